@@ -0,0 +1,51 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/algorithm-instantiations.h"
+
+namespace differential_privacy {
+
+template class Count<int>;
+template class Count<int64_t>;
+template class Count<float>;
+template class Count<double>;
+
+template class ApproxBounds<int>;
+template class ApproxBounds<int64_t>;
+template class ApproxBounds<float>;
+template class ApproxBounds<double>;
+
+template class BoundedSum<int>;
+template class BoundedSum<int64_t>;
+template class BoundedSum<float>;
+template class BoundedSum<double>;
+
+template class BoundedMean<int>;
+template class BoundedMean<int64_t>;
+template class BoundedMean<float>;
+template class BoundedMean<double>;
+
+template class BoundedVariance<int>;
+template class BoundedVariance<int64_t>;
+template class BoundedVariance<float>;
+template class BoundedVariance<double>;
+
+template class BoundedStandardDeviation<int>;
+template class BoundedStandardDeviation<int64_t>;
+template class BoundedStandardDeviation<float>;
+template class BoundedStandardDeviation<double>;
+
+}  // namespace differential_privacy
@@ -0,0 +1,76 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_INSTANTIATIONS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_INSTANTIATIONS_H_
+
+#include <cstdint>
+
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-standard-deviation.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/count.h"
+
+// Declares that the common algorithms for int, int64_t, float and double are
+// instantiated once in algorithm-instantiations.cc, so that translation units
+// that include this header instead of the individual algorithm headers do not
+// compile their own out-of-line copies of the member functions. This reduces
+// build times and binary sizes, and keeps a single copy of the code, e.g., for
+// profile-guided optimization. The compiler may still inline members that are
+// defined in the class. Depend on the algorithm-instantiations library to use
+// it.
+//
+// Instantiating a class also instantiates its nested Builder. Member function
+// templates, such as the AddEntries overload for iterators, are still
+// instantiated where they are used.
+
+namespace differential_privacy {
+
+extern template class Count<int>;
+extern template class Count<int64_t>;
+extern template class Count<float>;
+extern template class Count<double>;
+
+extern template class ApproxBounds<int>;
+extern template class ApproxBounds<int64_t>;
+extern template class ApproxBounds<float>;
+extern template class ApproxBounds<double>;
+
+extern template class BoundedSum<int>;
+extern template class BoundedSum<int64_t>;
+extern template class BoundedSum<float>;
+extern template class BoundedSum<double>;
+
+extern template class BoundedMean<int>;
+extern template class BoundedMean<int64_t>;
+extern template class BoundedMean<float>;
+extern template class BoundedMean<double>;
+
+extern template class BoundedVariance<int>;
+extern template class BoundedVariance<int64_t>;
+extern template class BoundedVariance<float>;
+extern template class BoundedVariance<double>;
+
+extern template class BoundedStandardDeviation<int>;
+extern template class BoundedStandardDeviation<int64_t>;
+extern template class BoundedStandardDeviation<float>;
+extern template class BoundedStandardDeviation<double>;
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_INSTANTIATIONS_H_
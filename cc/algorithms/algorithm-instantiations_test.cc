@@ -0,0 +1,100 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/algorithm-instantiations.h"
+
+#include <cstdint>
+#include <memory>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+
+template <typename T>
+class AlgorithmInstantiationsTest : public ::testing::Test {};
+
+typedef ::testing::Types<int, int64_t, float, double> InstantiatedTypes;
+TYPED_TEST_SUITE(AlgorithmInstantiationsTest, InstantiatedTypes);
+
+// The algorithms are linked from the explicit instantiations.
+TYPED_TEST(AlgorithmInstantiationsTest, AlgorithmsWork) {
+  std::unique_ptr<Count<TypeParam>> count =
+      typename Count<TypeParam>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<BoundedSum<TypeParam>> sum =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<BoundedMean<TypeParam>> mean =
+      typename BoundedMean<TypeParam>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<BoundedVariance<TypeParam>> variance =
+      typename BoundedVariance<TypeParam>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<BoundedStandardDeviation<TypeParam>> stddev =
+      typename BoundedStandardDeviation<TypeParam>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  for (TypeParam value : {2, 4}) {
+    count->AddEntry(value);
+    sum->AddEntry(value);
+    mean->AddEntry(value);
+    variance->AddEntry(value);
+    stddev->AddEntry(value);
+  }
+  EXPECT_EQ(GetValue<int64_t>(count->PartialResult().ValueOrDie()), 2);
+  EXPECT_EQ(GetValue<TypeParam>(sum->PartialResult().ValueOrDie()), 6);
+  EXPECT_DOUBLE_EQ(GetValue<double>(mean->PartialResult().ValueOrDie()), 3);
+  EXPECT_DOUBLE_EQ(GetValue<double>(variance->PartialResult().ValueOrDie()),
+                   1);
+  EXPECT_DOUBLE_EQ(GetValue<double>(stddev->PartialResult().ValueOrDie()), 1);
+
+  std::unique_ptr<ApproxBounds<TypeParam>> bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(4)
+          .SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  bounds->AddEntry(3);
+  EXPECT_OK(bounds->PartialResult());
+}
+
+}  // namespace
+}  // namespace differential_privacy
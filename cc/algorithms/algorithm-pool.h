@@ -0,0 +1,104 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "base/statusor.h"
+
+namespace differential_privacy {
+
+// Default maximum number of idle algorithms kept by an AlgorithmPool.
+constexpr int64_t kDefaultAlgorithmPoolMaxIdle = 1024;
+
+// AlgorithmPool recycles algorithms of type Alg, e.g., BoundedSum<double>, for
+// workloads that create and discard many short-lived aggregations with the
+// same parameters.
+//
+// Acquire() hands out an idle algorithm if there is one, and builds a new one
+// with the factory otherwise. Release() resets the algorithm, which discards
+// its entries and restores the full privacy budget, and keeps it for the next
+// Acquire(). Resetting keeps the mechanism, the ApproxBounds and the capacity
+// of the partial value vectors, so that acquiring and releasing algorithms
+// does not allocate once the pool is warm.
+//
+// Every algorithm handed out must have been built with the same parameters,
+// so the factory should always build the same configuration. The pool is
+// thread-safe; the algorithms it hands out are not.
+template <typename Alg>
+class AlgorithmPool {
+ public:
+  using Factory = std::function<base::StatusOr<std::unique_ptr<Alg>>()>;
+
+  // At most max_idle released algorithms are kept; further released
+  // algorithms are destroyed.
+  explicit AlgorithmPool(Factory factory,
+                         int64_t max_idle = kDefaultAlgorithmPoolMaxIdle)
+      : factory_(std::move(factory)), max_idle_(max_idle) {}
+
+  AlgorithmPool(const AlgorithmPool&) = delete;
+  AlgorithmPool& operator=(const AlgorithmPool&) = delete;
+
+  // Returns an algorithm without entries and with the full privacy budget.
+  // Returns the error of the factory if a new algorithm cannot be built.
+  base::StatusOr<std::unique_ptr<Alg>> Acquire() ABSL_LOCKS_EXCLUDED(mutex_) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!idle_.empty()) {
+        std::unique_ptr<Alg> algorithm = std::move(idle_.back());
+        idle_.pop_back();
+        return algorithm;
+      }
+    }
+    return factory_();
+  }
+
+  // Resets algorithm and returns it to the pool. algorithm must have been
+  // built with the same parameters as the algorithms of the factory.
+  void Release(std::unique_ptr<Alg> algorithm) ABSL_LOCKS_EXCLUDED(mutex_) {
+    if (algorithm == nullptr) {
+      return;
+    }
+    algorithm->Reset();
+    absl::MutexLock lock(&mutex_);
+    if (idle_.size() < max_idle_) {
+      idle_.push_back(std::move(algorithm));
+    }
+  }
+
+  // Returns the number of algorithms waiting to be acquired.
+  int64_t NumIdle() const ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return idle_.size();
+  }
+
+ private:
+  const Factory factory_;
+  const int64_t max_idle_;
+  mutable absl::Mutex mutex_;
+  std::vector<std::unique_ptr<Alg>> idle_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_POOL_H_
@@ -0,0 +1,127 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/algorithm-pool.h"
+
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/util.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::DoubleEq;
+using ::testing::HasSubstr;
+
+base::StatusOr<std::unique_ptr<BoundedSum<double>>> MakeBoundedSum() {
+  return BoundedSum<double>::Builder()
+      .SetEpsilon(1.0)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+TEST(AlgorithmPoolTest, ReleasedAlgorithmsAreResetAndReused) {
+  AlgorithmPool<BoundedSum<double>> pool(&MakeBoundedSum);
+  auto bs = pool.Acquire();
+  ASSERT_OK(bs);
+  BoundedSum<double>* address = bs->get();
+  (*bs)->AddEntry(4);
+  ASSERT_OK((*bs)->PartialResult());
+  pool.Release(std::move(*bs));
+  EXPECT_EQ(pool.NumIdle(), 1);
+
+  auto reused = pool.Acquire();
+  ASSERT_OK(reused);
+  EXPECT_EQ(reused->get(), address);
+  EXPECT_EQ(pool.NumIdle(), 0);
+  EXPECT_THAT((*reused)->RemainingPrivacyBudget(), DoubleEq(1));
+  (*reused)->AddEntry(2);
+  auto output = (*reused)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<double>(*output), 2);
+}
+
+TEST(AlgorithmPoolTest, BuildsNewAlgorithmsWhenEmpty) {
+  int num_built = 0;
+  AlgorithmPool<BoundedSum<double>> pool([&num_built]() {
+    ++num_built;
+    return MakeBoundedSum();
+  });
+  auto first = pool.Acquire();
+  ASSERT_OK(first);
+  auto second = pool.Acquire();
+  ASSERT_OK(second);
+  EXPECT_NE(first->get(), second->get());
+  pool.Release(std::move(*first));
+  pool.Release(std::move(*second));
+  for (int i = 0; i < 10; ++i) {
+    auto bs = pool.Acquire();
+    ASSERT_OK(bs);
+    pool.Release(std::move(*bs));
+  }
+  EXPECT_EQ(num_built, 2);
+}
+
+TEST(AlgorithmPoolTest, KeepsCapacityOfApproxBoundsState) {
+  AlgorithmPool<BoundedSum<double>> pool(
+      []() { return BoundedSum<double>::Builder().SetEpsilon(1.0).Build(); });
+  auto bs = pool.Acquire();
+  ASSERT_OK(bs);
+  for (int i = 0; i < 1000; ++i) {
+    (*bs)->AddEntry(i);
+  }
+  const int64_t memory = (*bs)->MemoryUsed();
+  pool.Release(std::move(*bs));
+
+  auto reused = pool.Acquire();
+  ASSERT_OK(reused);
+  EXPECT_EQ((*reused)->MemoryUsed(), memory);
+}
+
+TEST(AlgorithmPoolTest, DestroysAlgorithmsBeyondMaxIdle) {
+  AlgorithmPool<BoundedSum<double>> pool(&MakeBoundedSum, /*max_idle=*/1);
+  auto first = pool.Acquire();
+  ASSERT_OK(first);
+  auto second = pool.Acquire();
+  ASSERT_OK(second);
+  pool.Release(std::move(*first));
+  pool.Release(std::move(*second));
+  pool.Release(nullptr);
+  EXPECT_EQ(pool.NumIdle(), 1);
+}
+
+TEST(AlgorithmPoolTest, PropagatesFactoryError) {
+  AlgorithmPool<BoundedSum<double>> pool(
+      []() -> base::StatusOr<std::unique_ptr<BoundedSum<double>>> {
+        return absl::InvalidArgumentError("Factory failed.");
+      });
+  EXPECT_THAT(pool.Acquire(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                       HasSubstr("Factory failed")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
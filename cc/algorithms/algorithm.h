@@ -18,14 +18,21 @@
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_ALGORITHM_H_
 
 #include <cstddef>
+#include <functional>
+#include <future>  // NOLINT(build/c++11)
 #include <iterator>
 #include <memory>
 #include <string>
 
+#include "google/protobuf/arena.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/privacy-budget-accountant.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "proto/confidence-interval.pb.h"
@@ -38,6 +45,33 @@ namespace differential_privacy {
 constexpr double kDefaultDelta = 0.0;
 constexpr double kDefaultConfidenceLevel = .95;
 
+// Noise confidence interval of a ResultValue. Same as the ConfidenceInterval
+// proto.
+struct NoiseInterval {
+  double lower_bound;
+  double upper_bound;
+  double confidence_level;
+};
+
+// Result of an algorithm that releases a single value, returned by
+// PartialResultValue() without constructing an Output proto. Integral results
+// are converted to double, which is exact up to 2^53 in magnitude.
+struct ResultValue {
+  double value;
+  // Set if the algorithm provides a noise confidence interval.
+  absl::optional<NoiseInterval> noise_interval;
+};
+
+// Returns the noise interval with the values of a ConfidenceInterval proto.
+inline NoiseInterval ToNoiseInterval(const ConfidenceInterval& interval) {
+  return {interval.lower_bound(), interval.upper_bound(),
+          interval.confidence_level()};
+}
+
+// Runs a task, e.g., by submitting it to a thread pool. Must run every task it
+// is given exactly once, on any thread.
+using ResultExecutor = std::function<void(std::function<void()>)>;
+
 // Abstract superclass for differentially private algorithms.
 //
 // Includes a notion of privacy budget in addition to epsilon to allow for
@@ -68,6 +102,25 @@ class Algorithm {
   // Adds one input to the algorithm.
   virtual void AddEntry(const T& t) = 0;
 
+  // Adds t num_of_entries times, e.g., for input that is already aggregated
+  // into (value, frequency) pairs. Equivalent to calling AddEntry
+  // num_of_entries times. Subclasses override this to add all copies at once.
+  virtual void AddEntryWithCount(const T& t, uint64_t num_of_entries) {
+    for (uint64_t i = 0; i < num_of_entries; ++i) {
+      AddEntry(t);
+    }
+  }
+
+  // Removes num_of_entries entries equal to t that were added before, so that
+  // the state is the same as if they had never been added, e.g., for sliding
+  // windows. Returns an Unimplemented error and leaves the state unchanged
+  // for algorithms that cannot remove entries exactly.
+  virtual absl::Status RemoveEntryWithCount(const T& /*t*/,
+                                            uint64_t /*num_of_entries*/) {
+    return absl::UnimplementedError(
+        "RemoveEntryWithCount is not supported by this algorithm.");
+  }
+
   // Adds multiple inputs to the algorithm.
   template <typename Iterator>
   void AddEntries(Iterator begin, Iterator end) {
@@ -76,6 +129,16 @@ class Algorithm {
     }
   }
 
+  // Adds a contiguous array of inputs. Equivalent to calling AddEntry on each
+  // element. Subclasses override this with a loop that avoids the virtual call
+  // and per-entry bookkeeping of AddEntry. Subclasses that override it should
+  // also add `using Algorithm<T>::AddEntries;` to keep the iterator overload.
+  virtual void AddEntries(absl::Span<const T> entries) {
+    for (const T& t : entries) {
+      AddEntry(t);
+    }
+  }
+
   // Runs the algorithm on the input using the epsilon parameter
   // provided in the constructor and returns output.
   template <typename Iterator>
@@ -94,16 +157,65 @@ class Algorithm {
   // Privacy budget, defined on [0,1], represents the fraction of the total
   // budget to consume.
   base::StatusOr<Output> PartialResult(double privacy_budget) {
-    return GenerateResult(ConsumePrivacyBudget(privacy_budget),
-                          kDefaultConfidenceLevel);
+    return PartialResult(privacy_budget, kDefaultConfidenceLevel);
   }
 
   // Same as above, but provides the confidence level of the noise confidence
   // interval, which may be included in the algorithm output.
   base::StatusOr<Output> PartialResult(double privacy_budget,
                                        double noise_interval_level) {
-    return GenerateResult(ConsumePrivacyBudget(privacy_budget),
-                          noise_interval_level);
+    tracing::ScopedSpan span(tracing::TracePoint::kPartialResult);
+    ASSIGN_OR_RETURN(const double budget, ConsumeResultBudget(privacy_budget));
+    tracing::ScopedSpan generate_span(tracing::TracePoint::kGenerateResult);
+    return GenerateResult(budget, noise_interval_level);
+  }
+
+  // Same as PartialResult(privacy_budget, noise_interval_level), but generates
+  // the result on executor and returns a future of it, so that expensive
+  // results, e.g., of order statistics or with Gaussian noise, do not block
+  // the calling thread. The privacy budget is consumed on the calling thread
+  // before this returns. The algorithm must not be used in any other way,
+  // including for other asynchronous results, until the future is ready.
+  std::future<base::StatusOr<Output>> PartialResultAsync(
+      const ResultExecutor& executor, double privacy_budget,
+      double noise_interval_level = kDefaultConfidenceLevel) {
+    base::StatusOr<double> budget = ConsumeResultBudget(privacy_budget);
+    auto promise = std::make_shared<std::promise<base::StatusOr<Output>>>();
+    std::future<base::StatusOr<Output>> future = promise->get_future();
+    if (!budget.ok()) {
+      promise->set_value(budget.status());
+      return future;
+    }
+    executor([this, promise, budget = budget.ValueOrDie(),
+              noise_interval_level] {
+      tracing::ScopedSpan span(tracing::TracePoint::kGenerateResult);
+      promise->set_value(GenerateResult(budget, noise_interval_level));
+    });
+    return future;
+  }
+
+  // Same as above, but consumes the remaining privacy budget.
+  std::future<base::StatusOr<Output>> PartialResultAsync(
+      const ResultExecutor& executor) {
+    return PartialResultAsync(executor, RemainingPrivacyBudget());
+  }
+
+  // Same as PartialResult(), but returns the first value of the output and its
+  // noise confidence interval as a ResultValue. Algorithms that release a
+  // single value skip the construction of the Output proto, which is cheaper
+  // when releasing many results. The bounding report of automatically
+  // determined bounds is not included.
+  base::StatusOr<ResultValue> PartialResultValue() {
+    return PartialResultValue(RemainingPrivacyBudget());
+  }
+
+  base::StatusOr<ResultValue> PartialResultValue(
+      double privacy_budget,
+      double noise_interval_level = kDefaultConfidenceLevel) {
+    tracing::ScopedSpan span(tracing::TracePoint::kPartialResult);
+    ASSIGN_OR_RETURN(const double budget, ConsumeResultBudget(privacy_budget));
+    tracing::ScopedSpan generate_span(tracing::TracePoint::kGenerateResult);
+    return GenerateResultValue(budget, noise_interval_level);
   }
 
   double RemainingPrivacyBudget() { return privacy_budget_; }
@@ -122,6 +234,23 @@ class Algorithm {
     return budget - privacy_budget_;
   }
 
+  // Binds this algorithm to accountant, so that every result also consumes the
+  // used fraction of the epsilon of this algorithm, and of delta, from
+  // accountant. Results are refused with a FailedPrecondition error, without
+  // consuming any budget, if accountant does not have enough budget left.
+  // Only the result methods consume from the accountant, not
+  // ConsumePrivacyBudget. nullptr unbinds the algorithm.
+  void SetPrivacyBudgetAccountant(
+      std::shared_ptr<PrivacyBudgetAccountant> accountant, double delta = 0) {
+    accountant_ = std::move(accountant);
+    accountant_delta_ = delta;
+  }
+
+  const std::shared_ptr<PrivacyBudgetAccountant>& GetPrivacyBudgetAccountant()
+      const {
+    return accountant_;
+  }
+
   // Resets the algorithm to a state in which it has received no input. After
   // Reset is called, the algorithm should only consider input added after the
   // last Reset call when providing output.
@@ -135,15 +264,46 @@ class Algorithm {
   // Returns empty summary for algorithms for which serialize is unimplemented.
   virtual Summary Serialize() = 0;
 
+  // Like Serialize(), but allocates the Summary on arena, so that the summaries
+  // of many algorithms can be freed at once. If arena is nullptr, the caller
+  // takes ownership of the returned Summary. By default, this copies the
+  // result of Serialize() to the arena.
+  virtual Summary* SerializeToArena(google::protobuf::Arena* arena) {
+    if (arena == nullptr) {
+      return new Summary(Serialize());
+    }
+    Summary* summary = google::protobuf::Arena::CreateMessage<Summary>(arena);
+    *summary = Serialize();
+    return summary;
+  }
+
   // Merges serialized summary data into this algorithm. The summary proto must
   // represent data from the same algorithm type with identical parameters. The
   // data field must contain the algorithm summary type of the corresponding
   // algorithm used. The summary proto cannot be empty.
   virtual absl::Status Merge(const Summary& summary) = 0;
 
+  // Merges the entries of other into this algorithm. other must be the same
+  // algorithm type with identical parameters. other may be flushed, but its
+  // entries are not removed. By default this goes through other.Serialize()
+  // and Merge(); algorithms override it to combine their state directly.
+  virtual absl::Status MergeFrom(Algorithm<T>& other) {
+    return Merge(other.Serialize());
+  }
+
   // Returns the memory currently used by the algorithm in bytes.
   virtual int64_t MemoryUsed() = 0;
 
+  // Returns a new algorithm with the same parameters as this one, but without
+  // entries and with the full privacy budget. This is meant to be cheaper than
+  // building the algorithm again, e.g., when creating one algorithm per
+  // partition. Returns an Unimplemented error for algorithms that do not
+  // support it.
+  virtual base::StatusOr<std::unique_ptr<Algorithm<T>>> NewInstance() const {
+    return absl::UnimplementedError(
+        "NewInstance is not supported by this algorithm.");
+  }
+
   // Returns the confidence_level confidence interval of noise added within the
   // algorithm with specified privacy budget, using epsilon and other relevant,
   // algorithm-specific parameters (e.g. bounds) provided by the constructor.
@@ -173,14 +333,56 @@ class Algorithm {
   virtual base::StatusOr<Output> GenerateResult(
       double privacy_budget, double noise_interval_level) = 0;
 
+  // Returns the result of GenerateResult() as a ResultValue. By default, this
+  // converts the Output; algorithms that release a single value override it
+  // to compute the value directly.
+  virtual base::StatusOr<ResultValue> GenerateResultValue(
+      double privacy_budget, double noise_interval_level) {
+    ASSIGN_OR_RETURN(Output output,
+                     GenerateResult(privacy_budget, noise_interval_level));
+    if (output.elements_size() == 0) {
+      return absl::InternalError("Algorithm output has no elements.");
+    }
+    const ValueType& value = output.elements(0).value();
+    ResultValue result;
+    result.value = value.has_int_value() ? value.int_value()
+                                         : value.float_value();
+    if (output.error_report().has_noise_confidence_interval()) {
+      result.noise_interval = ToNoiseInterval(
+          output.error_report().noise_confidence_interval());
+    }
+    return result;
+  }
+
   // Allows child classes to reset their state as part of a global reset.
   virtual void ResetState() = 0;
 
+  // Binds other to the accountant of this algorithm, e.g., for NewInstance().
+  void SharePrivacyBudgetAccountant(Algorithm<T>* other) const {
+    other->SetPrivacyBudgetAccountant(accountant_, accountant_delta_);
+  }
+
+  // Consumes privacy_budget for a result, and the corresponding epsilon and
+  // delta from the accountant, if any. Consumes nothing if the accountant does
+  // not have enough budget left. Used by the PartialResult methods, including
+  // those of child classes.
+  base::StatusOr<double> ConsumeResultBudget(double privacy_budget) {
+    if (accountant_ != nullptr) {
+      const double fraction =
+          std::min(privacy_budget_, Clamp(0.0, 1.0, privacy_budget));
+      RETURN_IF_ERROR(accountant_->Consume(fraction * epsilon_,
+                                           fraction * accountant_delta_));
+    }
+    return ConsumePrivacyBudget(privacy_budget);
+  }
+
  private:
   static constexpr double kFullPrivacyBudget = 1.0;
 
   const double epsilon_;
   double privacy_budget_;
+  std::shared_ptr<PrivacyBudgetAccountant> accountant_;
+  double accountant_delta_ = 0;
 };
 
 template <typename T, class Algorithm, class Builder>
@@ -188,7 +390,7 @@ class AlgorithmBuilder {
  public:
   virtual ~AlgorithmBuilder() = default;
 
-  base::StatusOr<std::unique_ptr<Algorithm>> Build() {
+  base::StatusOr<std::unique_ptr<Algorithm>> Build() & {
     // Default epsilon is used whenever epsilon is not set. This value should
     // only be used for testing convenience. For any production use case, please
     // set your own epsilon based on privacy considerations.
@@ -218,7 +420,27 @@ class AlgorithmBuilder {
                              "Maximum number of contributions per partition"));
     }  // TODO: Default is set in UpdateAndBuildMechanism() below.
 
-    return BuildAlgorithm();
+    ASSIGN_OR_RETURN(std::unique_ptr<Algorithm> algorithm, BuildAlgorithm());
+    if (accountant_ != nullptr) {
+      if (move_state_) {
+        algorithm->SetPrivacyBudgetAccountant(std::move(accountant_),
+                                              delta_.value_or(0));
+      } else {
+        algorithm->SetPrivacyBudgetAccountant(accountant_, delta_.value_or(0));
+      }
+    }
+    return algorithm;
+  }
+
+  // Builds the algorithm from a builder that is not used anymore, e.g.,
+  // std::move(builder).Build() or Count<T>::Builder().Build(). Instead of
+  // cloning the mechanism builder for its last use, it is moved into the
+  // algorithm, and so is the accountant, which saves allocations when many
+  // algorithms are built, e.g., one per partition. The builder must not be
+  // used afterwards.
+  base::StatusOr<std::unique_ptr<Algorithm>> Build() && {
+    move_state_ = true;
+    return Build();
   }
 
   Builder& SetEpsilon(double epsilon) {
@@ -243,17 +465,44 @@ class AlgorithmBuilder {
     return *static_cast<Builder*>(this);
   }
 
+  // Binds the built algorithm to accountant, see
+  // Algorithm::SetPrivacyBudgetAccountant. The delta of the algorithm is
+  // consumed along with its epsilon.
+  Builder& SetPrivacyBudgetAccountant(
+      std::shared_ptr<PrivacyBudgetAccountant> accountant) {
+    accountant_ = std::move(accountant);
+    return *static_cast<Builder*>(this);
+  }
+
   Builder& SetLaplaceMechanism(
       std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
     mechanism_builder_ = std::move(mechanism_builder);
     return *static_cast<Builder*>(this);
   }
 
+  // With a lazy mechanism, the algorithm keeps the mechanism builder and builds
+  // its noise mechanisms only when a result or a noise confidence interval is
+  // first requested, instead of in Build(). This saves the construction cost
+  // for algorithms that never release a result, e.g., for partitions that are
+  // dropped by partition selection, but invalid mechanism parameters are only
+  // reported then. Supported by Count, ApproxBounds, BoundedSum, BoundedMean,
+  // BoundedVariance and BoundedStandardDeviation; other algorithms build their
+  // mechanisms eagerly.
+  Builder& SetLazyMechanism(bool lazy_mechanism) {
+    lazy_mechanism_ = lazy_mechanism;
+    return *static_cast<Builder*>(this);
+  }
+
  private:
   absl::optional<double> epsilon_;
   absl::optional<double> delta_;
   absl::optional<int> l0_sensitivity_;
   absl::optional<int> max_contributions_per_partition_;
+  bool lazy_mechanism_ = false;
+  std::shared_ptr<PrivacyBudgetAccountant> accountant_;
+  // Whether the state of the builder may be moved into the algorithm, see
+  // Build() &&.
+  bool move_state_ = false;
 
   // The mechanism builder is used to interject custom mechanisms for testing.
   std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_ =
@@ -269,15 +518,35 @@ class AlgorithmBuilder {
     return max_contributions_per_partition_;
   }
 
+  bool GetLazyMechanism() const { return lazy_mechanism_; }
+
   std::unique_ptr<NumericalMechanismBuilder> GetMechanismBuilderClone() const {
     return mechanism_builder_->Clone();
   }
 
+  // Returns the mechanism builder for its last use in BuildAlgorithm(): the
+  // mechanism builder itself when building with Build() &&, and a clone
+  // otherwise. Must be called at most once per build, after all calls to
+  // GetMechanismBuilderClone().
+  std::unique_ptr<NumericalMechanismBuilder> TakeMechanismBuilder() {
+    if (move_state_) {
+      return std::move(mechanism_builder_);
+    }
+    return mechanism_builder_->Clone();
+  }
+
   virtual base::StatusOr<std::unique_ptr<Algorithm>> BuildAlgorithm() = 0;
 
   base::StatusOr<std::unique_ptr<NumericalMechanism>>
   UpdateAndBuildMechanism() {
-    auto clone = mechanism_builder_->Clone();
+    return UpdateMechanismBuilder()->Build();
+  }
+
+  // Returns the mechanism builder, see TakeMechanismBuilder(), with the
+  // parameters of this builder set, from which UpdateAndBuildMechanism()
+  // builds the mechanism.
+  std::unique_ptr<NumericalMechanismBuilder> UpdateMechanismBuilder() {
+    auto clone = TakeMechanismBuilder();
     if (epsilon_.has_value()) {
       clone->SetEpsilon(epsilon_.value());
     }
@@ -287,9 +556,9 @@ class AlgorithmBuilder {
     // If not set, we are using 1 as default value for both, L0 and Linf, as
     // fallback for existing clients.
     // TODO: Refactor, consolidate, or remove defaults.
-    return clone->SetL0Sensitivity(l0_sensitivity_.value_or(1))
-        .SetLInfSensitivity(max_contributions_per_partition_.value_or(1))
-        .Build();
+    clone->SetL0Sensitivity(l0_sensitivity_.value_or(1))
+        .SetLInfSensitivity(max_contributions_per_partition_.value_or(1));
+    return clone;
   }
 };
 
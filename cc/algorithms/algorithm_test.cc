@@ -16,8 +16,12 @@
 
 #include "algorithms/algorithm.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <forward_list>
+#include <functional>
+#include <future>  // NOLINT(build/c++11)
 #include <list>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "base/testing/status_matchers.h"
@@ -125,6 +129,13 @@ TEST(IncrementalAlgorithmTest, MergedPartialResultConsumesBudget) {
   EXPECT_THAT(alg_2.RemainingPrivacyBudget(), DoubleNear(0.0, kTestPrecision));
 }
 
+TEST(IncrementalAlgorithmTest, NewInstanceIsUnimplementedByDefault) {
+  TestAlgorithm<double> alg;
+  EXPECT_THAT(alg.NewInstance(),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("NewInstance is not supported")));
+}
+
 TEST(IncrementalAlgorithmDeathTest, BudgetTooHigh) {
   TestAlgorithm<double> alg;
   ASSERT_OK(alg.PartialResult(0.5));
@@ -216,5 +227,56 @@ TEST(IncrementalAlgorithmBuilderTest,
                                  "partition must be positive")));
 }
 
+TEST(IncrementalAlgorithmTest, PartialResultValueConsumesBudget) {
+  TestAlgorithm<double> alg;
+  // The output of TestAlgorithm has no elements to convert.
+  EXPECT_THAT(alg.PartialResultValue(.3),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("Algorithm output has no elements")));
+  EXPECT_THAT(alg.RemainingPrivacyBudget(), DoubleNear(.7, kTestPrecision));
+}
+
+
+TEST(IncrementalAlgorithmTest, PartialResultAsyncConsumesBudgetImmediately) {
+  TestAlgorithm<double> alg;
+  std::vector<std::function<void()>> tasks;
+  ResultExecutor executor = [&tasks](std::function<void()> task) {
+    tasks.push_back(std::move(task));
+  };
+  std::future<base::StatusOr<Output>> future =
+      alg.PartialResultAsync(executor, .4, .8);
+  EXPECT_THAT(alg.RemainingPrivacyBudget(), DoubleNear(.6, kTestPrecision));
+  ASSERT_EQ(tasks.size(), 1);
+  EXPECT_EQ(future.wait_for(std::chrono::seconds(0)),
+            std::future_status::timeout);
+  tasks[0]();
+  base::StatusOr<Output> output = future.get();
+  ASSERT_OK(output);
+  EXPECT_EQ(output.ValueOrDie()
+                .error_report()
+                .noise_confidence_interval()
+                .confidence_level(),
+            .8);
+}
+
+TEST(IncrementalAlgorithmTest, PartialResultAsyncGeneratesConcurrently) {
+  std::vector<std::thread> threads;
+  ResultExecutor executor = [&threads](std::function<void()> task) {
+    threads.emplace_back(std::move(task));
+  };
+  std::vector<TestAlgorithm<double>> algorithms(8);
+  std::vector<std::future<base::StatusOr<Output>>> futures;
+  for (TestAlgorithm<double>& alg : algorithms) {
+    futures.push_back(alg.PartialResultAsync(executor));
+    EXPECT_EQ(alg.RemainingPrivacyBudget(), 0);
+  }
+  for (std::future<base::StatusOr<Output>>& future : futures) {
+    EXPECT_OK(future.get());
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -0,0 +1,202 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for ingestion, serialization, merging and result generation of
+// the algorithms in this directory. All algorithms are benchmarked through the
+// Algorithm<double> interface, since that is how callers use them.
+
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/random/random.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/count.h"
+#include "algorithms/order-statistics.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr double kEpsilon = 1.0;
+constexpr double kLower = -50;
+constexpr double kUpper = 50;
+
+using AlgorithmFactory = std::unique_ptr<Algorithm<double>> (*)();
+
+std::unique_ptr<Algorithm<double>> MakeCount() {
+  return Count<double>::Builder().SetEpsilon(kEpsilon).Build().ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedSum() {
+  return BoundedSum<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedSumWithApproxBounds() {
+  return BoundedSum<double>::Builder().SetEpsilon(kEpsilon).Build().ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedMean() {
+  return BoundedMean<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedMeanWithApproxBounds() {
+  return BoundedMean<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedVariance() {
+  return BoundedVariance<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedVarianceWithApproxBounds() {
+  return BoundedVariance<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeApproxBounds() {
+  return ApproxBounds<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakePercentile() {
+  return continuous::Percentile<double>::Builder()
+      .SetPercentile(0.5)
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+// Returns n deterministic pseudo-random values in [kLower, kUpper).
+std::vector<double> Input(int64_t n) {
+  std::mt19937 gen(/*seed=*/n);
+  std::vector<double> input(n);
+  for (double& value : input) {
+    value = absl::Uniform(gen, kLower, kUpper);
+  }
+  return input;
+}
+
+void BM_AddEntry(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> algorithm = factory();
+  const std::vector<double> input = Input(state.range(0));
+  for (auto _ : state) {
+    algorithm->Reset();
+    for (double value : input) {
+      algorithm->AddEntry(value);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+}
+
+void BM_AddEntries(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> algorithm = factory();
+  const std::vector<double> input = Input(state.range(0));
+  for (auto _ : state) {
+    algorithm->Reset();
+    algorithm->AddEntries(absl::MakeConstSpan(input));
+  }
+  state.SetItemsProcessed(state.iterations() * input.size());
+  state.SetBytesProcessed(state.iterations() * input.size() * sizeof(double));
+}
+
+void BM_Serialize(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> algorithm = factory();
+  const std::vector<double> input = Input(state.range(0));
+  algorithm->AddEntries(input.begin(), input.end());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(algorithm->Serialize());
+  }
+  state.SetLabel(
+      absl::StrCat(algorithm->Serialize().ByteSizeLong(), " bytes"));
+}
+
+void BM_Merge(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> source = factory();
+  const std::vector<double> input = Input(state.range(0));
+  source->AddEntries(input.begin(), input.end());
+  const Summary summary = source->Serialize();
+  std::unique_ptr<Algorithm<double>> target = factory();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(target->Merge(summary));
+  }
+}
+
+void BM_Result(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> algorithm = factory();
+  const std::vector<double> input = Input(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    algorithm->Reset();
+    algorithm->AddEntries(input.begin(), input.end());
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(algorithm->PartialResult());
+  }
+}
+
+// Registers the AddEntry, AddEntries, Serialize, Merge and Result benchmarks
+// for the algorithm built by factory, over a range of input sizes.
+#define DP_ALGORITHM_BENCHMARKS(name, factory)                             \
+  BENCHMARK_CAPTURE(BM_AddEntry, name, factory)->Range(1 << 4, 1 << 16);  \
+  BENCHMARK_CAPTURE(BM_AddEntries, name, factory)->Range(1 << 4, 1 << 16); \
+  BENCHMARK_CAPTURE(BM_Serialize, name, factory)->Range(1 << 4, 1 << 16); \
+  BENCHMARK_CAPTURE(BM_Merge, name, factory)->Range(1 << 4, 1 << 16);     \
+  BENCHMARK_CAPTURE(BM_Result, name, factory)->Range(1 << 4, 1 << 16)
+
+DP_ALGORITHM_BENCHMARKS(Count, &MakeCount);
+DP_ALGORITHM_BENCHMARKS(BoundedSum, &MakeBoundedSum);
+DP_ALGORITHM_BENCHMARKS(BoundedSumWithApproxBounds,
+                        &MakeBoundedSumWithApproxBounds);
+DP_ALGORITHM_BENCHMARKS(BoundedMean, &MakeBoundedMean);
+DP_ALGORITHM_BENCHMARKS(BoundedMeanWithApproxBounds,
+                        &MakeBoundedMeanWithApproxBounds);
+DP_ALGORITHM_BENCHMARKS(BoundedVariance, &MakeBoundedVariance);
+DP_ALGORITHM_BENCHMARKS(BoundedVarianceWithApproxBounds,
+                        &MakeBoundedVarianceWithApproxBounds);
+DP_ALGORITHM_BENCHMARKS(ApproxBounds, &MakeApproxBounds);
+DP_ALGORITHM_BENCHMARKS(Percentile, &MakePercentile);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -17,15 +17,25 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_APPROX_BOUNDS_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_APPROX_BOUNDS_H_
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "google/protobuf/any.pb.h"
+#include "absl/numeric/bits.h"
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "algorithms/algorithm.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "base/canonical_errors.h"
@@ -33,6 +43,68 @@
 
 namespace differential_privacy {
 
+// Deferred form of the per-bin partials built by
+// ApproxBounds::AddMultipleEntriesToPartials. Adding a value there updates
+// every bin up to the bin of its most significant bit, but the contribution to
+// each bin below the msb is the same constant for all values. LazyPartials
+// therefore only records, per msb, how many values had that msb and the sum of
+// their contributions to the msb bin. This costs O(1) per value. The full
+// partials are reconstructed with ApproxBounds::FlushLazyPartials.
+//
+// For integral types the reconstructed partials are identical to the ones
+// built by AddMultipleEntriesToPartials, including wrap-around on overflow.
+// For floating-point types they may differ in the last bits, since the
+// constant contributions are multiplied by a count instead of being added one
+// by one.
+template <typename T2>
+class LazyPartials {
+ public:
+  explicit LazyPartials(int num_bins = 0) { Resize(num_bins); }
+
+  void Resize(int num_bins) {
+    pos_entries_.assign(num_bins, 0);
+    neg_entries_.assign(num_bins, 0);
+    remainders_.assign(num_bins, 0);
+    has_entries_ = false;
+  }
+
+  // Records num_of_entries values whose most significant bit is msb and that
+  // contribute remainder each to the bin of msb.
+  void Add(int msb, bool positive, T2 remainder, uint64_t num_of_entries) {
+    if (positive) {
+      pos_entries_[msb] += num_of_entries;
+    } else {
+      neg_entries_[msb] += num_of_entries;
+    }
+    remainders_[msb] += remainder * num_of_entries;
+    has_entries_ = true;
+  }
+
+  void Clear() {
+    if (has_entries_) {
+      Resize(remainders_.size());
+    }
+  }
+
+  bool HasEntries() const { return has_entries_; }
+  int NumBins() const { return remainders_.size(); }
+  uint64_t PositiveEntries(int msb) const { return pos_entries_[msb]; }
+  uint64_t NegativeEntries(int msb) const { return neg_entries_[msb]; }
+  T2 Remainder(int msb) const { return remainders_[msb]; }
+
+  int64_t MemoryUsed() const {
+    return sizeof(uint64_t) *
+               (pos_entries_.capacity() + neg_entries_.capacity()) +
+           sizeof(T2) * remainders_.capacity();
+  }
+
+ private:
+  std::vector<uint64_t> pos_entries_;
+  std::vector<uint64_t> neg_entries_;
+  std::vector<T2> remainders_;
+  bool has_entries_ = false;
+};
+
 // Find the approximate bounds of a set of numbers using logarithmic histogram
 // bins. Like other algorithms, ApproxBounds assumes that it only gets one input
 // per user.
@@ -67,6 +139,15 @@ namespace differential_privacy {
 // greater than the threshold. In this case we return an error status in the
 // output.
 //
+// If kNumBins is positive, the number of bins is fixed at compile time and the
+// bin counts, boundaries and widths are stored in std::arrays inside the
+// object rather than in separately allocated vectors. The builder then
+// defaults to kNumBins bins and rejects any other number.
+//
+// With base 2 and a power of two scale, which includes the default parameters,
+// the bin of an input is found with a bit width computation instead of
+// logarithms.
+//
 // For example, if
 //   scale = 2, base = 1, num_bins = 4, inputs = {0, 0, 0, 0, 1, 3, 7, 8, 8, 8}
 // We have histogram bins and counts
@@ -78,12 +159,14 @@ namespace differential_privacy {
 // threshold=3.5. Since the count of bin (4, 8] > threshold, we return an
 // approx max of 2^3 = 8. Since the count of bin [0,1] > threshold, we return an
 // approx min of 0.
-template <typename T>
+template <typename T, int kNumBins = 0>
 class ApproxBounds : public Algorithm<T> {
  public:
-  class Builder : public AlgorithmBuilder<T, ApproxBounds<T>, Builder> {
+  class Builder
+      : public AlgorithmBuilder<T, ApproxBounds<T, kNumBins>, Builder> {
     using AlgorithmBuilder =
-        differential_privacy::AlgorithmBuilder<T, ApproxBounds<T>, Builder>;
+        differential_privacy::AlgorithmBuilder<T, ApproxBounds<T, kNumBins>,
+                                               Builder>;
 
    public:
     // Constructor sets default values depending on the input type. Bins are
@@ -102,6 +185,9 @@ class ApproxBounds : public Algorithm<T> {
                              std::log(scale_)) /
                             std::log(base_)) +
                   1;
+      if (kNumBins > 0) {
+        num_bins_ = kNumBins;
+      }
     }
 
     Builder& SetNumBins(int64_t num_bins) {
@@ -134,14 +220,26 @@ class ApproxBounds : public Algorithm<T> {
     }
 
    private:
-    base::StatusOr<std::unique_ptr<ApproxBounds<T>>> BuildAlgorithm() override {
+    base::StatusOr<std::unique_ptr<ApproxBounds<T, kNumBins>>> BuildAlgorithm()
+        override {
       std::unique_ptr<NumericalMechanism> mechanism;
-      ASSIGN_OR_RETURN(mechanism, AlgorithmBuilder::UpdateAndBuildMechanism());
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder;
+      if (AlgorithmBuilder::GetLazyMechanism()) {
+        mechanism_builder = AlgorithmBuilder::UpdateMechanismBuilder();
+      } else {
+        ASSIGN_OR_RETURN(mechanism,
+                         AlgorithmBuilder::UpdateAndBuildMechanism());
+      }
 
       // Check the validity of the histogram parameters. num_bin and
       // success_probability restrictions prevent undefined threshold
       // calculation.
       RETURN_IF_ERROR(ValidateIsPositive(num_bins_, "Number of bins"));
+      if (kNumBins > 0 && num_bins_ != kNumBins) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Number of bins must be ", kNumBins,
+                         " for fixed-size bins, but is ", num_bins_, "."));
+      }
       RETURN_IF_ERROR(ValidateIsFiniteAndPositive(scale_, "Scale"));
       RETURN_IF_ERROR(ValidateIsFinite(base_, "Base"));
       RETURN_IF_ERROR(ValidateIsGreaterThanOrEqualTo(base_, 1, "Base"));
@@ -170,9 +268,9 @@ class ApproxBounds : public Algorithm<T> {
       }
 
       // Create ApproxBounds.
-      return absl::WrapUnique(
-          new ApproxBounds(AlgorithmBuilder::GetEpsilon().value(), num_bins_,
-                           scale_, base_, k_, has_k_, std::move(mechanism)));
+      return absl::WrapUnique(new ApproxBounds(
+          AlgorithmBuilder::GetEpsilon().value(), num_bins_, scale_, base_, k_,
+          has_k_, std::move(mechanism), std::move(mechanism_builder)));
     }
 
     // Stores whether threshold k is set.
@@ -185,24 +283,46 @@ class ApproxBounds : public Algorithm<T> {
     double success_probability_;
   };
 
-  void AddEntry(const T& input) override { AddMultipleEntries(input, 1); }
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& input) override {
+    metrics::Add(metrics::Counter::kApproxBoundsEntries);
+    AddMultipleEntries(input, 1);
+  }
+
+  void AddEntryWithCount(const T& input, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kApproxBoundsEntries, num_of_entries);
+    AddMultipleEntries(input, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kApproxBoundsEntries, entries.size());
+    for (const T& input : entries) {
+      AddMultipleEntries(input, 1);
+    }
+  }
 
   // Serialize the positive and negative bin counts.
   Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
     ApproxBoundsSummary am_summary;
     *am_summary.mutable_pos_bin_count() = {pos_bins_.begin(), pos_bins_.end()};
     *am_summary.mutable_neg_bin_count() = {neg_bins_.begin(), neg_bins_.end()};
     Summary summary;
     summary.mutable_data()->PackFrom(am_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
     return summary;
   }
 
   // Retrieve positive and negative bin counts from summary and add them.
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError(
           "Cannot merge summary with no histogram data.");
     }
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
     ApproxBoundsSummary am_summary;
     if (!summary.data().UnpackTo(&am_summary)) {
       return absl::InternalError(
@@ -224,15 +344,37 @@ class ApproxBounds : public Algorithm<T> {
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_bounds = dynamic_cast<ApproxBounds<T, kNumBins>*>(&other);
+    if (other_bounds == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if (pos_bins_.size() != other_bounds->pos_bins_.size() ||
+        neg_bins_.size() != other_bounds->neg_bins_.size()) {
+      return absl::InternalError(
+          "Merged approximate max summary must have the same number of "
+          "bin counts as this histogram.");
+    }
+    for (int i = 0; i < pos_bins_.size(); ++i) {
+      pos_bins_[i] += other_bounds->pos_bins_[i];
+      neg_bins_[i] += other_bounds->neg_bins_[i];
+    }
+    return absl::OkStatus();
+  }
+
   int64_t MemoryUsed() override {
-    int64_t memory = sizeof(ApproxBounds<T>) +
-                   sizeof(int64_t) * neg_bins_.capacity() +
-                   sizeof(int64_t) * pos_bins_.capacity() +
-                   sizeof(T) * noisy_neg_bins_.capacity() +
-                   sizeof(T) * noisy_pos_bins_.capacity();
+    int64_t memory = sizeof(ApproxBounds<T, kNumBins>) +
+                     HeapBytes(neg_bins_) + HeapBytes(pos_bins_) +
+                     sizeof(T) * noisy_neg_bins_.capacity() +
+                     sizeof(T) * noisy_pos_bins_.capacity() +
+                     HeapBytes(bin_boundaries_) + HeapBytes(pos_bin_widths_) +
+                     HeapBytes(neg_bin_widths_);
     if (mechanism_) {
       memory += mechanism_->MemoryUsed();
     }
+    if (mechanism_builder_) {
+      memory += sizeof(*mechanism_builder_);
+    }
     return memory;
   }
 
@@ -264,7 +406,12 @@ class ApproxBounds : public Algorithm<T> {
     }
 
     // Calculate the most significant bit and clamp to a valid bin index.
-    int msb = std::ceil((std::log(abs) - std::log(scale_)) / std::log(base_));
+    int msb;
+    if (log2_scale_.has_value()) {
+      msb = CeilLog2(abs) - *log2_scale_;
+    } else {
+      msb = std::ceil((std::log(abs) - std::log(scale_)) / std::log(base_));
+    }
     int bin_index =
         std::max(0, std::min(msb, static_cast<int>(pos_bins_.size() - 1)));
 
@@ -296,9 +443,9 @@ class ApproxBounds : public Algorithm<T> {
   // that lie in bins that are included in the bounds. In our case it is bins
   // (0, 1], (1, 2], (2, 4]. So 1 + 1 + 2 = 4. This is the same result if our
   // value 7 was initially clamped between [0, 4].
-  template <typename T2>
+  template <typename T2, typename MakePartial>
   void AddToPartials(std::vector<T2>* partials, T value,
-                     std::function<T2(T, T)> make_partial) {
+                     MakePartial make_partial) {
     AddMultipleEntriesToPartials<T2>(partials, value, 1, make_partial);
   }
 
@@ -311,10 +458,10 @@ class ApproxBounds : public Algorithm<T> {
   // the boundaries corresponding to lower and upper to get the clamped value.
   // The value_transform and count parameters are used to calculate the
   // contribution of values clamped below lower or above upper, if applicable.
-  template <typename T2>
-  T2 ComputeFromPartials(const std::vector<T2>& pos_partials,
-                         const std::vector<T2>& neg_partials,
-                         std::function<T2(T)> value_transform, T lower, T upper,
+  template <typename T2, typename ValueTransform, typename Allocator>
+  T2 ComputeFromPartials(const std::vector<T2, Allocator>& pos_partials,
+                         const std::vector<T2, Allocator>& neg_partials,
+                         ValueTransform value_transform, T lower, T upper,
                          uint64_t count) {
     // Find value by adding the partial values corresponding to bins that are
     // between the lower and upper bound. ApproxBounds will always return a
@@ -374,19 +521,57 @@ class ApproxBounds : public Algorithm<T> {
     return report;
   }
 
+  // Returns the bounds in an output of an ApproxBounds with the same bins as
+  // this one. This allows one noisy result to be shared by several algorithms
+  // that store partials for these bins, see ComputeFromPartials(), e.g., by the
+  // sum, mean and variance of the same column.
+  base::StatusOr<std::pair<T, T>> BoundsFromOutput(const Output& bounds) {
+    if (bounds.elements_size() != 2) {
+      return absl::InvalidArgumentError(
+          "Approximate bounds must have two elements.");
+    }
+    const T lower = GetValue<T>(bounds.elements(0).value());
+    const T upper = GetValue<T>(bounds.elements(1).value());
+    if (lower > upper) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Lower approximate bound ", lower,
+          " must not be larger than the upper bound ", upper, "."));
+    }
+    if (!IsBinBoundary(lower) || !IsBinBoundary(upper)) {
+      return absl::InvalidArgumentError(
+          "Approximate bounds must be bin boundaries of an ApproxBounds with "
+          "the same bins.");
+    }
+    return std::make_pair(lower, upper);
+  }
+
  protected:
-  ApproxBounds(double epsilon, int64_t num_bins, double scale, double base,
-               double k, bool preset_k,
-               std::unique_ptr<NumericalMechanism> mechanism)
+  // If mechanism is nullptr, it is built from mechanism_builder when it is
+  // first needed.
+  ApproxBounds(
+      double epsilon, int64_t num_bins, double scale, double base, double k,
+      bool preset_k, std::unique_ptr<NumericalMechanism> mechanism,
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder = nullptr)
       : Algorithm<T>(epsilon),
-        pos_bins_(num_bins, 0),
-        neg_bins_(num_bins, 0),
-        bin_boundaries_(num_bins, 0),
         scale_(scale),
         base_(base),
         k_(k),
         preset_k_(preset_k),
-        mechanism_(std::move(mechanism)) {
+        mechanism_(std::move(mechanism)),
+        mechanism_builder_(std::move(mechanism_builder)) {
+    InitBins(&pos_bins_, num_bins);
+    InitBins(&neg_bins_, num_bins);
+    InitBins(&bin_boundaries_, num_bins);
+    InitBins(&pos_bin_widths_, num_bins);
+    InitBins(&neg_bin_widths_, num_bins);
+
+    // With base 2 and a power of two scale, bin indices are exact base 2
+    // logarithms.
+    int scale_exponent;
+    if (base_ == 2 && std::frexp(scale_, &scale_exponent) == 0.5) {
+      log2_scale_ = scale_exponent - 1;
+    }
+
     // Cache the bin boundary magnitudes for performance. Note that casting
     // numeric limits lead to inconsistencies.
     auto get_boundary = [boundary = scale_, base = base_]() mutable {
@@ -398,6 +583,13 @@ class ApproxBounds : public Algorithm<T> {
       return static_cast<T>(this_boundary);
     };
     std::generate(bin_boundaries_.begin(), bin_boundaries_.end(), get_boundary);
+
+    // Cache the partial sum that a value contributes to each bin below the
+    // bin of its most significant bit.
+    for (int i = 0; i < num_bins; ++i) {
+      pos_bin_widths_[i] = PosRightBinBoundary(i) - PosLeftBinBoundary(i);
+      neg_bin_widths_[i] = NegRightBinBoundary(i) - NegLeftBinBoundary(i);
+    }
   }
 
   // Returns an output containing approximate min as the first element and
@@ -415,6 +607,14 @@ class ApproxBounds : public Algorithm<T> {
       threshold /= privacy_budget;
     }
 
+    if (!mechanism_) {
+      ASSIGN_OR_RETURN(mechanism_, mechanism_builder_->Build());
+      mechanism_builder_.reset();
+    }
+
+    tracing::ScopedSpan span(
+        tracing::TracePoint::kApproxBoundsThresholdSearch);
+
     // Populate noisy versions of the histogram bins.
     noisy_pos_bins_ = AddNoise(privacy_budget, pos_bins_);
     noisy_neg_bins_ = AddNoise(privacy_budget, neg_bins_);
@@ -505,10 +705,10 @@ class ApproxBounds : public Algorithm<T> {
   // Adds value to partials (as described in comment for AddToPartials())
   // num_of_entries times. This function more efficiently adds multiple entries
   // at once, instead of using AddToPartials() in a for-loop.
-  template <typename T2>
+  template <typename T2, typename MakePartial>
   void AddMultipleEntriesToPartials(std::vector<T2>* partials, T value,
                                     uint64_t num_of_entries,
-                                    std::function<T2(T, T)> make_partial) {
+                                    MakePartial make_partial) {
     int msb = MostSignificantBit(value);
 
     // Each bin of the logarithmic histograms in ApproxBounds can be a candidate
@@ -550,17 +750,169 @@ class ApproxBounds : public Algorithm<T> {
 
   // Break value into its partial sums and store it into the sums vector. A
   // specific use case of AddToPartials used in some algorithms.
+  //
+  // Equivalent to AddMultipleEntriesToPartials with the difference function,
+  // but reads the contribution to every bin below the msb from the cached bin
+  // widths, so that those bins are updated by a single loop over a prefix.
   template <typename T2>
   void AddMultipleEntriesToPartialSums(std::vector<T2>* sums, T value,
                                        uint64_t num_of_entries) {
-    AddMultipleEntriesToPartials<T2>(
-        sums, value, num_of_entries,
-        [](T val1, T val2) { return val1 - val2; });
+    const int msb = MostSignificantBit(value);
+    const T* widths =
+        value >= 0 ? pos_bin_widths_.data() : neg_bin_widths_.data();
+    T2* partials = sums->data();
+
+    for (int i = 0; i < msb; ++i) {
+      partials[i] += static_cast<T2>(widths[i]) * num_of_entries;
+    }
+
+    // The bin of the msb receives the remainder of the value, but not more
+    // than the width of the bin. See AddMultipleEntriesToPartials.
+    T2 partial = widths[msb];
+    T2 remainder;
+    if (value > 0) {
+      remainder = value - PosLeftBinBoundary(msb);
+    } else {
+      remainder = value - NegLeftBinBoundary(msb);
+    }
+    if (std::abs(partial) < std::abs(remainder)) {
+      partials[msb] += partial * num_of_entries;
+    } else {
+      partials[msb] += remainder * num_of_entries;
+    }
+  }
+
+  // Records value num_of_entries times in lazy, such that flushing lazy with
+  // the same make_partial adds the same partials as
+  // AddMultipleEntriesToPartials would. lazy must have NumPositiveBins() bins.
+  template <typename T2, typename MakePartial>
+  void AddMultipleEntriesToLazyPartials(LazyPartials<T2>* lazy, T value,
+                                        uint64_t num_of_entries,
+                                        MakePartial make_partial) {
+    int msb = MostSignificantBit(value);
+    T2 partial;
+    if (value >= 0) {
+      partial = make_partial(PosRightBinBoundary(msb), PosLeftBinBoundary(msb));
+    } else {
+      partial = make_partial(NegRightBinBoundary(msb), NegLeftBinBoundary(msb));
+    }
+    T2 remainder;
+    if (value > 0) {
+      remainder = make_partial(value, PosLeftBinBoundary(msb));
+    } else {
+      remainder = make_partial(value, NegLeftBinBoundary(msb));
+    }
+    lazy->Add(msb, value >= 0,
+              std::abs(partial) < std::abs(remainder) ? partial : remainder,
+              num_of_entries);
+  }
+
+  // Lazy version of AddMultipleEntriesToPartialSums.
+  template <typename T2>
+  void AddMultipleEntriesToLazyPartialSums(LazyPartials<T2>* lazy, T value,
+                                           uint64_t num_of_entries) {
+    int msb = MostSignificantBit(value);
+    T2 partial = value >= 0 ? pos_bin_widths_[msb] : neg_bin_widths_[msb];
+    T2 remainder;
+    if (value > 0) {
+      remainder = value - PosLeftBinBoundary(msb);
+    } else {
+      remainder = value - NegLeftBinBoundary(msb);
+    }
+    lazy->Add(msb, value >= 0,
+              std::abs(partial) < std::abs(remainder) ? partial : remainder,
+              num_of_entries);
+  }
+
+  // Adds input num_of_entries times to the bins, and records its partial sums
+  // in lazy_sums and its partials for make_partial in lazy_partials. This is
+  // the same as AddMultipleEntries, AddMultipleEntriesToLazyPartialSums and
+  // AddMultipleEntriesToLazyPartials, but finds the bin of input and its
+  // boundaries only once.
+  template <typename T2, typename T3, typename MakePartial>
+  void AddMultipleEntriesWithLazyPartials(const T& input,
+                                          uint64_t num_of_entries,
+                                          LazyPartials<T2>* lazy_sums,
+                                          LazyPartials<T3>* lazy_partials,
+                                          MakePartial make_partial) {
+    // REF:
+    // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
+    if (std::isnan(static_cast<double>(input))) {
+      return;
+    }
+    const int msb = MostSignificantBit(input);
+    const bool positive = input >= 0;
+    T left;
+    T right;
+    if (positive) {
+      pos_bins_[msb] += num_of_entries;
+      left = PosLeftBinBoundary(msb);
+      right = PosRightBinBoundary(msb);
+    } else {
+      neg_bins_[msb] += num_of_entries;
+      left = NegLeftBinBoundary(msb);
+      right = NegRightBinBoundary(msb);
+    }
+
+    // The remainders are capped at the full partial of the bin, see
+    // AddMultipleEntriesToPartials.
+    const T2 width = positive ? pos_bin_widths_[msb] : neg_bin_widths_[msb];
+    const T2 sum_remainder = input - left;
+    lazy_sums->Add(msb, positive,
+                   std::abs(width) < std::abs(sum_remainder) ? width
+                                                             : sum_remainder,
+                   num_of_entries);
+    const T3 partial = make_partial(right, left);
+    const T3 remainder = make_partial(input, left);
+    lazy_partials->Add(
+        msb, positive,
+        std::abs(partial) < std::abs(remainder) ? partial : remainder,
+        num_of_entries);
+  }
+
+  // Adds the partials recorded in lazy to partials and clears lazy. Runs in
+  // time linear in the number of bins.
+  template <typename T2, typename MakePartial, typename Allocator>
+  void FlushLazyPartials(LazyPartials<T2>* lazy,
+                         std::vector<T2, Allocator>* partials,
+                         MakePartial make_partial) {
+    if (!lazy->HasEntries()) {
+      return;
+    }
+    // Every value contributes the full partial of each bin below its msb, so
+    // bin i receives it once for each value with a larger msb.
+    uint64_t pos_above = 0;
+    uint64_t neg_above = 0;
+    for (int i = lazy->NumBins() - 1; i >= 0; --i) {
+      T2 value = lazy->Remainder(i);
+      if (pos_above > 0) {
+        T2 partial =
+            make_partial(PosRightBinBoundary(i), PosLeftBinBoundary(i));
+        value += partial * pos_above;
+      }
+      if (neg_above > 0) {
+        T2 partial =
+            make_partial(NegRightBinBoundary(i), NegLeftBinBoundary(i));
+        value += partial * neg_above;
+      }
+      (*partials)[i] += value;
+      pos_above += lazy->PositiveEntries(i);
+      neg_above += lazy->NegativeEntries(i);
+    }
+    lazy->Clear();
+  }
+
+  // Flushes partial sums recorded by AddMultipleEntriesToLazyPartialSums.
+  template <typename T2, typename Allocator>
+  void FlushLazyPartialSums(LazyPartials<T2>* lazy,
+                            std::vector<T2, Allocator>* sums) {
+    FlushLazyPartials<T2>(lazy, sums,
+                          [](T val1, T val2) { return val1 - val2; });
   }
 
   // Add noise to each member of bins and return noisy vector.
   const std::vector<T> AddNoise(double privacy_budget,
-                                const std::vector<int64_t>& bins) {
+                                absl::Span<const int64_t> bins) {
     std::vector<T> noisy_bins(bins.size());
     for (int i = 0; i < bins.size(); ++i) {
       double noised_dbl =
@@ -585,6 +937,16 @@ class ApproxBounds : public Algorithm<T> {
     return -1 * PosLeftBinBoundary(bin_index);
   }
 
+  // Returns whether value is the boundary of a bin, i.e., a bound that
+  // GenerateResult() can return.
+  bool IsBinBoundary(T value) {
+    const int msb = MostSignificantBit(value);
+    return value == PosLeftBinBoundary(msb) ||
+           value == PosRightBinBoundary(msb) ||
+           value == NegLeftBinBoundary(msb) ||
+           value == NegRightBinBoundary(msb);
+  }
+
   // Calculate the noisy number of inputs outside the two bounds from the
   // most recent result generation. Inputs equal to either bound may or may not
   // be part of the count. Input lower and upper are rounded to the nearest
@@ -653,12 +1015,56 @@ class ApproxBounds : public Algorithm<T> {
   template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
   friend class BoundedMean;
   template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
+  friend class BoundedStatistics;
+  template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
+  friend class BoundedSum;
+  template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
   friend class BoundedVariance;
 
  private:
+  // Per-bin storage: a vector sized at construction, or an array inside the
+  // object if the number of bins is fixed at compile time.
+  template <typename U>
+  using BinArray = std::conditional_t<kNumBins == 0, std::vector<U>,
+                                      std::array<U, kNumBins>>;
+
+  // Sets the num_bins bins to 0. Fixed-size bins already have kNumBins bins,
+  // which the builder checks is num_bins.
+  template <typename Bins>
+  static void InitBins(Bins* bins, int64_t num_bins) {
+    if constexpr (kNumBins == 0) {
+      bins->assign(num_bins, 0);
+    } else {
+      bins->fill(0);
+    }
+  }
+
+  // Returns the bytes allocated for bins outside of the object.
+  template <typename Bins>
+  static int64_t HeapBytes(const Bins& bins) {
+    if constexpr (kNumBins == 0) {
+      return sizeof(typename Bins::value_type) * bins.capacity();
+    } else {
+      return 0;
+    }
+  }
+
+  // Returns the base 2 logarithm of the positive value x, rounded up. For
+  // integers, this is the bit width of x - 1, which compiles to a count leading
+  // zeros instruction. Floating point values are split into their exponent and
+  // mantissa instead.
+  static int CeilLog2(T x) {
+    if constexpr (std::is_integral<T>::value) {
+      return absl::bit_width(static_cast<std::make_unsigned_t<T>>(x) - 1);
+    } else {
+      int exponent;
+      return std::frexp(x, &exponent) == 0.5 ? exponent - 1 : exponent;
+    }
+  }
+
   // Count the values in each logarithmic bin for positives and negatives.
-  std::vector<int64_t> pos_bins_;
-  std::vector<int64_t> neg_bins_;
+  BinArray<int64_t> pos_bins_;
+  BinArray<int64_t> neg_bins_;
 
   // Noisy DP counts of the positive and negative bins. Populated upon
   // generating the result.
@@ -666,7 +1072,12 @@ class ApproxBounds : public Algorithm<T> {
   std::vector<T> noisy_neg_bins_;
 
   // The bin boundary magnitudes, starting from lowest positive magnitude.
-  std::vector<T> bin_boundaries_;
+  BinArray<T> bin_boundaries_;
+
+  // The differences between the larger- and smaller-magnitude boundaries of
+  // each positive and negative bin.
+  BinArray<T> pos_bin_widths_;
+  BinArray<T> neg_bin_widths_;
 
   // Multiplicative factor for inputs
   double scale_;
@@ -674,6 +1085,9 @@ class ApproxBounds : public Algorithm<T> {
   // Base of the logarithm.
   double base_;
 
+  // The base 2 logarithm of scale if base is 2 and scale is a power of two.
+  absl::optional<int> log2_scale_;
+
   // The bin count threshold for choosing a minimum / maximum.
   double k_;
 
@@ -682,6 +1096,10 @@ class ApproxBounds : public Algorithm<T> {
 
   // Mechanism for adding noise to buckets.
   std::unique_ptr<NumericalMechanism> mechanism_;
+
+  // Configured builder of the mechanism if it is built lazily, until it is
+  // built.
+  std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
 };
 
 }  // namespace differential_privacy
@@ -50,6 +50,46 @@ class ApproxBoundsTestPeer {
                                               ApproxBounds<T>* ab) {
     ab->AddMultipleEntriesToPartialSums(sums, value, num_of_entries);
   }
+
+  template <typename T, typename T2, typename MakePartial>
+  static void AddMultipleEntriesToLazyPartials(LazyPartials<T2>* lazy,
+                                               T value,
+                                               uint64_t num_of_entries,
+                                               MakePartial make_partial,
+                                               ApproxBounds<T>* ab) {
+    ab->AddMultipleEntriesToLazyPartials(lazy, value, num_of_entries,
+                                         make_partial);
+  }
+
+  template <typename T, typename T2>
+  static void AddMultipleEntriesToLazyPartialSums(LazyPartials<T2>* lazy,
+                                                  T value,
+                                                  uint64_t num_of_entries,
+                                                  ApproxBounds<T>* ab) {
+    ab->AddMultipleEntriesToLazyPartialSums(lazy, value, num_of_entries);
+  }
+
+  template <typename T, typename T2, typename T3, typename MakePartial>
+  static void AddMultipleEntriesWithLazyPartials(
+      T value, uint64_t num_of_entries, LazyPartials<T2>* lazy_sums,
+      LazyPartials<T3>* lazy_partials, MakePartial make_partial,
+      ApproxBounds<T>* ab) {
+    ab->AddMultipleEntriesWithLazyPartials(value, num_of_entries, lazy_sums,
+                                           lazy_partials, make_partial);
+  }
+
+  template <typename T, typename T2, typename MakePartial>
+  static void FlushLazyPartials(LazyPartials<T2>* lazy,
+                                std::vector<T2>* partials,
+                                MakePartial make_partial, ApproxBounds<T>* ab) {
+    ab->FlushLazyPartials(lazy, partials, make_partial);
+  }
+
+  template <typename T, typename T2>
+  static void FlushLazyPartialSums(LazyPartials<T2>* lazy,
+                                   std::vector<T2>* sums, ApproxBounds<T>* ab) {
+    ab->FlushLazyPartialSums(lazy, sums);
+  }
 };
 
 namespace {
@@ -386,6 +426,49 @@ TYPED_TEST(ApproxBoundsTest, SerializeAndMergeTest) {
                   result2->elements(1).value().float_value());
 }
 
+TYPED_TEST(ApproxBoundsTest, MergeFromMatchesMerge) {
+  std::vector<TypeParam> a = {-1, -11, 6};
+  std::vector<TypeParam> b = {3, 5, 15, 56};
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(3).SetBase(10).SetScale(1).SetThreshold(2);
+  auto source = builder.Build();
+  ASSERT_OK(source);
+  (*source)->AddEntries(a.begin(), a.end());
+  auto merged = builder.Build();
+  ASSERT_OK(merged);
+  (*merged)->AddEntries(b.begin(), b.end());
+  auto merged_from = builder.Build();
+  ASSERT_OK(merged_from);
+  (*merged_from)->AddEntries(b.begin(), b.end());
+
+  EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+  EXPECT_OK((*merged_from)->MergeFrom(**source));
+  EXPECT_THAT((*merged_from)->Serialize(), EqualsProto((*merged)->Serialize()));
+
+  auto other_bins = builder.SetNumBins(4).Build();
+  ASSERT_OK(other_bins);
+  EXPECT_THAT((*merged_from)->MergeFrom(**other_bins),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same number of bin counts")));
+}
+
+TYPED_TEST(ApproxBoundsTest, AddEntriesSpanMatchesAddEntry) {
+  std::vector<TypeParam> a = {-1, -11, 6, 0, 3, 5, 15, 56, -1000};
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(3).SetBase(10).SetScale(1).SetThreshold(2);
+  auto bounds1 = builder.Build();
+  ASSERT_OK(bounds1);
+  auto bounds2 = builder.Build();
+  ASSERT_OK(bounds2);
+
+  for (const TypeParam& v : a) {
+    (*bounds1)->AddEntry(v);
+  }
+  (*bounds2)->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT((*bounds2)->Serialize(), EqualsProto((*bounds1)->Serialize()));
+}
+
 TYPED_TEST(ApproxBoundsTest, SerializeAndMergeOverflowPosBinsTest) {
   typename ApproxBounds<int64_t>::Builder builder;
 
@@ -770,6 +853,82 @@ TYPED_TEST(ApproxBoundsTest, AddMultipleEntriesToPartialSums) {
   }
 }
 
+TYPED_TEST(ApproxBoundsTest, PartialSumsMatchGenericPartials) {
+  int n_bins = 10;
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(n_bins)
+          .SetBase(2)
+          .SetScale(1)
+          .Build();
+  ASSERT_OK(bounds);
+  auto difference = [](TypeParam val1, TypeParam val2) { return val1 - val2; };
+
+  std::vector<TypeParam> values = {0, 1, -1, 3, -3, 6, 100, -100, 511, -512,
+                                   std::numeric_limits<TypeParam>::max(),
+                                   std::numeric_limits<TypeParam>::lowest()};
+  for (TypeParam value : values) {
+    std::vector<TypeParam> expected(n_bins, 0);
+    std::vector<TypeParam> sums(n_bins, 0);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartials<TypeParam, TypeParam>(
+        &expected, value, 3, difference, bounds.value().get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSums<TypeParam,
+                                                          TypeParam>(
+        &sums, value, 3, bounds.value().get());
+    EXPECT_THAT(sums, ::testing::ContainerEq(expected)) << "value = " << value;
+  }
+}
+
+TYPED_TEST(ApproxBoundsTest, LazyPartialsMatchEagerPartials) {
+  int n_bins = 10;
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(n_bins)
+          .SetBase(2)
+          .SetScale(1)
+          .Build();
+  ASSERT_OK(bounds);
+  ApproxBounds<TypeParam>* ab = bounds.value().get();
+  auto square_difference = [](TypeParam val1, TypeParam val2) {
+    return static_cast<double>(val1) * val1 - static_cast<double>(val2) * val2;
+  };
+
+  std::vector<TypeParam> sums(n_bins, 0);
+  std::vector<TypeParam> expected_sums(n_bins, 0);
+  std::vector<double> squares(n_bins, 0);
+  std::vector<double> expected_squares(n_bins, 0);
+  LazyPartials<TypeParam> lazy_sums(n_bins);
+  LazyPartials<double> lazy_squares(n_bins);
+
+  // Mix signs within one vector, which AddMultipleEntriesToPartials allows.
+  std::vector<TypeParam> values = {0, 1, -1, 3, -3, 6, 100, -100, 511, -512,
+                                   2000, 7};
+  for (int i = 0; i < values.size(); ++i) {
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSums<TypeParam, TypeParam>(
+        &expected_sums, values[i], i + 1, ab);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartials<TypeParam, double>(
+        &expected_squares, values[i], i + 1, square_difference, ab);
+    ApproxBoundsTestPeer::AddMultipleEntriesToLazyPartialSums(
+        &lazy_sums, values[i], i + 1, ab);
+    ApproxBoundsTestPeer::AddMultipleEntriesToLazyPartials(
+        &lazy_squares, values[i], i + 1, square_difference, ab);
+  }
+  ApproxBoundsTestPeer::FlushLazyPartialSums(&lazy_sums, &sums, ab);
+  ApproxBoundsTestPeer::FlushLazyPartials(&lazy_squares, &squares,
+                                          square_difference, ab);
+  EXPECT_FALSE(lazy_sums.HasEntries());
+  EXPECT_FALSE(lazy_squares.HasEntries());
+
+  for (int i = 0; i < n_bins; ++i) {
+    EXPECT_DOUBLE_EQ(sums[i], expected_sums[i]) << "bin " << i;
+    EXPECT_DOUBLE_EQ(squares[i], expected_squares[i]) << "bin " << i;
+  }
+
+  // Flushing again adds nothing.
+  ApproxBoundsTestPeer::FlushLazyPartialSums(&lazy_sums, &sums, ab);
+  EXPECT_THAT(sums, ::testing::ContainerEq(expected_sums));
+}
+
 TEST(ApproxBoundsTest, OverflowAddMultipleEntriesToPartialSums) {
   int n_bins = 4;
   int64_t n_entries = std::numeric_limits<int64_t>::max();
@@ -914,5 +1073,135 @@ TYPED_TEST(ApproxBoundsTest, Memory) {
   EXPECT_GE((*bounds_big)->MemoryUsed(), (*bounds_small)->MemoryUsed());
 }
 
+TYPED_TEST(ApproxBoundsTest, AddEntryWithCountMatchesAddEntry) {
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(3).SetBase(10).SetScale(1).SetThreshold(2);
+  auto with_count = builder.Build();
+  ASSERT_OK(with_count);
+  auto one_by_one = builder.Build();
+  ASSERT_OK(one_by_one);
+  (*with_count)->AddEntryWithCount(-11, 3);
+  (*with_count)->AddEntryWithCount(56, 2);
+  (*one_by_one)->AddEntries(std::vector<TypeParam>{-11, -11, -11, 56, 56});
+  EXPECT_THAT((*with_count)->Serialize(),
+              EqualsProto((*one_by_one)->Serialize()));
+}
+
+TYPED_TEST(ApproxBoundsTest, FixedSizeBinsMatchVectorBins) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> vector_bins =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(4)
+          .SetScale(1)
+          .SetBase(2)
+          .SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(vector_bins);
+  using FixedBounds = ApproxBounds<TypeParam, 4>;
+  base::StatusOr<std::unique_ptr<FixedBounds>> fixed_bins =
+      typename FixedBounds::Builder()
+          .SetScale(1)
+          .SetBase(2)
+          .SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(fixed_bins);
+  EXPECT_EQ((*fixed_bins)->NumPositiveBins(), 4);
+
+  const std::vector<TypeParam> inputs = {-7, -1, 0, 1, 2, 3, 5, 8, 100};
+  (*vector_bins)->AddEntries(inputs);
+  (*fixed_bins)->AddEntries(inputs);
+  EXPECT_THAT((*fixed_bins)->Serialize(),
+              EqualsProto((*vector_bins)->Serialize()));
+  ASSERT_OK((*fixed_bins)->Merge((*vector_bins)->Serialize()));
+
+  base::StatusOr<Output> fixed_result = (*fixed_bins)->PartialResult();
+  ASSERT_OK(fixed_result);
+  EXPECT_EQ(GetValue<TypeParam>(fixed_result->elements(0).value()), -8);
+  EXPECT_EQ(GetValue<TypeParam>(fixed_result->elements(1).value()), 8);
+}
+
+TYPED_TEST(ApproxBoundsTest, FixedSizeBinsRejectOtherNumberOfBins) {
+  using FixedBounds = ApproxBounds<TypeParam, 4>;
+  EXPECT_THAT(typename FixedBounds::Builder().SetNumBins(5).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of bins must be 4")));
+}
+
+TEST(ApproxBoundsTest, MostSignificantBitOfPowersOfTwo) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<int64_t>>> int_bounds =
+      ApproxBounds<int64_t>::Builder().Build();
+  ASSERT_OK(int_bounds);
+  for (int k = 1; k < 62; ++k) {
+    const int64_t power = int64_t{1} << k;
+    EXPECT_EQ((*int_bounds)->MostSignificantBit(power), k);
+    EXPECT_EQ((*int_bounds)->MostSignificantBit(power + 1), k + 1);
+    EXPECT_EQ((*int_bounds)->MostSignificantBit(-power), k);
+  }
+
+  // The default scale for doubles is 2^-1022.
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> double_bounds =
+      ApproxBounds<double>::Builder().Build();
+  ASSERT_OK(double_bounds);
+  EXPECT_EQ((*double_bounds)->MostSignificantBit(1.0), 1022);
+  EXPECT_EQ((*double_bounds)->MostSignificantBit(1.5), 1023);
+  EXPECT_EQ((*double_bounds)->MostSignificantBit(-2.0), 1023);
+  EXPECT_EQ((*double_bounds)->MostSignificantBit(0.75), 1022);
+}
+
+TYPED_TEST(ApproxBoundsTest, FusedLazyPartialsMatchSeparateCalls) {
+  int n_bins = 10;
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(n_bins).SetBase(2).SetScale(1).SetThreshold(1);
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> fused =
+      builder.Build();
+  ASSERT_OK(fused);
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> separate =
+      builder.Build();
+  ASSERT_OK(separate);
+  auto square_difference = [](TypeParam val1, TypeParam val2) {
+    return static_cast<double>(val1) * val1 - static_cast<double>(val2) * val2;
+  };
+
+  LazyPartials<TypeParam> fused_sums(n_bins), expected_sums(n_bins);
+  LazyPartials<double> fused_squares(n_bins), expected_squares(n_bins);
+  std::vector<TypeParam> values = {0, 1, -1, 3, -3, 6, 100, -100, 511, -512,
+                                   2000, 7};
+  for (int i = 0; i < values.size(); ++i) {
+    ApproxBoundsTestPeer::AddMultipleEntriesWithLazyPartials(
+        values[i], i + 1, &fused_sums, &fused_squares, square_difference,
+        fused->get());
+    ApproxBoundsTestPeer::AddMultipleEntries<TypeParam>(values[i], i + 1,
+                                                        separate->get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToLazyPartialSums(
+        &expected_sums, values[i], i + 1, separate->get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToLazyPartials(
+        &expected_squares, values[i], i + 1, square_difference,
+        separate->get());
+  }
+
+  EXPECT_THAT((*fused)->Serialize(),
+              EqualsProto((*separate)->Serialize()));
+  for (int i = 0; i < n_bins; ++i) {
+    EXPECT_EQ(fused_sums.PositiveEntries(i), expected_sums.PositiveEntries(i));
+    EXPECT_EQ(fused_sums.NegativeEntries(i), expected_sums.NegativeEntries(i));
+    EXPECT_EQ(fused_sums.Remainder(i), expected_sums.Remainder(i));
+    EXPECT_EQ(fused_squares.Remainder(i), expected_squares.Remainder(i));
+  }
+}
+
+TEST(ApproxBoundsTest, LazyMechanismIsBuiltOnFirstResult) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> bounds =
+      ApproxBounds<double>::Builder()
+          .SetEpsilon(1.0)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bounds);
+  (*bounds)->AddEntry(1);
+  EXPECT_THAT((*bounds)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+}
+
 }  //  namespace
 }  // namespace differential_privacy
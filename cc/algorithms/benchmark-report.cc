@@ -0,0 +1,134 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/benchmark-report.h"
+
+#include "google/protobuf/struct.pb.h"
+#include "google/protobuf/util/json_util.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace differential_privacy {
+namespace {
+
+// Returns s as a JSON string literal. Benchmark and metric names have no
+// control characters, so only quotes and backslashes are escaped.
+std::string JsonString(absl::string_view s) {
+  std::string quoted = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      quoted.push_back('\\');
+    }
+    quoted.push_back(c);
+  }
+  quoted.push_back('"');
+  return quoted;
+}
+
+}  // namespace
+
+std::string BenchmarkReportToJson(const BenchmarkReport& report) {
+  std::string json = "{\n  \"benchmarks\": [";
+  bool first_benchmark = true;
+  for (const auto& benchmark : report) {
+    absl::StrAppend(&json, first_benchmark ? "\n" : ",\n",
+                    "    {\n      \"name\": ", JsonString(benchmark.first));
+    for (const auto& metric : benchmark.second) {
+      absl::StrAppend(&json, ",\n      ", JsonString(metric.first), ": ",
+                      absl::StrFormat("%.6g", metric.second));
+    }
+    absl::StrAppend(&json, "\n    }");
+    first_benchmark = false;
+  }
+  absl::StrAppend(&json, "\n  ]\n}\n");
+  return json;
+}
+
+base::StatusOr<BenchmarkReport> ParseBenchmarkReport(absl::string_view json) {
+  google::protobuf::Struct parsed;
+  const auto status =
+      google::protobuf::util::JsonStringToMessage(std::string(json), &parsed);
+  if (!status.ok()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Benchmark report is not valid JSON: ", std::string(status.message())));
+  }
+  const auto benchmarks = parsed.fields().find("benchmarks");
+  if (benchmarks == parsed.fields().end() ||
+      !benchmarks->second.has_list_value()) {
+    return absl::InvalidArgumentError(
+        "Benchmark report has no list of benchmarks.");
+  }
+  BenchmarkReport report;
+  for (const google::protobuf::Value& benchmark :
+       benchmarks->second.list_value().values()) {
+    const auto& fields = benchmark.struct_value().fields();
+    const auto name = fields.find("name");
+    if (name == fields.end() || name->second.string_value().empty()) {
+      return absl::InvalidArgumentError(
+          "Benchmark report has a benchmark without a name.");
+    }
+    std::map<std::string, double>& metrics =
+        report[name->second.string_value()];
+    for (const auto& field : fields) {
+      if (field.second.kind_case() == google::protobuf::Value::kNumberValue) {
+        metrics[field.first] = field.second.number_value();
+      }
+    }
+  }
+  return report;
+}
+
+std::vector<BenchmarkRegression> FindBenchmarkRegressions(
+    const BenchmarkReport& baseline, const BenchmarkReport& report,
+    absl::Span<const std::string> gated_metrics, double max_increase) {
+  std::vector<BenchmarkRegression> regressions;
+  for (const auto& benchmark : baseline) {
+    const std::string& name = benchmark.first;
+    const std::map<std::string, double>& baseline_metrics = benchmark.second;
+    const auto metrics = report.find(name);
+    if (metrics == report.end()) {
+      continue;
+    }
+    for (const std::string& metric : gated_metrics) {
+      const auto baseline_value = baseline_metrics.find(metric);
+      const auto value = metrics->second.find(metric);
+      if (baseline_value == baseline_metrics.end() ||
+          value == metrics->second.end()) {
+        continue;
+      }
+      if (value->second > baseline_value->second * (1 + max_increase)) {
+        regressions.push_back(
+            {name, metric, baseline_value->second, value->second});
+      }
+    }
+  }
+  return regressions;
+}
+
+std::string BenchmarkRegressionToString(
+    const BenchmarkRegression& regression) {
+  std::string increase = "from 0";
+  if (regression.baseline > 0) {
+    increase = absl::StrFormat(
+        "+%.1f%%", 100 * (regression.value / regression.baseline - 1));
+  }
+  return absl::StrFormat("%s: %s is %.6g, baseline %.6g (%s)",
+                         regression.benchmark, regression.metric,
+                         regression.value, regression.baseline, increase);
+}
+
+}  // namespace differential_privacy
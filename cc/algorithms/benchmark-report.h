@@ -0,0 +1,68 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BENCHMARK_REPORT_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_BENCHMARK_REPORT_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+
+namespace differential_privacy {
+
+// The metrics of a benchmark run, by benchmark name and metric name, e.g.,
+// report["BM_LaplaceAddNoise"]["instructions_per_entry"].
+using BenchmarkReport = std::map<std::string, std::map<std::string, double>>;
+
+// Returns the report as JSON in the layout of the JSON output of Google
+// Benchmark, with every metric a field of its benchmark:
+//
+//   {"benchmarks": [{"name": "BM_LaplaceAddNoise", "cycles_per_entry": 310,
+//                    ...}, ...]}
+std::string BenchmarkReportToJson(const BenchmarkReport& report);
+
+// Parses a report written by BenchmarkReportToJson, or by Google Benchmark
+// with --benchmark_format=json. All numeric fields of a benchmark are
+// metrics; other fields are ignored.
+base::StatusOr<BenchmarkReport> ParseBenchmarkReport(absl::string_view json);
+
+// A metric of a benchmark that increased by more than the allowed fraction of
+// its baseline.
+struct BenchmarkRegression {
+  std::string benchmark;
+  std::string metric;
+  double baseline;
+  double value;
+};
+
+// Returns the metrics in gated_metrics that increased from the baseline by
+// more than max_increase, e.g., 0.1 for 10%, for all benchmarks in both
+// reports. Larger values of the metrics must be worse, e.g., cycles per
+// entry. Benchmarks and metrics missing from either report are not compared.
+std::vector<BenchmarkRegression> FindBenchmarkRegressions(
+    const BenchmarkReport& baseline, const BenchmarkReport& report,
+    absl::Span<const std::string> gated_metrics, double max_increase);
+
+// Returns a description of the regression for the test log.
+std::string BenchmarkRegressionToString(const BenchmarkRegression& regression);
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_BENCHMARK_REPORT_H_
@@ -0,0 +1,109 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/benchmark-report.h"
+
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::IsOkAndHolds;
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+
+TEST(BenchmarkReportTest, RoundTripsJson) {
+  const BenchmarkReport report = {
+      {"BM_AddNoise/Laplace",
+       {{"cycles_per_entry", 310.5}, {"rng_bytes_per_output", 16}}},
+      {"BM_Aggregate/Count", {{"instructions_per_entry", 2.25e-3}}},
+  };
+  EXPECT_THAT(ParseBenchmarkReport(BenchmarkReportToJson(report)),
+              IsOkAndHolds(report));
+  EXPECT_THAT(ParseBenchmarkReport(BenchmarkReportToJson({})),
+              IsOkAndHolds(IsEmpty()));
+}
+
+TEST(BenchmarkReportTest, ParsesGoogleBenchmarkOutput) {
+  const std::string json = R"({
+    "context": {"date": "2020-09-01", "num_cpus": 8},
+    "benchmarks": [
+      {
+        "name": "BM_AddNoise/Laplace",
+        "run_type": "iteration",
+        "iterations": 1000,
+        "cpu_time": 512.5,
+        "time_unit": "ns",
+        "rng_bytes_per_output": 16
+      }
+    ]
+  })";
+  const BenchmarkReport expected = {
+      {"BM_AddNoise/Laplace",
+       {{"iterations", 1000},
+        {"cpu_time", 512.5},
+        {"rng_bytes_per_output", 16}}}};
+  EXPECT_THAT(ParseBenchmarkReport(json), IsOkAndHolds(expected));
+}
+
+TEST(BenchmarkReportTest, RejectsMalformedReports) {
+  EXPECT_THAT(ParseBenchmarkReport("{"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not valid JSON")));
+  EXPECT_THAT(ParseBenchmarkReport(R"({"runs": []})"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("no list of benchmarks")));
+  EXPECT_THAT(ParseBenchmarkReport(R"({"benchmarks": [{"cpu_time": 1}]})"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("without a name")));
+}
+
+TEST(BenchmarkReportTest, FindsRegressionsOfGatedMetrics) {
+  const BenchmarkReport baseline = {
+      {"BM_A", {{"instructions_per_entry", 100}, {"cpu_time_ns", 10}}},
+      {"BM_B", {{"instructions_per_entry", 100}}},
+      {"BM_Removed", {{"instructions_per_entry", 100}}},
+  };
+  const BenchmarkReport report = {
+      // Within the threshold, and an ungated metric that regressed.
+      {"BM_A", {{"instructions_per_entry", 109}, {"cpu_time_ns", 20}}},
+      {"BM_B", {{"instructions_per_entry", 111}}},
+      {"BM_New", {{"instructions_per_entry", 1000}}},
+  };
+  const std::vector<std::string> gated = {"instructions_per_entry",
+                                          "rng_bytes_per_output"};
+  const std::vector<BenchmarkRegression> regressions =
+      FindBenchmarkRegressions(baseline, report, gated, 0.1);
+  ASSERT_EQ(regressions.size(), 1);
+  EXPECT_EQ(regressions[0].benchmark, "BM_B");
+  EXPECT_EQ(regressions[0].metric, "instructions_per_entry");
+  EXPECT_EQ(regressions[0].baseline, 100);
+  EXPECT_EQ(regressions[0].value, 111);
+  EXPECT_EQ(BenchmarkRegressionToString(regressions[0]),
+            "BM_B: instructions_per_entry is 111, baseline 100 (+11.0%)");
+
+  EXPECT_THAT(FindBenchmarkRegressions(baseline, report, gated, 0.2),
+              IsEmpty());
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -17,12 +17,17 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SEARCH_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SEARCH_H_
 
+#include <cstddef>
+#include <vector>
+
 #include "base/percentile.h"
 #include "google/protobuf/any.pb.h"
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "proto/util.h"
 #include "base/canonical_errors.h"
 #include "base/status_macros.h"
@@ -55,7 +60,7 @@
 
 namespace differential_privacy {
 
-// Bayesian search creates a map entry for each iteration. Bound this to prevent
+// Bayesian search creates a bucket for each iteration. Bound this to prevent
 // out of memory exception.
 const size_t kMaxBayesianIterations = 10000;
 
@@ -82,7 +87,10 @@ const double kSingularityTolerance = std::pow(10, -6);
 template <typename T>
 class BinarySearch : public Algorithm<T> {
  public:
+  using Algorithm<T>::AddEntries;
+
   void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBinarySearchEntries);
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
     if (!std::isnan(static_cast<double>(t))) {
@@ -90,29 +98,60 @@ class BinarySearch : public Algorithm<T> {
     }
   }
 
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBinarySearchEntries, num_of_entries);
+    if (!std::isnan(static_cast<double>(t))) {
+      quantiles_->AddWithCount(t, num_of_entries);
+    }
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBinarySearchEntries, entries.size());
+    for (const T& t : entries) {
+      if (!std::isnan(static_cast<double>(t))) {
+        quantiles_->Add(t);
+      }
+    }
+  }
+
   Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
     BinarySearchSummary bs_summary;
-    quantiles_->SerializeToProto(bs_summary.mutable_input());
+    quantiles_->SerializeToSummary(&bs_summary);
     Summary summary;
     summary.mutable_data()->PackFrom(bs_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
     return summary;
   }
 
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError(
           "Cannot merge summary with no binary search data.");
     }
-    BinarySearchSummary bs_summary;
-    if (!summary.data().UnpackTo(&bs_summary)) {
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
+    // Merge straight from the packed bytes to avoid copying the inputs into
+    // an intermediate summary proto.
+    if (!summary.data().Is<BinarySearchSummary>() ||
+        !quantiles_->MergeFromSerializedSummary(summary.data().value())) {
       return absl::InternalError(
           "Binary search summary unable to be unpacked.");
     }
-    quantiles_->MergeFromProto(bs_summary.input());
 
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_search = dynamic_cast<BinarySearch<T>*>(&other);
+    if (other_search == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    quantiles_->MergeFrom(*other_search->quantiles_);
+    return absl::OkStatus();
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BinarySearch<T>);
     if (mechanism_) {
@@ -146,11 +185,12 @@ class BinarySearch : public Algorithm<T> {
                                         double noise_interval_level) override {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
-    return BayesianSearch(privacy_budget, noise_interval_level);
+    return BayesianSearch(quantile_, privacy_budget, noise_interval_level);
   }
 
- private:
-  base::StatusOr<Output> BayesianSearch(double privacy_budget,
+  // Searches for the quantile of the inputs using privacy_budget. Searches for
+  // different quantiles share the sorted inputs of the input sketch.
+  base::StatusOr<Output> BayesianSearch(double quantile, double privacy_budget,
                                         double noise_interval_level) {
     // If the bounds are equal, we return the only possible value with total
     // confidence.
@@ -169,21 +209,23 @@ class BinarySearch : public Algorithm<T> {
     double remaining_budget = privacy_budget;
     double max_local_budget = privacy_budget * kMaxLocalBudgetFraction;
 
-    // Stores probability that the target value is the subrange. Since the map
-    // is sorted, it contains a sequence of key-value pairs (k_i, v_i) for
-    // i = 1, 2, ..., n, where n is the dictionary size. Then for
-    // i = 1, ..., n-1, the subrange [k_i. k_(i+1)) has probability v_i of
-    // containing the target value. [k_n, upper_] has probability v_n of
-    // containing the target value.
-    std::map<double, double> weight;
+    // Stores probability that the target value is the subrange. It is kept in
+    // flat arrays, so that each iteration scans contiguous memory instead of
+    // chasing map nodes.
+    Posterior weight;
     double m = lower_ / 2.0 + upper_ / 2.0;
-    weight[lower_] = .5;
-    weight[m] = .5;
+    weight.bounds.push_back(lower_);
+    weight.weights.push_back(.5);
+    if (lower_ < m) {
+      weight.bounds.push_back(m);
+      weight.weights.push_back(.5);
+    }
 
     // Keep doing search iterations while we have enough budget left.
     int iterations = 0;
     while (remaining_budget - local_budget > 0 &&
            iterations < kMaxBayesianIterations) {
+      tracing::ScopedSpan span(tracing::TracePoint::kBinarySearchIteration);
       ++iterations;
 
       // Find noisy counts for number of values above and below m. A single
@@ -197,41 +239,30 @@ class BinarySearch : public Algorithm<T> {
       double noised_size = noisy_less + noisy_more;
       // For extreme percentiles, we want to push the result toward the range of
       // the input data.
-      if (quantile_ < kSingularityTolerance) {
+      if (quantile < kSingularityTolerance) {
         noisy_less -= GetDatapoints(noised_size);
-      } else if ((1 - quantile_) < kSingularityTolerance) {
+      } else if ((1 - quantile) < kSingularityTolerance) {
         noisy_more -= GetDatapoints(noised_size);
       }
 
       // Calculate update multipliers.
-      double update_left =
-          BayesianProbabilityLeft(local_budget, noisy_less, noisy_more);
+      double update_left = BayesianProbabilityLeft(quantile, local_budget,
+                                                   noisy_less, noisy_more);
 
       // Adjust the local budget based on certainty.
       remaining_budget -= local_budget;
       local_budget = std::min(UpdateLocalBudget(local_budget, update_left),
                               max_local_budget);
 
-      // Apply update multipliers.
-      UpdateWeight(&weight, m, update_left);
-
-      // Find the subrange to split the bucket and its weight in two.
+      // Apply update multipliers, and find the subrange to split the bucket
+      // and its weight in two.
       double sum_w = 0.0;
-      double lower_bound = static_cast<double>(lower_);
-      double w = 0;
-      auto it = weight.begin();
-      for (; it != weight.end(); it++) {
-        sum_w += it->second;
-        lower_bound = it->first;
-        w = it->second;
-        if (sum_w >= .5) {
-          break;
-        }
-      }
-
+      const size_t i = UpdateWeight(&weight, m, update_left, &sum_w);
+      const double lower_bound = weight.bounds[i];
+      const double w = weight.weights[i];
       double upper_bound = static_cast<double>(upper_);
-      if (it != weight.end() && ++it != weight.end()) {
-        upper_bound = it->first;
+      if (i + 1 < weight.bounds.size()) {
+        upper_bound = weight.bounds[i + 1];
       }
 
       // Split the bucket into two assuming uniform distribution of probability
@@ -241,9 +272,11 @@ class BinarySearch : public Algorithm<T> {
       // m is lower_bound or upper_bound.
       m = (.5 - sum_w + w) / w * (upper_bound - lower_bound) + lower_bound;
       if (lower_bound < m && m < upper_bound) {
-        weight[lower_bound] =
-            w * (m - lower_bound) / (upper_bound - lower_bound);
-        weight[m] = w * (upper_bound - m) / (upper_bound - lower_bound);
+        weight.weights[i] = w * (m - lower_bound) / (upper_bound - lower_bound);
+        weight.bounds.insert(weight.bounds.begin() + i + 1, m);
+        weight.weights.insert(
+            weight.weights.begin() + i + 1,
+            w * (upper_bound - m) / (upper_bound - lower_bound));
       }
     }
 
@@ -261,6 +294,7 @@ class BinarySearch : public Algorithm<T> {
     return output;
   }
 
+ private:
   // The "datapoints" is used to buffer the noisy less and noisy more
   // count for finding extreme quantiles (at 0 and 1). It approximately can be
   // thought of as you're looking for a value within datapoints away from the
@@ -274,12 +308,11 @@ class BinarySearch : public Algorithm<T> {
 
   // Given a noisy lower L and noisy greater count U for some value in a set,
   // and that the noise of these counts were generated by this mechanism with
-  // local privacy_budget, find the probability that the percentile p element of
+  // local privacy_budget, find the probability that the quantile p element of
   // the set is to the left of the investigated value. The tolerance is the
   // distance from removable singularities to use the value at singularity.
-  virtual double BayesianProbabilityLeft(double privacy_budget, double L,
-                                         double U) {
-    double p = quantile_;
+  double BayesianProbabilityLeft(double p, double privacy_budget, double L,
+                                 double U) {
     double b = privacy_budget / mechanism_->GetDiversity();
 
     // Removable singularity at p=1/2.
@@ -320,34 +353,47 @@ class BinarySearch : public Algorithm<T> {
     return (-2 + num1 * std::pow(-1 + p, 2) + 4 * p - num2 * p * p) / denom;
   }
 
-  void UpdateWeight(std::map<double, double>* weight, double m,
-                    double update_left) {
-    // Apply the multipliers. For buckets below, apply left update. For buckets
-    // above, apply right update. m is always the lower bound of some bucket.
-    double sum_w = 0;
-    for (std::map<double, double>::iterator it = weight->begin();
-         it != weight->end(); it++) {
-      // Get bounds and weight of the bucket.
-      double lower_bound = it->first;
-      double w = it->second;
-
-      // Apply multiplier for the bucket according to position wrt m.
-      double new_w = w;
-      double update_right = 1 - update_left;
-      if (lower_bound < m) {
-        new_w *= update_left;
-      } else {  // lower_bound >= m
-        new_w *= update_right;
-      }
-      (*weight)[lower_bound] = new_w;
-      sum_w += new_w;
+  // Posterior of the search as flat arrays sorted by bound. Bucket i is the
+  // subrange [bounds[i], bounds[i + 1]), or [bounds[i], upper_] for the last
+  // bucket, and has probability weights[i] of containing the target value.
+  struct Posterior {
+    std::vector<double> bounds;
+    std::vector<double> weights;
+  };
+
+  // Applies the multipliers to the weights and normalizes them. Returns the
+  // first bucket at which the cumulative weight reaches 1/2, or the last
+  // bucket if none does, and sets *sum_w to the cumulative weight up to and
+  // including that bucket.
+  size_t UpdateWeight(Posterior* weight, double m, double update_left,
+                      double* sum_w) {
+    // For buckets below, apply left update. For buckets above, apply right
+    // update. m is always the lower bound of some bucket.
+    std::vector<double>& weights = weight->weights;
+    const std::vector<double>& bounds = weight->bounds;
+    const double update_right = 1 - update_left;
+    double total = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights[i] *= bounds[i] < m ? update_left : update_right;
+      total += weights[i];
     }
 
-    // Normalize so weights sum to 1.
-    for (auto const& bucket : *weight) {
-      double lower_bound = bucket.first;
-      (*weight)[lower_bound] /= sum_w;
+    // Normalize so weights sum to 1, and find the bucket holding the median
+    // weight in the same pass.
+    size_t median = weights.size() - 1;
+    bool found = false;
+    *sum_w = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights[i] /= total;
+      if (!found) {
+        *sum_w += weights[i];
+        if (*sum_w >= .5) {
+          median = i;
+          found = true;
+        }
+      }
     }
+    return median;
   }
 
   base::StatusOr<double> Percentile(double m) {
@@ -387,26 +433,24 @@ class BinarySearch : public Algorithm<T> {
     return local_budget;
   }
 
-  ConfidenceInterval ErrorConfidenceInterval(
-      double confidence_level, const std::map<double, double>& weight,
-      double result) {
+  ConfidenceInterval ErrorConfidenceInterval(double confidence_level,
+                                             const Posterior& weight,
+                                             double result) {
     ConfidenceInterval interval;
     interval.set_confidence_level(confidence_level);
     double sum_w = 0.0;
     bool found_lower = false;
-    std::map<double, double>::const_iterator it;
-    for (it = weight.begin(); it != weight.end(); it++) {
-      sum_w += it->second;
+    for (size_t i = 0; i < weight.weights.size(); ++i) {
+      sum_w += weight.weights[i];
       if (!found_lower && sum_w >= .5 - confidence_level / 2) {
-        interval.set_upper_bound(result - it->first);
+        interval.set_upper_bound(result - weight.bounds[i]);
         found_lower = true;
       }
       if (sum_w > (.5 + confidence_level / 2)) {
-        std::map<double, double>::const_iterator it_next = std::next(it, 1);
-        if (it_next == weight.end()) {
+        if (i + 1 == weight.bounds.size()) {
           interval.set_lower_bound(result - upper_);
         } else {
-          interval.set_lower_bound(result - it_next->first);
+          interval.set_lower_bound(result - weight.bounds[i + 1]);
         }
         break;
       }
@@ -19,6 +19,7 @@
 #include <climits>
 #include <memory>
 
+#include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -34,6 +35,7 @@ namespace {
 static constexpr size_t kDataSize = 10000;
 static constexpr size_t kStatsSize = 500;
 
+using ::differential_privacy::base::testing::EqualsProto;
 using ::differential_privacy::test_utils::ZeroNoiseMechanism;
 
 template <typename T>
@@ -139,6 +141,21 @@ TEST(BinarySearchTest, SerializeMergeTest) {
   EXPECT_EQ(GetValue<int64_t>(search_2.PartialResult(1.0).ValueOrDie()), 200);
 }
 
+TEST(BinarySearchTest, AddEntriesSpanMatchesAddEntry) {
+  std::vector<double> a = {100, NAN, 200, 350, 0, 400, 12.5};
+  TestPercentileSearch<double> search1(
+      .5, 1.0, 0, 400, absl::make_unique<ZeroNoiseMechanism::Builder>());
+  TestPercentileSearch<double> search2(
+      .5, 1.0, 0, 400, absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  for (double v : a) {
+    search1.AddEntry(v);
+  }
+  search2.AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT(search2.Serialize(), EqualsProto(search1.Serialize()));
+}
+
 TEST(BinarySearchTest, DropNanEntries) {
   double epsilon = 1;
   int64_t lower = 0, upper = 400;
@@ -201,5 +218,35 @@ TEST(BinarySearchTest, LowerEqualsUpper) {
   EXPECT_EQ(output.error_report().noise_confidence_interval().upper_bound(), 1);
 }
 
+TEST(BinarySearchTest, MergeFromMatchesMerge) {
+  auto make_search = []() {
+    return absl::make_unique<TestPercentileSearch<double>>(
+        .5, 1.0, 0, 100, absl::make_unique<ZeroNoiseMechanism::Builder>());
+  };
+  auto source = make_search();
+  auto merged = make_search();
+  auto merged_from = make_search();
+  for (int i = 0; i < 50; ++i) {
+    source->AddEntry((i * 37) % 100);
+    merged->AddEntry(i);
+    merged_from->AddEntry(i);
+  }
+
+  EXPECT_OK(merged->Merge(source->Serialize()));
+  EXPECT_OK(merged_from->MergeFrom(*source));
+  EXPECT_THAT(merged_from->Serialize(), EqualsProto(merged->Serialize()));
+}
+
+TEST(BinarySearchTest, AddEntryWithCountMatchesAddEntry) {
+  TestPercentileSearch<int64_t> with_count(
+      .5, 1.0, 0, 100, absl::make_unique<ZeroNoiseMechanism::Builder>());
+  TestPercentileSearch<int64_t> one_by_one(
+      .5, 1.0, 0, 100, absl::make_unique<ZeroNoiseMechanism::Builder>());
+  with_count.AddEntryWithCount(20, 3);
+  with_count.AddEntryWithCount(7, 2);
+  one_by_one.AddEntries(std::vector<int64_t>{20, 20, 20, 7, 7});
+  EXPECT_THAT(with_count.Serialize(), EqualsProto(one_by_one.Serialize()));
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -96,12 +96,12 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
           AlgorithmBuilder::GetEpsilon().value() * kDefaultBoundsBudgetFraction;
       remaining_epsilon_ =
           AlgorithmBuilder::GetEpsilon().value() - bounds_epsilon;
-      auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
-      ASSIGN_OR_RETURN(approx_bounds_,
-                       typename ApproxBounds<T>::Builder()
-                           .SetEpsilon(bounds_epsilon)
-                           .SetLaplaceMechanism(std::move(mech_builder))
-                           .Build());
+      typename ApproxBounds<T>::Builder bounds_builder;
+      bounds_builder.SetEpsilon(bounds_epsilon)
+          .SetLaplaceMechanism(AlgorithmBuilder::GetMechanismBuilderClone())
+          .SetLazyMechanism(AlgorithmBuilder::GetLazyMechanism());
+      // Moves the clone into the ApproxBounds instead of cloning it again.
+      ASSIGN_OR_RETURN(approx_bounds_, std::move(bounds_builder).Build());
     }
     return absl::OkStatus();
   }
@@ -18,22 +18,40 @@
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_MEAN_H_
 
 #include <limits>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include "google/protobuf/any.pb.h"
 #include "absl/random/distributions.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
 #include "base/status_macros.h"
 
 namespace differential_privacy {
+namespace internal {
+
+// Adds the entries clamped to [lower, upper] to *sum, skipping NaN entries, and
+// returns the number of entries that are not NaN. See AddClampedEntriesInLanes
+// in util.h for how the entries are accumulated.
+template <typename T>
+uint64_t AddClampedEntriesAndCount(absl::Span<const T> entries, T lower,
+                                   T upper, T* sum) {
+  return AddClampedEntriesInLanes</*kWithSquares=*/false>(
+      entries, lower, upper, sum, /*sum_of_squares=*/nullptr);
+}
+
+}  // namespace internal
 
 // Incrementally provides a differentially private average.
 // All input vales are normalized to be their difference from the middle of the
@@ -82,11 +100,15 @@ class BoundedMean : public Algorithm<T> {
       RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
 
       // If manual bounding, check bounds and construct mechanism so we can fail
-      // on build if sensitivity is inappropriate.
+      // on build if sensitivity is inappropriate, unless the mechanisms are
+      // built lazily.
+      const bool lazy_mechanism = AlgorithmBuilder::GetLazyMechanism();
       std::unique_ptr<NumericalMechanism> sum_mechanism = nullptr;
       if (BoundedBuilder::BoundsAreSet()) {
         RETURN_IF_ERROR(CheckBounds(BoundedBuilder::GetLower().value(),
                                     BoundedBuilder::GetUpper().value()));
+      }
+      if (BoundedBuilder::BoundsAreSet() && !lazy_mechanism) {
         ASSIGN_OR_RETURN(
             sum_mechanism,
             BuildSumMechanism(
@@ -101,19 +123,19 @@ class BoundedMean : public Algorithm<T> {
       // The count noising doesn't depend on the bounds, so we can always
       // construct the mechanism we use for it here.
       std::unique_ptr<NumericalMechanism> count_mechanism;
-      ASSIGN_OR_RETURN(
-          count_mechanism,
-          AlgorithmBuilder::GetMechanismBuilderClone()
-              ->SetEpsilon(BoundedBuilder::GetRemainingEpsilon().value())
-              .SetL0Sensitivity(
-                  AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1))
-              .SetLInfSensitivity(
-                  AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
-                      1))
-              .Build());
+      if (!lazy_mechanism) {
+        ASSIGN_OR_RETURN(
+            count_mechanism,
+            BuildCountMechanism(
+                AlgorithmBuilder::GetMechanismBuilderClone(),
+                BoundedBuilder::GetRemainingEpsilon().value(),
+                AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+                AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
+                    1)));
+      }
 
       // Construct BoundedMean.
-      auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
+      auto mech_builder = AlgorithmBuilder::TakeMechanismBuilder();
       return absl::WrapUnique(new BoundedMean(
           BoundedBuilder::GetRemainingEpsilon().value(),
           BoundedBuilder::GetLower().value_or(0),
@@ -126,17 +148,44 @@ class BoundedMean : public Algorithm<T> {
     }
   };
 
-  void AddEntry(const T& input) override { AddMultipleEntries(input, 1); }
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& input) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries);
+    AddMultipleEntries(input, 1);
+  }
+
+  void AddEntryWithCount(const T& input, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries, num_of_entries);
+    AddMultipleEntries(input, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries, entries.size());
+    if (approx_bounds_) {
+      for (const T& input : entries) {
+        AddMultipleEntries(input, 1);
+      }
+      return;
+    }
+    raw_count_ += internal::AddClampedEntriesAndCount<T>(entries, lower_,
+                                                         upper_, &pos_sum_[0]);
+  }
 
   Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
+    FlushPartialSums();
+
     // Create BoundedMeanSummary.
     BoundedMeanSummary bm_summary;
     bm_summary.set_count(raw_count_);
     for (T x : pos_sum_) {
-      SetValue(bm_summary.add_pos_sum(), x);
+      AddPackedValue(x, bm_summary.mutable_pos_sum_int(),
+                     bm_summary.mutable_pos_sum_double());
     }
     for (T x : neg_sum_) {
-      SetValue(bm_summary.add_neg_sum(), x);
+      AddPackedValue(x, bm_summary.mutable_neg_sum_int(),
+                     bm_summary.mutable_neg_sum_double());
     }
     if (approx_bounds_) {
       Summary approx_bounds_summary = approx_bounds_->Serialize();
@@ -147,14 +196,18 @@ class BoundedMean : public Algorithm<T> {
     // Create Summary.
     Summary summary;
     summary.mutable_data()->PackFrom(bm_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
     return summary;
   }
 
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError(
           "Cannot merge summary with no bounded mean data.");
     }
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
 
     // Add counts and bounded sums.
     BoundedMeanSummary bm_summary;
@@ -162,16 +215,24 @@ class BoundedMean : public Algorithm<T> {
       return absl::InternalError("Bounded mean summary unable to be unpacked.");
     }
     raw_count_ += bm_summary.count();
-    if (pos_sum_.size() != bm_summary.pos_sum_size() ||
-        neg_sum_.size() != bm_summary.neg_sum_size()) {
+    if (pos_sum_.size() != NumPackedValues(bm_summary.pos_sum(),
+                                           bm_summary.pos_sum_int(),
+                                           bm_summary.pos_sum_double()) ||
+        neg_sum_.size() != NumPackedValues(bm_summary.neg_sum(),
+                                           bm_summary.neg_sum_int(),
+                                           bm_summary.neg_sum_double())) {
       return absl::InternalError(
           "Merged BoundedMeans must have equal number of partial sums.");
     }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bm_summary.pos_sum(i));
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetPackedValue<T>(bm_summary.pos_sum(),
+                                       bm_summary.pos_sum_int(),
+                                       bm_summary.pos_sum_double(), i);
     }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bm_summary.neg_sum(i));
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetPackedValue<T>(bm_summary.neg_sum(),
+                                       bm_summary.neg_sum_int(),
+                                       bm_summary.neg_sum_double(), i);
     }
     if (approx_bounds_) {
       Summary approx_bounds_summary;
@@ -183,15 +244,45 @@ class BoundedMean : public Algorithm<T> {
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_mean = dynamic_cast<BoundedMean<T>*>(&other);
+    if (other_mean == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if ((approx_bounds_ == nullptr) !=
+            (other_mean->approx_bounds_ == nullptr) ||
+        pos_sum_.size() != other_mean->pos_sum_.size() ||
+        neg_sum_.size() != other_mean->neg_sum_.size()) {
+      return absl::InternalError(
+          "Merged BoundedMeans must have equal number of partial sums.");
+    }
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(approx_bounds_->MergeFrom(*other_mean->approx_bounds_));
+      other_mean->FlushPartialSums();
+    }
+    raw_count_ += other_mean->raw_count_;
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += other_mean->pos_sum_[i];
+    }
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += other_mean->neg_sum_[i];
+    }
+    return absl::OkStatus();
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedMean<T>) +
-                   sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity());
+                   sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
+                   lazy_pos_sum_.MemoryUsed() + lazy_neg_sum_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
     if (sum_mechanism_) {
       memory += sum_mechanism_->MemoryUsed();
     }
+    if (count_mechanism_) {
+      memory += count_mechanism_->MemoryUsed();
+    }
     if (mechanism_builder_) {
       memory += sizeof(*mechanism_builder_);
     }
@@ -218,6 +309,24 @@ class BoundedMean : public Algorithm<T> {
   // specified explicitly, this will be the total epsilon used by the algorithm.
   double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
 
+  // Same as PartialResult(privacy_budget, noise_interval_level), but uses the
+  // bounds of a result of another ApproxBounds with the same bins instead of
+  // running the ApproxBounds of this mean. See BoundedSum for details.
+  base::StatusOr<Output> PartialResultWithBounds(
+      const Output& bounds, double privacy_budget,
+      double noise_interval_level = kDefaultConfidenceLevel) {
+    if (!approx_bounds_) {
+      return absl::FailedPreconditionError(
+          "Shared bounds require automatically determined bounds.");
+    }
+    ASSIGN_OR_RETURN(const auto shared_bounds,
+                     approx_bounds_->BoundsFromOutput(bounds));
+    ASSIGN_OR_RETURN(const double budget,
+                     Algorithm<T>::ConsumeResultBudget(privacy_budget));
+    return GenerateResultWithBounds(budget, noise_interval_level,
+                                    &shared_bounds);
+  }
+
  protected:
   BoundedMean(const double epsilon, T lower, T upper,
               const double l0_sensitivity,
@@ -243,6 +352,8 @@ class BoundedMean : public Algorithm<T> {
     if (approx_bounds_) {
       pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
       neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
+      lazy_pos_sum_.Resize(approx_bounds_->NumPositiveBins());
+      lazy_neg_sum_.Resize(approx_bounds_->NumPositiveBins());
     } else {
       pos_sum_.push_back(0);
     }
@@ -250,6 +361,15 @@ class BoundedMean : public Algorithm<T> {
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
+    return GenerateResultWithBounds(privacy_budget, noise_interval_level,
+                                    /*shared_bounds=*/nullptr);
+  }
+
+  // Uses shared_bounds instead of the result of approx_bounds_ if they are
+  // not nullptr, in which case the whole privacy budget is spent on the mean.
+  base::StatusOr<Output> GenerateResultWithBounds(
+      double privacy_budget, double noise_interval_level,
+      const std::pair<T, T>* shared_bounds) {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
 
@@ -259,24 +379,37 @@ class BoundedMean : public Algorithm<T> {
 
     // Find bounds and sum.
     if (approx_bounds_) {
-      // Use a fraction of the privacy budget to find the approximate bounds.
-      double bounds_budget = privacy_budget / 2;
-      remaining_budget -= bounds_budget;
-      ASSIGN_OR_RETURN(Output bounds, approx_bounds_->PartialResult(
-                                          bounds_budget, noise_interval_level));
-      lower_ = GetValue<T>(bounds.elements(0).value());
-      upper_ = GetValue<T>(bounds.elements(1).value());
+      if (shared_bounds) {
+        std::tie(lower_, upper_) = *shared_bounds;
+      } else {
+        // Use a fraction of the privacy budget to find the approximate bounds.
+        double bounds_budget = privacy_budget / 2;
+        remaining_budget -= bounds_budget;
+        ASSIGN_OR_RETURN(Output bounds,
+                         approx_bounds_->PartialResult(bounds_budget,
+                                                       noise_interval_level));
+        lower_ = GetValue<T>(bounds.elements(0).value());
+        upper_ = GetValue<T>(bounds.elements(1).value());
+      }
       RETURN_IF_ERROR(Builder::CheckBounds(lower_, upper_));
       midpoint_ = lower_ + (upper_ - lower_) / 2;
 
       // To find the sum, pass the identity function as the transform.
+      FlushPartialSums();
       sum = approx_bounds_->template ComputeFromPartials<T>(
           pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
           raw_count_);
 
-      // Populate the bounding report with ApproxBounds information.
-      *(output.mutable_error_report()->mutable_bounding_report()) =
-          approx_bounds_->GetBoundingReport(lower_, upper_);
+      // Populate the bounding report with ApproxBounds information. The
+      // noisy bins of shared bounds belong to another ApproxBounds.
+      BoundingReport* report =
+          output.mutable_error_report()->mutable_bounding_report();
+      if (shared_bounds) {
+        SetValue<T>(report->mutable_lower_bound(), lower_);
+        SetValue<T>(report->mutable_upper_bound(), upper_);
+      } else {
+        *report = approx_bounds_->GetBoundingReport(lower_, upper_);
+      }
 
       // Clear the mechanism. The sensitivity might have changed.
       sum_mechanism_.reset();
@@ -294,6 +427,14 @@ class BoundedMean : public Algorithm<T> {
                             max_contributions_per_partition_, lower_, upper_));
     }
 
+    if (!count_mechanism_) {
+      ASSIGN_OR_RETURN(count_mechanism_,
+                       BuildCountMechanism(mechanism_builder_->Clone(),
+                                           Algorithm<T>::GetEpsilon(),
+                                           l0_sensitivity_,
+                                           max_contributions_per_partition_));
+    }
+
     double count_budget = remaining_budget / 2;
     remaining_budget -= count_budget;
     double noised_count =
@@ -308,6 +449,8 @@ class BoundedMean : public Algorithm<T> {
   void ResetState() override {
     std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    lazy_pos_sum_.Clear();
+    lazy_neg_sum_.Clear();
     raw_count_ = 0;
     if (approx_bounds_) {
       approx_bounds_->Reset();
@@ -316,6 +459,15 @@ class BoundedMean : public Algorithm<T> {
   }
 
  private:
+  // Adds the partial sums recorded lazily since the last flush to pos_sum_ and
+  // neg_sum_.
+  void FlushPartialSums() {
+    if (approx_bounds_) {
+      approx_bounds_->FlushLazyPartialSums(&lazy_pos_sum_, &pos_sum_);
+      approx_bounds_->FlushLazyPartialSums(&lazy_neg_sum_, &neg_sum_);
+    }
+  }
+
   void AddMultipleEntries(const T& input, uint64_t num_of_entries) {
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
@@ -326,17 +478,18 @@ class BoundedMean : public Algorithm<T> {
     raw_count_ += num_of_entries;
 
     if (!approx_bounds_) {
-      pos_sum_[0] += Clamp<T>(lower_, upper_, input) * num_of_entries;
+      pos_sum_[0] = AddMultipleWrapping<T>(
+          pos_sum_[0], Clamp<T>(lower_, upper_, input), num_of_entries);
     } else {
       approx_bounds_->AddMultipleEntries(input, num_of_entries);
 
       // Find partial sums.
       if (input >= 0) {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &pos_sum_, input, num_of_entries);
+        approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+            &lazy_pos_sum_, input, num_of_entries);
       } else {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &neg_sum_, input, num_of_entries);
+        approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+            &lazy_neg_sum_, input, num_of_entries);
       }
     }
   }
@@ -353,12 +506,30 @@ class BoundedMean : public Algorithm<T> {
         .Build();
   }
 
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>>
+  BuildCountMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      const double epsilon, const double l0_sensitivity,
+      const double max_contributions_per_partition) {
+    return mechanism_builder->SetEpsilon(epsilon)
+        .SetL0Sensitivity(l0_sensitivity)
+        .SetLInfSensitivity(max_contributions_per_partition)
+        .Build();
+  }
+
   // Friend class for testing only.
   friend class BoundedMeanTestPeer;
 
+  // Adds entries to the state for manually set bounds directly.
+  template <typename T2, typename Bounds>
+  friend class StaticBoundedMean;
+
   // Vectors of partial values stored for automatic clamping.
   std::vector<T> pos_sum_, neg_sum_;
 
+  // Partial values added since the last call to FlushPartialSums.
+  LazyPartials<T> lazy_pos_sum_, lazy_neg_sum_;
+
   uint64_t raw_count_;
   T lower_, upper_;
   double midpoint_;
@@ -513,6 +513,55 @@ TYPED_TEST(BoundedMeanTest, SerializeMergePartialSumsTest) {
   EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
 }
 
+TEST(BoundedMeanTest, AddEntriesSpanMatchesAddEntryManualBounds) {
+  std::vector<double> a = {-2, 1.5, NAN, 3, 6, 0.25};
+  BoundedMean<double>::Builder builder;
+  builder.SetLower(-1).SetUpper(4).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto algorithm1 = builder.Build();
+  ASSERT_OK(algorithm1);
+  auto algorithm2 = builder.Build();
+  ASSERT_OK(algorithm2);
+
+  for (double v : a) {
+    (*algorithm1)->AddEntry(v);
+  }
+  (*algorithm2)->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT((*algorithm2)->Serialize(),
+              EqualsProto((*algorithm1)->Serialize()));
+}
+
+TEST(BoundedMeanTest, AddEntriesSpanMatchesAddEntryApproxBounds) {
+  std::vector<double> a = {-10, 4, NAN, 6, 0, -0.5, 100};
+  std::unique_ptr<BoundedMean<double>> algorithms[2];
+  for (auto& algorithm : algorithms) {
+    auto bounds =
+        ApproxBounds<double>::Builder()
+            .SetThreshold(1)
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .Build();
+    ASSERT_OK(bounds);
+    auto built =
+        BoundedMean<double>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetApproxBounds(std::move(*bounds))
+            .Build();
+    ASSERT_OK(built);
+    algorithm = std::move(*built);
+  }
+
+  for (double v : a) {
+    algorithms[0]->AddEntry(v);
+  }
+  algorithms[1]->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT(algorithms[1]->Serialize(),
+              EqualsProto(algorithms[0]->Serialize()));
+}
+
 TYPED_TEST(BoundedMeanTest, AutomaticBoundsNegative) {
   std::vector<TypeParam> a = {9, -2, -2, -1, -6, -6};
   auto bounds =
@@ -791,5 +840,178 @@ TYPED_TEST(BoundedMeanTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT((*bm)->GetAggregationEpsilon(), epsilon);
 }
 
+TYPED_TEST(BoundedMeanTest, MergeFromMatchesMerge) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedMean<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto source = builder.Build();
+    ASSERT_OK(source);
+    (*source)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    (*merged)->AddEntry(5);
+    auto merged_from = builder.Build();
+    ASSERT_OK(merged_from);
+    (*merged_from)->AddEntry(5);
+
+    EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+    EXPECT_OK((*merged_from)->MergeFrom(**source));
+    EXPECT_THAT((*merged_from)->Serialize(),
+                EqualsProto((*merged)->Serialize()));
+  }
+
+  auto manual = typename BoundedMean<TypeParam>::Builder()
+                    .SetEpsilon(1.0)
+                    .SetLower(0)
+                    .SetUpper(10)
+                    .Build();
+  ASSERT_OK(manual);
+  auto automatic =
+      typename BoundedMean<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(automatic);
+  EXPECT_THAT((*manual)->MergeFrom(**automatic),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("equal number of partial sums")));
+}
+
+TYPED_TEST(BoundedMeanTest, AddEntryWithCountMatchesAddEntry) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedMean<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(-5).SetUpper(10);
+    }
+    auto with_count = builder.Build();
+    ASSERT_OK(with_count);
+    auto one_by_one = builder.Build();
+    ASSERT_OK(one_by_one);
+    for (const std::pair<TypeParam, uint64_t>& entry :
+         std::vector<std::pair<TypeParam, uint64_t>>{
+             {3, 5}, {-2, 4}, {30, 2}, {7, 0}}) {
+      (*with_count)->AddEntryWithCount(entry.first, entry.second);
+      for (uint64_t i = 0; i < entry.second; ++i) {
+        (*one_by_one)->AddEntry(entry.first);
+      }
+    }
+    EXPECT_THAT((*with_count)->Serialize(),
+                EqualsProto((*one_by_one)->Serialize()));
+  }
+}
+
+
+TEST(BoundedMeanTest, AddEntriesManualBoundsMatchesAddEntry) {
+  std::vector<int64_t> entries;
+  for (int i = 0; i < 1003; ++i) {
+    entries.push_back(i % 3 == 0 ? std::numeric_limits<int64_t>::max()
+                                 : i % 17);
+  }
+  auto make_mean = []() {
+    return BoundedMean<int64_t>::Builder()
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .SetLower(0)
+        .SetUpper(std::numeric_limits<int64_t>::max())
+        .Build();
+  };
+  base::StatusOr<std::unique_ptr<BoundedMean<int64_t>>> batched = make_mean();
+  base::StatusOr<std::unique_ptr<BoundedMean<int64_t>>> single = make_mean();
+  ASSERT_OK(batched);
+  ASSERT_OK(single);
+  (*batched)->AddEntries(entries);
+  for (int64_t entry : entries) {
+    (*single)->AddEntry(entry);
+  }
+  // The sum wraps around in the same way for both.
+  EXPECT_THAT((*batched)->Serialize(), EqualsProto((*single)->Serialize()));
+}
+
+TEST(BoundedMeanTest, AddEntriesManualBoundsSkipsNaN) {
+  std::vector<double> entries;
+  for (int i = 0; i < 21; ++i) {
+    entries.push_back(i % 4 == 0 ? std::numeric_limits<double>::quiet_NaN()
+                                 : 2.0);
+  }
+  base::StatusOr<std::unique_ptr<BoundedMean<double>>> bm =
+      BoundedMean<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLower(0)
+          .SetUpper(4)
+          .Build();
+  ASSERT_OK(bm);
+  (*bm)->AddEntries(entries);
+  base::StatusOr<Output> result = (*bm)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(result.value()), 2.0);
+}
+
+
+TEST(BoundedMeanTest, LazyMechanismIsBuiltOnFirstResult) {
+  typename BoundedMean<double>::Builder failing_builder;
+  base::StatusOr<std::unique_ptr<BoundedMean<double>>> failing =
+      failing_builder.SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(failing);
+  EXPECT_THAT((*failing)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+
+  typename BoundedMean<double>::Builder builder;
+  base::StatusOr<std::unique_ptr<BoundedMean<double>>> bm =
+      builder.SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bm);
+  (*bm)->AddEntry(2);
+  (*bm)->AddEntry(4);
+  base::StatusOr<Output> result = (*bm)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result), 3);
+}
+
+std::unique_ptr<ApproxBounds<double>> MakeExactApproxBounds() {
+  return ApproxBounds<double>::Builder()
+      .SetEpsilon(1)
+      .SetNumBins(5)
+      .SetBase(2)
+      .SetScale(1)
+      .SetThreshold(2)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(BoundedMeanTest, PartialResultWithSharedBounds) {
+  std::vector<double> a = {2, 2, 4, 6, 6};
+  std::unique_ptr<ApproxBounds<double>> shared_bounds =
+      MakeExactApproxBounds();
+  shared_bounds->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> bounds = shared_bounds->PartialResult();
+  ASSERT_OK(bounds);
+
+  std::unique_ptr<BoundedMean<double>> bm =
+      BoundedMean<double>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(MakeExactApproxBounds())
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  bm->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> output = bm->PartialResultWithBounds(*bounds, 1);
+  ASSERT_OK(output);
+  EXPECT_NEAR(GetValue<double>(*output), 4, 1e-9);
+  EXPECT_DOUBLE_EQ(
+      GetValue<double>(output->error_report().bounding_report().lower_bound()),
+      1);
+  EXPECT_EQ(bm->RemainingPrivacyBudget(), 0);
+}
+
 }  //  namespace
 }  // namespace differential_privacy
@@ -67,11 +67,12 @@ class BoundedStandardDeviation : public Algorithm<T> {
 
       // Construct bounded variance.
       std::unique_ptr<BoundedVariance<T>> variance;
-      auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
+      auto mech_builder = AlgorithmBuilder::TakeMechanismBuilder();
       ASSIGN_OR_RETURN(
           variance,
           variance_builder_.SetEpsilon(AlgorithmBuilder::GetEpsilon().value())
               .SetLaplaceMechanism(std::move(mech_builder))
+              .SetLazyMechanism(AlgorithmBuilder::GetLazyMechanism())
               .Build());
 
       return absl::WrapUnique(new BoundedStandardDeviation(
@@ -81,8 +82,18 @@ class BoundedStandardDeviation : public Algorithm<T> {
     typename BoundedVariance<T>::Builder variance_builder_;
   };
 
+  using Algorithm<T>::AddEntries;
+
   void AddEntry(const T& t) override { variance_->AddEntry(t); }
 
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    variance_->AddEntryWithCount(t, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    variance_->AddEntries(entries);
+  }
+
   // Returns a BoundedVarianceSummary.
   Summary Serialize() override { return variance_->Serialize(); }
 
@@ -91,6 +102,15 @@ class BoundedStandardDeviation : public Algorithm<T> {
     return variance_->Merge(summary);
   }
 
+  // Merges from a BoundedStandardDeviation or a BoundedVariance.
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_deviation = dynamic_cast<BoundedStandardDeviation<T>*>(&other);
+    if (other_deviation != nullptr) {
+      return variance_->MergeFrom(*other_deviation->variance_);
+    }
+    return variance_->MergeFrom(other);
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedStandardDeviation<T>);
     if (variance_) {
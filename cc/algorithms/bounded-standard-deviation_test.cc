@@ -325,5 +325,63 @@ TYPED_TEST(BoundedStandardDeviationTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT(bsd->GetAggregationEpsilon(), epsilon);
 }
 
+TYPED_TEST(BoundedStandardDeviationTest, MergeFromMatchesMerge) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedStandardDeviation<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto source = builder.Build();
+    ASSERT_OK(source);
+    (*source)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    (*merged)->AddEntry(5);
+    auto merged_from = builder.Build();
+    ASSERT_OK(merged_from);
+    (*merged_from)->AddEntry(5);
+
+    EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+    EXPECT_OK((*merged_from)->MergeFrom(**source));
+    EXPECT_THAT((*merged_from)->Serialize(),
+                EqualsProto((*merged)->Serialize()));
+  }
+}
+
+TYPED_TEST(BoundedStandardDeviationTest, MergeFromBoundedVariance) {
+  auto variance = typename BoundedVariance<TypeParam>::Builder()
+                      .SetEpsilon(1.0)
+                      .SetLower(0)
+                      .SetUpper(10)
+                      .Build();
+  ASSERT_OK(variance);
+  (*variance)->AddEntries(std::vector<TypeParam>{1, 2, 30});
+  auto deviation = typename BoundedStandardDeviation<TypeParam>::Builder()
+                       .SetEpsilon(1.0)
+                       .SetLower(0)
+                       .SetUpper(10)
+                       .Build();
+  ASSERT_OK(deviation);
+  EXPECT_OK((*deviation)->MergeFrom(**variance));
+  EXPECT_THAT((*deviation)->Serialize(),
+              EqualsProto((*variance)->Serialize()));
+}
+
+TEST(BoundedStandardDeviationTest, LazyMechanismAppliesToVariance) {
+  typename BoundedStandardDeviation<double>::Builder builder;
+  base::StatusOr<std::unique_ptr<BoundedStandardDeviation<double>>> bsd =
+      builder.SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bsd);
+  (*bsd)->AddEntry(2);
+  EXPECT_THAT((*bsd)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+}
+
 }  // namespace
 }  // namespace differential_privacy
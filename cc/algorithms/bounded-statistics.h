@@ -0,0 +1,693 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-algorithm.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/metrics.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
+#include "algorithms/util.h"
+#include "proto/util.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// The statistics that BoundedStatistics can release.
+enum class BoundedStatistic {
+  kCount,
+  kSum,
+  kMean,
+  kVariance,
+  kStandardDeviation,
+};
+
+// Incrementally provides several differentially private statistics of the same
+// values in a single pass. Every value is clamped once, and a single
+// ApproxBounds histogram is shared by all statistics when bounds are determined
+// automatically. This is cheaper than feeding the values to Count, BoundedSum,
+// BoundedMean and BoundedStandardDeviation separately.
+//
+// The output contains one element for each requested statistic, in the order
+// they were added to the builder. The statistics are computed from up to four
+// noisy quantities: the count, the sum, the sum normalized to the midpoint of
+// the bounds and the normalized sum of squares. Only the quantities needed by
+// the requested statistics are noised, and the privacy budget is split equally
+// between them. The count and normalized sum are shared by the mean and the
+// variance, which are computed as in BoundedMean and BoundedVariance. The sum
+// is noised as in BoundedSum.
+//
+// Summaries use the BoundedVarianceSummary format. As for other algorithms,
+// they can only be merged into a BoundedStatistics built with identical
+// parameters, including the requested statistics.
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class BoundedStatistics : public Algorithm<T> {
+ public:
+  // Builder for BoundedStatistics algorithm.
+  class Builder
+      : public BoundedAlgorithmBuilder<T, BoundedStatistics<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, BoundedStatistics<T>,
+                                               Builder>;
+    using BoundedBuilder =
+        BoundedAlgorithmBuilder<T, BoundedStatistics<T>, Builder>;
+
+   public:
+    // Requests statistic as the next element of the output. Adding the same
+    // statistic again has no effect.
+    Builder& AddStatistic(BoundedStatistic statistic) {
+      if (std::find(statistics_.begin(), statistics_.end(), statistic) ==
+          statistics_.end()) {
+        statistics_.push_back(statistic);
+      }
+      return *this;
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<BoundedStatistics<T>>>
+    BuildBoundedAlgorithm() override {
+      // We have to check epsilon now, otherwise the split during ApproxBounds
+      // construction might make the error message confusing.
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(
+          AlgorithmBuilder::GetEpsilon(), "Epsilon"));
+      if (statistics_.empty()) {
+        return absl::InvalidArgumentError(
+            "At least one statistic must be requested.");
+      }
+
+      // Ensure that either bounds are manually set or ApproxBounds is made.
+      RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
+      if (BoundedBuilder::BoundsAreSet()) {
+        RETURN_IF_ERROR(CheckBounds(BoundedBuilder::GetLower().value(),
+                                    BoundedBuilder::GetUpper().value(),
+                                    NeedsSquares(statistics_)));
+      }
+
+      // The count noising doesn't depend on the bounds, so we can always
+      // construct the mechanism we use for it here.
+      std::unique_ptr<NumericalMechanism> count_mechanism;
+      ASSIGN_OR_RETURN(
+          count_mechanism,
+          AlgorithmBuilder::GetMechanismBuilderClone()
+              ->SetEpsilon(BoundedBuilder::GetRemainingEpsilon().value())
+              .SetL0Sensitivity(
+                  AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1))
+              .SetLInfSensitivity(
+                  AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
+                      1))
+              .Build());
+
+      return absl::WrapUnique(new BoundedStatistics(
+          BoundedBuilder::GetRemainingEpsilon().value(),
+          BoundedBuilder::GetLower().value_or(0),
+          BoundedBuilder::GetUpper().value_or(0),
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+          AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1),
+          statistics_, AlgorithmBuilder::GetMechanismBuilderClone(),
+          std::move(count_mechanism),
+          std::move(BoundedBuilder::MoveApproxBoundsPointer())));
+    }
+
+    std::vector<BoundedStatistic> statistics_;
+  };
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBoundedStatisticsEntries);
+    AddMultipleEntries(t, 1);
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedStatisticsEntries, num_of_entries);
+    AddMultipleEntries(t, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedStatisticsEntries, entries.size());
+    if (approx_bounds_) {
+      for (const T& t : entries) {
+        AddMultipleEntries(t, 1);
+      }
+      return;
+    }
+    // With manual bounds, clamp each entry once and accumulate in locals.
+    T sum = pos_sum_[0];
+    double sum_of_squares = pos_sum_of_squares_[0];
+    uint64_t count = raw_count_;
+    for (const T& t : entries) {
+      if (!std::isnan(static_cast<double>(t))) {
+        const T clamped = Clamp<T>(lower_, upper_, t);
+        sum += clamped;
+        if (needs_squares_) {
+          sum_of_squares += static_cast<double>(clamped) * clamped;
+        }
+        ++count;
+      }
+    }
+    pos_sum_[0] = sum;
+    pos_sum_of_squares_[0] = sum_of_squares;
+    raw_count_ = count;
+  }
+
+  Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
+    FlushPartials();
+
+    BoundedVarianceSummary bv_summary;
+    bv_summary.set_count(raw_count_);
+    for (T x : pos_sum_) {
+      AddPackedValue(x, bv_summary.mutable_pos_sum_int(),
+                     bv_summary.mutable_pos_sum_double());
+    }
+    for (T x : neg_sum_) {
+      AddPackedValue(x, bv_summary.mutable_neg_sum_int(),
+                     bv_summary.mutable_neg_sum_double());
+    }
+    for (double x : pos_sum_of_squares_) {
+      bv_summary.add_pos_sum_of_squares(x);
+    }
+    for (double x : neg_sum_of_squares_) {
+      bv_summary.add_neg_sum_of_squares(x);
+    }
+    if (approx_bounds_) {
+      Summary approx_bounds_summary = approx_bounds_->Serialize();
+      approx_bounds_summary.data().UnpackTo(
+          bv_summary.mutable_bounds_summary());
+    }
+
+    Summary summary;
+    summary.mutable_data()->PackFrom(bv_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
+    return summary;
+  }
+
+  absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded statistics data.");
+    }
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
+    BoundedVarianceSummary bv_summary;
+    if (!summary.data().UnpackTo(&bv_summary)) {
+      return absl::InternalError(
+          "Bounded statistics summary unable to be unpacked.");
+    }
+    if (pos_sum_.size() != NumPackedValues(bv_summary.pos_sum(),
+                                           bv_summary.pos_sum_int(),
+                                           bv_summary.pos_sum_double()) ||
+        neg_sum_.size() != NumPackedValues(bv_summary.neg_sum(),
+                                           bv_summary.neg_sum_int(),
+                                           bv_summary.neg_sum_double()) ||
+        pos_sum_of_squares_.size() != bv_summary.pos_sum_of_squares_size() ||
+        neg_sum_of_squares_.size() != bv_summary.neg_sum_of_squares_size()) {
+      return absl::InternalError(
+          "Merged BoundedStatistics must have the same amount of partial "
+          "sum or sum of squares values as this BoundedStatistics.");
+    }
+
+    raw_count_ += bv_summary.count();
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetPackedValue<T>(bv_summary.pos_sum(),
+                                       bv_summary.pos_sum_int(),
+                                       bv_summary.pos_sum_double(), i);
+      pos_sum_of_squares_[i] += bv_summary.pos_sum_of_squares(i);
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetPackedValue<T>(bv_summary.neg_sum(),
+                                       bv_summary.neg_sum_int(),
+                                       bv_summary.neg_sum_double(), i);
+      neg_sum_of_squares_[i] += bv_summary.neg_sum_of_squares(i);
+    }
+    if (approx_bounds_) {
+      Summary approx_bounds_summary;
+      approx_bounds_summary.mutable_data()->PackFrom(
+          bv_summary.bounds_summary());
+      RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
+    }
+
+    return absl::OkStatus();
+  }
+
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_statistics = dynamic_cast<BoundedStatistics<T>*>(&other);
+    if (other_statistics == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if ((approx_bounds_ == nullptr) !=
+            (other_statistics->approx_bounds_ == nullptr) ||
+        pos_sum_.size() != other_statistics->pos_sum_.size() ||
+        neg_sum_.size() != other_statistics->neg_sum_.size() ||
+        pos_sum_of_squares_.size() !=
+            other_statistics->pos_sum_of_squares_.size() ||
+        neg_sum_of_squares_.size() !=
+            other_statistics->neg_sum_of_squares_.size()) {
+      return absl::InternalError(
+          "Merged BoundedStatistics must have the same amount of partial "
+          "sum or sum of squares values as this BoundedStatistics.");
+    }
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(
+          approx_bounds_->MergeFrom(*other_statistics->approx_bounds_));
+      other_statistics->FlushPartials();
+    }
+    raw_count_ += other_statistics->raw_count_;
+    for (int i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += other_statistics->pos_sum_[i];
+      pos_sum_of_squares_[i] += other_statistics->pos_sum_of_squares_[i];
+    }
+    for (int i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += other_statistics->neg_sum_[i];
+      neg_sum_of_squares_[i] += other_statistics->neg_sum_of_squares_[i];
+    }
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    int64_t memory = sizeof(BoundedStatistics<T>) +
+                     sizeof(BoundedStatistic) * statistics_.capacity() +
+                     sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
+                     sizeof(double) * (pos_sum_of_squares_.capacity() +
+                                       neg_sum_of_squares_.capacity()) +
+                     lazy_pos_sum_.MemoryUsed() + lazy_neg_sum_.MemoryUsed() +
+                     lazy_pos_sum_of_squares_.MemoryUsed() +
+                     lazy_neg_sum_of_squares_.MemoryUsed();
+    if (approx_bounds_) {
+      memory += approx_bounds_->MemoryUsed();
+    }
+    if (count_mechanism_) {
+      memory += count_mechanism_->MemoryUsed();
+    }
+    if (mechanism_builder_) {
+      memory += sizeof(*mechanism_builder_);
+    }
+    return memory;
+  }
+
+  double GetEpsilon() const override {
+    if (approx_bounds_) {
+      return approx_bounds_->GetEpsilon() + Algorithm<T>::GetEpsilon();
+    }
+    return Algorithm<T>::GetEpsilon();
+  }
+
+  // Returns the epsilon used to calculate approximate bounds. If approximate
+  // bounds are not used, returns 0.
+  double GetBoundingEpsilon() const {
+    if (approx_bounds_) {
+      return approx_bounds_->GetEpsilon();
+    }
+    return 0;
+  }
+
+  // Returns the epsilon shared by the requested statistics. If bounds are
+  // specified explicitly, this will be the total epsilon used by the algorithm.
+  double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
+
+  // Returns the requested statistics in the order of the output elements.
+  const std::vector<BoundedStatistic>& GetStatistics() const {
+    return statistics_;
+  }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    double remaining_budget = privacy_budget;
+    Output output;
+    double sum = 0;
+    double sos = 0;  // Sum of squares.
+
+    if (approx_bounds_) {
+      // Get bounds with a fraction of the privacy budget.
+      double bounds_budget = remaining_budget / 2;
+      remaining_budget -= bounds_budget;
+      ASSIGN_OR_RETURN(Output bounds, approx_bounds_->PartialResult(
+                                          bounds_budget, noise_interval_level));
+      lower_ = GetValue<T>(bounds.elements(0).value());
+      upper_ = GetValue<T>(bounds.elements(1).value());
+      RETURN_IF_ERROR(CheckBounds(lower_, upper_, needs_squares_));
+
+      FlushPartials();
+      sum = approx_bounds_->template ComputeFromPartials<T>(
+          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
+          raw_count_);
+      if (needs_squares_) {
+        sos = approx_bounds_->template ComputeFromPartials<double>(
+            pos_sum_of_squares_, neg_sum_of_squares_,
+            [](T x) { return static_cast<double>(x) * x; }, lower_, upper_,
+            raw_count_);
+      }
+
+      // Populate the bounding report with ApproxBounds information.
+      *(output.mutable_error_report()->mutable_bounding_report()) =
+          approx_bounds_->GetBoundingReport(lower_, upper_);
+    } else {
+      // Manual bounds were set and clamping was done upon adding entries.
+      sum = pos_sum_[0];
+      sos = pos_sum_of_squares_[0];
+    }
+
+    // Split the remaining budget equally between the noisy quantities that
+    // the requested statistics are computed from.
+    int num_quantities =
+        needs_count_ + needs_sum_ + needs_normalized_sum_ + needs_squares_;
+    double quantity_budget = remaining_budget / num_quantities;
+
+    double noised_count = 0;
+    if (needs_count_) {
+      noised_count = count_mechanism_->AddNoise(raw_count_, quantity_budget);
+    }
+
+    double noised_sum = 0;
+    if (needs_sum_) {
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> sum_mechanism,
+          BuildMechanism(std::max(std::abs(static_cast<double>(lower_)),
+                                  std::abs(static_cast<double>(upper_)))));
+      noised_sum = sum_mechanism->AddNoise(sum, quantity_budget);
+    }
+
+    const T midpoint = lower_ + (upper_ - lower_) / 2;
+    double normalized_sum = 0;
+    if (needs_normalized_sum_) {
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> normalized_sum_mechanism,
+          BuildMechanism(static_cast<double>(upper_ - lower_) / 2.0));
+      normalized_sum = normalized_sum_mechanism->AddNoise(
+          sum - static_cast<double>(raw_count_) * midpoint, quantity_budget);
+    }
+
+    const double sos_midpoint = MidpointOfSquares(lower_, upper_);
+    double normalized_sos = 0;
+    if (needs_squares_) {
+      ASSIGN_OR_RETURN(
+          std::unique_ptr<NumericalMechanism> sos_mechanism,
+          BuildMechanism(RangeOfSquares(lower_, upper_) / 2));
+      normalized_sos = sos_mechanism->AddNoise(
+          sos - static_cast<double>(raw_count_) * sos_midpoint,
+          quantity_budget);
+    }
+
+    for (BoundedStatistic statistic : statistics_) {
+      switch (statistic) {
+        case BoundedStatistic::kCount: {
+          int64_t count;
+          SafeCastFromDouble(std::round(noised_count), count);
+          AddToOutput<int64_t>(&output, count);
+          break;
+        }
+        case BoundedStatistic::kSum:
+          if (std::is_integral<T>::value) {
+            T value;
+            SafeCastFromDouble<T>(std::round(noised_sum), value);
+            AddToOutput<T>(&output, value);
+          } else {
+            AddToOutput<T>(&output, noised_sum);
+          }
+          break;
+        case BoundedStatistic::kMean: {
+          // Computed as in BoundedMean.
+          double mean =
+              normalized_sum / std::max(1.0, noised_count) + midpoint;
+          AddToOutput<double>(&output, Clamp<double>(lower_, upper_, mean));
+          break;
+        }
+        case BoundedStatistic::kVariance:
+          AddToOutput<double>(
+              &output,
+              Variance(noised_count, normalized_sum, normalized_sos, midpoint,
+                       sos_midpoint));
+          break;
+        case BoundedStatistic::kStandardDeviation:
+          AddToOutput<double>(
+              &output,
+              std::sqrt(Variance(noised_count, normalized_sum, normalized_sos,
+                                 midpoint, sos_midpoint)));
+          break;
+      }
+    }
+    return output;
+  }
+
+  void ResetState() override {
+    std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
+    std::fill(pos_sum_of_squares_.begin(), pos_sum_of_squares_.end(), 0);
+    std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    std::fill(neg_sum_of_squares_.begin(), neg_sum_of_squares_.end(), 0);
+    lazy_pos_sum_.Clear();
+    lazy_neg_sum_.Clear();
+    lazy_pos_sum_of_squares_.Clear();
+    lazy_neg_sum_of_squares_.Clear();
+    raw_count_ = 0;
+    if (approx_bounds_) {
+      approx_bounds_->Reset();
+    }
+  }
+
+ private:
+  BoundedStatistics(const double epsilon, const T lower, const T upper,
+                    const double l0_sensitivity,
+                    const double max_contributions_per_partition,
+                    std::vector<BoundedStatistic> statistics,
+                    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+                    std::unique_ptr<NumericalMechanism> count_mechanism,
+                    std::unique_ptr<ApproxBounds<T>> approx_bounds = nullptr)
+      : Algorithm<T>(epsilon),
+        raw_count_(0),
+        lower_(lower),
+        upper_(upper),
+        statistics_(std::move(statistics)),
+        needs_count_(false),
+        needs_sum_(false),
+        needs_normalized_sum_(false),
+        needs_squares_(NeedsSquares(statistics_)),
+        mechanism_builder_(std::move(mechanism_builder)),
+        l0_sensitivity_(l0_sensitivity),
+        max_contributions_per_partition_(max_contributions_per_partition),
+        count_mechanism_(std::move(count_mechanism)),
+        approx_bounds_(std::move(approx_bounds)) {
+    for (BoundedStatistic statistic : statistics_) {
+      needs_count_ |= statistic != BoundedStatistic::kSum;
+      needs_sum_ |= statistic == BoundedStatistic::kSum;
+      needs_normalized_sum_ |= statistic != BoundedStatistic::kCount &&
+                               statistic != BoundedStatistic::kSum;
+    }
+
+    // If automatically determining bounds, we need partial values for each bin
+    // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
+    // store one already-clamped value.
+    if (approx_bounds_) {
+      const int num_bins = approx_bounds_->NumPositiveBins();
+      pos_sum_.resize(num_bins, 0);
+      neg_sum_.resize(num_bins, 0);
+      pos_sum_of_squares_.resize(num_bins, 0);
+      neg_sum_of_squares_.resize(num_bins, 0);
+      lazy_pos_sum_.Resize(num_bins);
+      lazy_neg_sum_.Resize(num_bins);
+      lazy_pos_sum_of_squares_.Resize(num_bins);
+      lazy_neg_sum_of_squares_.Resize(num_bins);
+    } else {
+      pos_sum_.push_back(0);
+      pos_sum_of_squares_.push_back(0);
+    }
+  }
+
+  static bool NeedsSquares(const std::vector<BoundedStatistic>& statistics) {
+    for (BoundedStatistic statistic : statistics) {
+      if (statistic == BoundedStatistic::kVariance ||
+          statistic == BoundedStatistic::kStandardDeviation) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Applies the bound checks of BoundedVariance if sums of squares are needed,
+  // and those of BoundedMean otherwise.
+  static absl::Status CheckBounds(T lower, T upper, bool squares) {
+    if (squares) {
+      return BoundedVariance<T>::Builder::CheckBounds(lower, upper);
+    }
+    return BoundedMean<T>::Builder::CheckBounds(lower, upper);
+  }
+
+  // Returns the midpoint of the range of f(x) = x^2 where the domain of f is
+  // [lower, upper].
+  static double MidpointOfSquares(T lower, T upper) {
+    double l = lower;
+    double u = upper;
+    if (0 > l && 0 < u) {
+      return std::max(l * l, u * u) / 2;
+    }
+    return l * l + (u * u - l * l) / 2;
+  }
+
+  // Returns the width of the range of f(x) = x^2 where the domain of f is
+  // [lower, upper].
+  static double RangeOfSquares(T lower, T upper) {
+    double l = lower;
+    double u = upper;
+    if (0 > l && 0 < u) {
+      return std::max(l * l, u * u);
+    }
+    return std::abs(u * u - l * l);
+  }
+
+  // Computes the variance from the shared noisy quantities as in
+  // BoundedVariance.
+  double Variance(double noised_count, double normalized_sum,
+                  double normalized_sos, double midpoint,
+                  double sos_midpoint) const {
+    double mean = midpoint;
+    double mean_of_square = sos_midpoint;
+    if (noised_count > 1) {
+      mean = normalized_sum / noised_count + midpoint;
+      mean_of_square = normalized_sos / noised_count + sos_midpoint;
+    }
+    double interval = static_cast<double>(upper_) - lower_;
+    return Clamp<double>(0.0, interval * interval / 4,
+                         mean_of_square - mean * mean);
+  }
+
+  // Builds a mechanism for a sum whose per-entry contribution is bounded by
+  // linf_sensitivity.
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
+      double linf_sensitivity) {
+    return mechanism_builder_->Clone()
+        ->SetEpsilon(Algorithm<T>::GetEpsilon())
+        .SetL0Sensitivity(l0_sensitivity_)
+        .SetLInfSensitivity(max_contributions_per_partition_ *
+                            linf_sensitivity)
+        .Build();
+  }
+
+  void AddMultipleEntries(const T& t, uint64_t num_of_entries) {
+    // REF:
+    // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
+    if (std::isnan(static_cast<double>(t))) {
+      return;
+    }
+
+    raw_count_ += num_of_entries;
+
+    if (!approx_bounds_) {
+      const T clamped = Clamp<T>(lower_, upper_, t);
+      pos_sum_[0] += clamped * num_of_entries;
+      if (needs_squares_) {
+        pos_sum_of_squares_[0] +=
+            static_cast<double>(clamped) * clamped * num_of_entries;
+      }
+      return;
+    }
+
+    approx_bounds_->AddMultipleEntries(t, num_of_entries);
+    if (t >= 0) {
+      approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+          &lazy_pos_sum_, t, num_of_entries);
+      if (needs_squares_) {
+        approx_bounds_->template AddMultipleEntriesToLazyPartials<double>(
+            &lazy_pos_sum_of_squares_, t, num_of_entries,
+            &DifferenceOfSquares);
+      }
+    } else {
+      approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+          &lazy_neg_sum_, t, num_of_entries);
+      if (needs_squares_) {
+        approx_bounds_->template AddMultipleEntriesToLazyPartials<double>(
+            &lazy_neg_sum_of_squares_, t, num_of_entries,
+            &DifferenceOfSquares);
+      }
+    }
+  }
+
+  static double DifferenceOfSquares(T val1, T val2) {
+    // Lessen the chance of becoming inf/-inf by calculating it like this.
+    return (static_cast<double>(val1) + val2) *
+           (static_cast<double>(val1) - val2);
+  }
+
+  // Adds the partial values recorded lazily since the last flush to the
+  // partial sum and sum of squares vectors.
+  void FlushPartials() {
+    if (approx_bounds_) {
+      approx_bounds_->FlushLazyPartialSums(&lazy_pos_sum_, &pos_sum_);
+      approx_bounds_->FlushLazyPartialSums(&lazy_neg_sum_, &neg_sum_);
+      approx_bounds_->FlushLazyPartials(&lazy_pos_sum_of_squares_,
+                                        &pos_sum_of_squares_,
+                                        &DifferenceOfSquares);
+      approx_bounds_->FlushLazyPartials(&lazy_neg_sum_of_squares_,
+                                        &neg_sum_of_squares_,
+                                        &DifferenceOfSquares);
+    }
+  }
+
+  // Vectors of partial values stored for automatic clamping.
+  std::vector<T> pos_sum_, neg_sum_;
+  std::vector<double> pos_sum_of_squares_, neg_sum_of_squares_;
+
+  // Partial values added since the last call to FlushPartials.
+  LazyPartials<T> lazy_pos_sum_, lazy_neg_sum_;
+  LazyPartials<double> lazy_pos_sum_of_squares_, lazy_neg_sum_of_squares_;
+
+  uint64_t raw_count_;
+
+  // If manually set, these values are determined upon construction. Otherwise,
+  // they are found in GenerateResult().
+  T lower_, upper_;
+
+  // The requested statistics, and which noisy quantities they need.
+  const std::vector<BoundedStatistic> statistics_;
+  bool needs_count_;
+  bool needs_sum_;
+  bool needs_normalized_sum_;
+  const bool needs_squares_;
+
+  // Used to construct the sum mechanisms once bounds are known.
+  std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
+  const double l0_sensitivity_;
+  const int max_contributions_per_partition_;
+  std::unique_ptr<NumericalMechanism> count_mechanism_;
+
+  // If this is not nullptr, we are automatically determining bounds. Otherwise,
+  // lower and upper contain the manually set bounds.
+  std::unique_ptr<ApproxBounds<T>> approx_bounds_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_STATISTICS_H_
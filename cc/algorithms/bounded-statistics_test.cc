@@ -0,0 +1,334 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/bounded-statistics.h"
+
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/status/status.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using test_utils::ZeroNoiseMechanism;
+using ::differential_privacy::base::testing::EqualsProto;
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::HasSubstr;
+
+template <typename T>
+class BoundedStatisticsTest : public ::testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(BoundedStatisticsTest, NumericTypes);
+
+template <typename T>
+typename BoundedStatistics<T>::Builder& AddAllStatistics(
+    typename BoundedStatistics<T>::Builder* builder) {
+  return builder->AddStatistic(BoundedStatistic::kCount)
+      .AddStatistic(BoundedStatistic::kSum)
+      .AddStatistic(BoundedStatistic::kMean)
+      .AddStatistic(BoundedStatistic::kVariance)
+      .AddStatistic(BoundedStatistic::kStandardDeviation);
+}
+
+TYPED_TEST(BoundedStatisticsTest, AllStatisticsManualBounds) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 20};
+  typename BoundedStatistics<TypeParam>::Builder builder;
+  auto bs = AddAllStatistics<TypeParam>(&builder)
+                .SetLaplaceMechanism(
+                    absl::make_unique<ZeroNoiseMechanism::Builder>())
+                .SetLower(0)
+                .SetUpper(10)
+                .SetEpsilon(1.0)
+                .Build();
+  ASSERT_OK(bs);
+  auto result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 5);
+
+  // 20 is clamped to 10.
+  EXPECT_EQ(GetValue<int64_t>(*result), 5);
+  EXPECT_EQ(GetValue<TypeParam>(result->elements(1).value()), 20);
+  EXPECT_THAT(GetValue<double>(result->elements(2).value()), DoubleEq(4.0));
+  EXPECT_THAT(GetValue<double>(result->elements(3).value()),
+              DoubleNear(10.0, 1e-10));
+  EXPECT_THAT(GetValue<double>(result->elements(4).value()),
+              DoubleNear(std::sqrt(10.0), 1e-10));
+}
+
+TYPED_TEST(BoundedStatisticsTest, MatchesSeparateAlgorithms) {
+  std::vector<TypeParam> a = {-3, 1, 2, 7, 8, 11};
+  auto bs = typename BoundedStatistics<TypeParam>::Builder()
+                .AddStatistic(BoundedStatistic::kVariance)
+                .AddStatistic(BoundedStatistic::kMean)
+                .SetLaplaceMechanism(
+                    absl::make_unique<ZeroNoiseMechanism::Builder>())
+                .SetLower(-5)
+                .SetUpper(10)
+                .SetEpsilon(1.0)
+                .Build();
+  ASSERT_OK(bs);
+  auto mean = typename BoundedMean<TypeParam>::Builder()
+                  .SetLaplaceMechanism(
+                      absl::make_unique<ZeroNoiseMechanism::Builder>())
+                  .SetLower(-5)
+                  .SetUpper(10)
+                  .SetEpsilon(1.0)
+                  .Build();
+  ASSERT_OK(mean);
+  auto variance = typename BoundedVariance<TypeParam>::Builder()
+                      .SetLaplaceMechanism(
+                          absl::make_unique<ZeroNoiseMechanism::Builder>())
+                      .SetLower(-5)
+                      .SetUpper(10)
+                      .SetEpsilon(1.0)
+                      .Build();
+  ASSERT_OK(variance);
+
+  auto result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 2);
+  auto expected_mean = (*mean)->Result(a.begin(), a.end());
+  ASSERT_OK(expected_mean);
+  auto expected_variance = (*variance)->Result(a.begin(), a.end());
+  ASSERT_OK(expected_variance);
+
+  // Outputs are in the order the statistics were requested.
+  EXPECT_THAT(GetValue<double>(result->elements(0).value()),
+              DoubleNear(GetValue<double>(*expected_variance), 1e-10));
+  EXPECT_THAT(GetValue<double>(result->elements(1).value()),
+              DoubleNear(GetValue<double>(*expected_mean), 1e-10));
+}
+
+TYPED_TEST(BoundedStatisticsTest, DuplicateStatisticsAreIgnored) {
+  auto bs = typename BoundedStatistics<TypeParam>::Builder()
+                .AddStatistic(BoundedStatistic::kSum)
+                .AddStatistic(BoundedStatistic::kCount)
+                .AddStatistic(BoundedStatistic::kSum)
+                .SetLower(0)
+                .SetUpper(10)
+                .SetEpsilon(1.0)
+                .Build();
+  ASSERT_OK(bs);
+  EXPECT_THAT((*bs)->GetStatistics(),
+              ::testing::ElementsAre(BoundedStatistic::kSum,
+                                     BoundedStatistic::kCount));
+}
+
+TYPED_TEST(BoundedStatisticsTest, NoStatisticsFailsToBuild) {
+  auto bs = typename BoundedStatistics<TypeParam>::Builder()
+                .SetLower(0)
+                .SetUpper(10)
+                .SetEpsilon(1.0)
+                .Build();
+  EXPECT_THAT(bs.status(), StatusIs(absl::StatusCode::kInvalidArgument,
+                                    HasSubstr("At least one statistic")));
+}
+
+TYPED_TEST(BoundedStatisticsTest, InvalidBoundsFailToBuild) {
+  auto bs = typename BoundedStatistics<TypeParam>::Builder()
+                .AddStatistic(BoundedStatistic::kMean)
+                .SetLower(10)
+                .SetUpper(0)
+                .SetEpsilon(1.0)
+                .Build();
+  EXPECT_THAT(bs.status(), StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TYPED_TEST(BoundedStatisticsTest, AddEntriesMatchesAddEntry) {
+  std::vector<TypeParam> a = {-8, -2, 0, 3, 5, 9, 14};
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedStatistics<TypeParam>::Builder builder;
+    AddAllStatistics<TypeParam>(&builder);
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(-5).SetUpper(10);
+    }
+    auto bs1 = builder.Build();
+    ASSERT_OK(bs1);
+    auto bs2 = builder.Build();
+    ASSERT_OK(bs2);
+    for (const TypeParam& t : a) {
+      (*bs1)->AddEntry(t);
+    }
+    (*bs2)->AddEntries(absl::MakeConstSpan(a));
+    EXPECT_THAT((*bs2)->Serialize(), EqualsProto((*bs1)->Serialize()));
+  }
+}
+
+TYPED_TEST(BoundedStatisticsTest, AutomaticBounds) {
+  std::vector<TypeParam> a = {-10, -4, 0, 4, 6};
+  auto bounds = typename ApproxBounds<TypeParam>::Builder()
+                    .SetThreshold(1)
+                    .SetLaplaceMechanism(
+                        absl::make_unique<ZeroNoiseMechanism::Builder>())
+                    .Build();
+  ASSERT_OK(bounds);
+  typename BoundedStatistics<TypeParam>::Builder builder;
+  auto bs = AddAllStatistics<TypeParam>(&builder)
+                .SetLaplaceMechanism(
+                    absl::make_unique<ZeroNoiseMechanism::Builder>())
+                .SetApproxBounds(std::move(*bounds))
+                .Build();
+  ASSERT_OK(bs);
+  auto result = (*bs)->Result(a.begin(), a.end());
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 5);
+
+  // Bounds are [-16, 8], so no entry is clamped.
+  EXPECT_EQ(GetValue<int64_t>(*result), 5);
+  EXPECT_THAT(static_cast<double>(
+                  GetValue<TypeParam>(result->elements(1).value())),
+              DoubleNear(-4, 1e-10));
+  EXPECT_THAT(GetValue<double>(result->elements(2).value()),
+              DoubleNear(-0.8, 1e-10));
+  EXPECT_THAT(GetValue<double>(result->elements(3).value()),
+              DoubleNear(32.96, 1e-10));
+  EXPECT_TRUE(result->error_report().has_bounding_report());
+  EXPECT_EQ(GetValue<TypeParam>(
+                result->error_report().bounding_report().lower_bound()),
+            -16);
+  EXPECT_EQ(GetValue<TypeParam>(
+                result->error_report().bounding_report().upper_bound()),
+            8);
+}
+
+TYPED_TEST(BoundedStatisticsTest, SerializeMergeMatchesSingleInstance) {
+  std::vector<TypeParam> a = {-10, 4, 2, 8, -6};
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedStatistics<TypeParam>::Builder builder;
+    AddAllStatistics<TypeParam>(&builder);
+    builder.SetLaplaceMechanism(
+        absl::make_unique<ZeroNoiseMechanism::Builder>());
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(-8).SetUpper(8);
+    } else {
+      auto bounds = typename ApproxBounds<TypeParam>::Builder()
+                        .SetThreshold(1)
+                        .SetLaplaceMechanism(
+                            absl::make_unique<ZeroNoiseMechanism::Builder>())
+                        .Build();
+      ASSERT_OK(bounds);
+      builder.SetApproxBounds(std::move(*bounds));
+    }
+    auto single = builder.Build();
+    ASSERT_OK(single);
+    if (!manual_bounds) {
+      auto bounds = typename ApproxBounds<TypeParam>::Builder()
+                        .SetThreshold(1)
+                        .SetLaplaceMechanism(
+                            absl::make_unique<ZeroNoiseMechanism::Builder>())
+                        .Build();
+      ASSERT_OK(bounds);
+      builder.SetApproxBounds(std::move(*bounds));
+    }
+    auto first = builder.Build();
+    ASSERT_OK(first);
+    if (!manual_bounds) {
+      auto bounds = typename ApproxBounds<TypeParam>::Builder()
+                        .SetThreshold(1)
+                        .SetLaplaceMechanism(
+                            absl::make_unique<ZeroNoiseMechanism::Builder>())
+                        .Build();
+      ASSERT_OK(bounds);
+      builder.SetApproxBounds(std::move(*bounds));
+    }
+    auto second = builder.Build();
+    ASSERT_OK(second);
+
+    (*single)->AddEntries(a.begin(), a.end());
+    (*first)->AddEntries(a.begin(), a.begin() + 2);
+    (*second)->AddEntries(a.begin() + 2, a.end());
+    ASSERT_OK((*second)->Merge((*first)->Serialize()));
+    EXPECT_THAT((*second)->Serialize(), EqualsProto((*single)->Serialize()));
+
+    auto expected = (*single)->PartialResult();
+    ASSERT_OK(expected);
+    auto merged = (*second)->PartialResult();
+    ASSERT_OK(merged);
+    for (int i = 0; i < expected->elements_size(); ++i) {
+      EXPECT_THAT(merged->elements(i), EqualsProto(expected->elements(i)));
+    }
+  }
+}
+
+TEST(BoundedStatisticsTest, MergeRejectsMismatchedSummary) {
+  auto manual = BoundedStatistics<double>::Builder()
+                    .AddStatistic(BoundedStatistic::kMean)
+                    .SetLower(0)
+                    .SetUpper(10)
+                    .SetEpsilon(1.0)
+                    .Build();
+  ASSERT_OK(manual);
+  auto automatic = BoundedStatistics<double>::Builder()
+                       .AddStatistic(BoundedStatistic::kMean)
+                       .SetEpsilon(1.0)
+                       .Build();
+  ASSERT_OK(automatic);
+  EXPECT_THAT((*manual)->Merge((*automatic)->Serialize()),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT((*manual)->Merge(Summary()),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(BoundedStatisticsTest, SplitsEpsilonForApproxBounds) {
+  auto bs = BoundedStatistics<double>::Builder()
+                .AddStatistic(BoundedStatistic::kSum)
+                .SetEpsilon(1.0)
+                .Build();
+  ASSERT_OK(bs);
+  EXPECT_DOUBLE_EQ((*bs)->GetEpsilon(), 1.0);
+  EXPECT_DOUBLE_EQ((*bs)->GetBoundingEpsilon(), 0.5);
+  EXPECT_DOUBLE_EQ((*bs)->GetAggregationEpsilon(), 0.5);
+}
+
+TYPED_TEST(BoundedStatisticsTest, MergeFromMatchesMerge) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedStatistics<TypeParam>::Builder builder;
+    AddAllStatistics<TypeParam>(&builder).SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto source = builder.Build();
+    ASSERT_OK(source);
+    (*source)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    (*merged)->AddEntry(5);
+    auto merged_from = builder.Build();
+    ASSERT_OK(merged_from);
+    (*merged_from)->AddEntry(5);
+
+    EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+    EXPECT_OK((*merged_from)->MergeFrom(**source));
+    EXPECT_THAT((*merged_from)->Serialize(),
+                EqualsProto((*merged)->Serialize()));
+  }
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -18,21 +18,43 @@
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_SUM_H_
 
 #include <limits>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include "google/protobuf/any.pb.h"
+#include "google/protobuf/arena.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/exact-sum.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
 
 namespace differential_privacy {
+namespace internal {
+
+// Returns sum plus the sum of entries clamped to [lower, upper], skipping NaN
+// entries. See AddClampedEntriesInLanes in util.h for how the entries are
+// accumulated.
+template <typename T>
+T AddClampedEntries(T sum, absl::Span<const T> entries, T lower, T upper) {
+  AddClampedEntriesInLanes</*kWithSquares=*/false>(entries, lower, upper, &sum,
+                                                   /*sum_of_squares=*/nullptr);
+  return sum;
+}
+
+}  // namespace internal
 
 // Incrementally provides a differentially private sum, clamped between upper
 // and lower values. Bounds can be manually set or privately inferred.
@@ -57,7 +79,46 @@ class BoundedSum : public Algorithm<T> {
       return absl::OkStatus();
     }
 
+    // With compact state, the BoundedSum keeps its sum inline and builds its
+    // mechanism only when a result is generated, from a mechanism builder that
+    // is shared by all BoundedSums this builder builds with the same
+    // parameters. This minimizes the memory of many live instances. Requires
+    // manually set bounds.
+    Builder& SetCompactState(bool compact_state) {
+      compact_state_ = compact_state;
+      return *this;
+    }
+
+    // Allocates the partial sums kept for automatic bounds from resource,
+    // e.g., a std::pmr::monotonic_buffer_resource shared by a batch of
+    // BoundedSums. resource must outlive the built BoundedSums and is not
+    // owned. Defaults to std::pmr::get_default_resource().
+    Builder& SetMemoryResource(std::pmr::memory_resource* resource) {
+      memory_resource_ = resource;
+      return *this;
+    }
+
+    // With an exact sum, floating point entries are added without rounding
+    // into an ExactSum, so that the sum, and therefore the result for a given
+    // noise, does not depend on the order in which entries are added and
+    // summaries are merged. Requires manually set bounds. Integral sums are
+    // always exact, so this has no effect for them.
+    Builder& SetExactSum(bool exact_sum) {
+      exact_sum_ = exact_sum;
+      return *this;
+    }
+
+    Builder& SetLaplaceMechanism(
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
+      shared_mechanism_builder_ = nullptr;
+      return AlgorithmBuilder::SetLaplaceMechanism(
+          std::move(mechanism_builder));
+    }
+
    private:
+    // Parameters the shared mechanism builder was configured with.
+    using MechanismParameters = std::tuple<double, double, double, T, T>;
+
     base::StatusOr<std::unique_ptr<BoundedSum<T>>> BuildBoundedAlgorithm()
         override {
       // We have to check epsilon now, otherwise the split during ApproxBounds
@@ -68,11 +129,53 @@ class BoundedSum : public Algorithm<T> {
       // Ensure that either bounds are manually set or ApproxBounds is made.
       RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
 
+      if (exact_sum_ && !BoundedBuilder::BoundsAreSet()) {
+        return absl::InvalidArgumentError(
+            "Exact sum requires manually set bounds.");
+      }
+
+      if (compact_state_) {
+        if (!BoundedBuilder::BoundsAreSet()) {
+          return absl::InvalidArgumentError(
+              "Compact state requires manually set bounds.");
+        }
+        RETURN_IF_ERROR(CheckLowerBound(BoundedBuilder::GetLower().value()));
+        const MechanismParameters parameters(
+            BoundedBuilder::GetRemainingEpsilon().value(),
+            AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+            AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1),
+            BoundedBuilder::GetLower().value(),
+            BoundedBuilder::GetUpper().value());
+        if (!shared_mechanism_builder_ ||
+            shared_mechanism_parameters_ != parameters) {
+          // Build a mechanism once so we can fail on build if sensitivity is
+          // inappropriate.
+          std::unique_ptr<NumericalMechanismBuilder> mechanism_builder =
+              AlgorithmBuilder::GetMechanismBuilderClone();
+          RETURN_IF_ERROR(
+              BuildMechanism(mechanism_builder->Clone(),
+                             std::get<0>(parameters), std::get<1>(parameters),
+                             std::get<2>(parameters), std::get<3>(parameters),
+                             std::get<4>(parameters))
+                  .status());
+          shared_mechanism_builder_ = std::move(mechanism_builder);
+          shared_mechanism_parameters_ = parameters;
+        }
+        return WithExactSum(absl::WrapUnique(new BoundedSum(
+            std::get<0>(parameters), std::get<3>(parameters),
+            std::get<4>(parameters), std::get<1>(parameters),
+            std::get<2>(parameters), shared_mechanism_builder_,
+            /*mechanism=*/nullptr)));
+      }
+
       // If manual bounding, construct mechanism so we can fail on build if
-      // sensitivity is inappropriate.
+      // sensitivity is inappropriate, unless it is built lazily.
       std::unique_ptr<NumericalMechanism> mechanism = nullptr;
       if (BoundedBuilder::BoundsAreSet()) {
         RETURN_IF_ERROR(CheckLowerBound(BoundedBuilder::GetLower().value()));
+      }
+      if (BoundedBuilder::BoundsAreSet() &&
+          !AlgorithmBuilder::GetLazyMechanism()) {
         ASSIGN_OR_RETURN(
             mechanism,
             BuildMechanism(
@@ -85,19 +188,40 @@ class BoundedSum : public Algorithm<T> {
       }
 
       // Construct BoundedSum.
-      auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
-      return absl::WrapUnique(new BoundedSum(
+      auto mech_builder = AlgorithmBuilder::TakeMechanismBuilder();
+      return WithExactSum(absl::WrapUnique(new BoundedSum(
           BoundedBuilder::GetRemainingEpsilon().value(),
           BoundedBuilder::GetLower().value_or(0),
           BoundedBuilder::GetUpper().value_or(0),
           AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
           AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1),
           std::move(mech_builder), std::move(mechanism),
-          std::move(BoundedBuilder::MoveApproxBoundsPointer())));
+          std::move(BoundedBuilder::MoveApproxBoundsPointer()),
+          memory_resource_)));
+    }
+
+    std::unique_ptr<BoundedSum<T>> WithExactSum(
+        std::unique_ptr<BoundedSum<T>> bounded_sum) const {
+      if (exact_sum_) {
+        bounded_sum->EnableExactSum();
+      }
+      return bounded_sum;
     }
+
+    bool compact_state_ = false;
+    bool exact_sum_ = false;
+    std::pmr::memory_resource* memory_resource_ =
+        std::pmr::get_default_resource();
+    std::shared_ptr<const NumericalMechanismBuilder> shared_mechanism_builder_;
+    MechanismParameters shared_mechanism_parameters_;
   };
 
-  void AddEntry(const T& t) override {
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override { AddEntryWithCount(t, 1); }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedSumEntries, num_of_entries);
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
     if (std::isnan(static_cast<double>(t))) {
@@ -106,20 +230,82 @@ class BoundedSum : public Algorithm<T> {
 
     // If manual bounds are set, clamp immediately and store sum. Otherwise,
     // feed inputs into ApproxBounds and store temporary partial sums.
-    if (!approx_bounds_) {
-      pos_sum_[0] += Clamp<T>(lower_, upper_, t);
+    if (exact_sum_) {
+      exact_sum_->Add(Clamp<T>(lower_, upper_, t), num_of_entries);
+    } else if (!approx_bounds_) {
+      sum_ = AddMultipleWrapping<T>(sum_, Clamp<T>(lower_, upper_, t),
+                                    num_of_entries);
     } else {
-      approx_bounds_->AddEntry(t);
+      approx_bounds_->AddMultipleEntries(t, num_of_entries);
 
       // Find partial sums.
       if (t >= 0) {
-        approx_bounds_->template AddToPartialSums<T>(&pos_sum_, t);
+        approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+            &lazy_pos_sum_, t, num_of_entries);
       } else {
-        approx_bounds_->template AddToPartialSums<T>(&neg_sum_, t);
+        approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+            &lazy_neg_sum_, t, num_of_entries);
       }
     }
   }
 
+  // Supported with manually set bounds. Floating-point sums must also be
+  // exact sums, since subtracting from them would not undo the rounding of
+  // the additions.
+  absl::Status RemoveEntryWithCount(const T& t,
+                                    uint64_t num_of_entries) override {
+    if (approx_bounds_) {
+      return absl::UnimplementedError(
+          "Removing entries requires manually set bounds.");
+    }
+    if (std::is_floating_point<T>::value && !exact_sum_) {
+      return absl::UnimplementedError(
+          "Removing entries from a floating-point sum requires an exact sum.");
+    }
+    if (std::isnan(static_cast<double>(t))) {
+      return absl::OkStatus();
+    }
+    if (exact_sum_) {
+      exact_sum_->Add(-static_cast<double>(Clamp<T>(lower_, upper_, t)),
+                      num_of_entries);
+    } else {
+      // Adding the value -num_of_entries times modulo 2^64 subtracts it
+      // num_of_entries times, with the same wrapping as the additions.
+      sum_ = AddMultipleWrapping<T>(sum_, Clamp<T>(lower_, upper_, t),
+                                    uint64_t{0} - num_of_entries);
+    }
+    return absl::OkStatus();
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedSumEntries, entries.size());
+    if (approx_bounds_) {
+      for (const T& t : entries) {
+        if (std::isnan(static_cast<double>(t))) {
+          continue;
+        }
+        approx_bounds_->AddMultipleEntries(t, 1);
+        if (t >= 0) {
+          approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+              &lazy_pos_sum_, t, 1);
+        } else {
+          approx_bounds_->template AddMultipleEntriesToLazyPartialSums<T>(
+              &lazy_neg_sum_, t, 1);
+        }
+      }
+      return;
+    }
+    if (exact_sum_) {
+      for (const T& t : entries) {
+        if (t == t) {
+          exact_sum_->Add(Clamp<T>(lower_, upper_, t));
+        }
+      }
+      return;
+    }
+    sum_ = internal::AddClampedEntries<T>(sum_, entries, lower_, upper_);
+  }
+
   // Only return noise confidence interval for manually set bounds, since it is
   // dynamic upon result generation for auto-bounds.
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
@@ -129,65 +315,157 @@ class BoundedSum : public Algorithm<T> {
           "NoiseConfidenceInterval changes per result generation for "
           "automatically-determined sensitivity.");
     }
+    if (!mechanism_) {
+      ASSIGN_OR_RETURN(mechanism_, BuildMechanism());
+    }
     return NoiseConfidenceIntervalImpl(confidence_level, privacy_budget);
   }
 
+  // Returns a new BoundedSum with the same parameters as this one, but without
+  // entries and with the full privacy budget. Unlike Builder::Build(), this
+  // does not validate the parameters again, and the new instance shares the
+  // mechanism builder of this one and builds its mechanism only when it is
+  // first needed. Requires manually set bounds.
+  base::StatusOr<std::unique_ptr<Algorithm<T>>> NewInstance() const override {
+    if (approx_bounds_) {
+      return absl::UnimplementedError(
+          "NewInstance requires manually set bounds.");
+    }
+    auto instance = absl::WrapUnique(new BoundedSum(
+        Algorithm<T>::GetEpsilon(), lower_, upper_, l0_sensitivity_,
+        max_contributions_per_partition_, mechanism_builder_,
+        /*mechanism=*/nullptr));
+    if (exact_sum_) {
+      instance->EnableExactSum();
+    }
+    Algorithm<T>::SharePrivacyBudgetAccountant(instance.get());
+    return std::unique_ptr<Algorithm<T>>(std::move(instance));
+  }
+
   T lower() { return lower_; }
   T upper() { return upper_; }
 
   Summary Serialize() override {
-    // Create BoundedSumSummary.
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
     BoundedSumSummary bs_summary;
-    for (T x : pos_sum_) {
-      SetValue(bs_summary.add_pos_sum(), x);
-    }
-    for (T x : neg_sum_) {
-      SetValue(bs_summary.add_neg_sum(), x);
-    }
-    if (approx_bounds_) {
-      Summary approx_bounds_summary = approx_bounds_->Serialize();
-      approx_bounds_summary.data().UnpackTo(
-          bs_summary.mutable_bounds_summary());
-    }
-
-    // Create Summary.
+    SerializeToBoundedSumSummary(&bs_summary, /*arena=*/nullptr);
     Summary summary;
     summary.mutable_data()->PackFrom(bs_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
+    return summary;
+  }
+
+  Summary* SerializeToArena(google::protobuf::Arena* arena) override {
+    if (arena == nullptr) {
+      return new Summary(Serialize());
+    }
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
+    BoundedSumSummary* bs_summary =
+        google::protobuf::Arena::CreateMessage<BoundedSumSummary>(arena);
+    SerializeToBoundedSumSummary(bs_summary, arena);
+    Summary* summary = google::protobuf::Arena::CreateMessage<Summary>(arena);
+    summary->mutable_data()->PackFrom(*bs_summary);
     return summary;
   }
 
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError(
           "Cannot merge summary with no bounded sum data.");
     }
-
-    // Add bounded sum partial values.
-    BoundedSumSummary bs_summary;
-    if (!summary.data().UnpackTo(&bs_summary)) {
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
+
+    // Add bounded sum partial values. The unpacked summary is allocated on the
+    // arena of summary, if any.
+    google::protobuf::Arena* arena = summary.GetArena();
+    BoundedSumSummary* bs_summary =
+        google::protobuf::Arena::CreateMessage<BoundedSumSummary>(arena);
+    std::unique_ptr<BoundedSumSummary> owned_summary(
+        arena == nullptr ? bs_summary : nullptr);
+    if (!summary.data().UnpackTo(bs_summary)) {
       return absl::InternalError("Bounded sum summary unable to be unpacked.");
     }
-    if (pos_sum_.size() != bs_summary.pos_sum_size() ||
-        neg_sum_.size() != bs_summary.neg_sum_size()) {
+    // With manual bounds, the sum is the only positive partial sum.
+    const size_t num_pos_sums = approx_bounds_ ? pos_sum_.size() : 1;
+    if (num_pos_sums != NumPackedValues(bs_summary->pos_sum(),
+                                        bs_summary->pos_sum_int(),
+                                        bs_summary->pos_sum_double()) ||
+        neg_sum_.size() != NumPackedValues(bs_summary->neg_sum(),
+                                           bs_summary->neg_sum_int(),
+                                           bs_summary->neg_sum_double())) {
       return absl::InternalError(
           "Merged BoundedSum must have the same amount of partial sum "
           "values as this BoundedSum.");
     }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bs_summary.pos_sum(i));
+    if (!approx_bounds_) {
+      const T sum = GetPackedValue<T>(bs_summary->pos_sum(),
+                                      bs_summary->pos_sum_int(),
+                                      bs_summary->pos_sum_double(), 0);
+      if (!exact_sum_) {
+        sum_ += sum;
+      } else if (bs_summary->exact_sum_size() > 0) {
+        ExactSum other;
+        RETURN_IF_ERROR(other.SetDigits(bs_summary->exact_sum()));
+        exact_sum_->Merge(other);
+      } else {
+        // Summaries without an exact sum are merged with their rounded sum.
+        exact_sum_->Add(sum);
+      }
+      return absl::OkStatus();
     }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bs_summary.neg_sum(i));
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetPackedValue<T>(bs_summary->pos_sum(),
+                                       bs_summary->pos_sum_int(),
+                                       bs_summary->pos_sum_double(), i);
+    }
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetPackedValue<T>(bs_summary->neg_sum(),
+                                       bs_summary->neg_sum_int(),
+                                       bs_summary->neg_sum_double(), i);
     }
     if (approx_bounds_) {
       Summary approx_bounds_summary;
       approx_bounds_summary.mutable_data()->PackFrom(
-          bs_summary.bounds_summary());
+          bs_summary->bounds_summary());
       RETURN_IF_ERROR(approx_bounds_->Merge(approx_bounds_summary));
     }
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_sum = dynamic_cast<BoundedSum<T>*>(&other);
+    if (other_sum == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if ((approx_bounds_ == nullptr) != (other_sum->approx_bounds_ == nullptr) ||
+        pos_sum_.size() != other_sum->pos_sum_.size() ||
+        neg_sum_.size() != other_sum->neg_sum_.size()) {
+      return absl::InternalError(
+          "Merged BoundedSum must have the same amount of partial sum "
+          "values as this BoundedSum.");
+    }
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(approx_bounds_->MergeFrom(*other_sum->approx_bounds_));
+      other_sum->FlushPartialSums();
+    }
+    if (exact_sum_ && other_sum->exact_sum_) {
+      exact_sum_->Merge(*other_sum->exact_sum_);
+    } else if (exact_sum_) {
+      exact_sum_->Add(other_sum->sum_);
+    } else {
+      sum_ += other_sum->CurrentSum();
+    }
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += other_sum->pos_sum_[i];
+    }
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += other_sum->neg_sum_[i];
+    }
+    return absl::OkStatus();
+  }
+
   double GetEpsilon() const override {
     if (approx_bounds_) {
       return approx_bounds_->GetEpsilon() + Algorithm<T>::GetEpsilon();
@@ -208,29 +486,71 @@ class BoundedSum : public Algorithm<T> {
   // specified explicitly, this will be the total epsilon used by the algorithm.
   double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
 
+  // Same as PartialResult(privacy_budget, noise_interval_level), but uses the
+  // bounds of a result of another ApproxBounds with the same bins instead of
+  // running the ApproxBounds of this sum, which then only provides the bins of
+  // the partial sums. This allows one noisy result of an ApproxBounds to be
+  // shared by several algorithms over the same column. The whole privacy
+  // budget is spent on the sum, and the caller accounts for the epsilon of the
+  // shared ApproxBounds once; the bounding epsilon of this sum is not used.
+  base::StatusOr<Output> PartialResultWithBounds(
+      const Output& bounds, double privacy_budget,
+      double noise_interval_level = kDefaultConfidenceLevel) {
+    if (!approx_bounds_) {
+      return absl::FailedPreconditionError(
+          "Shared bounds require automatically determined bounds.");
+    }
+    ASSIGN_OR_RETURN(const auto shared_bounds,
+                     approx_bounds_->BoundsFromOutput(bounds));
+    ASSIGN_OR_RETURN(const double budget,
+                     Algorithm<T>::ConsumeResultBudget(privacy_budget));
+    Output output;
+    absl::optional<ConfidenceInterval> interval;
+    ASSIGN_OR_RETURN(T sum, NoisySum(budget, noise_interval_level, &interval,
+                                     output.mutable_error_report()
+                                         ->mutable_bounding_report(),
+                                     &shared_bounds));
+    if (interval.has_value()) {
+      *(output.mutable_error_report()->mutable_noise_confidence_interval()) =
+          interval.value();
+    }
+    AddToOutput<T>(&output, sum);
+    return output;
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedSum<T>) +
-                   sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity());
+                   sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
+                   lazy_pos_sum_.MemoryUsed() + lazy_neg_sum_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
     if (mechanism_) {
       memory += mechanism_->MemoryUsed();
     }
-    if (mechanism_builder_) {
+    if (exact_sum_) {
+      memory += sizeof(ExactSum);
+    }
+    // Mechanism builders shared with other instances are not counted.
+    if (mechanism_builder_ && mechanism_builder_.use_count() == 1) {
       memory += sizeof(*mechanism_builder_);
     }
     return memory;
   }
 
  protected:
-  // Protected constructor to allow for testing.
+  // Protected constructor to allow for testing. If mechanism is nullptr, it is
+  // built from mechanism_builder when it is first needed.
   BoundedSum(double epsilon, T lower, T upper, const double l0_sensitivity,
              const double max_contributions_per_partition,
-             std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+             std::shared_ptr<const NumericalMechanismBuilder> mechanism_builder,
              std::unique_ptr<NumericalMechanism> mechanism,
-             std::unique_ptr<ApproxBounds<T>> approx_bounds = nullptr)
+             std::unique_ptr<ApproxBounds<T>> approx_bounds = nullptr,
+             std::pmr::memory_resource* memory_resource =
+                 std::pmr::get_default_resource())
       : Algorithm<T>(epsilon),
+        pos_sum_(memory_resource),
+        neg_sum_(memory_resource),
         lower_(lower),
         upper_(upper),
         mechanism_builder_(std::move(mechanism_builder)),
@@ -240,89 +560,55 @@ class BoundedSum : public Algorithm<T> {
         approx_bounds_(std::move(approx_bounds)) {
     // If automatically determining bounds, we need partial values for each bin
     // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
-    // store one already-clamped value.
+    // store one already-clamped value in sum_.
     if (approx_bounds_) {
       pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
       neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
-    } else {
-      pos_sum_.push_back(0);
+      lazy_pos_sum_.Resize(approx_bounds_->NumPositiveBins());
+      lazy_neg_sum_.Resize(approx_bounds_->NumPositiveBins());
     }
   }
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
-    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
-                                       absl::StatusCode::kFailedPrecondition));
-
     Output output;
-    double sum = 0;
-    double remaining_budget = privacy_budget;
-
-    if (approx_bounds_) {
-      // Use a fraction of the privacy budget to find the approximate bounds.
-      double bounds_budget = privacy_budget / 2;
-      remaining_budget -= bounds_budget;
-      ASSIGN_OR_RETURN(Output bounds, approx_bounds_->PartialResult(
-                                          bounds_budget, noise_interval_level));
-      T lower = GetValue<T>(bounds.elements(0).value());
-      T upper = GetValue<T>(bounds.elements(1).value());
-      RETURN_IF_ERROR(Builder::CheckLowerBound(lower));
-
-      // Since sensitivity is determined only by the larger-magnitude bound,
-      // set the smaller-magnitude bound to be the negative of the larger. This
-      // minimizes clamping and so maximizes accuracy.
-      lower_ = std::min(lower, -1 * upper);
-      upper_ = std::max(upper, -1 * lower);
-
-      // To find the sum, pass the identity function as the transform. We pass
-      // count = 0 because the count should never be used.
-      sum = approx_bounds_->template ComputeFromPartials<T>(
-          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_, 0);
-
-      // Populate the bounding report with ApproxBounds information.
-      *(output.mutable_error_report()->mutable_bounding_report()) =
-          approx_bounds_->GetBoundingReport(lower_, upper_);
-
-      // Clear the mechanism. The sensitivity might have changed.
-      mechanism_.reset();
-    } else {
-      // Manual bounds were set and clamping was done upon adding entries.
-      sum = pos_sum_[0];
-    }
-
-    // Construct mechanism if needed. Mechanism is already constructed if
-    // NoiseConfidenceInterval() was called with manual bounds.
-    if (!mechanism_) {
-      ASSIGN_OR_RETURN(
-          mechanism_,
-          BuildMechanism(mechanism_builder_->Clone(),
-                         Algorithm<T>::GetEpsilon(), l0_sensitivity_,
-                         max_contributions_per_partition_, lower_, upper_));
-    }
-
-    // Add noise confidence interval to the error report.
-    base::StatusOr<ConfidenceInterval> interval =
-        NoiseConfidenceIntervalImpl(noise_interval_level, remaining_budget);
-    if (interval.ok()) {
+    absl::optional<ConfidenceInterval> interval;
+    ASSIGN_OR_RETURN(
+        T sum, NoisySum(privacy_budget, noise_interval_level, &interval,
+                        approx_bounds_
+                            ? output.mutable_error_report()
+                                  ->mutable_bounding_report()
+                            : nullptr));
+    if (interval.has_value()) {
       *(output.mutable_error_report()->mutable_noise_confidence_interval()) =
           interval.value();
     }
+    AddToOutput<T>(&output, sum);
+    return output;
+  }
 
-    // Add noise to sum. Use the remaining privacy budget.
-    double noisy_sum = mechanism_->AddNoise(sum, remaining_budget);
-    if (std::is_integral<T>::value) {
-      T value;
-      SafeCastFromDouble<T>(std::round(noisy_sum), value);
-      AddToOutput<T>(&output, value);
-    } else {
-      AddToOutput<T>(&output, noisy_sum);
+  base::StatusOr<ResultValue> GenerateResultValue(
+      double privacy_budget, double noise_interval_level) override {
+    absl::optional<ConfidenceInterval> interval;
+    ResultValue result;
+    ASSIGN_OR_RETURN(result.value,
+                     NoisySum(privacy_budget, noise_interval_level, &interval,
+                              /*bounding_report=*/nullptr));
+    if (interval.has_value()) {
+      result.noise_interval = ToNoiseInterval(interval.value());
     }
-    return output;
+    return result;
   }
 
   void ResetState() override {
+    sum_ = 0;
+    if (exact_sum_) {
+      exact_sum_->Clear();
+    }
     std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
+    lazy_pos_sum_.Clear();
+    lazy_neg_sum_.Clear();
     if (approx_bounds_) {
       approx_bounds_->Reset();
       mechanism_ = nullptr;
@@ -330,6 +616,62 @@ class BoundedSum : public Algorithm<T> {
   }
 
  private:
+  // Writes the partial sums, and the ApproxBounds summary if bounds are
+  // determined automatically, to bs_summary. arena is used for temporaries.
+  void SerializeToBoundedSumSummary(BoundedSumSummary* bs_summary,
+                                    google::protobuf::Arena* arena) {
+    FlushPartialSums();
+    if (!approx_bounds_) {
+      AddPackedValue(CurrentSum(), bs_summary->mutable_pos_sum_int(),
+                     bs_summary->mutable_pos_sum_double());
+    }
+    if (exact_sum_) {
+      for (int64_t digit : exact_sum_->Digits()) {
+        bs_summary->add_exact_sum(digit);
+      }
+    }
+    for (T x : pos_sum_) {
+      AddPackedValue(x, bs_summary->mutable_pos_sum_int(),
+                     bs_summary->mutable_pos_sum_double());
+    }
+    for (T x : neg_sum_) {
+      AddPackedValue(x, bs_summary->mutable_neg_sum_int(),
+                     bs_summary->mutable_neg_sum_double());
+    }
+    if (approx_bounds_) {
+      if (arena == nullptr) {
+        Summary approx_bounds_summary = approx_bounds_->Serialize();
+        approx_bounds_summary.data().UnpackTo(
+            bs_summary->mutable_bounds_summary());
+      } else {
+        approx_bounds_->SerializeToArena(arena)->data().UnpackTo(
+            bs_summary->mutable_bounds_summary());
+      }
+    }
+  }
+
+  // Keeps the sum for manually set bounds in an ExactSum instead of sum_. Only
+  // floating point sums are affected, since integral sums are exact already.
+  void EnableExactSum() {
+    if (std::is_floating_point<T>::value) {
+      exact_sum_ = absl::make_unique<ExactSum>();
+    }
+  }
+
+  // Returns the clamped sum of the entries for manually set bounds.
+  T CurrentSum() const {
+    return exact_sum_ ? static_cast<T>(exact_sum_->Value()) : sum_;
+  }
+
+  // Adds the partial sums recorded lazily since the last flush to pos_sum_ and
+  // neg_sum_.
+  void FlushPartialSums() {
+    if (approx_bounds_) {
+      approx_bounds_->FlushLazyPartialSums(&lazy_pos_sum_, &pos_sum_);
+      approx_bounds_->FlushLazyPartialSums(&lazy_neg_sum_, &neg_sum_);
+    }
+  }
+
   base::StatusOr<ConfidenceInterval> NoiseConfidenceIntervalImpl(
       double confidence_level, double privacy_budget = 1) {
     if (!mechanism_) {
@@ -341,6 +683,13 @@ class BoundedSum : public Algorithm<T> {
                                                privacy_budget);
   }
 
+  // Builds the mechanism for the current bounds.
+  base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism() const {
+    return BuildMechanism(mechanism_builder_->Clone(),
+                          Algorithm<T>::GetEpsilon(), l0_sensitivity_,
+                          max_contributions_per_partition_, lower_, upper_);
+  }
+
   static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
       std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
       const double epsilon, const double l0_sensitivity,
@@ -353,20 +702,118 @@ class BoundedSum : public Algorithm<T> {
         .Build();
   }
 
+  // Adds entries to the state for manually set bounds directly.
+  template <typename T2, typename Bounds>
+  friend class StaticBoundedSum;
+
+  // Clamped sum of the entries for manually set bounds.
+  T sum_ = 0;
+
+  // If this is not nullptr, it holds the sum for manually set bounds instead
+  // of sum_.
+  std::unique_ptr<ExactSum> exact_sum_;
+
   // Vectors of partial values stored for automatic clamping.
-  std::vector<T> pos_sum_, neg_sum_;
+  std::pmr::vector<T> pos_sum_, neg_sum_;
+
+  // Partial values added since the last call to FlushPartialSums.
+  LazyPartials<T> lazy_pos_sum_, lazy_neg_sum_;
+
+  // Returns the noisy sum, rounded for integral T, and sets *interval to the
+  // noise confidence interval if it is available. With automatically
+  // determined bounds, the bounding report is written to bounding_report if
+  // it is not nullptr, and shared_bounds are used instead of the result of
+  // approx_bounds_ if they are not nullptr.
+  base::StatusOr<T> NoisySum(double privacy_budget, double noise_interval_level,
+                             absl::optional<ConfidenceInterval>* interval,
+                             BoundingReport* bounding_report,
+                             const std::pair<T, T>* shared_bounds = nullptr) {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    double sum = 0;
+    double remaining_budget = privacy_budget;
+
+    if (approx_bounds_) {
+      T lower;
+      T upper;
+      if (shared_bounds) {
+        std::tie(lower, upper) = *shared_bounds;
+      } else {
+        // Use a fraction of the privacy budget to find the approximate bounds.
+        double bounds_budget = privacy_budget / 2;
+        remaining_budget -= bounds_budget;
+        ASSIGN_OR_RETURN(Output bounds,
+                         approx_bounds_->PartialResult(bounds_budget,
+                                                       noise_interval_level));
+        lower = GetValue<T>(bounds.elements(0).value());
+        upper = GetValue<T>(bounds.elements(1).value());
+      }
+      RETURN_IF_ERROR(Builder::CheckLowerBound(lower));
+
+      // Since sensitivity is determined only by the larger-magnitude bound,
+      // set the smaller-magnitude bound to be the negative of the larger. This
+      // minimizes clamping and so maximizes accuracy.
+      lower_ = std::min(lower, -1 * upper);
+      upper_ = std::max(upper, -1 * lower);
+
+      // To find the sum, pass the identity function as the transform. We pass
+      // count = 0 because the count should never be used.
+      FlushPartialSums();
+      sum = approx_bounds_->template ComputeFromPartials<T>(
+          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_, 0);
+
+      // Populate the bounding report with ApproxBounds information. The
+      // noisy bins of shared bounds belong to another ApproxBounds.
+      if (bounding_report && shared_bounds) {
+        SetValue<T>(bounding_report->mutable_lower_bound(), lower_);
+        SetValue<T>(bounding_report->mutable_upper_bound(), upper_);
+      } else if (bounding_report) {
+        *bounding_report = approx_bounds_->GetBoundingReport(lower_, upper_);
+      }
+
+      // Clear the mechanism. The sensitivity might have changed.
+      mechanism_.reset();
+    } else {
+      // Manual bounds were set and clamping was done upon adding entries.
+      sum = CurrentSum();
+    }
+
+    // Construct mechanism if needed. Mechanism is already constructed if
+    // NoiseConfidenceInterval() was called with manual bounds.
+    if (!mechanism_) {
+      ASSIGN_OR_RETURN(mechanism_, BuildMechanism());
+    }
+
+    base::StatusOr<ConfidenceInterval> noise_interval =
+        NoiseConfidenceIntervalImpl(noise_interval_level, remaining_budget);
+    if (noise_interval.ok()) {
+      *interval = noise_interval.value();
+    }
+
+    // Add noise to sum. Use the remaining privacy budget.
+    double noisy_sum = mechanism_->AddNoise(sum, remaining_budget);
+    if (std::is_integral<T>::value) {
+      T value;
+      SafeCastFromDouble<T>(std::round(noisy_sum), value);
+      return value;
+    }
+    return static_cast<T>(noisy_sum);
+  }
 
   // If manually set, these values are determined upon construction. Otherwise,
-  // they are found in GenerateResult().
+  // they are found in NoisySum().
   T lower_, upper_;
 
-  // Used to construct mechanism once bounds are obtained for auto-bounding.
-  std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
+  // Used to construct mechanism once bounds are obtained for auto-bounding, and
+  // lazily for compact state and new instances. Mechanism builders are never
+  // modified after construction, so they can be shared between instances.
+  std::shared_ptr<const NumericalMechanismBuilder> mechanism_builder_;
   const double l0_sensitivity_;
   const int max_contributions_per_partition_;
 
   // Will be available upon BoundedSum for manual bounding, and constructed upon
-  // GenerateResult for auto-bounding.
+  // NoisySum for auto-bounding and compact state.
   std::unique_ptr<NumericalMechanism> mechanism_;
 
   // If this is not nullptr, we are automatically determining bounds. Otherwise,
@@ -16,6 +16,8 @@
 
 #include "algorithms/bounded-sum.h"
 
+#include <memory_resource>
+
 #include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -289,6 +291,33 @@ TYPED_TEST(BoundedSumTest, SerializeMergeTest) {
   EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
 }
 
+TYPED_TEST(BoundedSumTest, MergeAcceptsValueTypePartialSums) {
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(2);
+
+  // Summaries are written with packed partial sums...
+  BoundedSumSummary packed;
+  ASSERT_TRUE((*bs)->Serialize().data().UnpackTo(&packed));
+  EXPECT_EQ(packed.pos_sum_size(), 0);
+  EXPECT_EQ(packed.pos_sum_int_size() + packed.pos_sum_double_size(), 1);
+
+  // ...but summaries with ValueType partial sums can still be merged.
+  BoundedSumSummary legacy;
+  SetValue<TypeParam>(legacy.add_pos_sum(), 5);
+  Summary summary;
+  summary.mutable_data()->PackFrom(legacy);
+  EXPECT_OK((*bs)->Merge(summary));
+  auto result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 7);
+}
+
 TYPED_TEST(BoundedSumTest, SerializeMergePartialSumsTest) {
   typename ApproxBounds<TypeParam>::Builder bounds_builder;
   typename BoundedSum<TypeParam>::Builder builder;
@@ -327,6 +356,99 @@ TYPED_TEST(BoundedSumTest, SerializeMergePartialSumsTest) {
   EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
 }
 
+TEST(BoundedSumTest, AddEntriesSpanMatchesAddEntryManualBounds) {
+  std::vector<double> a = {-2, 1.5, NAN, 3, 6, 0.25};
+  BoundedSum<double>::Builder builder;
+  builder.SetLower(-1).SetUpper(4).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto algorithm1 = builder.Build();
+  ASSERT_OK(algorithm1);
+  auto algorithm2 = builder.Build();
+  ASSERT_OK(algorithm2);
+
+  for (double v : a) {
+    (*algorithm1)->AddEntry(v);
+  }
+  (*algorithm2)->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT((*algorithm2)->Serialize(),
+              EqualsProto((*algorithm1)->Serialize()));
+}
+
+TEST(BoundedSumTest, AddEntriesSpanMatchesAddEntryApproxBounds) {
+  std::vector<double> a = {-10, 4, NAN, 6, 0, -0.5, 100};
+  std::unique_ptr<BoundedSum<double>> algorithms[2];
+  for (auto& algorithm : algorithms) {
+    auto bounds =
+        ApproxBounds<double>::Builder()
+            .SetThreshold(1)
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .Build();
+    ASSERT_OK(bounds);
+    auto built =
+        BoundedSum<double>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetApproxBounds(std::move(*bounds))
+            .Build();
+    ASSERT_OK(built);
+    algorithm = std::move(*built);
+  }
+
+  for (double v : a) {
+    algorithms[0]->AddEntry(v);
+  }
+  algorithms[1]->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT(algorithms[1]->Serialize(),
+              EqualsProto(algorithms[0]->Serialize()));
+}
+
+TEST(BoundedSumTest, AddClampedEntriesMatchesSequentialSum) {
+  std::vector<int64_t> ints;
+  std::vector<double> doubles;
+  for (int i = 0; i < 1003; ++i) {
+    ints.push_back((i * 7919) % 201 - 100);
+    doubles.push_back(((i * 7919) % 2001 - 1000) / 8.0);
+  }
+  doubles[17] = NAN;
+
+  int64_t int_sum = 5;
+  double double_sum = 5;
+  for (int64_t v : ints) {
+    int_sum += Clamp<int64_t>(-50, 60, v);
+  }
+  for (double v : doubles) {
+    if (!std::isnan(v)) {
+      double_sum += Clamp<double>(-50, 60, v);
+    }
+  }
+
+  EXPECT_EQ(internal::AddClampedEntries<int64_t>(5, ints, -50, 60), int_sum);
+  EXPECT_DOUBLE_EQ(internal::AddClampedEntries<double>(5, doubles, -50, 60),
+                   double_sum);
+}
+
+TEST(BoundedSumTest, OverflowAddEntriesManualBounds) {
+  std::vector<int64_t> a(16, 1);
+  a[0] = std::numeric_limits<int64_t>::max();
+  a[8] = std::numeric_limits<int64_t>::max();
+  auto bs =
+      BoundedSum<int64_t>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLower(0)
+          .SetUpper(std::numeric_limits<int64_t>::max())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntries(absl::MakeConstSpan(a));
+
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  // As with AddEntry, overflowing wraps the running sum around.
+  EXPECT_EQ(GetValue<int64_t>(result.value()), 12);
+}
+
 TEST(BoundedSumTest, OverflowAddEntryManualBounds) {
   typename BoundedSum<int64_t>::Builder builder;
 
@@ -680,6 +802,234 @@ TYPED_TEST(BoundedSumTest, Memory) {
   EXPECT_GE((*bs_big)->MemoryUsed(), (*bs_small)->MemoryUsed());
 }
 
+TYPED_TEST(BoundedSumTest, CompactStateMatchesDefaultState) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetEpsilon(1.0)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto bs = builder.Build();
+  ASSERT_OK(bs);
+  auto compact = builder.SetCompactState(true).Build();
+  ASSERT_OK(compact);
+  for (auto* algorithm : {bs->get(), compact->get()}) {
+    algorithm->AddEntries(std::vector<TypeParam>{1, 2, 20, -4});
+  }
+
+  EXPECT_THAT((*compact)->Serialize(), EqualsProto((*bs)->Serialize()));
+  EXPECT_OK((*bs)->Merge((*compact)->Serialize()));
+  EXPECT_OK((*compact)->Merge((*bs)->Serialize()));
+  auto output = (*compact)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 39);
+}
+
+TYPED_TEST(BoundedSumTest, CompactStateBuildsMechanismLazily) {
+  auto bs = typename BoundedSum<TypeParam>::Builder()
+                .SetEpsilon(1.0)
+                .SetLower(0)
+                .SetUpper(10)
+                .Build();
+  ASSERT_OK(bs);
+  auto compact = typename BoundedSum<TypeParam>::Builder()
+                     .SetEpsilon(1.0)
+                     .SetLower(0)
+                     .SetUpper(10)
+                     .SetCompactState(true)
+                     .Build();
+  ASSERT_OK(compact);
+  EXPECT_LT((*compact)->MemoryUsed(), (*bs)->MemoryUsed());
+
+  // The mechanism is built when it is first needed.
+  EXPECT_OK((*compact)->NoiseConfidenceInterval(0.95));
+  (*compact)->AddEntry(1);
+  EXPECT_OK((*compact)->PartialResult());
+}
+
+TYPED_TEST(BoundedSumTest, CompactStateSharesMechanismBuilder) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetEpsilon(1.0).SetLower(0).SetUpper(10).SetCompactState(true);
+  std::vector<std::unique_ptr<BoundedSum<TypeParam>>> sums;
+  for (int i = 0; i < 3; ++i) {
+    auto bs = builder.Build();
+    ASSERT_OK(bs);
+    (*bs)->AddEntry(i);
+    sums.push_back(std::move(*bs));
+  }
+
+  // Changing a parameter configures a new mechanism builder.
+  auto zero_noise =
+      builder
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(zero_noise);
+  (*zero_noise)->AddEntry(7);
+  auto output = (*zero_noise)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 7);
+  for (auto& bs : sums) {
+    EXPECT_OK(bs->PartialResult());
+  }
+}
+
+TYPED_TEST(BoundedSumTest, SerializeToArenaMatchesSerialize) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedSum<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0).SetLaplaceMechanism(
+        absl::make_unique<ZeroNoiseMechanism::Builder>());
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto bs = builder.Build();
+    ASSERT_OK(bs);
+    (*bs)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+
+    google::protobuf::Arena arena;
+    Summary* summary = (*bs)->SerializeToArena(&arena);
+    EXPECT_EQ(summary->GetArena(), &arena);
+    EXPECT_THAT(*summary, EqualsProto((*bs)->Serialize()));
+
+    // Merging a summary allocated on an arena.
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    EXPECT_OK((*merged)->Merge(*summary));
+    EXPECT_THAT((*merged)->Serialize(), EqualsProto((*bs)->Serialize()));
+
+    std::unique_ptr<Summary> owned((*bs)->SerializeToArena(nullptr));
+    EXPECT_THAT(*owned, EqualsProto((*bs)->Serialize()));
+  }
+}
+
+// Memory resource that counts the bytes allocated through it.
+class CountingMemoryResource : public std::pmr::memory_resource {
+ public:
+  int64_t bytes_allocated() const { return bytes_allocated_; }
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    bytes_allocated_ += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  int64_t bytes_allocated_ = 0;
+};
+
+TYPED_TEST(BoundedSumTest, AllocatesPartialSumsFromMemoryResource) {
+  CountingMemoryResource resource;
+  auto bs = typename BoundedSum<TypeParam>::Builder()
+                .SetEpsilon(1.0)
+                .SetMemoryResource(&resource)
+                .Build();
+  ASSERT_OK(bs);
+  EXPECT_GE(resource.bytes_allocated(), 2 * sizeof(TypeParam));
+  (*bs)->AddEntry(1);
+  BoundedSumSummary summary;
+  ASSERT_TRUE((*bs)->Serialize().data().UnpackTo(&summary));
+  EXPECT_EQ(summary.pos_sum_int_size() + summary.pos_sum_double_size(),
+            summary.neg_sum_int_size() + summary.neg_sum_double_size());
+}
+
+TYPED_TEST(BoundedSumTest, MergeFromMatchesMerge) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedSum<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto source = builder.Build();
+    ASSERT_OK(source);
+    (*source)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    (*merged)->AddEntry(5);
+    auto merged_from = builder.Build();
+    ASSERT_OK(merged_from);
+    (*merged_from)->AddEntry(5);
+
+    EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+    EXPECT_OK((*merged_from)->MergeFrom(**source));
+    EXPECT_THAT((*merged_from)->Serialize(),
+                EqualsProto((*merged)->Serialize()));
+  }
+
+  auto manual = typename BoundedSum<TypeParam>::Builder()
+                    .SetEpsilon(1.0)
+                    .SetLower(0)
+                    .SetUpper(10)
+                    .Build();
+  ASSERT_OK(manual);
+  auto automatic =
+      typename BoundedSum<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(automatic);
+  EXPECT_THAT((*manual)->MergeFrom(**automatic),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same amount of partial sum values")));
+}
+
+TYPED_TEST(BoundedSumTest, NewInstance) {
+  auto bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(3);
+  ASSERT_OK((*bs)->PartialResult());
+
+  // The new instance has the same parameters, but no entries and the full
+  // privacy budget.
+  auto instance = (*bs)->NewInstance();
+  ASSERT_OK(instance);
+  EXPECT_EQ((*instance)->GetEpsilon(), (*bs)->GetEpsilon());
+  (*instance)->AddEntries(std::vector<TypeParam>{1, 20});
+  auto output = (*instance)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 11);
+
+  auto another = (*instance)->NewInstance();
+  ASSERT_OK(another);
+  EXPECT_OK((*another)->Merge((*instance)->Serialize()));
+  output = (*another)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<TypeParam>(*output), 11);
+}
+
+TYPED_TEST(BoundedSumTest, NewInstanceRequiresManualBounds) {
+  auto bs = typename BoundedSum<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(bs);
+  EXPECT_THAT((*bs)->NewInstance(),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("requires manually set bounds")));
+}
+
+TYPED_TEST(BoundedSumTest, CompactStateRequiresManualBounds) {
+  EXPECT_THAT(typename BoundedSum<TypeParam>::Builder()
+                  .SetEpsilon(1.0)
+                  .SetCompactState(true)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("requires manually set bounds")));
+  EXPECT_THAT(BoundedSum<double>::Builder()
+                  .SetEpsilon(1.0)
+                  .SetLower(std::numeric_limits<double>::lowest() + 1)
+                  .SetUpper(std::numeric_limits<double>::max())
+                  .SetCompactState(true)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Sensitivity is too high")));
+}
+
 TYPED_TEST(BoundedSumTest, SplitsEpsilonWithAutomaticBounds) {
   double epsilon = 1.0;
 
@@ -697,5 +1047,375 @@ TYPED_TEST(BoundedSumTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT((*bs)->GetAggregationEpsilon(), epsilon);
 }
 
+TYPED_TEST(BoundedSumTest, AddEntryWithCountMatchesAddEntry) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedSum<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(-5).SetUpper(10);
+    }
+    auto with_count = builder.Build();
+    ASSERT_OK(with_count);
+    auto one_by_one = builder.Build();
+    ASSERT_OK(one_by_one);
+    for (const std::pair<TypeParam, uint64_t>& entry :
+         std::vector<std::pair<TypeParam, uint64_t>>{
+             {3, 5}, {-2, 4}, {30, 2}, {7, 0}}) {
+      (*with_count)->AddEntryWithCount(entry.first, entry.second);
+      for (uint64_t i = 0; i < entry.second; ++i) {
+        (*one_by_one)->AddEntry(entry.first);
+      }
+    }
+    EXPECT_THAT((*with_count)->Serialize(),
+                EqualsProto((*one_by_one)->Serialize()));
+  }
+}
+
+
+base::StatusOr<std::unique_ptr<BoundedSum<double>>> MakeExactSum() {
+  return BoundedSum<double>::Builder()
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .SetEpsilon(1.0)
+      .SetLower(-1e10)
+      .SetUpper(1e10)
+      .SetExactSum(true)
+      .Build();
+}
+
+TEST(BoundedSumTest, ExactSumDoesNotDependOnOrder) {
+  std::vector<double> entries;
+  for (int i = 0; i < 1000; ++i) {
+    entries.push_back((i % 2 == 0 ? 1 : -1) * 0.1 * std::pow(7, i % 23) +
+                      1e-3 * i);
+  }
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> forward = MakeExactSum();
+  ASSERT_OK(forward);
+  for (double entry : entries) {
+    (*forward)->AddEntry(entry);
+  }
+  // Add the entries in reverse to shards that are merged.
+  std::vector<std::unique_ptr<BoundedSum<double>>> shards;
+  for (int i = 0; i < 3; ++i) {
+    base::StatusOr<std::unique_ptr<BoundedSum<double>>> shard = MakeExactSum();
+    ASSERT_OK(shard);
+    shards.push_back(std::move(shard.value()));
+  }
+  for (int i = entries.size() - 1; i >= 0; --i) {
+    shards[i % 3]->AddEntry(entries[i]);
+  }
+  ASSERT_OK(shards[2]->Merge(shards[0]->Serialize()));
+  ASSERT_OK(shards[1]->MergeFrom(*shards[2]));
+  EXPECT_THAT(shards[1]->Serialize(), EqualsProto((*forward)->Serialize()));
+
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> batched = MakeExactSum();
+  ASSERT_OK(batched);
+  (*batched)->AddEntries(entries);
+  EXPECT_THAT((*batched)->Serialize(), EqualsProto((*forward)->Serialize()));
+}
+
+TEST(BoundedSumTest, ExactSumIsCorrectlyRounded) {
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> bs = MakeExactSum();
+  ASSERT_OK(bs);
+  for (int i = 0; i < 10; ++i) {
+    (*bs)->AddEntry(0.1);
+  }
+  (*bs)->AddEntryWithCount(1e10, 3);
+  (*bs)->AddEntry(-1e10);
+  (*bs)->AddEntry(-1e10);
+  // Clamped to -1e10.
+  (*bs)->AddEntry(-5e10);
+  (*bs)->AddEntry(std::numeric_limits<double>::quiet_NaN());
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<double>(*result), 1.0);
+}
+
+TEST(BoundedSumTest, ExactSumMergesWithInexactSums) {
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> exact = MakeExactSum();
+  ASSERT_OK(exact);
+  base::StatusOr<std::unique_ptr<Algorithm<double>>> inexact =
+      BoundedSum<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(-1e10)
+          .SetUpper(1e10)
+          .Build();
+  ASSERT_OK(inexact);
+  (*exact)->AddEntry(2.5);
+  (*inexact)->AddEntry(1.5);
+  ASSERT_OK((*exact)->Merge((*inexact)->Serialize()));
+  ASSERT_OK((*inexact)->Merge((*exact)->Serialize()));
+
+  base::StatusOr<Output> exact_result = (*exact)->PartialResult();
+  ASSERT_OK(exact_result);
+  EXPECT_EQ(GetValue<double>(*exact_result), 4.0);
+  base::StatusOr<Output> inexact_result = (*inexact)->PartialResult();
+  ASSERT_OK(inexact_result);
+  EXPECT_EQ(GetValue<double>(*inexact_result), 5.5);
+}
+
+TEST(BoundedSumTest, ExactSumRequiresManualBounds) {
+  EXPECT_THAT(BoundedSum<double>::Builder()
+                  .SetEpsilon(1.0)
+                  .SetExactSum(true)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Exact sum requires manually set bounds")));
+}
+
+TEST(BoundedSumTest, ExactSumNewInstanceAndReset) {
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> bs = MakeExactSum();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(3);
+  base::StatusOr<std::unique_ptr<Algorithm<double>>> instance =
+      (*bs)->NewInstance();
+  ASSERT_OK(instance);
+  (*instance)->AddEntry(0.25);
+  ASSERT_OK((*bs)->Merge((*instance)->Serialize()));
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<double>(*result), 3.25);
+
+  (*bs)->Reset();
+  (*bs)->AddEntry(1);
+  result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<double>(*result), 1);
+}
+
+
+TYPED_TEST(BoundedSumTest, LazyMechanismIsBuiltOnFirstResult) {
+  base::StatusOr<std::unique_ptr<BoundedSum<TypeParam>>> failing =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(failing);
+  EXPECT_THAT((*failing)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+
+  base::StatusOr<std::unique_ptr<BoundedSum<TypeParam>>> bs =
+      typename BoundedSum<TypeParam>::Builder()
+          .SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bs);
+  (*bs)->AddEntry(4);
+  (*bs)->AddEntry(20);
+  base::StatusOr<Output> result = (*bs)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<TypeParam>(*result), 14);
+}
+
+
+TEST(BoundedSumTest, LazyMechanismAppliesToDefaultApproxBounds) {
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> bs =
+      BoundedSum<double>::Builder()
+          .SetEpsilon(1.0)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bs);
+  EXPECT_THAT((*bs)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+}
+
+TEST(BoundedSumTest, RemoveEntryWithCountUndoesAdd) {
+  base::StatusOr<std::unique_ptr<BoundedSum<int64_t>>> int_sum =
+      BoundedSum<int64_t>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetEpsilon(1.0)
+          .SetLower(-10)
+          .SetUpper(10)
+          .Build();
+  ASSERT_OK(int_sum);
+  (*int_sum)->AddEntryWithCount(4, 3);
+  (*int_sum)->AddEntry(20);
+  EXPECT_OK((*int_sum)->RemoveEntryWithCount(4, 2));
+  EXPECT_OK((*int_sum)->RemoveEntryWithCount(20, 1));
+  base::StatusOr<Output> int_result = (*int_sum)->PartialResult();
+  ASSERT_OK(int_result);
+  EXPECT_EQ(GetValue<int64_t>(*int_result), 4);
+
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> exact = MakeExactSum();
+  ASSERT_OK(exact);
+  (*exact)->AddEntry(0.1);
+  (*exact)->AddEntry(1e9);
+  (*exact)->AddEntry(0.2);
+  EXPECT_OK((*exact)->RemoveEntryWithCount(1e9, 1));
+  base::StatusOr<Output> exact_result = (*exact)->PartialResult();
+  ASSERT_OK(exact_result);
+  EXPECT_EQ(GetValue<double>(*exact_result), 0.30000000000000004);
+}
+
+TEST(BoundedSumTest, RemoveEntryWithCountRequiresExactBoundedSum) {
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> inexact =
+      BoundedSum<double>::Builder().SetLower(0).SetUpper(10).Build();
+  ASSERT_OK(inexact);
+  EXPECT_THAT((*inexact)->RemoveEntryWithCount(1, 1),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("requires an exact sum")));
+
+  base::StatusOr<std::unique_ptr<BoundedSum<int64_t>>> auto_bounds =
+      BoundedSum<int64_t>::Builder().Build();
+  ASSERT_OK(auto_bounds);
+  EXPECT_THAT((*auto_bounds)->RemoveEntryWithCount(1, 1),
+              StatusIs(absl::StatusCode::kUnimplemented,
+                       HasSubstr("manually set bounds")));
+}
+
+TYPED_TEST(BoundedSumTest, PartialResultValueMatchesPartialResult) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 20};
+  std::unique_ptr<BoundedSum<TypeParam>> sums[2];
+  for (auto& sum : sums) {
+    auto built =
+        typename BoundedSum<TypeParam>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetEpsilon(1.0)
+            .SetLower(0)
+            .SetUpper(10)
+            .Build();
+    ASSERT_OK(built);
+    sum = std::move(*built);
+    sum->AddEntries(a.begin(), a.end());
+  }
+  auto output = sums[0]->PartialResult();
+  ASSERT_OK(output);
+  auto value = sums[1]->PartialResultValue();
+  ASSERT_OK(value);
+  EXPECT_EQ(value->value, GetValue<TypeParam>(*output));
+  ASSERT_TRUE(value->noise_interval.has_value());
+  EXPECT_EQ(value->noise_interval->upper_bound,
+            output->error_report().noise_confidence_interval().upper_bound());
+}
+
+TEST(BoundedSumTest, PartialResultValueApproxBounds) {
+  std::vector<double> a = {-10, 4, 6, 0, -0.5, 100};
+  std::unique_ptr<BoundedSum<double>> sums[2];
+  for (auto& sum : sums) {
+    auto bounds =
+        ApproxBounds<double>::Builder()
+            .SetThreshold(1)
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .Build();
+    ASSERT_OK(bounds);
+    auto built =
+        BoundedSum<double>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetApproxBounds(std::move(*bounds))
+            .Build();
+    ASSERT_OK(built);
+    sum = std::move(*built);
+    sum->AddEntries(a.begin(), a.end());
+  }
+  auto output = sums[0]->PartialResult();
+  ASSERT_OK(output);
+  ASSERT_TRUE(output->error_report().has_bounding_report());
+  auto value = sums[1]->PartialResultValue();
+  ASSERT_OK(value);
+  EXPECT_EQ(value->value, GetValue<double>(*output));
+}
+
+std::unique_ptr<ApproxBounds<double>> MakeExactApproxBounds() {
+  return ApproxBounds<double>::Builder()
+      .SetEpsilon(1)
+      .SetNumBins(5)
+      .SetBase(2)
+      .SetScale(1)
+      .SetThreshold(2)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(BoundedSumTest, PartialResultWithSharedBounds) {
+  std::vector<double> a = {-9, 2, 2, 4, 6, 6};
+  std::unique_ptr<ApproxBounds<double>> shared_bounds =
+      MakeExactApproxBounds();
+  shared_bounds->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> bounds = shared_bounds->PartialResult();
+  ASSERT_OK(bounds);
+
+  std::unique_ptr<BoundedSum<double>> bs =
+      BoundedSum<double>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(MakeExactApproxBounds())
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  bs->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> output = bs->PartialResultWithBounds(*bounds, 1);
+  ASSERT_OK(output);
+
+  // The bounds [1, 8] are widened to [-8, 8], so -9 gets clamped to -8.
+  BoundingReport expected_report;
+  SetValue<double>(expected_report.mutable_lower_bound(), -8);
+  SetValue<double>(expected_report.mutable_upper_bound(), 8);
+  EXPECT_EQ(GetValue<double>(output->elements(0).value()), 12);
+  EXPECT_THAT(output->error_report().bounding_report(),
+              EqualsProto(expected_report));
+  EXPECT_EQ(bs->RemainingPrivacyBudget(), 0);
+}
+
+TEST(BoundedSumTest, PartialResultWithSharedBoundsValidatesBounds) {
+  std::unique_ptr<BoundedSum<double>> bs =
+      BoundedSum<double>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(MakeExactApproxBounds())
+          .Build()
+          .ValueOrDie();
+  Output not_bin_boundaries;
+  AddToOutput<double>(&not_bin_boundaries, 1.5);
+  AddToOutput<double>(&not_bin_boundaries, 8);
+  EXPECT_THAT(bs->PartialResultWithBounds(not_bin_boundaries, 1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("bin boundaries")));
+  EXPECT_THAT(bs->PartialResultWithBounds(Output(), 1),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("two elements")));
+  // Failed validation does not consume the budget.
+  EXPECT_EQ(bs->RemainingPrivacyBudget(), 1);
+
+  std::unique_ptr<BoundedSum<double>> manual = BoundedSum<double>::Builder()
+                                                   .SetEpsilon(1)
+                                                   .SetLower(0)
+                                                   .SetUpper(1)
+                                                   .Build()
+                                                   .ValueOrDie();
+  EXPECT_THAT(manual->PartialResultWithBounds(Output(), 1),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(BoundedSumTest, RvalueBuildClonesMechanismBuilderOnce) {
+  int clones = 0;
+  typename BoundedSum<double>::Builder builder;
+  builder.SetEpsilon(1.0).SetLaplaceMechanism(
+      absl::make_unique<test_utils::CloneCountingMechanismBuilder>(&clones));
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> copied = builder.Build();
+  ASSERT_OK(copied);
+  EXPECT_EQ(clones, 2);
+
+  // The approximate bounds still need their own mechanism builder.
+  clones = 0;
+  base::StatusOr<std::unique_ptr<BoundedSum<double>>> moved =
+      std::move(builder).Build();
+  ASSERT_OK(moved);
+  EXPECT_EQ(clones, 1);
+
+  std::vector<double> entries = {-10, 4, 6, 0, -0.5, 100};
+  (*copied)->AddEntries(entries.begin(), entries.end());
+  (*moved)->AddEntries(entries.begin(), entries.end());
+  EXPECT_THAT((*moved)->Serialize(), EqualsProto((*copied)->Serialize()));
+}
+
 }  //  namespace
 }  // namespace differential_privacy
@@ -17,21 +17,41 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_VARIANCE_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_VARIANCE_H_
 
+#include <cstdint>
 #include <limits>
+#include <tuple>
 #include <type_traits>
+#include <utility>
 
 #include "google/protobuf/any.pb.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
 #include "algorithms/bounded-algorithm.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 
 namespace differential_privacy {
+namespace internal {
+
+// Adds the entries clamped to [lower, upper] to *sum and their squares to
+// *sum_of_squares, skipping NaN entries, and returns the number of entries that
+// are not NaN. All three are accumulated in one pass, see
+// AddClampedEntriesInLanes in util.h.
+template <typename T>
+uint64_t AddClampedEntriesAndSquares(absl::Span<const T> entries, T lower,
+                                     T upper, T* sum, double* sum_of_squares) {
+  return AddClampedEntriesInLanes</*kWithSquares=*/true>(entries, lower, upper,
+                                                         sum, sum_of_squares);
+}
+
+}  // namespace internal
 
 // Incrementally provides a differentially private variance for values in the
 // range [lower..upper]. Values outside of this range will be clamped so they
@@ -103,12 +123,16 @@ class BoundedVariance : public Algorithm<T> {
       RETURN_IF_ERROR(BoundedBuilder::BoundsSetup());
 
       // If manual bounding, check bounds and construct mechanism so we can fail
-      // on build if sensitivity is inappropriate.
+      // on build if sensitivity is inappropriate, unless the mechanisms are
+      // built lazily.
+      const bool lazy_mechanism = AlgorithmBuilder::GetLazyMechanism();
       std::unique_ptr<NumericalMechanism> sum_mechanism = nullptr;
       std::unique_ptr<NumericalMechanism> sos_mechanism = nullptr;
       if (BoundedBuilder::BoundsAreSet()) {
         RETURN_IF_ERROR(CheckBounds(BoundedBuilder::GetLower().value(),
                                     BoundedBuilder::GetUpper().value()));
+      }
+      if (BoundedBuilder::BoundsAreSet() && !lazy_mechanism) {
         ASSIGN_OR_RETURN(
             sum_mechanism,
             BuildSumMechanism(
@@ -130,19 +154,19 @@ class BoundedVariance : public Algorithm<T> {
       }
 
       std::unique_ptr<NumericalMechanism> count_mechanism;
-      ASSIGN_OR_RETURN(
-          count_mechanism,
-          AlgorithmBuilder::GetMechanismBuilderClone()
-              ->SetEpsilon(BoundedBuilder::GetRemainingEpsilon().value())
-              .SetL0Sensitivity(
-                  AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1))
-              .SetLInfSensitivity(
-                  AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
-                      1))
-              .Build());
+      if (!lazy_mechanism) {
+        ASSIGN_OR_RETURN(
+            count_mechanism,
+            BuildCountMechanism(
+                AlgorithmBuilder::GetMechanismBuilderClone(),
+                BoundedBuilder::GetRemainingEpsilon().value(),
+                AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1),
+                AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(
+                    1)));
+      }
 
       // Construct bounded variance.
-      auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
+      auto mech_builder = AlgorithmBuilder::TakeMechanismBuilder();
       return absl::WrapUnique(new BoundedVariance(
           BoundedBuilder::GetRemainingEpsilon().value(),
           BoundedBuilder::GetLower().value_or(0),
@@ -155,17 +179,44 @@ class BoundedVariance : public Algorithm<T> {
     }
   };
 
-  void AddEntry(const T& t) override { AddMultipleEntries(t, 1); }
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries);
+    AddMultipleEntries(t, 1);
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries, num_of_entries);
+    AddMultipleEntries(t, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries, entries.size());
+    if (approx_bounds_) {
+      for (const T& t : entries) {
+        AddMultipleEntries(t, 1);
+      }
+      return;
+    }
+    raw_count_ += internal::AddClampedEntriesAndSquares<T>(
+        entries, lower_, upper_, &pos_sum_[0], &pos_sum_of_squares_[0]);
+  }
 
   Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
+    FlushPartials();
+
     // Create BoundedVarianceSummary.
     BoundedVarianceSummary bv_summary;
     bv_summary.set_count(raw_count_);
     for (T x : pos_sum_) {
-      SetValue(bv_summary.add_pos_sum(), x);
+      AddPackedValue(x, bv_summary.mutable_pos_sum_int(),
+                     bv_summary.mutable_pos_sum_double());
     }
     for (T x : neg_sum_) {
-      SetValue(bv_summary.add_neg_sum(), x);
+      AddPackedValue(x, bv_summary.mutable_neg_sum_int(),
+                     bv_summary.mutable_neg_sum_double());
     }
     for (double x : pos_sum_of_squares_) {
       bv_summary.add_pos_sum_of_squares(x);
@@ -182,14 +233,18 @@ class BoundedVariance : public Algorithm<T> {
     // Create Summary.
     Summary summary;
     summary.mutable_data()->PackFrom(bv_summary);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
     return summary;
   }
 
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError(
           "Cannot merge summary with no bounded variance data.");
     }
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
 
     // Unpack bounded variance summary.
     BoundedVarianceSummary bv_summary;
@@ -201,10 +256,16 @@ class BoundedVariance : public Algorithm<T> {
       return absl::InternalError(
           "Merged BoundedVariance must have the same bounding strategy.");
     }
-    if (pos_sum_.size() != bv_summary.pos_sum_size() ||
-        neg_sum_.size() != bv_summary.neg_sum_size() ||
-        pos_sum_of_squares_.size() != bv_summary.pos_sum_of_squares_size() ||
-        neg_sum_of_squares_.size() != bv_summary.neg_sum_of_squares_size()) {
+    if (pos_sum_.size() != NumPackedValues(bv_summary.pos_sum(),
+                                           bv_summary.pos_sum_int(),
+                                           bv_summary.pos_sum_double()) ||
+        neg_sum_.size() != NumPackedValues(bv_summary.neg_sum(),
+                                           bv_summary.neg_sum_int(),
+                                           bv_summary.neg_sum_double()) ||
+        pos_sum_of_squares_.size() !=
+            static_cast<size_t>(bv_summary.pos_sum_of_squares_size()) ||
+        neg_sum_of_squares_.size() !=
+            static_cast<size_t>(bv_summary.neg_sum_of_squares_size())) {
       return absl::InternalError(
           "Merged BoundedVariance must have the same amount of partial "
           "sum or sum of squares values as this BoundedVariance.");
@@ -212,12 +273,16 @@ class BoundedVariance : public Algorithm<T> {
 
     // Add count and partial values to current ones.
     raw_count_ += bv_summary.count();
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      pos_sum_[i] += GetValue<T>(bv_summary.pos_sum(i));
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += GetPackedValue<T>(bv_summary.pos_sum(),
+                                       bv_summary.pos_sum_int(),
+                                       bv_summary.pos_sum_double(), i);
       pos_sum_of_squares_[i] += bv_summary.pos_sum_of_squares(i);
     }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      neg_sum_[i] += GetValue<T>(bv_summary.neg_sum(i));
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += GetPackedValue<T>(bv_summary.neg_sum(),
+                                       bv_summary.neg_sum_int(),
+                                       bv_summary.neg_sum_double(), i);
       neg_sum_of_squares_[i] += bv_summary.neg_sum_of_squares(i);
     }
 
@@ -232,11 +297,51 @@ class BoundedVariance : public Algorithm<T> {
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_variance = dynamic_cast<BoundedVariance<T>*>(&other);
+    if (other_variance == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if ((approx_bounds_ == nullptr) !=
+        (other_variance->approx_bounds_ == nullptr)) {
+      return absl::InternalError(
+          "Merged BoundedVariance must have the same bounding strategy.");
+    }
+    if (pos_sum_.size() != other_variance->pos_sum_.size() ||
+        neg_sum_.size() != other_variance->neg_sum_.size() ||
+        pos_sum_of_squares_.size() !=
+            other_variance->pos_sum_of_squares_.size() ||
+        neg_sum_of_squares_.size() !=
+            other_variance->neg_sum_of_squares_.size()) {
+      return absl::InternalError(
+          "Merged BoundedVariance must have the same amount of partial "
+          "sum or sum of squares values as this BoundedVariance.");
+    }
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(
+          approx_bounds_->MergeFrom(*other_variance->approx_bounds_));
+      other_variance->FlushPartials();
+    }
+    raw_count_ += other_variance->raw_count_;
+    for (size_t i = 0; i < pos_sum_.size(); ++i) {
+      pos_sum_[i] += other_variance->pos_sum_[i];
+      pos_sum_of_squares_[i] += other_variance->pos_sum_of_squares_[i];
+    }
+    for (size_t i = 0; i < neg_sum_.size(); ++i) {
+      neg_sum_[i] += other_variance->neg_sum_[i];
+      neg_sum_of_squares_[i] += other_variance->neg_sum_of_squares_[i];
+    }
+    return absl::OkStatus();
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedVariance<T>) +
                    sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
                    sizeof(double) * (pos_sum_of_squares_.capacity() +
-                                     neg_sum_of_squares_.capacity());
+                                     neg_sum_of_squares_.capacity()) +
+                   lazy_pos_sum_.MemoryUsed() + lazy_neg_sum_.MemoryUsed() +
+                   lazy_pos_sum_of_squares_.MemoryUsed() +
+                   lazy_neg_sum_of_squares_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
@@ -269,6 +374,24 @@ class BoundedVariance : public Algorithm<T> {
   // specified explicitly, this will be the total epsilon used by the algorithm.
   double GetAggregationEpsilon() const { return Algorithm<T>::GetEpsilon(); }
 
+  // Same as PartialResult(privacy_budget, noise_interval_level), but uses the
+  // bounds of a result of another ApproxBounds with the same bins instead of
+  // running the ApproxBounds of this variance. See BoundedSum for details.
+  base::StatusOr<Output> PartialResultWithBounds(
+      const Output& bounds, double privacy_budget,
+      double noise_interval_level = kDefaultConfidenceLevel) {
+    if (!approx_bounds_) {
+      return absl::FailedPreconditionError(
+          "Shared bounds require automatically determined bounds.");
+    }
+    ASSIGN_OR_RETURN(const auto shared_bounds,
+                     approx_bounds_->BoundsFromOutput(bounds));
+    ASSIGN_OR_RETURN(const double budget,
+                     Algorithm<T>::ConsumeResultBudget(privacy_budget));
+    return GenerateResultWithBounds(budget, noise_interval_level,
+                                    &shared_bounds);
+  }
+
  private:
   BoundedVariance(const double epsilon, const T lower, const T upper,
                   const double l0_sensitivity,
@@ -297,6 +420,10 @@ class BoundedVariance : public Algorithm<T> {
       neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
       pos_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
       neg_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
+      lazy_pos_sum_.Resize(approx_bounds_->NumPositiveBins());
+      lazy_neg_sum_.Resize(approx_bounds_->NumPositiveBins());
+      lazy_pos_sum_of_squares_.Resize(approx_bounds_->NumPositiveBins());
+      lazy_neg_sum_of_squares_.Resize(approx_bounds_->NumPositiveBins());
     } else {
       pos_sum_.push_back(0);
       pos_sum_of_squares_.push_back(0);
@@ -305,6 +432,16 @@ class BoundedVariance : public Algorithm<T> {
 
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
+    return GenerateResultWithBounds(privacy_budget, noise_interval_level,
+                                    /*shared_bounds=*/nullptr);
+  }
+
+  // Uses shared_bounds instead of the result of approx_bounds_ if they are
+  // not nullptr, in which case the whole privacy budget is spent on the
+  // variance.
+  base::StatusOr<Output> GenerateResultWithBounds(
+      double privacy_budget, double noise_interval_level,
+      const std::pair<T, T>* shared_bounds) {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
 
@@ -316,16 +453,22 @@ class BoundedVariance : public Algorithm<T> {
     double sos = 0;  // Sum of squares.
 
     if (approx_bounds_) {
-      // Get bounds with a fraction of the privacy budget.
-      double bounds_budget = remaining_budget / 2;
-      remaining_budget -= bounds_budget;
-      ASSIGN_OR_RETURN(Output bounds, approx_bounds_->PartialResult(
-                                          bounds_budget, noise_interval_level));
-      lower_ = GetValue<T>(bounds.elements(0).value());
-      upper_ = GetValue<T>(bounds.elements(1).value());
+      if (shared_bounds) {
+        std::tie(lower_, upper_) = *shared_bounds;
+      } else {
+        // Get bounds with a fraction of the privacy budget.
+        double bounds_budget = remaining_budget / 2;
+        remaining_budget -= bounds_budget;
+        ASSIGN_OR_RETURN(Output bounds,
+                         approx_bounds_->PartialResult(bounds_budget,
+                                                       noise_interval_level));
+        lower_ = GetValue<T>(bounds.elements(0).value());
+        upper_ = GetValue<T>(bounds.elements(1).value());
+      }
       RETURN_IF_ERROR(Builder::CheckBounds(lower_, upper_));
 
       // To find the sum, pass the identity function as the transform.
+      FlushPartials();
       sum = approx_bounds_->template ComputeFromPartials<T>(
           pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
           raw_count_);
@@ -335,9 +478,16 @@ class BoundedVariance : public Algorithm<T> {
           pos_sum_of_squares_, neg_sum_of_squares_, [](T x) { return x * x; },
           lower_, upper_, raw_count_);
 
-      // Populate the bounding report with ApproxBounds information.
-      *(output.mutable_error_report()->mutable_bounding_report()) =
-          approx_bounds_->GetBoundingReport(lower_, upper_);
+      // Populate the bounding report with ApproxBounds information. The
+      // noisy bins of shared bounds belong to another ApproxBounds.
+      BoundingReport* report =
+          output.mutable_error_report()->mutable_bounding_report();
+      if (shared_bounds) {
+        SetValue<T>(report->mutable_lower_bound(), lower_);
+        SetValue<T>(report->mutable_upper_bound(), upper_);
+      } else {
+        *report = approx_bounds_->GetBoundingReport(lower_, upper_);
+      }
 
       // Clear the mechanism. The sensitivity might have changed.
       sum_mechanism_.reset();
@@ -366,6 +516,13 @@ class BoundedVariance : public Algorithm<T> {
                            Algorithm<T>::GetEpsilon(), l0_sensitivity_,
                            max_contributions_per_partition_, lower_, upper_));
     }
+    if (!count_mechanism_) {
+      ASSIGN_OR_RETURN(count_mechanism_,
+                       BuildCountMechanism(mechanism_builder_->Clone(),
+                                           Algorithm<T>::GetEpsilon(),
+                                           l0_sensitivity_,
+                                           max_contributions_per_partition_));
+    }
 
     T sum_midpoint = lower_ + (upper_ - lower_) / 2;
     T sos_midpoint = MidpointOfSquares(lower_, upper_);
@@ -413,6 +570,10 @@ class BoundedVariance : public Algorithm<T> {
     std::fill(pos_sum_of_squares_.begin(), pos_sum_of_squares_.end(), 0);
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
     std::fill(neg_sum_of_squares_.begin(), neg_sum_of_squares_.end(), 0);
+    lazy_pos_sum_.Clear();
+    lazy_neg_sum_.Clear();
+    lazy_pos_sum_of_squares_.Clear();
+    lazy_neg_sum_of_squares_.Clear();
     raw_count_ = 0;
 
     if (approx_bounds_) {
@@ -457,6 +618,17 @@ class BoundedVariance : public Algorithm<T> {
         .Build();
   }
 
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>>
+  BuildCountMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      const double epsilon, const double l0_sensitivity,
+      const double max_contributions_per_partition) {
+    return mechanism_builder->SetEpsilon(epsilon)
+        .SetL0Sensitivity(l0_sensitivity)
+        .SetLInfSensitivity(max_contributions_per_partition)
+        .Build();
+  }
+
   static base::StatusOr<std::unique_ptr<NumericalMechanism>>
   BuildSumOfSquaresMechanism(
       std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
@@ -488,28 +660,40 @@ class BoundedVariance : public Algorithm<T> {
           AddManualBoundsEntries(Clamp<T>(lower_, upper_, t), num_of_entries),
           absl::OkStatus());
     } else {
-      approx_bounds_->AddMultipleEntries(t, num_of_entries);
-
-      // Add to partial sums and sum of squares.
-      auto difference_of_squares = [](T val1, T val2) {
-        // Lessen the chance of becoming inf/-inf by calculating it like this.
-        return (static_cast<double>(val1) + val2) *
-               (static_cast<double>(val1) - val2);
-      };
+      // Add to the bins, partial sums and sum of squares at once.
       if (t >= 0) {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &pos_sum_, t, num_of_entries);
-        approx_bounds_->template AddMultipleEntriesToPartials<double>(
-            &pos_sum_of_squares_, t, num_of_entries, difference_of_squares);
+        approx_bounds_->AddMultipleEntriesWithLazyPartials(
+            t, num_of_entries, &lazy_pos_sum_, &lazy_pos_sum_of_squares_,
+            &DifferenceOfSquares);
       } else {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &neg_sum_, t, num_of_entries);
-        approx_bounds_->template AddMultipleEntriesToPartials<double>(
-            &neg_sum_of_squares_, t, num_of_entries, difference_of_squares);
+        approx_bounds_->AddMultipleEntriesWithLazyPartials(
+            t, num_of_entries, &lazy_neg_sum_, &lazy_neg_sum_of_squares_,
+            &DifferenceOfSquares);
       }
     }
   }
 
+  static double DifferenceOfSquares(T val1, T val2) {
+    // Lessen the chance of becoming inf/-inf by calculating it like this.
+    return (static_cast<double>(val1) + val2) *
+           (static_cast<double>(val1) - val2);
+  }
+
+  // Adds the partial values recorded lazily since the last flush to pos_sum_,
+  // neg_sum_, pos_sum_of_squares_ and neg_sum_of_squares_.
+  void FlushPartials() {
+    if (approx_bounds_) {
+      approx_bounds_->FlushLazyPartialSums(&lazy_pos_sum_, &pos_sum_);
+      approx_bounds_->FlushLazyPartialSums(&lazy_neg_sum_, &neg_sum_);
+      approx_bounds_->FlushLazyPartials(
+          &lazy_pos_sum_of_squares_, &pos_sum_of_squares_,
+          &DifferenceOfSquares);
+      approx_bounds_->FlushLazyPartials(
+          &lazy_neg_sum_of_squares_, &neg_sum_of_squares_,
+          &DifferenceOfSquares);
+    }
+  }
+
   absl::Status AddManualBoundsEntries(const T& t, uint64_t num_of_entries) {
     if (approx_bounds_) {
       return absl::InternalError(
@@ -529,9 +713,17 @@ class BoundedVariance : public Algorithm<T> {
   // Friend class for testing only
   friend class BoundedVarianceTestPeer;
 
+  // Adds entries to the state for manually set bounds directly.
+  template <typename T2, typename Bounds>
+  friend class StaticBoundedVariance;
+
   // Vectors of partial values stored for automatic clamping.
   std::vector<T> pos_sum_, neg_sum_;
   std::vector<double> pos_sum_of_squares_, neg_sum_of_squares_;
+
+  // Partial values added since the last call to FlushPartials.
+  LazyPartials<T> lazy_pos_sum_, lazy_neg_sum_;
+  LazyPartials<double> lazy_pos_sum_of_squares_, lazy_neg_sum_of_squares_;
   uint64_t raw_count_;
   T lower_, upper_;
 
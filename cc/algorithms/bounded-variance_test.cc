@@ -374,6 +374,55 @@ TYPED_TEST(BoundedVarianceTest, SerializeMergePartialValuesTest) {
   EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
 }
 
+TEST(BoundedVarianceTest, AddEntriesSpanMatchesAddEntryManualBounds) {
+  std::vector<double> a = {-2, 1.5, NAN, 3, 6, 0.25};
+  BoundedVariance<double>::Builder builder;
+  builder.SetLower(-1).SetUpper(4).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto algorithm1 = builder.Build();
+  ASSERT_OK(algorithm1);
+  auto algorithm2 = builder.Build();
+  ASSERT_OK(algorithm2);
+
+  for (double v : a) {
+    (*algorithm1)->AddEntry(v);
+  }
+  (*algorithm2)->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT((*algorithm2)->Serialize(),
+              EqualsProto((*algorithm1)->Serialize()));
+}
+
+TEST(BoundedVarianceTest, AddEntriesSpanMatchesAddEntryApproxBounds) {
+  std::vector<double> a = {-10, 4, NAN, 6, 0, -0.5, 100};
+  std::unique_ptr<BoundedVariance<double>> algorithms[2];
+  for (auto& algorithm : algorithms) {
+    auto bounds =
+        ApproxBounds<double>::Builder()
+            .SetThreshold(1)
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .Build();
+    ASSERT_OK(bounds);
+    auto built =
+        BoundedVariance<double>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetApproxBounds(std::move(*bounds))
+            .Build();
+    ASSERT_OK(built);
+    algorithm = std::move(*built);
+  }
+
+  for (double v : a) {
+    algorithms[0]->AddEntry(v);
+  }
+  algorithms[1]->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT(algorithms[1]->Serialize(),
+              EqualsProto(algorithms[0]->Serialize()));
+}
+
 TEST(BoundedVarianceTest, OverflowRawCountTest) {
   typename BoundedVariance<double>::Builder builder;
 
@@ -807,5 +856,177 @@ TYPED_TEST(BoundedVarianceTest, SplitsEpsilonWithAutomaticBounds) {
   EXPECT_LT((*bv)->GetAggregationEpsilon(), epsilon);
 }
 
+TYPED_TEST(BoundedVarianceTest, MergeFromMatchesMerge) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedVariance<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(0).SetUpper(10);
+    }
+    auto source = builder.Build();
+    ASSERT_OK(source);
+    (*source)->AddEntries(std::vector<TypeParam>{1, 2, 30, -4});
+    auto merged = builder.Build();
+    ASSERT_OK(merged);
+    (*merged)->AddEntry(5);
+    auto merged_from = builder.Build();
+    ASSERT_OK(merged_from);
+    (*merged_from)->AddEntry(5);
+
+    EXPECT_OK((*merged)->Merge((*source)->Serialize()));
+    EXPECT_OK((*merged_from)->MergeFrom(**source));
+    EXPECT_THAT((*merged_from)->Serialize(),
+                EqualsProto((*merged)->Serialize()));
+  }
+
+  auto manual = typename BoundedVariance<TypeParam>::Builder()
+                    .SetEpsilon(1.0)
+                    .SetLower(0)
+                    .SetUpper(10)
+                    .Build();
+  ASSERT_OK(manual);
+  auto automatic =
+      typename BoundedVariance<TypeParam>::Builder().SetEpsilon(1.0).Build();
+  ASSERT_OK(automatic);
+  EXPECT_THAT((*manual)->MergeFrom(**automatic),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("same bounding strategy")));
+}
+
+TYPED_TEST(BoundedVarianceTest, AddEntryWithCountMatchesAddEntry) {
+  for (bool manual_bounds : {true, false}) {
+    typename BoundedVariance<TypeParam>::Builder builder;
+    builder.SetEpsilon(1.0);
+    if (manual_bounds) {
+      builder.SetLower(-5).SetUpper(10);
+    }
+    auto with_count = builder.Build();
+    ASSERT_OK(with_count);
+    auto one_by_one = builder.Build();
+    ASSERT_OK(one_by_one);
+    for (const std::pair<TypeParam, uint64_t>& entry :
+         std::vector<std::pair<TypeParam, uint64_t>>{
+             {3, 5}, {-2, 4}, {30, 2}, {7, 0}}) {
+      (*with_count)->AddEntryWithCount(entry.first, entry.second);
+      for (uint64_t i = 0; i < entry.second; ++i) {
+        (*one_by_one)->AddEntry(entry.first);
+      }
+    }
+    EXPECT_THAT((*with_count)->Serialize(),
+                EqualsProto((*one_by_one)->Serialize()));
+  }
+}
+
+TEST(BoundedVarianceTest, AddEntriesSpanMatchesAddEntryManyEntries) {
+  // More entries than accumulator lanes, with small integers so that any
+  // summation order is exact.
+  std::vector<double> a;
+  for (int i = 0; i < 37; ++i) {
+    a.push_back(i % 5 == 0 ? NAN : (i % 11) - 3);
+  }
+  BoundedVariance<double>::Builder builder;
+  builder.SetLower(-1).SetUpper(4).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto algorithm1 = builder.Build();
+  ASSERT_OK(algorithm1);
+  auto algorithm2 = builder.Build();
+  ASSERT_OK(algorithm2);
+
+  for (double v : a) {
+    (*algorithm1)->AddEntry(v);
+  }
+  (*algorithm2)->AddEntries(absl::MakeConstSpan(a));
+  EXPECT_THAT((*algorithm2)->Serialize(),
+              EqualsProto((*algorithm1)->Serialize()));
+}
+
+TEST(BoundedVarianceTest, IntegralAddEntriesSpanMatchesAddEntry) {
+  std::vector<int64_t> a;
+  for (int64_t i = 0; i < 29; ++i) {
+    a.push_back(i * 7 % 23 - 10);
+  }
+  BoundedVariance<int64_t>::Builder builder;
+  builder.SetLower(-5).SetUpper(8).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto algorithm1 = builder.Build();
+  ASSERT_OK(algorithm1);
+  auto algorithm2 = builder.Build();
+  ASSERT_OK(algorithm2);
+
+  for (int64_t v : a) {
+    (*algorithm1)->AddEntry(v);
+  }
+  (*algorithm2)->AddEntries(absl::MakeConstSpan(a));
+  EXPECT_THAT((*algorithm2)->Serialize(),
+              EqualsProto((*algorithm1)->Serialize()));
+}
+
+
+TEST(BoundedVarianceTest, LazyMechanismIsBuiltOnFirstResult) {
+  typename BoundedVariance<double>::Builder failing_builder;
+  base::StatusOr<std::unique_ptr<BoundedVariance<double>>> failing =
+      failing_builder.SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(failing);
+  EXPECT_THAT((*failing)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+
+  typename BoundedVariance<double>::Builder builder;
+  base::StatusOr<std::unique_ptr<BoundedVariance<double>>> bv =
+      builder.SetEpsilon(1.0)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(bv);
+  (*bv)->AddEntry(2);
+  (*bv)->AddEntry(4);
+  base::StatusOr<Output> result = (*bv)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result), 1);
+}
+
+std::unique_ptr<ApproxBounds<double>> MakeExactApproxBounds() {
+  return ApproxBounds<double>::Builder()
+      .SetEpsilon(1)
+      .SetNumBins(5)
+      .SetBase(2)
+      .SetScale(1)
+      .SetThreshold(2)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(BoundedVarianceTest, PartialResultWithSharedBounds) {
+  std::vector<double> a = {2, 2, 4, 6, 6};
+  std::unique_ptr<ApproxBounds<double>> shared_bounds =
+      MakeExactApproxBounds();
+  shared_bounds->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> bounds = shared_bounds->PartialResult();
+  ASSERT_OK(bounds);
+
+  std::unique_ptr<BoundedVariance<double>> bv =
+      BoundedVariance<double>::Builder()
+          .SetEpsilon(1)
+          .SetApproxBounds(MakeExactApproxBounds())
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  bv->AddEntries(a.begin(), a.end());
+  base::StatusOr<Output> output = bv->PartialResultWithBounds(*bounds, 1);
+  ASSERT_OK(output);
+  EXPECT_NEAR(GetValue<double>(*output), 3.2, 1e-9);
+  EXPECT_DOUBLE_EQ(
+      GetValue<double>(output->error_report().bounding_report().lower_bound()),
+      1);
+  EXPECT_EQ(bv->RemainingPrivacyBudget(), 0);
+}
+
 }  //  namespace
 }  // namespace differential_privacy
@@ -0,0 +1,350 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_VECTOR_SUM_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_VECTOR_SUM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/logging.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+namespace internal {
+
+// Number of independent accumulators used by SquaredNorm, for the same reason
+// as kClampedSumLanes.
+constexpr int kSquaredNormLanes = 8;
+
+// Returns the sum of the squares of the elements of entry. The lanes are
+// combined in a fixed order, so the result is deterministic.
+inline double SquaredNorm(absl::Span<const double> entry) {
+  double lanes[kSquaredNormLanes] = {};
+  const size_t blocked_size =
+      entry.size() - entry.size() % kSquaredNormLanes;
+  for (size_t i = 0; i < blocked_size; i += kSquaredNormLanes) {
+    for (int j = 0; j < kSquaredNormLanes; ++j) {
+      lanes[j] += entry[i + j] * entry[i + j];
+    }
+  }
+  double squared_norm = 0;
+  for (size_t i = blocked_size; i < entry.size(); ++i) {
+    squared_norm += entry[i] * entry[i];
+  }
+  for (double lane : lanes) {
+    squared_norm += lane;
+  }
+  return squared_norm;
+}
+
+// Returns the L2 norm of entry, or NaN if an element is not finite. Squares
+// that overflow are avoided by scaling the elements by the largest magnitude.
+inline double L2Norm(absl::Span<const double> entry) {
+  const double squared_norm = SquaredNorm(entry);
+  if (std::isfinite(squared_norm)) {
+    return std::sqrt(squared_norm);
+  }
+  double max_abs = 0;
+  for (double t : entry) {
+    if (!std::isfinite(t)) {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    max_abs = std::max(max_abs, std::abs(t));
+  }
+  double scaled_squared_norm = 0;
+  for (double t : entry) {
+    scaled_squared_norm += (t / max_abs) * (t / max_abs);
+  }
+  return max_abs * std::sqrt(scaled_squared_norm);
+}
+
+// Adds scale * entry element-wise to sum. The loop has no dependency between
+// elements, so the compiler vectorizes it.
+inline void AddScaled(absl::Span<const double> entry, double scale,
+                      absl::Span<double> sum) {
+  for (size_t i = 0; i < entry.size(); ++i) {
+    sum[i] += scale * entry[i];
+  }
+}
+
+}  // namespace internal
+
+// Incrementally provides a differentially private sum of vectors of a fixed
+// dimension, e.g., embeddings or feature vectors. Each entry is scaled down to
+// an L2 norm of at most the L2 norm bound before it is added, so a privacy
+// unit that contributes at most max_contributions entries changes the sum by
+// at most max_contributions * l2_norm_bound in L2 norm. The whole vector is
+// noised by one Gaussian mechanism calibrated to that L2 sensitivity, instead
+// of splitting the budget among one BoundedSum per dimension.
+//
+// BoundedVectorSum is not an Algorithm<T>, since its entries are vectors, but
+// its budget, result and serialization methods behave like those of
+// Algorithm.
+class BoundedVectorSum {
+ public:
+  class Builder {
+   public:
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    // Must be in (0, 1).
+    Builder& SetDelta(double delta) {
+      delta_ = delta;
+      return *this;
+    }
+
+    // Number of elements of every entry.
+    Builder& SetDimension(int dimension) {
+      dimension_ = dimension;
+      return *this;
+    }
+
+    // Entries with a larger L2 norm are scaled down to this norm.
+    Builder& SetL2NormBound(double l2_norm_bound) {
+      l2_norm_bound_ = l2_norm_bound;
+      return *this;
+    }
+
+    // Maximum number of entries a privacy unit contributes. Defaults to 1.
+    Builder& SetMaxContributions(int max_contributions) {
+      max_contributions_ = max_contributions;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<BoundedVectorSum>> Build() {
+      if (!epsilon_.has_value()) {
+        epsilon_ = DefaultEpsilon();
+        LOG(WARNING) << "Default epsilon of " << epsilon_.value()
+                     << " is being used. Consider setting your own epsilon "
+                        "based on privacy considerations.";
+      }
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon_, "Epsilon"));
+      RETURN_IF_ERROR(ValidateIsInExclusiveInterval(delta_, 0, 1, "Delta"));
+      if (!dimension_.has_value()) {
+        return absl::InvalidArgumentError("Dimension must be set.");
+      }
+      RETURN_IF_ERROR(ValidateIsPositive(dimension_, "Dimension"));
+      if (!l2_norm_bound_.has_value()) {
+        return absl::InvalidArgumentError("L2 norm bound must be set.");
+      }
+      RETURN_IF_ERROR(
+          ValidateIsFiniteAndPositive(l2_norm_bound_, "L2 norm bound"));
+      RETURN_IF_ERROR(ValidateIsPositive(max_contributions_,
+                                         "Maximum number of contributions"));
+      std::unique_ptr<NumericalMechanism> mechanism;
+      ASSIGN_OR_RETURN(mechanism,
+                       GaussianMechanism::Builder()
+                           .SetL2Sensitivity(max_contributions_ *
+                                             l2_norm_bound_.value())
+                           .SetEpsilon(epsilon_.value())
+                           .SetDelta(delta_.value())
+                           .Build());
+      return absl::WrapUnique(new BoundedVectorSum(
+          epsilon_.value(), delta_.value(), dimension_.value(),
+          l2_norm_bound_.value(), max_contributions_, std::move(mechanism)));
+    }
+
+   private:
+    absl::optional<double> epsilon_;
+    absl::optional<double> delta_;
+    absl::optional<int> dimension_;
+    absl::optional<double> l2_norm_bound_;
+    int max_contributions_ = 1;
+  };
+
+  // Clips entry to the L2 norm bound and adds it to the sum. Entries with an
+  // element that is NaN or infinite are ignored. Fails if entry does not have
+  // GetDimension() elements.
+  absl::Status AddEntry(absl::Span<const double> entry) {
+    RETURN_IF_ERROR(CheckSize(entry.size(), 1));
+    AddClippedEntry(entry);
+    return absl::OkStatus();
+  }
+
+  // Adds entries stored one after the other, i.e., a row-major matrix with one
+  // entry per row. Fails without adding anything if the number of elements is
+  // not a multiple of GetDimension().
+  absl::Status AddEntries(absl::Span<const double> entries) {
+    const int64_t num_entries = entries.size() / dimension_;
+    RETURN_IF_ERROR(CheckSize(entries.size(), num_entries));
+    for (int64_t i = 0; i < num_entries; ++i) {
+      AddClippedEntry(entries.subspan(i * dimension_, dimension_));
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the noisy sum, consuming privacy_budget of the remaining budget.
+  // The noise of all elements is drawn in one batch.
+  base::StatusOr<std::vector<double>> PartialResult() {
+    return PartialResult(RemainingPrivacyBudget());
+  }
+
+  base::StatusOr<std::vector<double>> PartialResult(double privacy_budget) {
+    if (privacy_budget > privacy_budget_) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Privacy budget requested ", privacy_budget,
+          " exceeds the remaining budget of ", privacy_budget_, "."));
+    }
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+    std::vector<double> result(dimension_);
+    RETURN_IF_ERROR(mechanism_->AddNoise(sum_, absl::MakeSpan(result),
+                                         privacy_budget));
+    privacy_budget_ = std::max(0.0, privacy_budget_ - privacy_budget);
+    return result;
+  }
+
+  // Returns the confidence_level confidence interval of the noise of every
+  // element of a result with privacy_budget.
+  base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
+      double confidence_level, double privacy_budget = 1) {
+    return mechanism_->NoiseConfidenceInterval(confidence_level,
+                                               privacy_budget);
+  }
+
+  double RemainingPrivacyBudget() const { return privacy_budget_; }
+
+  // Removes all entries and restores the full privacy budget.
+  void Reset() {
+    std::fill(sum_.begin(), sum_.end(), 0);
+    privacy_budget_ = kFullPrivacyBudget;
+  }
+
+  Summary Serialize() const {
+    BoundedVectorSumSummary vector_sum_summary;
+    vector_sum_summary.mutable_sum()->Add(sum_.begin(), sum_.end());
+    vector_sum_summary.set_epsilon(epsilon_);
+    vector_sum_summary.set_delta(delta_);
+    vector_sum_summary.set_l2_norm_bound(l2_norm_bound_);
+    vector_sum_summary.set_max_contributions(max_contributions_);
+    Summary summary;
+    summary.mutable_data()->PackFrom(vector_sum_summary);
+    return summary;
+  }
+
+  // Merges a summary of a BoundedVectorSum with the same parameters.
+  absl::Status Merge(const Summary& summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no bounded vector sum data.");
+    }
+    BoundedVectorSumSummary vector_sum_summary;
+    if (!summary.data().UnpackTo(&vector_sum_summary)) {
+      return absl::InternalError(
+          "Bounded vector sum summary unable to be unpacked.");
+    }
+    if (vector_sum_summary.sum_size() != dimension_ ||
+        vector_sum_summary.epsilon() != epsilon_ ||
+        vector_sum_summary.delta() != delta_ ||
+        vector_sum_summary.l2_norm_bound() != l2_norm_bound_ ||
+        vector_sum_summary.max_contributions() != max_contributions_) {
+      return absl::InvalidArgumentError(
+          "Merged BoundedVectorSum must have the same parameters as this "
+          "BoundedVectorSum.");
+    }
+    internal::AddScaled(vector_sum_summary.sum(), 1, absl::MakeSpan(sum_));
+    return absl::OkStatus();
+  }
+
+  // Same as Merge(other.Serialize()), without the Summary round trip.
+  absl::Status MergeFrom(const BoundedVectorSum& other) {
+    if (other.dimension_ != dimension_ || other.epsilon_ != epsilon_ ||
+        other.delta_ != delta_ || other.l2_norm_bound_ != l2_norm_bound_ ||
+        other.max_contributions_ != max_contributions_) {
+      return absl::InvalidArgumentError(
+          "Merged BoundedVectorSum must have the same parameters as this "
+          "BoundedVectorSum.");
+    }
+    internal::AddScaled(other.sum_, 1, absl::MakeSpan(sum_));
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() const {
+    return sizeof(BoundedVectorSum) + sizeof(double) * sum_.capacity() +
+           mechanism_->MemoryUsed();
+  }
+
+  double GetEpsilon() const { return epsilon_; }
+  double GetDelta() const { return delta_; }
+  int GetDimension() const { return dimension_; }
+  double GetL2NormBound() const { return l2_norm_bound_; }
+  int GetMaxContributions() const { return max_contributions_; }
+
+ private:
+  static constexpr double kFullPrivacyBudget = 1.0;
+
+  BoundedVectorSum(double epsilon, double delta, int dimension,
+                   double l2_norm_bound, int max_contributions,
+                   std::unique_ptr<NumericalMechanism> mechanism)
+      : epsilon_(epsilon),
+        delta_(delta),
+        dimension_(dimension),
+        l2_norm_bound_(l2_norm_bound),
+        max_contributions_(max_contributions),
+        mechanism_(std::move(mechanism)),
+        sum_(dimension, 0) {}
+
+  absl::Status CheckSize(int64_t size, int64_t num_entries) const {
+    if (size != num_entries * dimension_) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Entries must have ", dimension_, " elements each, but got ", size,
+          " elements."));
+    }
+    return absl::OkStatus();
+  }
+
+  void AddClippedEntry(absl::Span<const double> entry) {
+    const double norm = internal::L2Norm(entry);
+    // NaN fails the comparison, which skips entries with NaN or infinite
+    // elements.
+    if (!(norm <= std::numeric_limits<double>::max())) {
+      return;
+    }
+    const double scale = norm > l2_norm_bound_ ? l2_norm_bound_ / norm : 1;
+    internal::AddScaled(entry, scale, absl::MakeSpan(sum_));
+  }
+
+  const double epsilon_;
+  const double delta_;
+  const int dimension_;
+  const double l2_norm_bound_;
+  const int max_contributions_;
+  std::unique_ptr<NumericalMechanism> mechanism_;
+  std::vector<double> sum_;
+  double privacy_budget_ = kFullPrivacyBudget;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_BOUNDED_VECTOR_SUM_H_
@@ -0,0 +1,189 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/bounded-vector-sum.h"
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Pointwise;
+
+// The noise of a huge epsilon is negligible.
+std::unique_ptr<BoundedVectorSum> MakeAlmostExactSum(int dimension,
+                                                     double l2_norm_bound) {
+  return BoundedVectorSum::Builder()
+      .SetEpsilon(1e12)
+      .SetDelta(.5)
+      .SetDimension(dimension)
+      .SetL2NormBound(l2_norm_bound)
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(BoundedVectorSumInternalTest, L2Norm) {
+  std::vector<double> entry(19, 2);
+  EXPECT_DOUBLE_EQ(internal::L2Norm(entry), std::sqrt(19 * 4));
+  // The squares overflow.
+  EXPECT_DOUBLE_EQ(internal::L2Norm({3e200, 4e200}), 5e200);
+  EXPECT_TRUE(std::isnan(
+      internal::L2Norm({1, std::numeric_limits<double>::infinity()})));
+}
+
+TEST(BoundedVectorSumTest, SumsClippedEntries) {
+  std::unique_ptr<BoundedVectorSum> sum = MakeAlmostExactSum(2, 5);
+  ASSERT_OK(sum->AddEntry({1, 2}));
+  // Norm 10, scaled down to norm 5.
+  ASSERT_OK(sum->AddEntry({6, -8}));
+  ASSERT_OK(sum->AddEntry({1, std::numeric_limits<double>::quiet_NaN()}));
+
+  base::StatusOr<std::vector<double>> result = sum->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_THAT(result.value(), ElementsAre(DoubleNear(4, 1e-6),
+                                          DoubleNear(-2, 1e-6)));
+  EXPECT_EQ(sum->RemainingPrivacyBudget(), 0);
+}
+
+TEST(BoundedVectorSumTest, AddEntriesMatchesAddEntry) {
+  const int kDimension = 37;
+  std::unique_ptr<BoundedVectorSum> batched = MakeAlmostExactSum(kDimension, 3);
+  std::unique_ptr<BoundedVectorSum> single = MakeAlmostExactSum(kDimension, 3);
+  std::vector<double> entries;
+  for (int i = 0; i < 5 * kDimension; ++i) {
+    entries.push_back(std::sin(i));
+  }
+  ASSERT_OK(batched->AddEntries(entries));
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_OK(single->AddEntry(
+        absl::MakeConstSpan(entries).subspan(i * kDimension, kDimension)));
+  }
+  const std::vector<double> expected = single->PartialResult().ValueOrDie();
+  EXPECT_THAT(batched->PartialResult().ValueOrDie(),
+              Pointwise(DoubleNear(1e-6), expected));
+}
+
+TEST(BoundedVectorSumTest, RejectsWrongDimension) {
+  std::unique_ptr<BoundedVectorSum> sum = MakeAlmostExactSum(3, 1);
+  EXPECT_THAT(sum->AddEntry({1, 2}),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must have 3 elements")));
+  EXPECT_THAT(sum->AddEntries({1, 2, 3, 4}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_OK(sum->AddEntries({}));
+}
+
+TEST(BoundedVectorSumTest, NoiseIsCalibratedToL2Sensitivity) {
+  const int kDimension = 2048;
+  std::unique_ptr<BoundedVectorSum> sum = BoundedVectorSum::Builder()
+                                              .SetEpsilon(1)
+                                              .SetDelta(1e-5)
+                                              .SetDimension(kDimension)
+                                              .SetL2NormBound(1)
+                                              .Build()
+                                              .ValueOrDie();
+  std::vector<double> result = sum->PartialResult().ValueOrDie();
+  double squared_noise = 0;
+  for (double value : result) {
+    squared_noise += value * value;
+  }
+  // The stddev of the elements is that of a single Gaussian mechanism with L2
+  // sensitivity 1, independently of the dimension.
+  GaussianMechanism mechanism(1, 1e-5, 1);
+  const double stddev = mechanism.CalculateStddev(1, 1e-5);
+  EXPECT_NEAR(std::sqrt(squared_noise / kDimension), stddev, .1 * stddev);
+}
+
+TEST(BoundedVectorSumTest, SerializeAndMerge) {
+  std::unique_ptr<BoundedVectorSum> sum = MakeAlmostExactSum(2, 10);
+  ASSERT_OK(sum->AddEntry({1, 2}));
+  std::unique_ptr<BoundedVectorSum> merged = MakeAlmostExactSum(2, 10);
+  ASSERT_OK(merged->AddEntry({3, 4}));
+  ASSERT_OK(merged->Merge(sum->Serialize()));
+  ASSERT_OK(merged->MergeFrom(*sum));
+  EXPECT_THAT(merged->PartialResult().ValueOrDie(),
+              ElementsAre(DoubleNear(5, 1e-6), DoubleNear(8, 1e-6)));
+
+  std::unique_ptr<BoundedVectorSum> other = MakeAlmostExactSum(2, 1);
+  EXPECT_THAT(other->Merge(sum->Serialize()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same parameters")));
+  EXPECT_THAT(other->MergeFrom(*sum),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(other->Merge(Summary()),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(BoundedVectorSumTest, ConsumesBudgetAndResets) {
+  std::unique_ptr<BoundedVectorSum> sum = MakeAlmostExactSum(1, 1);
+  ASSERT_OK(sum->PartialResult(.4));
+  EXPECT_THAT(sum->PartialResult(.7),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("exceeds the remaining budget")));
+  ASSERT_OK(sum->PartialResult());
+  EXPECT_THAT(sum->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  ASSERT_OK(sum->AddEntry({1}));
+  sum->Reset();
+  EXPECT_EQ(sum->RemainingPrivacyBudget(), 1);
+  EXPECT_THAT(sum->PartialResult().ValueOrDie(),
+              ElementsAre(DoubleNear(0, 1e-6)));
+}
+
+TEST(BoundedVectorSumTest, BuildValidatesParameters) {
+  EXPECT_THAT(BoundedVectorSum::Builder()
+                  .SetEpsilon(1)
+                  .SetDimension(2)
+                  .SetL2NormBound(1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Delta")));
+  EXPECT_THAT(
+      BoundedVectorSum::Builder().SetEpsilon(1).SetDelta(1e-5).Build(),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("Dimension must be set")));
+  EXPECT_THAT(BoundedVectorSum::Builder()
+                  .SetEpsilon(1)
+                  .SetDelta(1e-5)
+                  .SetDimension(2)
+                  .SetL2NormBound(-1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("L2 norm bound")));
+  EXPECT_THAT(BoundedVectorSum::Builder()
+                  .SetEpsilon(1)
+                  .SetDelta(1e-5)
+                  .SetDimension(2)
+                  .SetL2NormBound(1)
+                  .SetMaxContributions(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of contributions")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
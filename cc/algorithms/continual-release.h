@@ -0,0 +1,206 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// ContinualRelease releases the running total of a Count or BoundedSum after
+// every time step of a stream, e.g., every hour, with the binary tree
+// mechanism of Chan, Shi and Song, "Private and Continual Release of
+// Statistics". Instead of releasing each prefix from scratch, which spends the
+// budget again on every release, the steps are aggregated in a binary tree:
+// every node covers 2^level consecutive steps and is noised once when its last
+// step ends. The total after step t is the sum of the noised nodes that
+// correspond to the bits set in t, so the noise of a release grows with
+// log(T) for T time steps instead of with T.
+//
+// Every entry is contained in one node per level, i.e., in at most
+// NumLevels() = floor(log2(max_time_steps)) + 1 nodes, so every node is
+// computed by an algorithm with epsilon / NumLevels() and delta / NumLevels().
+// By basic composition, the whole stream of releases is then
+// (epsilon, delta)-differentially private. Only the last node of every level
+// is kept, as an algorithm with its exact entries to be merged into the next
+// level, so a time step takes O(log T) merges and the memory is O(log T)
+// algorithms.
+//
+// The algorithms are built by a factory that is passed the epsilon and delta
+// of a node, and must not use a larger delta than the one passed, e.g., for a
+// Gaussian mechanism; with the default delta of 0, only pure mechanisms may be
+// used. They must support MergeFrom and release their result without
+// consuming further budget, e.g., Count or a BoundedSum with bounds set in
+// its builder; automatic bounding is not supported.
+template <typename T>
+class ContinualRelease {
+ public:
+  using Factory = std::function<base::StatusOr<std::unique_ptr<Algorithm<T>>>(
+      double node_epsilon, double node_delta)>;
+
+  // Creates a release for up to max_time_steps time steps with a total budget
+  // of epsilon and delta. Fails if an algorithm built by factory has a larger
+  // epsilon than the one it was passed. Algorithms do not expose their delta,
+  // so the factory is trusted to respect node_delta.
+  static base::StatusOr<std::unique_ptr<ContinualRelease<T>>> Create(
+      double epsilon, int64_t max_time_steps, const Factory& factory,
+      double delta = 0) {
+    RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon, "Epsilon"));
+    RETURN_IF_ERROR(ValidateIsInInclusiveInterval(delta, 0, 1, "Delta"));
+    RETURN_IF_ERROR(
+        ValidateIsPositive(max_time_steps, "Maximum number of time steps"));
+    int num_levels = 1;
+    while ((max_time_steps >> num_levels) > 0) {
+      ++num_levels;
+    }
+    const double node_epsilon = epsilon / num_levels;
+    const double node_delta = delta / num_levels;
+
+    // One algorithm per level, and one for the current time step.
+    std::vector<std::unique_ptr<Algorithm<T>>> nodes(num_levels + 1);
+    for (std::unique_ptr<Algorithm<T>>& node : nodes) {
+      ASSIGN_OR_RETURN(node, factory(node_epsilon, node_delta));
+      if (node->GetEpsilon() > node_epsilon) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Algorithms for the nodes must use an epsilon of at most ",
+            node_epsilon, ", but the factory built one with epsilon ",
+            node->GetEpsilon(), "."));
+      }
+    }
+    std::unique_ptr<Algorithm<T>> current = std::move(nodes.back());
+    nodes.pop_back();
+    return absl::WrapUnique(new ContinualRelease(epsilon, delta, max_time_steps,
+                                                 std::move(current),
+                                                 std::move(nodes)));
+  }
+
+  // Adds entries to the current time step.
+  void AddEntry(const T& t) { current_->AddEntry(t); }
+
+  void AddEntries(absl::Span<const T> entries) {
+    current_->AddEntries(entries);
+  }
+
+  // Ends the current time step and returns the noisy total of all time steps
+  // so far. Fails with a FailedPrecondition error once max_time_steps time
+  // steps have ended.
+  base::StatusOr<double> EndTimeStep() {
+    if (num_time_steps_ == max_time_steps_) {
+      return absl::FailedPreconditionError(absl::StrCat(
+          "All ", max_time_steps_, " time steps have already ended."));
+    }
+    const int64_t t = num_time_steps_ + 1;
+    // The node that ends with step t is at the level of the lowest set bit of
+    // t, and contains the step and the last nodes of all lower levels.
+    int level = 0;
+    while (((t >> level) & 1) == 0) {
+      ++level;
+    }
+    std::unique_ptr<Algorithm<T>>& node = nodes_[level];
+    node->Reset();
+    std::swap(node, current_);
+    for (int lower = 0; lower < level; ++lower) {
+      RETURN_IF_ERROR(node->MergeFrom(*nodes_[lower]));
+      nodes_[lower]->Reset();
+      noisy_nodes_[lower] = 0;
+    }
+    ASSIGN_OR_RETURN(ResultValue result, node->PartialResultValue());
+    noisy_nodes_[level] = result.value;
+    num_time_steps_ = t;
+
+    double total = 0;
+    for (int i = 0; i < NumLevels(); ++i) {
+      if ((t >> i) & 1) {
+        total += noisy_nodes_[i];
+      }
+    }
+    last_result_ = total;
+    return total;
+  }
+
+  // Returns the result of the last EndTimeStep() call, or 0 before the first
+  // time step ended, without consuming any budget.
+  double LastResult() const { return last_result_; }
+
+  int64_t NumTimeSteps() const { return num_time_steps_; }
+
+  int64_t MaxTimeSteps() const { return max_time_steps_; }
+
+  // Returns the number of levels of the tree, i.e., the number of nodes that
+  // contain every entry.
+  int NumLevels() const { return nodes_.size(); }
+
+  double GetEpsilon() const { return epsilon_; }
+
+  // Returns the epsilon of each node, epsilon / NumLevels().
+  double GetNodeEpsilon() const { return epsilon_ / NumLevels(); }
+
+  double GetDelta() const { return delta_; }
+
+  // Returns the delta of each node, delta / NumLevels().
+  double GetNodeDelta() const { return delta_ / NumLevels(); }
+
+  int64_t MemoryUsed() {
+    int64_t memory = sizeof(ContinualRelease<T>) + current_->MemoryUsed() +
+                     noisy_nodes_.capacity() * sizeof(double) +
+                     nodes_.capacity() * sizeof(nodes_[0]);
+    for (const std::unique_ptr<Algorithm<T>>& node : nodes_) {
+      memory += node->MemoryUsed();
+    }
+    return memory;
+  }
+
+ private:
+  ContinualRelease(double epsilon, double delta, int64_t max_time_steps,
+                   std::unique_ptr<Algorithm<T>> current,
+                   std::vector<std::unique_ptr<Algorithm<T>>> nodes)
+      : epsilon_(epsilon),
+        delta_(delta),
+        max_time_steps_(max_time_steps),
+        current_(std::move(current)),
+        nodes_(std::move(nodes)),
+        noisy_nodes_(nodes_.size(), 0) {}
+
+  const double epsilon_;
+  const double delta_;
+  const int64_t max_time_steps_;
+  int64_t num_time_steps_ = 0;
+  double last_result_ = 0;
+  // Entries of the current time step.
+  std::unique_ptr<Algorithm<T>> current_;
+  // The last node of every level, with its exact entries, and its noisy
+  // result. Nodes that are not part of the current total are reset.
+  std::vector<std::unique_ptr<Algorithm<T>>> nodes_;
+  std::vector<double> noisy_nodes_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTINUAL_RELEASE_H_
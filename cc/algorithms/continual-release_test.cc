@@ -0,0 +1,187 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/continual-release.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::DoubleEq;
+using ::testing::HasSubstr;
+
+base::StatusOr<std::unique_ptr<Algorithm<int>>> MakeExactCount(
+    double epsilon, double /*delta*/) {
+  return Count<int>::Builder()
+      .SetEpsilon(epsilon)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+base::StatusOr<std::unique_ptr<Algorithm<double>>> MakeExactSum(
+    double epsilon, double /*delta*/) {
+  return BoundedSum<double>::Builder()
+      .SetEpsilon(epsilon)
+      .SetLower(0)
+      .SetUpper(5)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+TEST(ContinualReleaseTest, ReleasesRunningCount) {
+  std::unique_ptr<ContinualRelease<int>> release =
+      ContinualRelease<int>::Create(1, 100, &MakeExactCount).ValueOrDie();
+  int64_t total = 0;
+  for (int step = 0; step < 100; ++step) {
+    for (int i = 0; i < step % 7; ++i) {
+      release->AddEntry(1);
+    }
+    total += step % 7;
+    base::StatusOr<double> result = release->EndTimeStep();
+    ASSERT_OK(result);
+    EXPECT_EQ(result.value(), total) << "at time step " << step;
+  }
+  EXPECT_EQ(release->NumTimeSteps(), 100);
+  EXPECT_EQ(release->LastResult(), total);
+}
+
+TEST(ContinualReleaseTest, ReleasesRunningBoundedSum) {
+  std::unique_ptr<ContinualRelease<double>> release =
+      ContinualRelease<double>::Create(1, 16, &MakeExactSum).ValueOrDie();
+  double total = 0;
+  for (int step = 0; step < 16; ++step) {
+    release->AddEntries({1.5, 2.0, 10.0});
+    // The last entry is clamped to the upper bound.
+    total += 8.5;
+    base::StatusOr<double> result = release->EndTimeStep();
+    ASSERT_OK(result);
+    EXPECT_THAT(result.value(), DoubleEq(total));
+  }
+}
+
+TEST(ContinualReleaseTest, SplitsEpsilonAmongLevels) {
+  std::unique_ptr<ContinualRelease<int>> release =
+      ContinualRelease<int>::Create(2.2, 1024, &MakeExactCount).ValueOrDie();
+  // Steps 1 to 1024 have their lowest set bits at levels 0 to 10.
+  EXPECT_EQ(release->NumLevels(), 11);
+  EXPECT_THAT(release->GetNodeEpsilon(), DoubleEq(.2));
+  EXPECT_EQ(ContinualRelease<int>::Create(1, 1, &MakeExactCount)
+                .ValueOrDie()
+                ->NumLevels(),
+            1);
+  EXPECT_EQ(ContinualRelease<int>::Create(1, 1023, &MakeExactCount)
+                .ValueOrDie()
+                ->NumLevels(),
+            10);
+}
+
+TEST(ContinualReleaseTest, SplitsDeltaAmongLevels) {
+  std::vector<double> node_deltas;
+  std::unique_ptr<ContinualRelease<int>> release =
+      ContinualRelease<int>::Create(
+          1, 7,
+          [&node_deltas](double epsilon, double delta) {
+            node_deltas.push_back(delta);
+            return MakeExactCount(epsilon, delta);
+          },
+          /*delta=*/3e-5)
+          .ValueOrDie();
+  // Three levels and the current time step.
+  ASSERT_EQ(node_deltas.size(), 4);
+  for (double node_delta : node_deltas) {
+    EXPECT_THAT(node_delta, DoubleEq(1e-5));
+  }
+  EXPECT_EQ(release->GetDelta(), 3e-5);
+  EXPECT_THAT(release->GetNodeDelta(), DoubleEq(1e-5));
+  EXPECT_EQ(
+      ContinualRelease<int>::Create(1, 7, &MakeExactCount)
+          .ValueOrDie()
+          ->GetNodeDelta(),
+      0);
+}
+
+TEST(ContinualReleaseTest, NoiseGrowsLogarithmically) {
+  // With a Laplace mechanism of scale 1 / node_epsilon per node, the noise of
+  // a release is the sum of those of at most NumLevels() nodes.
+  const int kMaxTimeSteps = 64;
+  const int kNumRuns = 200;
+  double squared_error = 0;
+  for (int run = 0; run < kNumRuns; ++run) {
+    std::unique_ptr<ContinualRelease<int>> release =
+        ContinualRelease<int>::Create(
+            7, kMaxTimeSteps,
+            [](double epsilon, double /*delta*/) {
+              return Count<int>::Builder().SetEpsilon(epsilon).Build();
+            })
+            .ValueOrDie();
+    for (int step = 0; step < kMaxTimeSteps; ++step) {
+      squared_error += std::pow(release->EndTimeStep().ValueOrDie(), 2);
+    }
+  }
+  // The node epsilon is 1, so the variance of a node is 2, and a release
+  // contains on average half of the 7 levels.
+  const double mean_squared_error = squared_error / (kNumRuns * kMaxTimeSteps);
+  EXPECT_GT(mean_squared_error, 2);
+  EXPECT_LT(mean_squared_error, 2 * 7);
+}
+
+TEST(ContinualReleaseTest, FailsAfterMaxTimeSteps) {
+  std::unique_ptr<ContinualRelease<int>> release =
+      ContinualRelease<int>::Create(1, 3, &MakeExactCount).ValueOrDie();
+  for (int step = 0; step < 3; ++step) {
+    ASSERT_OK(release->EndTimeStep());
+  }
+  EXPECT_THAT(release->EndTimeStep(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("time steps have already ended")));
+}
+
+TEST(ContinualReleaseTest, CreateValidatesParameters) {
+  EXPECT_THAT(ContinualRelease<int>::Create(0, 10, &MakeExactCount),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon")));
+  EXPECT_THAT(ContinualRelease<int>::Create(1, 0, &MakeExactCount),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of time steps")));
+  EXPECT_THAT(ContinualRelease<int>::Create(1, 10, &MakeExactCount,
+                                            /*delta=*/-1e-5),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Delta")));
+  // The factory ignores the epsilon of the nodes.
+  EXPECT_THAT(ContinualRelease<int>::Create(
+                  1, 10,
+                  [](double, double) {
+                    return Count<int>::Builder().SetEpsilon(1).Build();
+                  }),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must use an epsilon of at most")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
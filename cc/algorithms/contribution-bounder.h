@@ -0,0 +1,388 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/merge-all.h"
+#include "algorithms/partitioned-aggregator.h"
+#include "algorithms/rand.h"
+#include "algorithms/sharding.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// ContributionBounder bounds the contributions of every privacy unit, e.g., a
+// user, before they are aggregated per partition, which the aggregators of
+// this library leave to the caller. It takes (user_id, partition_key, value)
+// contributions in any order and keeps
+//
+// - at most max_partitions_contributed partitions per user, sampled uniformly
+//   among the distinct partitions of the user, and
+// - at most max_contributions_per_partition values per user and partition,
+//   sampled uniformly among the values of the user in that partition.
+//
+// The partitions of a user are sampled with bottom-k sampling: every pair of
+// user and partition gets a pseudorandom priority from a keyed hash, and the
+// partitions with the smallest priorities are kept. Repeated contributions to
+// a dropped partition are therefore dropped as well, and the state of a user
+// never exceeds the bound, however many contributions the user has. Values are
+// sampled by reservoir sampling. NaN values are dropped.
+//
+// Users are hash-partitioned into shards, each with its own table and lock.
+// AddContributions sorts a batch by shard and adds the shards in parallel, so
+// batches should be large, e.g., thousands of contributions. Several threads
+// may also add batches concurrently. The bounded contributions are then
+// streamed into a PartitionedAggregator, or any other sink, with Flush.
+//
+// A bounder is single-use: once Flush has been called, contributions can no
+// longer be added. The state of a flushed user is discarded, so contributions
+// added afterwards would be bounded again from scratch, and a user could pass
+// more than the bounds to the sink over several flushes.
+template <typename UserId, typename Key, typename T,
+          typename UserHash = absl::Hash<UserId>,
+          typename KeyHash = absl::Hash<Key>>
+class ContributionBounder {
+  static_assert(std::is_arithmetic<T>::value,
+                "ContributionBounder can only be used for arithmetic types");
+
+ public:
+  // Batches smaller than this are added on the calling thread, since starting
+  // threads would cost more than it saves.
+  static constexpr int64_t kMinParallelBatchSize = 4096;
+
+  struct Contribution {
+    UserId user_id;
+    Key key;
+    T value;
+  };
+
+  // Receives the kept values of one user in one partition. A non-OK status
+  // stops the flush.
+  using Sink = std::function<absl::Status(const Key&, absl::Span<const T>)>;
+
+  class Builder {
+   public:
+    // Defaults to 1.
+    Builder& SetMaxPartitionsContributed(int max_partitions) {
+      max_partitions_contributed_ = max_partitions;
+      return *this;
+    }
+
+    // Defaults to 1.
+    Builder& SetMaxContributionsPerPartition(int max_contributions) {
+      max_contributions_per_partition_ = max_contributions;
+      return *this;
+    }
+
+    // Number of shards that users are hash-partitioned into. More shards than
+    // threads balance the load better. Defaults to 64.
+    Builder& SetNumShards(int num_shards) {
+      num_shards_ = num_shards;
+      return *this;
+    }
+
+    // Number of threads that add a batch, including the calling thread.
+    // Defaults to the number of hardware threads.
+    Builder& SetNumThreads(int num_threads) {
+      num_threads_ = num_threads;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<ContributionBounder>> Build() {
+      RETURN_IF_ERROR(ValidateIsPositive(
+          max_partitions_contributed_, "Maximum number of partitions"));
+      RETURN_IF_ERROR(
+          ValidateIsPositive(max_contributions_per_partition_,
+                             "Maximum number of contributions per partition"));
+      RETURN_IF_ERROR(ValidateIsPositive(num_shards_, "Number of shards"));
+      if (!num_threads_.has_value()) {
+        num_threads_ = std::max<int>(1, std::thread::hardware_concurrency());
+      }
+      RETURN_IF_ERROR(
+          ValidateIsPositive(num_threads_.value(), "Number of threads"));
+      return absl::WrapUnique(new ContributionBounder(
+          max_partitions_contributed_, max_contributions_per_partition_,
+          num_shards_, num_threads_.value()));
+    }
+
+   private:
+    int max_partitions_contributed_ = 1;
+    int max_contributions_per_partition_ = 1;
+    int num_shards_ = 64;
+    absl::optional<int> num_threads_;
+  };
+
+  absl::Status AddContribution(const UserId& user_id, const Key& key,
+                               const T& value) {
+    const Contribution contribution{user_id, key, value};
+    return AddContributions(absl::MakeConstSpan(&contribution, 1));
+  }
+
+  // Adds a batch of contributions. The shards of batches of at least
+  // kMinParallelBatchSize contributions are added in parallel, and concurrent
+  // calls only wait for each other on the shards they share. Fails without
+  // adding anything once Flush has been called, and must not be called
+  // concurrently with Flush.
+  absl::Status AddContributions(absl::Span<const Contribution> contributions) {
+    if (flushed_.load(std::memory_order_acquire)) {
+      return absl::FailedPreconditionError(
+          "Cannot add contributions after the bounder was flushed, since they "
+          "would not be bounded together with the flushed ones.");
+    }
+    std::vector<std::size_t> hashes(contributions.size());
+    std::vector<int> shards(contributions.size());
+    for (size_t i = 0; i < contributions.size(); ++i) {
+      hashes[i] = user_hash_(contributions[i].user_id);
+      shards[i] = internal::ShardIndex(hashes[i], num_shards_);
+    }
+    const internal::ShardOrder shard_order =
+        internal::SortByShard(shards, num_shards_);
+
+    std::vector<int> used_shards;
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      if (!shard_order.IsEmpty(shard)) {
+        used_shards.push_back(shard);
+      }
+    }
+    const int num_threads =
+        contributions.size() < kMinParallelBatchSize ? 1 : num_threads_;
+    internal::ParallelFor(used_shards.size(), num_threads, [&](int64_t used) {
+      const int shard = used_shards[used];
+      Shard& current = shards_[shard];
+      absl::MutexLock lock(&current.mutex);
+      for (int64_t j = shard_order.offsets[shard];
+           j < shard_order.offsets[shard + 1]; ++j) {
+        const int64_t i = shard_order.order[j];
+        AddToShard(contributions[i], hashes[i], &current);
+      }
+    });
+    return absl::OkStatus();
+  }
+
+  // Calls sink once per user and kept partition with the kept values, shard
+  // by shard on the calling thread, and removes the contributions that were
+  // passed to it. If sink fails, the flush stops and the contributions that
+  // were not passed, including the failed one, are kept, so that the caller
+  // can resolve the error, e.g., spill an aggregator, and flush again. No
+  // contributions can be added after the first call.
+  absl::Status Flush(const Sink& sink) {
+    flushed_.store(true, std::memory_order_release);
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      Shard& current = shards_[shard];
+      absl::MutexLock lock(&current.mutex);
+      for (auto it = current.users.begin(); it != current.users.end();) {
+        std::vector<KeptPartition>& partitions = it->second;
+        while (!partitions.empty()) {
+          const KeptPartition& partition = partitions.back();
+          RETURN_IF_ERROR(sink(partition.key, partition.values));
+          partitions.pop_back();
+        }
+        current.users.erase(it++);
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Flushes into aggregator, which adds the values of every user and kept
+  // partition in one AddEntries call, as the aggregator requires. Fails
+  // without flushing if the bounds of this bounder exceed the ones the
+  // aggregator is calibrated for.
+  template <typename Hash, typename Eq>
+  absl::Status FlushInto(
+      PartitionedAggregator<Key, T, Hash, Eq>* aggregator) {
+    const int64_t aggregator_max_partitions =
+        aggregator->GetPartitionSelectionStrategy()
+            .GetMaxPartitionsContributed();
+    if (max_partitions_contributed_ > aggregator_max_partitions) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Maximum number of partitions contributed (",
+          max_partitions_contributed_,
+          ") exceeds the one of the partition selection strategy (",
+          aggregator_max_partitions, ")."));
+    }
+    if (max_contributions_per_partition_ >
+        aggregator->GetMaxContributionsPerPartition()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Maximum number of contributions per partition (",
+          max_contributions_per_partition_,
+          ") exceeds the one of the aggregator (",
+          aggregator->GetMaxContributionsPerPartition(), ")."));
+    }
+    return Flush([aggregator](const Key& key, absl::Span<const T> values) {
+      return aggregator->AddEntries(key, values);
+    });
+  }
+
+  // Returns the number of users with contributions that were not flushed.
+  int64_t NumUsers() const {
+    int64_t num_users = 0;
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      absl::MutexLock lock(&shards_[shard].mutex);
+      num_users += shards_[shard].users.size();
+    }
+    return num_users;
+  }
+
+  int GetMaxPartitionsContributed() const {
+    return max_partitions_contributed_;
+  }
+
+  int GetMaxContributionsPerPartition() const {
+    return max_contributions_per_partition_;
+  }
+
+  int NumShards() const { return num_shards_; }
+
+ private:
+  // A sampled partition of a user and its sampled values.
+  struct KeptPartition {
+    Key key;
+    uint64_t priority;
+    // The number of non-NaN values of the user in the partition so far.
+    int64_t num_values;
+    std::vector<T> values;
+  };
+
+  // Kept partitions of a user, in no particular order.
+  using UserTable =
+      absl::flat_hash_map<UserId, std::vector<KeptPartition>, UserHash>;
+
+  struct alignas(64) Shard {
+    mutable absl::Mutex mutex;
+    UserTable users ABSL_GUARDED_BY(mutex);
+    // Draws the values kept by reservoir sampling.
+    std::mt19937_64 random ABSL_GUARDED_BY(mutex);
+  };
+
+  ContributionBounder(int max_partitions_contributed,
+                      int max_contributions_per_partition, int num_shards,
+                      int num_threads)
+      : max_partitions_contributed_(max_partitions_contributed),
+        max_contributions_per_partition_(max_contributions_per_partition),
+        num_shards_(num_shards),
+        num_threads_(num_threads),
+        seed_(SecureURBG::GetSingleton()()),
+        shards_(absl::make_unique<Shard[]>(num_shards)) {
+    for (int shard = 0; shard < num_shards; ++shard) {
+      shards_[shard].random.seed(SecureURBG::GetSingleton()());
+    }
+  }
+
+  // The finalizer of SplitMix64. The priorities must be close to independent
+  // and uniform for every user, which the container hashes alone do not
+  // guarantee for small integer keys.
+  static uint64_t Mix(uint64_t x) {
+    x = (x ^ (x >> 30)) * uint64_t{0xBF58476D1CE4E5B9};
+    x = (x ^ (x >> 27)) * uint64_t{0x94D049BB133111EB};
+    return x ^ (x >> 31);
+  }
+
+  void AddToShard(const Contribution& contribution, std::size_t user_hash,
+                  Shard* shard) ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mutex) {
+    // REF:
+    // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
+    if (std::isnan(static_cast<double>(contribution.value))) {
+      return;
+    }
+    std::vector<KeptPartition>& partitions =
+        shard->users[contribution.user_id];
+    for (KeptPartition& partition : partitions) {
+      if (partition.key == contribution.key) {
+        AddValue(contribution.value, &partition, &shard->random);
+        return;
+      }
+    }
+
+    // A new partition of the user. It replaces the kept partition with the
+    // largest priority if its own priority is smaller.
+    const uint64_t priority =
+        Mix(seed_ ^ Mix(user_hash ^ Mix(key_hash_(contribution.key))));
+    KeptPartition* slot;
+    if (partitions.size() < max_partitions_contributed_) {
+      partitions.push_back({contribution.key, priority, 0, {}});
+      slot = &partitions.back();
+    } else {
+      slot = &*std::max_element(
+          partitions.begin(), partitions.end(),
+          [](const KeptPartition& a, const KeptPartition& b) {
+            return a.priority < b.priority;
+          });
+      if (priority >= slot->priority) {
+        return;
+      }
+      slot->key = contribution.key;
+      slot->priority = priority;
+      slot->num_values = 0;
+      slot->values.clear();
+    }
+    AddValue(contribution.value, slot, &shard->random);
+  }
+
+  // Adds value to the reservoir of the partition.
+  void AddValue(const T& value, KeptPartition* partition,
+                std::mt19937_64* random) const {
+    ++partition->num_values;
+    if (partition->values.size() < max_contributions_per_partition_) {
+      partition->values.push_back(value);
+      return;
+    }
+    const int64_t index = std::uniform_int_distribution<int64_t>(
+        0, partition->num_values - 1)(*random);
+    if (index < max_contributions_per_partition_) {
+      partition->values[index] = value;
+    }
+  }
+
+  const int max_partitions_contributed_;
+  const int max_contributions_per_partition_;
+  const int num_shards_;
+  const int num_threads_;
+  // Keys the priorities of the partitions of every user.
+  const uint64_t seed_;
+  // Whether Flush has been called.
+  std::atomic<bool> flushed_{false};
+  UserHash user_hash_;
+  KeyHash key_hash_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
@@ -0,0 +1,320 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/contribution-bounder.h"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/partition-selection.h"
+#include "algorithms/partitioned-aggregator.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+using Bounder = ContributionBounder<int64_t, int64_t, double>;
+
+std::unique_ptr<Bounder> MakeBounder(int max_partitions,
+                                     int max_contributions,
+                                     int num_threads = 1) {
+  return Bounder::Builder()
+      .SetMaxPartitionsContributed(max_partitions)
+      .SetMaxContributionsPerPartition(max_contributions)
+      .SetNumShards(16)
+      .SetNumThreads(num_threads)
+      .Build()
+      .ValueOrDie();
+}
+
+// Flushes bounder and returns the kept values of each partition, over all
+// users.
+absl::flat_hash_map<int64_t, std::vector<std::vector<double>>> FlushAll(
+    Bounder* bounder) {
+  absl::flat_hash_map<int64_t, std::vector<std::vector<double>>> partitions;
+  EXPECT_OK(bounder->Flush(
+      [&](const int64_t& key, absl::Span<const double> values) {
+        partitions[key].emplace_back(values.begin(), values.end());
+        return absl::OkStatus();
+      }));
+  return partitions;
+}
+
+TEST(ContributionBounderTest, KeepsContributionsWithinBounds) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(2, 2);
+  ASSERT_OK(bounder->AddContribution(/*user_id=*/1, /*key=*/10, 1));
+  ASSERT_OK(bounder->AddContribution(1, 10, 2));
+  ASSERT_OK(bounder->AddContribution(1, 20, 3));
+  ASSERT_OK(bounder->AddContribution(2, 10, 4));
+  EXPECT_EQ(bounder->NumUsers(), 2);
+
+  auto partitions = FlushAll(bounder.get());
+  ASSERT_EQ(partitions.size(), 2);
+  EXPECT_THAT(partitions[10], SizeIs(2));
+  EXPECT_THAT(partitions[20], SizeIs(1));
+  EXPECT_THAT(partitions[20][0], ::testing::ElementsAre(3));
+  EXPECT_EQ(bounder->NumUsers(), 0);
+}
+
+TEST(ContributionBounderTest, BoundsPartitionsAndValuesPerUser) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(5, 3);
+  std::vector<Bounder::Contribution> contributions;
+  // Contributions to the same partitions are interleaved, so that dropped
+  // partitions are contributed to again.
+  for (int value = 0; value < 10; ++value) {
+    for (int64_t key = 0; key < 100; ++key) {
+      contributions.push_back({/*user_id=*/7, key, static_cast<double>(value)});
+    }
+  }
+  ASSERT_OK(bounder->AddContributions(contributions));
+
+  auto partitions = FlushAll(bounder.get());
+  EXPECT_EQ(partitions.size(), 5);
+  for (const auto& partition : partitions) {
+    ASSERT_THAT(partition.second, SizeIs(1));
+    EXPECT_THAT(partition.second[0], SizeIs(3));
+  }
+}
+
+TEST(ContributionBounderTest, DropsNan) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(1, 1);
+  ASSERT_OK(bounder->AddContribution(
+      1, 10, std::numeric_limits<double>::quiet_NaN()));
+  EXPECT_EQ(bounder->NumUsers(), 0);
+  ASSERT_OK(bounder->AddContribution(1, 10, 1));
+  auto partitions = FlushAll(bounder.get());
+  EXPECT_THAT(partitions[10], ::testing::ElementsAre(
+                                  ::testing::ElementsAre(1)));
+}
+
+TEST(ContributionBounderTest, SamplesPartitionsUniformly) {
+  const int kNumUsers = 10000;
+  std::unique_ptr<Bounder> bounder = MakeBounder(1, 1);
+  std::vector<Bounder::Contribution> contributions;
+  for (int64_t user = 0; user < kNumUsers; ++user) {
+    for (int64_t key = 0; key < 10; ++key) {
+      contributions.push_back({user, key, 1});
+    }
+  }
+  ASSERT_OK(bounder->AddContributions(contributions));
+
+  auto partitions = FlushAll(bounder.get());
+  ASSERT_EQ(partitions.size(), 10);
+  for (const auto& partition : partitions) {
+    // The expected number of users is 1000, with a standard deviation of 30.
+    EXPECT_NEAR(partition.second.size(), kNumUsers / 10, 150);
+  }
+}
+
+TEST(ContributionBounderTest, SamplesValuesUniformly) {
+  const int kNumUsers = 10000;
+  std::unique_ptr<Bounder> bounder = MakeBounder(1, 1);
+  for (int64_t user = 0; user < kNumUsers; ++user) {
+    for (int value = 0; value < 4; ++value) {
+      ASSERT_OK(bounder->AddContribution(user, 0, value));
+    }
+  }
+  auto partitions = FlushAll(bounder.get());
+  std::vector<int> num_kept(4, 0);
+  for (const std::vector<double>& values : partitions[0]) {
+    ASSERT_THAT(values, SizeIs(1));
+    ++num_kept[static_cast<int>(values[0])];
+  }
+  // The expected number is 2500, with a standard deviation of 43.
+  for (int value = 0; value < 4; ++value) {
+    EXPECT_NEAR(num_kept[value], kNumUsers / 4, 250);
+  }
+}
+
+TEST(ContributionBounderTest, ConcurrentBatchesMatchBounds) {
+  const int kNumThreads = 4;
+  const int kNumUsers = 2000;
+  std::unique_ptr<Bounder> bounder =
+      MakeBounder(3, 2, /*num_threads=*/kNumThreads);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.emplace_back([&bounder] {
+      std::vector<Bounder::Contribution> contributions;
+      for (int64_t user = 0; user < kNumUsers; ++user) {
+        for (int64_t key = 0; key < 5; ++key) {
+          contributions.push_back({user, key, 1});
+        }
+      }
+      ASSERT_OK(bounder->AddContributions(contributions));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(bounder->NumUsers(), kNumUsers);
+
+  int64_t num_partitions = 0;
+  int64_t num_values = 0;
+  ASSERT_OK(
+      bounder->Flush([&](const int64_t&, absl::Span<const double> values) {
+        ++num_partitions;
+        num_values += values.size();
+        return absl::OkStatus();
+      }));
+  // Every user contributed at least twice to all five partitions.
+  EXPECT_EQ(num_partitions, 3 * kNumUsers);
+  EXPECT_EQ(num_values, 2 * 3 * kNumUsers);
+}
+
+TEST(ContributionBounderTest, FailedFlushKeepsRemainingContributions) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(1, 1);
+  for (int64_t user = 0; user < 10; ++user) {
+    ASSERT_OK(bounder->AddContribution(user, user, 1));
+  }
+  int num_flushed = 0;
+  EXPECT_THAT(
+      bounder->Flush([&](const int64_t&, absl::Span<const double>) {
+        if (num_flushed == 4) {
+          return absl::ResourceExhaustedError("Full");
+        }
+        ++num_flushed;
+        return absl::OkStatus();
+      }),
+      StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_EQ(bounder->NumUsers(), 6);
+  EXPECT_EQ(FlushAll(bounder.get()).size(), 6);
+}
+
+TEST(ContributionBounderTest, RejectsContributionsAfterFlush) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(1, 2);
+  ASSERT_OK(bounder->AddContribution(1, 10, 1));
+  ASSERT_OK(bounder->AddContribution(1, 10, 2));
+  ASSERT_OK(bounder->AddContribution(1, 10, 3));
+  absl::flat_hash_map<int64_t, std::vector<std::vector<double>>> partitions =
+      FlushAll(bounder.get());
+  ASSERT_THAT(partitions[10], SizeIs(1));
+  EXPECT_THAT(partitions[10][0], SizeIs(2));
+
+  // The same user again, in the same and another partition. Adding them
+  // would let the user pass more than the bounds to the sink in total.
+  EXPECT_THAT(bounder->AddContribution(1, 10, 4),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("after the bounder was flushed")));
+  const std::vector<Bounder::Contribution> contributions = {{1, 20, 5}};
+  EXPECT_THAT(bounder->AddContributions(contributions),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_EQ(bounder->NumUsers(), 0);
+  EXPECT_TRUE(FlushAll(bounder.get()).empty());
+}
+
+// Keeps all partitions.
+class KeepAllSelection : public PartitionSelectionStrategy {
+ public:
+  explicit KeepAllSelection(int64_t max_partitions_contributed)
+      : PartitionSelectionStrategy(1, 1e-5, max_partitions_contributed, 1e-5) {}
+
+  bool ShouldKeep(int num_users) override { return true; }
+};
+
+std::unique_ptr<PartitionedAggregator<int64_t, double>> MakeAggregator(
+    int max_partitions, int max_contributions) {
+  return PartitionedAggregator<int64_t, double>::Builder()
+      .SetEpsilon(1)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetMaxContributionsPerPartition(max_contributions)
+      .SetPartitionSelectionStrategy(
+          absl::make_unique<KeepAllSelection>(max_partitions))
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(ContributionBounderTest, StreamsIntoAggregator) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(2, 1);
+  std::unique_ptr<PartitionedAggregator<int64_t, double>> aggregator =
+      MakeAggregator(2, 1);
+  for (int64_t user = 0; user < 100; ++user) {
+    ASSERT_OK(bounder->AddContribution(user, 1, 3));
+    ASSERT_OK(bounder->AddContribution(user, 1, 3));
+    ASSERT_OK(bounder->AddContribution(user, 2, 5));
+  }
+  ASSERT_OK(bounder->FlushInto(aggregator.get()));
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  ASSERT_THAT(results.value(), SizeIs(2));
+  for (const auto& result : results.value()) {
+    EXPECT_EQ(result.count, 100);
+    EXPECT_EQ(result.sum, result.key == 1 ? 300 : 500);
+  }
+}
+
+TEST(ContributionBounderTest, FlushIntoRejectsLooserBounds) {
+  std::unique_ptr<Bounder> bounder = MakeBounder(3, 2);
+  ASSERT_OK(bounder->AddContribution(1, 1, 1));
+  EXPECT_THAT(bounder->FlushInto(MakeAggregator(2, 2).get()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("partition selection strategy")));
+  EXPECT_THAT(bounder->FlushInto(MakeAggregator(3, 1).get()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("contributions per partition")));
+  EXPECT_EQ(bounder->NumUsers(), 1);
+}
+
+TEST(ContributionBounderTest, BuildValidatesParameters) {
+  EXPECT_THAT(Bounder::Builder().SetMaxPartitionsContributed(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of partitions")));
+  EXPECT_THAT(Bounder::Builder().SetMaxContributionsPerPartition(-1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(Bounder::Builder().SetNumShards(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of shards")));
+  EXPECT_THAT(Bounder::Builder().SetNumThreads(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of threads")));
+}
+
+TEST(ContributionBounderTest, SupportsStringKeys) {
+  auto bounder = ContributionBounder<std::string, std::string, int64_t>::
+                     Builder()
+                         .SetMaxPartitionsContributed(1)
+                         .Build()
+                         .ValueOrDie();
+  ASSERT_OK(bounder->AddContribution("alice", "a", 1));
+  ASSERT_OK(bounder->AddContribution("alice", "a", 2));
+  int num_partitions = 0;
+  ASSERT_OK(bounder->Flush(
+      [&](const std::string& key, absl::Span<const int64_t> values) {
+        EXPECT_EQ(key, "a");
+        EXPECT_THAT(values, SizeIs(1));
+        ++num_partitions;
+        return absl::OkStatus();
+      }));
+  EXPECT_EQ(num_partitions, 1);
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,313 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_COUNT_DISTINCT_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_COUNT_DISTINCT_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "google/protobuf/any.pb.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
+#include "algorithms/util.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+namespace internal {
+
+// The finalizer of SplitMix64, a bijection that mixes all bits of x.
+inline uint64_t MixFingerprint(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+// Returns a 64-bit fingerprint of value that is the same in every process, so
+// that sketches of different machines can be merged, unlike absl::Hash, which
+// is seeded per process. Equal integral values of different types have the
+// same fingerprint, and so do 0 and -0.
+template <typename T, std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+uint64_t DistinctFingerprint(T value) {
+  return MixFingerprint(static_cast<uint64_t>(static_cast<int64_t>(value)));
+}
+
+template <typename T,
+          std::enable_if_t<std::is_floating_point<T>::value>* = nullptr>
+uint64_t DistinctFingerprint(T value) {
+  double normalized = value == 0 ? 0.0 : static_cast<double>(value);
+  uint64_t bits;
+  std::memcpy(&bits, &normalized, sizeof(bits));
+  return MixFingerprint(bits);
+}
+
+// MurmurHash64A with a fixed seed.
+inline uint64_t DistinctFingerprint(absl::string_view value) {
+  constexpr uint64_t kMul = 0xc6a4a7935bd1e995;
+  constexpr int kShift = 47;
+  uint64_t h = 0x8445d61a4e774912 ^ (value.size() * kMul);
+  const char* data = value.data();
+  const char* const end = data + (value.size() & ~size_t{7});
+  for (; data != end; data += 8) {
+    uint64_t k;
+    std::memcpy(&k, data, sizeof(k));
+    k *= kMul;
+    k ^= k >> kShift;
+    k *= kMul;
+    h ^= k;
+    h *= kMul;
+  }
+  const size_t remaining = value.size() & 7;
+  if (remaining > 0) {
+    uint64_t k = 0;
+    for (size_t i = 0; i < remaining; ++i) {
+      k |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+           << (8 * i);
+    }
+    h ^= k;
+    h *= kMul;
+  }
+  h ^= h >> kShift;
+  h *= kMul;
+  h ^= h >> kShift;
+  return h;
+}
+
+inline uint64_t DistinctFingerprint(const std::string& value) {
+  return DistinctFingerprint(absl::string_view(value));
+}
+
+}  // namespace internal
+
+// CountDistinct counts the number of distinct values in a dataset, with
+// differentially private noise, e.g., the number of distinct items bought.
+//
+// Instead of the values themselves, it stores a sketch of the distinct 64-bit
+// fingerprints of the values whose fingerprint falls below a fixed sampling
+// threshold, i.e., a fraction sampling_rate of all distinct values in
+// expectation. The sketch is mergeable: the sketch of the union of datasets
+// is the union of their sketches, so distinct counts can be computed across
+// shards and machines. With the default sampling rate of 1, all fingerprints
+// are kept and the count is exact up to fingerprint collisions.
+//
+// Sensitivity: a privacy unit may contribute at most
+// max_partitions_contributed * max_contributions_per_partition distinct
+// values, which the caller must ensure, e.g., with a ContributionBounder.
+// Removing a privacy unit removes at most that many fingerprints from the
+// sketch, whatever the other values, so the number of sampled fingerprints is
+// noised with this sensitivity. The released estimate is the noisy number of
+// sampled fingerprints divided by the sampling rate, which is post-processing.
+// Because the sampling threshold is fixed rather than adapted to the data,
+// sampling does not weaken the privacy guarantee; adaptive sketches such as
+// HyperLogLog or k minimum values have no such bound on the change of their
+// estimate. The noise confidence interval does not include the sampling
+// error, which has a relative standard deviation of about
+// sqrt((1 - sampling_rate) / (sampling_rate * count)).
+template <typename T>
+class CountDistinct : public Algorithm<T> {
+ public:
+  class Builder : public AlgorithmBuilder<T, CountDistinct<T>, Builder> {
+   public:
+    // Fraction of the distinct values that are kept in the sketch, in (0, 1].
+    // The sketch holds about sampling_rate * 8 bytes per distinct value.
+    Builder& SetSamplingRate(double sampling_rate) {
+      sampling_rate_ = sampling_rate;
+      return *this;
+    }
+
+   private:
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, CountDistinct<T>, Builder>;
+
+    base::StatusOr<std::unique_ptr<CountDistinct<T>>> BuildAlgorithm()
+        override {
+      RETURN_IF_ERROR(ValidateIsInInterval(sampling_rate_, 0, 1,
+                                           /*include_lower=*/false,
+                                           /*include_upper=*/true,
+                                           "Sampling rate"));
+      std::unique_ptr<NumericalMechanism> mechanism;
+      ASSIGN_OR_RETURN(mechanism, AlgorithmBuilder::UpdateAndBuildMechanism());
+      return absl::WrapUnique(
+          new CountDistinct<T>(AlgorithmBuilder::GetEpsilon().value(),
+                               sampling_rate_, std::move(mechanism)));
+    }
+
+    double sampling_rate_ = 1;
+  };
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& v) override { AddFingerprint(v); }
+
+  // Adding a value several times counts it once.
+  void AddEntryWithCount(const T& v, uint64_t num_of_entries) override {
+    if (num_of_entries > 0) {
+      AddFingerprint(v);
+    }
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    for (const T& v : entries) {
+      AddFingerprint(v);
+    }
+  }
+
+  // The interval of the noise on the estimate, not including the sampling
+  // error.
+  base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
+      double confidence_level, double privacy_budget = 1) override {
+    ASSIGN_OR_RETURN(ConfidenceInterval interval,
+                     mechanism_->NoiseConfidenceInterval(confidence_level,
+                                                         privacy_budget));
+    interval.set_lower_bound(interval.lower_bound() / sampling_rate_);
+    interval.set_upper_bound(interval.upper_bound() / sampling_rate_);
+    return interval;
+  }
+
+  Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
+    CountDistinctSummary count_distinct_summary;
+    count_distinct_summary.mutable_fingerprint()->Reserve(fingerprints_.size());
+    for (uint64_t fingerprint : fingerprints_) {
+      count_distinct_summary.add_fingerprint(fingerprint);
+    }
+    count_distinct_summary.set_sampling_rate(sampling_rate_);
+    Summary summary;
+    summary.mutable_data()->PackFrom(count_distinct_summary);
+    return summary;
+  }
+
+  // Adds the fingerprints of a summary of a CountDistinct with the same
+  // sampling rate.
+  absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no count distinct data.");
+    }
+    CountDistinctSummary count_distinct_summary;
+    if (!summary.data().UnpackTo(&count_distinct_summary)) {
+      return absl::InternalError(
+          "Count distinct summary unable to be unpacked.");
+    }
+    if (count_distinct_summary.sampling_rate() != sampling_rate_) {
+      return absl::InvalidArgumentError(
+          "Merged count distinct must have the same sampling rate.");
+    }
+    fingerprints_.reserve(fingerprints_.size() +
+                          count_distinct_summary.fingerprint_size());
+    fingerprints_.insert(count_distinct_summary.fingerprint().begin(),
+                         count_distinct_summary.fingerprint().end());
+    return absl::OkStatus();
+  }
+
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_count = dynamic_cast<CountDistinct<T>*>(&other);
+    if (other_count == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    if (other_count->sampling_rate_ != sampling_rate_) {
+      return absl::InvalidArgumentError(
+          "Merged count distinct must have the same sampling rate.");
+    }
+    fingerprints_.insert(other_count->fingerprints_.begin(),
+                         other_count->fingerprints_.end());
+    return absl::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    return sizeof(CountDistinct<T>) +
+           fingerprints_.capacity() * (sizeof(uint64_t) + 1) +
+           mechanism_->MemoryUsed();
+  }
+
+  // Returns the number of fingerprints in the sketch.
+  int64_t NumSampled() const { return fingerprints_.size(); }
+
+  double GetSamplingRate() const { return sampling_rate_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+    const double noisy_sampled =
+        mechanism_->AddNoise(fingerprints_.size(), privacy_budget);
+    int64_t estimate;
+    SafeCastFromDouble(std::round(noisy_sampled / sampling_rate_), estimate);
+    Output output;
+    AddToOutput<int64_t>(&output, estimate);
+
+    base::StatusOr<ConfidenceInterval> interval =
+        NoiseConfidenceInterval(noise_interval_level, privacy_budget);
+    if (interval.ok()) {
+      *(output.mutable_error_report()->mutable_noise_confidence_interval()) =
+          interval.value();
+    }
+    return output;
+  }
+
+  void ResetState() override { fingerprints_.clear(); }
+
+ private:
+  CountDistinct(double epsilon, double sampling_rate,
+                std::unique_ptr<NumericalMechanism> mechanism)
+      : Algorithm<T>(epsilon),
+        sampling_rate_(sampling_rate),
+        // A rate of 1 keeps all fingerprints, see Sampled().
+        threshold_(sampling_rate < 1
+                       ? static_cast<uint64_t>(std::ldexp(sampling_rate, 64))
+                       : 0),
+        mechanism_(std::move(mechanism)) {}
+
+  bool Sampled(uint64_t fingerprint) const {
+    return sampling_rate_ == 1 || fingerprint < threshold_;
+  }
+
+  void AddFingerprint(const T& v) {
+    if constexpr (std::is_floating_point<T>::value) {
+      if (std::isnan(v)) {
+        return;
+      }
+    }
+    const uint64_t fingerprint = internal::DistinctFingerprint(v);
+    if (Sampled(fingerprint)) {
+      fingerprints_.insert(fingerprint);
+    }
+  }
+
+  const double sampling_rate_;
+  // Fingerprints below the threshold are sampled.
+  const uint64_t threshold_;
+  std::unique_ptr<NumericalMechanism> mechanism_;
+  absl::flat_hash_set<uint64_t> fingerprints_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_COUNT_DISTINCT_H_
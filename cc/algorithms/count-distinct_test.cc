@@ -0,0 +1,172 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/count-distinct.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+template <typename T>
+std::unique_ptr<CountDistinct<T>> MakeCountDistinct(double sampling_rate = 1) {
+  return typename CountDistinct<T>::Builder()
+      .SetEpsilon(1)
+      .SetSamplingRate(sampling_rate)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+template <typename T>
+class CountDistinctTest : public testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(CountDistinctTest, NumericTypes);
+
+TYPED_TEST(CountDistinctTest, CountsDistinctValues) {
+  std::unique_ptr<CountDistinct<TypeParam>> count =
+      MakeCountDistinct<TypeParam>();
+  count->AddEntries({1, 2, 3, 2, 3, 3});
+  count->AddEntry(4);
+  count->AddEntryWithCount(5, 10);
+  count->AddEntryWithCount(6, 0);
+  EXPECT_EQ(count->NumSampled(), 5);
+
+  base::StatusOr<Output> result = count->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 5);
+}
+
+TEST(CountDistinctTest, CountsDistinctStrings) {
+  std::unique_ptr<CountDistinct<std::string>> count =
+      MakeCountDistinct<std::string>();
+  count->AddEntries({"apple", "pear", "apple", "", "a longer key than eight"});
+  count->AddEntry("pear");
+  EXPECT_EQ(GetValue<int64_t>(count->PartialResult().ValueOrDie()), 4);
+}
+
+TEST(CountDistinctTest, IgnoresNanAndSignOfZero) {
+  std::unique_ptr<CountDistinct<double>> count = MakeCountDistinct<double>();
+  count->AddEntries({0.0, -0.0, std::nan(""), 1.5});
+  EXPECT_EQ(count->NumSampled(), 2);
+}
+
+TEST(CountDistinctTest, SamplingEstimatesDistinctCount) {
+  const int kNumDistinct = 100000;
+  const double kSamplingRate = 0.1;
+  std::unique_ptr<CountDistinct<int64_t>> count =
+      MakeCountDistinct<int64_t>(kSamplingRate);
+  for (int64_t i = 0; i < kNumDistinct; ++i) {
+    count->AddEntryWithCount(i, 3);
+  }
+  // The number of sampled values has a standard deviation of about 95.
+  EXPECT_NEAR(count->NumSampled(), kNumDistinct * kSamplingRate, 500);
+  EXPECT_NEAR(GetValue<int64_t>(count->PartialResult().ValueOrDie()),
+              kNumDistinct, 5000);
+}
+
+TEST(CountDistinctTest, SerializeAndMergeTakeTheUnion) {
+  std::unique_ptr<CountDistinct<std::string>> count =
+      MakeCountDistinct<std::string>(0.5);
+  std::unique_ptr<CountDistinct<std::string>> merged =
+      MakeCountDistinct<std::string>(0.5);
+  std::unique_ptr<CountDistinct<std::string>> expected =
+      MakeCountDistinct<std::string>(0.5);
+  for (int i = 0; i < 1000; ++i) {
+    count->AddEntry(absl::StrCat("key", i));
+    merged->AddEntry(absl::StrCat("key", i + 500));
+    expected->AddEntry(absl::StrCat("key", i));
+    expected->AddEntry(absl::StrCat("key", i + 500));
+  }
+  ASSERT_OK(merged->Merge(count->Serialize()));
+  EXPECT_EQ(merged->NumSampled(), expected->NumSampled());
+
+  EXPECT_THAT(MakeCountDistinct<std::string>(1)->Merge(count->Serialize()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same sampling rate")));
+  EXPECT_THAT(merged->Merge(Summary()), StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(CountDistinctTest, MergeFrom) {
+  std::unique_ptr<CountDistinct<int64_t>> count = MakeCountDistinct<int64_t>();
+  std::unique_ptr<CountDistinct<int64_t>> other = MakeCountDistinct<int64_t>();
+  count->AddEntries({1, 2, 3});
+  other->AddEntries({3, 4});
+  ASSERT_OK(count->MergeFrom(*other));
+  EXPECT_EQ(GetValue<int64_t>(count->PartialResult().ValueOrDie()), 4);
+
+  std::unique_ptr<CountDistinct<int64_t>> sampled =
+      MakeCountDistinct<int64_t>(0.5);
+  EXPECT_THAT(count->MergeFrom(*sampled),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same sampling rate")));
+}
+
+TEST(CountDistinctTest, NoiseIsCalibratedToDistinctValuesPerPrivacyUnit) {
+  std::unique_ptr<CountDistinct<int64_t>> count =
+      CountDistinct<int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetMaxPartitionsContributed(2)
+          .SetMaxContributionsPerPartition(3)
+          .SetSamplingRate(0.5)
+          .Build()
+          .ValueOrDie();
+  LaplaceMechanism::Builder builder;
+  std::unique_ptr<NumericalMechanism> expected =
+      builder.SetEpsilon(1)
+          .SetL0Sensitivity(2)
+          .SetLInfSensitivity(3)
+          .Build()
+          .ValueOrDie();
+  ConfidenceInterval expected_interval =
+      expected->NoiseConfidenceInterval(0.95, 1).ValueOrDie();
+  ConfidenceInterval interval =
+      count->NoiseConfidenceInterval(0.95).ValueOrDie();
+  EXPECT_DOUBLE_EQ(interval.lower_bound(),
+                   expected_interval.lower_bound() / 0.5);
+  EXPECT_DOUBLE_EQ(interval.upper_bound(),
+                   expected_interval.upper_bound() / 0.5);
+}
+
+TEST(CountDistinctTest, BuildValidatesSamplingRate) {
+  for (double rate : {0.0, -0.5, 1.5, std::nan("")}) {
+    EXPECT_THAT(CountDistinct<int64_t>::Builder()
+                    .SetEpsilon(1)
+                    .SetSamplingRate(rate)
+                    .Build(),
+                StatusIs(absl::StatusCode::kInvalidArgument,
+                         HasSubstr("Sampling rate")));
+  }
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -21,7 +21,9 @@
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
+#include "algorithms/metrics.h"
 #include "algorithms/numerical-mechanisms.h"
+#include "algorithms/tracing.h"
 #include "algorithms/util.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
@@ -35,16 +37,43 @@ class Count : public Algorithm<T> {
  public:
   class Builder;
 
-  void AddEntry(const T& v) override { AddMultipleEntries(v, 1); }
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& v) override {
+    metrics::Add(metrics::Counter::kCountEntries);
+    AddMultipleEntries(v, 1);
+  }
+
+  void AddEntryWithCount(const T& v, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kCountEntries, num_of_entries);
+    AddMultipleEntries(v, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kCountEntries, entries.size());
+    count_ += entries.size();
+  }
+
+  absl::Status RemoveEntryWithCount(const T& v,
+                                    uint64_t num_of_entries) override {
+    if (num_of_entries > count_) {
+      return absl::InvalidArgumentError(
+          "Cannot remove more entries than were added.");
+    }
+    count_ -= num_of_entries;
+    return absl::OkStatus();
+  }
 
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
       double confidence_level, double privacy_budget = 1) override {
+    RETURN_IF_ERROR(BuildMechanismIfNeeded());
     return mechanism_->NoiseConfidenceInterval(confidence_level,
                                                privacy_budget);
   }
 
   // Create and return summary containing the count.
   Summary Serialize() override {
+    tracing::ScopedSpan span(tracing::TracePoint::kSerialize);
     // Create CountSummary.
     CountSummary count_summ;
     count_summ.set_count(count_);
@@ -52,14 +81,18 @@ class Count : public Algorithm<T> {
     // Create Summary.
     Summary summary;
     summary.mutable_data()->PackFrom(count_summ);
+    metrics::Add(metrics::Counter::kSerializedBytes,
+                 summary.data().value().size());
     return summary;
   }
 
   // Add count from serialized data.
   absl::Status Merge(const Summary& summary) override {
+    tracing::ScopedSpan span(tracing::TracePoint::kMerge);
     if (!summary.has_data()) {
       return absl::InternalError("Cannot merge summary with no count data.");
     }
+    metrics::Add(metrics::Counter::kMergedBytes, summary.data().value().size());
 
     // Add counts.
     CountSummary count_summary;
@@ -71,11 +104,23 @@ class Count : public Algorithm<T> {
     return absl::OkStatus();
   }
 
+  absl::Status MergeFrom(Algorithm<T>& other) override {
+    auto* other_count = dynamic_cast<Count<T>*>(&other);
+    if (other_count == nullptr) {
+      return Algorithm<T>::MergeFrom(other);
+    }
+    count_ += other_count->count_;
+    return absl::OkStatus();
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(Count<T>);
     if (mechanism_) {
       memory += mechanism_->MemoryUsed();
     }
+    if (mechanism_builder_) {
+      memory += sizeof(*mechanism_builder_);
+    }
     return memory;
   }
 
@@ -85,11 +130,9 @@ class Count : public Algorithm<T> {
     RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
                                        absl::StatusCode::kFailedPrecondition));
 
+    RETURN_IF_ERROR(BuildMechanismIfNeeded());
     Output output;
-    int64_t countWithNoise;
-    SafeCastFromDouble(std::round(mechanism_->AddNoise(count_, privacy_budget)),
-                       countWithNoise);
-    AddToOutput<int64_t>(&output, countWithNoise);
+    AddToOutput<int64_t>(&output, NoisyCount(privacy_budget));
 
     base::StatusOr<ConfidenceInterval> interval =
         NoiseConfidenceInterval(noise_interval_level, privacy_budget);
@@ -100,15 +143,53 @@ class Count : public Algorithm<T> {
     return output;
   }
 
+  base::StatusOr<ResultValue> GenerateResultValue(
+      double privacy_budget, double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+
+    RETURN_IF_ERROR(BuildMechanismIfNeeded());
+    ResultValue result;
+    result.value = NoisyCount(privacy_budget);
+    base::StatusOr<ConfidenceInterval> interval =
+        NoiseConfidenceInterval(noise_interval_level, privacy_budget);
+    if (interval.ok()) {
+      result.noise_interval = ToNoiseInterval(interval.value());
+    }
+    return result;
+  }
+
   void ResetState() override { count_ = 0; }
 
   uint64_t GetCount() const { return count_; }
 
-  // The constructor and count_ are non-private for testing.
-  Count(double epsilon, std::unique_ptr<NumericalMechanism> mechanism)
-      : Algorithm<T>(epsilon), count_(0), mechanism_(std::move(mechanism)) {}
+  // The constructor and count_ are non-private for testing. If mechanism is
+  // nullptr, it is built from mechanism_builder when it is first needed.
+  Count(double epsilon, std::unique_ptr<NumericalMechanism> mechanism,
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder = nullptr)
+      : Algorithm<T>(epsilon),
+        count_(0),
+        mechanism_(std::move(mechanism)),
+        mechanism_builder_(std::move(mechanism_builder)) {}
 
  private:
+  // Returns the count with noise, rounded to an integer. The mechanism must be
+  // built.
+  int64_t NoisyCount(double privacy_budget) {
+    int64_t count_with_noise;
+    SafeCastFromDouble(std::round(mechanism_->AddNoise(count_, privacy_budget)),
+                       count_with_noise);
+    return count_with_noise;
+  }
+
+  absl::Status BuildMechanismIfNeeded() {
+    if (!mechanism_) {
+      ASSIGN_OR_RETURN(mechanism_, mechanism_builder_->Build());
+      mechanism_builder_.reset();
+    }
+    return absl::OkStatus();
+  }
+
   void AddMultipleEntries(const T& v, uint64_t num_of_entries) {
     count_ += num_of_entries;
   }
@@ -118,6 +199,10 @@ class Count : public Algorithm<T> {
 
   uint64_t count_;
   std::unique_ptr<NumericalMechanism> mechanism_;
+
+  // Configured builder of the mechanism if it is built lazily, until it is
+  // built.
+  std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
 };
 
 template <typename T>
@@ -128,6 +213,11 @@ class Count<T>::Builder
       differential_privacy::AlgorithmBuilder<T, Count<T>, Count<T>::Builder>;
 
   base::StatusOr<std::unique_ptr<Count<T>>> BuildAlgorithm() override {
+    if (AlgorithmBuilder::GetLazyMechanism()) {
+      return absl::WrapUnique(new Count<T>(
+          AlgorithmBuilder::GetEpsilon().value(), /*mechanism=*/nullptr,
+          AlgorithmBuilder::UpdateMechanismBuilder()));
+    }
     std::unique_ptr<NumericalMechanism> mechanism;
     ASSIGN_OR_RETURN(mechanism, AlgorithmBuilder::UpdateAndBuildMechanism());
 
@@ -176,6 +176,22 @@ TEST(CountTest, MergeTest) {
   EXPECT_EQ(GetValue<int64_t>(*result), 3);
 }
 
+TEST(CountTest, MergeFromTest) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto count = builder.Build();
+  ASSERT_OK(count);
+  auto other = builder.Build();
+  ASSERT_OK(other);
+  (*count)->AddEntry(0);
+  (*other)->AddEntries(std::vector<double>{1, 2});
+
+  EXPECT_OK((*count)->MergeFrom(**other));
+  auto result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 3);
+}
+
 TEST(CountTest, SerializeAndMergeOverflowTest) {
   Count<uint64_t>::Builder builder;
   builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
@@ -203,11 +219,142 @@ TEST(CountTest, SerializeAndMergeOverflowTest) {
   EXPECT_DOUBLE_EQ(GetValue<int64_t>(result.value()), 0);
 }
 
+TYPED_TEST(CountTest, AddEntriesSpanMatchesAddEntry) {
+  std::vector<TypeParam> a = {1, 2, 3, 4, 2, 3};
+  auto count1 = typename Count<TypeParam>::Builder().Build();
+  ASSERT_OK(count1);
+  auto count2 = typename Count<TypeParam>::Builder().Build();
+  ASSERT_OK(count2);
+
+  for (const TypeParam& v : a) {
+    (*count1)->AddEntry(v);
+  }
+  (*count2)->AddEntries(absl::MakeConstSpan(a));
+
+  EXPECT_THAT((*count2)->Serialize(), EqualsProto((*count1)->Serialize()));
+}
+
 TEST(CountTest, MemoryUsed) {
   auto count = Count<double>::Builder().Build();
   ASSERT_OK(count);
   EXPECT_GT((*count)->MemoryUsed(), 0);
 }
 
+TEST(CountTest, AddEntryWithCount) {
+  auto count = Count<double>::Builder()
+                   .SetLaplaceMechanism(
+                       absl::make_unique<ZeroNoiseMechanism::Builder>())
+                   .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntryWithCount(1.5, 1000000);
+  (*count)->AddEntry(2);
+  auto result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 1000001);
+}
+
+
+TEST(CountTest, LazyMechanismIsBuiltOnFirstResult) {
+  // The Gaussian mechanism requires a delta, so building it fails.
+  EXPECT_FALSE(Count<double>::Builder()
+                   .SetEpsilon(1.0)
+                   .SetLaplaceMechanism(
+                       absl::make_unique<GaussianMechanism::Builder>())
+                   .Build()
+                   .ok());
+  base::StatusOr<std::unique_ptr<Count<double>>> lazy =
+      Count<double>::Builder()
+          .SetEpsilon(1.0)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(lazy);
+  (*lazy)->AddEntry(1);
+  EXPECT_THAT((*lazy)->PartialResult(),
+              StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+}
+
+TEST(CountTest, LazyMechanismMatchesEagerMechanism) {
+  base::StatusOr<std::unique_ptr<Count<double>>> count =
+      Count<double>::Builder()
+          .SetEpsilon(1.0)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetLazyMechanism(true)
+          .Build();
+  ASSERT_OK(count);
+  std::vector<double> entries = {1, 2, 3};
+  (*count)->AddEntries(entries);
+  EXPECT_OK((*count)->NoiseConfidenceInterval(0.95));
+  base::StatusOr<Output> result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 3);
+}
+
+TEST(CountTest, RvalueBuildMovesMechanismBuilder) {
+  int clones = 0;
+  Count<double>::Builder builder;
+  builder.SetEpsilon(1.0).SetLaplaceMechanism(
+      absl::make_unique<test_utils::CloneCountingMechanismBuilder>(&clones));
+  base::StatusOr<std::unique_ptr<Count<double>>> copied = builder.Build();
+  ASSERT_OK(copied);
+  EXPECT_EQ(clones, 1);
+
+  clones = 0;
+  base::StatusOr<std::unique_ptr<Count<double>>> moved =
+      std::move(builder).Build();
+  ASSERT_OK(moved);
+  EXPECT_EQ(clones, 0);
+
+  std::vector<double> entries = {1, 2, 3};
+  (*copied)->AddEntries(entries);
+  (*moved)->AddEntries(entries);
+  EXPECT_EQ(GetValue<int64_t>((*copied)->PartialResult().ValueOrDie()), 3);
+  EXPECT_EQ(GetValue<int64_t>((*moved)->PartialResult().ValueOrDie()), 3);
+}
+
+TEST(CountTest, RemoveEntryWithCount) {
+  auto count = Count<double>::Builder()
+                   .SetLaplaceMechanism(
+                       absl::make_unique<ZeroNoiseMechanism::Builder>())
+                   .Build();
+  ASSERT_OK(count);
+  (*count)->AddEntryWithCount(1.5, 10);
+  EXPECT_OK((*count)->RemoveEntryWithCount(1.5, 4));
+  EXPECT_THAT((*count)->RemoveEntryWithCount(1.5, 7),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("more entries than were added")));
+  auto result = (*count)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 6);
+}
+
+TEST(CountTest, PartialResultValueMatchesPartialResult) {
+  double level = .9;
+  std::unique_ptr<Count<double>> counts[2];
+  for (auto& count : counts) {
+    auto built =
+        Count<double>::Builder()
+            .SetLaplaceMechanism(
+                absl::make_unique<ZeroNoiseMechanism::Builder>())
+            .SetEpsilon(0.5)
+            .Build();
+    ASSERT_OK(built);
+    count = std::move(*built);
+    count->AddEntryWithCount(1, 7);
+  }
+  auto output = counts[0]->PartialResult(1, level);
+  ASSERT_OK(output);
+  auto value = counts[1]->PartialResultValue(1, level);
+  ASSERT_OK(value);
+  EXPECT_EQ(value->value, GetValue<int64_t>(*output));
+  ASSERT_TRUE(value->noise_interval.has_value());
+  const ConfidenceInterval& interval =
+      output->error_report().noise_confidence_interval();
+  EXPECT_EQ(value->noise_interval->lower_bound, interval.lower_bound());
+  EXPECT_EQ(value->noise_interval->upper_bound, interval.upper_bound());
+  EXPECT_EQ(value->noise_interval->confidence_level, level);
+  EXPECT_EQ(counts[1]->RemainingPrivacyBudget(), 0);
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -0,0 +1,143 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/csv-ingestion.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+
+namespace differential_privacy {
+
+base::StatusOr<std::unique_ptr<MappedFile>> MappedFile::Open(
+    const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::NotFoundError(
+        absl::StrCat("Cannot open ", path, ": ", std::strerror(errno)));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const int error = errno;
+    close(fd);
+    return absl::InternalError(
+        absl::StrCat("Cannot stat ", path, ": ", std::strerror(error)));
+  }
+  const int64_t size = file_stat.st_size;
+  // Mapping zero bytes fails, and an empty file has no data to map.
+  if (size == 0) {
+    close(fd);
+    return absl::WrapUnique(new MappedFile(nullptr, 0));
+  }
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  const int error = errno;
+  // The mapping stays valid after closing the file.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return absl::InternalError(
+        absl::StrCat("Cannot map ", path, ": ", std::strerror(error)));
+  }
+  // The file is read once from start to end.
+  madvise(data, size, MADV_SEQUENTIAL);
+  return absl::WrapUnique(new MappedFile(static_cast<const char*>(data), size));
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+}
+
+namespace internal {
+
+bool ParseCsvNumber(absl::string_view field, int64_t* value) {
+  return absl::SimpleAtoi(field, value);
+}
+
+bool ParseCsvNumber(absl::string_view field, double* value) {
+  return absl::SimpleAtod(field, value);
+}
+
+std::vector<absl::string_view> SplitCsvChunks(absl::string_view csv,
+                                              int num_chunks) {
+  std::vector<absl::string_view> chunks;
+  const char* const end = csv.data() + csv.size();
+  const char* begin = csv.data();
+  for (int i = 1; i < num_chunks && begin != end; ++i) {
+    // Cut after the first newline following the target size of the chunks.
+    const char* target = std::max(
+        begin, csv.data() + static_cast<int64_t>(csv.size()) * i / num_chunks);
+    const void* newline = std::memchr(target, '\n', end - target);
+    if (newline == nullptr) {
+      break;
+    }
+    const char* chunk_end = static_cast<const char*>(newline) + 1;
+    chunks.emplace_back(begin, chunk_end - begin);
+    begin = chunk_end;
+  }
+  chunks.emplace_back(begin, end - begin);
+  return chunks;
+}
+
+absl::Status ForEachCsvLine(
+    absl::string_view chunk,
+    const std::function<absl::Status(absl::string_view, int64_t)>& fn) {
+  const char* const end = chunk.data() + chunk.size();
+  const char* begin = chunk.data();
+  while (begin != end) {
+    const void* newline = std::memchr(begin, '\n', end - begin);
+    const char* line_end =
+        newline == nullptr ? end : static_cast<const char*>(newline);
+    absl::string_view line(begin, line_end - begin);
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (!line.empty()) {
+      RETURN_IF_ERROR(fn(line, begin - chunk.data()));
+    }
+    begin = line_end == end ? end : line_end + 1;
+  }
+  return absl::OkStatus();
+}
+
+bool SplitCsvFields(absl::string_view line, char delimiter, int num_fields,
+                    absl::string_view* fields) {
+  const char* const end = line.data() + line.size();
+  const char* begin = line.data();
+  for (int i = 0; i < num_fields; ++i) {
+    if (begin == nullptr) {
+      return false;
+    }
+    const void* found = std::memchr(begin, delimiter, end - begin);
+    const char* field_end =
+        found == nullptr ? end : static_cast<const char*>(found);
+    fields[i] = absl::string_view(begin, field_end - begin);
+    // After the last field, there is no next one.
+    begin = found == nullptr ? nullptr : field_end + 1;
+  }
+  return true;
+}
+
+}  // namespace internal
+}  // namespace differential_privacy
@@ -0,0 +1,212 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_CSV_INGESTION_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_CSV_INGESTION_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/merge-all.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Reads numeric columns of CSV files and feeds them to algorithms through the
+// batch AddEntries API, instead of parsing the file line by line and adding
+// one entry per row:
+//
+//   std::unique_ptr<Algorithm<double>> sum = ...;
+//   std::unique_ptr<Algorithm<double>> mean = ...;
+//   RETURN_IF_ERROR(AddCsvColumnEntries<double>(
+//       "data.csv", /*column=*/1, {sum.get(), mean.get()}));
+//
+// The file is memory-mapped and split into chunks at line boundaries, which
+// are parsed in parallel. Lines and fields are found with memchr, which the C
+// library vectorizes. Fields are not unquoted; this is meant for numeric
+// columns, e.g., the output of a database export.
+
+struct CsvOptions {
+  char delimiter = ',';
+  // Whether the first line is a header that is not parsed.
+  bool skip_header = false;
+  // Number of threads that parse the chunks and add the entries. Defaults to
+  // the number of hardware threads.
+  int num_threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+// A read-only memory mapping of a whole file, unmapped on destruction.
+class MappedFile {
+ public:
+  static base::StatusOr<std::unique_ptr<MappedFile>> Open(
+      const std::string& path);
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  absl::string_view data() const { return absl::string_view(data_, size_); }
+
+ private:
+  MappedFile(const char* data, int64_t size) : data_(data), size_(size) {}
+
+  const char* data_;
+  int64_t size_;
+};
+
+namespace internal {
+
+// Parses a numeric field, ignoring surrounding whitespace. Returns false if
+// the field is not a number.
+bool ParseCsvNumber(absl::string_view field, int64_t* value);
+bool ParseCsvNumber(absl::string_view field, double* value);
+
+// Splits csv into at most num_chunks chunks of whole lines, of roughly equal
+// sizes. All chunks but the last end with a newline.
+std::vector<absl::string_view> SplitCsvChunks(absl::string_view csv,
+                                              int num_chunks);
+
+// Calls fn(line, offset) for every non-empty line of chunk, without the
+// trailing "\n" or "\r\n", where offset is the position of the line in the
+// chunk. Stops at the first error of fn.
+absl::Status ForEachCsvLine(
+    absl::string_view chunk,
+    const std::function<absl::Status(absl::string_view, int64_t)>& fn);
+
+// Splits line into its first num_fields fields. Returns false if the line has
+// fewer fields.
+bool SplitCsvFields(absl::string_view line, char delimiter, int num_fields,
+                    absl::string_view* fields);
+
+// Chunks smaller than this are not worth a thread.
+constexpr int64_t kMinCsvChunkBytes = 1 << 20;
+
+}  // namespace internal
+
+// Parses the given columns of csv, counted from 0, and returns the values of
+// every column in row order. Empty lines are skipped. Fails with an
+// InvalidArgument error if a line has too few fields or a field is not a
+// number.
+template <typename T>
+base::StatusOr<std::vector<std::vector<T>>> ParseCsvColumns(
+    absl::string_view csv, absl::Span<const int> columns,
+    const CsvOptions& options = CsvOptions()) {
+  static_assert(
+      std::is_same<T, int64_t>::value || std::is_same<T, double>::value,
+      "CSV columns can only be parsed as int64_t or double");
+  if (columns.empty()) {
+    return absl::InvalidArgumentError("At least one column must be parsed.");
+  }
+  for (int column : columns) {
+    if (column < 0) {
+      return absl::InvalidArgumentError("Columns must be non-negative.");
+    }
+  }
+  const int num_fields = *std::max_element(columns.begin(), columns.end()) + 1;
+
+  if (options.skip_header) {
+    const size_t header_end = csv.find('\n');
+    csv.remove_prefix(header_end == absl::string_view::npos ? csv.size()
+                                                            : header_end + 1);
+  }
+
+  const int num_chunks = static_cast<int>(std::min<int64_t>(
+      std::max(options.num_threads, 1),
+      1 + static_cast<int64_t>(csv.size()) / internal::kMinCsvChunkBytes));
+  const std::vector<absl::string_view> chunks =
+      internal::SplitCsvChunks(csv, num_chunks);
+
+  // values[chunk][i] holds the values of columns[i] in the chunk.
+  std::vector<std::vector<std::vector<T>>> values(
+      chunks.size(), std::vector<std::vector<T>>(columns.size()));
+  std::vector<absl::Status> statuses(chunks.size());
+  internal::ParallelFor(chunks.size(), num_chunks, [&](int64_t chunk) {
+    std::vector<absl::string_view> fields(num_fields);
+    const int64_t chunk_offset = chunks[chunk].data() - csv.data();
+    statuses[chunk] = internal::ForEachCsvLine(
+        chunks[chunk],
+        [&](absl::string_view line, int64_t offset) -> absl::Status {
+          if (!internal::SplitCsvFields(line, options.delimiter, num_fields,
+                                        fields.data())) {
+            return absl::InvalidArgumentError(absl::StrCat(
+                "Line at byte ", chunk_offset + offset, " has fewer than ",
+                num_fields, " fields."));
+          }
+          for (int i = 0; i < columns.size(); ++i) {
+            T value;
+            if (!internal::ParseCsvNumber(fields[columns[i]], &value)) {
+              return absl::InvalidArgumentError(absl::StrCat(
+                  "Field \"", fields[columns[i]], "\" of column ", columns[i],
+                  " in the line at byte ", chunk_offset + offset,
+                  " is not a number."));
+            }
+            values[chunk][i].push_back(value);
+          }
+          return absl::OkStatus();
+        });
+  });
+  RETURN_IF_ERROR(internal::FirstError(statuses));
+
+  std::vector<std::vector<T>> result = std::move(values[0]);
+  for (int64_t chunk = 1; chunk < chunks.size(); ++chunk) {
+    for (int i = 0; i < columns.size(); ++i) {
+      result[i].insert(result[i].end(), values[chunk][i].begin(),
+                       values[chunk][i].end());
+    }
+  }
+  return result;
+}
+
+// Adds values to every algorithm with one AddEntries call each. Different
+// algorithms are fed in parallel.
+template <typename T>
+void AddEntriesToAll(absl::Span<const T> values,
+                     absl::Span<Algorithm<T>* const> algorithms,
+                     int num_threads) {
+  internal::ParallelFor(algorithms.size(), num_threads, [&](int64_t i) {
+    algorithms[i]->AddEntries(values);
+  });
+}
+
+// Memory-maps the CSV file at path, parses the given column and adds its
+// values to every algorithm.
+template <typename T>
+absl::Status AddCsvColumnEntries(const std::string& path, int column,
+                                 absl::Span<Algorithm<T>* const> algorithms,
+                                 const CsvOptions& options = CsvOptions()) {
+  ASSIGN_OR_RETURN(std::unique_ptr<MappedFile> file, MappedFile::Open(path));
+  const int columns[] = {column};
+  ASSIGN_OR_RETURN(std::vector<std::vector<T>> values,
+                   ParseCsvColumns<T>(file->data(), columns, options));
+  AddEntriesToAll<T>(values[0], algorithms, options.num_threads);
+  return absl::OkStatus();
+}
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_CSV_INGESTION_H_
@@ -0,0 +1,157 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/csv-ingestion.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+std::string WriteTempFile(const std::string& name,
+                          const std::string& contents) {
+  const std::string path = absl::StrCat(::testing::TempDir(), "/", name);
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+  return path;
+}
+
+TEST(CsvIngestionTest, ParsesColumns) {
+  const std::string csv = "1,kiwi,2.5\n2,banana,-1\r\n\n3,apple, 4e1 \n";
+  const int columns[] = {2, 0};
+  base::StatusOr<std::vector<std::vector<double>>> values =
+      ParseCsvColumns<double>(csv, columns);
+  ASSERT_OK(values);
+  EXPECT_THAT(values.value(),
+              ElementsAre(ElementsAre(2.5, -1, 40), ElementsAre(1, 2, 3)));
+}
+
+TEST(CsvIngestionTest, SkipsHeaderAndUsesDelimiter) {
+  CsvOptions options;
+  options.skip_header = true;
+  options.delimiter = '\t';
+  const int columns[] = {1};
+  base::StatusOr<std::vector<std::vector<int64_t>>> values =
+      ParseCsvColumns<int64_t>("name\tcount\nfoo\t7\nbar\t-3", columns,
+                               options);
+  ASSERT_OK(values);
+  EXPECT_THAT(values.value(), ElementsAre(ElementsAre(7, -3)));
+
+  values = ParseCsvColumns<int64_t>("name\tcount", columns, options);
+  ASSERT_OK(values);
+  EXPECT_THAT(values.value(), ElementsAre(IsEmpty()));
+}
+
+TEST(CsvIngestionTest, ReportsInvalidLines) {
+  const int columns[] = {1};
+  EXPECT_THAT(ParseCsvColumns<int64_t>("1,2\n3\n", columns),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Line at byte 4 has fewer than 2 fields")));
+  EXPECT_THAT(ParseCsvColumns<int64_t>("1,2\n3,x4\n", columns),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Field \"x4\" of column 1")));
+  EXPECT_THAT(ParseCsvColumns<int64_t>("1,2.5\n", columns),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ParseCsvColumns<int64_t>("1,2\n", {}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(CsvIngestionTest, SplitsChunksAtLineBoundaries) {
+  const std::string csv = "1\n22\n333\n4444\n55555";
+  for (int num_chunks = 1; num_chunks <= 8; ++num_chunks) {
+    const std::vector<absl::string_view> chunks =
+        internal::SplitCsvChunks(csv, num_chunks);
+    EXPECT_LE(chunks.size(), num_chunks);
+    std::string joined;
+    for (int i = 0; i < chunks.size(); ++i) {
+      if (i + 1 < chunks.size()) {
+        EXPECT_EQ(chunks[i].back(), '\n');
+      }
+      joined.append(chunks[i].data(), chunks[i].size());
+    }
+    EXPECT_EQ(joined, csv);
+  }
+}
+
+TEST(CsvIngestionTest, ParallelParsingKeepsRowOrder) {
+  std::string csv;
+  const int kNumRows = 300000;
+  for (int i = 0; i < kNumRows; ++i) {
+    absl::StrAppend(&csv, "row", i, ",", i, "\n");
+  }
+  CsvOptions options;
+  options.num_threads = 4;
+  const int columns[] = {1};
+  base::StatusOr<std::vector<std::vector<int64_t>>> values =
+      ParseCsvColumns<int64_t>(csv, columns, options);
+  ASSERT_OK(values);
+  ASSERT_THAT(values.value()[0], SizeIs(kNumRows));
+  for (int i = 0; i < kNumRows; ++i) {
+    ASSERT_EQ(values.value()[0][i], i);
+  }
+}
+
+TEST(CsvIngestionTest, FeedsAlgorithmsFromFile) {
+  const std::string path =
+      WriteTempFile("carrots.csv", "Aardvark,1\nBadger,20\nCamel,3\n");
+  std::unique_ptr<Algorithm<double>> count =
+      Count<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<Algorithm<double>> sum =
+      BoundedSum<double>::Builder()
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  ASSERT_OK(AddCsvColumnEntries<double>(path, 1, {count.get(), sum.get()}));
+  EXPECT_EQ(GetValue<int64_t>(count->PartialResult().ValueOrDie()), 3);
+  EXPECT_EQ(GetValue<double>(sum->PartialResult().ValueOrDie()), 14);
+
+  EXPECT_THAT(AddCsvColumnEntries<double>(path + ".missing", 1, {sum.get()}),
+              StatusIs(absl::StatusCode::kNotFound));
+}
+
+TEST(CsvIngestionTest, MapsEmptyFile) {
+  const std::string path = WriteTempFile("empty.csv", "");
+  base::StatusOr<std::unique_ptr<MappedFile>> file = MappedFile::Open(path);
+  ASSERT_OK(file);
+  EXPECT_TRUE(file.value()->data().empty());
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -22,6 +22,7 @@
 #include "absl/random/random.h"
 #include "base/statusor.h"
 #include "absl/strings/string_view.h"
+#include "algorithms/metrics.h"
 #include "algorithms/rand.h"
 #include "algorithms/util.h"
 #include "base/canonical_errors.h"
@@ -40,17 +41,35 @@ static constexpr double kPi = 3.14159265358979323846;
 // root is set to 2^57.
 static constexpr double kBinomialBound = (double)(1LL << 57);
 
+// The largest block size used by GeometricSamplingMethod::kBlockedRejection.
+static constexpr double kMaxBlockSize = (double)(1LL << 60);
+
 // Approximates the probability of a random sample m + n / 2 drawn from a
 // binomial distribution of n Bernoulli trials that have a success probability
 // of 1 / 2 each. The approximation is taken from Lemma 7 of the noise
 // generation documentation available in
 // https://github.com/google/differential-privacy/blob/main/common_docs/Secure_Noise_Generation.pdf
-double ApproximateBinomialProbability(double sqrt_n, int64_t m) {
-  if (abs(m) > sqrt_n * sqrt(log(sqrt_n) / 2)) return 0;
+//
+// The terms that only depend on n are computed once on construction, since
+// they are shared by every candidate of a rejection sampling loop.
+class BinomialProbabilityApproximation {
+ public:
+  explicit BinomialProbabilityApproximation(double sqrt_n)
+      : support_bound_(sqrt_n * sqrt(log(sqrt_n) / 2)),
+        exponent_factor_(-2.0 / (sqrt_n * sqrt_n)),
+        normalization_(sqrt(2 / kPi) / sqrt_n *
+                       (1 - 0.4 * (2 * pow(log(sqrt_n), 1.5)) / sqrt_n)) {}
+
+  double Probability(int64_t m) const {
+    if (std::abs(m) > support_bound_) return 0;
+    return normalization_ * exp(exponent_factor_ * m * m);
+  }
 
-  return sqrt(2 / kPi) / sqrt_n * exp(-2.0 * m * m / (sqrt_n * sqrt_n)) *
-         (1 - 0.4 * (2 * pow(log(sqrt_n), 1.5)) / sqrt_n);
-}
+ private:
+  const double support_bound_;
+  const double exponent_factor_;
+  const double normalization_;
+};
 
 }  // namespace
 
@@ -75,6 +94,18 @@ double GaussianDistribution::Sample(double scale) {
   return SampleBinomial(sqrt_n) * granularity;
 }
 
+void GaussianDistribution::Sample(double scale, absl::Span<double> samples) {
+  DCHECK_GT(scale, 0);
+  double sigma = scale * stddev_;
+  double granularity =
+      std::max(GetGranularity(scale), std::numeric_limits<double>::min());
+  double sqrt_n = 2.0 * sigma / granularity;
+  SampleBinomial(sqrt_n, samples);
+  for (double& sample : samples) {
+    sample *= granularity;
+  }
+}
+
 double GaussianDistribution::Sample() { return Sample(1.0); }
 
 double GaussianDistribution::Stddev() { return stddev_; }
@@ -89,13 +120,15 @@ double GaussianDistribution::cdf(double stddev, double x) {
   return (1 + std::erf(x / (stddev * sqrt(2)))) / 2;
 }
 
-GeometricDistribution::GeometricDistribution(double lambda) : lambda_(lambda) {
+GeometricDistribution::GeometricDistribution(double lambda,
+                                             GeometricSamplingMethod method)
+    : lambda_(lambda), method_(method) {
   DCHECK_GE(lambda, 0);
 }
 
 double GaussianDistribution::SampleGeometric() {
   int geom_sample = 0;
-  while (absl::Bernoulli(SecureURBG::GetSingleton(), 0.5)) ++geom_sample;
+  while (UniformBool()) ++geom_sample;
   return geom_sample;
 }
 
@@ -109,35 +142,91 @@ double GaussianDistribution::SampleGeometric() {
 // Gaussian distribution.
 double GaussianDistribution::SampleBinomial(double sqrt_n) {
   long long step_size = static_cast<long long>(round(sqrt(2.0) * sqrt_n + 1));
+  BinomialProbabilityApproximation approximation(sqrt_n);
 
   SecureURBG& random = SecureURBG::GetSingleton();
   while (true) {
+    metrics::Add(metrics::Counter::kBinomialRejectionIterations);
     int geom_sample = SampleGeometric();
-    int two_sided_geom =
-        absl::Bernoulli(random, 0.5) ? geom_sample : (-geom_sample - 1);
+    int two_sided_geom = UniformBool() ? geom_sample : (-geom_sample - 1);
     int64_t uniform_sample = absl::Uniform(random, 0u, step_size);
     int64_t result = step_size * two_sided_geom + uniform_sample;
 
-    double result_prob = ApproximateBinomialProbability(sqrt_n, result);
+    double result_prob = approximation.Probability(result);
     double reject_prob = UniformDouble();
 
     if (result_prob > 0 && reject_prob > 0 &&
-        reject_prob < result_prob * step_size * pow(2.0, geom_sample - 2)) {
+        reject_prob <
+            result_prob * step_size * std::ldexp(1.0, geom_sample - 2)) {
       return result;
     }
   }
 }
 
+// Runs the same rejection sampling as SampleBinomial, but draws the candidates
+// of kLanes independent rejection loops at a time and evaluates their
+// acceptance probabilities in a separate loop without branches or calls into
+// the random number generator, which the compiler can vectorize. Since all
+// candidates are independent, taking the accepted ones in order yields
+// independent samples of the same distribution as SampleBinomial.
+void GaussianDistribution::SampleBinomial(double sqrt_n,
+                                          absl::Span<double> samples) {
+  constexpr int kLanes = 64;
+  long long step_size = static_cast<long long>(round(sqrt(2.0) * sqrt_n + 1));
+  BinomialProbabilityApproximation approximation(sqrt_n);
+
+  SecureURBG& random = SecureURBG::GetSingleton();
+  int64_t candidates[kLanes];
+  int geom_samples[kLanes];
+  double reject_probs[kLanes];
+  double accept_probs[kLanes];
+  size_t num_filled = 0;
+  while (num_filled < samples.size()) {
+    metrics::Add(metrics::Counter::kBinomialRejectionIterations, kLanes);
+    for (int lane = 0; lane < kLanes; ++lane) {
+      int geom_sample = SampleGeometric();
+      int two_sided_geom = UniformBool() ? geom_sample : (-geom_sample - 1);
+      int64_t uniform_sample = absl::Uniform(random, 0u, step_size);
+      geom_samples[lane] = geom_sample;
+      candidates[lane] = step_size * two_sided_geom + uniform_sample;
+      reject_probs[lane] = UniformDouble();
+    }
+    for (int lane = 0; lane < kLanes; ++lane) {
+      accept_probs[lane] = approximation.Probability(candidates[lane]) *
+                           step_size * std::ldexp(1.0, geom_samples[lane] - 2);
+    }
+    for (int lane = 0; lane < kLanes && num_filled < samples.size(); ++lane) {
+      if (accept_probs[lane] > 0 && reject_probs[lane] > 0 &&
+          reject_probs[lane] < accept_probs[lane]) {
+        samples[num_filled++] = candidates[lane];
+      }
+    }
+  }
+}
+
 double GeometricDistribution::GetUniformDouble() { return UniformDouble(); }
 
 int64_t GeometricDistribution::Sample() { return Sample(1.0); }
 
+int64_t GeometricDistribution::GetUniformInteger(int64_t upper) {
+  return absl::Uniform<int64_t>(SecureURBG::GetSingleton(), 0, upper);
+}
+
 int64_t GeometricDistribution::Sample(double scale) {
   if (lambda_ == std::numeric_limits<double>::infinity()) {
     return 0;
   }
   double lambda = lambda_ / scale;
+  // Blocks of 1 / lambda values must fit comfortably into an int64_t, so fall
+  // back to the binary search for extremely small lambdas.
+  if (method_ == GeometricSamplingMethod::kBlockedRejection &&
+      lambda * kMaxBlockSize >= 1) {
+    return SampleWithBlockedRejection(lambda);
+  }
+  return SampleWithBinarySearch(lambda);
+}
 
+int64_t GeometricDistribution::SampleWithBinarySearch(double lambda) {
   if (GetUniformDouble() >
       -1.0 * expm1(-1.0 * lambda * std::numeric_limits<int64_t>::max())) {
     return std::numeric_limits<int64_t>::max();
@@ -166,6 +255,39 @@ int64_t GeometricDistribution::Sample(double scale) {
   return hi - 1;
 }
 
+// A geometric sample k with P(k) proportional to e^(-lambda * k) can be written
+// as k = q * block_size + r, where q and r are independent. q is geometric with
+// P(q) proportional to e^(-lambda * block_size * q), and r is a geometric
+// sample truncated to [0, block_size). With block_size = ceil(1 / lambda),
+// each further block is taken with probability at most 1 / e, and every
+// candidate r is accepted with probability e^(-lambda * r) >=
+// e^(-lambda * (block_size - 1)), which is above e^-2 in each rejection round.
+// Both loops therefore terminate after a constant number of iterations in
+// expectation.
+int64_t GeometricDistribution::SampleWithBlockedRejection(double lambda) {
+  const int64_t block_size =
+      lambda >= 1 ? 1 : static_cast<int64_t>(std::ceil(1 / lambda));
+  const double block_continue_prob = std::exp(-lambda * block_size);
+
+  int64_t num_blocks = 0;
+  while (GetUniformDouble() < block_continue_prob) {
+    ++num_blocks;
+  }
+
+  int64_t offset = 0;
+  if (block_size > 1) {
+    do {
+      offset = GetUniformInteger(block_size);
+    } while (GetUniformDouble() >= std::exp(-lambda * offset));
+  }
+
+  if (num_blocks >
+      (std::numeric_limits<int64_t>::max() - offset) / block_size) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  return num_blocks * block_size + offset;
+}
+
 double GeometricDistribution::Lambda() { return lambda_; }
 
 // This is 2^K, with K hardcoded as 40. To generate laplace noise, we sample an
@@ -190,7 +312,8 @@ base::StatusOr<double> CalculateGranularity(double epsilon,
   return gran;
 }
 
-LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
+LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity,
+                                         GeometricSamplingMethod method) {
   epsilon_ = epsilon;
   sensitivity_ = sensitivity;
 
@@ -205,14 +328,12 @@ LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
   } else {
     lambda = granularity_ * epsilon_ / (sensitivity_ + granularity_);
   }
-  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda);
+  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda, method);
 }
 
 double LaplaceDistribution::GetUniformDouble() { return UniformDouble(); }
 
-bool LaplaceDistribution::GetBoolean() {
-  return absl::Bernoulli(SecureURBG::GetSingleton(), 0.5);
-}
+bool LaplaceDistribution::GetBoolean() { return UniformBool(); }
 double LaplaceDistribution::Sample() { return Sample(1.0); }
 
 double LaplaceDistribution::Sample(double scale) {
@@ -22,8 +22,22 @@
 #include <cstdint>
 #include "absl/status/status.h"
 #include "base/statusor.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
+
+// Selects the algorithm GeometricDistribution uses to draw samples. Both
+// produce the same distribution.
+enum class GeometricSamplingMethod {
+  // Binary search over the whole int64_t range. Every sample costs roughly 64
+  // uniform draws and transcendental function evaluations.
+  kBinarySearch,
+  // Splits the sample into a geometric number of blocks of about 1 / lambda
+  // values each, plus an offset within the last block drawn by rejection
+  // sampling. Takes a constant number of uniform draws in expectation.
+  kBlockedRejection,
+};
+
 namespace internal {
 
 // Allows samples to be drawn from a Gaussian distribution over a given stddev
@@ -45,6 +59,11 @@ class GaussianDistribution {
   // Samples the Gaussian with distribution Gauss(scale*stddev).
   virtual double Sample(double scale);
 
+  // Fills samples with independent samples of Gauss(scale*stddev). The result
+  // has the same distribution as calling Sample(scale) for each element, but
+  // the rejection sampling is run for many candidates at once.
+  void Sample(double scale, absl::Span<double> samples);
+
   // Returns the standard deviation of this distribution.
   double Stddev();
 
@@ -62,6 +81,7 @@ class GaussianDistribution {
   // then using GeometricDistribution which is suitable for any probability.
   double SampleGeometric();
   double SampleBinomial(double sqrt_n);
+  void SampleBinomial(double sqrt_n, absl::Span<double> samples);
 
   double stddev_;
 };
@@ -74,20 +94,31 @@ class GaussianDistribution {
 // of their distribution.
 class GeometricDistribution {
  public:
-  explicit GeometricDistribution(double lambda);
+  explicit GeometricDistribution(
+      double lambda,
+      GeometricSamplingMethod method = GeometricSamplingMethod::kBinarySearch);
 
   virtual ~GeometricDistribution() {}
 
   virtual double GetUniformDouble();
 
+  // Returns a uniformly random integer in [0, upper).
+  virtual int64_t GetUniformInteger(int64_t upper);
+
   virtual int64_t Sample();
 
   virtual int64_t Sample(double scale);
 
   double Lambda();
 
+  GeometricSamplingMethod Method() const { return method_; }
+
  private:
+  int64_t SampleWithBinarySearch(double lambda);
+  int64_t SampleWithBlockedRejection(double lambda);
+
   double lambda_;
+  GeometricSamplingMethod method_;
 };
 
 // Calculates 'r' from the secure noise paper (see
@@ -105,7 +136,9 @@ base::StatusOr<double> CalculateGranularity(double epsilon, double sensitivity);
 // http://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.366.5957&rep=rep1&type=pdf
 class LaplaceDistribution {
  public:
-  explicit LaplaceDistribution(double epsilon, double sensitivity);
+  explicit LaplaceDistribution(
+      double epsilon, double sensitivity,
+      GeometricSamplingMethod method = GeometricSamplingMethod::kBinarySearch);
 
   virtual ~LaplaceDistribution() = default;
 
@@ -133,6 +133,31 @@ TEST(GaussDistributionTest, CheckStatisticsForSpecificScaledDistribution) {
   EXPECT_NEAR(stddev * stddev * scale * scale, Variance(samples), 0.1 * scale);
 }
 
+TEST(GaussDistributionTest, CheckStatisticsForBatchSamples) {
+  double stddev = kOneOverLog2;
+  double scale = 3.0;
+  GaussianDistribution dist(stddev);
+  std::vector<double> samples(kGaussianSamples);
+  dist.Sample(scale, absl::MakeSpan(samples));
+  double mean = Mean(samples);
+  double var = Variance(samples);
+  EXPECT_NEAR(0.0, mean, 0.01 * scale);
+  EXPECT_NEAR(stddev * stddev * scale * scale, var, 0.1 * scale);
+  EXPECT_NEAR(0.0, Skew(samples, mean, std::sqrt(var)), 0.1);
+  // The excess kurtosis of a Gaussian distribution is 0.
+  EXPECT_NEAR(0.0, Kurtosis(samples, mean, var), 0.1);
+}
+
+TEST(GaussDistributionTest, BatchSamplesAreMultiplesOfGranularity) {
+  GaussianDistribution dist(1.0);
+  double granularity = dist.GetGranularity(2.0);
+  std::vector<double> samples(1000);
+  dist.Sample(2.0, absl::MakeSpan(samples));
+  for (double sample : samples) {
+    EXPECT_EQ(std::fmod(sample, granularity), 0);
+  }
+}
+
 TEST(GaussDistributionTest, StandardDeviationGetter) {
   double stddev = kOneOverLog2;
   GaussianDistribution dist(stddev);
@@ -234,10 +259,9 @@ std::vector<double> ExpectedCounts(const double p, const double one_minus_p,
 
 class GeometricDistributionTest : public ::testing::TestWithParam<double> {};
 
-TEST_P(GeometricDistributionTest, Distribution) {
-  auto lambda = GetParam();
-
-  GeometricDistribution distribution(lambda);
+void CheckGeometricDistribution(double lambda,
+                                GeometricSamplingMethod method) {
+  GeometricDistribution distribution(lambda, method);
   // Choose bucket sizes so that the expected count in the first bucket is
   // 150.
   const int64_t kBucketSize =
@@ -295,6 +319,16 @@ TEST_P(GeometricDistributionTest, Distribution) {
   }
 }
 
+TEST_P(GeometricDistributionTest, Distribution) {
+  CheckGeometricDistribution(GetParam(),
+                             GeometricSamplingMethod::kBinarySearch);
+}
+
+TEST_P(GeometricDistributionTest, BlockedRejectionDistribution) {
+  CheckGeometricDistribution(GetParam(),
+                             GeometricSamplingMethod::kBlockedRejection);
+}
+
 std::vector<double> GenParams() {
   return std::vector<double>({
       30,
@@ -337,6 +371,56 @@ TEST(GeometricDistribution, ImpossibleDoubles) {
   EXPECT_GT(count, 0);
 }
 
+TEST(GeometricDistribution, BlockedRejectionImpossibleDoubles) {
+  GeometricDistribution distribution(1e-15,
+                                     GeometricSamplingMethod::kBlockedRejection);
+  double count = 0;
+  constexpr int kIter = 1000000;
+  for (int i = 0; i < kIter; ++i) {
+    int64_t val = distribution.Sample();
+    ASSERT_GE(val, 0);
+
+    if (val > (1LL << 53) && val % 2) {
+      ++count;
+    }
+  }
+  EXPECT_GT(count, 0);
+}
+
+TEST(GeometricDistribution, BlockedRejectionScaledStats) {
+  double p = 1e-3;
+  double scale = 4.0;
+  GeometricDistribution dist(-1.0 * std::log(1.0 - p),
+                             GeometricSamplingMethod::kBlockedRejection);
+  std::vector<int64_t> samples(kNumGeometricSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist, scale]() { return dist.Sample(scale) + 1; });
+  // Scaling divides lambda, so the success probability becomes
+  // 1 - (1 - p)^(1 / scale).
+  double scaled_p = -std::expm1(std::log1p(-p) / scale);
+  EXPECT_NEAR(1 / scaled_p, Mean(samples), 0.01 / scaled_p);
+}
+
+TEST(GeometricDistribution, BlockedRejectionInfiniteLambda) {
+  GeometricDistribution dist(std::numeric_limits<double>::infinity(),
+                             GeometricSamplingMethod::kBlockedRejection);
+  EXPECT_EQ(dist.Sample(), 0);
+}
+
+TEST(LaplaceDistributionTest, BlockedRejectionStatistics) {
+  LaplaceDistribution dist(1.0, 1.0,
+                           GeometricSamplingMethod::kBlockedRejection);
+  std::vector<double> samples(kNumGeometricSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist]() { return dist.Sample(1.0); });
+  double mean = Mean(samples);
+  double var = Variance(samples);
+  EXPECT_NEAR(0.0, mean, 0.01);
+  EXPECT_NEAR(2.0, var, 0.1);
+  EXPECT_NEAR(0.0, Skew(samples, mean, std::sqrt(var)), 0.1);
+  EXPECT_NEAR(3.0, Kurtosis(samples, mean, var), 0.1);
+}
+
 }  // namespace
 }  // namespace internal
 }  // namespace differential_privacy
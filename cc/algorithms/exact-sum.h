@@ -0,0 +1,227 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_EXACT_SUM_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_EXACT_SUM_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+#include "base/logging.h"
+#include "absl/base/casts.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+
+namespace differential_privacy {
+
+// ExactSum adds finite doubles without rounding. It is a fixed-point
+// accumulator wide enough for every finite double: 2^-1074, the smallest
+// subnormal, is its unit, and it has enough headroom for more than 2^64
+// additions of the largest double. Since every addition is exact, the sum does
+// not depend on the order of the additions or merges, and Value() returns the
+// sum correctly rounded to the nearest double (or an infinity if it is out of
+// range).
+//
+// The sum is stored in base 2^32 digits held in int64_t, so that additions do
+// not propagate carries. Carries are propagated once every kMaxPendingAdds
+// additions, and whenever the digits are read.
+class ExactSum {
+ public:
+  // Number of bits per digit.
+  static constexpr int kDigitBits = 32;
+  // Bit positions 0 to 2097 hold the finite doubles, and 64 more bits of
+  // headroom are needed for 2^64 additions, which makes 68 digits.
+  static constexpr int kNumDigits = 68;
+
+  ExactSum() { Clear(); }
+
+  // Adds value, which must be finite.
+  void Add(double value) {
+    DCHECK(std::isfinite(value));
+    int position;
+    const uint64_t mantissa = Decompose(value, &position);
+    AddShifted(static_cast<unsigned __int128>(mantissa) << (position % 32),
+               position / 32, std::signbit(value));
+    CountPendingAdds(1);
+  }
+
+  // Adds value * count, which is exact as well.
+  void Add(double value, uint64_t count) {
+    DCHECK(std::isfinite(value));
+    int position;
+    const unsigned __int128 mantissa = Decompose(value, &position);
+    const bool negative = std::signbit(value);
+    // mantissa * count has up to 117 bits, so multiply by each half of count
+    // separately to stay within 128 bits after the shift.
+    AddShifted((mantissa * (count & 0xffffffff)) << (position % 32),
+               position / 32, negative);
+    AddShifted((mantissa * (count >> 32)) << (position % 32),
+               position / 32 + 1, negative);
+    CountPendingAdds(2);
+  }
+
+  // Adds the sum of other to this sum.
+  void Merge(const ExactSum& other) {
+    for (int i = 0; i < kNumDigits; ++i) {
+      digits_[i] += other.digits_[i];
+    }
+    // Both digit arrays are within the bound of kMaxPendingAdds additions, so
+    // their sum is within the bound of twice as many, which still fits.
+    CountPendingAdds(other.pending_adds_ + 1);
+  }
+
+  // Returns the sum correctly rounded to the nearest double.
+  double Value() const {
+    std::array<int64_t, kNumDigits> digits = digits_;
+    Normalize(&digits);
+    const bool negative = digits[kNumDigits - 1] < 0;
+    if (negative) {
+      for (int64_t& digit : digits) {
+        digit = -digit;
+      }
+      Normalize(&digits);
+    }
+    int top = kNumDigits - 1;
+    while (top >= 0 && digits[top] == 0) {
+      --top;
+    }
+    if (top < 0) {
+      return 0;
+    }
+    // Take the top three digits, which are more than 64 bits, and replace the
+    // digits below them by a sticky bit, so that converting to double rounds
+    // correctly. With fewer digits the mantissa has less than 64 bits, and
+    // the conversion to double is the only rounding.
+    const int lowest = std::max(top - 2, 0);
+    unsigned __int128 mantissa = 0;
+    for (int i = top; i >= lowest; --i) {
+      mantissa = (mantissa << kDigitBits) | static_cast<uint64_t>(digits[i]);
+    }
+    for (int i = 0; i < lowest; ++i) {
+      if (digits[i] != 0) {
+        mantissa |= 1;
+        break;
+      }
+    }
+    const double magnitude = std::ldexp(static_cast<double>(mantissa),
+                                        lowest * kDigitBits - kUnitExponent);
+    return negative ? -magnitude : magnitude;
+  }
+
+  // Returns the normalized digits, least significant first. All digits but the
+  // last are in [0, 2^32), and the sign of the last is the sign of the sum.
+  // Equal sums always have equal digits.
+  std::array<int64_t, kNumDigits> Digits() const {
+    std::array<int64_t, kNumDigits> digits = digits_;
+    Normalize(&digits);
+    return digits;
+  }
+
+  // Replaces the sum by the sum with the given digits, e.g., as returned by
+  // Digits(). Returns an error if there is a wrong number of digits or they
+  // are out of range.
+  absl::Status SetDigits(absl::Span<const int64_t> digits) {
+    if (digits.size() != kNumDigits) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Exact sum must have ", kNumDigits, " digits, but has ",
+          digits.size(), "."));
+    }
+    for (int i = 0; i < kNumDigits - 1; ++i) {
+      if (digits[i] < 0 || digits[i] >= kDigitBase) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Exact sum digit ", i, " is out of range."));
+      }
+    }
+    if (digits[kNumDigits - 1] <= -kDigitBase ||
+        digits[kNumDigits - 1] >= kDigitBase) {
+      return absl::InvalidArgumentError(
+          "Most significant exact sum digit is out of range.");
+    }
+    std::copy(digits.begin(), digits.end(), digits_.begin());
+    pending_adds_ = 1;
+    return absl::OkStatus();
+  }
+
+  void Clear() {
+    digits_.fill(0);
+    pending_adds_ = 0;
+  }
+
+ private:
+  // Each addition changes a digit by less than 2^32 in magnitude, so digits
+  // that are normalized and then changed by 2^30 additions fit in int64_t, even
+  // summed with the digits of another ExactSum by Merge().
+  static constexpr int64_t kMaxPendingAdds = int64_t{1} << 30;
+  static constexpr int64_t kDigitBase = int64_t{1} << kDigitBits;
+  static constexpr int64_t kDigitMask = kDigitBase - 1;
+  // The value of bit position 0 is 2^-kUnitExponent.
+  static constexpr int kUnitExponent = 1074;
+
+  // Returns the integer mantissa m of value and sets *position to p such that
+  // |value| = m * 2^(p - kUnitExponent).
+  static uint64_t Decompose(double value, int* position) {
+    const uint64_t bits = absl::bit_cast<uint64_t>(value);
+    const int biased_exponent = static_cast<int>((bits >> 52) & 0x7ff);
+    const uint64_t fraction = bits & ((uint64_t{1} << 52) - 1);
+    // Subnormals have an implicit leading zero and the exponent of the
+    // smallest normal, i.e., position 0.
+    if (biased_exponent == 0) {
+      *position = 0;
+      return fraction;
+    }
+    *position = biased_exponent - 1;
+    return fraction | (uint64_t{1} << 52);
+  }
+
+  // Adds or subtracts shifted * 2^(32 * digit). The digits of shifted are
+  // added without carries.
+  void AddShifted(unsigned __int128 shifted, int digit, bool negative) {
+    const int64_t sign = negative ? -1 : 1;
+    for (int i = digit; shifted != 0 && i < kNumDigits; ++i) {
+      digits_[i] += sign * static_cast<int64_t>(shifted & kDigitMask);
+      shifted >>= kDigitBits;
+    }
+  }
+
+  void CountPendingAdds(int64_t adds) {
+    pending_adds_ += adds;
+    if (pending_adds_ >= kMaxPendingAdds) {
+      Normalize(&digits_);
+      pending_adds_ = 0;
+    }
+  }
+
+  // Propagates the carries, so that all digits but the last are in [0, 2^32).
+  static void Normalize(std::array<int64_t, kNumDigits>* digits) {
+    for (int i = 0; i < kNumDigits - 1; ++i) {
+      // Arithmetic shift, i.e., floor division by 2^32.
+      const int64_t carry = (*digits)[i] >> kDigitBits;
+      (*digits)[i] -= carry * kDigitBase;
+      (*digits)[i + 1] += carry;
+    }
+  }
+
+  std::array<int64_t, kNumDigits> digits_;
+  // Number of additions since the carries were last propagated.
+  int64_t pending_adds_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_EXACT_SUM_H_
@@ -0,0 +1,151 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/exact-sum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
+
+TEST(ExactSumTest, EmptySumIsZero) {
+  ExactSum sum;
+  EXPECT_EQ(sum.Value(), 0);
+  sum.Add(0.0);
+  sum.Add(-0.0);
+  EXPECT_EQ(sum.Value(), 0);
+}
+
+TEST(ExactSumTest, AddsWithoutRounding) {
+  ExactSum sum;
+  sum.Add(1e100);
+  sum.Add(1.0);
+  sum.Add(-1e100);
+  EXPECT_EQ(sum.Value(), 1.0);
+
+  ExactSum tenths;
+  for (int i = 0; i < 10; ++i) {
+    tenths.Add(0.1);
+  }
+  // Adding 0.1 ten times with doubles gives 0.9999999999999999, but the exact
+  // sum of the ten doubles rounds to 1.
+  EXPECT_EQ(tenths.Value(), 1.0);
+}
+
+TEST(ExactSumTest, HandlesExtremeValues) {
+  const double max = std::numeric_limits<double>::max();
+  const double denorm_min = std::numeric_limits<double>::denorm_min();
+  ExactSum sum;
+  sum.Add(max);
+  sum.Add(max);
+  sum.Add(-max);
+  EXPECT_EQ(sum.Value(), max);
+  sum.Add(max);
+  EXPECT_EQ(sum.Value(), std::numeric_limits<double>::infinity());
+
+  ExactSum small;
+  small.Add(denorm_min);
+  small.Add(denorm_min);
+  small.Add(std::numeric_limits<double>::min());
+  EXPECT_EQ(small.Value(), std::numeric_limits<double>::min() + 2 * denorm_min);
+  small.Add(-1.0);
+  EXPECT_EQ(small.Value(), -1.0);
+}
+
+TEST(ExactSumTest, RoundsToNearestEven) {
+  // 1 + 2^-53 is halfway between 1 and the next double, and rounds to 1.
+  ExactSum halfway;
+  halfway.Add(1.0);
+  halfway.Add(std::ldexp(1.0, -53));
+  EXPECT_EQ(halfway.Value(), 1.0);
+  // Anything above halfway rounds up, however far below the last digit.
+  halfway.Add(std::ldexp(1.0, -1000));
+  EXPECT_EQ(halfway.Value(), 1.0 + std::ldexp(1.0, -52));
+}
+
+TEST(ExactSumTest, AddWithCountMatchesRepeatedAdd) {
+  for (double value : {0.1, -3.7, 1e300, -1e-310}) {
+    ExactSum repeated;
+    for (int i = 0; i < 1000; ++i) {
+      repeated.Add(value);
+    }
+    ExactSum counted;
+    counted.Add(value, 1000);
+    EXPECT_EQ(counted.Digits(), repeated.Digits());
+  }
+  ExactSum large;
+  large.Add(3.0, std::numeric_limits<uint64_t>::max());
+  EXPECT_EQ(large.Value(), 3.0 * std::numeric_limits<uint64_t>::max());
+}
+
+TEST(ExactSumTest, ResultDoesNotDependOnOrder) {
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+  std::vector<double> values;
+  for (int i = 0; i < 10000; ++i) {
+    values.push_back(distribution(generator) *
+                     std::pow(10, static_cast<int>(i % 20) - 10));
+  }
+  ExactSum forward;
+  for (double value : values) {
+    forward.Add(value);
+  }
+  std::shuffle(values.begin(), values.end(), generator);
+  // Add the shuffled values to several sums that are merged.
+  ExactSum shards[3];
+  for (int i = 0; i < values.size(); ++i) {
+    shards[i % 3].Add(values[i]);
+  }
+  shards[2].Merge(shards[0]);
+  shards[1].Merge(shards[2]);
+  EXPECT_EQ(shards[1].Digits(), forward.Digits());
+  EXPECT_EQ(shards[1].Value(), forward.Value());
+}
+
+TEST(ExactSumTest, SetDigitsRoundTrips) {
+  ExactSum sum;
+  sum.Add(-12.5);
+  sum.Add(1e-300);
+  const std::array<int64_t, ExactSum::kNumDigits> digits = sum.Digits();
+  ExactSum copy;
+  ASSERT_OK(copy.SetDigits(digits));
+  EXPECT_EQ(copy.Digits(), digits);
+  EXPECT_EQ(copy.Value(), sum.Value());
+
+  std::vector<int64_t> wrong_size(digits.begin(), digits.end() - 1);
+  EXPECT_THAT(copy.SetDigits(wrong_size),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must have 68 digits")));
+  std::vector<int64_t> out_of_range(digits.begin(), digits.end());
+  out_of_range[3] = -1;
+  EXPECT_THAT(copy.SetDigits(out_of_range),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("digit 3 is out of range")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,331 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_HISTOGRAM_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_HISTOGRAM_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/logging.h"
+#include "base/statusor.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/partition-selection.h"
+#include "algorithms/util.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Histogram computes differentially private counts of many buckets at once,
+// instead of one Count per bucket. Buckets are identified by int64 keys, and
+// every entry is the contribution of one privacy unit to one bucket; the
+// caller must ensure that a privacy unit contributes at most once to a bucket
+// and to at most max_buckets_contributed buckets, e.g., with a
+// ContributionBounder.
+//
+// There are two modes:
+//
+// - Dense, for known domains: the keys are the indices 0 to num_buckets - 1
+//   and the counts are stored in one flat array. All buckets are released,
+//   noised with one batched call of the mechanism. Entries with other keys
+//   are ignored.
+// - Sparse, for unknown domains: the counts are stored in a hash table, and
+//   only the buckets that the PartitionSelectionStrategy keeps are released.
+//   The strategy uses its own epsilon and delta, so the total budget is the
+//   sum of both, and it determines max_buckets_contributed.
+//
+// Results can only be released once until Reset() is called.
+class Histogram {
+ public:
+  // A released bucket.
+  struct Bucket {
+    int64_t key;
+    int64_t count;
+  };
+
+  class Builder {
+   public:
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    // Selects the dense mode with buckets 0 to num_buckets - 1.
+    Builder& SetNumBuckets(int64_t num_buckets) {
+      num_buckets_ = num_buckets;
+      return *this;
+    }
+
+    // Selects the sparse mode, in which strategy selects the released buckets.
+    Builder& SetPartitionSelectionStrategy(
+        std::unique_ptr<PartitionSelectionStrategy> strategy) {
+      strategy_ = std::move(strategy);
+      return *this;
+    }
+
+    // Maximum number of buckets a privacy unit contributes to in the dense
+    // mode. Defaults to 1. The sparse mode uses the value of the strategy.
+    Builder& SetMaxBucketsContributed(int64_t max_buckets) {
+      max_buckets_contributed_ = max_buckets;
+      return *this;
+    }
+
+    Builder& SetLaplaceMechanism(
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
+      mechanism_builder_ = std::move(mechanism_builder);
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<Histogram>> Build() {
+      if (!epsilon_.has_value()) {
+        epsilon_ = DefaultEpsilon();
+        LOG(WARNING) << "Default epsilon of " << epsilon_.value()
+                     << " is being used. Consider setting your own epsilon "
+                        "based on privacy considerations.";
+      }
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon_, "Epsilon"));
+      if (num_buckets_.has_value() == (strategy_ != nullptr)) {
+        return absl::InvalidArgumentError(
+            "Exactly one of the number of buckets and the partition selection "
+            "strategy must be set.");
+      }
+      int64_t max_buckets_contributed;
+      if (num_buckets_.has_value()) {
+        RETURN_IF_ERROR(ValidateIsPositive(num_buckets_, "Number of buckets"));
+        RETURN_IF_ERROR(ValidateIsPositive(max_buckets_contributed_,
+                                           "Maximum number of buckets"));
+        max_buckets_contributed = max_buckets_contributed_;
+      } else {
+        max_buckets_contributed = strategy_->GetMaxPartitionsContributed();
+      }
+      if (mechanism_builder_ == nullptr) {
+        mechanism_builder_ = absl::make_unique<LaplaceMechanism::Builder>();
+      }
+      std::unique_ptr<NumericalMechanism> mechanism;
+      ASSIGN_OR_RETURN(mechanism, mechanism_builder_->Clone()
+                                      ->SetEpsilon(epsilon_.value())
+                                      .SetL0Sensitivity(max_buckets_contributed)
+                                      .SetLInfSensitivity(1)
+                                      .Build());
+      return absl::WrapUnique(new Histogram(epsilon_.value(),
+                                            num_buckets_.value_or(0),
+                                            std::move(strategy_),
+                                            std::move(mechanism)));
+    }
+
+   private:
+    absl::optional<double> epsilon_;
+    absl::optional<int64_t> num_buckets_;
+    std::unique_ptr<PartitionSelectionStrategy> strategy_;
+    int64_t max_buckets_contributed_ = 1;
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
+  };
+
+  void AddEntry(int64_t key) { AddEntryWithCount(key, 1); }
+
+  // Adds num_entries contributions of different privacy units to the bucket.
+  void AddEntryWithCount(int64_t key, int64_t num_entries) {
+    if (IsDense()) {
+      if (InDenseDomain(key)) {
+        dense_counts_[key] += num_entries;
+      }
+    } else {
+      sparse_counts_[key] += num_entries;
+    }
+  }
+
+  void AddEntries(absl::Span<const int64_t> keys) {
+    if (IsDense()) {
+      for (int64_t key : keys) {
+        if (InDenseDomain(key)) {
+          ++dense_counts_[key];
+        }
+      }
+    } else {
+      for (int64_t key : keys) {
+        ++sparse_counts_[key];
+      }
+    }
+  }
+
+  // Returns the noisy counts of the released buckets. In the dense mode, all
+  // buckets are released in key order; in the sparse mode, the kept buckets
+  // are released in no particular order.
+  base::StatusOr<std::vector<Bucket>> ReleaseBuckets() {
+    if (released_) {
+      return absl::FailedPreconditionError(
+          "Results have already been released. Call Reset() to aggregate a "
+          "new histogram.");
+    }
+    released_ = true;
+
+    std::vector<int64_t> keys;
+    std::vector<double> counts;
+    if (IsDense()) {
+      counts.assign(dense_counts_.begin(), dense_counts_.end());
+    } else {
+      // Select all buckets at once, so that the strategy can share work
+      // between the decisions.
+      std::vector<int64_t> num_users;
+      num_users.reserve(sparse_counts_.size());
+      for (const auto& bucket : sparse_counts_) {
+        num_users.push_back(bucket.second);
+      }
+      std::vector<bool> keep;
+      strategy_->ShouldKeep(num_users, &keep);
+      int64_t index = 0;
+      for (const auto& bucket : sparse_counts_) {
+        if (keep[index++]) {
+          keys.push_back(bucket.first);
+          counts.push_back(bucket.second);
+        }
+      }
+    }
+    RETURN_IF_ERROR(
+        mechanism_->AddNoise(counts, absl::MakeSpan(counts), /*budget=*/1));
+
+    std::vector<Bucket> buckets;
+    buckets.reserve(counts.size());
+    for (int64_t i = 0; i < counts.size(); ++i) {
+      int64_t count;
+      SafeCastFromDouble(std::round(counts[i]), count);
+      buckets.push_back({IsDense() ? i : keys[i], count});
+    }
+    return buckets;
+  }
+
+  // Serializes the counts into a HistogramSummary. Sparse summaries also hold
+  // the keys.
+  Summary Serialize() const {
+    HistogramSummary histogram_summary;
+    if (IsDense()) {
+      histogram_summary.mutable_bin_count()->Add(dense_counts_.begin(),
+                                                 dense_counts_.end());
+    } else {
+      histogram_summary.mutable_bin_count()->Reserve(sparse_counts_.size());
+      histogram_summary.mutable_bin_key()->Reserve(sparse_counts_.size());
+      for (const auto& bucket : sparse_counts_) {
+        histogram_summary.add_bin_key(bucket.first);
+        histogram_summary.add_bin_count(bucket.second);
+      }
+    }
+    Summary summary;
+    summary.mutable_data()->PackFrom(histogram_summary);
+    return summary;
+  }
+
+  // Merges a summary of a histogram in the same mode. Dense summaries must
+  // have the same number of buckets.
+  absl::Status Merge(const Summary& summary) {
+    if (!summary.has_data()) {
+      return absl::InternalError(
+          "Cannot merge summary with no histogram data.");
+    }
+    HistogramSummary histogram_summary;
+    if (!summary.data().UnpackTo(&histogram_summary)) {
+      return absl::InternalError("Histogram summary unable to be unpacked.");
+    }
+    if (IsDense()) {
+      if (histogram_summary.bin_key_size() > 0 ||
+          histogram_summary.bin_count_size() != num_buckets_) {
+        return absl::InternalError(absl::StrCat(
+            "Merged histogram must be dense with ", num_buckets_,
+            " buckets."));
+      }
+      for (int64_t i = 0; i < num_buckets_; ++i) {
+        dense_counts_[i] += histogram_summary.bin_count(i);
+      }
+    } else {
+      if (histogram_summary.bin_key_size() !=
+          histogram_summary.bin_count_size()) {
+        return absl::InternalError(
+            "Merged histogram must be sparse with one key per count.");
+      }
+      sparse_counts_.reserve(sparse_counts_.size() +
+                             histogram_summary.bin_key_size());
+      for (int i = 0; i < histogram_summary.bin_key_size(); ++i) {
+        sparse_counts_[histogram_summary.bin_key(i)] +=
+            histogram_summary.bin_count(i);
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Removes all entries and allows releasing results again.
+  void Reset() {
+    std::fill(dense_counts_.begin(), dense_counts_.end(), 0);
+    sparse_counts_.clear();
+    released_ = false;
+  }
+
+  bool IsDense() const { return strategy_ == nullptr; }
+
+  // Returns the number of buckets in the dense mode, and the number of buckets
+  // with entries in the sparse mode.
+  int64_t NumBuckets() const {
+    return IsDense() ? num_buckets_ : sparse_counts_.size();
+  }
+
+  int64_t MemoryUsed() const {
+    return sizeof(Histogram) + sizeof(int64_t) * dense_counts_.capacity() +
+           sparse_counts_.bucket_count() *
+               (sizeof(std::pair<int64_t, int64_t>) + 1) +
+           mechanism_->MemoryUsed();
+  }
+
+  double GetEpsilon() const { return epsilon_; }
+
+ private:
+  Histogram(double epsilon, int64_t num_buckets,
+            std::unique_ptr<PartitionSelectionStrategy> strategy,
+            std::unique_ptr<NumericalMechanism> mechanism)
+      : epsilon_(epsilon),
+        num_buckets_(num_buckets),
+        strategy_(std::move(strategy)),
+        mechanism_(std::move(mechanism)),
+        dense_counts_(num_buckets, 0) {}
+
+  // Checks both bounds of the domain with one unsigned comparison.
+  bool InDenseDomain(int64_t key) const {
+    return static_cast<uint64_t>(key) < static_cast<uint64_t>(num_buckets_);
+  }
+
+  const double epsilon_;
+  const int64_t num_buckets_;
+  // Set in the sparse mode.
+  std::unique_ptr<PartitionSelectionStrategy> strategy_;
+  std::unique_ptr<NumericalMechanism> mechanism_;
+  // Counts of the dense mode, indexed by key.
+  std::vector<int64_t> dense_counts_;
+  // Counts of the sparse mode.
+  absl::flat_hash_map<int64_t, int64_t> sparse_counts_;
+  bool released_ = false;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_HISTOGRAM_H_
@@ -0,0 +1,194 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/histogram.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/partition-selection.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+using ::testing::UnorderedElementsAre;
+
+MATCHER_P2(BucketIs, key, count, "") {
+  return arg.key == key && arg.count == count;
+}
+
+// Keeps the buckets with at least min_users privacy units.
+class MinUsersSelection : public PartitionSelectionStrategy {
+ public:
+  explicit MinUsersSelection(int min_users)
+      : PartitionSelectionStrategy(1, 1e-5, 1, 1e-5), min_users_(min_users) {}
+
+  bool ShouldKeep(int num_users) override { return num_users >= min_users_; }
+
+ private:
+  const int min_users_;
+};
+
+std::unique_ptr<Histogram> MakeDense(int64_t num_buckets) {
+  return Histogram::Builder()
+      .SetEpsilon(1)
+      .SetNumBuckets(num_buckets)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Histogram> MakeSparse(int min_users) {
+  return Histogram::Builder()
+      .SetEpsilon(1)
+      .SetPartitionSelectionStrategy(
+          absl::make_unique<MinUsersSelection>(min_users))
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(HistogramTest, DenseReleasesAllBucketsInOrder) {
+  std::unique_ptr<Histogram> histogram = MakeDense(4);
+  EXPECT_TRUE(histogram->IsDense());
+  histogram->AddEntries({0, 2, 2, 3, -1, 4});
+  histogram->AddEntryWithCount(1, 5);
+
+  base::StatusOr<std::vector<Histogram::Bucket>> buckets =
+      histogram->ReleaseBuckets();
+  ASSERT_OK(buckets);
+  EXPECT_THAT(buckets.value(), ElementsAre(BucketIs(0, 1), BucketIs(1, 5),
+                                           BucketIs(2, 2), BucketIs(3, 1)));
+}
+
+TEST(HistogramTest, SparseReleasesSelectedBuckets) {
+  std::unique_ptr<Histogram> histogram = MakeSparse(/*min_users=*/2);
+  EXPECT_FALSE(histogram->IsDense());
+  histogram->AddEntries({10, 10, 20, -5, -5, -5});
+  EXPECT_EQ(histogram->NumBuckets(), 3);
+
+  base::StatusOr<std::vector<Histogram::Bucket>> buckets =
+      histogram->ReleaseBuckets();
+  ASSERT_OK(buckets);
+  EXPECT_THAT(buckets.value(),
+              UnorderedElementsAre(BucketIs(10, 2), BucketIs(-5, 3)));
+}
+
+TEST(HistogramTest, ReleasesOnceUntilReset) {
+  std::unique_ptr<Histogram> histogram = MakeDense(2);
+  histogram->AddEntry(0);
+  ASSERT_OK(histogram->ReleaseBuckets());
+  EXPECT_THAT(histogram->ReleaseBuckets(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("already been released")));
+  histogram->Reset();
+  EXPECT_THAT(histogram->ReleaseBuckets().ValueOrDie(),
+              ElementsAre(BucketIs(0, 0), BucketIs(1, 0)));
+}
+
+TEST(HistogramTest, NoiseIsCalibratedToMaxBucketsContributed) {
+  const int kNumBuckets = 10000;
+  std::unique_ptr<Histogram> histogram = Histogram::Builder()
+                                             .SetEpsilon(1)
+                                             .SetNumBuckets(kNumBuckets)
+                                             .SetMaxBucketsContributed(2)
+                                             .Build()
+                                             .ValueOrDie();
+  const std::vector<Histogram::Bucket> buckets =
+      histogram->ReleaseBuckets().ValueOrDie();
+  double squared_noise = 0;
+  for (const Histogram::Bucket& bucket : buckets) {
+    squared_noise += bucket.count * bucket.count;
+  }
+  // Laplace noise with scale 2 has a variance of 8, plus the rounding error.
+  EXPECT_NEAR(squared_noise / kNumBuckets, 8, 1);
+}
+
+TEST(HistogramTest, DenseSerializeAndMerge) {
+  std::unique_ptr<Histogram> histogram = MakeDense(3);
+  histogram->AddEntries({0, 1, 1});
+  std::unique_ptr<Histogram> merged = MakeDense(3);
+  merged->AddEntry(2);
+  ASSERT_OK(merged->Merge(histogram->Serialize()));
+  EXPECT_THAT(merged->ReleaseBuckets().ValueOrDie(),
+              ElementsAre(BucketIs(0, 1), BucketIs(1, 2), BucketIs(2, 1)));
+
+  EXPECT_THAT(MakeDense(4)->Merge(histogram->Serialize()),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("dense with 4 buckets")));
+  EXPECT_THAT(MakeSparse(1)->Merge(histogram->Serialize()),
+              StatusIs(absl::StatusCode::kInternal));
+  EXPECT_THAT(MakeDense(3)->Merge(Summary()),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(HistogramTest, SparseSerializeAndMerge) {
+  std::unique_ptr<Histogram> histogram = MakeSparse(1);
+  histogram->AddEntries({7, 7, 1000000});
+  Summary summary = histogram->Serialize();
+  HistogramSummary histogram_summary;
+  ASSERT_TRUE(summary.data().UnpackTo(&histogram_summary));
+  EXPECT_THAT(histogram_summary.bin_key(), SizeIs(2));
+
+  std::unique_ptr<Histogram> merged = MakeSparse(1);
+  merged->AddEntry(7);
+  ASSERT_OK(merged->Merge(summary));
+  EXPECT_THAT(merged->ReleaseBuckets().ValueOrDie(),
+              UnorderedElementsAre(BucketIs(7, 3), BucketIs(1000000, 1)));
+  EXPECT_THAT(MakeDense(3)->Merge(summary),
+              StatusIs(absl::StatusCode::kInternal));
+}
+
+TEST(HistogramTest, BuildValidatesParameters) {
+  EXPECT_THAT(Histogram::Builder().SetEpsilon(1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Exactly one of")));
+  EXPECT_THAT(Histogram::Builder()
+                  .SetEpsilon(1)
+                  .SetNumBuckets(2)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1))
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Exactly one of")));
+  EXPECT_THAT(Histogram::Builder().SetEpsilon(1).SetNumBuckets(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of buckets")));
+  EXPECT_THAT(Histogram::Builder()
+                  .SetEpsilon(1)
+                  .SetNumBuckets(2)
+                  .SetMaxBucketsContributed(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum number of buckets")));
+  EXPECT_THAT(Histogram::Builder().SetEpsilon(-1).SetNumBuckets(2).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
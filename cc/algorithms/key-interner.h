@@ -0,0 +1,201 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_KEY_INTERNER_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_KEY_INTERNER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/logging.h"
+
+namespace differential_privacy {
+
+// KeyInterner maps string partition keys to dense 32-bit ids 0, 1, 2, ..., in
+// the order in which the keys are first seen, so that the state of a grouped
+// aggregation can be indexed by id instead of by string, e.g., with
+// PartitionedAggregator<KeyInterner::Id, T> or a plain vector per id.
+//
+// Every key is stored once, in one contiguous arena of characters, instead of
+// as one std::string per node of a map. The index is a flat open-addressing
+// table of ids that compares keys against the arena and caches the hash of
+// every key, so that keys are never hashed again when the index grows.
+// Callers that look up the same key several times, or that hash keys on
+// another thread, can hash keys once with Prehash().
+//
+// Views returned by Get() are invalidated when new keys are added. Not thread
+// safe.
+class KeyInterner {
+ public:
+  using Id = uint32_t;
+
+  // A key with its hash, as computed by Prehash().
+  struct PrehashedKey {
+    absl::string_view key;
+    size_t hash;
+  };
+
+  static PrehashedKey Prehash(absl::string_view key) {
+    return {key, absl::Hash<absl::string_view>()(key)};
+  }
+
+  KeyInterner()
+      : index_(/*bucket_count=*/0, IdHash{&hashes_},
+               IdEq{&arena_, &offsets_}) {
+    offsets_.push_back(0);
+  }
+
+  // The index refers to the members of this interner.
+  KeyInterner(const KeyInterner&) = delete;
+  KeyInterner& operator=(const KeyInterner&) = delete;
+
+  // Returns the id of key, adding key with the next id if it is new. key must
+  // not be a view returned by Get().
+  Id Intern(absl::string_view key) { return Intern(Prehash(key)); }
+
+  Id Intern(const PrehashedKey& key) {
+    // Probes once, and only adds the key if it is not found.
+    return *index_.lazy_emplace(
+        key, [&](const IdSet::constructor& construct) { construct(Add(key)); });
+  }
+
+  // Interns all keys and writes their ids to ids, which must have the same
+  // size. All keys are hashed before the first lookup, which keeps the hashing
+  // loop free of the table's memory accesses.
+  void InternAll(absl::Span<const absl::string_view> keys,
+                 absl::Span<Id> ids) {
+    DCHECK_EQ(keys.size(), ids.size());
+    std::vector<PrehashedKey> prehashed;
+    prehashed.reserve(keys.size());
+    for (absl::string_view key : keys) {
+      prehashed.push_back(Prehash(key));
+    }
+    for (size_t i = 0; i < prehashed.size(); ++i) {
+      ids[i] = Intern(prehashed[i]);
+    }
+  }
+
+  // Returns the id of key, or nullopt if key was never interned.
+  absl::optional<Id> Find(absl::string_view key) const {
+    return Find(Prehash(key));
+  }
+
+  absl::optional<Id> Find(const PrehashedKey& key) const {
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      return absl::nullopt;
+    }
+    return *it;
+  }
+
+  // Returns the key of id, which must have been returned by this interner.
+  absl::string_view Get(Id id) const {
+    DCHECK_LT(id, size());
+    return KeyOf(arena_, offsets_, id);
+  }
+
+  // Returns the number of interned keys, which is also the next id.
+  int64_t size() const { return hashes_.size(); }
+
+  // Allocates memory for num_keys keys with num_bytes characters in total.
+  void Reserve(int64_t num_keys, int64_t num_bytes) {
+    index_.reserve(num_keys);
+    hashes_.reserve(num_keys);
+    offsets_.reserve(num_keys + 1);
+    arena_.reserve(num_bytes);
+  }
+
+  // Removes all keys, so that ids start at 0 again. Keeps the allocated
+  // memory.
+  void Clear() {
+    index_.clear();
+    hashes_.clear();
+    offsets_.resize(1);
+    arena_.clear();
+  }
+
+  int64_t MemoryUsed() const {
+    return sizeof(KeyInterner) + arena_.capacity() +
+           sizeof(size_t) * (offsets_.capacity() + hashes_.capacity()) +
+           index_.capacity() * (sizeof(Id) + 1);
+  }
+
+ private:
+  static absl::string_view KeyOf(const std::string& arena,
+                                 const std::vector<size_t>& offsets, Id id) {
+    return absl::string_view(arena.data() + offsets[id],
+                             offsets[id + 1] - offsets[id]);
+  }
+
+  // Hashes ids by their cached hash, and prehashed keys by their hash.
+  struct IdHash {
+    using is_transparent = void;
+
+    size_t operator()(Id id) const { return (*hashes)[id]; }
+    size_t operator()(const PrehashedKey& key) const { return key.hash; }
+
+    const std::vector<size_t>* hashes;
+  };
+
+  // Compares ids and prehashed keys by their keys.
+  struct IdEq {
+    using is_transparent = void;
+
+    bool operator()(Id a, Id b) const { return a == b; }
+    bool operator()(Id id, const PrehashedKey& key) const {
+      return KeyOf(*arena, *offsets, id) == key.key;
+    }
+    bool operator()(const PrehashedKey& key, Id id) const {
+      return (*this)(id, key);
+    }
+
+    const std::string* arena;
+    const std::vector<size_t>* offsets;
+  };
+
+  using IdSet = absl::flat_hash_set<Id, IdHash, IdEq>;
+
+  // Appends key to the arena and returns its id.
+  Id Add(const PrehashedKey& key) {
+    CHECK_LT(size(), std::numeric_limits<Id>::max())
+        << "Too many keys for 32-bit ids.";
+    const Id id = size();
+    arena_.append(key.key.data(), key.key.size());
+    offsets_.push_back(arena_.size());
+    hashes_.push_back(key.hash);
+    return id;
+  }
+
+  // The characters of all keys, concatenated in id order.
+  std::string arena_;
+  // Key i is arena_[offsets_[i], offsets_[i + 1]).
+  std::vector<size_t> offsets_;
+  // Hash of every key, by id.
+  std::vector<size_t> hashes_;
+  IdSet index_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_KEY_INTERNER_H_
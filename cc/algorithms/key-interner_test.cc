@@ -0,0 +1,109 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/key-interner.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Optional;
+
+TEST(KeyInternerTest, AssignsDenseIdsInOrder) {
+  KeyInterner interner;
+  EXPECT_EQ(interner.Intern("carrot"), 0);
+  EXPECT_EQ(interner.Intern("apple"), 1);
+  EXPECT_EQ(interner.Intern("carrot"), 0);
+  EXPECT_EQ(interner.Intern(""), 2);
+  EXPECT_EQ(interner.Intern(""), 2);
+  EXPECT_EQ(interner.size(), 3);
+
+  EXPECT_EQ(interner.Get(0), "carrot");
+  EXPECT_EQ(interner.Get(1), "apple");
+  EXPECT_EQ(interner.Get(2), "");
+}
+
+TEST(KeyInternerTest, FindDoesNotAdd) {
+  KeyInterner interner;
+  interner.Intern("a");
+  EXPECT_THAT(interner.Find("a"), Optional(0));
+  EXPECT_EQ(interner.Find("b"), absl::nullopt);
+  EXPECT_EQ(interner.size(), 1);
+}
+
+TEST(KeyInternerTest, PrehashedLookupMatchesLookup) {
+  KeyInterner interner;
+  const KeyInterner::PrehashedKey key = KeyInterner::Prehash("x");
+  EXPECT_EQ(interner.Intern(key), 0);
+  EXPECT_EQ(interner.Intern("x"), 0);
+  EXPECT_THAT(interner.Find(key), Optional(0));
+}
+
+TEST(KeyInternerTest, KeysWithEmbeddedNulsAreDistinct) {
+  KeyInterner interner;
+  const std::string a("a\0b", 3);
+  const std::string b("a\0c", 3);
+  EXPECT_EQ(interner.Intern(a), 0);
+  EXPECT_EQ(interner.Intern(b), 1);
+  EXPECT_EQ(interner.Intern("a"), 2);
+  EXPECT_EQ(interner.Get(1), b);
+}
+
+TEST(KeyInternerTest, KeepsIdsWhileGrowing) {
+  const int kNumKeys = 100000;
+  KeyInterner interner;
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(interner.Intern(absl::StrCat("key", i)), i);
+  }
+  for (int i = 0; i < kNumKeys; ++i) {
+    ASSERT_EQ(interner.Intern(absl::StrCat("key", i)), i);
+    ASSERT_EQ(interner.Get(i), absl::StrCat("key", i));
+  }
+  EXPECT_EQ(interner.size(), kNumKeys);
+  EXPECT_GT(interner.MemoryUsed(), kNumKeys * sizeof(KeyInterner::Id));
+}
+
+TEST(KeyInternerTest, InternAllMatchesIntern) {
+  KeyInterner interner;
+  interner.Intern("b");
+  const std::vector<absl::string_view> keys = {"a", "b", "a", "c"};
+  std::vector<KeyInterner::Id> ids(keys.size());
+  interner.InternAll(keys, absl::MakeSpan(ids));
+  EXPECT_THAT(ids, ElementsAre(1, 0, 1, 2));
+}
+
+TEST(KeyInternerTest, ClearRestartsIds) {
+  KeyInterner interner;
+  interner.Reserve(2, 8);
+  interner.Intern("a");
+  interner.Intern("b");
+  interner.Clear();
+  EXPECT_EQ(interner.size(), 0);
+  EXPECT_EQ(interner.Find("a"), absl::nullopt);
+  EXPECT_EQ(interner.Intern("b"), 0);
+  EXPECT_EQ(interner.Get(0), "b");
+}
+
+}  // namespace
+}  // namespace differential_privacy
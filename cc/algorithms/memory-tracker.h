@@ -0,0 +1,162 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_MEMORY_TRACKER_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_MEMORY_TRACKER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+
+namespace differential_privacy {
+
+// Limit of a MemoryTracker that never rejects a reservation.
+constexpr int64_t kNoMemoryLimit = std::numeric_limits<int64_t>::max();
+
+// MemoryTracker counts the bytes of aggregation state as it grows and shrinks,
+// so that the current usage can be read in O(1) instead of being recomputed
+// with MemoryUsed(), and optionally enforces a limit on it.
+//
+// Trackers can be chained, e.g., one tracker per aggregator with a parent
+// tracker shared by all aggregators of the process. Bytes reserved on a
+// tracker are also reserved on its parents, and TryReserve() fails if any
+// tracker of the chain would exceed its limit. A tracker releases its bytes
+// from its parents when it is destroyed. The parent must outlive the tracker.
+//
+// MemoryTracker is thread-safe.
+class MemoryTracker {
+ public:
+  explicit MemoryTracker(int64_t limit = kNoMemoryLimit,
+                         MemoryTracker* parent = nullptr)
+      : limit_(limit), parent_(parent) {}
+
+  MemoryTracker(const MemoryTracker&) = delete;
+  MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+  ~MemoryTracker() {
+    if (parent_ != nullptr) {
+      parent_->Release(bytes_.load(std::memory_order_relaxed));
+    }
+  }
+
+  // Reserves bytes if this tracker and all of its parents stay within their
+  // limits, and returns whether they were reserved.
+  bool TryReserve(int64_t bytes) {
+    int64_t current = bytes_.load(std::memory_order_relaxed);
+    do {
+      if (bytes > limit_ - current) {
+        return false;
+      }
+    } while (!bytes_.compare_exchange_weak(current, current + bytes,
+                                           std::memory_order_relaxed));
+    if (parent_ != nullptr && !parent_->TryReserve(bytes)) {
+      bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+      return false;
+    }
+    UpdatePeak(current + bytes);
+    return true;
+  }
+
+  // Reserves bytes regardless of the limits, for memory that has already been
+  // allocated.
+  void Reserve(int64_t bytes) {
+    const int64_t used =
+        bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (parent_ != nullptr) {
+      parent_->Reserve(bytes);
+    }
+    UpdatePeak(used);
+  }
+
+  // Releases bytes that were reserved before.
+  void Release(int64_t bytes) {
+    bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    if (parent_ != nullptr) {
+      parent_->Release(bytes);
+    }
+  }
+
+  // Returns the number of bytes currently reserved, including the bytes
+  // reserved on trackers that have this tracker as their parent.
+  int64_t BytesUsed() const { return bytes_.load(std::memory_order_relaxed); }
+
+  // Returns the largest number of bytes that has been reserved at once.
+  int64_t PeakBytesUsed() const {
+    return peak_bytes_.load(std::memory_order_relaxed);
+  }
+
+  int64_t GetLimit() const { return limit_; }
+
+ private:
+  void UpdatePeak(int64_t used) {
+    int64_t peak = peak_bytes_.load(std::memory_order_relaxed);
+    while (used > peak && !peak_bytes_.compare_exchange_weak(
+                              peak, used, std::memory_order_relaxed)) {
+    }
+  }
+
+  const int64_t limit_;
+  MemoryTracker* const parent_;
+  std::atomic<int64_t> bytes_{0};
+  std::atomic<int64_t> peak_bytes_{0};
+};
+
+// TrackingMemoryResource forwards allocations to an upstream memory resource
+// and reserves them on a MemoryTracker, e.g., for the partial sums of a
+// BoundedSum built with SetMemoryResource(). Allocations are always served,
+// even beyond the limit of the tracker, since containers cannot handle a
+// failed allocation; check the limit where new state can be refused instead.
+//
+// Each allocation is accounted with its alignment padding, i.e., rounded up to
+// a multiple of its alignment. Neither the tracker nor the upstream resource
+// are owned, and both must outlive the resource.
+class TrackingMemoryResource : public std::pmr::memory_resource {
+ public:
+  explicit TrackingMemoryResource(
+      MemoryTracker* tracker,
+      std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : tracker_(tracker), upstream_(upstream) {}
+
+ private:
+  static int64_t AccountedBytes(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+  }
+
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    void* p = upstream_->allocate(bytes, alignment);
+    tracker_->Reserve(AccountedBytes(bytes, alignment));
+    return p;
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    upstream_->deallocate(p, bytes, alignment);
+    tracker_->Release(AccountedBytes(bytes, alignment));
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+
+  MemoryTracker* const tracker_;
+  std::pmr::memory_resource* const upstream_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_MEMORY_TRACKER_H_
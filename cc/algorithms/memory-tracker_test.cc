@@ -0,0 +1,123 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/memory-tracker.h"
+
+#include <memory>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "algorithms/bounded-sum.h"
+
+namespace differential_privacy {
+namespace {
+
+TEST(MemoryTrackerTest, ReservesAndReleases) {
+  MemoryTracker tracker;
+  EXPECT_EQ(tracker.GetLimit(), kNoMemoryLimit);
+  EXPECT_TRUE(tracker.TryReserve(100));
+  tracker.Reserve(50);
+  EXPECT_EQ(tracker.BytesUsed(), 150);
+  tracker.Release(120);
+  EXPECT_EQ(tracker.BytesUsed(), 30);
+  EXPECT_EQ(tracker.PeakBytesUsed(), 150);
+}
+
+TEST(MemoryTrackerTest, TryReserveRespectsLimit) {
+  MemoryTracker tracker(/*limit=*/100);
+  EXPECT_TRUE(tracker.TryReserve(60));
+  EXPECT_FALSE(tracker.TryReserve(41));
+  EXPECT_TRUE(tracker.TryReserve(40));
+  EXPECT_EQ(tracker.BytesUsed(), 100);
+
+  // Reserve() is not limited.
+  tracker.Reserve(10);
+  EXPECT_EQ(tracker.BytesUsed(), 110);
+  EXPECT_FALSE(tracker.TryReserve(1));
+}
+
+TEST(MemoryTrackerTest, ChargesParentAndChecksItsLimit) {
+  MemoryTracker process(/*limit=*/100);
+  {
+    MemoryTracker first(kNoMemoryLimit, &process);
+    MemoryTracker second(/*limit=*/30, &process);
+    EXPECT_TRUE(first.TryReserve(60));
+    EXPECT_FALSE(second.TryReserve(31));
+    EXPECT_TRUE(second.TryReserve(30));
+    EXPECT_EQ(process.BytesUsed(), 90);
+
+    // The parent limit is exceeded, so nothing is reserved on first.
+    EXPECT_FALSE(first.TryReserve(20));
+    EXPECT_EQ(first.BytesUsed(), 60);
+    EXPECT_EQ(process.BytesUsed(), 90);
+
+    first.Release(10);
+    EXPECT_EQ(process.BytesUsed(), 80);
+  }
+  // Destroyed trackers release their bytes from the parent.
+  EXPECT_EQ(process.BytesUsed(), 0);
+  EXPECT_EQ(process.PeakBytesUsed(), 90);
+}
+
+TEST(MemoryTrackerTest, ConcurrentTryReserveNeverExceedsLimit) {
+  MemoryTracker tracker(/*limit=*/10000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&tracker]() {
+      for (int i = 0; i < 10000; ++i) {
+        tracker.TryReserve(1);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(tracker.BytesUsed(), 10000);
+  EXPECT_EQ(tracker.PeakBytesUsed(), 10000);
+}
+
+TEST(TrackingMemoryResourceTest, TracksContainerGrowth) {
+  MemoryTracker tracker;
+  TrackingMemoryResource resource(&tracker);
+  {
+    std::pmr::vector<int64_t> values(&resource);
+    values.reserve(10);
+    EXPECT_EQ(tracker.BytesUsed(), 10 * sizeof(int64_t));
+    values.reserve(100);
+    EXPECT_EQ(tracker.BytesUsed(), 100 * sizeof(int64_t));
+  }
+  EXPECT_EQ(tracker.BytesUsed(), 0);
+}
+
+TEST(TrackingMemoryResourceTest, TracksBoundedSumPartials) {
+  MemoryTracker tracker;
+  TrackingMemoryResource resource(&tracker);
+  auto bs = BoundedSum<double>::Builder()
+                .SetEpsilon(1.0)
+                .SetMemoryResource(&resource)
+                .Build();
+  ASSERT_OK(bs);
+  EXPECT_GT(tracker.BytesUsed(), 0);
+  bs->reset();
+  EXPECT_EQ(tracker.BytesUsed(), 0);
+}
+
+}  // namespace
+}  // namespace differential_privacy
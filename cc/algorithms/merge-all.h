@@ -0,0 +1,162 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_MERGE_ALL_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_MERGE_ALL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Number of summaries that MergeAll merges sequentially into each leaf of the
+// reduction tree.
+constexpr int kMergeAllLeafSize = 16;
+
+namespace internal {
+
+// Calls fn(i) for every i in [0, n) on up to num_threads threads, including
+// the calling thread, and returns when all calls are done.
+inline void ParallelFor(int64_t n, int num_threads,
+                        const std::function<void(int64_t)>& fn) {
+  const int num_workers =
+      static_cast<int>(std::min<int64_t>(std::max(num_threads, 1), n));
+  if (num_workers <= 1) {
+    for (int64_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic<int64_t> next(0);
+  auto work = [&next, n, &fn]() {
+    for (int64_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+      fn(i);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_workers; ++i) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+// Returns the first error of statuses, or OK if there is none.
+inline absl::Status FirstError(const std::vector<absl::Status>& statuses) {
+  for (const absl::Status& status : statuses) {
+    RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace internal
+
+// Merges summaries into target using up to num_threads threads. If
+// num_threads is not positive, the number of hardware threads is used.
+//
+// All summaries must contain data of the same algorithm summary type, which is
+// checked before any summary is merged. Summaries are first merged in order
+// into leaf algorithms of kMergeAllLeafSize summaries each, built by factory,
+// which are then combined pairwise with Algorithm::MergeFrom() in a balanced
+// tree. The shape of the tree only depends on the number of summaries, so the
+// result is the same for any number of threads, including for floating point
+// partial values.
+//
+// factory must build algorithms of the same type and with the same parameters
+// as target. If an error occurs, target is not modified unless the error
+// comes from merging into target itself.
+template <typename T>
+absl::Status MergeAll(
+    absl::Span<const Summary> summaries,
+    const std::function<base::StatusOr<std::unique_ptr<Algorithm<T>>>()>&
+        factory,
+    Algorithm<T>* target, int num_threads = 0) {
+  if (summaries.empty()) {
+    return absl::OkStatus();
+  }
+  for (int64_t i = 0; i < summaries.size(); ++i) {
+    if (!summaries[i].has_data()) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Summary ", i, " has no data."));
+    }
+    if (summaries[i].data().type_url() != summaries[0].data().type_url()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Summary ", i, " has type ", summaries[i].data().type_url(),
+          ", but summary 0 has type ", summaries[0].data().type_url(), "."));
+    }
+  }
+  if (num_threads <= 0) {
+    num_threads = std::max<int>(1, std::thread::hardware_concurrency());
+  }
+
+  // Merge the summaries of each leaf in order.
+  const int64_t num_leaves =
+      (summaries.size() + kMergeAllLeafSize - 1) / kMergeAllLeafSize;
+  std::vector<std::unique_ptr<Algorithm<T>>> level(num_leaves);
+  std::vector<absl::Status> statuses(num_leaves);
+  internal::ParallelFor(num_leaves, num_threads, [&](int64_t leaf) {
+    base::StatusOr<std::unique_ptr<Algorithm<T>>> algorithm = factory();
+    if (!algorithm.ok()) {
+      statuses[leaf] = algorithm.status();
+      return;
+    }
+    level[leaf] = std::move(algorithm.value());
+    const int64_t end = std::min<int64_t>(
+        summaries.size(), (leaf + 1) * kMergeAllLeafSize);
+    for (int64_t i = leaf * kMergeAllLeafSize; i < end; ++i) {
+      statuses[leaf] = level[leaf]->Merge(summaries[i]);
+      if (!statuses[leaf].ok()) {
+        return;
+      }
+    }
+  });
+  RETURN_IF_ERROR(internal::FirstError(statuses));
+
+  // Combine neighbouring algorithms until one is left.
+  while (level.size() > 1) {
+    const int64_t num_pairs = level.size() / 2;
+    statuses.assign(num_pairs, absl::OkStatus());
+    internal::ParallelFor(num_pairs, num_threads, [&](int64_t pair) {
+      statuses[pair] = level[2 * pair]->MergeFrom(*level[2 * pair + 1]);
+    });
+    RETURN_IF_ERROR(internal::FirstError(statuses));
+    for (int64_t i = 0; i < level.size(); i += 2) {
+      level[i / 2] = std::move(level[i]);
+    }
+    level.resize((level.size() + 1) / 2);
+  }
+  return target->MergeFrom(*level[0]);
+}
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_MERGE_ALL_H_
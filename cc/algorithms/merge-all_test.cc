@@ -0,0 +1,153 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/merge-all.h"
+
+#include <utility>
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/util.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::EqualsProto;
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+base::StatusOr<std::unique_ptr<Algorithm<double>>> MakeBoundedSum() {
+  return BoundedSum<double>::Builder()
+      .SetEpsilon(1.0)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+base::StatusOr<std::unique_ptr<Algorithm<double>>> MakeCount() {
+  return Count<double>::Builder()
+      .SetEpsilon(1.0)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+std::unique_ptr<Algorithm<double>> NewAlgorithm(
+    base::StatusOr<std::unique_ptr<Algorithm<double>>> algorithm) {
+  EXPECT_OK(algorithm);
+  return std::move(algorithm.value());
+}
+
+// Returns num_summaries bounded sum summaries of values that do not add up
+// exactly in floating point.
+std::vector<Summary> MakeBoundedSumSummaries(int num_summaries) {
+  std::vector<Summary> summaries;
+  for (int i = 0; i < num_summaries; ++i) {
+    std::unique_ptr<Algorithm<double>> bs = NewAlgorithm(MakeBoundedSum());
+    bs->AddEntry(0.1 * (i % 7) + 1e-7 * i);
+    summaries.push_back(bs->Serialize());
+  }
+  return summaries;
+}
+
+TEST(MergeAllTest, MergesAllSummaries) {
+  std::vector<Summary> summaries;
+  for (int i = 0; i < 1000; ++i) {
+    std::unique_ptr<Algorithm<double>> count = NewAlgorithm(MakeCount());
+    for (int j = 0; j < i % 5; ++j) {
+      count->AddEntry(j);
+    }
+    summaries.push_back(count->Serialize());
+  }
+  std::unique_ptr<Algorithm<double>> target = NewAlgorithm(MakeCount());
+  target->AddEntry(1);
+  ASSERT_OK(MergeAll<double>(summaries, &MakeCount, target.get(),
+                             /*num_threads=*/4));
+
+  auto output = target->PartialResult();
+  ASSERT_OK(output);
+  // Each block of 5 summaries has 0 + 1 + 2 + 3 + 4 entries.
+  EXPECT_EQ(GetValue<int64_t>(*output), 1 + 200 * 10);
+}
+
+TEST(MergeAllTest, ResultDoesNotDependOnNumberOfThreads) {
+  const std::vector<Summary> summaries = MakeBoundedSumSummaries(1001);
+  std::unique_ptr<Algorithm<double>> expected = NewAlgorithm(MakeBoundedSum());
+  ASSERT_OK(MergeAll<double>(summaries, &MakeBoundedSum, expected.get(),
+                             /*num_threads=*/1));
+  for (int num_threads : {2, 3, 8, 0}) {
+    std::unique_ptr<Algorithm<double>> target = NewAlgorithm(MakeBoundedSum());
+    ASSERT_OK(MergeAll<double>(summaries, &MakeBoundedSum, target.get(),
+                               num_threads));
+    EXPECT_THAT(target->Serialize(), EqualsProto(expected->Serialize()));
+  }
+}
+
+TEST(MergeAllTest, EmptySummariesIsNoOp) {
+  std::unique_ptr<Algorithm<double>> target = NewAlgorithm(MakeBoundedSum());
+  target->AddEntry(3);
+  const Summary before = target->Serialize();
+  EXPECT_OK(MergeAll<double>({}, &MakeBoundedSum, target.get()));
+  EXPECT_THAT(target->Serialize(), EqualsProto(before));
+}
+
+TEST(MergeAllTest, RejectsIncompatibleSummariesBeforeMerging) {
+  std::vector<Summary> summaries = MakeBoundedSumSummaries(40);
+  summaries.push_back(NewAlgorithm(MakeCount())->Serialize());
+  int num_built = 0;
+  auto factory = [&num_built]() {
+    ++num_built;
+    return MakeBoundedSum();
+  };
+  std::unique_ptr<Algorithm<double>> target = NewAlgorithm(MakeBoundedSum());
+  EXPECT_THAT(MergeAll<double>(summaries, factory, target.get()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Summary 40 has type")));
+  EXPECT_EQ(num_built, 0);
+
+  summaries.back().clear_data();
+  EXPECT_THAT(MergeAll<double>(summaries, factory, target.get()),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Summary 40 has no data")));
+}
+
+TEST(MergeAllTest, PropagatesErrors) {
+  const std::vector<Summary> summaries = MakeBoundedSumSummaries(40);
+  std::unique_ptr<Algorithm<double>> target = NewAlgorithm(MakeBoundedSum());
+  EXPECT_THAT(
+      MergeAll<double>(
+          summaries,
+          []() -> base::StatusOr<std::unique_ptr<Algorithm<double>>> {
+            return absl::InvalidArgumentError("Factory failed.");
+          },
+          target.get()),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Factory")));
+
+  // Merging a bounded sum summary into a count fails in the leaves.
+  std::unique_ptr<Algorithm<double>> count = NewAlgorithm(MakeCount());
+  EXPECT_FALSE(MergeAll<double>(summaries, &MakeCount, count.get()).ok());
+}
+
+}  // namespace
+}  // namespace differential_privacy
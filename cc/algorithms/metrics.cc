@@ -0,0 +1,180 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/metrics.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace differential_privacy {
+namespace metrics {
+namespace {
+
+constexpr absl::string_view kEntriesName = "dp_entries_added_total";
+constexpr absl::string_view kEntriesHelp =
+    "Entries added to differentially private algorithms.";
+constexpr absl::string_view kNoiseName = "dp_noise_samples_total";
+constexpr absl::string_view kNoiseHelp =
+    "Noise samples drawn by numerical mechanisms.";
+
+const CounterInfo kCounterInfos[kNumCounters] = {
+    {kEntriesName, "algorithm", "approx_bounds", kEntriesHelp},
+    {kEntriesName, "algorithm", "binary_search", kEntriesHelp},
+    {kEntriesName, "algorithm", "bounded_mean", kEntriesHelp},
+    {kEntriesName, "algorithm", "bounded_statistics", kEntriesHelp},
+    {kEntriesName, "algorithm", "bounded_sum", kEntriesHelp},
+    {kEntriesName, "algorithm", "bounded_variance", kEntriesHelp},
+    {kEntriesName, "algorithm", "count", kEntriesHelp},
+    {kNoiseName, "mechanism", "laplace", kNoiseHelp},
+    {kNoiseName, "mechanism", "gaussian", kNoiseHelp},
+    {"dp_random_bytes_consumed_total", "", "",
+     "Random bytes drawn from SecureURBG."},
+    {"dp_random_buffer_refills_total", "", "",
+     "Buffers of random bytes refilled by SecureURBG."},
+    {"dp_random_bytes_generated_total", "", "",
+     "Random bytes generated to refill the buffers of SecureURBG."},
+    {"dp_binomial_rejection_iterations_total", "", "",
+     "Candidates drawn by the rejection sampling of Gaussian noise."},
+    {"dp_serialized_bytes_total", "", "",
+     "Payload bytes of the summaries returned by Serialize."},
+    {"dp_merged_bytes_total", "", "",
+     "Payload bytes of the summaries passed to Merge."},
+};
+
+// The counters of all live threads, and the totals of the threads that have
+// exited.
+struct Registry {
+  absl::Mutex mutex;
+  std::vector<internal::ThreadCounters*> threads ABSL_GUARDED_BY(mutex);
+  int64_t retired[kNumCounters] ABSL_GUARDED_BY(mutex) = {};
+  std::unique_ptr<MetricsExporter> exporter ABSL_GUARDED_BY(mutex);
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry;
+  return *registry;
+}
+
+// Unregisters the counters of a thread when it exits, and keeps their values
+// in the retired totals.
+class ThreadCountersOwner {
+ public:
+  ThreadCountersOwner() {
+    Registry& registry = GetRegistry();
+    absl::MutexLock lock(&registry.mutex);
+    registry.threads.push_back(&counters_);
+  }
+
+  ~ThreadCountersOwner() {
+    Registry& registry = GetRegistry();
+    absl::MutexLock lock(&registry.mutex);
+    for (int i = 0; i < kNumCounters; ++i) {
+      registry.retired[i] +=
+          counters_.values[i].load(std::memory_order_relaxed);
+    }
+    registry.threads.erase(std::find(registry.threads.begin(),
+                                     registry.threads.end(), &counters_));
+  }
+
+  internal::ThreadCounters* counters() { return &counters_; }
+
+ private:
+  internal::ThreadCounters counters_;
+};
+
+}  // namespace
+
+const CounterInfo& GetCounterInfo(Counter counter) {
+  return kCounterInfos[static_cast<int>(counter)];
+}
+
+int64_t GetCounter(Counter counter) {
+  const int index = static_cast<int>(counter);
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  int64_t total = registry.retired[index];
+  for (const internal::ThreadCounters* counters : registry.threads) {
+    total += counters->values[index].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+std::vector<CounterValue> Snapshot() {
+  std::vector<CounterValue> values(kNumCounters);
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  for (int i = 0; i < kNumCounters; ++i) {
+    values[i].counter = static_cast<Counter>(i);
+    values[i].value = registry.retired[i];
+  }
+  for (const internal::ThreadCounters* counters : registry.threads) {
+    for (int i = 0; i < kNumCounters; ++i) {
+      values[i].value += counters->values[i].load(std::memory_order_relaxed);
+    }
+  }
+  return values;
+}
+
+void SetExporter(std::unique_ptr<MetricsExporter> exporter) {
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  registry.exporter = std::move(exporter);
+}
+
+void ExportMetrics() {
+  std::vector<CounterValue> values = Snapshot();
+  Registry& registry = GetRegistry();
+  absl::MutexLock lock(&registry.mutex);
+  if (registry.exporter != nullptr) {
+    registry.exporter->Export(values);
+  }
+}
+
+std::string FormatPrometheusText(const std::vector<CounterValue>& values) {
+  std::string text;
+  absl::string_view last_name;
+  for (const CounterValue& value : values) {
+    const CounterInfo& info = GetCounterInfo(value.counter);
+    // Counters of the same name are consecutive, so each name gets its HELP
+    // and TYPE lines once.
+    if (info.name != last_name) {
+      absl::StrAppend(&text, "# HELP ", info.name, " ", info.help, "\n",
+                      "# TYPE ", info.name, " counter\n");
+      last_name = info.name;
+    }
+    absl::StrAppend(&text, info.name);
+    if (!info.label_name.empty()) {
+      absl::StrAppend(&text, "{", info.label_name, "=\"", info.label_value,
+                      "\"}");
+    }
+    absl::StrAppend(&text, " ", value.value, "\n");
+  }
+  return text;
+}
+
+namespace internal {
+
+ThreadCounters* RegisterThread() {
+  static thread_local ThreadCountersOwner owner;
+  return owner.counters();
+}
+
+}  // namespace internal
+}  // namespace metrics
+}  // namespace differential_privacy
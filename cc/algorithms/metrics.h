@@ -0,0 +1,167 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_METRICS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+
+namespace differential_privacy {
+namespace metrics {
+
+// Counters of the work done by the library, to attribute CPU time and
+// randomness to the algorithms and mechanisms that consume them.
+//
+// Counters are kept per thread and only combined when they are read, so
+// incrementing one is a relaxed load and store on memory owned by the calling
+// thread. Building with --define dp_metrics=disabled, which defines
+// DIFFERENTIAL_PRIVACY_DISABLE_METRICS, compiles all increments away.
+enum class Counter {
+  // Entries added to each algorithm type through AddEntry, AddEntryWithCount
+  // or AddEntries. Algorithms that only forward entries to another algorithm,
+  // e.g., BoundedStandardDeviation to BoundedVariance, count them under the
+  // algorithm that stores them.
+  kApproxBoundsEntries,
+  kBinarySearchEntries,
+  kBoundedMeanEntries,
+  kBoundedStatisticsEntries,
+  kBoundedSumEntries,
+  kBoundedVarianceEntries,
+  kCountEntries,
+  // Noise samples drawn by each mechanism.
+  kLaplaceNoiseSamples,
+  kGaussianNoiseSamples,
+  // Random bytes drawn from SecureURBG.
+  kRandomBytesConsumed,
+  // Buffers refilled by SecureURBG, and the random bytes generated for them.
+  kRandomBufferRefills,
+  kRandomBytesGenerated,
+  // Candidates drawn by the rejection sampling of the Gaussian distribution.
+  kBinomialRejectionIterations,
+  // Payload bytes of the summaries returned by Serialize and passed to Merge.
+  // Algorithms that contain other algorithms, e.g., BoundedMean with
+  // ApproxBounds, also count the summaries of the contained algorithms.
+  kSerializedBytes,
+  kMergedBytes,
+  kNumCounters
+};
+
+constexpr int kNumCounters = static_cast<int>(Counter::kNumCounters);
+
+#ifdef DIFFERENTIAL_PRIVACY_DISABLE_METRICS
+constexpr bool kMetricsEnabled = false;
+#else
+constexpr bool kMetricsEnabled = true;
+#endif
+
+// Description of a counter for exporters. The name and label are chosen for
+// the Prometheus and OpenTelemetry naming conventions, e.g., all entry
+// counters share the name "dp_entries_added_total" and are told apart by the
+// "algorithm" label.
+struct CounterInfo {
+  absl::string_view name;
+  // Empty for counters without a label.
+  absl::string_view label_name;
+  absl::string_view label_value;
+  absl::string_view help;
+};
+
+// Returns the description of counter.
+const CounterInfo& GetCounterInfo(Counter counter);
+
+// The value of a counter at the time of a snapshot.
+struct CounterValue {
+  Counter counter;
+  int64_t value;
+};
+
+// Returns the sum of counter over all threads, including those that have
+// exited. Always 0 if metrics are disabled.
+int64_t GetCounter(Counter counter);
+
+// Returns the values of all counters. The snapshot is not atomic across
+// counters, so increments racing with it may show in some counters only.
+std::vector<CounterValue> Snapshot();
+
+// Receives snapshots of the counters, e.g., to register them with a metrics
+// library. Implementations must be thread-safe if ExportMetrics is called
+// from several threads.
+class MetricsExporter {
+ public:
+  virtual ~MetricsExporter() = default;
+
+  virtual void Export(const std::vector<CounterValue>& values) = 0;
+};
+
+// Sets the exporter that ExportMetrics passes snapshots to, replacing the
+// previous one. nullptr removes the exporter.
+void SetExporter(std::unique_ptr<MetricsExporter> exporter);
+
+// Takes a snapshot and passes it to the exporter, if any. Meant to be called
+// periodically or from the scrape handler of the monitoring system.
+void ExportMetrics();
+
+// Formats values in the Prometheus text exposition format, with HELP and TYPE
+// lines for each metric name.
+std::string FormatPrometheusText(const std::vector<CounterValue>& values);
+
+namespace internal {
+
+// The counters of one thread. Only the owning thread writes them, so the
+// atomics merely make the concurrent reads of Snapshot well-defined.
+struct alignas(64) ThreadCounters {
+  std::atomic<int64_t> values[kNumCounters] = {};
+};
+
+// Allocates and registers the counters of the calling thread.
+ThreadCounters* RegisterThread();
+
+inline ThreadCounters& LocalCounters() {
+  // A pointer needs no dynamic initialization, so the thread_local access is
+  // a plain TLS load.
+  static thread_local ThreadCounters* counters = nullptr;
+  if (ABSL_PREDICT_FALSE(counters == nullptr)) {
+    counters = RegisterThread();
+  }
+  return *counters;
+}
+
+}  // namespace internal
+
+// Adds n to counter for the calling thread. The counter wraps around on
+// overflow, e.g., for entries added with a count above the range of int64_t.
+inline void Add(Counter counter, int64_t n = 1) {
+#ifndef DIFFERENTIAL_PRIVACY_DISABLE_METRICS
+  std::atomic<int64_t>& value =
+      internal::LocalCounters().values[static_cast<int>(counter)];
+  value.store(static_cast<int64_t>(
+                  static_cast<uint64_t>(value.load(std::memory_order_relaxed)) +
+                  static_cast<uint64_t>(n)),
+              std::memory_order_relaxed);
+#endif
+}
+
+}  // namespace metrics
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_METRICS_H_
@@ -0,0 +1,185 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/metrics.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/rand.h"
+
+namespace differential_privacy {
+namespace metrics {
+namespace {
+
+using ::testing::HasSubstr;
+
+TEST(MetricsTest, AddsOverThreads) {
+  const int64_t before = GetCounter(Counter::kMergedBytes);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 1000; ++j) {
+        Add(Counter::kMergedBytes, 2);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  Add(Counter::kMergedBytes);
+  EXPECT_EQ(GetCounter(Counter::kMergedBytes) - before,
+            kMetricsEnabled ? 8001 : 0);
+}
+
+TEST(MetricsTest, CountsEntriesPerAlgorithm) {
+  if (!kMetricsEnabled) GTEST_SKIP() << "Metrics are disabled.";
+  const int64_t count_before = GetCounter(Counter::kCountEntries);
+  const int64_t sum_before = GetCounter(Counter::kBoundedSumEntries);
+  std::unique_ptr<Count<double>> count =
+      Count<double>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  std::vector<double> entries = {1, 2, 3};
+  count->AddEntry(1);
+  count->AddEntryWithCount(1, 10);
+  count->AddEntries(absl::MakeConstSpan(entries));
+  EXPECT_EQ(GetCounter(Counter::kCountEntries) - count_before, 14);
+  EXPECT_EQ(GetCounter(Counter::kBoundedSumEntries), sum_before);
+}
+
+TEST(MetricsTest, CountsSummaryBytes) {
+  if (!kMetricsEnabled) GTEST_SKIP() << "Metrics are disabled.";
+  std::unique_ptr<BoundedSum<int64_t>> sum = BoundedSum<int64_t>::Builder()
+                                                 .SetEpsilon(1)
+                                                 .SetLower(0)
+                                                 .SetUpper(10)
+                                                 .Build()
+                                                 .ValueOrDie();
+  sum->AddEntry(5);
+  const int64_t serialized_before = GetCounter(Counter::kSerializedBytes);
+  Summary summary = sum->Serialize();
+  EXPECT_EQ(GetCounter(Counter::kSerializedBytes) - serialized_before,
+            summary.data().value().size());
+  const int64_t merged_before = GetCounter(Counter::kMergedBytes);
+  EXPECT_TRUE(sum->Merge(summary).ok());
+  EXPECT_EQ(GetCounter(Counter::kMergedBytes) - merged_before,
+            summary.data().value().size());
+}
+
+TEST(MetricsTest, CountsNoiseAndRandomness) {
+  if (!kMetricsEnabled) GTEST_SKIP() << "Metrics are disabled.";
+  std::unique_ptr<NumericalMechanism> laplace =
+      LaplaceMechanism::Builder().SetEpsilon(1).Build().ValueOrDie();
+  std::unique_ptr<NumericalMechanism> gaussian = GaussianMechanism::Builder()
+                                                     .SetL2Sensitivity(1)
+                                                     .SetDelta(1e-5)
+                                                     .SetEpsilon(1)
+                                                     .Build()
+                                                     .ValueOrDie();
+  const int64_t laplace_before = GetCounter(Counter::kLaplaceNoiseSamples);
+  const int64_t gaussian_before = GetCounter(Counter::kGaussianNoiseSamples);
+  const int64_t iterations_before =
+      GetCounter(Counter::kBinomialRejectionIterations);
+  const int64_t bytes_before = GetCounter(Counter::kRandomBytesConsumed);
+  laplace->AddNoise(0);
+  gaussian->AddNoise(0);
+  std::vector<double> values(10);
+  EXPECT_TRUE(gaussian
+                  ->AddNoise(absl::MakeConstSpan(values),
+                             absl::MakeSpan(values), 1.0)
+                  .ok());
+  EXPECT_EQ(GetCounter(Counter::kLaplaceNoiseSamples) - laplace_before, 1);
+  EXPECT_EQ(GetCounter(Counter::kGaussianNoiseSamples) - gaussian_before, 11);
+  EXPECT_GE(GetCounter(Counter::kBinomialRejectionIterations) -
+                iterations_before,
+            11);
+  EXPECT_GT(GetCounter(Counter::kRandomBytesConsumed), bytes_before);
+}
+
+TEST(MetricsTest, CountsBufferRefills) {
+  if (!kMetricsEnabled) GTEST_SKIP() << "Metrics are disabled.";
+  const int64_t refills_before = GetCounter(Counter::kRandomBufferRefills);
+  const int64_t generated_before = GetCounter(Counter::kRandomBytesGenerated);
+  // Drawing more than a buffer refills it at least once.
+  for (int i = 0; i <= SecureURBG::GetBufferSize() / 8; ++i) {
+    SecureURBG::GetSingleton()();
+  }
+  EXPECT_GE(GetCounter(Counter::kRandomBufferRefills) - refills_before, 1);
+  EXPECT_GE(GetCounter(Counter::kRandomBytesGenerated) - generated_before,
+            SecureURBG::GetBufferSize());
+}
+
+TEST(MetricsTest, SnapshotHasAllCounters) {
+  std::vector<CounterValue> values = Snapshot();
+  ASSERT_EQ(values.size(), kNumCounters);
+  for (int i = 0; i < kNumCounters; ++i) {
+    EXPECT_EQ(values[i].counter, static_cast<Counter>(i));
+    EXPECT_EQ(values[i].value, GetCounter(static_cast<Counter>(i)));
+  }
+}
+
+class RecordingExporter : public MetricsExporter {
+ public:
+  explicit RecordingExporter(std::vector<CounterValue>* exported)
+      : exported_(exported) {}
+
+  void Export(const std::vector<CounterValue>& values) override {
+    *exported_ = values;
+  }
+
+ private:
+  std::vector<CounterValue>* exported_;
+};
+
+TEST(MetricsTest, ExportsToExporter) {
+  std::vector<CounterValue> exported;
+  SetExporter(absl::make_unique<RecordingExporter>(&exported));
+  ExportMetrics();
+  EXPECT_EQ(exported.size(), kNumCounters);
+  SetExporter(nullptr);
+  exported.clear();
+  ExportMetrics();
+  EXPECT_TRUE(exported.empty());
+}
+
+TEST(MetricsTest, FormatsPrometheusText) {
+  std::string text = FormatPrometheusText(
+      {{Counter::kCountEntries, 3},
+       {Counter::kBoundedSumEntries, 4},
+       {Counter::kRandomBufferRefills, 5}});
+  EXPECT_EQ(text,
+            "# HELP dp_entries_added_total Entries added to differentially "
+            "private algorithms.\n"
+            "# TYPE dp_entries_added_total counter\n"
+            "dp_entries_added_total{algorithm=\"count\"} 3\n"
+            "dp_entries_added_total{algorithm=\"bounded_sum\"} 4\n"
+            "# HELP dp_random_buffer_refills_total Buffers of random bytes "
+            "refilled by SecureURBG.\n"
+            "# TYPE dp_random_buffer_refills_total counter\n"
+            "dp_random_buffer_refills_total 5\n");
+  EXPECT_THAT(FormatPrometheusText(Snapshot()),
+              HasSubstr("dp_noise_samples_total{mechanism=\"gaussian\"}"));
+}
+
+}  // namespace
+}  // namespace metrics
+}  // namespace differential_privacy
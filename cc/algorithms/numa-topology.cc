@@ -0,0 +1,207 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/numa-topology.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+
+#include <cstring>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/base/optimization.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+
+namespace differential_privacy {
+namespace {
+
+#ifdef __linux__
+
+constexpr char kNodeDirectory[] = "/sys/devices/system/node/";
+
+// Returns the contents of a sysfs file, or an empty string if it cannot be
+// read.
+std::string ReadSysfsFile(const std::string& path) {
+  std::ifstream file(path);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+base::StatusOr<std::vector<int>> ParseCpuList(absl::string_view cpu_list) {
+  std::vector<int> cpus;
+  cpu_list = absl::StripAsciiWhitespace(cpu_list);
+  if (cpu_list.empty()) {
+    return cpus;
+  }
+  for (absl::string_view range : absl::StrSplit(cpu_list, ',')) {
+    const std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+    int first;
+    int last;
+    if (bounds.size() > 2 || !absl::SimpleAtoi(bounds.front(), &first) ||
+        !absl::SimpleAtoi(bounds.back(), &last) || first < 0 ||
+        last < first) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid CPU list: ", cpu_list));
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+#ifdef __linux__
+
+NumaTopology NumaTopology::Detect() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return SingleNode();
+  }
+  base::StatusOr<std::vector<int>> nodes =
+      ParseCpuList(ReadSysfsFile(absl::StrCat(kNodeDirectory, "online")));
+  if (!nodes.ok()) {
+    return SingleNode();
+  }
+  NumaTopology topology;
+  for (int node : nodes.value()) {
+    base::StatusOr<std::vector<int>> cpus = ParseCpuList(ReadSysfsFile(
+        absl::StrCat(kNodeDirectory, "node", node, "/cpulist")));
+    if (!cpus.ok()) {
+      return SingleNode();
+    }
+    std::vector<int> node_cpus;
+    for (int cpu : cpus.value()) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        node_cpus.push_back(cpu);
+      }
+    }
+    // Nodes without CPUs, e.g., memory-only nodes, cannot run threads.
+    if (!node_cpus.empty()) {
+      topology.node_cpus.push_back(std::move(node_cpus));
+    }
+  }
+  if (topology.node_cpus.empty()) {
+    return SingleNode();
+  }
+  return topology;
+}
+
+absl::Status PinCurrentThreadToCpus(absl::Span<const int> cpus) {
+  if (cpus.empty()) {
+    return absl::InvalidArgumentError("Cannot pin a thread to no CPUs.");
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("CPU ", cpu, " is out of range."));
+    }
+    CPU_SET(cpu, &set);
+  }
+  const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (error != 0) {
+    return absl::InternalError(
+        absl::StrCat("Cannot pin thread: ", std::strerror(error)));
+  }
+  return absl::OkStatus();
+}
+
+#else  // __linux__
+
+NumaTopology NumaTopology::Detect() { return SingleNode(); }
+
+absl::Status PinCurrentThreadToCpus(absl::Span<const int> cpus) {
+  return absl::UnimplementedError(
+      "Pinning threads is only supported on Linux.");
+}
+
+#endif  // __linux__
+
+namespace internal {
+
+void NumaParallelFor(const NumaTopology& topology,
+                     absl::Span<const std::vector<int64_t>> node_tasks,
+                     int num_threads, bool pin_threads,
+                     const std::function<void(int64_t)>& fn) {
+  int64_t num_tasks = 0;
+  for (const std::vector<int64_t>& tasks : node_tasks) {
+    num_tasks += tasks.size();
+  }
+  const int num_workers = static_cast<int>(
+      std::min<int64_t>(std::max(num_threads, 1), num_tasks));
+  if (num_workers <= 1) {
+    for (const std::vector<int64_t>& tasks : node_tasks) {
+      for (int64_t task : tasks) {
+        fn(task);
+      }
+    }
+    return;
+  }
+
+  // The index of the next task of every node, each on its own cache line so
+  // that the threads of different nodes do not contend on it until they
+  // steal.
+  struct alignas(ABSL_CACHELINE_SIZE) Queue {
+    std::atomic<int64_t> next{0};
+  };
+  const int num_nodes = node_tasks.size();
+  auto queues = absl::make_unique<Queue[]>(num_nodes);
+  auto work = [&](int home) {
+    if (pin_threads && home < topology.NumNodes() &&
+        !topology.node_cpus[home].empty()) {
+      // An unpinned thread still produces correct results, only slower.
+      PinCurrentThreadToCpus(topology.node_cpus[home]).IgnoreError();
+    }
+    for (int offset = 0; offset < num_nodes; ++offset) {
+      const int node = (home + offset) % num_nodes;
+      const std::vector<int64_t>& tasks = node_tasks[node];
+      for (int64_t i = queues[node].next.fetch_add(1); i < tasks.size();
+           i = queues[node].next.fetch_add(1)) {
+        fn(tasks[i]);
+      }
+    }
+  };
+  // The calling thread only waits, so that its affinity is left unchanged.
+  std::vector<std::thread> workers;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(work, i % num_nodes);
+  }
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+}  // namespace internal
+}  // namespace differential_privacy
@@ -0,0 +1,76 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_NUMA_TOPOLOGY_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_NUMA_TOPOLOGY_H_
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+
+namespace differential_privacy {
+
+// The CPUs of every NUMA node that the process may run on. Node i of the
+// topology is the i-th such node, which may differ from the node number of
+// the kernel if some nodes have no CPUs.
+struct NumaTopology {
+  std::vector<std::vector<int>> node_cpus;
+
+  int NumNodes() const { return node_cpus.size(); }
+
+  // Reads the topology from /sys/devices/system/node on Linux, restricted to
+  // the CPUs in the affinity mask of the calling thread. Returns a single
+  // node without CPUs if the topology cannot be read, e.g., on other
+  // platforms, in which case threads are not pinned.
+  static NumaTopology Detect();
+
+  // Returns a single node without CPUs.
+  static NumaTopology SingleNode() { return {{{}}}; }
+};
+
+// Parses a CPU list in the format of the kernel, e.g., "0-3,8,10-11".
+base::StatusOr<std::vector<int>> ParseCpuList(absl::string_view cpu_list);
+
+// Restricts the calling thread to run on cpus. Memory that the thread first
+// touches afterwards is then allocated on the node of these CPUs under the
+// default policy of Linux. Returns an Unimplemented error on other platforms.
+absl::Status PinCurrentThreadToCpus(absl::Span<const int> cpus);
+
+namespace internal {
+
+// Calls fn(task) for every task in node_tasks on up to num_threads threads
+// and returns when all calls are done. node_tasks[i] are the tasks whose data
+// lives on node i of topology. The threads are spread evenly over the nodes
+// and, if pin_threads is true, pinned to the CPUs of their node. Each thread
+// first takes the tasks of its own node, and then steals the remaining tasks
+// of the other nodes, so that nodes with more or slower tasks do not leave
+// the other threads idle. The calling thread only waits for the others, so
+// that its own affinity is not changed; with a single thread, all tasks are
+// run on the calling thread instead.
+void NumaParallelFor(const NumaTopology& topology,
+                     absl::Span<const std::vector<int64_t>> node_tasks,
+                     int num_threads, bool pin_threads,
+                     const std::function<void(int64_t)>& fn);
+
+}  // namespace internal
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_NUMA_TOPOLOGY_H_
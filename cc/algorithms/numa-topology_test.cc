@@ -0,0 +1,97 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/numa-topology.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::IsOkAndHolds;
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(NumaTopologyTest, ParsesCpuLists) {
+  EXPECT_THAT(ParseCpuList("0-3,8,10-11\n"),
+              IsOkAndHolds(ElementsAre(0, 1, 2, 3, 8, 10, 11)));
+  EXPECT_THAT(ParseCpuList("5"), IsOkAndHolds(ElementsAre(5)));
+  EXPECT_THAT(ParseCpuList("\n"), IsOkAndHolds(IsEmpty()));
+  for (const char* invalid : {"a", "3-1", "1-2-3", "1,,2", "-1"}) {
+    EXPECT_THAT(ParseCpuList(invalid),
+                StatusIs(absl::StatusCode::kInvalidArgument))
+        << invalid;
+  }
+}
+
+TEST(NumaTopologyTest, DetectsAtLeastOneNode) {
+  const NumaTopology topology = NumaTopology::Detect();
+  ASSERT_GE(topology.NumNodes(), 1);
+#ifdef __linux__
+  // The calling thread may run on every detected CPU, so pinning to them
+  // succeeds.
+  if (!topology.node_cpus[0].empty()) {
+    EXPECT_OK(PinCurrentThreadToCpus(topology.node_cpus[0]));
+  }
+#endif
+}
+
+TEST(NumaTopologyTest, ParallelForRunsEveryTaskOnce) {
+  // All tasks are on the first node, so the threads of the other nodes have
+  // to steal them.
+  const NumaTopology topology = {{{}, {}, {}}};
+  const int kNumTasks = 1000;
+  std::vector<std::vector<int64_t>> node_tasks(3);
+  for (int64_t task = 0; task < kNumTasks; ++task) {
+    node_tasks[task < 900 ? 0 : 2].push_back(task);
+  }
+  for (int num_threads : {1, 2, 7}) {
+    std::vector<std::atomic<int>> calls(kNumTasks);
+    internal::NumaParallelFor(topology, node_tasks, num_threads,
+                              /*pin_threads=*/true,
+                              [&calls](int64_t task) { ++calls[task]; });
+    for (int task = 0; task < kNumTasks; ++task) {
+      EXPECT_EQ(calls[task], 1) << task << " with " << num_threads;
+    }
+  }
+}
+
+TEST(NumaTopologyTest, ParallelForPinsThreadsToTheirNode) {
+  const NumaTopology detected = NumaTopology::Detect();
+  if (detected.node_cpus[0].empty()) {
+    GTEST_SKIP() << "No CPUs detected.";
+  }
+  // Every node of this topology has the CPUs of the first detected node, so
+  // pinning succeeds on all of them.
+  const NumaTopology topology = {{detected.node_cpus[0],
+                                  detected.node_cpus[0]}};
+  std::vector<std::vector<int64_t>> node_tasks = {{0, 1}, {2, 3}};
+  std::atomic<int> calls(0);
+  internal::NumaParallelFor(topology, node_tasks, /*num_threads=*/4,
+                            /*pin_threads=*/true,
+                            [&calls](int64_t) { ++calls; });
+  EXPECT_EQ(calls, 4);
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -52,10 +52,19 @@ class ZeroNoiseMechanism : public LaplaceMechanism {
   ZeroNoiseMechanism(double epsilon, double sensitivity)
       : LaplaceMechanism(epsilon, sensitivity) {}
 
+  using LaplaceMechanism::AddNoise;
+
   double AddNoise(double result, double privacy_budget) override {
     return result;
   }
 
+  absl::Status AddNoise(absl::Span<const double> results,
+                        absl::Span<double> noised_results,
+                        double privacy_budget) override {
+    return NumericalMechanism::AddNoise(results, noised_results,
+                                        privacy_budget);
+  }
+
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
       double confidence_level, double privacy_budget) override {
     ConfidenceInterval confidence;
@@ -68,6 +77,22 @@ class ZeroNoiseMechanism : public LaplaceMechanism {
   int64_t MemoryUsed() override { return sizeof(ZeroNoiseMechanism); }
 };
 
+// Builds ZeroNoiseMechanisms, and counts how often it and its clones are
+// cloned in *clones, e.g., to test that algorithm builders do not clone it
+// needlessly. Use only for testing.
+class CloneCountingMechanismBuilder : public ZeroNoiseMechanism::Builder {
+ public:
+  explicit CloneCountingMechanismBuilder(int* clones) : clones_(clones) {}
+
+  std::unique_ptr<NumericalMechanismBuilder> Clone() const override {
+    ++*clones_;
+    return absl::make_unique<CloneCountingMechanismBuilder>(*this);
+  }
+
+ private:
+  int* clones_;
+};
+
 class SeededGeometricDistribution : public internal::GeometricDistribution {
  public:
   SeededGeometricDistribution(double lambda, std::mt19937* rand_gen)
@@ -77,6 +102,10 @@ class SeededGeometricDistribution : public internal::GeometricDistribution {
     return absl::Uniform(*rand_gen_, 0, 1.0);
   }
 
+  int64_t GetUniformInteger(int64_t upper) override {
+    return absl::Uniform<int64_t>(*rand_gen_, 0, upper);
+  }
+
  private:
   std::mt19937* rand_gen_;
 };
@@ -196,6 +225,14 @@ class MockLaplaceMechanism : public LaplaceMechanism {
   MockLaplaceMechanism(double epsilon, double sensitivity)
       : LaplaceMechanism(epsilon, sensitivity) {}
   MOCK_METHOD2_T(AddNoise, double(double result, double privacy_budget));
+
+  // Routes batched calls through the mocked scalar AddNoise.
+  absl::Status AddNoise(absl::Span<const double> results,
+                        absl::Span<double> noised_results,
+                        double privacy_budget) override {
+    return NumericalMechanism::AddNoise(results, noised_results,
+                                        privacy_budget);
+  }
   MOCK_METHOD2_T(NoiseConfidenceInterval,
                  base::StatusOr<ConfidenceInterval>(double confidence_level,
                                                     double privacy_budget));
@@ -19,6 +19,7 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 #include <string>
@@ -33,7 +34,9 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "algorithms/distributions.h"
+#include "algorithms/metrics.h"
 #include "algorithms/rand.h"
 #include "algorithms/util.h"
 #include "proto/confidence-interval.pb.h"
@@ -69,6 +72,22 @@ class NumericalMechanism {
 
   double AddNoise(double result) { return AddNoise(result, 1.0); }
 
+  // Adds noise to each value of results and writes the noised values to the
+  // corresponding position of noised_results. Each value is noised with the
+  // given privacy_budget, exactly as if AddNoise(result, privacy_budget) had
+  // been called on it. results and noised_results must have the same size and
+  // may refer to the same memory. Mechanisms override this to compute the
+  // noise parameters once for the whole batch.
+  virtual absl::Status AddNoise(absl::Span<const double> results,
+                                absl::Span<double> noised_results,
+                                double privacy_budget) {
+    RETURN_IF_ERROR(CheckBatchSizes(results, noised_results));
+    for (int i = 0; i < results.size(); ++i) {
+      noised_results[i] = AddNoise(results[i], privacy_budget);
+    }
+    return absl::OkStatus();
+  }
+
   // Quickly determines if result with added noise is greater than threshold.
   // This method allows for quicker thresholding decisions by using a uniform
   // random number instead of the slower (i.e., more complex to compute) noise
@@ -117,8 +136,42 @@ class NumericalMechanism {
     return Clamp<double>(std::numeric_limits<double>::min(), 1, privacy_budget);
   }
 
+  absl::Status CheckBatchSizes(absl::Span<const double> results,
+                               absl::Span<double> noised_results) {
+    if (results.size() != noised_results.size()) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Input and output of batched AddNoise must have the same size, but "
+          "are of size ",
+          results.size(), " and ", noised_results.size(), "."));
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns calculate_bound(), reusing the result of the previous call when
+  // both the confidence level and the privacy budget are unchanged. Confidence
+  // intervals are usually requested for many results with the same arguments,
+  // so a single entry is enough to skip the recomputation for all but the
+  // first of them.
+  template <typename CalculateBound>
+  double CachedConfidenceBound(double confidence_level, double privacy_budget,
+                               CalculateBound calculate_bound) {
+    if (!cached_confidence_level_.has_value() ||
+        *cached_confidence_level_ != confidence_level ||
+        cached_confidence_budget_ != privacy_budget) {
+      cached_confidence_bound_ = calculate_bound();
+      cached_confidence_level_ = confidence_level;
+      cached_confidence_budget_ = privacy_budget;
+    }
+    return cached_confidence_bound_;
+  }
+
  private:
   double epsilon_;
+
+  // Arguments and result of the last CachedConfidenceBound computation.
+  absl::optional<double> cached_confidence_level_;
+  double cached_confidence_budget_ = 0;
+  double cached_confidence_bound_ = 0;
 };
 
 // Provides a common abstraction for Builders for NumericalMechanism.
@@ -190,6 +243,13 @@ class LaplaceMechanism : public NumericalMechanism {
       return *this;
     }
 
+    // Selects how the underlying geometric noise is sampled. Does not affect
+    // the distribution of the noise.
+    Builder& SetGeometricSamplingMethod(GeometricSamplingMethod method) {
+      sampling_method_ = method;
+      return *this;
+    }
+
     base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() override {
       RETURN_IF_ERROR(ValidateIsFiniteAndPositive(GetEpsilon(), "Epsilon"));
       double epsilon = GetEpsilon().value();
@@ -209,7 +269,7 @@ class LaplaceMechanism : public NumericalMechanism {
       if (!gran_or_status.ok()) return gran_or_status.status();
 
       std::unique_ptr<NumericalMechanism> result =
-          absl::make_unique<LaplaceMechanism>(epsilon, L1);
+          absl::make_unique<LaplaceMechanism>(epsilon, L1, sampling_method_);
       return result;
     }
 
@@ -219,9 +279,14 @@ class LaplaceMechanism : public NumericalMechanism {
 
    protected:
     absl::optional<double> GetL1Sensitivity() const { return l1_sensitivity_; }
+    GeometricSamplingMethod GetGeometricSamplingMethod() const {
+      return sampling_method_;
+    }
 
    private:
     absl::optional<double> l1_sensitivity_;
+    GeometricSamplingMethod sampling_method_ =
+        GeometricSamplingMethod::kBinarySearch;
 
     // Returns the l1 sensitivity when it has been set or returns an upper bound
     // on the l1 sensitivity calculated from l0 and linf sensitivities.
@@ -257,12 +322,14 @@ class LaplaceMechanism : public NumericalMechanism {
     }
   };
 
-  explicit LaplaceMechanism(double epsilon, double sensitivity = 1.0)
+  explicit LaplaceMechanism(
+      double epsilon, double sensitivity = 1.0,
+      GeometricSamplingMethod method = GeometricSamplingMethod::kBinarySearch)
       : NumericalMechanism(epsilon),
         sensitivity_(sensitivity),
         diversity_(sensitivity / epsilon),
         distro_(absl::make_unique<internal::LaplaceDistribution>(
-            GetEpsilon(), sensitivity_)) {}
+            GetEpsilon(), sensitivity_, method)) {}
 
   LaplaceMechanism(double epsilon, double sensitivity,
                    std::unique_ptr<internal::LaplaceDistribution> distro)
@@ -282,10 +349,26 @@ class LaplaceMechanism : public NumericalMechanism {
   // budget of 0.5 (or 0.4 and 0.6, etc).
   double AddNoise(double result, double privacy_budget) override {
     privacy_budget = CheckAndClampBudget(privacy_budget);
+    metrics::Add(metrics::Counter::kLaplaceNoiseSamples);
     double sample = distro_->Sample(1.0 / privacy_budget);
     return RoundToNearestMultiple(result, distro_->GetGranularity()) + sample;
   }
 
+  absl::Status AddNoise(absl::Span<const double> results,
+                        absl::Span<double> noised_results,
+                        double privacy_budget) override {
+    RETURN_IF_ERROR(CheckBatchSizes(results, noised_results));
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    const double scale = 1.0 / privacy_budget;
+    const double granularity = distro_->GetGranularity();
+    metrics::Add(metrics::Counter::kLaplaceNoiseSamples, results.size());
+    for (int i = 0; i < results.size(); ++i) {
+      noised_results[i] = RoundToNearestMultiple(results[i], granularity) +
+                          distro_->Sample(scale);
+    }
+    return absl::OkStatus();
+  }
+
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
     return UniformDouble() >
@@ -309,7 +392,10 @@ class LaplaceMechanism : public NumericalMechanism {
     RETURN_IF_ERROR(CheckConfidenceLevel(confidence_level));
     RETURN_IF_ERROR(CheckPrivacyBudget(privacy_budget));
 
-    double bound = diversity_ * log(1 - confidence_level) / privacy_budget;
+    double bound =
+        CachedConfidenceBound(confidence_level, privacy_budget, [&] {
+          return diversity_ * log(1 - confidence_level) / privacy_budget;
+        });
 
     ConfidenceInterval confidence;
     confidence.set_lower_bound(noised_result + bound);
@@ -423,15 +509,40 @@ class GaussianMechanism : public NumericalMechanism {
   double AddNoise(double result, double privacy_budget) override {
     privacy_budget = CheckAndClampBudget(privacy_budget);
 
-    double local_epsilon = privacy_budget * GetEpsilon();
-    double local_delta = privacy_budget * delta_;
-    double stddev = CalculateStddev(local_epsilon, local_delta);
+    double stddev = GetStddevForBudget(privacy_budget);
+    metrics::Add(metrics::Counter::kGaussianNoiseSamples);
     double sample = distro_->Sample(stddev);
 
     return RoundToNearestMultiple(result, distro_->GetGranularity(stddev)) +
            sample;
   }
 
+  // Computes the granularity once for the whole batch and draws the noise
+  // with the batch sampler of the Gaussian distribution.
+  absl::Status AddNoise(absl::Span<const double> results,
+                        absl::Span<double> noised_results,
+                        double privacy_budget) override {
+    RETURN_IF_ERROR(CheckBatchSizes(results, noised_results));
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    const double stddev = GetStddevForBudget(privacy_budget);
+    const double granularity = distro_->GetGranularity(stddev);
+    metrics::Add(metrics::Counter::kGaussianNoiseSamples, results.size());
+    // The noise is drawn into a separate buffer since results and
+    // noised_results may alias.
+    constexpr int kChunkSize = 256;
+    double samples[kChunkSize];
+    for (int start = 0; start < results.size(); start += kChunkSize) {
+      int size = std::min<int>(kChunkSize, results.size() - start);
+      distro_->Sample(stddev, absl::MakeSpan(samples, size));
+      for (int i = 0; i < size; ++i) {
+        noised_results[start + i] =
+            RoundToNearestMultiple(results[start + i], granularity) +
+            samples[i];
+      }
+    }
+    return absl::OkStatus();
+  }
+
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
     return UniformDouble() > internal::GaussianDistribution::cdf(
@@ -462,15 +573,14 @@ class GaussianMechanism : public NumericalMechanism {
     RETURN_IF_ERROR(CheckConfidenceLevel(confidence_level));
     RETURN_IF_ERROR(CheckPrivacyBudget(privacy_budget));
 
-    double local_epsilon = privacy_budget * GetEpsilon();
-    double local_delta = privacy_budget * delta_;
-    double stddev = CalculateStddev(local_epsilon, local_delta);
-
-    ConfidenceInterval confidence;
     // calculated using the symmetric properties of the Gaussian distribution
     // and the cumulative distribution function for the distribution
-    float bound =
-        InverseErrorFunction(-1 * confidence_level) * stddev * std::sqrt(2);
+    float bound = CachedConfidenceBound(confidence_level, privacy_budget, [&] {
+      return InverseErrorFunction(-1 * confidence_level) *
+             GetStddevForBudget(privacy_budget) * std::sqrt(2);
+    });
+
+    ConfidenceInterval confidence;
     confidence.set_lower_bound(noised_result + bound);
     confidence.set_upper_bound(noised_result - bound);
     confidence.set_confidence_level(confidence_level);
@@ -524,6 +634,23 @@ class GaussianMechanism : public NumericalMechanism {
   double l2_sensitivity_;
   std::unique_ptr<internal::GaussianDistribution> distro_;
 
+  // The privacy budget for which cached_stddev_ was last computed. Callers
+  // almost always use the same budget for every value, so remembering a single
+  // entry avoids repeating the search in CalculateStddev for each of them.
+  absl::optional<double> cached_budget_;
+  double cached_stddev_ = 0;
+
+  // Returns CalculateStddev for the epsilon and delta scaled by the privacy
+  // budget, reusing the previous result when the budget is unchanged.
+  double GetStddevForBudget(double privacy_budget) {
+    if (!cached_budget_.has_value() || *cached_budget_ != privacy_budget) {
+      cached_stddev_ = CalculateStddev(privacy_budget * GetEpsilon(),
+                                       privacy_budget * delta_);
+      cached_budget_ = privacy_budget;
+    }
+    return cached_stddev_;
+  }
+
   double StandardNormalDistributionCDF(double x) {
     return internal::GaussianDistribution::cdf(1, x);
   }
@@ -0,0 +1,142 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Benchmarks for adding noise with the numerical mechanisms, one value at a
+// time and in batches, and for the random number generation underneath.
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/distributions.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/rand.h"
+
+namespace differential_privacy {
+namespace {
+
+std::unique_ptr<NumericalMechanism> MakeLaplace(
+    GeometricSamplingMethod method) {
+  return LaplaceMechanism::Builder()
+      .SetGeometricSamplingMethod(method)
+      .SetL1Sensitivity(1.0)
+      .SetEpsilon(1.0)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<NumericalMechanism> MakeGaussian() {
+  return GaussianMechanism::Builder()
+      .SetL2Sensitivity(1.0)
+      .SetEpsilon(1.0)
+      .SetDelta(1e-5)
+      .Build()
+      .ValueOrDie();
+}
+
+void BM_LaplaceAddNoise(benchmark::State& state,
+                        GeometricSamplingMethod method) {
+  std::unique_ptr<NumericalMechanism> mechanism = MakeLaplace(method);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism->AddNoise(1.0, 1.0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_LaplaceAddNoise, BinarySearch,
+                  GeometricSamplingMethod::kBinarySearch);
+BENCHMARK_CAPTURE(BM_LaplaceAddNoise, BlockedRejection,
+                  GeometricSamplingMethod::kBlockedRejection);
+
+void BM_LaplaceAddNoiseBatch(benchmark::State& state,
+                             GeometricSamplingMethod method) {
+  std::unique_ptr<NumericalMechanism> mechanism = MakeLaplace(method);
+  std::vector<double> values(state.range(0), 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        mechanism->AddNoise(values, absl::MakeSpan(values), 1.0));
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK_CAPTURE(BM_LaplaceAddNoiseBatch, BinarySearch,
+                  GeometricSamplingMethod::kBinarySearch)
+    ->Range(1 << 4, 1 << 14);
+BENCHMARK_CAPTURE(BM_LaplaceAddNoiseBatch, BlockedRejection,
+                  GeometricSamplingMethod::kBlockedRejection)
+    ->Range(1 << 4, 1 << 14);
+
+void BM_GaussianAddNoise(benchmark::State& state) {
+  std::unique_ptr<NumericalMechanism> mechanism = MakeGaussian();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism->AddNoise(1.0, 1.0));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GaussianAddNoise);
+
+void BM_GaussianAddNoiseBatch(benchmark::State& state) {
+  std::unique_ptr<NumericalMechanism> mechanism = MakeGaussian();
+  std::vector<double> values(state.range(0), 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        mechanism->AddNoise(values, absl::MakeSpan(values), 1.0));
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_GaussianAddNoiseBatch)->Range(1 << 4, 1 << 14);
+
+void BM_GaussianCalculateStddev(benchmark::State& state) {
+  GaussianMechanism mechanism(1.0, 1e-5, 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism.CalculateStddev(1.0, 1e-5));
+  }
+}
+BENCHMARK(BM_GaussianCalculateStddev);
+
+// Draws from SecureURBG with the given buffer mode and generator, on as many
+// threads as the benchmark is run with. The settings are global, so these
+// benchmarks are registered after all others.
+void BM_UniformDouble(benchmark::State& state, SecureURBG::BufferMode mode,
+                      SecureURBG::GeneratorFactory factory) {
+  SecureURBG::SetBufferMode(mode);
+  SecureURBG::SetGeneratorFactory(factory);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UniformDouble());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_UniformDouble, Shared, SecureURBG::BufferMode::kShared,
+                  &MakeRandBytesGenerator)
+    ->ThreadRange(1, 8);
+BENCHMARK_CAPTURE(BM_UniformDouble, ThreadLocal,
+                  SecureURBG::BufferMode::kThreadLocal, &MakeRandBytesGenerator)
+    ->ThreadRange(1, 8);
+BENCHMARK_CAPTURE(BM_UniformDouble, BackgroundRefill,
+                  SecureURBG::BufferMode::kBackgroundRefill,
+                  &MakeRandBytesGenerator)
+    ->ThreadRange(1, 8);
+BENCHMARK_CAPTURE(BM_UniformDouble, ThreadLocalAesCtrDrbg,
+                  SecureURBG::BufferMode::kThreadLocal,
+                  &MakeAesCtrDrbgGenerator)
+    ->ThreadRange(1, 8);
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM
+BENCHMARK_CAPTURE(BM_UniformDouble, ThreadLocalInsecureFast,
+                  SecureURBG::BufferMode::kThreadLocal,
+                  &MakeInsecureFastGenerator)
+    ->ThreadRange(1, 8);
+#endif
+
+}  // namespace
+}  // namespace differential_privacy
@@ -418,6 +418,27 @@ TYPED_TEST(NumericalMechanismsTest, LaplaceBuilderClone) {
       3);
 }
 
+TEST(NumericalMechanismsTest, LaplaceBlockedRejectionSamplingVariance) {
+  auto test_mechanism =
+      LaplaceMechanism::Builder()
+          .SetGeometricSamplingMethod(
+              GeometricSamplingMethod::kBlockedRejection)
+          .SetL1Sensitivity(1)
+          .SetEpsilon(1)
+          .Build();
+  ASSERT_OK(test_mechanism);
+
+  std::vector<double> results(kSmallNumSamples, 0);
+  std::vector<double> noised_results(kSmallNumSamples);
+  ASSERT_OK((*test_mechanism)
+                ->AddNoise(results, absl::MakeSpan(noised_results), 1.0));
+  double sum_of_squares = 0;
+  for (double noised_result : noised_results) {
+    sum_of_squares += noised_result * noised_result;
+  }
+  EXPECT_NEAR(sum_of_squares / kSmallNumSamples, 2.0, 0.05);
+}
+
 class NoiseIntervalMultipleParametersTests
     : public ::testing::TestWithParam<struct conf_int_params> {};
 
@@ -510,6 +531,62 @@ TEST(NumericalMechanismsTest, AddNoise) {
               DoubleNear(10.0, 0.000001));
 }
 
+TEST(NumericalMechanismsTest, LaplaceBatchAddNoise) {
+  auto distro = absl::make_unique<MockLaplaceDistribution>();
+  double granularity = distro->GetGranularity();
+  EXPECT_CALL(*distro, Sample(2.0)).Times(3).WillRepeatedly(Return(10));
+  LaplaceMechanism mechanism(1.0, 1.0, std::move(distro));
+
+  std::vector<double> results = {0.1 * granularity, 1.0, -3.0};
+  std::vector<double> noised_results(results.size());
+  ASSERT_OK(mechanism.AddNoise(results, absl::MakeSpan(noised_results), 0.5));
+  EXPECT_THAT(noised_results[0], DoubleNear(10.0, 0.000001));
+  EXPECT_THAT(noised_results[1], DoubleNear(11.0, 0.000001));
+  EXPECT_THAT(noised_results[2], DoubleNear(7.0, 0.000001));
+}
+
+TEST(NumericalMechanismsTest, LaplaceBatchAddNoiseInPlace) {
+  LaplaceMechanism mechanism(1.0, 0.0);
+
+  std::vector<double> values = {12.3, -4.5};
+  ASSERT_OK(mechanism.AddNoise(values, absl::MakeSpan(values), 1.0));
+  EXPECT_THAT(values[0], DoubleEq(12.3));
+  EXPECT_THAT(values[1], DoubleEq(-4.5));
+}
+
+TEST(NumericalMechanismsTest, BatchAddNoiseFailsForMismatchedSizes) {
+  LaplaceMechanism laplace(1.0, 1.0);
+  GaussianMechanism gaussian(1.0, 0.5, 1.0);
+  std::vector<double> results(3);
+  std::vector<double> noised_results(2);
+
+  EXPECT_THAT(laplace.AddNoise(results, absl::MakeSpan(noised_results), 1.0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same size")));
+  EXPECT_THAT(gaussian.AddNoise(results, absl::MakeSpan(noised_results), 1.0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same size")));
+}
+
+TEST(NumericalMechanismsTest, GaussianBatchAddNoiseMatchesScalarVariance) {
+  GaussianMechanism mechanism(log(3), 0.00001, 1.0);
+  const double stddev = mechanism.CalculateStddev(log(3) / 2, 0.00001 / 2);
+
+  std::vector<double> results(kSmallNumSamples, 0);
+  std::vector<double> noised_results(kSmallNumSamples);
+  ASSERT_OK(mechanism.AddNoise(results, absl::MakeSpan(noised_results), 0.5));
+  double sum = 0;
+  double sum_of_squares = 0;
+  for (double noised_result : noised_results) {
+    sum += noised_result;
+    sum_of_squares += noised_result * noised_result;
+  }
+  double mean = sum / kSmallNumSamples;
+  double variance = sum_of_squares / kSmallNumSamples - mean * mean;
+  EXPECT_NEAR(mean, 0, 0.05 * stddev);
+  EXPECT_NEAR(std::sqrt(variance), stddev, 0.05 * stddev);
+}
+
 TEST(NumericalMechanismsTest, LambdaTooSmall) {
   LaplaceMechanism::Builder test_builder;
   base::StatusOr<std::unique_ptr<NumericalMechanism>> test_mechanism_or =
@@ -725,5 +802,53 @@ TEST(NumericalMechanismsTest, Stddev) {
   EXPECT_DOUBLE_EQ(mechanism.CalculateStddev(log(3), 0.00001), 3.42578125);
 }
 
+// Confidence intervals depend on the stddev for the requested budget, which is
+// cached between calls. Alternating budgets must not return stale values.
+TEST(NumericalMechanismsTest, GaussianConfidenceIntervalTracksBudget) {
+  GaussianMechanism mechanism(log(3), 0.00001, 1.0);
+  GaussianMechanism reference(log(3), 0.00001, 1.0);
+
+  for (double budget : {0.5, 0.5, 1.0, 0.25, 0.5}) {
+    base::StatusOr<ConfidenceInterval> interval =
+        mechanism.NoiseConfidenceInterval(0.95, budget);
+    ASSERT_OK(interval);
+    double stddev = reference.CalculateStddev(budget * log(3),
+                                              budget * 0.00001);
+    double bound = InverseErrorFunction(-0.95) * stddev * std::sqrt(2);
+    EXPECT_FLOAT_EQ(interval->upper_bound(), -bound);
+    EXPECT_FLOAT_EQ(interval->lower_bound(), bound);
+  }
+}
+
+// The bound of the last (confidence level, budget) pair is cached. Changing
+// either argument must recompute it.
+TEST(NumericalMechanismsTest, ConfidenceIntervalTracksLevelAndBudget) {
+  LaplaceMechanism laplace(0.5, 1.0);
+  GaussianMechanism gaussian(log(3), 0.00001, 1.0);
+  GaussianMechanism reference(log(3), 0.00001, 1.0);
+
+  for (auto args : std::vector<std::pair<double, double>>{
+           {0.95, 0.5}, {0.95, 0.5}, {0.9, 0.5}, {0.9, 1.0}, {0.95, 0.5}}) {
+    double level = args.first;
+    double budget = args.second;
+
+    base::StatusOr<ConfidenceInterval> laplace_interval =
+        laplace.NoiseConfidenceInterval(level, budget, 1.0);
+    ASSERT_OK(laplace_interval);
+    EXPECT_DOUBLE_EQ(laplace_interval->lower_bound(),
+                     1.0 + log(1 - level) / 0.5 / budget);
+    EXPECT_EQ(laplace_interval->confidence_level(), level);
+
+    base::StatusOr<ConfidenceInterval> gaussian_interval =
+        gaussian.NoiseConfidenceInterval(level, budget, 1.0);
+    ASSERT_OK(gaussian_interval);
+    double stddev = reference.CalculateStddev(budget * log(3),
+                                              budget * 0.00001);
+    EXPECT_FLOAT_EQ(gaussian_interval->lower_bound(),
+                    1.0 + InverseErrorFunction(-level) * stddev * std::sqrt(2));
+    EXPECT_EQ(gaussian_interval->confidence_level(), level);
+  }
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -17,8 +17,13 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_ORDER_STATISTICS_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_ORDER_STATISTICS_H_
 
+#include <utility>
+#include <vector>
+
+#include "base/log-histogram-sketch.h"
 #include "base/percentile.h"
 #include "absl/status/status.h"
+#include "absl/types/optional.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/binary-search.h"
@@ -43,6 +48,26 @@ class OrderStatisticsBuilder
     BoundedBuilder::SetUpper(std::numeric_limits<T>::max());
   }
 
+  // Summarizes the inputs in a base::LogHistogramSketch with the default bins
+  // of ApproxBounds, each split into num_sub_bins sub-bins, instead of storing
+  // them. Memory is bounded by the number of sub-bins and no inputs are
+  // sorted, at the cost of finding the result only within its sub-bin. Each
+  // input adds to a single count, so this keeps the sensitivity of the noised
+  // counts. Meant for Min and Max of many partitions.
+  Builder& SetLogHistogram(
+      int num_sub_bins = base::kDefaultLogHistogramSubBins) {
+    log_histogram_sub_bins_ = num_sub_bins;
+    return *static_cast<Builder*>(this);
+  }
+
+  // Serializes the inputs as sorted varint deltas for integral T, and as
+  // distinct values with counts when inputs are heavily duplicated. This has
+  // no effect together with SetLogHistogram.
+  Builder& SetCompactSummary(bool compact_summary) {
+    compact_summary_ = compact_summary;
+    return *static_cast<Builder*>(this);
+  }
+
  protected:
   // Check numeric parameters and construct quantiles and mechanism. Called
   // only at build.
@@ -67,13 +92,24 @@ class OrderStatisticsBuilder
           "Order statistics are only supported for Laplace mechanism.");
     }
 
-    quantiles_ = absl::make_unique<base::Percentile<T>>();
+    if (log_histogram_sub_bins_.has_value()) {
+      RETURN_IF_ERROR(ValidateIsPositive(log_histogram_sub_bins_,
+                                         "Number of log histogram sub-bins"));
+      quantiles_ = absl::make_unique<base::LogHistogramSketch<T>>(
+          log_histogram_sub_bins_.value());
+    } else {
+      quantiles_ = absl::make_unique<base::Percentile<T>>(compact_summary_);
+    }
     return absl::OkStatus();
   }
 
   // Constructed when processing parameters.
   std::unique_ptr<LaplaceMechanism> mechanism_;
   std::unique_ptr<base::Percentile<T>> quantiles_;
+
+ private:
+  absl::optional<int> log_histogram_sub_bins_;
+  bool compact_summary_ = false;
 };
 
 template <typename T>
@@ -206,6 +242,82 @@ class Percentile : public BinarySearch<T> {
   const double percentile_;
 };
 
+// MultiPercentile computes several percentiles of one set of inputs. All
+// percentiles are searched in the same input sketch, so that the inputs are
+// stored and sorted once rather than once per percentile. The privacy budget
+// of a result is split equally across the percentiles. The result has one
+// element per percentile, in the order they were set in the builder, and no
+// noise confidence interval.
+template <typename T>
+class MultiPercentile : public BinarySearch<T> {
+ public:
+  class Builder
+      : public OrderStatisticsBuilder<T, MultiPercentile<T>, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, MultiPercentile<T>, Builder>;
+    using BoundedBuilder =
+        BoundedAlgorithmBuilder<T, MultiPercentile<T>, Builder>;
+    using OrderBuilder = OrderStatisticsBuilder<T, MultiPercentile<T>, Builder>;
+
+   public:
+    Builder& SetPercentiles(std::vector<double> percentiles) {
+      percentiles_ = std::move(percentiles);
+      return *static_cast<Builder*>(this);
+    }
+
+   private:
+    base::StatusOr<std::unique_ptr<MultiPercentile<T>>> BuildBoundedAlgorithm()
+        override {
+      if (percentiles_.empty()) {
+        return absl::InvalidArgumentError(
+            "At least one percentile must be set.");
+      }
+      for (double percentile : percentiles_) {
+        RETURN_IF_ERROR(
+            ValidateIsInInclusiveInterval(percentile, 0, 1, "Percentile"));
+      }
+      RETURN_IF_ERROR(OrderBuilder::ConstructDependencies());
+      return absl::WrapUnique(new MultiPercentile(
+          percentiles_, AlgorithmBuilder::GetEpsilon().value(),
+          BoundedBuilder::GetLower().value(),
+          BoundedBuilder::GetUpper().value(),
+          std::move(OrderBuilder::mechanism_),
+          std::move(OrderBuilder::quantiles_)));
+    }
+
+    std::vector<double> percentiles_;
+  };
+
+  const std::vector<double>& GetPercentiles() const { return percentiles_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(ValidateIsPositive(privacy_budget, "Privacy budget",
+                                       absl::StatusCode::kFailedPrecondition));
+    const double budget_per_percentile = privacy_budget / percentiles_.size();
+    Output output;
+    for (double percentile : percentiles_) {
+      ASSIGN_OR_RETURN(Output search,
+                       BinarySearch<T>::BayesianSearch(
+                           percentile, budget_per_percentile,
+                           noise_interval_level));
+      *output.add_elements() = search.elements(0);
+    }
+    return output;
+  }
+
+ private:
+  MultiPercentile(std::vector<double> percentiles, double epsilon, T lower,
+                  T upper, std::unique_ptr<LaplaceMechanism> mechanism,
+                  std::unique_ptr<base::Percentile<T>> quantiles)
+      : BinarySearch<T>(epsilon, lower, upper, percentiles.front(),
+                        std::move(mechanism), std::move(quantiles)),
+        percentiles_(std::move(percentiles)) {}
+
+  const std::vector<double> percentiles_;
+};
+
 }  // namespace continuous
 }  // namespace differential_privacy
 
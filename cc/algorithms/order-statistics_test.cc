@@ -89,6 +89,81 @@ TEST(OrderStatisticsTest, Median) {
   EXPECT_EQ(GetValue<int64_t>(*result), 100);
 }
 
+TEST(OrderStatisticsTest, CompactSummarySerializeMerge) {
+  auto build = []() {
+    return Median<int64_t>::Builder()
+        .SetCompactSummary(true)
+        .SetEpsilon(1)
+        .SetLower(0)
+        .SetUpper(2048)
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .Build();
+  };
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> first = build();
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> second = build();
+  ASSERT_OK(first);
+  ASSERT_OK(second);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*(i % 2 == 0 ? first : second))->AddEntry(200 * i / kDataSize);
+  }
+  Summary summary = (*first)->Serialize();
+  BinarySearchSummary bs_summary;
+  ASSERT_TRUE(summary.data().UnpackTo(&bs_summary));
+  EXPECT_EQ(bs_summary.input_int_size(), 0);
+  EXPECT_EQ(bs_summary.input_count_size(), 200);
+
+  ASSERT_OK((*second)->Merge(summary));
+  base::StatusOr<Output> result = (*second)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 100);
+}
+
+TEST(OrderStatisticsTest, MaxAndMinWithLogHistogram) {
+  auto build_max = [] {
+    return Max<double>::Builder()
+        .SetEpsilon(std::log(3))
+        .SetLower(-1000)
+        .SetUpper(1000)
+        .SetLogHistogram()
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .Build()
+        .ValueOrDie();
+  };
+  std::unique_ptr<Max<double>> max = build_max();
+  std::unique_ptr<Max<double>> other_max = build_max();
+  std::unique_ptr<Min<double>> min =
+      Min<double>::Builder()
+          .SetEpsilon(std::log(3))
+          .SetLower(-1000)
+          .SetUpper(1000)
+          .SetLogHistogram()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    const double value = -150 + 350.0 * i / kDataSize;
+    (i % 2 == 0 ? max : other_max)->AddEntry(value);
+    min->AddEntry(value);
+  }
+  EXPECT_NEAR(GetValue<double>(min->PartialResult(1.0).ValueOrDie()), -150, 10);
+
+  // The inputs are summarized by bin counts, which merge.
+  Summary summary = other_max->Serialize();
+  BinarySearchSummary bs_summary;
+  ASSERT_TRUE(summary.data().UnpackTo(&bs_summary));
+  EXPECT_TRUE(bs_summary.has_input_log_histogram());
+  EXPECT_EQ(bs_summary.input_double_size(), 0);
+  ASSERT_OK(max->Merge(summary));
+  EXPECT_NEAR(GetValue<double>(max->PartialResult(1.0).ValueOrDie()), 200, 10);
+  EXPECT_LT(max->MemoryUsed(), kDataSize * sizeof(double));
+}
+
+TEST(OrderStatisticsTest, LogHistogramInvalidParameters) {
+  EXPECT_THAT(Max<double>::Builder().SetLogHistogram(0).SetEpsilon(1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("log histogram sub-bins")));
+}
+
 TEST(OrderStatisticsTest, MedianLinfIncreasesVariance) {
   // Median is 0
   const std::vector<double> input = {1, 0, 0, -1};
@@ -188,6 +263,44 @@ TEST(OrderStatisticsTest, Median_DefaultBounds) {
   EXPECT_EQ(GetValue<int64_t>(*result), 100);
 }
 
+TEST(OrderStatisticsTest, MultiPercentile) {
+  const std::vector<double> percentiles = {.1, .25, .5, .75, .9};
+  auto search = MultiPercentile<int64_t>::Builder()
+                    .SetPercentiles(percentiles)
+                    .SetEpsilon(std::log(3))
+                    .SetLower(0)
+                    .SetUpper(2048)
+                    .SetLaplaceMechanism(
+                        absl::make_unique<ZeroNoiseMechanism::Builder>())
+                    .Build();
+  ASSERT_OK(search);
+  EXPECT_EQ((*search)->GetPercentiles(), percentiles);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*search)->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  base::StatusOr<Output> result = (*search)->PartialResult();
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), percentiles.size());
+  for (int i = 0; i < percentiles.size(); ++i) {
+    EXPECT_NEAR(GetValue<int64_t>(result->elements(i).value()),
+                200 * percentiles[i], 2);
+  }
+  EXPECT_THAT((*search)->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(OrderStatisticsTest, MultiPercentileInvalidParameters) {
+  EXPECT_THAT(MultiPercentile<double>::Builder().SetEpsilon(1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one percentile")));
+  EXPECT_THAT(MultiPercentile<double>::Builder()
+                  .SetPercentiles({.5, 1.5})
+                  .SetEpsilon(1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Percentile must be in the inclusive")));
+}
+
 }  // namespace
 }  // namespace continuous
 }  // namespace differential_privacy
@@ -0,0 +1,253 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITION_CHECKPOINT_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITION_CHECKPOINT_H_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Parameters of an aggregation stored in a checkpoint. A checkpoint can only
+// be restored into an aggregation with the same parameters.
+struct PartitionCheckpointParams {
+  double epsilon;
+  double lower;
+  double upper;
+  int64_t max_contributions_per_partition;
+};
+
+// State of one partition in a PartitionCheckpoint.
+template <typename Key, typename T>
+struct PartitionRecord {
+  Key key;
+  T sum;
+  int64_t count;
+  int num_users;
+};
+
+// PartitionCheckpoint reads a flat checkpoint of the per-partition state of a
+// grouped aggregation, e.g., as written by
+// PartitionedAggregator::WriteCheckpoint().
+//
+// A checkpoint is a fixed-size header followed by one fixed-size record per
+// partition. Nothing is parsed when the checkpoint is opened, apart from the
+// header, and a record is only read when it is accessed. The data may be a
+// memory-mapped file, e.g., from mmap(2), in which case only the pages of the
+// accessed records are read from disk. The bytes of the view must outlive it.
+//
+// Values are stored in the native byte order, so checkpoints can only be
+// restored on machines of the same architecture. The version is increased
+// whenever the layout changes, and checkpoints of other versions are
+// rejected.
+template <typename Key, typename T>
+class PartitionCheckpoint {
+  static_assert(std::is_trivially_copyable<Key>::value,
+                "PartitionCheckpoint requires trivially copyable keys");
+  static_assert(std::is_arithmetic<T>::value,
+                "PartitionCheckpoint can only be used for arithmetic types");
+
+ public:
+  static constexpr uint32_t kVersion = 1;
+
+  using Record = PartitionRecord<Key, T>;
+
+  // Returns a view of the checkpoint in data, after validating its header and
+  // size.
+  static base::StatusOr<PartitionCheckpoint> Open(absl::string_view data) {
+    if (data.size() < kHeaderSize ||
+        std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+      return absl::InvalidArgumentError("Data is not a partition checkpoint.");
+    }
+    const char* header = data.data() + sizeof(kMagic);
+    if (Read<uint32_t>(header) != kVersion) {
+      return absl::InvalidArgumentError(
+          "Partition checkpoint has an unsupported version.");
+    }
+    if (Read<uint32_t>(header + 4) != sizeof(Key) ||
+        Read<uint32_t>(header + 8) != sizeof(T) ||
+        Read<uint32_t>(header + 12) != std::is_integral<T>::value) {
+      return absl::InvalidArgumentError(
+          "Partition checkpoint has different key or value types.");
+    }
+    const int64_t num_partitions = Read<int64_t>(header + 48);
+    if (num_partitions < 0 ||
+        (data.size() - kHeaderSize) / kRecordSize !=
+            static_cast<uint64_t>(num_partitions) ||
+        (data.size() - kHeaderSize) % kRecordSize != 0) {
+      return absl::InvalidArgumentError(
+          "Partition checkpoint size does not match its header.");
+    }
+    PartitionCheckpointParams params;
+    params.epsilon = Read<double>(header + 16);
+    params.lower = Read<double>(header + 24);
+    params.upper = Read<double>(header + 32);
+    params.max_contributions_per_partition = Read<int64_t>(header + 40);
+    return PartitionCheckpoint(data.data() + kHeaderSize, num_partitions,
+                               params);
+  }
+
+  // Appends the header of a checkpoint with num_partitions records to out.
+  // The records must be appended after it with AppendRecord().
+  static void AppendHeader(const PartitionCheckpointParams& params,
+                           int64_t num_partitions, std::string* out) {
+    out->reserve(out->size() + kHeaderSize + num_partitions * kRecordSize);
+    out->append(kMagic, sizeof(kMagic));
+    Append<uint32_t>(kVersion, out);
+    Append<uint32_t>(sizeof(Key), out);
+    Append<uint32_t>(sizeof(T), out);
+    Append<uint32_t>(std::is_integral<T>::value, out);
+    Append<double>(params.epsilon, out);
+    Append<double>(params.lower, out);
+    Append<double>(params.upper, out);
+    Append<int64_t>(params.max_contributions_per_partition, out);
+    Append<int64_t>(num_partitions, out);
+  }
+
+  static void AppendRecord(const Record& record, std::string* out) {
+    Append<Key>(record.key, out);
+    Append<T>(record.sum, out);
+    Append<int64_t>(record.count, out);
+    Append<int32_t>(record.num_users, out);
+  }
+
+  // Returns the number of partitions in the checkpoint.
+  int64_t size() const { return num_partitions_; }
+
+  const PartitionCheckpointParams& params() const { return params_; }
+
+  // Returns record i, which is read from the data on every call.
+  Record Get(int64_t i) const {
+    const char* data = records_ + i * kRecordSize;
+    Record record;
+    record.key = Read<Key>(data);
+    record.sum = Read<T>(data + sizeof(Key));
+    record.count = Read<int64_t>(data + sizeof(Key) + sizeof(T));
+    record.num_users = Read<int32_t>(data + sizeof(Key) + sizeof(T) + 8);
+    return record;
+  }
+
+ private:
+  static constexpr char kMagic[8] = {'D', 'P', 'P', 'A', 'R', 'T', 'C', 'K'};
+  // Magic, four 32-bit fields, three doubles and two 64-bit integers.
+  static constexpr size_t kHeaderSize = sizeof(kMagic) + 16 + 24 + 16;
+  // Records are packed, so fields are read with memcpy rather than through
+  // pointers that may be unaligned.
+  static constexpr size_t kRecordSize = sizeof(Key) + sizeof(T) + 8 + 4;
+
+  PartitionCheckpoint(const char* records, int64_t num_partitions,
+                      const PartitionCheckpointParams& params)
+      : records_(records), num_partitions_(num_partitions), params_(params) {}
+
+  template <typename V>
+  static V Read(const char* data) {
+    V value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  template <typename V>
+  static void Append(V value, std::string* out) {
+    out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  const char* records_;
+  int64_t num_partitions_;
+  PartitionCheckpointParams params_;
+};
+
+template <typename Key, typename T>
+constexpr char PartitionCheckpoint<Key, T>::kMagic[8];
+
+// Merges checkpoints whose records are sorted by key, e.g., partitions that an
+// aggregation spilled to disk in sorted chunks, like the runs of an external
+// sort. Calls fn once per distinct key in increasing key order, with the sum
+// of the records of that key over all checkpoints, and stops at the first
+// error that fn returns. Only one record per checkpoint is read at a time, so
+// the checkpoints may be much larger than memory when they are memory-mapped.
+// Returns an error if a checkpoint is not sorted.
+template <typename Key, typename T, typename Fn>
+absl::Status MergeSortedPartitionCheckpoints(
+    absl::Span<const PartitionCheckpoint<Key, T>> checkpoints, Fn fn) {
+  using Record = PartitionRecord<Key, T>;
+  // Next record of each checkpoint that is not exhausted, and the index of
+  // the checkpoint and of the record in it.
+  struct Head {
+    Record record;
+    int64_t checkpoint;
+    int64_t index;
+  };
+  auto greater = [](const Head& a, const Head& b) {
+    return std::less<Key>()(b.record.key, a.record.key);
+  };
+  std::priority_queue<Head, std::vector<Head>, decltype(greater)> heads(
+      greater);
+  for (int64_t i = 0; i < checkpoints.size(); ++i) {
+    if (checkpoints[i].size() > 0) {
+      heads.push({checkpoints[i].Get(0), i, 0});
+    }
+  }
+  // Replaces the head of a checkpoint by its next record, if any.
+  auto advance = [&](const Head& head) -> absl::Status {
+    const PartitionCheckpoint<Key, T>& checkpoint =
+        checkpoints[head.checkpoint];
+    if (head.index + 1 == checkpoint.size()) {
+      return absl::OkStatus();
+    }
+    Head next = {checkpoint.Get(head.index + 1), head.checkpoint,
+                 head.index + 1};
+    if (!std::less<Key>()(head.record.key, next.record.key)) {
+      return absl::InvalidArgumentError(
+          "Partition checkpoint is not sorted by key.");
+    }
+    heads.push(std::move(next));
+    return absl::OkStatus();
+  };
+  while (!heads.empty()) {
+    Head head = heads.top();
+    heads.pop();
+    RETURN_IF_ERROR(advance(head));
+    Record merged = std::move(head.record);
+    while (!heads.empty() &&
+           !std::less<Key>()(merged.key, heads.top().record.key)) {
+      head = heads.top();
+      heads.pop();
+      RETURN_IF_ERROR(advance(head));
+      merged.sum += head.record.sum;
+      merged.count += head.record.count;
+      merged.num_users += head.record.num_users;
+    }
+    RETURN_IF_ERROR(fn(merged));
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITION_CHECKPOINT_H_
@@ -0,0 +1,134 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/partition-checkpoint.h"
+
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
+
+using Checkpoint = PartitionCheckpoint<int64_t, double>;
+
+std::string WriteCheckpoint(int64_t num_partitions) {
+  std::string data;
+  Checkpoint::AppendHeader({1.5, -2, 3, 4}, num_partitions, &data);
+  for (int64_t i = 0; i < num_partitions; ++i) {
+    Checkpoint::AppendRecord({i * 10, i + 0.5, i * 2, static_cast<int>(i)},
+                             &data);
+  }
+  return data;
+}
+
+TEST(PartitionCheckpointTest, ReadsRecordsInPlace) {
+  const std::string data = WriteCheckpoint(5);
+  // Open a view of unaligned data, e.g., a file mapped at an offset.
+  const std::string unaligned = "x" + data;
+  auto checkpoint = Checkpoint::Open(absl::string_view(unaligned).substr(1));
+  ASSERT_OK(checkpoint);
+  EXPECT_EQ(checkpoint->size(), 5);
+  EXPECT_EQ(checkpoint->params().epsilon, 1.5);
+  EXPECT_EQ(checkpoint->params().lower, -2);
+  EXPECT_EQ(checkpoint->params().upper, 3);
+  EXPECT_EQ(checkpoint->params().max_contributions_per_partition, 4);
+  for (int64_t i = 0; i < 5; ++i) {
+    const Checkpoint::Record record = checkpoint->Get(i);
+    EXPECT_EQ(record.key, i * 10);
+    EXPECT_EQ(record.sum, i + 0.5);
+    EXPECT_EQ(record.count, i * 2);
+    EXPECT_EQ(record.num_users, i);
+  }
+}
+
+TEST(PartitionCheckpointTest, EmptyCheckpoint) {
+  auto checkpoint = Checkpoint::Open(WriteCheckpoint(0));
+  ASSERT_OK(checkpoint);
+  EXPECT_EQ(checkpoint->size(), 0);
+}
+
+TEST(PartitionCheckpointTest, RejectsInvalidData) {
+  EXPECT_THAT(Checkpoint::Open("not a checkpoint"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a partition checkpoint")));
+
+  std::string data = WriteCheckpoint(3);
+  EXPECT_THAT(Checkpoint::Open(data.substr(0, data.size() - 1)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("size does not match")));
+  using IntKeyCheckpoint = PartitionCheckpoint<int32_t, double>;
+  using IntValueCheckpoint = PartitionCheckpoint<int64_t, int64_t>;
+  EXPECT_THAT(IntKeyCheckpoint::Open(data),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("different key or value types")));
+  EXPECT_THAT(IntValueCheckpoint::Open(data),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("different key or value types")));
+
+  // The version follows the magic.
+  data[8] = 2;
+  EXPECT_THAT(Checkpoint::Open(data),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unsupported version")));
+}
+
+TEST(PartitionCheckpointTest, MergesSortedCheckpoints) {
+  // Keys 0, 10, ..., 40 with sums 0.5, ..., 4.5 and keys 0, 10, 20.
+  const std::string first = WriteCheckpoint(5);
+  const std::string second = WriteCheckpoint(3);
+  const std::string empty = WriteCheckpoint(0);
+  std::vector<Checkpoint> checkpoints;
+  for (const std::string* data : {&first, &empty, &second}) {
+    auto checkpoint = Checkpoint::Open(*data);
+    ASSERT_OK(checkpoint);
+    checkpoints.push_back(checkpoint.value());
+  }
+  std::vector<Checkpoint::Record> merged;
+  ASSERT_OK(MergeSortedPartitionCheckpoints(
+      absl::MakeConstSpan(checkpoints), [&](const Checkpoint::Record& record) {
+        merged.push_back(record);
+        return absl::OkStatus();
+      }));
+  ASSERT_EQ(merged.size(), 5);
+  for (int64_t i = 0; i < 5; ++i) {
+    const int copies = i < 3 ? 2 : 1;
+    EXPECT_EQ(merged[i].key, i * 10);
+    EXPECT_EQ(merged[i].sum, copies * (i + 0.5));
+    EXPECT_EQ(merged[i].count, copies * i * 2);
+    EXPECT_EQ(merged[i].num_users, copies * i);
+  }
+
+  // Errors of the callback stop the merge.
+  int calls = 0;
+  EXPECT_THAT(MergeSortedPartitionCheckpoints(
+                  absl::MakeConstSpan(checkpoints),
+                  [&](const Checkpoint::Record& record) {
+                    ++calls;
+                    return absl::CancelledError("Stop.");
+                  }),
+              StatusIs(absl::StatusCode::kCancelled));
+  EXPECT_EQ(calls, 1);
+}
+
+}  // namespace
+}  // namespace differential_privacy
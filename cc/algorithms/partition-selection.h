@@ -19,11 +19,15 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "base/statusor.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/rand.h"
@@ -104,6 +108,18 @@ class PartitionSelectionStrategy {
   // should be kept and false otherwise.
   virtual bool ShouldKeep(int num_users) = 0;
 
+  // Decides for each partition whether it should be kept, exactly as if
+  // ShouldKeep(num_users[i]) was called for each i in order, and writes the
+  // decisions to *keep, which is resized to the number of partitions.
+  // Strategies override this to share work between the decisions.
+  virtual void ShouldKeep(absl::Span<const int64_t> num_users,
+                          std::vector<bool>* keep) {
+    keep->resize(num_users.size());
+    for (size_t i = 0; i < num_users.size(); ++i) {
+      (*keep)[i] = ShouldKeep(static_cast<int>(num_users[i]));
+    }
+  }
+
  protected:
   PartitionSelectionStrategy(double epsilon, double delta,
                              int64_t max_partitions_contributed,
@@ -223,7 +239,20 @@ class PreaggPartitionSelection : public PartitionSelectionStrategy {
     // generate a random number between 0 and 1
     double rand_num = UniformDouble();
     // only keep partition if random number < expected probability of keep
-    return (rand_num <= ProbabilityOfKeep(num_users));
+    return (rand_num <= KeepProbability(num_users));
+  }
+
+  // Looks up the probabilities of keep for small numbers of users, which most
+  // partitions have, in a table that is built on the first call.
+  void ShouldKeep(absl::Span<const int64_t> num_users,
+                  std::vector<bool>* keep) override {
+    if (keep_probabilities_.empty()) {
+      BuildKeepProbabilities();
+    }
+    keep->resize(num_users.size());
+    for (size_t i = 0; i < num_users.size(); ++i) {
+      (*keep)[i] = UniformDouble() <= KeepProbability(num_users[i]);
+    }
   }
 
  protected:
@@ -243,10 +272,34 @@ class PreaggPartitionSelection : public PartitionSelectionStrategy {
   }
 
  private:
+  // Maximum number of entries of keep_probabilities_. The probability of keep
+  // is 1 above the second crossover, so the table usually ends there.
+  static constexpr int64_t kMaxKeepProbabilities = int64_t{1} << 16;
+
   double adjusted_epsilon_;
   double crossover_1_;
   double crossover_2_;
 
+  // ProbabilityOfKeep(n) for 0 <= n <= min(crossover_2_, ...), once built.
+  std::vector<double> keep_probabilities_;
+
+  void BuildKeepProbabilities() {
+    const int64_t size = static_cast<int64_t>(std::min<double>(
+        std::max(crossover_2_, 0.0) + 1, kMaxKeepProbabilities));
+    keep_probabilities_.resize(size);
+    for (int64_t n = 0; n < size; ++n) {
+      keep_probabilities_[n] = ProbabilityOfKeep(n);
+    }
+  }
+
+  // Returns ProbabilityOfKeep(n), from keep_probabilities_ if it covers n.
+  double KeepProbability(int64_t n) const {
+    if (n >= 0 && n < static_cast<int64_t>(keep_probabilities_.size())) {
+      return keep_probabilities_[n];
+    }
+    return ProbabilityOfKeep(n);
+  }
+
   // ProbabilityOfKeep returns the probability with which a partition with n
   // users should be kept, Thm. 1 of https://arxiv.org/pdf/2006.03684.pdf
   double ProbabilityOfKeep(double n) const {
@@ -324,6 +377,8 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
 
   virtual ~LaplacePartitionSelection() = default;
 
+  using PartitionSelectionStrategy::ShouldKeep;
+
   bool ShouldKeep(int num_users) override {
     return mechanism_->NoisedValueAboveThreshold(num_users, threshold_);
   }
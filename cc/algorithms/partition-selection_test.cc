@@ -1067,5 +1067,57 @@ TEST(PartitionSelectionTest, RoundTripDeltaTests) {
   }
 }
 
+
+TEST(PartitionSelectionTest, PreaggPartitionSelectionBulkShouldKeep) {
+  PreaggPartitionSelection::Builder test_builder;
+  std::unique_ptr<PartitionSelectionStrategy> build =
+      test_builder.SetEpsilon(0.5)
+          .SetDelta(0.02)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  // 0 users, exactly one user, the first crossover and beyond the second
+  // crossover, repeated.
+  const std::vector<int64_t> users = {0, 1, 6, 20};
+  std::vector<int64_t> num_users;
+  for (int i = 0; i < kSmallNumSamples; ++i) {
+    num_users.push_back(users[i % users.size()]);
+  }
+  std::vector<bool> keep = {true};
+  build->ShouldKeep(num_users, &keep);
+  ASSERT_EQ(keep.size(), num_users.size());
+  std::vector<double> num_kept(users.size());
+  for (int i = 0; i < keep.size(); ++i) {
+    num_kept[i % users.size()] += keep[i];
+  }
+  const double samples_per_user = kSmallNumSamples / users.size();
+  EXPECT_EQ(num_kept[0], 0);
+  EXPECT_THAT(num_kept[1] / samples_per_user, DoubleNear(0.02, 0.002));
+  EXPECT_THAT(num_kept[2] / samples_per_user,
+              DoubleNear(0.58840484458, 0.005));
+  EXPECT_EQ(num_kept[3], samples_per_user);
+
+  // The single decisions keep working once the table is built.
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_FALSE(build->ShouldKeep(0));
+    EXPECT_TRUE(build->ShouldKeep(20));
+  }
+}
+
+TEST(PartitionSelectionTest, LaplacePartitionSelectionBulkShouldKeep) {
+  LaplacePartitionSelection::Builder test_builder;
+  std::unique_ptr<PartitionSelectionStrategy> build =
+      test_builder.SetEpsilon(0.5)
+          .SetDelta(0.02)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  std::vector<bool> keep;
+  build->ShouldKeep(std::vector<int64_t>{1000000, 1000000, 1000000}, &keep);
+  EXPECT_THAT(keep, testing::ElementsAre(true, true, true));
+  build->ShouldKeep(std::vector<int64_t>{}, &keep);
+  EXPECT_TRUE(keep.empty());
+}
+
 }  // namespace
 }  // namespace differential_privacy
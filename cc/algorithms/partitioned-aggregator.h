@@ -0,0 +1,696 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/logging.h"
+#include "base/statusor.h"
+#include "algorithms/memory-tracker.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/partition-checkpoint.h"
+#include "algorithms/partition-selection.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// PartitionedAggregator computes a differentially private count and bounded
+// sum for every partition of a grouped aggregation, i.e., for
+// "GROUP BY key, COUNT(*), SUM(value)", and only releases the partitions that
+// the PartitionSelectionStrategy keeps.
+//
+// Unlike one Count and one BoundedSum per key, the state of a partition is a
+// small accumulator of the number of privacy units, the number of
+// contributions and the clamped sum, stored inline in a flat open-addressing
+// table. The two mechanisms are built once and shared by all partitions, and
+// ReleaseResults() selects and noises all partitions in one pass.
+//
+// The caller must pass all contributions of a privacy unit to a partition in
+// one call to AddEntries, and must ensure that a privacy unit contributes to at
+// most GetMaxPartitionsContributed() partitions of the strategy. Only bounds
+// set in the builder are supported; there is no automatic bounding.
+//
+// The aggregation epsilon is split equally between the count and the sum. The
+// partition selection strategy uses its own epsilon and delta, so the total
+// budget is the sum of both.
+//
+// The memory of the aggregator and its partition table is reserved on a
+// MemoryTracker as the table grows. With SetMemoryLimit() or a parent tracker
+// that has a limit, contributions to new partitions are rejected once the
+// table cannot grow within the limit, so that the caller can stop, or spill
+// the partitions with SpillSorted() and merge them back at release time.
+// Heap memory owned by the keys themselves is not tracked. For string keys,
+// the ids of a KeyInterner keep the table free of heap-allocated keys.
+template <typename Key, typename T, typename Hash = absl::Hash<Key>,
+          typename Eq = std::equal_to<Key>>
+class PartitionedAggregator {
+  static_assert(std::is_arithmetic<T>::value,
+                "PartitionedAggregator can only be used for arithmetic types");
+
+ public:
+  // A released partition.
+  struct PartitionResult {
+    Key key;
+    int64_t count;
+    T sum;
+  };
+
+  // Released partitions stored column by column, e.g., to be wrapped by Arrow
+  // arrays without copying. Row i of every column is the same partition.
+  struct PartitionColumns {
+    std::vector<Key> keys;
+    std::vector<int64_t> counts;
+    std::vector<T> sums;
+    // Bounds of the noise confidence intervals around each noisy count and
+    // sum, computed before rounding. Only filled by ReleaseColumns with a
+    // confidence level, and empty otherwise.
+    std::vector<double> count_lower_bounds;
+    std::vector<double> count_upper_bounds;
+    std::vector<double> sum_lower_bounds;
+    std::vector<double> sum_upper_bounds;
+  };
+
+  class Builder {
+   public:
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    Builder& SetLower(T lower) {
+      lower_ = lower;
+      return *this;
+    }
+
+    Builder& SetUpper(T upper) {
+      upper_ = upper;
+      return *this;
+    }
+
+    // Contributions of a privacy unit to a partition beyond this number are
+    // dropped.
+    Builder& SetMaxContributionsPerPartition(int max_contributions) {
+      max_contributions_per_partition_ = max_contributions;
+      return *this;
+    }
+
+    // The strategy also determines the maximum number of partitions a privacy
+    // unit contributes to, i.e., the L0 sensitivity of the count and sum.
+    Builder& SetPartitionSelectionStrategy(
+        std::unique_ptr<PartitionSelectionStrategy> strategy) {
+      strategy_ = std::move(strategy);
+      return *this;
+    }
+
+    Builder& SetLaplaceMechanism(
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
+      mechanism_builder_ = std::move(mechanism_builder);
+      return *this;
+    }
+
+    // Maximum number of bytes used by the aggregator. Defaults to no limit.
+    Builder& SetMemoryLimit(int64_t bytes) {
+      memory_limit_ = bytes;
+      return *this;
+    }
+
+    // Memory used by the aggregator is also reserved on parent, e.g., a tracker
+    // shared by all aggregators of the process, and must fit in its limit. Not
+    // owned; parent must outlive the aggregator.
+    Builder& SetParentMemoryTracker(MemoryTracker* parent) {
+      parent_memory_tracker_ = parent;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<PartitionedAggregator>> Build() {
+      if (!epsilon_.has_value()) {
+        epsilon_ = DefaultEpsilon();
+        LOG(WARNING) << "Default epsilon of " << epsilon_.value()
+                     << " is being used. Consider setting your own epsilon "
+                        "based on privacy considerations.";
+      }
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon_, "Epsilon"));
+      if (!lower_.has_value() || !upper_.has_value()) {
+        return absl::InvalidArgumentError(
+            "Lower and upper bounds must be set.");
+      }
+      RETURN_IF_ERROR(ValidateIsFinite(lower_.value(), "Lower bound"));
+      RETURN_IF_ERROR(ValidateIsFinite(upper_.value(), "Upper bound"));
+      if (lower_.value() > upper_.value()) {
+        return absl::InvalidArgumentError(
+            "Lower bound cannot be greater than upper bound.");
+      }
+      RETURN_IF_ERROR(
+          ValidateIsPositive(max_contributions_per_partition_,
+                             "Maximum number of contributions per partition"));
+      if (strategy_ == nullptr) {
+        return absl::InvalidArgumentError(
+            "Partition selection strategy must be set.");
+      }
+      if (mechanism_builder_ == nullptr) {
+        mechanism_builder_ = absl::make_unique<LaplaceMechanism::Builder>();
+      }
+      RETURN_IF_ERROR(ValidateIsPositive(memory_limit_, "Memory limit"));
+
+      const int64_t l0_sensitivity = strategy_->GetMaxPartitionsContributed();
+      const double max_abs_value = std::max(std::abs(lower_.value()),
+                                            std::abs(upper_.value()));
+      std::unique_ptr<NumericalMechanism> count_mechanism;
+      ASSIGN_OR_RETURN(count_mechanism,
+                       mechanism_builder_->Clone()
+                           ->SetEpsilon(epsilon_.value())
+                           .SetL0Sensitivity(l0_sensitivity)
+                           .SetLInfSensitivity(max_contributions_per_partition_)
+                           .Build());
+      std::unique_ptr<NumericalMechanism> sum_mechanism;
+      ASSIGN_OR_RETURN(sum_mechanism,
+                       mechanism_builder_->Clone()
+                           ->SetEpsilon(epsilon_.value())
+                           .SetL0Sensitivity(l0_sensitivity)
+                           .SetLInfSensitivity(
+                               max_contributions_per_partition_ * max_abs_value)
+                           .Build());
+      auto aggregator = absl::WrapUnique(new PartitionedAggregator(
+          epsilon_.value(), lower_.value(), upper_.value(),
+          max_contributions_per_partition_, std::move(strategy_),
+          std::move(count_mechanism), std::move(sum_mechanism), memory_limit_,
+          parent_memory_tracker_));
+      if (!aggregator->memory_tracker_.TryReserve(
+              sizeof(PartitionedAggregator))) {
+        return absl::ResourceExhaustedError(
+            "Memory limit is too small for the aggregator.");
+      }
+      return aggregator;
+    }
+
+   private:
+    absl::optional<double> epsilon_;
+    absl::optional<T> lower_;
+    absl::optional<T> upper_;
+    int max_contributions_per_partition_ = 1;
+    std::unique_ptr<PartitionSelectionStrategy> strategy_;
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_;
+    int64_t memory_limit_ = kNoMemoryLimit;
+    MemoryTracker* parent_memory_tracker_ = nullptr;
+  };
+
+  // Adds a single contribution of a privacy unit to the partition key.
+  absl::Status AddEntry(const Key& key, const T& value) {
+    return AddEntries(key, absl::MakeConstSpan(&value, 1));
+  }
+
+  // Adds all contributions of a privacy unit to the partition key. Values are
+  // clamped to the bounds, and only the first
+  // max_contributions_per_partition values are used. NaN values are ignored.
+  //
+  // Returns a ResourceExhausted error without adding anything if key is a new
+  // partition and the table cannot grow within the memory limit.
+  absl::Status AddEntries(const Key& key, absl::Span<const T> values) {
+    auto it = partitions_.find(key);
+    if (it == partitions_.end()) {
+      // Reserve the memory of the table growth that inserting may cause up
+      // front, and correct it to the actual growth afterwards.
+      const int64_t growth = MayGrowOnInsert()
+                                 ? TableBytes(2 * partitions_.capacity() + 1) -
+                                       TableBytes(partitions_.capacity())
+                                 : 0;
+      if (growth > 0 && !memory_tracker_.TryReserve(growth)) {
+        return absl::ResourceExhaustedError(
+            "Memory limit reached, cannot add a new partition.");
+      }
+      it = partitions_.try_emplace(key).first;
+      memory_tracker_.Release(growth);
+      TrackTableCapacity();
+    }
+    Accumulator& accumulator = it->second;
+    ++accumulator.num_users;
+    int added = 0;
+    for (const T& t : values) {
+      if (added == max_contributions_per_partition_) {
+        break;
+      }
+      // REF:
+      // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
+      if (std::isnan(static_cast<double>(t))) {
+        continue;
+      }
+      accumulator.sum += Clamp<T>(lower_, upper_, t);
+      ++added;
+    }
+    accumulator.count += added;
+    return absl::OkStatus();
+  }
+
+  // Allocates the table for num_partitions partitions up front, so that it is
+  // not rehashed while adding entries. The table is reserved on the memory
+  // tracker even if it exceeds the limit.
+  void Reserve(int64_t num_partitions) {
+    partitions_.reserve(num_partitions);
+    TrackTableCapacity();
+  }
+
+  // Selects the partitions to release and returns their noisy counts and sums,
+  // in no particular order. This consumes the whole privacy budget, so results
+  // can only be released once until Reset() is called.
+  base::StatusOr<std::vector<PartitionResult>> ReleaseResults() {
+    std::vector<const Key*> keys;
+    std::vector<double> counts;
+    std::vector<double> sums;
+    RETURN_IF_ERROR(SelectAndNoise(&keys, &counts, &sums));
+
+    std::vector<PartitionResult> results;
+    results.reserve(keys.size());
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      results.push_back({*keys[i], RoundCount(counts[i]), RoundSum(sums[i])});
+    }
+    return results;
+  }
+
+  // Same as ReleaseResults(), but returns the partitions as columns, which
+  // avoids building one row per partition when exporting many partitions to a
+  // columnar format.
+  base::StatusOr<PartitionColumns> ReleaseColumns() {
+    std::vector<const Key*> keys;
+    std::vector<double> counts;
+    std::vector<double> sums;
+    RETURN_IF_ERROR(SelectAndNoise(&keys, &counts, &sums));
+    return ToColumns(keys, counts, sums);
+  }
+
+  // Same as above, and also fills the bounds columns with the confidence_level
+  // noise confidence intervals. The interval widths only depend on the
+  // mechanisms, so they are computed once for all partitions.
+  base::StatusOr<PartitionColumns> ReleaseColumns(double confidence_level) {
+    ASSIGN_OR_RETURN(ConfidenceInterval count_interval,
+                     count_mechanism_->NoiseConfidenceInterval(
+                         confidence_level, kCountBudgetFraction));
+    ASSIGN_OR_RETURN(ConfidenceInterval sum_interval,
+                     sum_mechanism_->NoiseConfidenceInterval(
+                         confidence_level, 1 - kCountBudgetFraction));
+    std::vector<const Key*> keys;
+    std::vector<double> counts;
+    std::vector<double> sums;
+    RETURN_IF_ERROR(SelectAndNoise(&keys, &counts, &sums));
+    PartitionColumns columns = ToColumns(keys, counts, sums);
+    const int64_t size = counts.size();
+    columns.count_lower_bounds.resize(size);
+    columns.count_upper_bounds.resize(size);
+    columns.sum_lower_bounds.resize(size);
+    columns.sum_upper_bounds.resize(size);
+    for (int64_t i = 0; i < size; ++i) {
+      columns.count_lower_bounds[i] = counts[i] + count_interval.lower_bound();
+      columns.count_upper_bounds[i] = counts[i] + count_interval.upper_bound();
+      columns.sum_lower_bounds[i] = sums[i] + sum_interval.lower_bound();
+      columns.sum_upper_bounds[i] = sums[i] + sum_interval.upper_bound();
+    }
+    return columns;
+  }
+
+  // Appends a checkpoint of the partitions and the parameters of the
+  // aggregator to out, in the flat format of PartitionCheckpoint, e.g., to be
+  // written to a file for fault tolerance. Requires trivially copyable keys.
+  void WriteCheckpoint(std::string* out) const {
+    using Checkpoint = PartitionCheckpoint<Key, T>;
+    Checkpoint::AppendHeader(CheckpointParams(), partitions_.size(), out);
+    for (const auto& partition : partitions_) {
+      Checkpoint::AppendRecord(
+          {partition.first, partition.second.sum, partition.second.count,
+           partition.second.num_users},
+          out);
+    }
+  }
+
+  // Adds the partitions of a checkpoint written by an aggregator with the same
+  // parameters, which is equivalent to adding their entries again. The
+  // checkpoint is read in place, e.g., from a memory-mapped file. The table
+  // is reserved for all partitions up front, even if it exceeds the memory
+  // limit. Fails without adding anything if the checkpoint is invalid or its
+  // parameters differ, or if the results were already released.
+  absl::Status RestoreCheckpoint(absl::string_view data) {
+    if (released_) {
+      return absl::FailedPreconditionError(
+          "Cannot restore a checkpoint after the results were released.");
+    }
+    using Checkpoint = PartitionCheckpoint<Key, T>;
+    ASSIGN_OR_RETURN(Checkpoint checkpoint, OpenCheckpoint(data));
+    Reserve(partitions_.size() + checkpoint.size());
+    for (int64_t i = 0; i < checkpoint.size(); ++i) {
+      const PartitionRecord<Key, T> record = checkpoint.Get(i);
+      Accumulator& accumulator = partitions_[record.key];
+      accumulator.sum += record.sum;
+      accumulator.count += record.count;
+      accumulator.num_users += record.num_users;
+    }
+    return absl::OkStatus();
+  }
+
+  // Appends the partitions to out as a checkpoint sorted by key, and removes
+  // them, which frees the memory of the table. This lets an aggregation handle
+  // more partitions than fit in memory: when AddEntries() fails because of
+  // the memory limit, the partitions are spilled, e.g., to a file, and the
+  // contribution is added again. The spills are merged back by
+  // ReleaseResults(spills). Requires trivially copyable keys that are ordered
+  // by operator<.
+  absl::Status SpillSorted(std::string* out) {
+    if (released_) {
+      return absl::FailedPreconditionError(
+          "Cannot spill partitions after the results were released.");
+    }
+    AppendSortedCheckpoint(out);
+    Table().swap(partitions_);
+    TrackTableCapacity();
+    return absl::OkStatus();
+  }
+
+  // Same as ReleaseResults(), but also releases the partitions spilled by
+  // SpillSorted(), whose checkpoints are read in place, e.g., from
+  // memory-mapped files. The spills and the partitions in memory are merged
+  // like the runs of an external sort, and the partitions of the same key
+  // are combined before partition selection. The results are released in
+  // increasing key order, and only a batch of the merged partitions is held
+  // in memory at a time, apart from the results.
+  base::StatusOr<std::vector<PartitionResult>> ReleaseResults(
+      absl::Span<const absl::string_view> spills) {
+    if (released_) {
+      return absl::FailedPreconditionError(
+          "Results have already been released. Call Reset() to aggregate a "
+          "new set of partitions.");
+    }
+    using Checkpoint = PartitionCheckpoint<Key, T>;
+    std::string in_memory;
+    AppendSortedCheckpoint(&in_memory);
+    std::vector<Checkpoint> checkpoints;
+    checkpoints.reserve(spills.size() + 1);
+    ASSIGN_OR_RETURN(Checkpoint checkpoint, Checkpoint::Open(in_memory));
+    checkpoints.push_back(checkpoint);
+    for (absl::string_view spill : spills) {
+      ASSIGN_OR_RETURN(checkpoint, OpenCheckpoint(spill));
+      checkpoints.push_back(checkpoint);
+    }
+    released_ = true;
+
+    std::vector<PartitionResult> results;
+    std::vector<PartitionRecord<Key, T>> batch;
+    batch.reserve(kReleaseBatchSize);
+    auto release = [&](const PartitionRecord<Key, T>& record) {
+      batch.push_back(record);
+      if (batch.size() < kReleaseBatchSize) {
+        return absl::OkStatus();
+      }
+      return ReleaseBatch(&batch, &results);
+    };
+    RETURN_IF_ERROR(
+        MergeSortedPartitionCheckpoints(absl::MakeConstSpan(checkpoints),
+                                        release));
+    RETURN_IF_ERROR(ReleaseBatch(&batch, &results));
+    return results;
+  }
+
+  // Removes all partitions and allows results to be released again.
+  void Reset() {
+    partitions_.clear();
+    TrackTableCapacity();
+    released_ = false;
+  }
+
+  // Returns the number of partitions that have been contributed to.
+  int64_t NumPartitions() const { return partitions_.size(); }
+
+  int64_t MemoryUsed() const {
+    return sizeof(PartitionedAggregator) + TableBytes(partitions_.capacity());
+  }
+
+  // Returns the tracker on which the memory of the aggregator is reserved.
+  // Its BytesUsed() equals MemoryUsed().
+  const MemoryTracker& GetMemoryTracker() const { return memory_tracker_; }
+
+  double GetEpsilon() const { return epsilon_; }
+
+  int GetMaxContributionsPerPartition() const {
+    return max_contributions_per_partition_;
+  }
+
+  const PartitionSelectionStrategy& GetPartitionSelectionStrategy() const {
+    return *strategy_;
+  }
+
+ private:
+  // Fraction of the aggregation epsilon used to noise the counts.
+  static constexpr double kCountBudgetFraction = 0.5;
+
+  // Per-partition state.
+  struct Accumulator {
+    T sum = 0;
+    int64_t count = 0;
+    int num_users = 0;
+  };
+
+  using Table = absl::flat_hash_map<Key, Accumulator, Hash, Eq>;
+
+  // Selects the partitions to release, and returns their keys and their noisy
+  // counts and sums before rounding. Fails if the results were already
+  // released.
+  absl::Status SelectAndNoise(std::vector<const Key*>* keys,
+                              std::vector<double>* counts,
+                              std::vector<double>* sums) {
+    if (released_) {
+      return absl::FailedPreconditionError(
+          "Results have already been released. Call Reset() to aggregate a "
+          "new set of partitions.");
+    }
+    released_ = true;
+
+    // Select all partitions at once, so that the strategy can share work
+    // between the decisions.
+    std::vector<int64_t> num_users;
+    num_users.reserve(partitions_.size());
+    for (const auto& partition : partitions_) {
+      num_users.push_back(partition.second.num_users);
+    }
+    std::vector<bool> keep;
+    strategy_->ShouldKeep(num_users, &keep);
+
+    int64_t index = 0;
+    for (const auto& partition : partitions_) {
+      if (keep[index++]) {
+        keys->push_back(&partition.first);
+        counts->push_back(partition.second.count);
+        sums->push_back(partition.second.sum);
+      }
+    }
+    RETURN_IF_ERROR(count_mechanism_->AddNoise(
+        *counts, absl::MakeSpan(*counts), kCountBudgetFraction));
+    RETURN_IF_ERROR(sum_mechanism_->AddNoise(*sums, absl::MakeSpan(*sums),
+                                             1 - kCountBudgetFraction));
+    return absl::OkStatus();
+  }
+
+  // Returns the columns of the keys and the rounded counts and sums returned
+  // by SelectAndNoise().
+  static PartitionColumns ToColumns(absl::Span<const Key* const> keys,
+                                    absl::Span<const double> counts,
+                                    absl::Span<const double> sums) {
+    PartitionColumns columns;
+    const int64_t size = keys.size();
+    columns.keys.reserve(size);
+    columns.counts.resize(size);
+    columns.sums.resize(size);
+    for (int64_t i = 0; i < size; ++i) {
+      columns.keys.push_back(*keys[i]);
+      columns.counts[i] = RoundCount(counts[i]);
+      columns.sums[i] = RoundSum(sums[i]);
+    }
+    return columns;
+  }
+
+  static int64_t RoundCount(double noisy_count) {
+    int64_t count;
+    SafeCastFromDouble(std::round(noisy_count), count);
+    return count;
+  }
+
+  // Rounds the noisy sum for integral T.
+  static T RoundSum(double noisy_sum) {
+    if (std::is_integral<T>::value) {
+      T sum;
+      SafeCastFromDouble<T>(std::round(noisy_sum), sum);
+      return sum;
+    }
+    return static_cast<T>(noisy_sum);
+  }
+
+  PartitionedAggregator(double epsilon, T lower, T upper,
+                        int max_contributions_per_partition,
+                        std::unique_ptr<PartitionSelectionStrategy> strategy,
+                        std::unique_ptr<NumericalMechanism> count_mechanism,
+                        std::unique_ptr<NumericalMechanism> sum_mechanism,
+                        int64_t memory_limit,
+                        MemoryTracker* parent_memory_tracker)
+      : epsilon_(epsilon),
+        lower_(lower),
+        upper_(upper),
+        max_contributions_per_partition_(max_contributions_per_partition),
+        strategy_(std::move(strategy)),
+        count_mechanism_(std::move(count_mechanism)),
+        sum_mechanism_(std::move(sum_mechanism)),
+        memory_tracker_(memory_limit, parent_memory_tracker) {}
+
+  // Number of merged partitions that ReleaseResults(spills) selects and
+  // noises at once.
+  static constexpr int64_t kReleaseBatchSize = 4096;
+
+  // Opens a checkpoint and checks that it was written by an aggregator with
+  // the same parameters.
+  base::StatusOr<PartitionCheckpoint<Key, T>> OpenCheckpoint(
+      absl::string_view data) const {
+    using Checkpoint = PartitionCheckpoint<Key, T>;
+    ASSIGN_OR_RETURN(Checkpoint checkpoint, Checkpoint::Open(data));
+    const PartitionCheckpointParams& params = checkpoint.params();
+    const PartitionCheckpointParams expected = CheckpointParams();
+    if (params.epsilon != expected.epsilon || params.lower != expected.lower ||
+        params.upper != expected.upper ||
+        params.max_contributions_per_partition !=
+            expected.max_contributions_per_partition) {
+      return absl::InvalidArgumentError(
+          "Checkpoint was written by an aggregator with different "
+          "parameters.");
+    }
+    return checkpoint;
+  }
+
+  // Appends a checkpoint of the partitions sorted by key to out.
+  void AppendSortedCheckpoint(std::string* out) const {
+    std::vector<const typename Table::value_type*> sorted;
+    sorted.reserve(partitions_.size());
+    for (const auto& partition : partitions_) {
+      sorted.push_back(&partition);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const typename Table::value_type* a,
+                 const typename Table::value_type* b) {
+                return a->first < b->first;
+              });
+    using Checkpoint = PartitionCheckpoint<Key, T>;
+    Checkpoint::AppendHeader(CheckpointParams(), sorted.size(), out);
+    for (const auto* partition : sorted) {
+      Checkpoint::AppendRecord(
+          {partition->first, partition->second.sum, partition->second.count,
+           partition->second.num_users},
+          out);
+    }
+  }
+
+  // Selects and noises a batch of merged partitions, appends the released
+  // ones to results, and clears the batch.
+  absl::Status ReleaseBatch(
+      std::vector<PartitionRecord<Key, T>>* batch,
+      std::vector<PartitionResult>* results) {
+    std::vector<int64_t> num_users;
+    num_users.reserve(batch->size());
+    for (const auto& record : *batch) {
+      num_users.push_back(record.num_users);
+    }
+    std::vector<bool> keep;
+    strategy_->ShouldKeep(num_users, &keep);
+
+    std::vector<const Key*> keys;
+    std::vector<double> counts;
+    std::vector<double> sums;
+    for (int64_t i = 0; i < batch->size(); ++i) {
+      if (keep[i]) {
+        keys.push_back(&(*batch)[i].key);
+        counts.push_back((*batch)[i].count);
+        sums.push_back((*batch)[i].sum);
+      }
+    }
+    RETURN_IF_ERROR(count_mechanism_->AddNoise(
+        counts, absl::MakeSpan(counts), kCountBudgetFraction));
+    RETURN_IF_ERROR(sum_mechanism_->AddNoise(sums, absl::MakeSpan(sums),
+                                             1 - kCountBudgetFraction));
+    for (int64_t i = 0; i < keys.size(); ++i) {
+      results->push_back(
+          {*keys[i], RoundCount(counts[i]), RoundSum(sums[i])});
+    }
+    batch->clear();
+    return absl::OkStatus();
+  }
+
+  PartitionCheckpointParams CheckpointParams() const {
+    return {epsilon_, static_cast<double>(lower_), static_cast<double>(upper_),
+            max_contributions_per_partition_};
+  }
+
+  // Returns the bytes of a table with capacity slots. The table stores one
+  // control byte per slot next to the slots.
+  static int64_t TableBytes(int64_t capacity) {
+    return capacity * (sizeof(typename Table::value_type) + sizeof(int8_t));
+  }
+
+  // Returns whether inserting a partition may rehash the table, which keeps
+  // its load factor at most 7/8. This may be conservative for small tables.
+  bool MayGrowOnInsert() const {
+    const int64_t capacity = partitions_.capacity();
+    return partitions_.size() >= capacity - capacity / 8;
+  }
+
+  // Reserves or releases the change of the table capacity since the last call
+  // on the memory tracker.
+  void TrackTableCapacity() {
+    const int64_t capacity = partitions_.capacity();
+    const int64_t delta = TableBytes(capacity) - TableBytes(tracked_capacity_);
+    if (delta > 0) {
+      memory_tracker_.Reserve(delta);
+    } else if (delta < 0) {
+      memory_tracker_.Release(-delta);
+    }
+    tracked_capacity_ = capacity;
+  }
+
+  const double epsilon_;
+  const T lower_;
+  const T upper_;
+  const int max_contributions_per_partition_;
+  std::unique_ptr<PartitionSelectionStrategy> strategy_;
+  std::unique_ptr<NumericalMechanism> count_mechanism_;
+  std::unique_ptr<NumericalMechanism> sum_mechanism_;
+
+  MemoryTracker memory_tracker_;
+  Table partitions_;
+  int64_t tracked_capacity_ = 0;
+  bool released_ = false;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
@@ -0,0 +1,519 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/partitioned-aggregator.h"
+
+#include <string>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "base/statusor.h"
+#include "algorithms/memory-tracker.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/partition-selection.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::UnorderedElementsAre;
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+
+// Keeps the partitions with at least min_users privacy units.
+class MinUsersSelection : public PartitionSelectionStrategy {
+ public:
+  MinUsersSelection(int min_users, int64_t max_partitions_contributed)
+      : PartitionSelectionStrategy(1, 1e-5, max_partitions_contributed, 1e-5),
+        min_users_(min_users) {}
+
+  bool ShouldKeep(int num_users) override { return num_users >= min_users_; }
+
+ private:
+  const int min_users_;
+};
+
+template <typename Key, typename T>
+std::unique_ptr<PartitionedAggregator<Key, T>> MakeAggregator(
+    int min_users, int max_contributions = 1) {
+  return typename PartitionedAggregator<Key, T>::Builder()
+      .SetEpsilon(1)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetMaxContributionsPerPartition(max_contributions)
+      .SetPartitionSelectionStrategy(
+          absl::make_unique<MinUsersSelection>(min_users, 1))
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+MATCHER_P3(PartitionIs, key, count, sum, "") {
+  return arg.key == key && arg.count == count && arg.sum == sum;
+}
+
+TEST(PartitionedAggregatorTest, CountsAndSumsPerPartition) {
+  auto aggregator = MakeAggregator<std::string, int64_t>(/*min_users=*/1);
+  ASSERT_OK(aggregator->AddEntry("a", 1));
+  ASSERT_OK(aggregator->AddEntry("a", 2));
+  ASSERT_OK(aggregator->AddEntry("b", 5));
+  EXPECT_EQ(aggregator->NumPartitions(), 2);
+
+  base::StatusOr<std::vector<PartitionedAggregator<
+      std::string, int64_t>::PartitionResult>>
+      results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_THAT(results.value(), UnorderedElementsAre(PartitionIs("a", 2, 3),
+                                                    PartitionIs("b", 1, 5)));
+}
+
+TEST(PartitionedAggregatorTest, DropsPartitionsTheStrategyRejects) {
+  auto aggregator = MakeAggregator<int64_t, double>(/*min_users=*/2);
+  ASSERT_OK(aggregator->AddEntry(1, 1.5));
+  ASSERT_OK(aggregator->AddEntry(1, 2.5));
+  ASSERT_OK(aggregator->AddEntry(2, 3));
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_THAT(results.value(), UnorderedElementsAre(PartitionIs(1, 2, 4.0)));
+}
+
+TEST(PartitionedAggregatorTest, BoundsContributionsOfAPrivacyUnit) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/1,
+                                                     /*max_contributions=*/2);
+  const std::vector<int64_t> values = {20, -5, 7};
+  ASSERT_OK(aggregator->AddEntries(1, values));
+
+  // Values are clamped to [0, 10], and only the first two are used.
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_THAT(results.value(), UnorderedElementsAre(PartitionIs(1, 2, 10)));
+}
+
+TEST(PartitionedAggregatorTest, IgnoresNaN) {
+  auto aggregator = MakeAggregator<int64_t, double>(/*min_users=*/1);
+  ASSERT_OK(aggregator->AddEntry(1, std::numeric_limits<double>::quiet_NaN()));
+  ASSERT_OK(aggregator->AddEntry(1, 3));
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_THAT(results.value(), UnorderedElementsAre(PartitionIs(1, 1, 3.0)));
+}
+
+TEST(PartitionedAggregatorTest, ReleasesOnlyOnceUntilReset) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/1);
+  ASSERT_OK(aggregator->AddEntry(1, 1));
+  ASSERT_OK(aggregator->ReleaseResults());
+  EXPECT_THAT(aggregator->ReleaseResults(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("already been released")));
+
+  aggregator->Reset();
+  EXPECT_EQ(aggregator->NumPartitions(), 0);
+  ASSERT_OK(aggregator->AddEntry(2, 4));
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_THAT(results.value(), UnorderedElementsAre(PartitionIs(2, 1, 4)));
+}
+
+TEST(PartitionedAggregatorTest, ManyPartitions) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/2);
+  const int64_t num_partitions = 100000;
+  aggregator->Reserve(num_partitions);
+  for (int64_t key = 0; key < num_partitions; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, key % 10));
+    if (key % 2 == 0) {
+      ASSERT_OK(aggregator->AddEntry(key, 1));
+    }
+  }
+  EXPECT_EQ(aggregator->NumPartitions(), num_partitions);
+  EXPECT_LT(aggregator->MemoryUsed(), 100 * num_partitions);
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  ASSERT_EQ(results.value().size(), num_partitions / 2);
+  for (const auto& result : results.value()) {
+    EXPECT_EQ(result.key % 2, 0);
+    EXPECT_EQ(result.count, 2);
+    EXPECT_EQ(result.sum, result.key % 10 + 1);
+  }
+}
+
+TEST(PartitionedAggregatorTest, NoisesCountsAndSums) {
+  auto aggregator = PartitionedAggregator<int64_t, double>::Builder()
+                        .SetEpsilon(1)
+                        .SetLower(0)
+                        .SetUpper(1)
+                        .SetPartitionSelectionStrategy(
+                            absl::make_unique<MinUsersSelection>(1, 1))
+                        .Build()
+                        .ValueOrDie();
+  for (int64_t key = 0; key < 100; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, 1));
+  }
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  bool noised = false;
+  for (const auto& result : results.value()) {
+    noised |= result.count != 1 || result.sum != 1;
+  }
+  EXPECT_TRUE(noised);
+}
+
+TEST(PartitionedAggregatorTest, BuildValidatesParameters) {
+  using Builder = PartitionedAggregator<int64_t, double>::Builder;
+  EXPECT_THAT(Builder()
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .SetEpsilon(-1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon")));
+  EXPECT_THAT(Builder()
+                  .SetLower(0)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("bounds must be set")));
+  EXPECT_THAT(Builder()
+                  .SetLower(2)
+                  .SetUpper(1)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("cannot be greater than upper")));
+  EXPECT_THAT(Builder()
+                  .SetLower(0)
+                  .SetUpper(1)
+                  .SetMaxContributionsPerPartition(0)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("contributions per partition")));
+  EXPECT_THAT(Builder().SetLower(0).SetUpper(1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Partition selection strategy")));
+}
+
+TEST(PartitionedAggregatorTest, TracksMemoryIncrementally) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/1);
+  EXPECT_EQ(aggregator->GetMemoryTracker().BytesUsed(),
+            aggregator->MemoryUsed());
+  for (int64_t key = 0; key < 1000; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, 1));
+    EXPECT_EQ(aggregator->GetMemoryTracker().BytesUsed(),
+              aggregator->MemoryUsed());
+  }
+  aggregator->Reserve(10000);
+  EXPECT_EQ(aggregator->GetMemoryTracker().BytesUsed(),
+            aggregator->MemoryUsed());
+  aggregator->Reset();
+  EXPECT_EQ(aggregator->GetMemoryTracker().BytesUsed(),
+            aggregator->MemoryUsed());
+}
+
+TEST(PartitionedAggregatorTest, RejectsNewPartitionsBeyondMemoryLimit) {
+  MemoryTracker process;
+  const int64_t limit = 8192;
+  auto aggregator = PartitionedAggregator<int64_t, int64_t>::Builder()
+                        .SetEpsilon(1)
+                        .SetLower(0)
+                        .SetUpper(10)
+                        .SetPartitionSelectionStrategy(
+                            absl::make_unique<MinUsersSelection>(1, 1))
+                        .SetLaplaceMechanism(
+                            absl::make_unique<ZeroNoiseMechanism::Builder>())
+                        .SetMemoryLimit(limit)
+                        .SetParentMemoryTracker(&process)
+                        .Build();
+  ASSERT_OK(aggregator);
+
+  int64_t key = 0;
+  absl::Status status = absl::OkStatus();
+  for (; status.ok(); ++key) {
+    status = (*aggregator)->AddEntry(key, 1);
+  }
+  EXPECT_THAT(status, StatusIs(absl::StatusCode::kResourceExhausted,
+                               HasSubstr("Memory limit")));
+  const int64_t num_partitions = (*aggregator)->NumPartitions();
+  EXPECT_EQ(num_partitions, key - 1);
+  EXPECT_LE((*aggregator)->MemoryUsed(), limit);
+  EXPECT_EQ(process.BytesUsed(), (*aggregator)->MemoryUsed());
+
+  // Existing partitions still accept contributions.
+  EXPECT_OK((*aggregator)->AddEntry(0, 1));
+  EXPECT_EQ((*aggregator)->NumPartitions(), num_partitions);
+
+  aggregator->reset();
+  EXPECT_EQ(process.BytesUsed(), 0);
+}
+
+TEST(PartitionedAggregatorTest, ParentMemoryLimitIsShared) {
+  MemoryTracker process(/*limit=*/8192);
+  auto make_aggregator = [&process]() {
+    return PartitionedAggregator<int64_t, int64_t>::Builder()
+        .SetEpsilon(1)
+        .SetLower(0)
+        .SetUpper(10)
+        .SetPartitionSelectionStrategy(
+            absl::make_unique<MinUsersSelection>(1, 1))
+        .SetParentMemoryTracker(&process)
+        .Build()
+        .ValueOrDie();
+  };
+  auto first = make_aggregator();
+  auto second = make_aggregator();
+  int64_t key = 0;
+  while (first->AddEntry(key, 1).ok()) {
+    ++key;
+  }
+  // The first aggregator used up the shared limit.
+  int64_t second_key = 0;
+  while (second->AddEntry(second_key, 1).ok()) {
+    ++second_key;
+  }
+  EXPECT_LT(second_key, key);
+  EXPECT_LE(process.BytesUsed(), 8192);
+}
+
+TEST(PartitionedAggregatorTest, MemoryLimitMustFitAggregator) {
+  using Builder = PartitionedAggregator<int64_t, int64_t>::Builder;
+  EXPECT_THAT(Builder()
+                  .SetLower(0)
+                  .SetUpper(10)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .SetMemoryLimit(16)
+                  .Build(),
+              StatusIs(absl::StatusCode::kResourceExhausted,
+                       HasSubstr("too small")));
+  EXPECT_THAT(Builder()
+                  .SetLower(0)
+                  .SetUpper(10)
+                  .SetPartitionSelectionStrategy(
+                      absl::make_unique<MinUsersSelection>(1, 1))
+                  .SetMemoryLimit(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Memory limit")));
+}
+
+TEST(PartitionedAggregatorTest, ReleasesColumns) {
+  auto aggregator = MakeAggregator<std::string, int64_t>(/*min_users=*/2);
+  ASSERT_OK(aggregator->AddEntry("a", 1));
+  ASSERT_OK(aggregator->AddEntry("a", 2));
+  ASSERT_OK(aggregator->AddEntry("b", 5));
+  ASSERT_OK(aggregator->AddEntry("c", 20));
+  ASSERT_OK(aggregator->AddEntry("c", 4));
+
+  auto columns = aggregator->ReleaseColumns();
+  ASSERT_OK(columns);
+  ASSERT_EQ(columns->keys.size(), 2);
+  ASSERT_EQ(columns->counts.size(), 2);
+  ASSERT_EQ(columns->sums.size(), 2);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(columns->counts[i], 2);
+    EXPECT_EQ(columns->sums[i], columns->keys[i] == "a" ? 3 : 14);
+  }
+  EXPECT_THAT(columns->keys, UnorderedElementsAre("a", "c"));
+  EXPECT_TRUE(columns->count_lower_bounds.empty());
+  EXPECT_TRUE(columns->sum_upper_bounds.empty());
+
+  EXPECT_THAT(aggregator->ReleaseColumns(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("already been released")));
+}
+
+TEST(PartitionedAggregatorTest, ReleasesColumnsWithConfidenceBounds) {
+  auto build = [] {
+    return PartitionedAggregator<int64_t, double>::Builder()
+        .SetEpsilon(1)
+        .SetLower(0)
+        .SetUpper(10)
+        .SetPartitionSelectionStrategy(
+            absl::make_unique<MinUsersSelection>(1, 1))
+        .Build()
+        .ValueOrDie();
+  };
+  auto aggregator = build();
+  for (int64_t key = 0; key < 10; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, key));
+  }
+  auto columns = aggregator->ReleaseColumns(0.9);
+  ASSERT_OK(columns);
+  ASSERT_EQ(columns->keys.size(), 10);
+  ASSERT_EQ(columns->count_lower_bounds.size(), 10);
+  ASSERT_EQ(columns->sum_upper_bounds.size(), 10);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_LT(columns->count_lower_bounds[i], columns->counts[i]);
+    EXPECT_GT(columns->count_upper_bounds[i], columns->counts[i]);
+    EXPECT_LT(columns->sum_lower_bounds[i], columns->sums[i]);
+    EXPECT_GT(columns->sum_upper_bounds[i], columns->sums[i]);
+    // The sum has the larger sensitivity, so its interval is wider.
+    EXPECT_GT(columns->sum_upper_bounds[i] - columns->sum_lower_bounds[i],
+              columns->count_upper_bounds[i] - columns->count_lower_bounds[i]);
+  }
+
+  EXPECT_THAT(build()->ReleaseColumns(1.5),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Confidence level")));
+}
+
+TEST(PartitionedAggregatorTest, RestoresCheckpoint) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/2);
+  for (int64_t key = 0; key < 100; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, key % 10));
+  }
+  std::string checkpoint;
+  aggregator->WriteCheckpoint(&checkpoint);
+
+  // Restoring into an empty aggregator is the same as adding the entries
+  // again, and restoring twice adds the partitions twice.
+  auto restored = MakeAggregator<int64_t, int64_t>(/*min_users=*/2);
+  ASSERT_OK(restored->RestoreCheckpoint(checkpoint));
+  EXPECT_EQ(restored->NumPartitions(), 100);
+  auto results = restored->ReleaseResults();
+  ASSERT_OK(results);
+  EXPECT_TRUE(results->empty());
+
+  restored->Reset();
+  ASSERT_OK(restored->RestoreCheckpoint(checkpoint));
+  ASSERT_OK(restored->RestoreCheckpoint(checkpoint));
+  results = restored->ReleaseResults();
+  ASSERT_OK(results);
+  ASSERT_EQ(results->size(), 100);
+  for (const auto& result : results.value()) {
+    EXPECT_EQ(result.count, 2);
+    EXPECT_EQ(result.sum, 2 * (result.key % 10));
+  }
+  EXPECT_THAT(restored->RestoreCheckpoint(checkpoint),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("after the results were released")));
+}
+
+TEST(PartitionedAggregatorTest, RejectsCheckpointWithDifferentParameters) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/1);
+  ASSERT_OK(aggregator->AddEntry(1, 1));
+  std::string checkpoint;
+  aggregator->WriteCheckpoint(&checkpoint);
+
+  auto other = MakeAggregator<int64_t, int64_t>(/*min_users=*/1,
+                                                /*max_contributions=*/2);
+  EXPECT_THAT(other->RestoreCheckpoint(checkpoint),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("different parameters")));
+  EXPECT_EQ(other->NumPartitions(), 0);
+  EXPECT_THAT(other->RestoreCheckpoint("invalid"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(PartitionedAggregatorTest, ReleasesSpilledPartitions) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/2);
+  std::vector<std::string> spills(3);
+  // Every key gets one privacy unit in each spill and one in memory, and keys
+  // divisible by 7 only get one in total.
+  for (std::string& spill : spills) {
+    for (int64_t key = 1; key < 500; ++key) {
+      if (key % 7 != 0) {
+        ASSERT_OK(aggregator->AddEntry(key, key % 10));
+      }
+    }
+    ASSERT_OK(aggregator->SpillSorted(&spill));
+    EXPECT_EQ(aggregator->NumPartitions(), 0);
+  }
+  for (int64_t key = 1; key < 500; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, key % 10));
+  }
+
+  std::vector<absl::string_view> views(spills.begin(), spills.end());
+  auto results = aggregator->ReleaseResults(views);
+  ASSERT_OK(results);
+  ASSERT_EQ(results->size(), 499 - 499 / 7);
+  int64_t previous_key = 0;
+  for (const auto& result : results.value()) {
+    EXPECT_GT(result.key, previous_key);
+    EXPECT_NE(result.key % 7, 0);
+    EXPECT_EQ(result.count, 4);
+    EXPECT_EQ(result.sum, 4 * (result.key % 10));
+    previous_key = result.key;
+  }
+  EXPECT_THAT(aggregator->ReleaseResults(views),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  std::string spill;
+  EXPECT_THAT(aggregator->SpillSorted(&spill),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(PartitionedAggregatorTest, SpillingFreesMemory) {
+  auto aggregator =
+      PartitionedAggregator<int64_t, int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetPartitionSelectionStrategy(
+              absl::make_unique<MinUsersSelection>(1, 1))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetMemoryLimit(1 << 14)
+          .Build()
+          .ValueOrDie();
+  std::vector<std::string> spills;
+  for (int64_t key = 0; key < 10000; ++key) {
+    absl::Status status = aggregator->AddEntry(key, 1);
+    if (status.code() == absl::StatusCode::kResourceExhausted) {
+      spills.emplace_back();
+      ASSERT_OK(aggregator->SpillSorted(&spills.back()));
+      status = aggregator->AddEntry(key, 1);
+    }
+    ASSERT_OK(status);
+  }
+  EXPECT_GT(spills.size(), 1);
+  EXPECT_LE(aggregator->MemoryUsed(), 1 << 14);
+
+  std::vector<absl::string_view> views(spills.begin(), spills.end());
+  auto results = aggregator->ReleaseResults(views);
+  ASSERT_OK(results);
+  EXPECT_EQ(results->size(), 10000);
+}
+
+TEST(PartitionedAggregatorTest, RejectsUnsortedSpill) {
+  auto aggregator = MakeAggregator<int64_t, int64_t>(/*min_users=*/1);
+  ASSERT_OK(aggregator->AddEntry(1, 1));
+  ASSERT_OK(aggregator->AddEntry(2, 1));
+  using Checkpoint = PartitionCheckpoint<int64_t, int64_t>;
+  // Swap the records of a sorted spill.
+  std::string sorted;
+  ASSERT_OK(aggregator->SpillSorted(&sorted));
+  auto checkpoint = Checkpoint::Open(sorted);
+  ASSERT_OK(checkpoint);
+  std::string unsorted;
+  Checkpoint::AppendHeader(checkpoint->params(), 2, &unsorted);
+  Checkpoint::AppendRecord(checkpoint->Get(1), &unsorted);
+  Checkpoint::AppendRecord(checkpoint->Get(0), &unsorted);
+
+  std::vector<absl::string_view> spills = {unsorted};
+  EXPECT_THAT(aggregator->ReleaseResults(spills),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not sorted")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
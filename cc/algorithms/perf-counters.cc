@@ -0,0 +1,156 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/perf-counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace differential_privacy {
+
+absl::string_view PerfEventName(PerfEvent event) {
+  switch (event) {
+    case PerfEvent::kCycles:
+      return "cycles";
+    case PerfEvent::kInstructions:
+      return "instructions";
+    case PerfEvent::kCacheMisses:
+      return "cache_misses";
+    case PerfEvent::kBranchMisses:
+      return "branch_misses";
+  }
+  return "";
+}
+
+#ifdef __linux__
+
+namespace {
+
+constexpr uint64_t kPerfEventConfigs[kNumPerfEvents] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+// The value of a counter read with PERF_FORMAT_TOTAL_TIME_ENABLED and
+// PERF_FORMAT_TOTAL_TIME_RUNNING.
+struct PerfReadFormat {
+  uint64_t value;
+  uint64_t time_enabled;
+  uint64_t time_running;
+};
+
+}  // namespace
+
+base::StatusOr<std::unique_ptr<PerfCounters>> PerfCounters::Open() {
+  auto counters = absl::WrapUnique(new PerfCounters());
+  int last_errno = 0;
+  bool any_available = false;
+  for (int i = 0; i < kNumPerfEvents; ++i) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = kPerfEventConfigs[i];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    const int fd = syscall(SYS_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1,
+                           /*group_fd=*/-1, /*flags=*/0);
+    if (fd < 0) {
+      last_errno = errno;
+      continue;
+    }
+    counters->fds_[i] = fd;
+    any_available = true;
+  }
+  if (!any_available) {
+    return absl::UnavailableError(
+        absl::StrCat("No hardware perf events are available: ",
+                     std::strerror(last_errno)));
+  }
+  return std::move(counters);
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void PerfCounters::Start() {
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+PerfEventCounts PerfCounters::Stop() {
+  PerfEventCounts counts = {};
+  for (int i = 0; i < kNumPerfEvents; ++i) {
+    if (fds_[i] < 0) {
+      continue;
+    }
+    ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+    PerfReadFormat read_format;
+    if (read(fds_[i], &read_format, sizeof(read_format)) !=
+        sizeof(read_format)) {
+      continue;
+    }
+    // The kernel multiplexes the counters if there are more events than
+    // hardware counters, so that each only runs part of the time.
+    double value = read_format.value;
+    if (read_format.time_running > 0 &&
+        read_format.time_running < read_format.time_enabled) {
+      value *= static_cast<double>(read_format.time_enabled) /
+               read_format.time_running;
+    }
+    counts[i] = static_cast<int64_t>(value);
+  }
+  return counts;
+}
+
+#else  // __linux__
+
+base::StatusOr<std::unique_ptr<PerfCounters>> PerfCounters::Open() {
+  return absl::UnavailableError(
+      "Hardware perf events are only available on Linux.");
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::Start() {}
+
+PerfEventCounts PerfCounters::Stop() { return {}; }
+
+#endif  // __linux__
+
+}  // namespace differential_privacy
@@ -0,0 +1,86 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PERF_COUNTERS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PERF_COUNTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "base/statusor.h"
+
+namespace differential_privacy {
+
+// Hardware events counted by PerfCounters.
+enum class PerfEvent { kCycles, kInstructions, kCacheMisses, kBranchMisses };
+
+constexpr int kNumPerfEvents = 4;
+
+// Returns the name of event in benchmark reports, e.g., "cycles".
+absl::string_view PerfEventName(PerfEvent event);
+
+// The counts of the events since the last Start(). Events that the CPU or the
+// kernel does not provide are 0.
+using PerfEventCounts = std::array<int64_t, kNumPerfEvents>;
+
+// Counts hardware events of the calling thread in user space with the Linux
+// perf_event_open interface, e.g., to attribute the cycles and cache misses
+// of a benchmark to the entries it processes:
+//
+//   ASSIGN_OR_RETURN(std::unique_ptr<PerfCounters> counters,
+//                    PerfCounters::Open());
+//   counters->Start();
+//   ...
+//   PerfEventCounts counts = counters->Stop();
+//
+// Counting user space only works with kernel.perf_event_paranoid <= 2, the
+// default of most distributions. Virtual machines often provide no hardware
+// events at all. Not thread safe.
+class PerfCounters {
+ public:
+  // Opens a counter for every event that is available. Fails with
+  // Unavailable if no event is, or on platforms other than Linux.
+  static base::StatusOr<std::unique_ptr<PerfCounters>> Open();
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Returns whether event is counted.
+  bool HasEvent(PerfEvent event) const {
+    return fds_[static_cast<int>(event)] >= 0;
+  }
+
+  // Resets all counters to 0 and starts counting.
+  void Start();
+
+  // Stops counting and returns the counts since Start().
+  PerfEventCounts Stop();
+
+ private:
+  PerfCounters() { fds_.fill(-1); }
+
+  // File descriptor of the counter of every event, -1 for events that are
+  // not available.
+  std::array<int, kNumPerfEvents> fds_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PERF_COUNTERS_H_
@@ -0,0 +1,64 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/perf-counters.h"
+
+#include <memory>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+
+TEST(PerfCountersTest, EventNames) {
+  EXPECT_EQ(PerfEventName(PerfEvent::kCycles), "cycles");
+  EXPECT_EQ(PerfEventName(PerfEvent::kInstructions), "instructions");
+  EXPECT_EQ(PerfEventName(PerfEvent::kCacheMisses), "cache_misses");
+  EXPECT_EQ(PerfEventName(PerfEvent::kBranchMisses), "branch_misses");
+}
+
+TEST(PerfCountersTest, CountsInstructionsIfAvailable) {
+  base::StatusOr<std::unique_ptr<PerfCounters>> counters =
+      PerfCounters::Open();
+  if (!counters.ok()) {
+    // Machines without hardware events, e.g., most virtual machines.
+    EXPECT_THAT(counters, StatusIs(absl::StatusCode::kUnavailable));
+    return;
+  }
+  if (!(*counters)->HasEvent(PerfEvent::kInstructions)) {
+    GTEST_SKIP() << "Instructions are not counted on this machine.";
+  }
+  (*counters)->Start();
+  volatile int64_t sum = 0;
+  for (int i = 0; i < 100000; ++i) {
+    sum += i;
+  }
+  const PerfEventCounts counts = (*counters)->Stop();
+  EXPECT_GT(counts[static_cast<int>(PerfEvent::kInstructions)], 100000);
+
+  // Start() resets the counters.
+  (*counters)->Start();
+  const PerfEventCounts empty_counts = (*counters)->Stop();
+  EXPECT_LT(empty_counts[static_cast<int>(PerfEvent::kInstructions)],
+            counts[static_cast<int>(PerfEvent::kInstructions)]);
+}
+
+}  // namespace
+}  // namespace differential_privacy
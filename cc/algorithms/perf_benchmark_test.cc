@@ -0,0 +1,360 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Runs the mechanism and algorithm benchmarks under hardware perf counters and
+// fails if they regressed from a stored baseline. Every benchmark reports
+//
+//   cycles_per_entry, instructions_per_entry, cache_misses_per_entry,
+//   branch_misses_per_entry: hardware events per noised value or added entry,
+//     if the CPU provides them, see PerfCounters.
+//   rng_bytes_per_output: random bytes drawn from SecureURBG per noised
+//     value or algorithm result.
+//   cpu_time_ns: CPU time per iteration.
+//
+// Flags, in addition to those of Google Benchmark:
+//
+//   --report_out=<path>: writes the metrics as JSON to path. Defaults to
+//     perf_benchmark_report.json in $TEST_UNDECLARED_OUTPUTS_DIR when run by
+//     bazel test.
+//   --baseline=<path>: fails if a gated metric of a benchmark increased by
+//     more than --max_regression from the report at path.
+//   --max_regression=<fraction>: defaults to 0.1.
+//   --gated_metrics=<metric>,...: defaults to instructions_per_entry and
+//     rng_bytes_per_output, which barely depend on the machine and its load.
+//
+// To update the baseline, copy the report of a run on the machine that runs
+// the gate over perf_benchmark_baseline.json.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/types/span.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/benchmark-report.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/count.h"
+#include "algorithms/metrics.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/perf-counters.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr double kEpsilon = 1.0;
+constexpr double kLower = -50;
+constexpr double kUpper = 50;
+constexpr int kNumEntries = 1024;
+
+// The counters of the calling thread, or nullptr if no hardware events are
+// available.
+PerfCounters* perf_counters = nullptr;
+
+// Counts the hardware events and random bytes of a benchmark loop, and adds
+// them to the counters of the benchmark when it is destroyed. Construct it
+// right before the loop, so that only the loop is counted.
+class ScopedEventCounters {
+ public:
+  ScopedEventCounters(benchmark::State& state, int64_t entries_per_iteration,
+                      int64_t outputs_per_iteration)
+      : state_(state),
+        entries_per_iteration_(entries_per_iteration),
+        outputs_per_iteration_(outputs_per_iteration),
+        random_bytes_(
+            metrics::GetCounter(metrics::Counter::kRandomBytesConsumed)) {
+    if (perf_counters != nullptr) {
+      perf_counters->Start();
+    }
+  }
+
+  ~ScopedEventCounters() {
+    PerfEventCounts counts = {};
+    if (perf_counters != nullptr) {
+      counts = perf_counters->Stop();
+    }
+    const double iterations = state_.iterations();
+    if (iterations == 0) {
+      return;
+    }
+    const double entries = iterations * entries_per_iteration_;
+    for (int i = 0; i < kNumPerfEvents; ++i) {
+      const PerfEvent event = static_cast<PerfEvent>(i);
+      if (perf_counters != nullptr && perf_counters->HasEvent(event)) {
+        state_.counters[absl::StrCat(PerfEventName(event), "_per_entry")] =
+            counts[i] / entries;
+      }
+    }
+    if (metrics::kMetricsEnabled) {
+      state_.counters["rng_bytes_per_output"] =
+          (metrics::GetCounter(metrics::Counter::kRandomBytesConsumed) -
+           random_bytes_) /
+          (iterations * outputs_per_iteration_);
+    }
+  }
+
+ private:
+  benchmark::State& state_;
+  const int64_t entries_per_iteration_;
+  const int64_t outputs_per_iteration_;
+  const int64_t random_bytes_;
+};
+
+std::unique_ptr<NumericalMechanism> MakeLaplace() {
+  return LaplaceMechanism::Builder()
+      .SetL1Sensitivity(1.0)
+      .SetEpsilon(kEpsilon)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<NumericalMechanism> MakeGaussian() {
+  return GaussianMechanism::Builder()
+      .SetL2Sensitivity(1.0)
+      .SetEpsilon(kEpsilon)
+      .SetDelta(1e-5)
+      .Build()
+      .ValueOrDie();
+}
+
+using MechanismFactory = std::unique_ptr<NumericalMechanism> (*)();
+
+void BM_AddNoise(benchmark::State& state, MechanismFactory factory) {
+  std::unique_ptr<NumericalMechanism> mechanism = factory();
+  ScopedEventCounters counters(state, 1, 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism->AddNoise(1.0, 1.0));
+  }
+}
+BENCHMARK_CAPTURE(BM_AddNoise, Laplace, &MakeLaplace);
+BENCHMARK_CAPTURE(BM_AddNoise, Gaussian, &MakeGaussian);
+
+void BM_AddNoiseBatch(benchmark::State& state, MechanismFactory factory) {
+  std::unique_ptr<NumericalMechanism> mechanism = factory();
+  std::vector<double> values(kNumEntries, 1.0);
+  ScopedEventCounters counters(state, values.size(), values.size());
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        mechanism->AddNoise(values, absl::MakeSpan(values), 1.0));
+  }
+}
+BENCHMARK_CAPTURE(BM_AddNoiseBatch, Laplace, &MakeLaplace);
+BENCHMARK_CAPTURE(BM_AddNoiseBatch, Gaussian, &MakeGaussian);
+
+std::unique_ptr<Algorithm<double>> MakeCount() {
+  return Count<double>::Builder().SetEpsilon(kEpsilon).Build().ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedSum() {
+  return BoundedSum<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedMean() {
+  return BoundedMean<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedMeanWithApproxBounds() {
+  return BoundedMean<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .Build()
+      .ValueOrDie();
+}
+
+std::unique_ptr<Algorithm<double>> MakeBoundedVariance() {
+  return BoundedVariance<double>::Builder()
+      .SetEpsilon(kEpsilon)
+      .SetLower(kLower)
+      .SetUpper(kUpper)
+      .Build()
+      .ValueOrDie();
+}
+
+using AlgorithmFactory = std::unique_ptr<Algorithm<double>> (*)();
+
+// Adds kNumEntries entries to the algorithm and generates its result, which is
+// the work of one partition.
+void BM_Aggregate(benchmark::State& state, AlgorithmFactory factory) {
+  std::unique_ptr<Algorithm<double>> algorithm = factory();
+  std::vector<double> input(kNumEntries);
+  for (int i = 0; i < input.size(); ++i) {
+    input[i] = kLower + (i * 37) % static_cast<int>(kUpper - kLower);
+  }
+  ScopedEventCounters counters(state, input.size(), 1);
+  for (auto _ : state) {
+    algorithm->Reset();
+    algorithm->AddEntries(absl::MakeConstSpan(input));
+    benchmark::DoNotOptimize(algorithm->PartialResult());
+  }
+}
+BENCHMARK_CAPTURE(BM_Aggregate, Count, &MakeCount);
+BENCHMARK_CAPTURE(BM_Aggregate, BoundedSum, &MakeBoundedSum);
+BENCHMARK_CAPTURE(BM_Aggregate, BoundedMean, &MakeBoundedMean);
+BENCHMARK_CAPTURE(BM_Aggregate, BoundedMeanWithApproxBounds,
+                  &MakeBoundedMeanWithApproxBounds);
+BENCHMARK_CAPTURE(BM_Aggregate, BoundedVariance, &MakeBoundedVariance);
+
+// Prints the runs to the console and collects their metrics.
+class ReportCollector : public benchmark::ConsoleReporter {
+ public:
+  void ReportRuns(const std::vector<Run>& runs) override {
+    benchmark::ConsoleReporter::ReportRuns(runs);
+    for (const Run& run : runs) {
+      if (run.error_occurred || run.run_type != Run::RT_Iteration) {
+        continue;
+      }
+      std::map<std::string, double>& metrics = report_[run.benchmark_name()];
+      for (const auto& counter : run.counters) {
+        metrics[counter.first] = counter.second.value;
+      }
+      metrics["cpu_time_ns"] = run.GetAdjustedCPUTime() /
+                               benchmark::GetTimeUnitMultiplier(run.time_unit) *
+                               1e9;
+    }
+  }
+
+  const BenchmarkReport& report() const { return report_; }
+
+ private:
+  BenchmarkReport report_;
+};
+
+struct Flags {
+  std::string report_out;
+  std::string baseline;
+  double max_regression = 0.1;
+  std::vector<std::string> gated_metrics = {"instructions_per_entry",
+                                            "rng_bytes_per_output"};
+};
+
+// Parses the flags that benchmark::Initialize left in argv. Returns false on
+// unknown or malformed flags.
+bool ParseFlags(int argc, char** argv, Flags* flags) {
+  if (const char* dir = std::getenv("TEST_UNDECLARED_OUTPUTS_DIR")) {
+    flags->report_out = absl::StrCat(dir, "/perf_benchmark_report.json");
+  }
+  for (int i = 1; i < argc; ++i) {
+    const std::vector<std::string> parts =
+        absl::StrSplit(argv[i], absl::MaxSplits('=', 1));
+    if (parts.size() != 2) {
+      std::cerr << "Unknown flag " << argv[i] << "\n";
+      return false;
+    }
+    if (parts[0] == "--report_out") {
+      flags->report_out = parts[1];
+    } else if (parts[0] == "--baseline") {
+      flags->baseline = parts[1];
+    } else if (parts[0] == "--max_regression") {
+      if (!absl::SimpleAtod(parts[1], &flags->max_regression) ||
+          flags->max_regression < 0) {
+        std::cerr << "Invalid --max_regression " << parts[1] << "\n";
+        return false;
+      }
+    } else if (parts[0] == "--gated_metrics") {
+      flags->gated_metrics = absl::StrSplit(parts[1], ',', absl::SkipEmpty());
+    } else {
+      std::cerr << "Unknown flag " << argv[i] << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+int Main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  Flags flags;
+  if (!ParseFlags(argc, argv, &flags)) {
+    return 2;
+  }
+
+  base::StatusOr<std::unique_ptr<PerfCounters>> counters =
+      PerfCounters::Open();
+  if (counters.ok()) {
+    perf_counters = counters->get();
+  } else {
+    std::cerr << counters.status().message()
+              << " Hardware event metrics are not reported.\n";
+  }
+
+  ReportCollector collector;
+  benchmark::RunSpecifiedBenchmarks(&collector);
+  const BenchmarkReport& report = collector.report();
+  if (!flags.report_out.empty()) {
+    std::ofstream out(flags.report_out);
+    out << BenchmarkReportToJson(report);
+    if (!out) {
+      std::cerr << "Failed to write " << flags.report_out << "\n";
+      return 1;
+    }
+  }
+  if (flags.baseline.empty()) {
+    return 0;
+  }
+
+  std::ifstream in(flags.baseline);
+  std::stringstream baseline_json;
+  baseline_json << in.rdbuf();
+  if (!in) {
+    std::cerr << "Failed to read " << flags.baseline << "\n";
+    return 1;
+  }
+  base::StatusOr<BenchmarkReport> baseline =
+      ParseBenchmarkReport(baseline_json.str());
+  if (!baseline.ok()) {
+    std::cerr << baseline.status().message() << "\n";
+    return 1;
+  }
+  const std::vector<BenchmarkRegression> regressions =
+      FindBenchmarkRegressions(*baseline, report, flags.gated_metrics,
+                               flags.max_regression);
+  for (const BenchmarkRegression& regression : regressions) {
+    std::cerr << "REGRESSION " << BenchmarkRegressionToString(regression)
+              << "\n";
+  }
+  if (!regressions.empty()) {
+    std::cerr << regressions.size() << " metrics regressed by more than "
+              << 100 * flags.max_regression << "% from " << flags.baseline
+              << "\n";
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace differential_privacy
+
+int main(int argc, char** argv) {
+  return differential_privacy::Main(argc, argv);
+}
@@ -0,0 +1,187 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_BUDGET_ACCOUNTANT_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_BUDGET_ACCOUNTANT_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "base/statusor.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Total (epsilon, delta) budget that is shared by many algorithms, e.g., all
+// queries over the data of one user or one dataset. Algorithms bound to an
+// accountant, see AlgorithmBuilder::SetPrivacyBudgetAccountant, consume from
+// it when they release a result, in proportion to the fraction of their own
+// budget that they use. Results are refused once the accountant runs out.
+//
+// Consume is lock-free: the remaining budgets are atomics that are updated by
+// compare-and-swap, so concurrent releases from any number of threads never
+// spend more than the total budget.
+//
+// Accountants can be nested: a sub-budget has its own limits and every
+// consumption from it also consumes from its parent, e.g., to give each query
+// type of a dataset a share of the budget of the dataset.
+class PrivacyBudgetAccountant
+    : public std::enable_shared_from_this<PrivacyBudgetAccountant> {
+ public:
+  // Creates an accountant with the given total budget. epsilon must be finite
+  // and positive, and delta must be in [0, 1].
+  static base::StatusOr<std::shared_ptr<PrivacyBudgetAccountant>> Create(
+      double epsilon, double delta = 0) {
+    RETURN_IF_ERROR(ValidateBudget(epsilon, delta));
+    return std::shared_ptr<PrivacyBudgetAccountant>(
+        new PrivacyBudgetAccountant(epsilon, delta, /*parent=*/nullptr));
+  }
+
+  PrivacyBudgetAccountant(const PrivacyBudgetAccountant&) = delete;
+  PrivacyBudgetAccountant& operator=(const PrivacyBudgetAccountant&) = delete;
+
+  // Creates a sub-budget that can consume at most epsilon and delta, and also
+  // consumes from this accountant. The limits of the sub-budget may exceed the
+  // remaining budget of this accountant, e.g., to oversubscribe a budget among
+  // query types, but its consumption is always bounded by both.
+  base::StatusOr<std::shared_ptr<PrivacyBudgetAccountant>> CreateSubBudget(
+      double epsilon, double delta = 0) {
+    RETURN_IF_ERROR(ValidateBudget(epsilon, delta));
+    return std::shared_ptr<PrivacyBudgetAccountant>(
+        new PrivacyBudgetAccountant(epsilon, delta, shared_from_this()));
+  }
+
+  // Consumes epsilon and delta from this accountant and all its parents.
+  // Either all of them have enough budget left and the budget is consumed, or
+  // a FailedPrecondition error is returned and nothing is consumed.
+  //
+  // While a consumption that fails is rolled back, other threads may see the
+  // budget it had reserved as consumed, so that a concurrent consumption may
+  // fail even though there would have been enough budget for it.
+  absl::Status Consume(double epsilon, double delta = 0) {
+    if (!(epsilon >= 0) || !(delta >= 0)) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Consumed budget must be non-negative, but was epsilon = ", epsilon,
+          " and delta = ", delta, "."));
+    }
+    for (PrivacyBudgetAccountant* accountant = this; accountant != nullptr;
+         accountant = accountant->parent_.get()) {
+      if (!accountant->ReserveLocal(epsilon, delta)) {
+        // Roll back the reservations of the descendants of accountant.
+        for (PrivacyBudgetAccountant* reserved = this; reserved != accountant;
+             reserved = reserved->parent_.get()) {
+          reserved->RefundLocal(epsilon, delta);
+        }
+        return absl::FailedPreconditionError(absl::StrCat(
+            "Privacy budget exhausted: requested epsilon = ", epsilon,
+            " and delta = ", delta, ", but only epsilon = ",
+            accountant->RemainingEpsilon(),
+            " and delta = ", accountant->RemainingDelta(), " remain."));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the budget that this accountant has left, without considering the
+  // budget left in its parents.
+  double RemainingEpsilon() const {
+    return remaining_epsilon_.load(std::memory_order_relaxed);
+  }
+  double RemainingDelta() const {
+    return remaining_delta_.load(std::memory_order_relaxed);
+  }
+
+  double TotalEpsilon() const { return total_epsilon_; }
+  double TotalDelta() const { return total_delta_; }
+
+ private:
+  PrivacyBudgetAccountant(double epsilon, double delta,
+                          std::shared_ptr<PrivacyBudgetAccountant> parent)
+      : total_epsilon_(epsilon),
+        total_delta_(delta),
+        remaining_epsilon_(epsilon),
+        remaining_delta_(delta),
+        parent_(std::move(parent)) {}
+
+  static absl::Status ValidateBudget(double epsilon, double delta) {
+    RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon, "Epsilon"));
+    return ValidateIsInInclusiveInterval(delta, 0, 1, "Delta");
+  }
+
+  // Subtracts amount from remaining unless less than amount is left, up to a
+  // rounding tolerance relative to total, so that consuming a budget in equal
+  // shares does not fail for the last share.
+  static bool Reserve(std::atomic<double>* remaining, double amount,
+                      double total) {
+    if (amount == 0) {
+      return true;
+    }
+    const double tolerance = total * 1e-12;
+    double current = remaining->load(std::memory_order_relaxed);
+    do {
+      if (amount > current + tolerance) {
+        return false;
+      }
+    } while (!remaining->compare_exchange_weak(
+        current, std::max(0.0, current - amount), std::memory_order_acq_rel,
+        std::memory_order_relaxed));
+    return true;
+  }
+
+  static void Refund(std::atomic<double>* remaining, double amount,
+                     double total) {
+    if (amount == 0) {
+      return;
+    }
+    double current = remaining->load(std::memory_order_relaxed);
+    while (!remaining->compare_exchange_weak(
+        current, std::min(total, current + amount), std::memory_order_acq_rel,
+        std::memory_order_relaxed)) {
+    }
+  }
+
+  // Reserves epsilon and delta from this accountant only. The epsilon is
+  // given back if the delta cannot be reserved.
+  bool ReserveLocal(double epsilon, double delta) {
+    if (!Reserve(&remaining_epsilon_, epsilon, total_epsilon_)) {
+      return false;
+    }
+    if (!Reserve(&remaining_delta_, delta, total_delta_)) {
+      Refund(&remaining_epsilon_, epsilon, total_epsilon_);
+      return false;
+    }
+    return true;
+  }
+
+  void RefundLocal(double epsilon, double delta) {
+    Refund(&remaining_epsilon_, epsilon, total_epsilon_);
+    Refund(&remaining_delta_, delta, total_delta_);
+  }
+
+  const double total_epsilon_;
+  const double total_delta_;
+  std::atomic<double> remaining_epsilon_;
+  std::atomic<double> remaining_delta_;
+  const std::shared_ptr<PrivacyBudgetAccountant> parent_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PRIVACY_BUDGET_ACCOUNTANT_H_
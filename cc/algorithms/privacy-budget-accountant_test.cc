@@ -0,0 +1,180 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/privacy-budget-accountant.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::DoubleNear;
+using ::testing::HasSubstr;
+
+std::shared_ptr<PrivacyBudgetAccountant> MakeAccountant(double epsilon,
+                                                        double delta = 0) {
+  return PrivacyBudgetAccountant::Create(epsilon, delta).ValueOrDie();
+}
+
+TEST(PrivacyBudgetAccountantTest, InvalidBudgetFailsCreate) {
+  EXPECT_THAT(PrivacyBudgetAccountant::Create(0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon must be finite and positive")));
+  EXPECT_THAT(PrivacyBudgetAccountant::Create(1, 2),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Delta must be in the inclusive interval")));
+  EXPECT_THAT(MakeAccountant(1)->CreateSubBudget(-1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(PrivacyBudgetAccountantTest, ConsumesUntilExhausted) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant = MakeAccountant(1, 1e-5);
+  EXPECT_OK(accountant->Consume(.6, 1e-6));
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.4, 1e-12));
+  EXPECT_THAT(accountant->RemainingDelta(), DoubleNear(9e-6, 1e-18));
+  EXPECT_THAT(accountant->Consume(.5),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("Privacy budget exhausted")));
+  // Failing on delta consumes no epsilon.
+  EXPECT_THAT(accountant->Consume(.1, 1e-4),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.4, 1e-12));
+  EXPECT_THAT(accountant->Consume(-1),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(PrivacyBudgetAccountantTest, EqualSharesConsumeWholeBudget) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant = MakeAccountant(1);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_OK(accountant->Consume(.1));
+  }
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(0, 1e-12));
+  EXPECT_THAT(accountant->Consume(.1),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(PrivacyBudgetAccountantTest, SubBudgetConsumesFromParent) {
+  std::shared_ptr<PrivacyBudgetAccountant> parent = MakeAccountant(1);
+  std::shared_ptr<PrivacyBudgetAccountant> first =
+      parent->CreateSubBudget(.6).ValueOrDie();
+  std::shared_ptr<PrivacyBudgetAccountant> second =
+      parent->CreateSubBudget(.6).ValueOrDie();
+  EXPECT_OK(first->Consume(.5));
+  EXPECT_THAT(parent->RemainingEpsilon(), DoubleNear(.5, 1e-12));
+  // Limited by the sub-budget.
+  EXPECT_THAT(first->Consume(.2),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  // Limited by the parent, and rolled back in the sub-budget.
+  EXPECT_THAT(second->Consume(.55),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_THAT(second->RemainingEpsilon(), DoubleNear(.6, 1e-12));
+  EXPECT_OK(second->Consume(.5));
+  EXPECT_THAT(parent->RemainingEpsilon(), DoubleNear(0, 1e-12));
+}
+
+TEST(PrivacyBudgetAccountantTest, ConcurrentConsumptionNeverOverspends) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant = MakeAccountant(100);
+  std::atomic<int> num_consumed(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&accountant, &num_consumed] {
+      for (int j = 0; j < 1000; ++j) {
+        if (accountant->Consume(.25).ok()) {
+          ++num_consumed;
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_consumed, 400);
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(0, 1e-12));
+}
+
+TEST(PrivacyBudgetAccountantTest, BoundAlgorithmsShareBudget) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant = MakeAccountant(1.5);
+  std::unique_ptr<Count<double>> first = Count<double>::Builder()
+                                             .SetEpsilon(1)
+                                             .SetPrivacyBudgetAccountant(
+                                                 accountant)
+                                             .Build()
+                                             .ValueOrDie();
+  std::unique_ptr<Count<double>> second = Count<double>::Builder()
+                                              .SetEpsilon(1)
+                                              .SetPrivacyBudgetAccountant(
+                                                  accountant)
+                                              .Build()
+                                              .ValueOrDie();
+  EXPECT_OK(first->PartialResult());
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(.5, 1e-12));
+  EXPECT_OK(second->PartialResult(.5));
+  // The accountant is exhausted, so the remaining budget of second cannot be
+  // used, and is kept.
+  EXPECT_THAT(second->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("Privacy budget exhausted")));
+  EXPECT_THAT(second->RemainingPrivacyBudget(), DoubleNear(.5, 1e-12));
+  EXPECT_THAT(second->PartialResultValue(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+TEST(PrivacyBudgetAccountantTest, ConsumesDeltaOfAlgorithm) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant =
+      MakeAccountant(10, 1e-5);
+  std::unique_ptr<Count<double>> count =
+      Count<double>::Builder()
+          .SetEpsilon(1)
+          .SetDelta(1e-6)
+          .SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>())
+          .SetPrivacyBudgetAccountant(accountant)
+          .Build()
+          .ValueOrDie();
+  EXPECT_OK(count->PartialResult(.5));
+  EXPECT_THAT(accountant->RemainingEpsilon(), DoubleNear(9.5, 1e-12));
+  EXPECT_THAT(accountant->RemainingDelta(), DoubleNear(9.5e-6, 1e-18));
+}
+
+TEST(PrivacyBudgetAccountantTest, NewInstanceSharesAccountant) {
+  std::shared_ptr<PrivacyBudgetAccountant> accountant = MakeAccountant(1);
+  std::unique_ptr<BoundedSum<double>> sum = BoundedSum<double>::Builder()
+                                                .SetEpsilon(1)
+                                                .SetLower(0)
+                                                .SetUpper(1)
+                                                .SetPrivacyBudgetAccountant(
+                                                    accountant)
+                                                .Build()
+                                                .ValueOrDie();
+  std::unique_ptr<Algorithm<double>> instance =
+      sum->NewInstance().ValueOrDie();
+  EXPECT_EQ(instance->GetPrivacyBudgetAccountant(), accountant);
+  EXPECT_OK(instance->PartialResult());
+  EXPECT_THAT(sum->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+}
+
+}  // namespace
+}  // namespace differential_privacy
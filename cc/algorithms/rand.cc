@@ -16,14 +16,22 @@
 
 #include "algorithms/rand.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <limits>
+#include <thread>  // NOLINT(build/c++11)
 
 #include "base/logging.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/mutex.h"
+#include "algorithms/metrics.h"
+#include "openssl/crypto.h"
+#include "openssl/evp.h"
 #include "openssl/rand.h"
 
 namespace differential_privacy {
@@ -38,6 +46,19 @@ int CountLeadingZeros64Slow(uint64_t n) {
   return "\4\3\2\2\1\1\1\1\0\0\0\0\0\0\0"[n] + zeroes;
 }
 
+// Uses the compiler builtin, which lowers to a single lzcnt/bsr instruction
+// where available. The builtin is undefined for 0, so that case is handled
+// explicitly.
+inline int CountLeadingZeros64(uint64_t n) {
+#if defined(__GNUC__) || defined(__clang__)
+  static_assert(sizeof(unsigned long long) == sizeof(uint64_t),  // NOLINT
+                "__builtin_clzll does not take 64-bit integers.");
+  return n == 0 ? 64 : __builtin_clzll(n);
+#else
+  return CountLeadingZeros64Slow(n);
+#endif
+}
+
 // We usually expect DBL_MANT_DIG to be 53.
 static_assert(DBL_MANT_DIG < 64,
               "Double mantissa must have less than 64 bits.");
@@ -59,7 +80,7 @@ double UniformDouble() {
   uint64_t j = uint_64_number >> kMantDigits;
 
   // exponent is the number of leading zeros in the first 11 bits plus one.
-  uint64_t exponent = CountLeadingZeros64Slow(j) - kMantDigits + 1;
+  uint64_t exponent = CountLeadingZeros64(j) - kMantDigits + 1;
 
   // Extra geometric sampling is needed only when the leading 11 bits are all 0.
   if (j == 0) {
@@ -84,25 +105,356 @@ uint64_t Geometric() {
   uint64_t r = 0;
   while (r == 0 && result < 1023) {
     r = SecureURBG::GetSingleton()();
-    result += CountLeadingZeros64Slow(r);
+    result += CountLeadingZeros64(r);
   }
   return result;
 }
 
-SecureURBG::result_type SecureURBG::operator()() {
-  absl::WriterMutexLock lock(&mutex_);
-  if (current_index_ + sizeof(result_type) > kBufferSize) {
-    RefreshBuffer();
+bool UniformBool() {
+  // Bits of the current word that have not been handed out yet, and how many
+  // of them remain. Only the low num_bits bits of bits are unused.
+  thread_local uint64_t bits = 0;
+  thread_local int num_bits = 0;
+  if (num_bits == 0) {
+    bits = SecureURBG::GetSingleton()();
+    num_bits = 64;
   }
-  int old_index = current_index_;
-  current_index_ += sizeof(result_type);
-  result_type result;
-  std::memcpy(&result, buffer_ + old_index, sizeof(result_type));
+  bool result = bits & 1;
+  bits >>= 1;
+  --num_bits;
   return result;
 }
 
-void SecureURBG::RefreshBuffer() {
-  RAND_bytes(buffer_, kBufferSize);
-  current_index_ = 0;
+namespace {
+
+class RandBytesGenerator : public RandomBytesGenerator {
+ public:
+  void Generate(uint8_t* out, int size) override { RAND_bytes(out, size); }
+};
+
+class AesCtrDrbgGenerator : public RandomBytesGenerator {
+ public:
+  AesCtrDrbgGenerator() : ctx_(EVP_CIPHER_CTX_new()) {
+    CHECK(ctx_ != nullptr);
+    Reseed();
+  }
+
+  ~AesCtrDrbgGenerator() override { EVP_CIPHER_CTX_free(ctx_); }
+
+  void Generate(uint8_t* out, int size) override {
+    while (size > 0) {
+      if (bytes_since_reseed_ >= kAesCtrDrbgReseedInterval) {
+        Reseed();
+      }
+      int chunk = static_cast<int>(std::min<int64_t>(
+          size, kAesCtrDrbgReseedInterval - bytes_since_reseed_));
+      // Encrypting zeros in counter mode yields the raw keystream.
+      std::memset(out, 0, chunk);
+      int out_size = 0;
+      CHECK_EQ(EVP_EncryptUpdate(ctx_, out, &out_size, out, chunk), 1);
+      DCHECK_EQ(out_size, chunk);
+      out += chunk;
+      size -= chunk;
+      bytes_since_reseed_ += chunk;
+    }
+  }
+
+ private:
+  void Reseed() {
+    uint8_t key[32];
+    uint8_t iv[16];
+    CHECK_EQ(RAND_bytes(key, sizeof(key)), 1);
+    CHECK_EQ(RAND_bytes(iv, sizeof(iv)), 1);
+    CHECK_EQ(
+        EVP_EncryptInit_ex(ctx_, EVP_aes_256_ctr(), nullptr, key, iv), 1);
+    OPENSSL_cleanse(key, sizeof(key));
+    bytes_since_reseed_ = 0;
+  }
+
+  EVP_CIPHER_CTX* ctx_;
+  int64_t bytes_since_reseed_ = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<RandomBytesGenerator> MakeRandBytesGenerator() {
+  return absl::make_unique<RandBytesGenerator>();
+}
+
+std::unique_ptr<RandomBytesGenerator> MakeAesCtrDrbgGenerator() {
+  return absl::make_unique<AesCtrDrbgGenerator>();
+}
+
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM
+namespace {
+
+std::atomic<uint64_t> insecure_fast_random_seed{0};
+std::atomic<uint64_t> insecure_fast_random_stream{0};
+
+// The SplitMix64 generator, which expands seeds into xoshiro states.
+uint64_t SplitMix64(uint64_t* state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+// xoshiro256** by Blackman and Vigna.
+class InsecureFastGenerator : public RandomBytesGenerator {
+ public:
+  InsecureFastGenerator(uint64_t seed, uint64_t stream) {
+    // Mix the stream into the seed rather than adding it, since consecutive
+    // SplitMix64 states would give overlapping xoshiro states.
+    uint64_t mixed_stream = stream;
+    uint64_t state = seed ^ SplitMix64(&mixed_stream);
+    for (uint64_t& s : s_) {
+      s = SplitMix64(&state);
+    }
+  }
+
+  void Generate(uint8_t* out, int size) override {
+    for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t)) {
+      const uint64_t next = Next();
+      std::memcpy(out, &next, sizeof(next));
+      out += sizeof(next);
+    }
+    if (size > 0) {
+      const uint64_t next = Next();
+      std::memcpy(out, &next, size);
+    }
+  }
+
+ private:
+  static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t Next() {
+    const uint64_t result = Rotl(s_[1] * 5, 7) * 9;
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = Rotl(s_[3], 45);
+    return result;
+  }
+
+  uint64_t s_[4];
+};
+
+}  // namespace
+
+std::unique_ptr<RandomBytesGenerator> MakeInsecureFastGenerator() {
+  static const bool kWarned = [] {
+    LOG(WARNING) << "Drawing noise from an insecure generator. The results "
+                    "are not differentially private.";
+    return true;
+  }();
+  (void)kWarned;
+  return absl::make_unique<InsecureFastGenerator>(
+      insecure_fast_random_seed.load(std::memory_order_relaxed),
+      insecure_fast_random_stream.fetch_add(1, std::memory_order_relaxed));
+}
+
+void SetInsecureFastRandomSeed(uint64_t seed) {
+  insecure_fast_random_seed.store(seed, std::memory_order_relaxed);
+  insecure_fast_random_stream.store(0, std::memory_order_relaxed);
+}
+#endif
+
+class SecureURBG::Buffer {
+ public:
+  result_type Next() {
+    if (Exhausted()) {
+      Refill();
+    }
+    result_type result;
+    std::memcpy(&result, bytes_.get() + current_index_, sizeof(result_type));
+    current_index_ += sizeof(result_type);
+    metrics::Add(metrics::Counter::kRandomBytesConsumed, sizeof(result_type));
+    return result;
+  }
+
+  // Returns true if the next draw needs to refill the buffer first.
+  bool Exhausted() const {
+    return current_index_ + sizeof(result_type) > size_;
+  }
+
+  // Picks up changes to the generator factory and buffer size, then fills the
+  // buffer with new random bytes.
+  void Refill() {
+    GeneratorFactory factory = GetGeneratorFactory();
+    if (generator_ == nullptr || factory != factory_) {
+      generator_ = factory();
+      factory_ = factory;
+    }
+    int size = GetBufferSize();
+    if (size != size_) {
+      bytes_ = absl::make_unique<uint8_t[]>(size);
+      size_ = size;
+    }
+    generator_->Generate(bytes_.get(), size_);
+    current_index_ = 0;
+    metrics::Add(metrics::Counter::kRandomBufferRefills);
+    metrics::Add(metrics::Counter::kRandomBytesGenerated, size_);
+  }
+
+ private:
+  std::unique_ptr<uint8_t[]> bytes_;
+  int size_ = 0;
+  // The current index in the buffer.
+  int current_index_ = 0;
+  GeneratorFactory factory_ = nullptr;
+  std::unique_ptr<RandomBytesGenerator> generator_;
+};
+
+// Drawing threads consume the current buffer and, when it is exhausted, swap it
+// for a filled one from ready_. The exhausted buffer goes to empty_, from where
+// the helper thread takes it, refills it without holding the lock, and returns
+// it to ready_. If no filled buffer is ready, there is no current buffer until
+// the helper thread catches up, and drawing threads draw from a buffer of
+// their own, which they refill without holding the lock. Each buffer owns its
+// generator, so refilling one buffer never shares state with another.
+class SecureURBG::RefillPool {
+ public:
+  explicit RefillPool(int num_buffers) : current_(absl::make_unique<Buffer>()) {
+    current_->Refill();
+    for (int i = 1; i < num_buffers; ++i) {
+      empty_.push_back(absl::make_unique<Buffer>());
+    }
+    // The pool lives as long as the singleton, i.e. until the process exits.
+    std::thread(&RefillPool::RefillLoop, this).detach();
+  }
+
+  result_type Next() ABSL_LOCKS_EXCLUDED(mutex_) {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (current_ != nullptr && current_->Exhausted()) {
+        empty_.push_back(std::move(current_));
+      }
+      if (current_ == nullptr && !ready_.empty()) {
+        ++stats_.buffers_consumed;
+        current_ = std::move(ready_.front());
+        ready_.pop_front();
+      }
+      if (current_ != nullptr) {
+        return current_->Next();
+      }
+    }
+    // The pool ran dry. Draw from a buffer of the calling thread instead, and
+    // refill it without holding the lock, so that the other drawing threads
+    // do not wait for the refill.
+    thread_local Buffer underflow_buffer;
+    if (underflow_buffer.Exhausted()) {
+      underflow_buffer.Refill();
+      absl::MutexLock lock(&mutex_);
+      ++stats_.buffers_consumed;
+      ++stats_.underflows;
+    }
+    return underflow_buffer.Next();
+  }
+
+  RefillPoolStats Stats() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return stats_;
+  }
+
+ private:
+  void RefillLoop() ABSL_LOCKS_EXCLUDED(mutex_) {
+    while (true) {
+      std::unique_ptr<Buffer> buffer;
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(
+            +[](std::deque<std::unique_ptr<Buffer>>* empty) {
+              return !empty->empty();
+            },
+            &empty_));
+        buffer = std::move(empty_.front());
+        empty_.pop_front();
+      }
+      buffer->Refill();
+      absl::MutexLock lock(&mutex_);
+      ready_.push_back(std::move(buffer));
+    }
+  }
+
+  absl::Mutex mutex_;
+  // Null while no filled buffer is ready.
+  std::unique_ptr<Buffer> current_ ABSL_GUARDED_BY(mutex_);
+  std::deque<std::unique_ptr<Buffer>> ready_ ABSL_GUARDED_BY(mutex_);
+  std::deque<std::unique_ptr<Buffer>> empty_ ABSL_GUARDED_BY(mutex_);
+  RefillPoolStats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+std::atomic<SecureURBG::BufferMode> SecureURBG::buffer_mode_{
+    SecureURBG::BufferMode::kShared};
+std::atomic<SecureURBG::GeneratorFactory> SecureURBG::generator_factory_{
+    &MakeRandBytesGenerator};
+std::atomic<int> SecureURBG::buffer_size_{SecureURBG::kDefaultBufferSize};
+std::atomic<int> SecureURBG::refill_pool_size_{
+    SecureURBG::kDefaultRefillPoolSize};
+std::atomic<bool> SecureURBG::refill_pool_started_{false};
+
+SecureURBG::SecureURBG() : shared_buffer_(absl::make_unique<Buffer>()) {}
+
+SecureURBG::~SecureURBG() = default;
+
+absl::Status SecureURBG::SetBufferSize(int buffer_size) {
+  if (buffer_size <= 0 || buffer_size % sizeof(result_type) != 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Buffer size must be a positive multiple of ", sizeof(result_type),
+        ", but is ", buffer_size, "."));
+  }
+  buffer_size_.store(buffer_size, std::memory_order_relaxed);
+  return absl::OkStatus();
+}
+
+absl::Status SecureURBG::SetRefillPoolSize(int num_buffers) {
+  if (num_buffers <= 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Refill pool size must be positive, but is ", num_buffers, "."));
+  }
+  if (refill_pool_started_.load(std::memory_order_relaxed)) {
+    return absl::FailedPreconditionError(
+        "Refill pool size cannot be changed after the pool has been used.");
+  }
+  refill_pool_size_.store(num_buffers, std::memory_order_relaxed);
+  return absl::OkStatus();
+}
+
+SecureURBG::RefillPoolStats SecureURBG::GetRefillPoolStats() {
+  if (!refill_pool_started_.load(std::memory_order_relaxed)) {
+    return RefillPoolStats();
+  }
+  return GetRefillPool().Stats();
+}
+
+SecureURBG::result_type SecureURBG::operator()() {
+  switch (GetBufferMode()) {
+    case BufferMode::kThreadLocal:
+      return ThreadLocalDraw();
+    case BufferMode::kBackgroundRefill:
+      return GetRefillPool().Next();
+    case BufferMode::kShared:
+      break;
+  }
+  absl::WriterMutexLock lock(&mutex_);
+  return shared_buffer_->Next();
+}
+
+SecureURBG::RefillPool& SecureURBG::GetRefillPool() {
+  static RefillPool* const kPool = [] {
+    refill_pool_started_.store(true, std::memory_order_relaxed);
+    return new RefillPool(GetRefillPoolSize());
+  }();
+  return *kPool;
+}
+
+SecureURBG::result_type SecureURBG::ThreadLocalDraw() {
+  // The buffer memory is allocated on first use, so threads that never draw
+  // random numbers do not pay for it.
+  thread_local Buffer buffer;
+  return buffer.Next();
 }
 }  // namespace differential_privacy
@@ -17,11 +17,13 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_RAND_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_RAND_H_
 
+#include <atomic>
 #include <cstdint>
 #include <limits>
 #include <memory>
 
 #include <cstdint>
+#include "absl/status/status.h"
 #include "absl/synchronization/mutex.h"
 
 namespace differential_privacy {
@@ -35,13 +37,141 @@ double UniformDouble();
 // parameter 0.5. Will not exceed 1025.
 uint64_t Geometric();
 
+// Returns a uniformly random bit. Each 64-bit draw from SecureURBG is split
+// into 64 bits that are returned by successive calls on the same thread, so
+// fair coin flips cost a shift rather than a full draw.
+bool UniformBool();
+
+// Source of cryptographically secure random bytes from which SecureURBG fills
+// its buffers. Every buffer owns a separate generator, so implementations do
+// not need to be thread-safe.
+class RandomBytesGenerator {
+ public:
+  virtual ~RandomBytesGenerator() = default;
+
+  // Fills out with size random bytes.
+  virtual void Generate(uint8_t* out, int size) = 0;
+};
+
+// Returns a generator that draws every byte from RAND_bytes. This is the
+// default generator of SecureURBG.
+std::unique_ptr<RandomBytesGenerator> MakeRandBytesGenerator();
+
+// Returns a generator that produces the keystream of AES-256 in counter mode,
+// keyed with a fresh key and IV from RAND_bytes every
+// kAesCtrDrbgReseedInterval bytes. This only calls into RAND_bytes at reseed
+// time and uses the hardware AES instructions when the CPU provides them, so
+// it is considerably cheaper per byte than MakeRandBytesGenerator.
+std::unique_ptr<RandomBytesGenerator> MakeAesCtrDrbgGenerator();
+
+// The number of bytes an AES-CTR generator produces before it is rekeyed.
+constexpr int64_t kAesCtrDrbgReseedInterval = int64_t{1} << 24;
+
+// The insecure fast generator is compiled out unless the library is built with
+// --define dp_insecure_fast_random=enabled, which defines
+// DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM. Release builds must not set
+// it: without the define, the functions below do not exist, so no code can
+// install the generator.
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM
+constexpr bool kInsecureFastRandomEnabled = true;
+#else
+constexpr bool kInsecureFastRandomEnabled = false;
+#endif
+
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM
+// NOT CRYPTOGRAPHICALLY SECURE. Returns a generator that produces the output of
+// xoshiro256**, which is predictable from its output and provides no privacy.
+// It is meant for benchmarks, load tests and stochastic testers, to measure
+// the cost of the algorithms apart from the cost of entropy and to make runs
+// reproducible. Install it for all samplers with
+// SecureURBG::SetGeneratorFactory(&MakeInsecureFastGenerator).
+//
+// The n-th generator created since the last call of SetInsecureFastRandomSeed
+// is seeded from the seed and n. In kShared mode, a process that installs the
+// generator and sets the seed before its first draw therefore draws the same
+// sequence in every run.
+std::unique_ptr<RandomBytesGenerator> MakeInsecureFastGenerator();
+
+// Sets the seed of the generators subsequently created by
+// MakeInsecureFastGenerator. The default seed is 0.
+void SetInsecureFastRandomSeed(uint64_t seed);
+#endif
+
 // Exposed for testing
 class SecureURBG {
  public:
+  // Controls where random bytes are drawn from. In kShared mode, all threads
+  // draw from a single buffer guarded by a mutex. In kThreadLocal mode, each
+  // thread keeps its own buffer of generator output and draws take no lock,
+  // so that throughput scales with the number of threads. In
+  // kBackgroundRefill mode, all threads draw from a pool of buffers that a
+  // helper thread keeps filled, so that draws do not wait for the generator
+  // unless the pool runs dry. All modes produce output of the same quality;
+  // only the buffering differs.
+  enum class BufferMode { kShared, kThreadLocal, kBackgroundRefill };
+
+  // Counters of the kBackgroundRefill pool.
+  struct RefillPoolStats {
+    // The number of buffers handed from the pool to drawing threads.
+    int64_t buffers_consumed = 0;
+    // The number of times a drawing thread found no filled buffer in the pool
+    // and had to fill one itself. A large proportion of underflows means that
+    // the pool is too small for the rate of draws.
+    int64_t underflows = 0;
+  };
+
+  static constexpr int kDefaultRefillPoolSize = 4;
+
+  // Creates the generator used to fill a buffer.
+  using GeneratorFactory = std::unique_ptr<RandomBytesGenerator> (*)();
+
+  static constexpr int kDefaultBufferSize = 65536;
+
   static SecureURBG& GetSingleton() {
     static auto* kInstance = new SecureURBG;
     return *kInstance;
   }
+
+  // Sets the buffer mode for all subsequent draws from the singleton. The
+  // default is kShared. Safe to call concurrently with draws.
+  static void SetBufferMode(BufferMode mode) {
+    buffer_mode_.store(mode, std::memory_order_relaxed);
+  }
+  static BufferMode GetBufferMode() {
+    return buffer_mode_.load(std::memory_order_relaxed);
+  }
+
+  // Sets the generator used to fill buffers, e.g. MakeAesCtrDrbgGenerator. The
+  // default is MakeRandBytesGenerator. Each buffer switches to the new
+  // generator the next time it is refilled. Safe to call concurrently with
+  // draws.
+  static void SetGeneratorFactory(GeneratorFactory factory) {
+    generator_factory_.store(factory, std::memory_order_relaxed);
+  }
+  static GeneratorFactory GetGeneratorFactory() {
+    return generator_factory_.load(std::memory_order_relaxed);
+  }
+
+  // Sets the number of bytes requested from the generator per refill. Must be
+  // a positive multiple of 8. Takes effect for each buffer the next time it is
+  // refilled. Safe to call concurrently with draws.
+  static absl::Status SetBufferSize(int buffer_size);
+  static int GetBufferSize() {
+    return buffer_size_.load(std::memory_order_relaxed);
+  }
+
+  // Sets the number of buffers in the kBackgroundRefill pool. Must be
+  // positive, and can only be changed before the pool is first used, i.e.
+  // before the first draw in kBackgroundRefill mode.
+  static absl::Status SetRefillPoolSize(int num_buffers);
+  static int GetRefillPoolSize() {
+    return refill_pool_size_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the counters of the kBackgroundRefill pool. All counters are zero
+  // if the pool has not been used.
+  static RefillPoolStats GetRefillPoolStats();
+
   using result_type = uint64_t;
   static constexpr result_type(min)() {
     return (std::numeric_limits<result_type>::min)();
@@ -52,15 +182,27 @@ class SecureURBG {
   result_type operator()() ABSL_LOCKS_EXCLUDED(mutex_);
 
  private:
-  SecureURBG() { buffer_ = new uint8_t[kBufferSize]; }
-  ~SecureURBG() { delete[] buffer_; }
-  // Refresh the cache with new random bytes.
-  void RefreshBuffer() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
-
-  static constexpr int kBufferSize = 65536;
-  // The current index in the cache.
-  int current_index_ ABSL_GUARDED_BY(mutex_) = kBufferSize;
-  uint8_t* buffer_ ABSL_GUARDED_BY(mutex_);
+  // A buffer of random bytes together with the generator that fills it.
+  class Buffer;
+  // The buffers used in kBackgroundRefill mode, and the thread filling them.
+  class RefillPool;
+
+  SecureURBG();
+  ~SecureURBG();
+
+  // Draws from the buffer owned by the calling thread. Takes no lock.
+  static result_type ThreadLocalDraw();
+
+  // Returns the pool used in kBackgroundRefill mode, starting it on first use.
+  static RefillPool& GetRefillPool();
+
+  static std::atomic<BufferMode> buffer_mode_;
+  static std::atomic<GeneratorFactory> generator_factory_;
+  static std::atomic<int> buffer_size_;
+  static std::atomic<int> refill_pool_size_;
+  static std::atomic<bool> refill_pool_started_;
+
+  std::unique_ptr<Buffer> shared_buffer_ ABSL_GUARDED_BY(mutex_);
   absl::Mutex mutex_;
 };
 }  // namespace differential_privacy
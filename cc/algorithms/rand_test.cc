@@ -17,7 +17,10 @@
 #include "algorithms/rand.h"
 
 #include <numeric>
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
 
+#include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
@@ -62,5 +65,193 @@ TEST_F(RandTest, Geometric) {
   RunTest(Geometric, /*expected_mean=*/2, /*expected_var=*/2);
 }
 
+TEST_F(RandTest, UniformBool) {
+  RunTest(UniformBool, /*expected_mean=*/0.5, /*expected_var=*/0.25);
+}
+
+// Consecutive bits come from the same word, so check that they are not
+// correlated with their neighbours.
+TEST_F(RandTest, UniformBoolNeighboursUncorrelated) {
+  int num_equal = 0;
+  bool previous = UniformBool();
+  for (int i = 0; i < sample_size; ++i) {
+    bool current = UniformBool();
+    if (current == previous) ++num_equal;
+    previous = current;
+  }
+  EXPECT_NEAR(static_cast<double>(num_equal) / sample_size, 0.5,
+              tolerance * 0.5);
+}
+
+TEST_F(RandTest, ThreadLocalUniformDouble) {
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kThreadLocal);
+  RunTest(UniformDouble, /*expected_mean=*/0.5, /*expected_var=*/1.0 / 12.0);
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+}
+
+TEST_F(RandTest, ThreadLocalGeometric) {
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kThreadLocal);
+  RunTest(Geometric, /*expected_mean=*/2, /*expected_var=*/2);
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+}
+
+// Each thread owns its own buffer, so no two threads should ever observe the
+// same sequence of draws.
+TEST_F(RandTest, ThreadLocalBuffersAreIndependent) {
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kThreadLocal);
+  const int kNumThreads = 4;
+  const int kDrawsPerThread = 20000;
+  std::vector<std::vector<uint64_t>> draws(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&draws, t]() {
+      for (int i = 0; i < kDrawsPerThread; ++i) {
+        draws[t].push_back(SecureURBG::GetSingleton()());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+
+  std::set<uint64_t> unique;
+  for (const std::vector<uint64_t>& d : draws) {
+    unique.insert(d.begin(), d.end());
+  }
+  EXPECT_EQ(unique.size(), kNumThreads * kDrawsPerThread);
+}
+
+TEST_F(RandTest, DefaultBufferModeIsShared) {
+  EXPECT_EQ(SecureURBG::GetBufferMode(), SecureURBG::BufferMode::kShared);
+}
+
+TEST_F(RandTest, BackgroundRefillPool) {
+  EXPECT_EQ(SecureURBG::GetRefillPoolStats().buffers_consumed, 0);
+  EXPECT_THAT(SecureURBG::SetRefillPoolSize(0),
+              base::testing::StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_OK(SecureURBG::SetRefillPoolSize(2));
+
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kBackgroundRefill);
+  RunTest(UniformDouble, /*expected_mean=*/0.5, /*expected_var=*/1.0 / 12.0);
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+
+  // 1000000 draws of 8 bytes span more than 100 buffers of the default size.
+  SecureURBG::RefillPoolStats stats = SecureURBG::GetRefillPoolStats();
+  EXPECT_GE(stats.buffers_consumed, 100);
+  EXPECT_LE(stats.underflows, stats.buffers_consumed);
+  EXPECT_THAT(
+      SecureURBG::SetRefillPoolSize(4),
+      base::testing::StatusIs(absl::StatusCode::kFailedPrecondition));
+  EXPECT_EQ(SecureURBG::GetRefillPoolSize(), 2);
+}
+
+TEST_F(RandTest, BackgroundRefillMultipleThreads) {
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kBackgroundRefill);
+  const int kNumThreads = 4;
+  const int kDrawsPerThread = 20000;
+  std::vector<std::vector<uint64_t>> draws(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&draws, t]() {
+      for (int i = 0; i < kDrawsPerThread; ++i) {
+        draws[t].push_back(SecureURBG::GetSingleton()());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+
+  std::set<uint64_t> unique;
+  for (const std::vector<uint64_t>& d : draws) {
+    unique.insert(d.begin(), d.end());
+  }
+  EXPECT_EQ(unique.size(), kNumThreads * kDrawsPerThread);
+}
+
+TEST_F(RandTest, AesCtrDrbgUniformDouble) {
+  SecureURBG::SetGeneratorFactory(&MakeAesCtrDrbgGenerator);
+  RunTest(UniformDouble, /*expected_mean=*/0.5, /*expected_var=*/1.0 / 12.0);
+  SecureURBG::SetGeneratorFactory(&MakeRandBytesGenerator);
+}
+
+TEST_F(RandTest, AesCtrDrbgThreadLocalGeometric) {
+  SecureURBG::SetGeneratorFactory(&MakeAesCtrDrbgGenerator);
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kThreadLocal);
+  RunTest(Geometric, /*expected_mean=*/2, /*expected_var=*/2);
+  SecureURBG::SetBufferMode(SecureURBG::BufferMode::kShared);
+  SecureURBG::SetGeneratorFactory(&MakeRandBytesGenerator);
+}
+
+// Requests that span a reseed must still be filled completely, and the bytes
+// on either side of the reseed must not repeat.
+TEST_F(RandTest, AesCtrDrbgFillsAcrossReseed) {
+  std::unique_ptr<RandomBytesGenerator> generator = MakeAesCtrDrbgGenerator();
+  const int kSize = 1 << 20;
+  std::vector<uint8_t> bytes(kSize);
+  for (int64_t generated = 0; generated < kAesCtrDrbgReseedInterval;
+       generated += kSize) {
+    generator->Generate(bytes.data(), kSize);
+  }
+  std::vector<uint64_t> words(kSize / sizeof(uint64_t), 0);
+  generator->Generate(reinterpret_cast<uint8_t*>(words.data()), kSize);
+  std::set<uint64_t> unique(words.begin(), words.end());
+  EXPECT_EQ(unique.size(), words.size());
+}
+
+TEST_F(RandTest, SetBufferSize) {
+  EXPECT_EQ(SecureURBG::GetBufferSize(), SecureURBG::kDefaultBufferSize);
+  EXPECT_OK(SecureURBG::SetBufferSize(64));
+  EXPECT_EQ(SecureURBG::GetBufferSize(), 64);
+  RunTest(UniformDouble, /*expected_mean=*/0.5, /*expected_var=*/1.0 / 12.0);
+  EXPECT_OK(SecureURBG::SetBufferSize(SecureURBG::kDefaultBufferSize));
+}
+
+TEST_F(RandTest, SetBufferSizeFailsForInvalidSizes) {
+  EXPECT_THAT(SecureURBG::SetBufferSize(0),
+              base::testing::StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(SecureURBG::SetBufferSize(-8),
+              base::testing::StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(SecureURBG::SetBufferSize(12),
+              base::testing::StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(SecureURBG::GetBufferSize(), SecureURBG::kDefaultBufferSize);
+}
+
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_INSECURE_FAST_RANDOM
+TEST_F(RandTest, InsecureFastGeneratorIsReproducible) {
+  // Sizes that are not multiples of 8 use part of the last draw.
+  const int kSize = 61;
+  auto generate = [kSize](RandomBytesGenerator& generator) {
+    std::vector<uint8_t> bytes(kSize);
+    generator.Generate(bytes.data(), kSize);
+    return bytes;
+  };
+  SetInsecureFastRandomSeed(42);
+  std::unique_ptr<RandomBytesGenerator> first = MakeInsecureFastGenerator();
+  std::unique_ptr<RandomBytesGenerator> second = MakeInsecureFastGenerator();
+  SetInsecureFastRandomSeed(42);
+  std::unique_ptr<RandomBytesGenerator> first_again =
+      MakeInsecureFastGenerator();
+  SetInsecureFastRandomSeed(43);
+  std::unique_ptr<RandomBytesGenerator> other_seed =
+      MakeInsecureFastGenerator();
+
+  const std::vector<uint8_t> bytes = generate(*first);
+  EXPECT_EQ(bytes, generate(*first_again));
+  EXPECT_NE(bytes, generate(*second));
+  EXPECT_NE(bytes, generate(*other_seed));
+  EXPECT_NE(bytes, generate(*first));
+}
+
+TEST_F(RandTest, InsecureFastGeneratorUniformDouble) {
+  SecureURBG::SetGeneratorFactory(&MakeInsecureFastGenerator);
+  RunTest(UniformDouble, /*expected_mean=*/0.5, /*expected_var=*/1.0 / 12.0);
+  RunTest(Geometric, /*expected_mean=*/2, /*expected_var=*/2);
+  SecureURBG::SetGeneratorFactory(&MakeRandBytesGenerator);
+}
+#endif
+
 }  // namespace
 }  // namespace differential_privacy
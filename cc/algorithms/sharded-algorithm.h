@@ -0,0 +1,196 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_ALGORITHM_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_ALGORITHM_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "absl/base/optimization.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "base/logging.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+namespace internal {
+
+// Returns a small integer that identifies the calling thread. Threads are
+// numbered in the order in which they first call this function.
+inline int64_t ThreadShardIndex() {
+  static std::atomic<int64_t> next_index(0);
+  thread_local const int64_t index = next_index.fetch_add(1);
+  return index;
+}
+
+}  // namespace internal
+
+// ShardedAlgorithm allows many threads to add entries to a single aggregation
+// concurrently. It wraps one algorithm per shard, all built by the same
+// factory, and each thread adds its entries to the shard picked by its thread
+// index. Each shard has its own lock and is aligned to a cache line, so that
+// threads on different shards do not contend. Use as many shards as threads
+// for the best scaling; threads that map to the same shard still produce
+// correct results.
+//
+// Serialize(), Merge() and result generation first combine the shards in
+// place into the first shard with Algorithm::MergeFrom(), which skips the
+// Summary round trip for algorithms that override it. These calls lock all
+// shards and should not be called concurrently with adding entries if the
+// result must include all entries added so far.
+template <typename T>
+class ShardedAlgorithm : public Algorithm<T> {
+ public:
+  using Factory =
+      std::function<base::StatusOr<std::unique_ptr<Algorithm<T>>>()>;
+
+  // Builds num_shards algorithms with factory. The factory must always build
+  // the same algorithm type with identical parameters.
+  static base::StatusOr<std::unique_ptr<ShardedAlgorithm<T>>> Create(
+      int num_shards, const Factory& factory) {
+    RETURN_IF_ERROR(ValidateIsPositive(num_shards, "Number of shards"));
+    auto shards = absl::make_unique<Shard[]>(num_shards);
+    for (int i = 0; i < num_shards; ++i) {
+      ASSIGN_OR_RETURN(shards[i].algorithm, factory());
+    }
+    const double epsilon = shards[0].algorithm->GetEpsilon();
+    return absl::WrapUnique(
+        new ShardedAlgorithm(epsilon, num_shards, std::move(shards)));
+  }
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    Shard& shard = CurrentShard();
+    absl::MutexLock lock(&shard.mutex);
+    shard.algorithm->AddEntry(t);
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    Shard& shard = CurrentShard();
+    absl::MutexLock lock(&shard.mutex);
+    shard.algorithm->AddEntryWithCount(t, num_of_entries);
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    Shard& shard = CurrentShard();
+    absl::MutexLock lock(&shard.mutex);
+    shard.algorithm->AddEntries(entries);
+  }
+
+  Summary Serialize() override {
+    absl::Status status = Combine();
+    if (!status.ok()) {
+      LOG(ERROR) << "Cannot combine shards: " << status.message();
+    }
+    absl::MutexLock lock(&shards_[0].mutex);
+    return shards_[0].algorithm->Serialize();
+  }
+
+  absl::Status Merge(const Summary& summary) override {
+    absl::MutexLock lock(&shards_[0].mutex);
+    return shards_[0].algorithm->Merge(summary);
+  }
+
+  base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
+      double confidence_level, double privacy_budget = 1) override {
+    absl::MutexLock lock(&shards_[0].mutex);
+    return shards_[0].algorithm->NoiseConfidenceInterval(confidence_level,
+                                                         privacy_budget);
+  }
+
+  double GetEpsilon() const override {
+    return shards_[0].algorithm->GetEpsilon();
+  }
+
+  int64_t MemoryUsed() override {
+    int64_t memory = sizeof(ShardedAlgorithm<T>) + sizeof(Shard) * num_shards_;
+    for (int i = 0; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      memory += shards_[i].algorithm->MemoryUsed();
+    }
+    return memory;
+  }
+
+  int NumShards() const { return num_shards_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    RETURN_IF_ERROR(Combine());
+    absl::MutexLock lock(&shards_[0].mutex);
+    return shards_[0].algorithm->PartialResult(privacy_budget,
+                                               noise_interval_level);
+  }
+
+  void ResetState() override {
+    for (int i = 0; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      shards_[i].algorithm->Reset();
+    }
+  }
+
+ private:
+  // The algorithm of a shard is only used while its mutex is held.
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    absl::Mutex mutex;
+    std::unique_ptr<Algorithm<T>> algorithm;
+  };
+
+  ShardedAlgorithm(double epsilon, int num_shards,
+                   std::unique_ptr<Shard[]> shards)
+      : Algorithm<T>(epsilon),
+        num_shards_(num_shards),
+        shards_(std::move(shards)) {}
+
+  Shard& CurrentShard() {
+    return shards_[internal::ThreadShardIndex() % num_shards_];
+  }
+
+  // Merges every shard into the first shard and resets it. A shard that fails
+  // to merge keeps its entries.
+  absl::Status Combine() {
+    absl::MutexLock first_lock(&shards_[0].mutex);
+    absl::Status status = absl::OkStatus();
+    for (int i = 1; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      absl::Status merged =
+          shards_[0].algorithm->MergeFrom(*shards_[i].algorithm);
+      if (merged.ok()) {
+        shards_[i].algorithm->Reset();
+      } else {
+        status.Update(merged);
+      }
+    }
+    return status;
+  }
+
+  const int num_shards_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_ALGORITHM_H_
@@ -0,0 +1,156 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/sharded-algorithm.h"
+
+#include <thread>
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/util.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::EqualsProto;
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+constexpr int kNumThreads = 8;
+constexpr int kEntriesPerThread = 10000;
+
+base::StatusOr<std::unique_ptr<Algorithm<int64_t>>> MakeCount() {
+  return Count<int64_t>::Builder()
+      .SetEpsilon(1.0)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+base::StatusOr<std::unique_ptr<Algorithm<int64_t>>> MakeBoundedSum() {
+  return BoundedSum<int64_t>::Builder()
+      .SetEpsilon(1.0)
+      .SetLower(0)
+      .SetUpper(10)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build();
+}
+
+// Adds kEntriesPerThread entries with value i % 20 from each of kNumThreads
+// threads, half of them one by one and half of them in batches.
+void AddEntriesConcurrently(Algorithm<int64_t>* algorithm) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([algorithm]() {
+      std::vector<int64_t> batch;
+      for (int i = 0; i < kEntriesPerThread; ++i) {
+        if (i % 2 == 0) {
+          algorithm->AddEntry(i % 20);
+        } else {
+          batch.push_back(i % 20);
+        }
+      }
+      algorithm->AddEntries(batch.begin(), batch.end());
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(ShardedAlgorithmTest, CountsConcurrentEntries) {
+  auto sharded = ShardedAlgorithm<int64_t>::Create(kNumThreads, &MakeCount);
+  ASSERT_OK(sharded);
+  AddEntriesConcurrently(sharded->get());
+  auto output = (*sharded)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<int64_t>(*output), kNumThreads * kEntriesPerThread);
+}
+
+TEST(ShardedAlgorithmTest, SumsConcurrentEntries) {
+  // Fewer shards than threads, so that some threads share a shard.
+  auto sharded = ShardedAlgorithm<int64_t>::Create(3, &MakeBoundedSum);
+  ASSERT_OK(sharded);
+  AddEntriesConcurrently(sharded->get());
+
+  // Values i % 20 are clamped to 10, which sums to 145 per 20 entries.
+  const int64_t expected = kNumThreads * (kEntriesPerThread / 20) * 145;
+  auto output = (*sharded)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<int64_t>(*output), expected);
+}
+
+TEST(ShardedAlgorithmTest, SerializeMatchesSingleAlgorithm) {
+  auto sharded = ShardedAlgorithm<int64_t>::Create(4, &MakeBoundedSum);
+  ASSERT_OK(sharded);
+  auto single = MakeBoundedSum();
+  ASSERT_OK(single);
+  AddEntriesConcurrently(sharded->get());
+  AddEntriesConcurrently(single->get());
+  EXPECT_THAT((*sharded)->Serialize(), EqualsProto((*single)->Serialize()));
+
+  // Merging into a sharded algorithm.
+  auto merged = ShardedAlgorithm<int64_t>::Create(4, &MakeBoundedSum);
+  ASSERT_OK(merged);
+  EXPECT_OK((*merged)->Merge((*single)->Serialize()));
+  EXPECT_THAT((*merged)->Serialize(), EqualsProto((*single)->Serialize()));
+}
+
+TEST(ShardedAlgorithmTest, ResultConsumesBudgetAndReset) {
+  auto sharded = ShardedAlgorithm<int64_t>::Create(2, &MakeCount);
+  ASSERT_OK(sharded);
+  EXPECT_EQ((*sharded)->GetEpsilon(), 1.0);
+  (*sharded)->AddEntry(1);
+  ASSERT_OK((*sharded)->PartialResult());
+  EXPECT_THAT((*sharded)->PartialResult(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+
+  (*sharded)->Reset();
+  (*sharded)->AddEntry(1);
+  auto output = (*sharded)->PartialResult();
+  ASSERT_OK(output);
+  EXPECT_EQ(GetValue<int64_t>(*output), 1);
+}
+
+TEST(ShardedAlgorithmTest, ShardsAreCachelineAligned) {
+  auto sharded = ShardedAlgorithm<int64_t>::Create(2, &MakeCount);
+  ASSERT_OK(sharded);
+  EXPECT_GE((*sharded)->MemoryUsed(), 2 * ABSL_CACHELINE_SIZE);
+  EXPECT_EQ((*sharded)->NumShards(), 2);
+}
+
+TEST(ShardedAlgorithmTest, CreateValidatesParameters) {
+  EXPECT_THAT(ShardedAlgorithm<int64_t>::Create(0, &MakeCount),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of shards")));
+  EXPECT_THAT(
+      ShardedAlgorithm<int64_t>::Create(
+          2,
+          []() -> base::StatusOr<std::unique_ptr<Algorithm<int64_t>>> {
+            return absl::InvalidArgumentError("Factory failed.");
+          }),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("Factory")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,383 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_PARTITIONED_AGGREGATOR_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_PARTITIONED_AGGREGATOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/merge-all.h"
+#include "algorithms/numa-topology.h"
+#include "algorithms/partitioned-aggregator.h"
+#include "algorithms/sharding.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// ShardedPartitionedAggregator is a PartitionedAggregator for machines with
+// many cores and several NUMA nodes. Partitions are hash-partitioned by key
+// into shards, each a PartitionedAggregator with its own lock, and every
+// shard is assigned to a NUMA node. Since every partition is in exactly one
+// shard, and partition selection and noise are independent per partition,
+// the results have the same distribution as the ones of a single aggregator
+// with the same parameters, and use the same privacy budget.
+//
+// AddBatch() and the release methods process the shards on worker threads
+// that are pinned to the CPUs of the node of their shards, so that the
+// partition tables are allocated and read on that node. With
+// SecureURBG::BufferMode::kThreadLocal, every worker also draws the noise of
+// its shards from its own buffer of random bytes, which it allocates on its
+// node, instead of from the buffer shared by all threads. A worker that runs
+// out of shards of its own node steals the remaining shards of the other
+// nodes, so that skewed shards, e.g., with many more partitions or entries
+// than the others, do not leave the other workers idle. Tables of stolen
+// shards may grow on a remote node.
+//
+// Results are released shard by shard, in no particular order. Like
+// PartitionedAggregator, all contributions of a privacy unit to a partition
+// must be added in one call or entry.
+template <typename Key, typename T, typename Hash = absl::Hash<Key>,
+          typename Eq = std::equal_to<Key>>
+class ShardedPartitionedAggregator {
+ public:
+  using Aggregator = PartitionedAggregator<Key, T, Hash, Eq>;
+  using PartitionResult = typename Aggregator::PartitionResult;
+  using PartitionColumns = typename Aggregator::PartitionColumns;
+  using Factory =
+      std::function<base::StatusOr<std::unique_ptr<Aggregator>>()>;
+
+  // Batches smaller than this are added on the calling thread, since starting
+  // threads would cost more than it saves.
+  static constexpr int64_t kMinParallelBatchSize = 4096;
+
+  // All contributions of a privacy unit to the partition key.
+  struct Entry {
+    Key key;
+    absl::Span<const T> values;
+  };
+
+  class Builder {
+   public:
+    // Builds the aggregator of every shard. The factory must always build
+    // aggregators with identical parameters. A memory limit set in the
+    // factory applies to every shard; use a parent memory tracker shared by
+    // all shards to limit their total memory. Required.
+    Builder& SetAggregatorFactory(Factory factory) {
+      factory_ = std::move(factory);
+      return *this;
+    }
+
+    // Number of shards that partitions are hash-partitioned into. More
+    // shards than threads balance the load better. Defaults to 64.
+    Builder& SetNumShards(int num_shards) {
+      num_shards_ = num_shards;
+      return *this;
+    }
+
+    // Number of worker threads of AddBatch() and the release methods.
+    // Defaults to the number of hardware threads.
+    Builder& SetNumThreads(int num_threads) {
+      num_threads_ = num_threads;
+      return *this;
+    }
+
+    // The NUMA nodes that shards and workers are assigned to. Defaults to
+    // NumaTopology::Detect().
+    Builder& SetNumaTopology(NumaTopology topology) {
+      topology_ = std::move(topology);
+      return *this;
+    }
+
+    // Whether workers are pinned to the CPUs of their node. Defaults to true.
+    // Pinning has no effect with a topology without CPUs.
+    Builder& SetPinThreads(bool pin_threads) {
+      pin_threads_ = pin_threads;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<ShardedPartitionedAggregator>> Build() {
+      if (!factory_) {
+        return absl::InvalidArgumentError("Aggregator factory must be set.");
+      }
+      RETURN_IF_ERROR(ValidateIsPositive(num_shards_, "Number of shards"));
+      if (!num_threads_.has_value()) {
+        num_threads_ = std::max<int>(1, std::thread::hardware_concurrency());
+      }
+      RETURN_IF_ERROR(
+          ValidateIsPositive(num_threads_.value(), "Number of threads"));
+      if (!topology_.has_value()) {
+        topology_ = NumaTopology::Detect();
+      }
+      if (topology_->NumNodes() == 0) {
+        return absl::InvalidArgumentError(
+            "NUMA topology must have at least one node.");
+      }
+      auto shards = absl::make_unique<Shard[]>(num_shards_);
+      for (int i = 0; i < num_shards_; ++i) {
+        ASSIGN_OR_RETURN(shards[i].aggregator, factory_());
+      }
+      return absl::WrapUnique(new ShardedPartitionedAggregator(
+          num_shards_, num_threads_.value(), std::move(topology_).value(),
+          pin_threads_, std::move(shards)));
+    }
+
+   private:
+    Factory factory_;
+    int num_shards_ = 64;
+    absl::optional<int> num_threads_;
+    absl::optional<NumaTopology> topology_;
+    bool pin_threads_ = true;
+  };
+
+  // Adds a single contribution of a privacy unit to the partition key on the
+  // calling thread.
+  absl::Status AddEntry(const Key& key, const T& value) {
+    return AddEntries(key, absl::MakeConstSpan(&value, 1));
+  }
+
+  // Adds all contributions of a privacy unit to the partition key on the
+  // calling thread, as PartitionedAggregator::AddEntries(). Several threads
+  // may add entries concurrently, and only wait for each other on the shards
+  // they share.
+  absl::Status AddEntries(const Key& key, absl::Span<const T> values) {
+    Shard& shard = shards_[internal::ShardIndex(hash_(key), num_shards_)];
+    absl::MutexLock lock(&shard.mutex);
+    return shard.aggregator->AddEntries(key, values);
+  }
+
+  // Adds a batch of entries. The shards of batches of at least
+  // kMinParallelBatchSize entries are added by the workers of their nodes.
+  // Returns the first error of any shard, e.g., if the memory limit of a shard
+  // is reached. The entries that failed are not added, and the other entries
+  // are added.
+  absl::Status AddBatch(absl::Span<const Entry> entries) {
+    std::vector<int> entry_shards(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entry_shards[i] =
+          internal::ShardIndex(hash_(entries[i].key), num_shards_);
+    }
+    const internal::ShardOrder shard_order =
+        internal::SortByShard(entry_shards, num_shards_);
+
+    std::vector<std::vector<int64_t>> node_shards(topology_.NumNodes());
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      if (!shard_order.IsEmpty(shard)) {
+        node_shards[NodeOf(shard)].push_back(shard);
+      }
+    }
+    std::vector<absl::Status> statuses(num_shards_);
+    const int num_threads =
+        entries.size() < kMinParallelBatchSize ? 1 : num_threads_;
+    internal::NumaParallelFor(
+        topology_, node_shards, num_threads, pin_threads_,
+        [&](int64_t shard) {
+          Shard& current = shards_[shard];
+          absl::MutexLock lock(&current.mutex);
+          for (int64_t j = shard_order.offsets[shard];
+               j < shard_order.offsets[shard + 1]; ++j) {
+            const Entry& entry = entries[shard_order.order[j]];
+            statuses[shard].Update(
+                current.aggregator->AddEntries(entry.key, entry.values));
+          }
+        });
+    return internal::FirstError(statuses);
+  }
+
+  // Selects and noises the partitions of every shard on the workers of its
+  // node, and returns the released partitions of all shards, as
+  // PartitionedAggregator::ReleaseResults().
+  base::StatusOr<std::vector<PartitionResult>> ReleaseResults() {
+    std::vector<std::vector<PartitionResult>> shard_results;
+    RETURN_IF_ERROR(ReleaseShards(
+        [](Aggregator* aggregator) { return aggregator->ReleaseResults(); },
+        &shard_results));
+    int64_t size = 0;
+    for (const std::vector<PartitionResult>& results : shard_results) {
+      size += results.size();
+    }
+    std::vector<PartitionResult> results;
+    results.reserve(size);
+    for (std::vector<PartitionResult>& shard : shard_results) {
+      results.insert(results.end(), std::make_move_iterator(shard.begin()),
+                     std::make_move_iterator(shard.end()));
+    }
+    return results;
+  }
+
+  // Same as ReleaseResults(), but returns the partitions as columns, e.g., to
+  // export them to a columnar format.
+  base::StatusOr<PartitionColumns> ReleaseColumns() {
+    std::vector<PartitionColumns> shard_columns;
+    RETURN_IF_ERROR(ReleaseShards(
+        [](Aggregator* aggregator) { return aggregator->ReleaseColumns(); },
+        &shard_columns));
+    return ConcatenateColumns(&shard_columns);
+  }
+
+  // Same as above, and also fills the bounds columns with the confidence_level
+  // noise confidence intervals.
+  base::StatusOr<PartitionColumns> ReleaseColumns(double confidence_level) {
+    std::vector<PartitionColumns> shard_columns;
+    RETURN_IF_ERROR(ReleaseShards(
+        [confidence_level](Aggregator* aggregator) {
+          return aggregator->ReleaseColumns(confidence_level);
+        },
+        &shard_columns));
+    return ConcatenateColumns(&shard_columns);
+  }
+
+  // Removes all partitions and allows results to be released again.
+  void Reset() {
+    for (int i = 0; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      shards_[i].aggregator->Reset();
+    }
+  }
+
+  // Returns the number of partitions that have been contributed to.
+  int64_t NumPartitions() const {
+    int64_t num_partitions = 0;
+    for (int i = 0; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      num_partitions += shards_[i].aggregator->NumPartitions();
+    }
+    return num_partitions;
+  }
+
+  int64_t MemoryUsed() const {
+    int64_t memory =
+        sizeof(ShardedPartitionedAggregator) + sizeof(Shard) * num_shards_;
+    for (int i = 0; i < num_shards_; ++i) {
+      absl::MutexLock lock(&shards_[i].mutex);
+      memory += shards_[i].aggregator->MemoryUsed();
+    }
+    return memory;
+  }
+
+  double GetEpsilon() const { return shards_[0].aggregator->GetEpsilon(); }
+
+  int NumShards() const { return num_shards_; }
+
+  const NumaTopology& GetNumaTopology() const { return topology_; }
+
+  // Returns the node of topology that the shard is assigned to.
+  int NodeOf(int shard) const { return shard % topology_.NumNodes(); }
+
+ private:
+  // The aggregator of a shard is only used while its mutex is held.
+  struct alignas(ABSL_CACHELINE_SIZE) Shard {
+    mutable absl::Mutex mutex;
+    std::unique_ptr<Aggregator> aggregator;
+  };
+
+  ShardedPartitionedAggregator(int num_shards, int num_threads,
+                               NumaTopology topology, bool pin_threads,
+                               std::unique_ptr<Shard[]> shards)
+      : num_shards_(num_shards),
+        num_threads_(num_threads),
+        topology_(std::move(topology)),
+        pin_threads_(pin_threads),
+        shards_(std::move(shards)) {}
+
+  // Calls release on the aggregator of every shard on the workers, and
+  // stores the output of shard i in (*outputs)[i]. Returns the first error of
+  // any shard.
+  template <typename Output, typename Release>
+  absl::Status ReleaseShards(const Release& release,
+                             std::vector<Output>* outputs) {
+    std::vector<std::vector<int64_t>> node_shards(topology_.NumNodes());
+    for (int shard = 0; shard < num_shards_; ++shard) {
+      node_shards[NodeOf(shard)].push_back(shard);
+    }
+    outputs->resize(num_shards_);
+    std::vector<absl::Status> statuses(num_shards_);
+    internal::NumaParallelFor(
+        topology_, node_shards, num_threads_, pin_threads_,
+        [&](int64_t shard) {
+          absl::MutexLock lock(&shards_[shard].mutex);
+          base::StatusOr<Output> output =
+              release(shards_[shard].aggregator.get());
+          if (output.ok()) {
+            (*outputs)[shard] = std::move(output.value());
+          } else {
+            statuses[shard] = output.status();
+          }
+        });
+    return internal::FirstError(statuses);
+  }
+
+  // Moves the rows of all shard columns into one set of columns.
+  static PartitionColumns ConcatenateColumns(
+      std::vector<PartitionColumns>* shard_columns) {
+    PartitionColumns columns;
+    int64_t size = 0;
+    for (const PartitionColumns& shard : *shard_columns) {
+      size += shard.keys.size();
+    }
+    columns.keys.reserve(size);
+    for (PartitionColumns& shard : *shard_columns) {
+      columns.keys.insert(columns.keys.end(),
+                          std::make_move_iterator(shard.keys.begin()),
+                          std::make_move_iterator(shard.keys.end()));
+      Append(shard.counts, size, &columns.counts);
+      Append(shard.sums, size, &columns.sums);
+      Append(shard.count_lower_bounds, size, &columns.count_lower_bounds);
+      Append(shard.count_upper_bounds, size, &columns.count_upper_bounds);
+      Append(shard.sum_lower_bounds, size, &columns.sum_lower_bounds);
+      Append(shard.sum_upper_bounds, size, &columns.sum_upper_bounds);
+    }
+    return columns;
+  }
+
+  // Appends from to the column to, which is reserved for size rows the first
+  // time rows are appended.
+  template <typename V>
+  static void Append(const std::vector<V>& from, int64_t size,
+                     std::vector<V>* to) {
+    if (from.empty()) {
+      return;
+    }
+    to->reserve(size);
+    to->insert(to->end(), from.begin(), from.end());
+  }
+
+  const int num_shards_;
+  const int num_threads_;
+  const NumaTopology topology_;
+  const bool pin_threads_;
+  Hash hash_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDED_PARTITIONED_AGGREGATOR_H_
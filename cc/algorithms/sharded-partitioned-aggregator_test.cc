@@ -0,0 +1,260 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/sharded-partitioned-aggregator.h"
+
+#include <cstdint>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numa-topology.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/partition-selection.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+
+using Sharded = ShardedPartitionedAggregator<int64_t, int64_t>;
+
+// Keeps the partitions with at least min_users privacy units.
+class MinUsersSelection : public PartitionSelectionStrategy {
+ public:
+  explicit MinUsersSelection(int min_users)
+      : PartitionSelectionStrategy(1, 1e-5, 1, 1e-5), min_users_(min_users) {}
+
+  bool ShouldKeep(int num_users) override { return num_users >= min_users_; }
+
+ private:
+  const int min_users_;
+};
+
+Sharded::Factory ZeroNoiseFactory(int min_users,
+                                  int64_t memory_limit = kNoMemoryLimit) {
+  return [min_users, memory_limit]() {
+    return Sharded::Aggregator::Builder()
+        .SetEpsilon(1)
+        .SetLower(0)
+        .SetUpper(10)
+        .SetMaxContributionsPerPartition(2)
+        .SetPartitionSelectionStrategy(
+            absl::make_unique<MinUsersSelection>(min_users))
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .SetMemoryLimit(memory_limit)
+        .Build();
+  };
+}
+
+// Returns a topology with two nodes that have no CPUs, so that workers are
+// spread over two nodes without being pinned.
+NumaTopology TwoNodes() { return {{{}, {}}}; }
+
+std::unique_ptr<Sharded> MakeSharded(int min_users, int num_threads) {
+  return Sharded::Builder()
+      .SetAggregatorFactory(ZeroNoiseFactory(min_users))
+      .SetNumShards(8)
+      .SetNumThreads(num_threads)
+      .SetNumaTopology(TwoNodes())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(ShardedPartitionedAggregatorTest, CountsAndSumsPerPartition) {
+  std::unique_ptr<Sharded> aggregator =
+      MakeSharded(/*min_users=*/2, /*num_threads=*/4);
+  for (int64_t key = 0; key < 100; ++key) {
+    ASSERT_OK(aggregator->AddEntry(key, key % 10));
+    if (key % 2 == 0) {
+      ASSERT_OK(aggregator->AddEntry(key, 20));
+    }
+  }
+  EXPECT_EQ(aggregator->NumPartitions(), 100);
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  // Only the even keys have two privacy units.
+  ASSERT_THAT(results.value(), SizeIs(50));
+  for (const Sharded::PartitionResult& result : results.value()) {
+    EXPECT_EQ(result.key % 2, 0);
+    EXPECT_EQ(result.count, 2);
+    EXPECT_EQ(result.sum, result.key % 10 + 10);
+  }
+
+  EXPECT_THAT(aggregator->ReleaseResults(),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("already been released")));
+  aggregator->Reset();
+  EXPECT_EQ(aggregator->NumPartitions(), 0);
+  EXPECT_OK(aggregator->ReleaseResults());
+}
+
+TEST(ShardedPartitionedAggregatorTest, AddsBatchesInParallel) {
+  std::unique_ptr<Sharded> aggregator =
+      MakeSharded(/*min_users=*/1, /*num_threads=*/4);
+  const int64_t kNumPartitions = 1000;
+  const std::vector<int64_t> values = {1, 2, 3};
+  std::vector<Sharded::Entry> entries;
+  for (int user = 0; user < 10; ++user) {
+    for (int64_t key = 0; key < kNumPartitions; ++key) {
+      entries.push_back({key, values});
+    }
+  }
+  ASSERT_GE(entries.size(), Sharded::kMinParallelBatchSize);
+  ASSERT_OK(aggregator->AddBatch(entries));
+
+  auto columns = aggregator->ReleaseColumns();
+  ASSERT_OK(columns);
+  ASSERT_THAT(columns->keys, SizeIs(kNumPartitions));
+  absl::flat_hash_map<int64_t, int> seen;
+  for (int i = 0; i < kNumPartitions; ++i) {
+    ++seen[columns->keys[i]];
+    // At most two contributions of every user are kept.
+    EXPECT_EQ(columns->counts[i], 20);
+    EXPECT_EQ(columns->sums[i], 30);
+  }
+  EXPECT_THAT(seen, SizeIs(kNumPartitions));
+  EXPECT_TRUE(columns->count_lower_bounds.empty());
+}
+
+TEST(ShardedPartitionedAggregatorTest, ConcurrentEntriesAreAllAdded) {
+  const int kNumThreads = 4;
+  std::unique_ptr<Sharded> aggregator =
+      MakeSharded(/*min_users=*/1, kNumThreads);
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.emplace_back([&aggregator] {
+      for (int64_t key = 0; key < 500; ++key) {
+        ASSERT_OK(aggregator->AddEntry(key, 1));
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  auto results = aggregator->ReleaseResults();
+  ASSERT_OK(results);
+  ASSERT_THAT(results.value(), SizeIs(500));
+  for (const Sharded::PartitionResult& result : results.value()) {
+    EXPECT_EQ(result.count, kNumThreads);
+    EXPECT_EQ(result.sum, kNumThreads);
+  }
+}
+
+TEST(ShardedPartitionedAggregatorTest, ReleasesColumnsWithConfidenceBounds) {
+  auto aggregator =
+      ShardedPartitionedAggregator<int64_t, double>::Builder()
+          .SetAggregatorFactory([] {
+            return PartitionedAggregator<int64_t, double>::Builder()
+                .SetEpsilon(1)
+                .SetLower(0)
+                .SetUpper(10)
+                .SetPartitionSelectionStrategy(
+                    absl::make_unique<MinUsersSelection>(1))
+                .Build();
+          })
+          .SetNumShards(4)
+          .SetNumThreads(2)
+          .SetNumaTopology(TwoNodes())
+          .Build();
+  ASSERT_OK(aggregator);
+  for (int64_t key = 0; key < 100; ++key) {
+    ASSERT_OK((*aggregator)->AddEntry(key, key % 10));
+  }
+
+  auto columns = (*aggregator)->ReleaseColumns(0.9);
+  ASSERT_OK(columns);
+  ASSERT_THAT(columns->keys, SizeIs(100));
+  ASSERT_THAT(columns->count_lower_bounds, SizeIs(100));
+  ASSERT_THAT(columns->sum_upper_bounds, SizeIs(100));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_LT(columns->count_lower_bounds[i], columns->counts[i]);
+    EXPECT_GT(columns->count_upper_bounds[i], columns->counts[i]);
+    EXPECT_LT(columns->sum_lower_bounds[i], columns->sums[i]);
+    EXPECT_GT(columns->sum_upper_bounds[i], columns->sums[i]);
+  }
+}
+
+TEST(ShardedPartitionedAggregatorTest, BatchReportsMemoryLimit) {
+  auto aggregator = Sharded::Builder()
+                        .SetAggregatorFactory(ZeroNoiseFactory(1, 4096))
+                        .SetNumShards(2)
+                        .SetNumThreads(2)
+                        .SetNumaTopology(TwoNodes())
+                        .Build();
+  ASSERT_OK(aggregator);
+  const std::vector<int64_t> values = {1};
+  std::vector<Sharded::Entry> entries;
+  for (int64_t key = 0; key < Sharded::kMinParallelBatchSize; ++key) {
+    entries.push_back({key, values});
+  }
+  EXPECT_THAT((*aggregator)->AddBatch(entries),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+  EXPECT_GT((*aggregator)->NumPartitions(), 0);
+  EXPECT_LT((*aggregator)->NumPartitions(), Sharded::kMinParallelBatchSize);
+}
+
+TEST(ShardedPartitionedAggregatorTest, AssignsShardsToNodes) {
+  std::unique_ptr<Sharded> aggregator =
+      MakeSharded(/*min_users=*/1, /*num_threads=*/1);
+  EXPECT_EQ(aggregator->NumShards(), 8);
+  EXPECT_EQ(aggregator->GetNumaTopology().NumNodes(), 2);
+  EXPECT_EQ(aggregator->NodeOf(0), 0);
+  EXPECT_EQ(aggregator->NodeOf(1), 1);
+  EXPECT_EQ(aggregator->NodeOf(6), 0);
+  EXPECT_EQ(aggregator->GetEpsilon(), 1);
+  EXPECT_GT(aggregator->MemoryUsed(), 0);
+}
+
+TEST(ShardedPartitionedAggregatorTest, BuildValidatesParameters) {
+  EXPECT_THAT(Sharded::Builder().Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("factory must be set")));
+  EXPECT_THAT(Sharded::Builder()
+                  .SetAggregatorFactory(ZeroNoiseFactory(1))
+                  .SetNumShards(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of shards")));
+  EXPECT_THAT(Sharded::Builder()
+                  .SetAggregatorFactory(ZeroNoiseFactory(1))
+                  .SetNumThreads(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Number of threads")));
+  EXPECT_THAT(Sharded::Builder()
+                  .SetAggregatorFactory(ZeroNoiseFactory(1))
+                  .SetNumaTopology(NumaTopology())
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("at least one node")));
+  EXPECT_THAT(Sharded::Builder()
+                  .SetAggregatorFactory(ZeroNoiseFactory(1, 16))
+                  .Build(),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
+}  // namespace
+}  // namespace differential_privacy
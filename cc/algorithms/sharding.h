@@ -0,0 +1,70 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDING_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace differential_privacy {
+namespace internal {
+
+// Returns the shard in [0, num_shards) of an element with the given hash. Uses
+// the high bits of the mixed hash, so that the shard of an element is
+// independent of the bits that the hash table of its shard uses.
+inline int ShardIndex(std::size_t hash, int num_shards) {
+  const uint64_t mixed =
+      static_cast<uint64_t>(hash) * uint64_t{0x9E3779B97F4A7C15};
+  return static_cast<int>((mixed >> 32) % num_shards);
+}
+
+// The indices of a batch of elements, grouped by shard. The indices of the
+// elements of shard s are order[offsets[s]] to order[offsets[s + 1] - 1], in
+// increasing order.
+struct ShardOrder {
+  std::vector<int64_t> offsets;
+  std::vector<int64_t> order;
+
+  bool IsEmpty(int shard) const { return offsets[shard] == offsets[shard + 1]; }
+};
+
+// Groups the indices of the elements of a batch by shard with a counting
+// sort, where shards[i] is the shard of element i, in [0, num_shards).
+inline ShardOrder SortByShard(absl::Span<const int> shards, int num_shards) {
+  ShardOrder result;
+  result.offsets.assign(num_shards + 1, 0);
+  for (int shard : shards) {
+    ++result.offsets[shard + 1];
+  }
+  for (int shard = 0; shard < num_shards; ++shard) {
+    result.offsets[shard + 1] += result.offsets[shard];
+  }
+  result.order.resize(shards.size());
+  std::vector<int64_t> next(result.offsets.begin(), result.offsets.end() - 1);
+  for (size_t i = 0; i < shards.size(); ++i) {
+    result.order[next[shards[i]]++] = i;
+  }
+  return result;
+}
+
+}  // namespace internal
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SHARDING_H_
@@ -0,0 +1,60 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/sharding.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+TEST(ShardingTest, ShardIndexIsInRange) {
+  std::vector<int> counts(7, 0);
+  for (std::size_t hash = 0; hash < 7000; ++hash) {
+    const int shard = ShardIndex(hash, 7);
+    ASSERT_GE(shard, 0);
+    ASSERT_LT(shard, 7);
+    ++counts[shard];
+  }
+  // Consecutive hashes are spread over all shards.
+  for (int count : counts) {
+    EXPECT_GT(count, 0);
+  }
+}
+
+TEST(ShardingTest, SortByShardGroupsIndicesInOrder) {
+  const ShardOrder shard_order = SortByShard({2, 0, 2, 3, 0}, 4);
+  EXPECT_THAT(shard_order.offsets, ElementsAre(0, 2, 2, 4, 5));
+  EXPECT_THAT(shard_order.order, ElementsAre(1, 4, 0, 2, 3));
+  EXPECT_FALSE(shard_order.IsEmpty(0));
+  EXPECT_TRUE(shard_order.IsEmpty(1));
+
+  const ShardOrder empty = SortByShard({}, 2);
+  EXPECT_THAT(empty.offsets, ElementsAre(0, 0, 0));
+  EXPECT_THAT(empty.order, IsEmpty());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace differential_privacy
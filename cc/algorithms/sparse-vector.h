@@ -0,0 +1,247 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SPARSE_VECTOR_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SPARSE_VECTOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Number of queries whose noise SparseVector draws with one batched AddNoise
+// call.
+constexpr int kSparseVectorBatchSize = 1024;
+
+// SparseVector answers a stream of queries with whether each query result is
+// at least a threshold, e.g., whether a monitored metric is high enough to
+// raise an alert, with the sparse vector technique: the whole stream costs a
+// fixed epsilon, however many queries are below the threshold, and the engine
+// halts after max_positive_answers queries were found at least the threshold.
+// Answering every query with NoisedValueAboveThreshold() instead costs
+// epsilon per query.
+//
+// This is Algorithm 1 of Lyu, Su and Li, "Understanding the Sparse Vector
+// Technique for Differential Privacy" (https://arxiv.org/abs/1603.01699).
+// The threshold is noised once with Laplace noise of epsilon_1 and
+// sensitivity Delta, where Delta is the sensitivity of every query, and every
+// query result with Laplace noise of epsilon_2 and sensitivity 2 c Delta, for
+// c = max_positive_answers, or c Delta if the queries are monotonic, i.e., if
+// adding a privacy unit never decreases one query and increases another.
+// epsilon is split into epsilon_1 = epsilon / (1 + (2c)^(2/3)), or
+// epsilon / (1 + c^(2/3)) for monotonic queries, and epsilon_2 = epsilon -
+// epsilon_1, the ratio that minimizes the variance of the comparison as
+// suggested in the paper. The noise of the queries is drawn in batches with
+// the batched AddNoise of the mechanism.
+//
+// Only the answers may be released, never the noised values. Not thread
+// safe.
+class SparseVector {
+ public:
+  class Builder {
+   public:
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    Builder& SetThreshold(double threshold) {
+      threshold_ = threshold;
+      return *this;
+    }
+
+    // Number of positive answers after which the engine halts.
+    Builder& SetMaxPositiveAnswers(int64_t max_positive_answers) {
+      max_positive_answers_ = max_positive_answers;
+      return *this;
+    }
+
+    // Maximum change of any query result when a privacy unit is added or
+    // removed. Defaults to 1, e.g., for counts of privacy units.
+    Builder& SetSensitivity(double sensitivity) {
+      sensitivity_ = sensitivity;
+      return *this;
+    }
+
+    // Whether adding a privacy unit changes all query results in the same
+    // direction, e.g., for counts. Monotonic queries need half the noise.
+    Builder& SetMonotonicQueries(bool monotonic_queries) {
+      monotonic_queries_ = monotonic_queries;
+      return *this;
+    }
+
+    // The mechanism builder is used to interject custom mechanisms for
+    // testing.
+    Builder& SetLaplaceMechanism(
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
+      mechanism_builder_ = std::move(mechanism_builder);
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<SparseVector>> Build() {
+      RETURN_IF_ERROR(ValidateIsFiniteAndPositive(epsilon_, "Epsilon"));
+      RETURN_IF_ERROR(ValidateIsFinite(threshold_, "Threshold"));
+      RETURN_IF_ERROR(ValidateIsPositive(max_positive_answers_,
+                                         "Maximum positive answers"));
+      RETURN_IF_ERROR(
+          ValidateIsFiniteAndPositive(sensitivity_, "Sensitivity"));
+      const double epsilon = epsilon_.value();
+      const double c = max_positive_answers_;
+      const double threshold_epsilon =
+          epsilon /
+          (1 + std::pow(monotonic_queries_ ? c : 2 * c, 2.0 / 3.0));
+      const double query_epsilon = epsilon - threshold_epsilon;
+      const double query_sensitivity =
+          (monotonic_queries_ ? 1 : 2) * c * sensitivity_;
+
+      std::unique_ptr<NumericalMechanism> threshold_mechanism;
+      ASSIGN_OR_RETURN(threshold_mechanism,
+                       mechanism_builder_->Clone()
+                           ->SetEpsilon(threshold_epsilon)
+                           .SetL0Sensitivity(1)
+                           .SetLInfSensitivity(sensitivity_)
+                           .Build());
+      std::unique_ptr<NumericalMechanism> query_mechanism;
+      ASSIGN_OR_RETURN(query_mechanism,
+                       mechanism_builder_->Clone()
+                           ->SetEpsilon(query_epsilon)
+                           .SetL0Sensitivity(1)
+                           .SetLInfSensitivity(query_sensitivity)
+                           .Build());
+      const double noised_threshold =
+          threshold_mechanism->AddNoise(threshold_.value());
+      return absl::WrapUnique(new SparseVector(
+          epsilon, noised_threshold, max_positive_answers_,
+          std::move(threshold_mechanism), std::move(query_mechanism)));
+    }
+
+   private:
+    absl::optional<double> epsilon_;
+    absl::optional<double> threshold_;
+    int64_t max_positive_answers_ = 1;
+    double sensitivity_ = 1;
+    bool monotonic_queries_ = false;
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_ =
+        absl::make_unique<LaplaceMechanism::Builder>();
+  };
+
+  // Returns whether the noised query result is at least the noised threshold.
+  // Fails with FailedPrecondition once the engine has halted.
+  base::StatusOr<bool> AnswerQuery(double query_result) {
+    std::vector<int64_t> above_threshold;
+    ASSIGN_OR_RETURN(int64_t num_answered,
+                     AnswerQueries({query_result}, &above_threshold));
+    return num_answered == 1 && !above_threshold.empty();
+  }
+
+  // Answers the queries in order, and appends the indices of the queries at
+  // least the threshold to above_threshold. Returns the number of answered
+  // queries, which is less than the number of queries only if the engine
+  // halted at the positive answer of the last answered query. Fails with
+  // FailedPrecondition if the engine has already halted.
+  base::StatusOr<int64_t> AnswerQueries(absl::Span<const double> query_results,
+                                        std::vector<int64_t>* above_threshold) {
+    if (Halted()) {
+      return absl::FailedPreconditionError(absl::StrCat(
+          "The sparse vector has halted after ", max_positive_answers_,
+          " positive answers."));
+    }
+    int64_t answered = 0;
+    while (answered < query_results.size() && !Halted()) {
+      const int64_t batch_size = std::min<int64_t>(
+          query_results.size() - answered, kSparseVectorBatchSize);
+      noised_results_.resize(batch_size);
+      RETURN_IF_ERROR(query_mechanism_->AddNoise(
+          query_results.subspan(answered, batch_size),
+          absl::MakeSpan(noised_results_), /*privacy_budget=*/1));
+      // The noise of the queries after the last positive answer is dropped
+      // without being used.
+      int64_t i = 0;
+      for (; i < batch_size && !Halted(); ++i) {
+        if (noised_results_[i] >= noised_threshold_) {
+          above_threshold->push_back(answered + i);
+          ++num_positive_answers_;
+        }
+      }
+      answered += i;
+    }
+    num_answered_ += answered;
+    return answered;
+  }
+
+  // Returns whether the engine has answered max_positive_answers queries
+  // positively, after which it answers no queries.
+  bool Halted() const { return num_positive_answers_ >= max_positive_answers_; }
+
+  int64_t RemainingPositiveAnswers() const {
+    return max_positive_answers_ - num_positive_answers_;
+  }
+
+  // Returns the total number of answered queries.
+  int64_t NumAnsweredQueries() const { return num_answered_; }
+
+  double GetEpsilon() const { return epsilon_; }
+
+  // Returns the parts of epsilon that noise the threshold and the queries.
+  double GetThresholdEpsilon() const {
+    return threshold_mechanism_->GetEpsilon();
+  }
+  double GetQueryEpsilon() const { return query_mechanism_->GetEpsilon(); }
+
+  int64_t MemoryUsed() const {
+    return sizeof(SparseVector) + threshold_mechanism_->MemoryUsed() +
+           query_mechanism_->MemoryUsed() +
+           noised_results_.capacity() * sizeof(double);
+  }
+
+ private:
+  SparseVector(double epsilon, double noised_threshold,
+               int64_t max_positive_answers,
+               std::unique_ptr<NumericalMechanism> threshold_mechanism,
+               std::unique_ptr<NumericalMechanism> query_mechanism)
+      : epsilon_(epsilon),
+        noised_threshold_(noised_threshold),
+        max_positive_answers_(max_positive_answers),
+        threshold_mechanism_(std::move(threshold_mechanism)),
+        query_mechanism_(std::move(query_mechanism)) {}
+
+  const double epsilon_;
+  const double noised_threshold_;
+  const int64_t max_positive_answers_;
+  int64_t num_positive_answers_ = 0;
+  int64_t num_answered_ = 0;
+  std::unique_ptr<NumericalMechanism> threshold_mechanism_;
+  std::unique_ptr<NumericalMechanism> query_mechanism_;
+  // Buffer of the noised query results of a batch.
+  std::vector<double> noised_results_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SPARSE_VECTOR_H_
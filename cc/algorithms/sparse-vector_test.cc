@@ -0,0 +1,153 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/sparse-vector.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::IsOkAndHolds;
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+std::unique_ptr<SparseVector> MakeZeroNoiseSparseVector(
+    double threshold, int64_t max_positive_answers) {
+  return SparseVector::Builder()
+      .SetEpsilon(1)
+      .SetThreshold(threshold)
+      .SetMaxPositiveAnswers(max_positive_answers)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+TEST(SparseVectorTest, HaltsAfterMaxPositiveAnswers) {
+  std::unique_ptr<SparseVector> sparse_vector =
+      MakeZeroNoiseSparseVector(10, 2);
+  std::vector<int64_t> above_threshold;
+  base::StatusOr<int64_t> answered =
+      sparse_vector->AnswerQueries({1, 12, 5, 10, 30}, &above_threshold);
+  ASSERT_OK(answered);
+  EXPECT_EQ(*answered, 4);
+  EXPECT_THAT(above_threshold, ElementsAre(1, 3));
+  EXPECT_TRUE(sparse_vector->Halted());
+  EXPECT_EQ(sparse_vector->RemainingPositiveAnswers(), 0);
+  EXPECT_EQ(sparse_vector->NumAnsweredQueries(), 4);
+
+  EXPECT_THAT(sparse_vector->AnswerQuery(20),
+              StatusIs(absl::StatusCode::kFailedPrecondition,
+                       HasSubstr("halted")));
+}
+
+TEST(SparseVectorTest, AnswersSingleQueries) {
+  std::unique_ptr<SparseVector> sparse_vector =
+      MakeZeroNoiseSparseVector(0, 1);
+  EXPECT_THAT(sparse_vector->AnswerQuery(-1), IsOkAndHolds(false));
+  EXPECT_THAT(sparse_vector->AnswerQuery(-2), IsOkAndHolds(false));
+  EXPECT_FALSE(sparse_vector->Halted());
+  EXPECT_THAT(sparse_vector->AnswerQuery(3), IsOkAndHolds(true));
+  EXPECT_TRUE(sparse_vector->Halted());
+}
+
+TEST(SparseVectorTest, AnswersQueriesAcrossBatches) {
+  std::unique_ptr<SparseVector> sparse_vector =
+      MakeZeroNoiseSparseVector(100, 3);
+  std::vector<double> queries(3 * kSparseVectorBatchSize + 5, 0);
+  queries[kSparseVectorBatchSize - 1] = 100;
+  queries[kSparseVectorBatchSize] = 101;
+  std::vector<int64_t> above_threshold;
+  EXPECT_THAT(sparse_vector->AnswerQueries(queries, &above_threshold),
+              IsOkAndHolds(queries.size()));
+  EXPECT_THAT(above_threshold, ElementsAre(kSparseVectorBatchSize - 1,
+                                           kSparseVectorBatchSize));
+  EXPECT_EQ(sparse_vector->RemainingPositiveAnswers(), 1);
+}
+
+TEST(SparseVectorTest, SplitsEpsilon) {
+  for (bool monotonic : {false, true}) {
+    std::unique_ptr<SparseVector> sparse_vector =
+        SparseVector::Builder()
+            .SetEpsilon(2)
+            .SetThreshold(0)
+            .SetMaxPositiveAnswers(4)
+            .SetMonotonicQueries(monotonic)
+            .Build()
+            .ValueOrDie();
+    const double c = monotonic ? 4 : 8;
+    EXPECT_DOUBLE_EQ(sparse_vector->GetThresholdEpsilon(),
+                     2 / (1 + std::pow(c, 2.0 / 3.0)));
+    EXPECT_DOUBLE_EQ(sparse_vector->GetThresholdEpsilon() +
+                         sparse_vector->GetQueryEpsilon(),
+                     2);
+  }
+}
+
+TEST(SparseVectorTest, NoisyAnswersSeparateFarQueries) {
+  std::unique_ptr<SparseVector> sparse_vector = SparseVector::Builder()
+                                                    .SetEpsilon(1)
+                                                    .SetThreshold(0)
+                                                    .SetMaxPositiveAnswers(10)
+                                                    .Build()
+                                                    .ValueOrDie();
+  // The query noise has a scale of about 23, and the threshold noise of 8.
+  std::vector<double> queries(10000, -1000);
+  std::vector<int64_t> above_threshold;
+  ASSERT_OK(sparse_vector->AnswerQueries(queries, &above_threshold));
+  EXPECT_TRUE(above_threshold.empty());
+
+  queries.assign(20, 1000);
+  EXPECT_THAT(sparse_vector->AnswerQueries(queries, &above_threshold),
+              IsOkAndHolds(10));
+  EXPECT_EQ(above_threshold.size(), 10);
+}
+
+TEST(SparseVectorTest, BuildValidatesParameters) {
+  EXPECT_THAT(SparseVector::Builder().SetThreshold(0).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon")));
+  EXPECT_THAT(SparseVector::Builder().SetEpsilon(1).Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Threshold")));
+  EXPECT_THAT(SparseVector::Builder()
+                  .SetEpsilon(1)
+                  .SetThreshold(0)
+                  .SetMaxPositiveAnswers(0)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Maximum positive answers")));
+  EXPECT_THAT(SparseVector::Builder()
+                  .SetEpsilon(1)
+                  .SetThreshold(0)
+                  .SetSensitivity(-1)
+                  .Build(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Sensitivity")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
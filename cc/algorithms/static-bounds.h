@@ -0,0 +1,361 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_STATIC_BOUNDS_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_STATIC_BOUNDS_H_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/bounded-variance.h"
+#include "algorithms/metrics.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Integral bounds known at compile time, for the StaticBounded* algorithms
+// below. Any type with static constexpr kLower and kUpper members can be used
+// as bounds. Floating point template parameters are not allowed before C++20,
+// so for fractional bounds, define such a type instead:
+//
+//   struct RatingBounds {
+//     static constexpr double kLower = 0.5;
+//     static constexpr double kUpper = 5;
+//   };
+template <int64_t kLowerBound, int64_t kUpperBound>
+struct StaticBounds {
+  static constexpr int64_t kLower = kLowerBound;
+  static constexpr int64_t kUpper = kUpperBound;
+};
+
+namespace internal {
+
+// Returns t clamped to the bounds, using selects instead of branches. NaN
+// fails both comparisons and is returned unchanged.
+template <typename T, typename Bounds>
+constexpr T ClampToStaticBounds(T t) {
+  constexpr T lower = static_cast<T>(Bounds::kLower);
+  constexpr T upper = static_cast<T>(Bounds::kUpper);
+  return t < lower ? lower : (upper < t ? upper : t);
+}
+
+}  // namespace internal
+
+// The StaticBounded* algorithms are the bounded algorithms with manually set
+// bounds that are fixed at compile time. Adding entries clamps them to the
+// constant bounds without checking for automatic bounds, so that it compiles to
+// a branch-free clamp and add, in particular when the algorithm is used through
+// its own type rather than through Algorithm<T>. Everything else is inherited
+// from the algorithm with manually set bounds, so Serialize() and Merge() use
+// the same summaries, and summaries of both can be merged into each other.
+//
+// The privacy parameters are still set at runtime with the builder. They only
+// affect the mechanisms, which are not used when adding entries.
+
+// BoundedSum with bounds fixed at compile time.
+template <typename T, typename Bounds>
+class StaticBoundedSum final : public BoundedSum<T> {
+ public:
+  static constexpr T kLower = static_cast<T>(Bounds::kLower);
+  static constexpr T kUpper = static_cast<T>(Bounds::kUpper);
+  static_assert(!(kUpper < kLower), "Lower bound must not exceed upper bound.");
+
+  class Builder : public AlgorithmBuilder<T, StaticBoundedSum, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, StaticBoundedSum, Builder>;
+
+   private:
+    base::StatusOr<std::unique_ptr<StaticBoundedSum>> BuildAlgorithm()
+        override {
+      RETURN_IF_ERROR(BoundedSum<T>::Builder::CheckLowerBound(kLower));
+      const double epsilon = AlgorithmBuilder::GetEpsilon().value();
+      const int l0_sensitivity =
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1);
+      const int max_contributions_per_partition =
+          AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1);
+      std::shared_ptr<const NumericalMechanismBuilder> mechanism_builder =
+          AlgorithmBuilder::GetMechanismBuilderClone();
+      std::unique_ptr<NumericalMechanism> mechanism;
+      ASSIGN_OR_RETURN(
+          mechanism,
+          BuildMechanism(mechanism_builder->Clone(), epsilon, l0_sensitivity,
+                         max_contributions_per_partition));
+      return absl::WrapUnique(new StaticBoundedSum(
+          epsilon, l0_sensitivity, max_contributions_per_partition,
+          std::move(mechanism_builder), std::move(mechanism)));
+    }
+  };
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBoundedSumEntries);
+    this->sum_ += t == t ? internal::ClampToStaticBounds<T, Bounds>(t) : 0;
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedSumEntries, num_of_entries);
+    if (t == t) {
+      this->sum_ = AddMultipleWrapping<T>(
+          this->sum_, internal::ClampToStaticBounds<T, Bounds>(t),
+          num_of_entries);
+    }
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedSumEntries, entries.size());
+    this->sum_ =
+        internal::AddClampedEntries<T>(this->sum_, entries, kLower, kUpper);
+  }
+
+ private:
+  StaticBoundedSum(
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition,
+      std::shared_ptr<const NumericalMechanismBuilder> mechanism_builder,
+      std::unique_ptr<NumericalMechanism> mechanism)
+      : BoundedSum<T>(epsilon, kLower, kUpper, l0_sensitivity,
+                      max_contributions_per_partition,
+                      std::move(mechanism_builder), std::move(mechanism)) {}
+
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition) {
+    return BoundedSum<T>::BuildMechanism(std::move(mechanism_builder), epsilon,
+                                         l0_sensitivity,
+                                         max_contributions_per_partition,
+                                         kLower, kUpper);
+  }
+};
+
+// BoundedMean with bounds fixed at compile time.
+template <typename T, typename Bounds>
+class StaticBoundedMean final : public BoundedMean<T> {
+ public:
+  static constexpr T kLower = static_cast<T>(Bounds::kLower);
+  static constexpr T kUpper = static_cast<T>(Bounds::kUpper);
+  static_assert(!(kUpper < kLower), "Lower bound must not exceed upper bound.");
+
+  class Builder : public AlgorithmBuilder<T, StaticBoundedMean, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, StaticBoundedMean, Builder>;
+
+   private:
+    base::StatusOr<std::unique_ptr<StaticBoundedMean>> BuildAlgorithm()
+        override {
+      RETURN_IF_ERROR(BoundedMean<T>::Builder::CheckBounds(kLower, kUpper));
+      const double epsilon = AlgorithmBuilder::GetEpsilon().value();
+      const int l0_sensitivity =
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1);
+      const int max_contributions_per_partition =
+          AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1);
+      std::unique_ptr<NumericalMechanism> sum_mechanism;
+      ASSIGN_OR_RETURN(sum_mechanism,
+                       BuildSumMechanism(
+                           AlgorithmBuilder::GetMechanismBuilderClone(),
+                           epsilon, l0_sensitivity,
+                           max_contributions_per_partition));
+      std::unique_ptr<NumericalMechanism> count_mechanism;
+      ASSIGN_OR_RETURN(count_mechanism,
+                       AlgorithmBuilder::GetMechanismBuilderClone()
+                           ->SetEpsilon(epsilon)
+                           .SetL0Sensitivity(l0_sensitivity)
+                           .SetLInfSensitivity(max_contributions_per_partition)
+                           .Build());
+      return absl::WrapUnique(new StaticBoundedMean(
+          epsilon, l0_sensitivity, max_contributions_per_partition,
+          AlgorithmBuilder::GetMechanismBuilderClone(),
+          std::move(sum_mechanism), std::move(count_mechanism)));
+    }
+  };
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries);
+    const bool is_number = t == t;
+    this->pos_sum_[0] +=
+        is_number ? internal::ClampToStaticBounds<T, Bounds>(t) : 0;
+    this->raw_count_ += is_number;
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries, num_of_entries);
+    if (t == t) {
+      this->pos_sum_[0] = AddMultipleWrapping<T>(
+          this->pos_sum_[0], internal::ClampToStaticBounds<T, Bounds>(t),
+          num_of_entries);
+      this->raw_count_ += num_of_entries;
+    }
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedMeanEntries, entries.size());
+    T sum = this->pos_sum_[0];
+    uint64_t count = this->raw_count_;
+    for (const T& t : entries) {
+      const bool is_number = t == t;
+      sum += is_number ? internal::ClampToStaticBounds<T, Bounds>(t) : 0;
+      count += is_number;
+    }
+    this->pos_sum_[0] = sum;
+    this->raw_count_ = count;
+  }
+
+ private:
+  StaticBoundedMean(
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition,
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      std::unique_ptr<NumericalMechanism> sum_mechanism,
+      std::unique_ptr<NumericalMechanism> count_mechanism)
+      : BoundedMean<T>(epsilon, kLower, kUpper, l0_sensitivity,
+                       max_contributions_per_partition,
+                       std::move(mechanism_builder), std::move(sum_mechanism),
+                       std::move(count_mechanism)) {}
+
+  static base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildSumMechanism(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition) {
+    return BoundedMean<T>::BuildSumMechanism(
+        std::move(mechanism_builder), epsilon, l0_sensitivity,
+        max_contributions_per_partition, kLower, kUpper);
+  }
+};
+
+// BoundedVariance with bounds fixed at compile time.
+template <typename T, typename Bounds>
+class StaticBoundedVariance final : public BoundedVariance<T> {
+ public:
+  static constexpr T kLower = static_cast<T>(Bounds::kLower);
+  static constexpr T kUpper = static_cast<T>(Bounds::kUpper);
+  static_assert(!(kUpper < kLower), "Lower bound must not exceed upper bound.");
+
+  class Builder : public AlgorithmBuilder<T, StaticBoundedVariance, Builder> {
+    using AlgorithmBuilder =
+        differential_privacy::AlgorithmBuilder<T, StaticBoundedVariance,
+                                               Builder>;
+
+   private:
+    base::StatusOr<std::unique_ptr<StaticBoundedVariance>> BuildAlgorithm()
+        override {
+      RETURN_IF_ERROR(
+          BoundedVariance<T>::Builder::CheckBounds(kLower, kUpper));
+      const double epsilon = AlgorithmBuilder::GetEpsilon().value();
+      const int l0_sensitivity =
+          AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1);
+      const int max_contributions_per_partition =
+          AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1);
+      std::unique_ptr<NumericalMechanism> sum_mechanism;
+      std::unique_ptr<NumericalMechanism> sos_mechanism;
+      RETURN_IF_ERROR(BuildMechanisms(
+          AlgorithmBuilder::GetMechanismBuilderClone(), epsilon,
+          l0_sensitivity, max_contributions_per_partition, &sum_mechanism,
+          &sos_mechanism));
+      std::unique_ptr<NumericalMechanism> count_mechanism;
+      ASSIGN_OR_RETURN(count_mechanism,
+                       AlgorithmBuilder::GetMechanismBuilderClone()
+                           ->SetEpsilon(epsilon)
+                           .SetL0Sensitivity(l0_sensitivity)
+                           .SetLInfSensitivity(max_contributions_per_partition)
+                           .Build());
+      return absl::WrapUnique(new StaticBoundedVariance(
+          epsilon, l0_sensitivity, max_contributions_per_partition,
+          AlgorithmBuilder::GetMechanismBuilderClone(),
+          std::move(sum_mechanism), std::move(sos_mechanism),
+          std::move(count_mechanism)));
+    }
+  };
+
+  using Algorithm<T>::AddEntries;
+
+  void AddEntry(const T& t) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries);
+    const bool is_number = t == t;
+    const T clamped =
+        is_number ? internal::ClampToStaticBounds<T, Bounds>(t) : 0;
+    this->pos_sum_[0] += clamped;
+    this->pos_sum_of_squares_[0] += static_cast<double>(clamped) * clamped;
+    this->raw_count_ += is_number;
+  }
+
+  void AddEntryWithCount(const T& t, uint64_t num_of_entries) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries, num_of_entries);
+    const bool is_number = t == t;
+    const T clamped =
+        is_number ? internal::ClampToStaticBounds<T, Bounds>(t) : 0;
+    this->pos_sum_[0] =
+        AddMultipleWrapping<T>(this->pos_sum_[0], clamped, num_of_entries);
+    this->pos_sum_of_squares_[0] +=
+        static_cast<double>(clamped) * clamped * num_of_entries;
+    this->raw_count_ += is_number ? num_of_entries : 0;
+  }
+
+  void AddEntries(absl::Span<const T> entries) override {
+    metrics::Add(metrics::Counter::kBoundedVarianceEntries, entries.size());
+    this->raw_count_ += internal::AddClampedEntriesAndSquares<T>(
+        entries, kLower, kUpper, &this->pos_sum_[0],
+        &this->pos_sum_of_squares_[0]);
+  }
+
+ private:
+  StaticBoundedVariance(
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition,
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      std::unique_ptr<NumericalMechanism> sum_mechanism,
+      std::unique_ptr<NumericalMechanism> sos_mechanism,
+      std::unique_ptr<NumericalMechanism> count_mechanism)
+      : BoundedVariance<T>(epsilon, kLower, kUpper, l0_sensitivity,
+                           max_contributions_per_partition,
+                           std::move(mechanism_builder),
+                           std::move(sum_mechanism), std::move(sos_mechanism),
+                           std::move(count_mechanism)) {}
+
+  // Builds the mechanisms for the sum and the sum of squares.
+  static absl::Status BuildMechanisms(
+      std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+      double epsilon, double l0_sensitivity,
+      double max_contributions_per_partition,
+      std::unique_ptr<NumericalMechanism>* sum_mechanism,
+      std::unique_ptr<NumericalMechanism>* sos_mechanism) {
+    ASSIGN_OR_RETURN(*sum_mechanism,
+                     BoundedVariance<T>::BuildSumMechanism(
+                         mechanism_builder->Clone(), epsilon, l0_sensitivity,
+                         max_contributions_per_partition, kLower, kUpper));
+    ASSIGN_OR_RETURN(*sos_mechanism,
+                     BoundedVariance<T>::BuildSumOfSquaresMechanism(
+                         std::move(mechanism_builder), epsilon, l0_sensitivity,
+                         max_contributions_per_partition, kLower, kUpper));
+    return absl::OkStatus();
+  }
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_STATIC_BOUNDS_H_
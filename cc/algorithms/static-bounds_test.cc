@@ -0,0 +1,223 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/static-bounds.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::EqualsProto;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+
+using RatingBounds = StaticBounds<0, 5>;
+
+struct FractionalBounds {
+  static constexpr double kLower = -0.5;
+  static constexpr double kUpper = 2.5;
+};
+
+template <typename T>
+class StaticBoundsTest : public ::testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(StaticBoundsTest, NumericTypes);
+
+// Returns entries with values below, inside and above RatingBounds.
+template <typename T>
+std::vector<T> MakeEntries() {
+  return {-3, 0, 1, 2, 4, 5, 9, 3, 3};
+}
+
+template <typename Algorithm, typename Builder>
+std::unique_ptr<Algorithm> Build(Builder& builder) {
+  base::StatusOr<std::unique_ptr<Algorithm>> algorithm =
+      builder.SetEpsilon(1.0)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  EXPECT_OK(algorithm);
+  return std::move(algorithm.value());
+}
+
+TYPED_TEST(StaticBoundsTest, SumMatchesManualBounds) {
+  using StaticSum = StaticBoundedSum<TypeParam, RatingBounds>;
+  typename StaticSum::Builder static_builder;
+  std::unique_ptr<StaticSum> static_sum = Build<StaticSum>(static_builder);
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedSum<TypeParam>> sum =
+      Build<BoundedSum<TypeParam>>(builder);
+
+  const std::vector<TypeParam> entries = MakeEntries<TypeParam>();
+  for (TypeParam entry : entries) {
+    static_sum->AddEntry(entry);
+  }
+  static_sum->AddEntryWithCount(7, 2);
+  sum->AddEntries(entries);
+  sum->AddEntryWithCount(7, 2);
+  EXPECT_THAT(static_sum->Serialize(), EqualsProto(sum->Serialize()));
+  EXPECT_EQ(static_sum->lower(), 0);
+  EXPECT_EQ(static_sum->upper(), 5);
+
+  // Summaries are interchangeable in both directions.
+  ASSERT_OK(sum->Merge(static_sum->Serialize()));
+  ASSERT_OK(static_sum->Merge(sum->Serialize()));
+  ASSERT_OK(sum->MergeFrom(*static_sum));
+  base::StatusOr<Output> result = sum->PartialResult();
+  ASSERT_OK(result);
+  // Each had 0 + 0 + 1 + 2 + 4 + 5 + 5 + 3 + 3 + 2 * 5 = 33. sum then has
+  // 2 * 33, static_sum 3 * 33, and sum 5 * 33 after merging both.
+  EXPECT_EQ(GetValue<TypeParam>(*result), 165);
+}
+
+TYPED_TEST(StaticBoundsTest, MeanMatchesManualBounds) {
+  using StaticMean = StaticBoundedMean<TypeParam, RatingBounds>;
+  typename StaticMean::Builder static_builder;
+  std::unique_ptr<StaticMean> static_mean = Build<StaticMean>(static_builder);
+  typename BoundedMean<TypeParam>::Builder builder;
+  builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedMean<TypeParam>> mean =
+      Build<BoundedMean<TypeParam>>(builder);
+
+  const std::vector<TypeParam> entries = MakeEntries<TypeParam>();
+  static_mean->AddEntries(entries);
+  static_mean->AddEntryWithCount(-1, 3);
+  static_mean->AddEntry(1);
+  for (TypeParam entry : entries) {
+    mean->AddEntry(entry);
+  }
+  mean->AddEntryWithCount(-1, 3);
+  mean->AddEntry(1);
+  EXPECT_THAT(static_mean->Serialize(), EqualsProto(mean->Serialize()));
+
+  ASSERT_OK(mean->Merge(static_mean->Serialize()));
+  base::StatusOr<Output> result = mean->PartialResult();
+  ASSERT_OK(result);
+  // The clamped entries add up to 24 over 13 entries in both algorithms.
+  EXPECT_NEAR(GetValue<double>(*result), 24.0 / 13, 1e-9);
+}
+
+TYPED_TEST(StaticBoundsTest, VarianceMatchesManualBounds) {
+  using StaticVariance = StaticBoundedVariance<TypeParam, RatingBounds>;
+  typename StaticVariance::Builder static_builder;
+  std::unique_ptr<StaticVariance> static_variance =
+      Build<StaticVariance>(static_builder);
+  typename BoundedVariance<TypeParam>::Builder builder;
+  builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedVariance<TypeParam>> variance =
+      Build<BoundedVariance<TypeParam>>(builder);
+
+  const std::vector<TypeParam> entries = MakeEntries<TypeParam>();
+  static_variance->AddEntries(entries);
+  static_variance->AddEntryWithCount(8, 2);
+  variance->AddEntries(entries);
+  variance->AddEntryWithCount(8, 2);
+  EXPECT_THAT(static_variance->Serialize(),
+              EqualsProto(variance->Serialize()));
+
+  ASSERT_OK(static_variance->MergeFrom(*variance));
+  base::StatusOr<Output> static_result = static_variance->PartialResult();
+  ASSERT_OK(static_result);
+  ASSERT_OK(variance->Merge(variance->Serialize()));
+  base::StatusOr<Output> result = variance->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<double>(*static_result), GetValue<double>(*result),
+              1e-9);
+}
+
+TEST(StaticBoundsTest, LargeCountsWrapLikeManualBounds) {
+  // The clamped value times the count does not fit in an int64_t, and the
+  // count itself does not either.
+  const uint64_t kCount = (uint64_t{1} << 63) + 3;
+  const int64_t kWrapped = static_cast<int64_t>(uint64_t{4} * kCount);
+
+  using StaticSum = StaticBoundedSum<int64_t, RatingBounds>;
+  typename StaticSum::Builder static_sum_builder;
+  std::unique_ptr<StaticSum> static_sum = Build<StaticSum>(static_sum_builder);
+  typename BoundedSum<int64_t>::Builder sum_builder;
+  sum_builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedSum<int64_t>> sum =
+      Build<BoundedSum<int64_t>>(sum_builder);
+  static_sum->AddEntryWithCount(4, kCount);
+  sum->AddEntryWithCount(4, kCount);
+  EXPECT_THAT(static_sum->Serialize(), EqualsProto(sum->Serialize()));
+  base::StatusOr<Output> result = static_sum->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), kWrapped);
+
+  using StaticMean = StaticBoundedMean<int64_t, RatingBounds>;
+  typename StaticMean::Builder static_mean_builder;
+  std::unique_ptr<StaticMean> static_mean =
+      Build<StaticMean>(static_mean_builder);
+  typename BoundedMean<int64_t>::Builder mean_builder;
+  mean_builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedMean<int64_t>> mean =
+      Build<BoundedMean<int64_t>>(mean_builder);
+  static_mean->AddEntryWithCount(4, kCount);
+  mean->AddEntryWithCount(4, kCount);
+  EXPECT_THAT(static_mean->Serialize(), EqualsProto(mean->Serialize()));
+
+  using StaticVariance = StaticBoundedVariance<int64_t, RatingBounds>;
+  typename StaticVariance::Builder static_variance_builder;
+  std::unique_ptr<StaticVariance> static_variance =
+      Build<StaticVariance>(static_variance_builder);
+  typename BoundedVariance<int64_t>::Builder variance_builder;
+  variance_builder.SetLower(0).SetUpper(5);
+  std::unique_ptr<BoundedVariance<int64_t>> variance =
+      Build<BoundedVariance<int64_t>>(variance_builder);
+  static_variance->AddEntryWithCount(4, kCount);
+  variance->AddEntryWithCount(4, kCount);
+  EXPECT_THAT(static_variance->Serialize(),
+              EqualsProto(variance->Serialize()));
+}
+
+TEST(StaticBoundsTest, DropsNanAndClampsToFractionalBounds) {
+  using StaticSum = StaticBoundedSum<double, FractionalBounds>;
+  typename StaticSum::Builder builder;
+  std::unique_ptr<StaticSum> sum = Build<StaticSum>(builder);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  sum->AddEntry(nan);
+  sum->AddEntryWithCount(nan, 3);
+  sum->AddEntries({-10.0, 1.0, nan, 10.0});
+  sum->AddEntryWithCount(-1.0, 2);
+  base::StatusOr<Output> result = sum->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result), -0.5 + 1.0 + 2.5 - 1.0);
+
+  using StaticMean = StaticBoundedMean<double, FractionalBounds>;
+  typename StaticMean::Builder mean_builder;
+  std::unique_ptr<StaticMean> mean = Build<StaticMean>(mean_builder);
+  mean->AddEntry(nan);
+  mean->AddEntries({nan, 2.0, 3.0});
+  base::StatusOr<Output> mean_result = mean->PartialResult();
+  ASSERT_OK(mean_result);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*mean_result), 2.25);
+}
+
+}  // namespace
+}  // namespace differential_privacy
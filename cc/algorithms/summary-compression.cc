@@ -0,0 +1,361 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/summary-compression.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr char kMagic[4] = {'D', 'P', 'S', 'Z'};
+constexpr uint8_t kVersion = 1;
+// Flag of frames whose body is deflated rather than stored.
+constexpr uint8_t kDeflated = 1;
+// Magic, version, flags, two reserved bytes, and the sizes of the serialized
+// batch and of the body.
+constexpr size_t kHeaderSize = sizeof(kMagic) + 4 + 8;
+// deflate compresses by at most about 1032:1, which bounds the size that a
+// frame can claim for its batch.
+constexpr int64_t kMaxCompressionRatio = 1032;
+// Length of the substrings that are counted when training dictionaries.
+constexpr int kDictionaryGramSize = 8;
+
+// Sizes are written in little-endian order, so frames can be sent between
+// machines of different architectures.
+void AppendUint32(uint32_t value, std::string* out) {
+  for (int i = 0; i < 4; ++i) {
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+uint32_t ReadUint32(const char* data) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<unsigned char>(data[i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+uint64_t ReadGram(const char* data) {
+  uint64_t gram;
+  std::memcpy(&gram, data, sizeof(gram));
+  return gram;
+}
+
+uint32_t DictionaryId(absl::string_view bytes) {
+  return adler32(adler32(0, nullptr, 0),
+                 reinterpret_cast<const Bytef*>(bytes.data()), bytes.size());
+}
+
+// Returns the type URL of the data of all summaries, or an empty string if
+// they have different types.
+std::string CommonTypeUrl(absl::Span<const Summary> summaries) {
+  if (summaries.empty()) {
+    return "";
+  }
+  const std::string& type_url = summaries[0].data().type_url();
+  for (const Summary& summary : summaries) {
+    if (summary.data().type_url() != type_url) {
+      return "";
+    }
+  }
+  return type_url;
+}
+
+}  // namespace
+
+SummaryDictionary::SummaryDictionary(std::string type_url, std::string bytes)
+    : type_url_(std::move(type_url)),
+      bytes_(std::move(bytes)),
+      id_(DictionaryId(bytes_)) {}
+
+base::StatusOr<SummaryDictionary> SummaryDictionary::Train(
+    absl::Span<const Summary> samples, int64_t max_size) {
+  if (samples.empty()) {
+    return absl::InvalidArgumentError(
+        "At least one sample summary is needed to train a dictionary.");
+  }
+  if (max_size <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Dictionary size must be positive, but is ", max_size,
+                     "."));
+  }
+  const std::string type_url = samples[0].data().type_url();
+  if (CommonTypeUrl(samples) != type_url) {
+    return absl::InvalidArgumentError(
+        "All sample summaries must have data of the same type.");
+  }
+  std::vector<std::string> serialized;
+  serialized.reserve(samples.size());
+  for (const Summary& sample : samples) {
+    serialized.push_back(sample.SerializeAsString());
+  }
+
+  // Number of samples that contain every gram.
+  absl::flat_hash_map<uint64_t, int64_t> frequency;
+  for (const std::string& sample : serialized) {
+    absl::flat_hash_set<uint64_t> grams;
+    for (size_t i = 0; i + kDictionaryGramSize <= sample.size(); ++i) {
+      grams.insert(ReadGram(sample.data() + i));
+    }
+    for (uint64_t gram : grams) {
+      ++frequency[gram];
+    }
+  }
+
+  // Maximal substrings of the samples whose grams are all common, scored by
+  // the total frequency of their grams.
+  struct Segment {
+    absl::string_view bytes;
+    int64_t score;
+  };
+  const int64_t min_frequency = samples.size() > 1 ? 2 : 1;
+  std::vector<Segment> segments;
+  absl::flat_hash_set<absl::string_view> seen;
+  for (const std::string& sample : serialized) {
+    size_t i = 0;
+    while (i + kDictionaryGramSize <= sample.size()) {
+      if (frequency[ReadGram(sample.data() + i)] < min_frequency) {
+        ++i;
+        continue;
+      }
+      const size_t start = i;
+      int64_t score = 0;
+      for (; i + kDictionaryGramSize <= sample.size(); ++i) {
+        const int64_t gram_frequency = frequency[ReadGram(sample.data() + i)];
+        if (gram_frequency < min_frequency) {
+          break;
+        }
+        score += gram_frequency;
+      }
+      absl::string_view bytes(sample.data() + start,
+                              i - start + kDictionaryGramSize - 1);
+      if (seen.insert(bytes).second) {
+        segments.push_back({bytes, score});
+      }
+    }
+  }
+  std::stable_sort(segments.begin(), segments.end(),
+                   [](const Segment& a, const Segment& b) {
+                     return a.score > b.score;
+                   });
+
+  // Takes the best segments that fit, and writes them in reverse order, so
+  // that the best one is last.
+  std::vector<absl::string_view> selected;
+  int64_t size = 0;
+  for (const Segment& segment : segments) {
+    if (size + static_cast<int64_t>(segment.bytes.size()) <= max_size) {
+      selected.push_back(segment.bytes);
+      size += segment.bytes.size();
+    }
+  }
+  std::string bytes;
+  bytes.reserve(size);
+  for (auto it = selected.rbegin(); it != selected.rend(); ++it) {
+    bytes.append(it->data(), it->size());
+  }
+  if (bytes.empty()) {
+    // The samples are too small or too different to have common grams.
+    const std::string& last = serialized.back();
+    bytes =
+        last.substr(last.size() - std::min<int64_t>(last.size(), max_size));
+  }
+  if (bytes.empty()) {
+    return absl::InvalidArgumentError(
+        "Sample summaries are empty, so no dictionary can be trained.");
+  }
+  return SummaryDictionary(type_url, std::move(bytes));
+}
+
+SummaryCodec::SummaryCodec(int compression_level)
+    : compression_level_(compression_level) {}
+
+absl::Status SummaryCodec::AddDictionary(SummaryDictionary dictionary) {
+  if (dictionary.bytes().empty()) {
+    return absl::InvalidArgumentError("Summary dictionary must not be empty.");
+  }
+  if (by_type_url_.contains(dictionary.type_url())) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("There already is a summary dictionary for ",
+                     dictionary.type_url(), "."));
+  }
+  if (!by_id_.emplace(dictionary.id(), dictionary.type_url()).second) {
+    return absl::InvalidArgumentError(
+        "There already is a summary dictionary with the same id.");
+  }
+  std::string type_url = dictionary.type_url();
+  by_type_url_.emplace(std::move(type_url), std::move(dictionary));
+  return absl::OkStatus();
+}
+
+absl::Status SummaryCodec::AppendBatch(absl::Span<const Summary> summaries,
+                                       std::string* out) const {
+  SummaryBatch batch;
+  batch.mutable_summary()->Reserve(summaries.size());
+  for (const Summary& summary : summaries) {
+    *batch.add_summary() = summary;
+  }
+  std::string raw = batch.SerializeAsString();
+  const size_t raw_size = raw.size();
+  if (raw_size > std::numeric_limits<uint32_t>::max()) {
+    return absl::InvalidArgumentError(
+        "Summary batch is too large for one frame.");
+  }
+
+  const SummaryDictionary* dictionary = nullptr;
+  const std::string type_url = CommonTypeUrl(summaries);
+  if (!type_url.empty()) {
+    auto it = by_type_url_.find(type_url);
+    if (it != by_type_url_.end()) {
+      dictionary = &it->second;
+    }
+  }
+  ASSIGN_OR_RETURN(std::string body, Compress(raw, dictionary));
+  uint8_t flags = kDeflated;
+  if (body.size() >= raw.size()) {
+    body = std::move(raw);
+    flags = 0;
+  }
+
+  out->reserve(out->size() + kHeaderSize + body.size());
+  out->append(kMagic, sizeof(kMagic));
+  out->push_back(static_cast<char>(kVersion));
+  out->push_back(static_cast<char>(flags));
+  out->append(2, '\0');
+  AppendUint32(raw_size, out);
+  AppendUint32(body.size(), out);
+  out->append(body);
+  return absl::OkStatus();
+}
+
+base::StatusOr<std::vector<Summary>> SummaryCodec::ReadBatches(
+    absl::string_view data) const {
+  std::vector<Summary> summaries;
+  std::string raw;
+  while (!data.empty()) {
+    if (data.size() < kHeaderSize ||
+        std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+      return absl::InvalidArgumentError("Data is not a summary batch frame.");
+    }
+    const uint8_t version = data[sizeof(kMagic)];
+    const uint8_t flags = data[sizeof(kMagic) + 1];
+    if (version != kVersion || (flags & ~kDeflated) != 0) {
+      return absl::InvalidArgumentError(
+          "Summary batch frame has an unsupported version.");
+    }
+    const uint32_t raw_size = ReadUint32(data.data() + sizeof(kMagic) + 4);
+    const uint32_t body_size = ReadUint32(data.data() + sizeof(kMagic) + 8);
+    if (body_size > data.size() - kHeaderSize) {
+      return absl::InvalidArgumentError("Summary batch frame is truncated.");
+    }
+    absl::string_view body = data.substr(kHeaderSize, body_size);
+    data.remove_prefix(kHeaderSize + body_size);
+
+    if (flags & kDeflated) {
+      if (raw_size > kMaxCompressionRatio * body_size + kHeaderSize) {
+        return absl::InvalidArgumentError("Summary batch frame is corrupt.");
+      }
+      raw.resize(raw_size);
+      RETURN_IF_ERROR(Decompress(body, &raw));
+      body = raw;
+    } else if (raw_size != body_size) {
+      return absl::InvalidArgumentError("Summary batch frame is corrupt.");
+    }
+    SummaryBatch batch;
+    if (!batch.ParseFromArray(body.data(), body.size())) {
+      return absl::InvalidArgumentError("Summary batch cannot be parsed.");
+    }
+    summaries.reserve(summaries.size() + batch.summary_size());
+    for (Summary& summary : *batch.mutable_summary()) {
+      summaries.push_back(std::move(summary));
+    }
+  }
+  return summaries;
+}
+
+base::StatusOr<std::string> SummaryCodec::Compress(
+    absl::string_view raw, const SummaryDictionary* dictionary) const {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (deflateInit(&stream, compression_level_) != Z_OK) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Invalid summary compression level ", compression_level_, "."));
+  }
+  if (dictionary != nullptr) {
+    deflateSetDictionary(
+        &stream, reinterpret_cast<const Bytef*>(dictionary->bytes().data()),
+        dictionary->bytes().size());
+  }
+  std::string body(deflateBound(&stream, raw.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(raw.data()));
+  stream.avail_in = raw.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&body[0]);
+  stream.avail_out = body.size();
+  const int result = deflate(&stream, Z_FINISH);
+  body.resize(stream.total_out);
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END) {
+    return absl::InternalError("Summary batch cannot be compressed.");
+  }
+  return body;
+}
+
+absl::Status SummaryCodec::Decompress(absl::string_view body,
+                                      std::string* raw) const {
+  z_stream stream;
+  std::memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK) {
+    return absl::InternalError("Summary batch cannot be decompressed.");
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+  stream.avail_in = body.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&(*raw)[0]);
+  stream.avail_out = raw->size();
+  int result = inflate(&stream, Z_FINISH);
+  if (result == Z_NEED_DICT) {
+    auto it = by_id_.find(stream.adler);
+    if (it == by_id_.end()) {
+      inflateEnd(&stream);
+      return absl::InvalidArgumentError(
+          "Summary batch was compressed with an unknown dictionary.");
+    }
+    const std::string& dictionary = by_type_url_.at(it->second).bytes();
+    inflateSetDictionary(&stream,
+                         reinterpret_cast<const Bytef*>(dictionary.data()),
+                         dictionary.size());
+    result = inflate(&stream, Z_FINISH);
+  }
+  const bool complete = result == Z_STREAM_END && stream.avail_in == 0 &&
+                        stream.total_out == raw->size();
+  inflateEnd(&stream);
+  if (!complete) {
+    return absl::InvalidArgumentError("Summary batch frame is corrupt.");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace differential_privacy
@@ -0,0 +1,130 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_SUMMARY_COMPRESSION_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_SUMMARY_COMPRESSION_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Compresses batches of summaries, e.g., the summaries of all partitions that
+// a mapper sends to a reducer, for transport over the network:
+//
+//   SummaryCodec codec;
+//   RETURN_IF_ERROR(codec.AddDictionary(dictionary));
+//   std::string frames;
+//   RETURN_IF_ERROR(codec.AppendBatch(summaries, &frames));
+//   ...
+//   RETURN_IF_ERROR(codec.MergeBatches(frames, *algorithm));
+//
+// Every batch is one frame: a 16-byte header followed by the SummaryBatch
+// proto of the summaries, compressed with zlib. Frames can be concatenated,
+// and are decoded in order. Summaries of the same type repeat the same type
+// URL and similar bins and fields, so that batches compress well, and even
+// better with a dictionary trained on sample summaries of the type.
+
+// Default maximum size of trained dictionaries. zlib only uses the last 32 KiB
+// of a dictionary.
+constexpr int64_t kDefaultSummaryDictionarySize = 16 << 10;
+
+// Default zlib compression level, from 1 (fastest) to 9 (smallest).
+constexpr int kDefaultSummaryCompressionLevel = 6;
+
+// A zlib preset dictionary for the summaries whose data has a given type URL.
+// Compressor and decompressor must use the same dictionary, which is
+// identified in the compressed data by its Adler-32 checksum.
+class SummaryDictionary {
+ public:
+  SummaryDictionary(std::string type_url, std::string bytes);
+
+  // Trains a dictionary of at most max_size bytes on sample summaries, which
+  // must all have data of the same type. The dictionary holds the substrings
+  // that occur in the most samples, the most common ones last, which is where
+  // zlib finds them at the smallest distance.
+  static base::StatusOr<SummaryDictionary> Train(
+      absl::Span<const Summary> samples,
+      int64_t max_size = kDefaultSummaryDictionarySize);
+
+  const std::string& type_url() const { return type_url_; }
+  const std::string& bytes() const { return bytes_; }
+  uint32_t id() const { return id_; }
+
+ private:
+  std::string type_url_;
+  std::string bytes_;
+  uint32_t id_;
+};
+
+// Compresses and decompresses batches of summaries with a set of
+// dictionaries. Thread safe once all dictionaries are added.
+class SummaryCodec {
+ public:
+  explicit SummaryCodec(
+      int compression_level = kDefaultSummaryCompressionLevel);
+
+  // Adds a dictionary that compresses batches of summaries of its type, and
+  // decompresses batches that were compressed with it. Fails if there is
+  // already a dictionary of the type, or with the same id.
+  absl::Status AddDictionary(SummaryDictionary dictionary);
+
+  // Appends a frame of the compressed summaries to out. The dictionary of the
+  // summaries' type is used if they all have the same type. The batch is
+  // stored uncompressed if it does not compress.
+  absl::Status AppendBatch(absl::Span<const Summary> summaries,
+                           std::string* out) const;
+
+  // Returns the summaries of all frames of data, in order.
+  base::StatusOr<std::vector<Summary>> ReadBatches(
+      absl::string_view data) const;
+
+  // Merges the summaries of all frames of data into algorithm, in order.
+  template <typename T>
+  absl::Status MergeBatches(absl::string_view data,
+                            Algorithm<T>& algorithm) const {
+    ASSIGN_OR_RETURN(std::vector<Summary> summaries, ReadBatches(data));
+    for (const Summary& summary : summaries) {
+      RETURN_IF_ERROR(algorithm.Merge(summary));
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  base::StatusOr<std::string> Compress(absl::string_view raw,
+                                       const SummaryDictionary* dictionary)
+      const;
+  absl::Status Decompress(absl::string_view body, std::string* raw) const;
+
+  const int compression_level_;
+  absl::flat_hash_map<std::string, SummaryDictionary> by_type_url_;
+  // Type URL of every dictionary id.
+  absl::flat_hash_map<uint32_t, std::string> by_id_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_SUMMARY_COMPRESSION_H_
@@ -0,0 +1,191 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/summary-compression.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/testing/proto_matchers.h"
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/approx-bounds.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::base::testing::EqualsProto;
+using ::differential_privacy::base::testing::StatusIs;
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+
+std::unique_ptr<Count<double>> MakeCount() {
+  return Count<double>::Builder()
+      .SetEpsilon(1)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+      .Build()
+      .ValueOrDie();
+}
+
+void ExpectSummariesEq(const std::vector<Summary>& summaries,
+                       const std::vector<Summary>& expected) {
+  ASSERT_EQ(summaries.size(), expected.size());
+  for (int i = 0; i < summaries.size(); ++i) {
+    EXPECT_THAT(summaries[i], EqualsProto(expected[i]));
+  }
+}
+
+// Returns summaries of approximate bounds of similar partitions.
+std::vector<Summary> ApproxBoundsSummaries(int num_partitions) {
+  std::vector<Summary> summaries;
+  for (int partition = 0; partition < num_partitions; ++partition) {
+    std::unique_ptr<ApproxBounds<double>> bounds =
+        ApproxBounds<double>::Builder()
+            .SetEpsilon(1)
+            .SetMaxContributionsPerPartition(1)
+            .Build()
+            .ValueOrDie();
+    for (int i = 0; i < 20 + partition % 7; ++i) {
+      bounds->AddEntry((i * 37 + partition) % 1000 - 100);
+    }
+    summaries.push_back(bounds->Serialize());
+  }
+  return summaries;
+}
+
+TEST(SummaryCompressionTest, RoundTripsFramesOfMixedSummaries) {
+  std::unique_ptr<Count<double>> count = MakeCount();
+  count->AddEntries({1, 2, 3});
+  std::vector<Summary> first = ApproxBoundsSummaries(10);
+  first.push_back(count->Serialize());
+  const std::vector<Summary> second = ApproxBoundsSummaries(3);
+
+  SummaryCodec codec;
+  std::string frames;
+  ASSERT_OK(codec.AppendBatch(first, &frames));
+  ASSERT_OK(codec.AppendBatch({}, &frames));
+  ASSERT_OK(codec.AppendBatch(second, &frames));
+
+  std::vector<Summary> expected = first;
+  expected.insert(expected.end(), second.begin(), second.end());
+  base::StatusOr<std::vector<Summary>> summaries = codec.ReadBatches(frames);
+  ASSERT_OK(summaries);
+  ExpectSummariesEq(*summaries, expected);
+}
+
+TEST(SummaryCompressionTest, DictionaryShrinksSmallBatches) {
+  const std::vector<Summary> samples = ApproxBoundsSummaries(200);
+  base::StatusOr<SummaryDictionary> dictionary =
+      SummaryDictionary::Train(samples);
+  ASSERT_OK(dictionary);
+  EXPECT_GT(dictionary->bytes().size(), 0);
+  EXPECT_LE(dictionary->bytes().size(), kDefaultSummaryDictionarySize);
+  EXPECT_EQ(dictionary->type_url(), samples[0].data().type_url());
+
+  SummaryCodec plain;
+  SummaryCodec trained;
+  ASSERT_OK(trained.AddDictionary(*dictionary));
+  const std::vector<Summary> batch(samples.begin() + 100,
+                                   samples.begin() + 104);
+  std::string plain_frame;
+  std::string trained_frame;
+  ASSERT_OK(plain.AppendBatch(batch, &plain_frame));
+  ASSERT_OK(trained.AppendBatch(batch, &trained_frame));
+  EXPECT_LT(trained_frame.size(), plain_frame.size());
+
+  base::StatusOr<std::vector<Summary>> summaries =
+      trained.ReadBatches(trained_frame);
+  ASSERT_OK(summaries);
+  ExpectSummariesEq(*summaries, batch);
+  EXPECT_THAT(plain.ReadBatches(trained_frame),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unknown dictionary")));
+  // Frames without a dictionary can be read by any codec.
+  EXPECT_OK(trained.ReadBatches(plain_frame));
+}
+
+TEST(SummaryCompressionTest, MergeBatches) {
+  std::vector<Summary> summaries;
+  for (int i = 1; i <= 5; ++i) {
+    std::unique_ptr<Count<double>> count = MakeCount();
+    for (int j = 0; j < i; ++j) {
+      count->AddEntry(j);
+    }
+    summaries.push_back(count->Serialize());
+  }
+  SummaryCodec codec;
+  std::string frames;
+  ASSERT_OK(codec.AppendBatch(summaries, &frames));
+
+  std::unique_ptr<Count<double>> merged = MakeCount();
+  ASSERT_OK(codec.MergeBatches(frames, *merged));
+  EXPECT_EQ(GetValue<int64_t>(merged->PartialResult().ValueOrDie()), 15);
+}
+
+TEST(SummaryCompressionTest, RejectsCorruptFrames) {
+  SummaryCodec codec;
+  std::string frames;
+  ASSERT_OK(codec.AppendBatch(ApproxBoundsSummaries(20), &frames));
+
+  EXPECT_THAT(codec.ReadBatches(frames.substr(0, frames.size() - 1)),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("truncated")));
+  EXPECT_THAT(codec.ReadBatches("not a frame"),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("not a summary batch")));
+  std::string corrupt = frames;
+  corrupt[corrupt.size() / 2] ^= 0x55;
+  EXPECT_THAT(codec.ReadBatches(corrupt),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  std::string new_version = frames;
+  new_version[4] = 2;
+  EXPECT_THAT(codec.ReadBatches(new_version),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("unsupported version")));
+}
+
+TEST(SummaryCompressionTest, ValidatesDictionaries) {
+  std::vector<Summary> samples = ApproxBoundsSummaries(5);
+  EXPECT_THAT(SummaryDictionary::Train({}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(SummaryDictionary::Train(samples, 0),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  samples.push_back(MakeCount()->Serialize());
+  EXPECT_THAT(SummaryDictionary::Train(samples),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("same type")));
+  samples.pop_back();
+
+  base::StatusOr<SummaryDictionary> dictionary =
+      SummaryDictionary::Train(samples);
+  ASSERT_OK(dictionary);
+  SummaryCodec codec;
+  ASSERT_OK(codec.AddDictionary(*dictionary));
+  EXPECT_THAT(
+      codec.AddDictionary(SummaryDictionary(samples[0].data().type_url(), "x")),
+      StatusIs(absl::StatusCode::kInvalidArgument, HasSubstr("already")));
+  EXPECT_THAT(codec.AddDictionary(SummaryDictionary("type", "")),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+}  // namespace
+}  // namespace differential_privacy
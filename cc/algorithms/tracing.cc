@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/tracing.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+
+#include "base/logging.h"
+
+namespace differential_privacy {
+namespace tracing {
+
+absl::string_view TracePointName(TracePoint point) {
+  switch (point) {
+    case TracePoint::kPartialResult:
+      return "PartialResult";
+    case TracePoint::kGenerateResult:
+      return "GenerateResult";
+    case TracePoint::kMerge:
+      return "Merge";
+    case TracePoint::kSerialize:
+      return "Serialize";
+    case TracePoint::kBinarySearchIteration:
+      return "BinarySearchIteration";
+    case TracePoint::kApproxBoundsThresholdSearch:
+      return "ApproxBoundsThresholdSearch";
+    case TracePoint::kNumTracePoints:
+      break;
+  }
+  return "Unknown";
+}
+
+void SetTraceSink(TraceSink* sink) {
+  internal::trace_sink.store(sink, std::memory_order_release);
+}
+
+RingBufferTraceSink::RingBufferTraceSink(int capacity) {
+  CHECK_GT(capacity, 0);
+  spans_.resize(capacity);
+}
+
+void RingBufferTraceSink::EndSpan(const SpanRecord& span) {
+  absl::MutexLock lock(&mutex_);
+  spans_[num_spans_ % spans_.size()] = span;
+  ++num_spans_;
+}
+
+std::vector<SpanRecord> RingBufferTraceSink::Spans() const {
+  absl::MutexLock lock(&mutex_);
+  const int64_t capacity = spans_.size();
+  if (num_spans_ <= capacity) {
+    return std::vector<SpanRecord>(spans_.begin(), spans_.begin() + num_spans_);
+  }
+  // The oldest kept span is at the slot that the next span would overwrite.
+  std::vector<SpanRecord> spans;
+  spans.reserve(capacity);
+  const int64_t oldest = num_spans_ % capacity;
+  spans.insert(spans.end(), spans_.begin() + oldest, spans_.end());
+  spans.insert(spans.end(), spans_.begin(), spans_.begin() + oldest);
+  return spans;
+}
+
+int64_t RingBufferTraceSink::NumDropped() const {
+  absl::MutexLock lock(&mutex_);
+  return std::max<int64_t>(0, num_spans_ - spans_.size());
+}
+
+namespace internal {
+
+std::atomic<TraceSink*> trace_sink{nullptr};
+
+int64_t NowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace internal
+}  // namespace tracing
+}  // namespace differential_privacy
@@ -0,0 +1,168 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_TRACING_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_TRACING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+
+namespace differential_privacy {
+namespace tracing {
+
+// Scoped trace points around the phases of releasing and aggregating results,
+// to attribute latency to the phases of the library.
+//
+// Tracing is compiled out unless the library is built with
+// --define dp_tracing=enabled, which defines
+// DIFFERENTIAL_PRIVACY_ENABLE_TRACING. When it is compiled in, spans are only
+// recorded while a sink is set, and cost a relaxed atomic load otherwise.
+enum class TracePoint {
+  // Algorithm::PartialResult and PartialResultValue, including the budget
+  // accounting.
+  kPartialResult,
+  // The GenerateResult or GenerateResultValue call of PartialResult.
+  kGenerateResult,
+  kMerge,
+  kSerialize,
+  // One iteration of the search of BinarySearch::BayesianSearch.
+  kBinarySearchIteration,
+  // The noising of the bins of ApproxBounds and the search for the bins above
+  // the threshold.
+  kApproxBoundsThresholdSearch,
+  kNumTracePoints
+};
+
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_TRACING
+constexpr bool kTracingEnabled = true;
+#else
+constexpr bool kTracingEnabled = false;
+#endif
+
+// Returns a name for point, e.g., "Merge".
+absl::string_view TracePointName(TracePoint point);
+
+// A finished span.
+struct SpanRecord {
+  TracePoint point;
+  // Start time on the steady clock, in nanoseconds.
+  int64_t start_ns;
+  int64_t duration_ns;
+  // The number of enclosing spans on the same thread, e.g., 1 for the
+  // GenerateResult span inside a PartialResult span.
+  int depth;
+};
+
+// Receives the spans. Sinks are called on the thread that runs the traced code,
+// from any number of threads at once, so they must be thread-safe and should
+// be cheap.
+class TraceSink {
+ public:
+  virtual ~TraceSink() = default;
+
+  // Called when a span starts, e.g., for adapters that start a span of their
+  // own tracing library so that it nests with the spans of the caller.
+  virtual void BeginSpan(TracePoint /*point*/) {}
+
+  // Called when the span ends, on the thread it started on.
+  virtual void EndSpan(const SpanRecord& span) = 0;
+};
+
+// Sets the sink that receives all subsequent spans. The sink is not owned and
+// must outlive all spans started while it is set. nullptr stops tracing.
+void SetTraceSink(TraceSink* sink);
+
+// Keeps the most recent spans in a fixed-size array, e.g., to be dumped when a
+// slow request is detected.
+class RingBufferTraceSink : public TraceSink {
+ public:
+  // capacity must be positive.
+  explicit RingBufferTraceSink(int capacity);
+
+  void EndSpan(const SpanRecord& span) override ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the kept spans in the order in which they ended.
+  std::vector<SpanRecord> Spans() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of spans that were overwritten by newer ones.
+  int64_t NumDropped() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::vector<SpanRecord> spans_ ABSL_GUARDED_BY(mutex_);
+  // The total number of spans received.
+  int64_t num_spans_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+namespace internal {
+
+extern std::atomic<TraceSink*> trace_sink;
+
+int64_t NowNanos();
+
+inline int& SpanDepth() {
+  static thread_local int depth = 0;
+  return depth;
+}
+
+}  // namespace internal
+
+// Records a span from construction to destruction if a sink is set.
+class ScopedSpan {
+ public:
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_TRACING
+  explicit ScopedSpan(TracePoint point)
+      : sink_(internal::trace_sink.load(std::memory_order_acquire)) {
+    if (sink_ != nullptr) {
+      point_ = point;
+      depth_ = internal::SpanDepth()++;
+      sink_->BeginSpan(point);
+      start_ns_ = internal::NowNanos();
+    }
+  }
+
+  ~ScopedSpan() {
+    if (sink_ != nullptr) {
+      const int64_t end_ns = internal::NowNanos();
+      --internal::SpanDepth();
+      sink_->EndSpan({point_, start_ns_, end_ns - start_ns_, depth_});
+    }
+  }
+#else
+  explicit ScopedSpan(TracePoint /*point*/) {}
+#endif
+
+  ScopedSpan(const ScopedSpan&) = delete;
+  ScopedSpan& operator=(const ScopedSpan&) = delete;
+
+#ifdef DIFFERENTIAL_PRIVACY_ENABLE_TRACING
+ private:
+  TraceSink* sink_;
+  TracePoint point_;
+  int64_t start_ns_;
+  int depth_;
+#endif
+};
+
+}  // namespace tracing
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_TRACING_H_
@@ -0,0 +1,189 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/tracing.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/order-statistics.h"
+
+namespace differential_privacy {
+namespace tracing {
+namespace {
+
+using ::testing::Contains;
+using ::testing::ElementsAre;
+using ::testing::Field;
+
+SpanRecord MakeSpan(int64_t start_ns) {
+  return {TracePoint::kMerge, start_ns, /*duration_ns=*/1, /*depth=*/0};
+}
+
+std::vector<int64_t> StartTimes(const std::vector<SpanRecord>& spans) {
+  std::vector<int64_t> start_times;
+  for (const SpanRecord& span : spans) {
+    start_times.push_back(span.start_ns);
+  }
+  return start_times;
+}
+
+std::vector<TracePoint> Points(const std::vector<SpanRecord>& spans) {
+  std::vector<TracePoint> points;
+  for (const SpanRecord& span : spans) {
+    points.push_back(span.point);
+  }
+  return points;
+}
+
+// Sets the sink for the duration of a test.
+class ScopedSink {
+ public:
+  explicit ScopedSink(TraceSink* sink) { SetTraceSink(sink); }
+  ~ScopedSink() { SetTraceSink(nullptr); }
+};
+
+TEST(RingBufferTraceSinkTest, KeepsSpansInOrder) {
+  RingBufferTraceSink sink(4);
+  sink.EndSpan(MakeSpan(1));
+  sink.EndSpan(MakeSpan(2));
+  EXPECT_THAT(StartTimes(sink.Spans()), ElementsAre(1, 2));
+  EXPECT_EQ(sink.NumDropped(), 0);
+}
+
+TEST(RingBufferTraceSinkTest, OverwritesOldestSpans) {
+  RingBufferTraceSink sink(3);
+  for (int i = 1; i <= 5; ++i) {
+    sink.EndSpan(MakeSpan(i));
+  }
+  EXPECT_THAT(StartTimes(sink.Spans()), ElementsAre(3, 4, 5));
+  EXPECT_EQ(sink.NumDropped(), 2);
+}
+
+TEST(TracingTest, TracePointNames) {
+  EXPECT_EQ(TracePointName(TracePoint::kPartialResult), "PartialResult");
+  EXPECT_EQ(TracePointName(TracePoint::kBinarySearchIteration),
+            "BinarySearchIteration");
+}
+
+TEST(TracingTest, RecordsNothingWithoutSink) {
+  RingBufferTraceSink sink(8);
+  { ScopedSpan span(TracePoint::kMerge); }
+  EXPECT_TRUE(sink.Spans().empty());
+}
+
+TEST(TracingTest, TracesResult) {
+  RingBufferTraceSink sink(8);
+  ScopedSink scoped_sink(&sink);
+  std::unique_ptr<Count<double>> count =
+      Count<double>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  count->AddEntry(1);
+  ASSERT_OK(count->PartialResult());
+  if (!kTracingEnabled) {
+    EXPECT_TRUE(sink.Spans().empty());
+    return;
+  }
+  const std::vector<SpanRecord> spans = sink.Spans();
+  // The inner span ends first.
+  EXPECT_THAT(Points(spans), ElementsAre(TracePoint::kGenerateResult,
+                                         TracePoint::kPartialResult));
+  EXPECT_EQ(spans[0].depth, 1);
+  EXPECT_EQ(spans[1].depth, 0);
+  EXPECT_GE(spans[0].start_ns, spans[1].start_ns);
+  EXPECT_LE(spans[0].duration_ns, spans[1].duration_ns);
+}
+
+TEST(TracingTest, TracesSerializeAndMerge) {
+  if (!kTracingEnabled) GTEST_SKIP() << "Tracing is compiled out.";
+  RingBufferTraceSink sink(8);
+  ScopedSink scoped_sink(&sink);
+  std::unique_ptr<BoundedSum<double>> sum = BoundedSum<double>::Builder()
+                                                .SetEpsilon(1)
+                                                .SetLower(0)
+                                                .SetUpper(10)
+                                                .Build()
+                                                .ValueOrDie();
+  ASSERT_OK(sum->Merge(sum->Serialize()));
+  EXPECT_THAT(Points(sink.Spans()),
+              ElementsAre(TracePoint::kSerialize, TracePoint::kMerge));
+}
+
+TEST(TracingTest, TracesSearchPhases) {
+  if (!kTracingEnabled) GTEST_SKIP() << "Tracing is compiled out.";
+  RingBufferTraceSink sink(1000);
+  ScopedSink scoped_sink(&sink);
+  std::unique_ptr<continuous::Median<double>> median =
+      continuous::Median<double>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<BoundedSum<double>> sum = BoundedSum<double>::Builder()
+                                                .SetEpsilon(1)
+                                                .Build()
+                                                .ValueOrDie();
+  for (int i = 0; i < 1000; ++i) {
+    median->AddEntry(i % 10);
+    sum->AddEntry(i % 10);
+  }
+  ASSERT_OK(median->PartialResult());
+  ASSERT_OK(sum->PartialResult());
+  const std::vector<SpanRecord> spans = sink.Spans();
+  EXPECT_THAT(spans, Contains(Field(&SpanRecord::point,
+                                    TracePoint::kBinarySearchIteration)));
+  EXPECT_THAT(spans, Contains(Field(&SpanRecord::point,
+                                    TracePoint::kApproxBoundsThresholdSearch)));
+}
+
+// Checks that BeginSpan and EndSpan are paired.
+class CountingSink : public TraceSink {
+ public:
+  void BeginSpan(TracePoint point) override { ++num_open_; }
+  void EndSpan(const SpanRecord& span) override {
+    --num_open_;
+    ++num_ended_;
+  }
+
+  int num_open() const { return num_open_; }
+  int num_ended() const { return num_ended_; }
+
+ private:
+  int num_open_ = 0;
+  int num_ended_ = 0;
+};
+
+TEST(TracingTest, PairsBeginAndEnd) {
+  CountingSink sink;
+  ScopedSink scoped_sink(&sink);
+  {
+    ScopedSpan outer(TracePoint::kPartialResult);
+    ScopedSpan inner(TracePoint::kGenerateResult);
+  }
+  EXPECT_EQ(sink.num_open(), 0);
+  EXPECT_EQ(sink.num_ended(), kTracingEnabled ? 2 : 0);
+}
+
+}  // namespace
+}  // namespace tracing
+}  // namespace differential_privacy
@@ -46,19 +46,26 @@ double DefaultEpsilon() { return std::log(3); }
 
 double GetNextPowerOfTwo(double n) { return pow(2.0, ceil(log2(n))); }
 
+namespace {
+
+constexpr double kInverseErrorLessThanFiveConstants[] = {
+    0.0000000281022636, 0.000000343273939, -0.0000035233877,
+    -0.00000439150654,  0.00021858087,     -0.00125372503,
+    -0.00417768164,     0.246640727,       1.50140941};
+constexpr double kInverseErrorGreaterThanFiveConstants[] = {
+    -0.000200214257, 0.000100950558, 0.00134934322,
+    -0.00367342844,  0.00573950773,  -0.0076224613,
+    0.00943887047,   1.00167406,     2.83297682};
+
+constexpr double kQnormC[] = {2.515517, 0.802853, 0.010328};
+constexpr double kQnormD[] = {1.432788, 0.189269, 0.001308};
+
+}  // namespace
+
 double InverseErrorFunction(double x) {
-  double LESS_THAN_FIVE_CONSTANTS[] = {
-      0.0000000281022636, 0.000000343273939, -0.0000035233877,
-      -0.00000439150654,  0.00021858087,     -0.00125372503,
-      -0.00417768164,     0.246640727,       1.50140941};
-  double GREATER_THAN_FIVE_CONSTANTS[] = {
-      -0.000200214257, 0.000100950558, 0.00134934322,
-      -0.00367342844,  0.00573950773,  -0.0076224613,
-      0.00943887047,   1.00167406,     2.83297682};
-
-  double constantArray[9];
   double w = -std::log((1 - x) * (1 + x));
   double ans = 0;
+  const double* constants;
 
   if (std::abs(x) == 1) {
     return x * std::numeric_limits<double>::infinity();
@@ -66,17 +73,14 @@ double InverseErrorFunction(double x) {
 
   if (w < 5) {
     w = w - 2.5;
-    std::copy(std::begin(LESS_THAN_FIVE_CONSTANTS),
-              std::end(LESS_THAN_FIVE_CONSTANTS), std::begin(constantArray));
+    constants = kInverseErrorLessThanFiveConstants;
   } else {
     w = std::sqrt(w) - 3;
-    std::copy(std::begin(GREATER_THAN_FIVE_CONSTANTS),
-              std::end(GREATER_THAN_FIVE_CONSTANTS), std::begin(constantArray));
+    constants = kInverseErrorGreaterThanFiveConstants;
   }
 
   for (int i = 0; i < 9; i++) {
-    double coefficient = constantArray[i];
-    ans = coefficient + ans * w;
+    ans = constants[i] + ans * w;
   }
 
   return ans * x;
@@ -88,16 +92,60 @@ base::StatusOr<double> Qnorm(double p, double mu, double sigma) {
         "Probability must be between 0 and 1, exclusive.");
   }
   double t = std::sqrt(-2.0 * log(std::min(p, 1.0 - p)));
-  std::vector<double> c = {2.515517, 0.802853, 0.010328};
-  std::vector<double> d = {1.432788, 0.189269, 0.001308};
-  double normalized = t - ((c[2] * t + c[1]) * t + c[0]) /
-                              (((d[2] * t + d[1]) * t + d[0]) * t + 1.0);
+  double normalized =
+      t - ((kQnormC[2] * t + kQnormC[1]) * t + kQnormC[0]) /
+              (((kQnormD[2] * t + kQnormD[1]) * t + kQnormD[0]) * t + 1.0);
   if (p < .5) {
     normalized *= -1;
   }
   return normalized * sigma + mu;
 }
 
+void InverseErrorFunction(absl::Span<const double> x, absl::Span<double> out) {
+  DCHECK_EQ(x.size(), out.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    const double xi = x[i];
+    const double w = -std::log((1 - xi) * (1 + xi));
+    const double w_less = w - 2.5;
+    const double w_greater = std::sqrt(w) - 3;
+    double ans_less = 0;
+    double ans_greater = 0;
+    for (int j = 0; j < 9; j++) {
+      ans_less = kInverseErrorLessThanFiveConstants[j] + ans_less * w_less;
+      ans_greater =
+          kInverseErrorGreaterThanFiveConstants[j] + ans_greater * w_greater;
+    }
+    const double ans = (w < 5 ? ans_less : ans_greater) * xi;
+    out[i] = std::abs(xi) == 1 ? xi * std::numeric_limits<double>::infinity()
+                               : ans;
+  }
+}
+
+absl::Status Qnorm(absl::Span<const double> p, absl::Span<double> out,
+                   double mu, double sigma) {
+  if (p.size() != out.size()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Input and output of batched Qnorm must have the same size, but are of "
+        "size ",
+        p.size(), " and ", out.size(), "."));
+  }
+  for (double pi : p) {
+    if (pi <= 0.0 || pi >= 1.0) {
+      return absl::InvalidArgumentError(
+          "Probability must be between 0 and 1, exclusive.");
+    }
+  }
+  for (size_t i = 0; i < p.size(); ++i) {
+    const double pi = p[i];
+    const double t = std::sqrt(-2.0 * std::log(std::min(pi, 1.0 - pi)));
+    double normalized =
+        t - ((kQnormC[2] * t + kQnormC[1]) * t + kQnormC[0]) /
+                (((kQnormD[2] * t + kQnormD[1]) * t + kQnormD[0]) * t + 1.0);
+    out[i] = (pi < .5 ? -normalized : normalized) * sigma + mu;
+  }
+  return absl::OkStatus();
+}
+
 double RoundToNearestMultiple(double n, double base) {
   if (base == 0.0) return n;
   double remainder = fmod(n, base);
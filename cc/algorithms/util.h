@@ -30,6 +30,7 @@
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
 #include "base/status_macros.h"
 
 namespace differential_privacy {
@@ -64,12 +65,27 @@ double sign(double n);
 // (https://people.maths.ox.ac.uk/gilesm/files/gems_erfinv.pdf).
 double InverseErrorFunction(double x);
 
+// Batch version of InverseErrorFunction that writes the approximation for each
+// element of x to the element of out at the same index. Evaluates both
+// polynomial branches and selects between them, so that the loop has no
+// data-dependent control flow and can be vectorized. Produces the same values
+// as the scalar version. x and out must have the same size and may be the same
+// span.
+void InverseErrorFunction(absl::Span<const double> x, absl::Span<double> out);
+
 // Estimation of the inverse cdf of the normal distribution centered at mu with
 // standard deviation sigma, at probability p. Based on Abramowitz and Stegun
 // formula 26.2.23. The error of the estimation is bounded by 4.5 e-4. This
 // function will fail if higher accuracy is required.
 base::StatusOr<double> Qnorm(double p, double mu = 0.0, double sigma = 1.0);
 
+// Batch version of Qnorm that writes the estimate for each probability in p to
+// the element of out at the same index. Fails without writing anything if the
+// spans differ in size or any probability is outside of (0, 1). p and out may
+// be the same span.
+absl::Status Qnorm(absl::Span<const double> p, absl::Span<double> out,
+                   double mu = 0.0, double sigma = 1.0);
+
 template <typename T>
 inline const T& Clamp(const T& low, const T& high, const T& value) {
   // Prevents errors in ordering the arguments.
@@ -79,6 +95,91 @@ inline const T& Clamp(const T& low, const T& high, const T& value) {
   return value;
 }
 
+// Returns sum + value * count. For integral types the arithmetic is done on the
+// unsigned counterpart of T, so that the result wraps around on overflow in the
+// same way as adding value count times, without relying on undefined signed
+// overflow and without a check per entry.
+template <typename T, std::enable_if_t<std::is_integral<T>::value>* = nullptr>
+inline T AddMultipleWrapping(T sum, T value, uint64_t count) {
+  using Unsigned = std::make_unsigned_t<T>;
+  const Unsigned product =
+      static_cast<Unsigned>(static_cast<Unsigned>(value) * count);
+  return static_cast<T>(static_cast<Unsigned>(sum) + product);
+}
+
+template <typename T,
+          std::enable_if_t<std::is_floating_point<T>::value>* = nullptr>
+inline T AddMultipleWrapping(T sum, T value, uint64_t count) {
+  return sum + value * count;
+}
+
+namespace internal {
+
+// Number of independent accumulators used by AddClampedEntriesInLanes. Summing
+// into separate lanes breaks the dependency between consecutive additions,
+// which allows the compiler to keep the lanes in vector registers.
+constexpr size_t kClampedSumLanes = 8;
+
+// Adds the entries clamped to [lower, upper] to *sum, skipping NaN entries, and
+// returns the number of entries that are not NaN. If kWithSquares is true, the
+// squares of the clamped entries are also added to *sum_of_squares, which is
+// not used otherwise. The loop uses selects instead of branches, so that it
+// vectorizes. Integral sums are accumulated on the unsigned counterpart of T,
+// so that they wrap around on overflow in the same way as adding the entries
+// one by one, without relying on undefined signed overflow. The lanes are
+// combined in a fixed order, so the result is deterministic, but floating point
+// sums may differ in the last bits from adding the entries one by one.
+template <bool kWithSquares, typename T>
+uint64_t AddClampedEntriesInLanes(absl::Span<const T> entries, T lower,
+                                  T upper, T* sum, double* sum_of_squares) {
+  using Accumulator = typename std::conditional_t<std::is_integral<T>::value,
+                                                  std::make_unsigned<T>,
+                                                  std::common_type<T>>::type;
+  Accumulator sum_lanes[kClampedSumLanes] = {};
+  double square_lanes[kClampedSumLanes] = {};
+  uint64_t count_lanes[kClampedSumLanes] = {};
+  const size_t blocked_size =
+      entries.size() - entries.size() % kClampedSumLanes;
+  for (size_t i = 0; i < blocked_size; i += kClampedSumLanes) {
+    for (size_t j = 0; j < kClampedSumLanes; ++j) {
+      // A NaN entry fails both comparisons and is replaced by zero.
+      const T t = entries[i + j];
+      const bool is_number = t == t;
+      const T clamped = t < lower ? lower : (upper < t ? upper : t);
+      const T value = is_number ? clamped : 0;
+      sum_lanes[j] += static_cast<Accumulator>(value);
+      if constexpr (kWithSquares) {
+        square_lanes[j] += static_cast<double>(value) * value;
+      }
+      count_lanes[j] += is_number;
+    }
+  }
+  Accumulator total = static_cast<Accumulator>(*sum);
+  uint64_t count = 0;
+  for (size_t i = blocked_size; i < entries.size(); ++i) {
+    const T t = entries[i];
+    if (t == t) {
+      const T clamped = Clamp<T>(lower, upper, t);
+      total += static_cast<Accumulator>(clamped);
+      if constexpr (kWithSquares) {
+        *sum_of_squares += static_cast<double>(clamped) * clamped;
+      }
+      ++count;
+    }
+  }
+  for (size_t j = 0; j < kClampedSumLanes; ++j) {
+    total += sum_lanes[j];
+    if constexpr (kWithSquares) {
+      *sum_of_squares += square_lanes[j];
+    }
+    count += count_lanes[j];
+  }
+  *sum = static_cast<T>(total);
+  return count;
+}
+
+}  // namespace internal
+
 // When T is an integral type, return true and assign the addition result if the
 // addition will not overflow. Otherwise, assign the numeric limit to result and
 // return false.
@@ -126,6 +126,23 @@ TEST(InverseErrorTest, EdgeCases) {
   EXPECT_EQ(InverseErrorFunction(0), 0);
 }
 
+TEST(InverseErrorTest, BatchMatchesScalar) {
+  std::vector<double> x = {-1, -0.9999, -0.5, -0.0012, 0, 0.0067,
+                           0.24, 0.39,  0.9, 0.99999, 1};
+  for (int i = 0; i < 100; i++) {
+    x.push_back(2.0 * ((double)rand() / RAND_MAX) - 1.0);
+  }
+  std::vector<double> out(x.size());
+  InverseErrorFunction(x, absl::MakeSpan(out));
+  for (int i = 0; i < x.size(); ++i) {
+    EXPECT_EQ(out[i], InverseErrorFunction(x[i])) << "x = " << x[i];
+  }
+
+  // The output may alias the input.
+  InverseErrorFunction(x, absl::MakeSpan(x));
+  EXPECT_THAT(x, ::testing::ContainerEq(out));
+}
+
 // In RoundToNearestMultiple tests exact comparison of double is used, because
 // for rounding to multiple of power of 2 RoundToNearestMultiple should provide
 // exact value.
@@ -178,6 +195,28 @@ TEST(QnormTest, Accuracy) {
   }
 }
 
+TEST(QnormTest, BatchMatchesScalar) {
+  std::vector<double> p = {0.0000001, 0.001, 0.05, 0.25, 0.5,
+                           0.55,      0.85,  0.95, 0.9999999};
+  std::vector<double> out(p.size());
+  ASSERT_OK(Qnorm(p, absl::MakeSpan(out), 2.0, 3.0));
+  for (int i = 0; i < p.size(); ++i) {
+    EXPECT_EQ(out[i], Qnorm(p[i], 2.0, 3.0).ValueOrDie());
+  }
+}
+
+TEST(QnormTest, BatchInvalidArguments) {
+  std::vector<double> p = {0.2, 0.5, 1.0};
+  std::vector<double> out(p.size(), -1.0);
+  EXPECT_EQ(Qnorm(p, absl::MakeSpan(out)).code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(out, ::testing::Each(-1.0));
+
+  std::vector<double> too_short(1);
+  EXPECT_EQ(Qnorm({0.5, 0.5}, absl::MakeSpan(too_short)).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
 TEST(ClampTest, DefaultTest) {
   EXPECT_EQ(Clamp(1, 3, 2), 2);
   EXPECT_EQ(Clamp(1.0, 3.0, 4.0), 3);
@@ -289,7 +328,7 @@ TEST(VectorUtilTest, VectorFilter) {
   std::vector<double> v = {1, 2, 2, 3};
   std::vector<bool> selection = {false, true, true, false};
   std::vector<double> expected = {2, 2};
-  EXPECT_THAT(VectorFilter(v, selection), testing::ContainerEq(expected));
+  EXPECT_THAT(VectorFilter(v, selection), ::testing::ContainerEq(expected));
 }
 
 TEST(VectorUtilTest, VectorToString) {
@@ -850,5 +889,19 @@ TEST(ValidateTest, IsInIntervalBadBehaviour) {
   }
 }
 
+
+TEST(AddMultipleWrappingTest, WrapsAroundLikeRepeatedAddition) {
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  EXPECT_EQ(AddMultipleWrapping<int64_t>(1, 2, 3), 7);
+  EXPECT_EQ(AddMultipleWrapping<int64_t>(0, max, 2), -2);
+  EXPECT_EQ(AddMultipleWrapping<int64_t>(max, 1, 1),
+            std::numeric_limits<int64_t>::lowest());
+  EXPECT_EQ(AddMultipleWrapping<int64_t>(5, -1, 10), -5);
+  EXPECT_EQ(AddMultipleWrapping<int32_t>(0, std::numeric_limits<int32_t>::max(),
+                                         4),
+            -4);
+  EXPECT_DOUBLE_EQ(AddMultipleWrapping<double>(0.5, 1.5, 4), 6.5);
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -0,0 +1,401 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_BASE_LOG_HISTOGRAM_SKETCH_H_
+#define DIFFERENTIAL_PRIVACY_BASE_LOG_HISTOGRAM_SKETCH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/repeated_field.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "base/percentile.h"
+#include "proto/util.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace base {
+
+// Default number of linear sub-bins of every logarithmic bin.
+constexpr int kDefaultLogHistogramSubBins = 16;
+
+// LogHistogramSketch approximates the relative ranks of Percentile with the
+// counts of logarithmic histogram bins, without storing or sorting the inputs.
+// It can replace Percentile as the input sketch of BinarySearch, e.g., for Min
+// and Max of many partitions, which otherwise hold all inputs in memory.
+//
+// The bins are those of ApproxBounds: the positive bins are [0, scale],
+// (scale, scale * base], (scale * base, scale * base^2], ..., num_bins of them,
+// and the negative bins mirror them. Inputs beyond the last bin are counted in
+// it. Every bin is split into num_sub_bins sub-bins of equal width, which
+// refine the search inside the bin. Only the occupied sub-bins are stored, so
+// memory is bounded by the number of sub-bins and usually much lower. Sketches
+// with the same bins are merged by adding their counts.
+//
+// Accuracy: the inputs of a sub-bin are assumed to be spread uniformly over it,
+// so ranks are exact at sub-bin boundaries, and a value searched by its rank
+// is found within its sub-bin, i.e., with a relative error of at most about
+// (base - 1) / num_sub_bins, or an absolute error of scale / num_sub_bins near
+// 0.
+//
+// The bins do not depend on the data, so a single input still changes the
+// approximated number of inputs below any value by at most one, and the noise
+// of BinarySearch keeps its calibration.
+template <typename T>
+class LogHistogramSketch : public Percentile<T> {
+ public:
+  // Uses the default bins of ApproxBounds, which cover the entire range of T.
+  explicit LogHistogramSketch(int num_sub_bins = kDefaultLogHistogramSubBins)
+      : LogHistogramSketch(DefaultScale(), /*base=*/2,
+                           DefaultNumBins(DefaultScale(), /*base=*/2),
+                           num_sub_bins) {}
+
+  // scale and base must be positive and finite, base must be greater than 1,
+  // and num_bins and num_sub_bins must be positive.
+  LogHistogramSketch(double scale, double base, int num_bins, int num_sub_bins)
+      : scale_(scale),
+        base_(base),
+        num_bins_(num_bins),
+        num_sub_bins_(num_sub_bins),
+        log_scale_(std::log(scale)),
+        log_base_(std::log(base)) {}
+
+  static double DefaultScale() {
+    return std::is_integral<T>::value ? 1.0 : std::numeric_limits<T>::min();
+  }
+
+  // Returns the number of bins for which the last bin boundary is at least the
+  // maximum of T.
+  static int DefaultNumBins(double scale, double base) {
+    // Take the subtraction of two logarithms to prevent overflow.
+    return std::ceil((std::log(std::numeric_limits<T>::max()) -
+                      std::log(scale)) /
+                     std::log(base)) +
+           1;
+  }
+
+  void Add(const T& t) override { AddWithCount(t, 1); }
+
+  void AddWithCount(const T& t, uint64_t num_of_entries) override {
+    // REF:
+    // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
+    if (std::isnan(static_cast<double>(t)) || num_of_entries == 0) {
+      return;
+    }
+    counts_[Key(static_cast<double>(t))] += num_of_entries;
+    num_values_ += num_of_entries;
+    ranks_valid_ = false;
+  }
+
+  void Reset() override {
+    counts_.clear();
+    num_values_ = 0;
+    ranks_valid_ = false;
+  }
+
+  // Writes the middle of every occupied sub-bin once per input in it. Prefer
+  // SerializeToSummary, which writes the counts.
+  void SerializeToProto(
+      google::protobuf::RepeatedPtrField<ValueType>* values) override {
+    for (const auto& bin : counts_) {
+      double lower, upper;
+      KeyBounds(bin.first, &lower, &upper);
+      const T middle = static_cast<T>(lower / 2 + upper / 2);
+      for (int64_t i = 0; i < bin.second; ++i) {
+        values->Add(MakeValueType(middle));
+      }
+    }
+  }
+
+  void MergeFromProto(
+      const google::protobuf::RepeatedPtrField<ValueType>& values) override {
+    for (const ValueType& v : values) {
+      Add(GetValue<T>(v));
+    }
+  }
+
+  void SerializeToSummary(BinarySearchSummary* summary) override {
+    LogHistogramSummary* histogram = summary->mutable_input_log_histogram();
+    histogram->set_scale(scale_);
+    histogram->set_base(base_);
+    histogram->set_num_bins(num_bins_);
+    histogram->set_num_sub_bins(num_sub_bins_);
+    histogram->mutable_bin_key()->Reserve(counts_.size());
+    histogram->mutable_bin_count()->Reserve(counts_.size());
+    for (const auto& bin : counts_) {
+      histogram->add_bin_key(bin.first);
+      histogram->add_bin_count(bin.second);
+    }
+  }
+
+  // Adds the counts of a log histogram with the same bins, and the exact
+  // inputs of other summaries one by one. Use MergeFromSerializedSummary to
+  // detect summaries that cannot be merged.
+  void MergeFromSummary(const BinarySearchSummary& summary) override {
+    MergeFromProto(summary.input());
+    for (int64_t v : summary.input_int()) {
+      Add(static_cast<T>(v));
+    }
+    for (double v : summary.input_double()) {
+      Add(static_cast<T>(v));
+    }
+    const LogHistogramSummary& histogram = summary.input_log_histogram();
+    if (!HasSameBins(histogram)) {
+      return;
+    }
+    const int num_bins =
+        std::min(histogram.bin_key_size(), histogram.bin_count_size());
+    counts_.reserve(counts_.size() + num_bins);
+    for (int i = 0; i < num_bins; ++i) {
+      counts_[histogram.bin_key(i)] += histogram.bin_count(i);
+      num_values_ += histogram.bin_count(i);
+    }
+    ranks_valid_ = false;
+  }
+
+  // Returns false and leaves the counts unchanged if bytes is not a valid
+  // summary, if it holds a log histogram with other bins or invalid counts, or
+  // if it holds inputs in the compact encoding of Percentile.
+  bool MergeFromSerializedSummary(absl::string_view bytes) override {
+    BinarySearchSummary summary;
+    if (!summary.ParseFromArray(bytes.data(), bytes.size())) {
+      return false;
+    }
+    if (summary.input_delta_size() > 0 || summary.input_count_size() > 0) {
+      return false;
+    }
+    if (summary.has_input_log_histogram()) {
+      const LogHistogramSummary& histogram = summary.input_log_histogram();
+      if (!HasSameBins(histogram) ||
+          histogram.bin_key_size() != histogram.bin_count_size()) {
+        return false;
+      }
+      const int64_t num_keys = int64_t{num_bins_} * num_sub_bins_;
+      for (int64_t key : histogram.bin_key()) {
+        if (key < -num_keys || key >= num_keys) {
+          return false;
+        }
+      }
+      for (int64_t count : histogram.bin_count()) {
+        if (count < 0) {
+          return false;
+        }
+      }
+    }
+    MergeFromSummary(summary);
+    return true;
+  }
+
+  // Adds the counts of other if it is a LogHistogramSketch with the same bins,
+  // and the inputs of other one by one otherwise.
+  void MergeFrom(Percentile<T>& other) override {
+    auto* other_sketch = dynamic_cast<LogHistogramSketch<T>*>(&other);
+    if (other_sketch == nullptr || !HasSameBins(*other_sketch)) {
+      google::protobuf::RepeatedPtrField<ValueType> values;
+      other.SerializeToProto(&values);
+      MergeFromProto(values);
+      return;
+    }
+    counts_.reserve(counts_.size() + other_sketch->counts_.size());
+    for (const auto& bin : other_sketch->counts_) {
+      counts_[bin.first] += bin.second;
+    }
+    num_values_ += other_sketch->num_values_;
+    ranks_valid_ = false;
+  }
+
+  int64_t Memory() override {
+    return sizeof(LogHistogramSketch<T>) +
+           counts_.capacity() * (sizeof(std::pair<int64_t, int64_t>) + 1) +
+           sizeof(Rank) * ranks_.capacity();
+  }
+
+  int64_t num_values() override { return num_values_; }
+
+  // Obtain the approximate relative rank of value t with respect to the added
+  // inputs. Both elements of the pair are the approximate fraction of inputs
+  // below t. See the class comment for the accuracy.
+  std::pair<double, double> GetRelativeRank(const T& t) override {
+    if (num_values_ == 0) {
+      return std::make_pair(0, 1);
+    }
+    if (!ranks_valid_) {
+      BuildRanks();
+    }
+    const double value = static_cast<double>(t);
+    const int64_t key = Key(value);
+    auto it = std::lower_bound(
+        ranks_.begin(), ranks_.end(), key,
+        [](const Rank& rank, int64_t k) { return rank.key < k; });
+    double num_lt = it == ranks_.end() ? num_values_ : it->num_before;
+    if (it != ranks_.end() && it->key == key) {
+      // Interpolate inside the sub-bin of t.
+      double lower, upper;
+      KeyBounds(key, &lower, &upper);
+      double fraction = value >= upper ? 1 : 0;
+      if (lower < upper && lower < value && value < upper) {
+        fraction = (value - lower) / (upper - lower);
+      }
+      num_lt += fraction * it->count;
+    }
+    const double rank = num_lt / num_values_;
+    return std::make_pair(rank, rank);
+  }
+
+  // The inputs are not kept, so each value is looked up in the ranks.
+  std::vector<std::pair<double, double>> GetRelativeRanks(
+      absl::Span<const T> values) override {
+    std::vector<std::pair<double, double>> ranks;
+    ranks.reserve(values.size());
+    for (const T& t : values) {
+      ranks.push_back(GetRelativeRank(t));
+    }
+    return ranks;
+  }
+
+  // Returns the number of occupied sub-bins.
+  int64_t NumOccupiedBins() const { return counts_.size(); }
+
+ private:
+  // An occupied sub-bin in the order of its values, with the number of inputs
+  // in all sub-bins before it.
+  struct Rank {
+    int64_t key;
+    int64_t count;
+    int64_t num_before;
+  };
+
+  bool HasSameBins(const LogHistogramSummary& histogram) const {
+    return histogram.scale() == scale_ && histogram.base() == base_ &&
+           histogram.num_bins() == num_bins_ &&
+           histogram.num_sub_bins() == num_sub_bins_;
+  }
+
+  bool HasSameBins(const LogHistogramSketch<T>& other) const {
+    return other.scale_ == scale_ && other.base_ == base_ &&
+           other.num_bins_ == num_bins_ && other.num_sub_bins_ == num_sub_bins_;
+  }
+
+  // Returns the upper boundary of the positive bin i, at most the maximum of T.
+  double BinBoundary(int i) const {
+    const double max = static_cast<double>(std::numeric_limits<T>::max());
+    const double boundary = base_ == 2 ? std::ldexp(scale_, i)
+                                       : std::exp(log_scale_ + i * log_base_);
+    return std::min(boundary, max);
+  }
+
+  // Returns the bin of magnitude, at most num_bins_ - 1, such that magnitude is
+  // in (BinBoundary(i - 1), BinBoundary(i)], or [0, BinBoundary(0)] for i = 0.
+  int BinIndex(double magnitude) const {
+    const double log_index =
+        std::ceil((std::log(magnitude) - log_scale_) / log_base_);
+    int i = static_cast<int>(
+        std::max(0.0, std::min<double>(log_index, num_bins_ - 1)));
+    // Correct floating point errors of the logarithms.
+    if (i > 0 && magnitude <= BinBoundary(i - 1)) {
+      --i;
+    } else if (i < num_bins_ - 1 && magnitude > BinBoundary(i)) {
+      ++i;
+    }
+    return i;
+  }
+
+  // Returns the key of the sub-bin of value. Keys are ordered like the values
+  // of their sub-bins: non-negative sub-bins have the keys 0, 1, 2, ... in
+  // ascending order of magnitude, and negative sub-bins the keys -1, -2, ....
+  int64_t Key(double value) const {
+    const double magnitude = std::abs(value);
+    const int i = BinIndex(magnitude);
+    const double bin_lower = i == 0 ? 0 : BinBoundary(i - 1);
+    const double width = (BinBoundary(i) - bin_lower) / num_sub_bins_;
+    int sub_bin = 0;
+    if (width > 0) {
+      sub_bin = static_cast<int>(std::max(
+          0.0, std::min<double>(std::floor((magnitude - bin_lower) / width),
+                                num_sub_bins_ - 1)));
+    }
+    const int64_t index = int64_t{i} * num_sub_bins_ + sub_bin;
+    return value < 0 ? -index - 1 : index;
+  }
+
+  // Sets *lower and *upper to the bounds of the sub-bin with key.
+  void KeyBounds(int64_t key, double* lower, double* upper) const {
+    if (key >= 0) {
+      SubBinBounds(key, lower, upper);
+      return;
+    }
+    SubBinBounds(-key - 1, lower, upper);
+    std::swap(*lower, *upper);
+    *lower = -*lower;
+    *upper = -*upper;
+  }
+
+  // Sets *lower and *upper to the bounds of the non-negative sub-bin index.
+  void SubBinBounds(int64_t index, double* lower, double* upper) const {
+    const int i = index / num_sub_bins_;
+    const int sub_bin = index % num_sub_bins_;
+    const double bin_lower = i == 0 ? 0 : BinBoundary(i - 1);
+    const double bin_upper = BinBoundary(i);
+    const double width = (bin_upper - bin_lower) / num_sub_bins_;
+    *lower = bin_lower + sub_bin * width;
+    *upper = sub_bin + 1 == num_sub_bins_ ? bin_upper : *lower + width;
+  }
+
+  // Builds the occupied sub-bins in the order of their values, which
+  // GetRelativeRank searches.
+  void BuildRanks() {
+    ranks_.clear();
+    ranks_.reserve(counts_.size());
+    for (const auto& bin : counts_) {
+      ranks_.push_back({bin.first, bin.second, 0});
+    }
+    std::sort(ranks_.begin(), ranks_.end(),
+              [](const Rank& a, const Rank& b) { return a.key < b.key; });
+    int64_t cumulative = 0;
+    for (Rank& rank : ranks_) {
+      rank.num_before = cumulative;
+      cumulative += rank.count;
+    }
+    ranks_valid_ = true;
+  }
+
+  const double scale_;
+  const double base_;
+  const int num_bins_;
+  const int num_sub_bins_;
+  const double log_scale_;
+  const double log_base_;
+
+  // Number of inputs in every occupied sub-bin, by key.
+  absl::flat_hash_map<int64_t, int64_t> counts_;
+  int64_t num_values_ = 0;
+
+  // Occupied sub-bins sorted by key. Only valid if ranks_valid_.
+  std::vector<Rank> ranks_;
+  bool ranks_valid_ = false;
+};
+
+}  // namespace base
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_BASE_LOG_HISTOGRAM_SKETCH_H_
@@ -0,0 +1,165 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "base/log-histogram-sketch.h"
+
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "base/percentile.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace base {
+namespace {
+
+template <typename T>
+class LogHistogramSketchTest : public ::testing::Test {};
+
+typedef ::testing::Types<int64_t, double> NumericTypes;
+TYPED_TEST_SUITE(LogHistogramSketchTest, NumericTypes);
+
+TYPED_TEST(LogHistogramSketchTest, EmptyInputSet) {
+  LogHistogramSketch<TypeParam> sketch;
+  EXPECT_EQ(sketch.num_values(), 0);
+  EXPECT_EQ(std::make_pair(0.0, 1.0), sketch.GetRelativeRank(1));
+}
+
+TYPED_TEST(LogHistogramSketchTest, RanksAreExactAtBinBoundaries) {
+  LogHistogramSketch<TypeParam> sketch;
+  Percentile<TypeParam> percentile;
+  for (TypeParam t : {-100, -3, 0, 1, 5, 5, 17, 1000}) {
+    sketch.Add(t);
+    percentile.Add(t);
+  }
+  EXPECT_EQ(sketch.num_values(), 8);
+  // Powers of two are bin boundaries, and their negations are lower
+  // boundaries of negative bins.
+  for (TypeParam t : {-1024, -128, -2, 4, 16, 32, 2048}) {
+    EXPECT_DOUBLE_EQ(sketch.GetRelativeRank(t).first,
+                     percentile.GetRelativeRank(t).first)
+        << t;
+  }
+  EXPECT_EQ(sketch.GetRelativeRank(-1000000), std::make_pair(0.0, 0.0));
+  EXPECT_EQ(sketch.GetRelativeRank(1000000), std::make_pair(1.0, 1.0));
+}
+
+TYPED_TEST(LogHistogramSketchTest, BoundedMemoryAndRankError) {
+  const int64_t n = 100000;
+  LogHistogramSketch<TypeParam> sketch;
+  for (int64_t i = 0; i < n; ++i) {
+    sketch.Add(static_cast<TypeParam>((i * 7919) % n));
+  }
+  EXPECT_EQ(sketch.num_values(), n);
+  // 17 bins up to 2^17, but the smallest ones are not divided by integers.
+  EXPECT_LE(sketch.NumOccupiedBins(), 18 * kDefaultLogHistogramSubBins);
+  for (double q : {0.01, 0.25, 0.5, 0.75, 0.99}) {
+    // The interpolation is off by at most a fraction of the inputs of one
+    // sub-bin, of which the largest holds 4096 / n of the inputs.
+    EXPECT_NEAR(sketch.GetRelativeRank(static_cast<TypeParam>(q * n)).first,
+                q, 0.01);
+  }
+}
+
+TYPED_TEST(LogHistogramSketchTest, SerializeAndMerge) {
+  LogHistogramSketch<TypeParam> first, second, single;
+  for (int64_t i = -500; i < 500; ++i) {
+    (i % 2 == 0 ? first : second).Add(static_cast<TypeParam>(i));
+    single.Add(static_cast<TypeParam>(i));
+  }
+  BinarySearchSummary summary;
+  first.SerializeToSummary(&summary);
+  EXPECT_EQ(summary.input_int_size(), 0);
+  EXPECT_EQ(summary.input_double_size(), 0);
+  ASSERT_TRUE(second.MergeFromSerializedSummary(summary.SerializeAsString()));
+  EXPECT_EQ(second.num_values(), single.num_values());
+  EXPECT_EQ(second.NumOccupiedBins(), single.NumOccupiedBins());
+  for (TypeParam t : {-400, -7, 0, 3, 100, 499}) {
+    EXPECT_DOUBLE_EQ(second.GetRelativeRank(t).first,
+                     single.GetRelativeRank(t).first);
+  }
+}
+
+TYPED_TEST(LogHistogramSketchTest, MergeFrom) {
+  LogHistogramSketch<TypeParam> sketch, other, single;
+  Percentile<TypeParam> exact;
+  for (int64_t i = 0; i < 100; ++i) {
+    sketch.Add(static_cast<TypeParam>(i));
+    other.Add(static_cast<TypeParam>(i + 50));
+    exact.Add(static_cast<TypeParam>(-i));
+    single.Add(static_cast<TypeParam>(i));
+    single.Add(static_cast<TypeParam>(i + 50));
+    single.Add(static_cast<TypeParam>(-i));
+  }
+  sketch.MergeFrom(other);
+  // The inputs of an exact Percentile are merged one by one.
+  sketch.MergeFrom(exact);
+  EXPECT_EQ(sketch.num_values(), 300);
+  for (TypeParam t : {-50, 0, 25, 120}) {
+    EXPECT_DOUBLE_EQ(sketch.GetRelativeRank(t).first,
+                     single.GetRelativeRank(t).first);
+  }
+}
+
+TEST(LogHistogramSketchTest, RejectsSummariesWithOtherBins) {
+  LogHistogramSketch<double> sketch(/*num_sub_bins=*/4);
+  sketch.Add(1.5);
+  BinarySearchSummary summary;
+  sketch.SerializeToSummary(&summary);
+
+  LogHistogramSketch<double> other(/*num_sub_bins=*/8);
+  EXPECT_FALSE(other.MergeFromSerializedSummary(summary.SerializeAsString()));
+  EXPECT_FALSE(other.MergeFromSerializedSummary("not a summary"));
+  EXPECT_EQ(other.num_values(), 0);
+
+  Percentile<double> percentile;
+  EXPECT_FALSE(
+      percentile.MergeFromSerializedSummary(summary.SerializeAsString()));
+
+  summary.mutable_input_log_histogram()->set_bin_count(0, -1);
+  LogHistogramSketch<double> same(/*num_sub_bins=*/4);
+  EXPECT_FALSE(same.MergeFromSerializedSummary(summary.SerializeAsString()));
+}
+
+TEST(LogHistogramSketchTest, IgnoresNaNAndCountsInfinity) {
+  LogHistogramSketch<double> sketch;
+  sketch.Add(std::nan(""));
+  sketch.Add(INFINITY);
+  sketch.Add(-INFINITY);
+  EXPECT_EQ(sketch.num_values(), 2);
+  EXPECT_EQ(sketch.GetRelativeRank(0).first, 0.5);
+  EXPECT_EQ(sketch.GetRelativeRank(INFINITY).first, 1);
+}
+
+TYPED_TEST(LogHistogramSketchTest, AddWithCountAndReset) {
+  LogHistogramSketch<TypeParam> sketch;
+  sketch.AddWithCount(3, 5);
+  sketch.AddWithCount(300, 15);
+  sketch.AddWithCount(7, 0);
+  EXPECT_EQ(sketch.num_values(), 20);
+  EXPECT_DOUBLE_EQ(sketch.GetRelativeRank(256).first, 0.25);
+  sketch.Reset();
+  EXPECT_EQ(sketch.num_values(), 0);
+  EXPECT_EQ(sketch.NumOccupiedBins(), 0);
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace differential_privacy
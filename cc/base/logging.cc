@@ -56,14 +56,22 @@ static int clock_gettime(int, struct timespec *spec)  // C-file part
 #else
 #include <unistd.h>
 #endif
+#include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "absl/base/attributes.h"
+#include "absl/base/call_once.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
 namespace base {
@@ -145,8 +153,136 @@ bool set_log_directory(const std::string &log_directory) {
 //        level less than or equal to this will be logged.
 void set_vlog_level(int level) { vlog_level = level; }
 
+struct LogRecord {
+  std::string text;
+  absl::LogSeverity severity;
+};
+
+// Appends the records to the log file, which is opened once for all of them,
+// and prints them to standard output, and to standard error from ERROR on.
+void WriteToLog(absl::Span<const LogRecord> records) {
+  std::string log_path = get_log_directory() + get_log_basename();
+
+  FILE *file = fopen(log_path.c_str(), "ab");
+  if (file) {
+    for (const LogRecord &record : records) {
+      if (fprintf(file, "%s", record.text.c_str()) > 0) {
+        if (record.text.back() != '\n') {
+          fprintf(file, "\n");
+        }
+      } else {
+        fprintf(stderr, "Failed to write to log file : %s! [%s]\n",
+                log_path.c_str(), strerror(errno));
+      }
+    }
+    fclose(file);
+  } else {
+    fprintf(stderr, "Failed to open log file : %s! [%s]\n",
+            log_path.c_str(), strerror(errno));
+  }
+  for (const LogRecord &record : records) {
+    if (record.severity >= absl::LogSeverity::kError) {
+      fprintf(stderr, "%s\n", record.text.c_str());
+    }
+    printf("%s\n", record.text.c_str());
+  }
+  fflush(stderr);
+  fflush(stdout);
+}
+
+// The queue of the asynchronous logging backend. Logging threads push records
+// onto a lock-free stack, and the writer thread takes the whole stack at once
+// and writes it in the order in which the records were pushed. The mutex is
+// only used to wake the writer when a record is pushed onto an empty stack,
+// and to wait for the writer in Flush().
+class AsyncLogQueue {
+ public:
+  AsyncLogQueue() { std::thread([this] { WriteLoop(); }).detach(); }
+
+  void Push(LogRecord record) {
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    Node *node = new Node{std::move(record), head_.load()};
+    while (!head_.compare_exchange_weak(node->next, node)) {
+    }
+    if (node->next == nullptr) {
+      // The writer may be waiting for the stack to become non-empty, which it
+      // checks whenever the mutex is released.
+      absl::MutexLock lock(&mutex_);
+    }
+  }
+
+  void Flush() {
+    const int64_t pushed = pushed_.load();
+    absl::MutexLock lock(&mutex_);
+    auto all_written = [this, pushed]() { return written_ >= pushed; };
+    mutex_.Await(absl::Condition(&all_written));
+  }
+
+ private:
+  struct Node {
+    LogRecord record;
+    Node *next;
+  };
+
+  void WriteLoop() {
+    std::vector<LogRecord> records;
+    while (true) {
+      {
+        absl::MutexLock lock(&mutex_);
+        auto has_records = [this]() { return head_.load() != nullptr; };
+        mutex_.Await(absl::Condition(&has_records));
+      }
+      // The stack holds the newest record first.
+      for (Node *node = head_.exchange(nullptr); node != nullptr;) {
+        records.push_back(std::move(node->record));
+        Node *next = node->next;
+        delete node;
+        node = next;
+      }
+      std::reverse(records.begin(), records.end());
+      WriteToLog(records);
+      absl::MutexLock lock(&mutex_);
+      written_ += records.size();
+      records.clear();
+    }
+  }
+
+  std::atomic<Node *> head_{nullptr};
+  std::atomic<int64_t> pushed_{0};
+  absl::Mutex mutex_;
+  int64_t written_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+ABSL_CONST_INIT std::atomic<bool> async_logging{false};
+
+AsyncLogQueue *GetAsyncLogQueue() {
+  static AsyncLogQueue *queue = [] {
+    auto *queue = new AsyncLogQueue();
+    std::atexit(FlushLog);
+    return queue;
+  }();
+  return queue;
+}
+
 }  // namespace
 
+void SetAsyncLogging(bool async) {
+  if (async) {
+    GetAsyncLogQueue();
+  }
+  if (async_logging.exchange(async) && !async) {
+    GetAsyncLogQueue()->Flush();
+  }
+}
+
+bool IsAsyncLogging() { return async_logging.load(); }
+
+void FlushLog() {
+  if (IsAsyncLogging()) {
+    GetAsyncLogQueue()->Flush();
+  }
+}
+
 std::string get_log_directory() {
   if (!log_file_directory) {
     return kDefaultDirectory;
@@ -264,29 +400,16 @@ LogMessage::~LogMessage() {
 }
 
 void LogMessage::SendToLog(const std::string &message_text) {
-  std::string log_path = get_log_directory() + get_log_basename();
-
-  FILE *file = fopen(log_path.c_str(), "ab");
-  if (file) {
-    if (fprintf(file, "%s", message_text.c_str()) > 0) {
-      if (message_text.back() != '\n') {
-        fprintf(file, "\n");
-      }
-    } else {
-      fprintf(stderr, "Failed to write to log file : %s! [%s]\n",
-              log_path.c_str(), strerror(errno));
-    }
-    fclose(file);
-  } else {
-    fprintf(stderr, "Failed to open log file : %s! [%s]\n",
-            log_path.c_str(), strerror(errno));
+  if (severity_ < absl::LogSeverity::kFatal && IsAsyncLogging()) {
+    GetAsyncLogQueue()->Push({message_text, severity_});
+    return;
   }
-  if (severity_ >= absl::LogSeverity::kError) {
-    fprintf(stderr, "%s\n", message_text.c_str());
-    fflush(stderr);
+  // Writes the queued messages first, so that the last message before an
+  // abort is the fatal one.
+  if (severity_ == absl::LogSeverity::kFatal) {
+    FlushLog();
   }
-  printf("%s\n", message_text.c_str());
-  fflush(stdout);
+  WriteToLog({{message_text, severity_}});
 }
 
 void LogMessage::Flush() {
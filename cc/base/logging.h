@@ -50,6 +50,38 @@
 #define DP_INTERNAL_LOGGING_DFATAL DP_INTERNAL_LOGGING_FATAL
 #endif
 
+// Log statements of a severity below DP_MIN_LOG_LEVEL are compiled out: their
+// streams are never constructed and their arguments are never evaluated. The
+// level is that of absl::LogSeverity: 0 for INFO, the default, 1 for WARNING
+// and 2 for ERROR. VLOG statements have INFO severity. FATAL statements and
+// CHECKs are never compiled out. Set it with --define dp_min_log_level=warning
+// or --define dp_min_log_level=error.
+#ifndef DP_MIN_LOG_LEVEL
+#define DP_MIN_LOG_LEVEL 0
+#endif
+
+#define DP_INTERNAL_LOG_ENABLED_INFO (DP_MIN_LOG_LEVEL <= 0)
+#define DP_INTERNAL_LOG_ENABLED_WARNING (DP_MIN_LOG_LEVEL <= 1)
+#define DP_INTERNAL_LOG_ENABLED_ERROR (DP_MIN_LOG_LEVEL <= 2)
+#define DP_INTERNAL_LOG_ENABLED_FATAL true
+#define DP_INTERNAL_LOG_ENABLED_QFATAL true
+
+// LOG(FATAL) is a plain stream so that the compiler sees that it does not
+// return.
+#define DP_INTERNAL_LOG_INFO LOG_IF(INFO, true)
+#define DP_INTERNAL_LOG_WARNING LOG_IF(WARNING, true)
+#define DP_INTERNAL_LOG_ERROR LOG_IF(ERROR, true)
+#define DP_INTERNAL_LOG_FATAL DP_INTERNAL_LOGGING_FATAL.stream()
+#define DP_INTERNAL_LOG_QFATAL DP_INTERNAL_LOG_FATAL
+
+#ifdef NDEBUG
+#define DP_INTERNAL_LOG_ENABLED_DFATAL DP_INTERNAL_LOG_ENABLED_ERROR
+#define DP_INTERNAL_LOG_DFATAL DP_INTERNAL_LOG_ERROR
+#else
+#define DP_INTERNAL_LOG_ENABLED_DFATAL true
+#define DP_INTERNAL_LOG_DFATAL DP_INTERNAL_LOG_FATAL
+#endif
+
 #ifdef NDEBUG
 #define DP_DEBUG_MODE false
 #else
@@ -66,7 +98,7 @@
 // severity: the severity of the log message, one of LogSeverity. The
 //           FATAL severity will terminate the program after the log is emitted.
 //           Must be exactly one of INFO WARNING ERROR FATAL QFATAL DFATAL
-#define LOG(severity) DP_INTERNAL_LOGGING_##severity.stream()
+#define LOG(severity) DP_INTERNAL_LOG_##severity
 
 // A command to LOG only if a condition is true. If the condition is false,
 // nothing is logged.
@@ -76,9 +108,10 @@
 //
 // severity: the severity of the log message, one of LogSeverity. The
 //           FATAL severity will terminate the program after the log is emitted.
-// condition: the condition that determines whether to log the message.
+// condition: the condition that determines whether to log the message. It is
+//            not evaluated if the severity is compiled out.
 #define LOG_IF(severity, condition)                                           \
-  !(condition)                                                                \
+  !(DP_INTERNAL_LOG_ENABLED_##severity && (condition))                        \
       ? (void)0                                                               \
       : ::differential_privacy::base::logging_internal::LogMessageVoidify() & \
             DP_INTERNAL_LOGGING_##severity.stream()
@@ -289,6 +322,23 @@ std::string get_log_directory();
 // Returns true if initialized successfully. Behavior is undefined false.
 bool InitLogging(const char *directory, const char *file_name, int level);
 
+// Sets whether log messages are written by a background thread. By default,
+// every message is written to the log file and to standard output by the
+// thread that logs it before the log statement returns. With asynchronous
+// logging, the logging thread only formats the message and hands it to the
+// writer thread through a lock-free queue, and the writer appends all queued
+// messages to the log file at once. Messages of every thread are written in
+// the order in which that thread logged them. FATAL messages are still
+// written synchronously, after all queued messages. Disabling asynchronous
+// logging flushes the queue.
+void SetAsyncLogging(bool async);
+
+bool IsAsyncLogging();
+
+// Blocks until all messages logged before the call are written. Also called
+// at exit when asynchronous logging was enabled.
+void FlushLog();
+
 namespace logging_internal {
 
 // Class representing a log message created by a log macro.
@@ -0,0 +1,91 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compiles out the log statements of this file below WARNING.
+#undef DP_MIN_LOG_LEVEL
+#define DP_MIN_LOG_LEVEL 1
+#include "base/logging.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace differential_privacy {
+namespace base {
+namespace {
+
+TEST(LoggingTest, CompilesOutStatementsBelowMinLevel) {
+  int evaluated = 0;
+  LOG(INFO) << ++evaluated;
+  LOG_IF(INFO, ++evaluated > 0) << "Not logged";
+  VLOG(0) << ++evaluated;
+  EXPECT_EQ(evaluated, 0);
+  LOG_IF(WARNING, ++evaluated < 0) << "Not logged";
+  EXPECT_EQ(evaluated, 1);
+}
+
+TEST(LoggingTest, AsyncLoggingKeepsOrderOfEveryThread) {
+  ASSERT_TRUE(InitLogging(::testing::TempDir().c_str(), "logging_test", 0));
+  const std::string log_path = get_log_directory() + "logging_test";
+  std::remove(log_path.c_str());
+
+  const int kNumThreads = 4;
+  const int kNumMessages = 50;
+  SetAsyncLogging(true);
+  EXPECT_TRUE(IsAsyncLogging());
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kNumThreads; ++thread) {
+    threads.emplace_back([thread]() {
+      for (int i = 0; i < kNumMessages; ++i) {
+        LOG(WARNING) << "thread:" << thread << ":" << i;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  FlushLog();
+  SetAsyncLogging(false);
+  EXPECT_FALSE(IsAsyncLogging());
+
+  std::ifstream log(log_path);
+  std::vector<int> next_message(kNumThreads, 0);
+  std::string line;
+  while (std::getline(log, line)) {
+    std::vector<absl::string_view> fields = absl::StrSplit(line, "thread:");
+    ASSERT_EQ(fields.size(), 2) << line;
+    std::vector<absl::string_view> ids = absl::StrSplit(fields[1], ':');
+    int thread, message;
+    ASSERT_EQ(ids.size(), 2);
+    ASSERT_TRUE(absl::SimpleAtoi(ids[0], &thread));
+    ASSERT_TRUE(absl::SimpleAtoi(ids[1], &message));
+    ASSERT_LT(thread, kNumThreads);
+    EXPECT_EQ(message, next_message[thread]++);
+  }
+  EXPECT_THAT(next_message, ::testing::Each(kNumMessages));
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace differential_privacy
@@ -17,10 +17,23 @@
 #ifndef DIFFERENTIAL_PRIVACY_BASE_PERCENTILE_H_
 #define DIFFERENTIAL_PRIVACY_BASE_PERCENTILE_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/repeated_field.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "proto/util.h"
+#include "proto/summary.pb.h"
 
 namespace differential_privacy {
 namespace base {
@@ -46,12 +59,30 @@ namespace base {
 // underlying vector only if there has been an addition since the previous sort.
 // Thus, retrieving a percentile is O(nlog n) worst case and O(log n) if no
 // additional inputs have been added.
+//
+// Serialized inputs are sorted, and each merged set of inputs is kept as a
+// sorted run. The next retrieval then merges the r runs in O(n log r) rather
+// than sorting all inputs again.
+//
+// If compact_summary is set, summaries encode integral inputs as varint deltas
+// between consecutive sorted values, and run-length encode inputs with many
+// duplicates as distinct values and their counts.
+//
+// GetRelativeRanks answers many values at once. Ascending values are answered
+// in one sweep over the sorted inputs. For large input sets, single lookups
+// first search a sampled copy of the sorted inputs in Eytzinger (breadth-first)
+// order, which fits in cache better than a binary search over all inputs.
+//
+// The methods are virtual so that BinarySearch can use an approximate,
+// bounded-memory summary of the inputs instead, such as LogHistogramSketch.
 template <typename T>
 class Percentile {
  public:
-  Percentile() {}
+  explicit Percentile(bool compact_summary = false)
+      : compact_summary_(compact_summary) {}
+  virtual ~Percentile() = default;
 
-  void Add(const T& t) {
+  virtual void Add(const T& t) {
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
     if (!std::isnan(static_cast<double>(t))) {
@@ -60,51 +91,609 @@ class Percentile {
     }
   }
 
-  void Reset() {
+  // Adds t num_of_entries times. The exact Percentile stores every copy.
+  virtual void AddWithCount(const T& t, uint64_t num_of_entries) {
+    if (!std::isnan(static_cast<double>(t)) && num_of_entries > 0) {
+      inputs_.insert(inputs_.end(), num_of_entries, t);
+      sorted_ = false;
+    }
+  }
+
+  virtual void Reset() {
     inputs_.clear();
+    run_ends_.clear();
     sorted_ = true;
+    index_.clear();
+    index_positions_.clear();
   }
 
-  void SerializeToProto(google::protobuf::RepeatedPtrField<ValueType>* values) {
+  // Writes the inputs in sorted order.
+  virtual void SerializeToProto(
+      google::protobuf::RepeatedPtrField<ValueType>* values) {
+    Sort();
+    values->Reserve(values->size() + inputs_.size());
     for (const T& t : inputs_) {
       values->Add(MakeValueType(t));
     }
   }
 
-  void MergeFromProto(google::protobuf::RepeatedPtrField<ValueType> values) {
-    for (const ValueType v : values) {
+  // Adds the values as a new sorted run. Values serialized by SerializeToProto
+  // are already sorted, so this does not need to sort them again.
+  virtual void MergeFromProto(
+      const google::protobuf::RepeatedPtrField<ValueType>& values) {
+    if (values.empty()) {
+      return;
+    }
+    EndRun();
+    inputs_.reserve(inputs_.size() + values.size());
+    for (const ValueType& v : values) {
       inputs_.push_back(GetValue<T>(v));
-      sorted_ = false;
     }
+    EndRun();
+    sorted_ = false;
   }
 
-  int64_t Memory() {
-    return sizeof(Percentile<T>) + sizeof(T) * inputs_.capacity();
+  // Writes the inputs to summary in sorted order, using the packed input field
+  // matching T, or the compact encoding if compact_summary was set.
+  virtual void SerializeToSummary(BinarySearchSummary* summary) {
+    Sort();
+    if (compact_summary_) {
+      SerializeCompact(summary);
+      return;
+    }
+    if (std::is_integral<T>::value) {
+      summary->mutable_input_int()->Reserve(inputs_.size());
+    } else {
+      summary->mutable_input_double()->Reserve(inputs_.size());
+    }
+    for (const T& t : inputs_) {
+      AddPackedValue(t, summary->mutable_input_int(),
+                     summary->mutable_input_double());
+    }
+  }
+
+  // Adds the inputs stored in summary, in any of the ValueType, packed or
+  // compact encodings.
+  virtual void MergeFromSummary(const BinarySearchSummary& summary) {
+    MergeFromProto(summary.input());
+    AddRun(summary.input_int());
+    if (summary.input_count().empty()) {
+      AddRun(summary.input_double());
+    }
+    AddCompactRun(summary);
   }
 
-  int64_t num_values() { return inputs_.size(); }
+  // Same as MergeFromSummary, but reads the inputs straight from a serialized
+  // BinarySearchSummary. This avoids building the summary proto, and reserves
+  // capacity for all inputs at once. Returns false and leaves the inputs
+  // unchanged if bytes is not a valid summary or summarizes the inputs in a
+  // log histogram.
+  virtual bool MergeFromSerializedSummary(absl::string_view bytes) {
+    using google::protobuf::internal::WireFormatLite;
+    constexpr int kInput = BinarySearchSummary::kInputFieldNumber;
+    constexpr int kInputInt = BinarySearchSummary::kInputIntFieldNumber;
+    constexpr int kInputDouble = BinarySearchSummary::kInputDoubleFieldNumber;
+
+    // Count the inputs first so that capacity is only reserved once.
+    int64_t num_inputs = 0;
+    bool compact = false;
+    {
+      google::protobuf::io::CodedInputStream input(
+          reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+      while (uint32_t tag = input.ReadTag()) {
+        const int field = WireFormatLite::GetTagFieldNumber(tag);
+        compact |= field == BinarySearchSummary::kInputDeltaFieldNumber ||
+                   field == BinarySearchSummary::kInputCountFieldNumber;
+        // Log histograms do not hold the inputs.
+        if (field == BinarySearchSummary::kInputLogHistogramFieldNumber) {
+          return false;
+        }
+        const bool packed = WireFormatLite::GetTagWireType(tag) ==
+                            WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+        if ((field == kInputInt || field == kInputDouble) && packed) {
+          uint32_t length;
+          if (!input.ReadVarint32(&length)) {
+            return false;
+          }
+          num_inputs += field == kInputDouble
+                            ? length / sizeof(double)
+                            : CountVarints(&input, length);
+          if (!input.Skip(length)) {
+            return false;
+          }
+          continue;
+        }
+        num_inputs += field == kInput || field == kInputInt ||
+                      field == kInputDouble;
+        if (!WireFormatLite::SkipField(&input, tag)) {
+          return false;
+        }
+      }
+    }
+
+    // Compact summaries are small, so they are simply parsed.
+    if (compact) {
+      BinarySearchSummary summary;
+      if (!summary.ParseFromArray(bytes.data(), bytes.size()) ||
+          !IsValidCompactEncoding(summary)) {
+        return false;
+      }
+      MergeFromSummary(summary);
+      return true;
+    }
+
+    EndRun();
+    const size_t old_size = inputs_.size();
+    const size_t old_num_runs = run_ends_.size();
+    inputs_.reserve(old_size + num_inputs);
+    if (!ReadInputs(bytes)) {
+      inputs_.resize(old_size);
+      run_ends_.resize(old_num_runs);
+      return false;
+    }
+    EndRun();
+    sorted_ = false;
+    return true;
+  }
+
+  // Adds the inputs of other. If other is a Percentile of the same type, its
+  // sorted inputs are appended as a new run without going through a summary;
+  // otherwise other is merged through SerializeToSummary.
+  virtual void MergeFrom(Percentile<T>& other) {
+    if (typeid(other) != typeid(*this)) {
+      BinarySearchSummary summary;
+      other.SerializeToSummary(&summary);
+      MergeFromSummary(summary);
+      return;
+    }
+    if (other.inputs_.empty()) {
+      return;
+    }
+    other.Sort();
+    EndRun();
+    inputs_.insert(inputs_.end(), other.inputs_.begin(), other.inputs_.end());
+    EndRun();
+    sorted_ = false;
+  }
+
+  virtual int64_t Memory() {
+    return sizeof(Percentile<T>) + sizeof(T) * inputs_.capacity() +
+           sizeof(size_t) * run_ends_.capacity() +
+           sizeof(T) * index_.capacity() +
+           sizeof(size_t) * index_positions_.capacity();
+  }
+
+  virtual int64_t num_values() { return inputs_.size(); }
 
   // Obtain the relative rank of value t with respect to the added inputs.
-  std::pair<double, double> GetRelativeRank(const T& t) {
+  virtual std::pair<double, double> GetRelativeRank(const T& t) {
     if (num_values() == 0) {
       return std::make_pair(0, 1);
     }
 
     // If something has been added since the last sort, sort again.
-    if (!sorted_) {
-      std::sort(inputs_.begin(), inputs_.end());
-      sorted_ = true;
-    }
-    auto lb = std::lower_bound(inputs_.begin(), inputs_.end(), t);
+    Sort();
+    auto lb = LowerBound(t);
     auto ub = std::upper_bound(lb, inputs_.end(), t);
     double num_lt = std::distance(inputs_.begin(), lb);
     double num_le = std::distance(inputs_.begin(), ub);
     return std::make_pair(num_lt / num_values(), num_le / num_values());
   }
 
+  // Obtain the relative ranks of values, in the same order as values. If
+  // values are in ascending order, they are answered in one sweep over the
+  // sorted inputs that gallops forward from the rank of the previous value,
+  // which takes O(k log(n / k)) for k values. Otherwise each value is looked
+  // up with GetRelativeRank.
+  virtual std::vector<std::pair<double, double>> GetRelativeRanks(
+      absl::Span<const T> values) {
+    std::vector<std::pair<double, double>> ranks;
+    ranks.reserve(values.size());
+    if (!std::is_sorted(values.begin(), values.end()) || num_values() == 0) {
+      for (const T& t : values) {
+        ranks.push_back(GetRelativeRank(t));
+      }
+      return ranks;
+    }
+
+    Sort();
+    auto lb = inputs_.begin();
+    for (const T& t : values) {
+      lb = Gallop(lb, [&t](const T& input) { return input < t; });
+      auto ub = Gallop(lb, [&t](const T& input) { return !(t < input); });
+      double num_lt = std::distance(inputs_.begin(), lb);
+      double num_le = std::distance(inputs_.begin(), ub);
+      ranks.emplace_back(num_lt / num_values(), num_le / num_values());
+    }
+    return ranks;
+  }
+
  private:
+  // Writes the sorted inputs in the compact encoding. They are run-length
+  // encoded if there are at least two inputs per distinct value on average.
+  void SerializeCompact(BinarySearchSummary* summary) {
+    size_t num_distinct = 0;
+    for (size_t i = 0; i < inputs_.size(); ++i) {
+      num_distinct += i == 0 || inputs_[i] != inputs_[i - 1];
+    }
+    const bool run_length = 2 * num_distinct <= inputs_.size();
+    uint64_t previous = 0;
+    size_t i = 0;
+    while (i < inputs_.size()) {
+      size_t next = i + 1;
+      if (run_length) {
+        while (next < inputs_.size() && inputs_[next] == inputs_[i]) {
+          ++next;
+        }
+        summary->add_input_count(next - i);
+      }
+      if (std::is_integral<T>::value) {
+        const uint64_t current =
+            static_cast<uint64_t>(static_cast<int64_t>(inputs_[i]));
+        summary->add_input_delta(current - previous);
+        previous = current;
+      } else {
+        summary->add_input_double(inputs_[i]);
+      }
+      i = next;
+    }
+  }
+
+  // Most inputs that a run-length encoded summary may stand for, which is the
+  // most that a packed field of the other encodings can hold. This keeps a
+  // corrupted count from making AddCompactRun allocate without bound.
+  static constexpr uint64_t kMaxCompactInputs =
+      std::numeric_limits<int32_t>::max();
+
+  // Returns whether the run-length encoding of summary, if any, has one count
+  // for each distinct value, and the counts add up to at most
+  // kMaxCompactInputs.
+  static bool IsValidCompactEncoding(const BinarySearchSummary& summary) {
+    if (summary.input_count().empty()) {
+      return true;
+    }
+    if ((!summary.input_delta().empty() && !summary.input_double().empty()) ||
+        summary.input_count_size() !=
+            summary.input_delta_size() + summary.input_double_size()) {
+      return false;
+    }
+    uint64_t num_inputs = 0;
+    for (uint64_t count : summary.input_count()) {
+      // Checked before adding, so that the sum cannot wrap around.
+      if (count > kMaxCompactInputs - num_inputs) {
+        return false;
+      }
+      num_inputs += count;
+    }
+    return true;
+  }
+
+  // Adds the inputs in the compact encoding of summary as a new sorted run.
+  void AddCompactRun(const BinarySearchSummary& summary) {
+    const google::protobuf::RepeatedField<uint64_t>& counts =
+        summary.input_count();
+    if (summary.input_delta().empty() && counts.empty()) {
+      return;
+    }
+    EndRun();
+    // The i-th value stands for counts[i] inputs if run-length encoded.
+    int i = 0;
+    auto add = [this, &counts, &i](T value) {
+      const uint64_t n = i < counts.size() ? counts[i] : 1;
+      inputs_.insert(inputs_.end(), n, value);
+      ++i;
+    };
+    uint64_t value = 0;
+    for (uint64_t delta : summary.input_delta()) {
+      value += delta;
+      add(static_cast<T>(static_cast<int64_t>(value)));
+    }
+    if (!counts.empty()) {
+      for (double v : summary.input_double()) {
+        add(static_cast<T>(v));
+      }
+    }
+    EndRun();
+    sorted_ = false;
+  }
+
+  // Adds values as a new sorted run.
+  template <typename V>
+  void AddRun(const google::protobuf::RepeatedField<V>& values) {
+    if (values.empty()) {
+      return;
+    }
+    EndRun();
+    inputs_.reserve(inputs_.size() + values.size());
+    for (const V& v : values) {
+      inputs_.push_back(static_cast<T>(v));
+    }
+    EndRun();
+    sorted_ = false;
+  }
+
+  // Returns the number of varints in the next length bytes of input, without
+  // consuming them. Returns 0 if they are not in a flat buffer.
+  static int64_t CountVarints(google::protobuf::io::CodedInputStream* input,
+                              uint32_t length) {
+    const void* data;
+    int size;
+    if (!input->GetDirectBufferPointer(&data, &size) || size < length) {
+      return 0;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    // Each varint ends with the only byte that has its high bit unset.
+    return std::count_if(bytes, bytes + length,
+                         [](uint8_t b) { return b < 0x80; });
+  }
+
+  // Appends the inputs of the serialized BinarySearchSummary in bytes to
+  // inputs_. Returns false if bytes is not a valid summary.
+  bool ReadInputs(absl::string_view bytes) {
+    using google::protobuf::internal::WireFormatLite;
+    constexpr uint32_t kInputTag = WireFormatLite::MakeTag(
+        BinarySearchSummary::kInputFieldNumber,
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    constexpr uint32_t kPackedInputIntTag = WireFormatLite::MakeTag(
+        BinarySearchSummary::kInputIntFieldNumber,
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    constexpr uint32_t kInputIntTag = WireFormatLite::MakeTag(
+        BinarySearchSummary::kInputIntFieldNumber,
+        WireFormatLite::WIRETYPE_VARINT);
+    constexpr uint32_t kPackedInputDoubleTag = WireFormatLite::MakeTag(
+        BinarySearchSummary::kInputDoubleFieldNumber,
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+    constexpr uint32_t kInputDoubleTag = WireFormatLite::MakeTag(
+        BinarySearchSummary::kInputDoubleFieldNumber,
+        WireFormatLite::WIRETYPE_FIXED64);
+
+    google::protobuf::io::CodedInputStream input(
+        reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+    while (uint32_t tag = input.ReadTag()) {
+      uint32_t length;
+      uint64_t v;
+      switch (tag) {
+        case kInputTag: {
+          T value;
+          if (!ReadValue(&input, &value)) {
+            return false;
+          }
+          inputs_.push_back(value);
+          break;
+        }
+        case kPackedInputIntTag: {
+          if (!input.ReadVarint32(&length)) {
+            return false;
+          }
+          auto limit = input.PushLimit(length);
+          while (input.BytesUntilLimit() > 0) {
+            if (!input.ReadVarint64(&v)) {
+              return false;
+            }
+            inputs_.push_back(static_cast<T>(static_cast<int64_t>(v)));
+          }
+          input.PopLimit(limit);
+          break;
+        }
+        case kInputIntTag:
+          if (!input.ReadVarint64(&v)) {
+            return false;
+          }
+          inputs_.push_back(static_cast<T>(static_cast<int64_t>(v)));
+          break;
+        case kPackedInputDoubleTag: {
+          if (!input.ReadVarint32(&length) || length % sizeof(double) != 0) {
+            return false;
+          }
+          for (uint32_t i = 0; i < length / sizeof(double); ++i) {
+            if (!input.ReadLittleEndian64(&v)) {
+              return false;
+            }
+            inputs_.push_back(static_cast<T>(WireFormatLite::DecodeDouble(v)));
+          }
+          break;
+        }
+        case kInputDoubleTag:
+          if (!input.ReadLittleEndian64(&v)) {
+            return false;
+          }
+          inputs_.push_back(static_cast<T>(WireFormatLite::DecodeDouble(v)));
+          break;
+        default:
+          if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+          }
+      }
+    }
+    return true;
+  }
+
+  // Reads a length-delimited ValueType from input into value. Like GetValue,
+  // this yields 0 unless the value set last is of the kind matching T.
+  static bool ReadValue(google::protobuf::io::CodedInputStream* input,
+                        T* value) {
+    using google::protobuf::internal::WireFormatLite;
+    uint32_t length;
+    if (!input->ReadVarint32(&length)) {
+      return false;
+    }
+    auto limit = input->PushLimit(length);
+    *value = 0;
+    while (uint32_t tag = input->ReadTag()) {
+      if (std::is_integral<T>::value &&
+          tag == WireFormatLite::MakeTag(ValueType::kIntValueFieldNumber,
+                                         WireFormatLite::WIRETYPE_VARINT)) {
+        uint64_t v;
+        if (!input->ReadVarint64(&v)) {
+          return false;
+        }
+        *value = static_cast<T>(static_cast<int64_t>(v));
+      } else if (std::is_floating_point<T>::value &&
+                 tag == WireFormatLite::MakeTag(
+                            ValueType::kFloatValueFieldNumber,
+                            WireFormatLite::WIRETYPE_FIXED64)) {
+        uint64_t v;
+        if (!input->ReadLittleEndian64(&v)) {
+          return false;
+        }
+        *value = static_cast<T>(WireFormatLite::DecodeDouble(v));
+      } else {
+        const int field = WireFormatLite::GetTagFieldNumber(tag);
+        if (field == ValueType::kIntValueFieldNumber ||
+            field == ValueType::kFloatValueFieldNumber ||
+            field == ValueType::kStringValueFieldNumber) {
+          // Another member of the value oneof replaces the earlier one.
+          *value = 0;
+        }
+        if (!WireFormatLite::SkipField(input, tag)) {
+          return false;
+        }
+      }
+    }
+    if (!input->ConsumedEntireMessage()) {
+      return false;
+    }
+    input->PopLimit(limit);
+    return true;
+  }
+
+  // Sorts the inputs added after the last run, and records them as a new run.
+  void EndRun() {
+    const size_t begin = run_ends_.empty() ? 0 : run_ends_.back();
+    if (begin == inputs_.size()) {
+      return;
+    }
+    auto first = inputs_.begin() + begin;
+    if (!std::is_sorted(first, inputs_.end())) {
+      std::sort(first, inputs_.end());
+    }
+    run_ends_.push_back(inputs_.size());
+  }
+
+  // Sorts all inputs by merging adjacent runs pairwise until a single run is
+  // left.
+  void Sort() {
+    if (sorted_) {
+      return;
+    }
+    index_.clear();
+    index_positions_.clear();
+    EndRun();
+    while (run_ends_.size() > 1) {
+      std::vector<size_t> merged_ends;
+      merged_ends.reserve((run_ends_.size() + 1) / 2);
+      size_t begin = 0;
+      for (size_t i = 0; i + 1 < run_ends_.size(); i += 2) {
+        auto first = inputs_.begin() + begin;
+        auto middle = inputs_.begin() + run_ends_[i];
+        auto last = inputs_.begin() + run_ends_[i + 1];
+        // Runs that are already in order need no merging.
+        if (*(middle - 1) > *middle) {
+          std::inplace_merge(first, middle, last);
+        }
+        begin = run_ends_[i + 1];
+        merged_ends.push_back(begin);
+      }
+      if (run_ends_.size() % 2 == 1) {
+        merged_ends.push_back(run_ends_.back());
+      }
+      run_ends_.swap(merged_ends);
+    }
+    sorted_ = true;
+  }
+
+  // Returns the first sorted input that is not less than t. Builds the index
+  // first if there are enough inputs for it to pay off.
+  typename std::vector<T>::iterator LowerBound(const T& t) {
+    if (index_.empty() && inputs_.size() >= kIndexMinInputs) {
+      BuildIndex();
+    }
+    if (index_.empty()) {
+      return std::lower_bound(inputs_.begin(), inputs_.end(), t);
+    }
+
+    // Descend the implicit tree, going right while the sample is less than t.
+    const size_t num_samples = index_.size() - 1;
+    size_t k = 1;
+    while (k <= num_samples) {
+      k = 2 * k + (index_[k] < t);
+    }
+    // Undo the right turns after the last left turn, which was taken at the
+    // first sample not less than t. k is 0 if all samples are less than t.
+    while (k & 1) {
+      k >>= 1;
+    }
+    k >>= 1;
+
+    // The lower bound is after the previous sample and at most at this one.
+    const size_t end = k == 0 ? inputs_.size() : index_positions_[k];
+    const size_t begin =
+        k == 0 ? (num_samples - 1) * kIndexStride + 1
+               : (end == 0 ? 0 : end - kIndexStride + 1);
+    return std::lower_bound(inputs_.begin() + begin, inputs_.begin() + end, t);
+  }
+
+  // Returns the first sorted input at or after first for which before returns
+  // false, checking exponentially growing steps before a binary search.
+  template <typename Predicate>
+  typename std::vector<T>::iterator Gallop(
+      typename std::vector<T>::iterator first, Predicate before) {
+    auto last = first;
+    size_t step = 1;
+    while (last != inputs_.end() && before(*last)) {
+      first = last + 1;
+      last = static_cast<size_t>(inputs_.end() - first) > step
+                 ? first + step
+                 : inputs_.end();
+      step *= 2;
+    }
+    return std::partition_point(first, last, before);
+  }
+
+  // Samples every kIndexStride-th sorted input into index_ in Eytzinger order:
+  // index_[1] is the root, and the children of index_[k] are index_[2k] and
+  // index_[2k + 1]. index_positions_ holds the position of each sample.
+  void BuildIndex() {
+    const size_t num_samples =
+        (inputs_.size() + kIndexStride - 1) / kIndexStride;
+    index_.resize(num_samples + 1);
+    index_positions_.resize(num_samples + 1);
+    size_t next = 0;
+    FillIndex(1, &next);
+  }
+
+  // Fills the subtree rooted at k with the next samples, in order.
+  void FillIndex(size_t k, size_t* next) {
+    if (k >= index_.size()) {
+      return;
+    }
+    FillIndex(2 * k, next);
+    index_positions_[k] = *next * kIndexStride;
+    index_[k] = inputs_[index_positions_[k]];
+    ++*next;
+    FillIndex(2 * k + 1, next);
+  }
+
+  // Number of sorted inputs from which single lookups use the index, and
+  // distance between the sampled inputs.
+  static constexpr size_t kIndexMinInputs = 1 << 16;
+  static constexpr size_t kIndexStride = 64;
+
   std::vector<T> inputs_;
+
+  // End positions in inputs_ of consecutive sorted runs. Inputs after the last
+  // run were added by Add and are not sorted yet.
+  std::vector<size_t> run_ends_;
   bool sorted_ = true;
+
+  // Sampled sorted inputs in Eytzinger order, with index_[0] unused, and their
+  // positions in inputs_. Empty until a lookup builds it, and cleared whenever
+  // the inputs change.
+  std::vector<T> index_;
+  std::vector<size_t> index_positions_;
+
+  // Whether summaries use the compact encoding.
+  const bool compact_summary_;
 };
 
 }  // namespace base
@@ -16,6 +16,13 @@
 
 #include "base/percentile.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "proto/summary.pb.h"
@@ -108,6 +115,288 @@ TYPED_TEST(PercentileTest, SerializeMerge) {
   EXPECT_EQ(std::make_pair(.25, .5), percentile2.GetRelativeRank(2));
 }
 
+TYPED_TEST(PercentileTest, SerializeWritesSortedInputs) {
+  Percentile<TypeParam> percentile;
+  for (TypeParam t : {5, 1, 4, 2, 3}) {
+    percentile.Add(t);
+  }
+  BinarySearchSummary summary;
+  percentile.SerializeToProto(summary.mutable_input());
+  ASSERT_EQ(summary.input_size(), 5);
+  for (int i = 0; i < summary.input_size(); ++i) {
+    EXPECT_EQ(GetValue<TypeParam>(summary.input(i)), i + 1);
+  }
+}
+
+TYPED_TEST(PercentileTest, MergeManySortedRuns) {
+  Percentile<TypeParam> merged, expected;
+  for (int shard = 0; shard < 7; ++shard) {
+    Percentile<TypeParam> percentile;
+    for (int i = 0; i < 100; ++i) {
+      TypeParam value = (i * 37 + shard * 11) % 250;
+      percentile.Add(value);
+      expected.Add(value);
+    }
+    BinarySearchSummary summary;
+    percentile.SerializeToProto(summary.mutable_input());
+    merged.MergeFromProto(summary.input());
+    // Unsorted additions between merges are kept apart from the runs.
+    merged.Add(shard);
+    expected.Add(shard);
+  }
+  EXPECT_EQ(merged.num_values(), expected.num_values());
+  for (TypeParam t : {-1, 0, 3, 50, 125, 200, 249, 300}) {
+    EXPECT_EQ(merged.GetRelativeRank(t), expected.GetRelativeRank(t));
+  }
+
+  // Merging after a retrieval keeps the ranks correct.
+  BinarySearchSummary summary;
+  expected.SerializeToProto(summary.mutable_input());
+  merged.MergeFromProto(summary.input());
+  expected.MergeFromProto(summary.input());
+  for (TypeParam t : {-1, 0, 3, 50, 125, 200, 249, 300}) {
+    EXPECT_EQ(merged.GetRelativeRank(t), expected.GetRelativeRank(t));
+  }
+}
+
+TYPED_TEST(PercentileTest, MergeFromSerializedSummary) {
+  Percentile<TypeParam> source;
+  for (int i = 0; i < 1000; ++i) {
+    source.Add((i * 37) % 101);
+  }
+  BinarySearchSummary summary;
+  source.SerializeToSummary(&summary);
+  // Values of another kind are read as 0, as GetValue does.
+  summary.add_input()->set_string_value("foo");
+  const std::string bytes = summary.SerializeAsString();
+
+  Percentile<TypeParam> from_bytes, from_proto;
+  from_bytes.Add(50);
+  from_proto.Add(50);
+  ASSERT_TRUE(from_bytes.MergeFromSerializedSummary(bytes));
+  from_proto.MergeFromSummary(summary);
+  EXPECT_EQ(from_bytes.num_values(), 1002);
+  EXPECT_EQ(from_bytes.num_values(), from_proto.num_values());
+  for (TypeParam t : {-1, 0, 1, 25, 50, 100, 101}) {
+    EXPECT_EQ(from_bytes.GetRelativeRank(t), from_proto.GetRelativeRank(t));
+  }
+}
+
+TYPED_TEST(PercentileTest, MergeFromInvalidSerializedSummary) {
+  Percentile<TypeParam> source;
+  for (int i = 0; i < 10; ++i) {
+    source.Add(i);
+  }
+  BinarySearchSummary summary;
+  source.SerializeToSummary(&summary);
+  std::string bytes = summary.SerializeAsString();
+  bytes.resize(bytes.size() - 1);
+
+  Percentile<TypeParam> percentile;
+  percentile.Add(1);
+  EXPECT_FALSE(percentile.MergeFromSerializedSummary(bytes));
+  EXPECT_EQ(percentile.num_values(), 1);
+  EXPECT_EQ(std::make_pair(0.0, 1.0), percentile.GetRelativeRank(1));
+}
+
+TYPED_TEST(PercentileTest, SerializeToSummaryUsesPackedInputs) {
+  Percentile<TypeParam> percentile;
+  for (int i = 0; i < 1000; ++i) {
+    percentile.Add((i * 37) % 1000);
+  }
+  BinarySearchSummary packed;
+  percentile.SerializeToSummary(&packed);
+  EXPECT_EQ(packed.input_size(), 0);
+  EXPECT_EQ(packed.input_int_size() + packed.input_double_size(), 1000);
+
+  // Summaries with the older ValueType inputs are still accepted.
+  BinarySearchSummary legacy;
+  percentile.SerializeToProto(legacy.mutable_input());
+  EXPECT_LT(packed.ByteSizeLong(), legacy.ByteSizeLong());
+
+  Percentile<TypeParam> from_packed, from_legacy, from_bytes;
+  from_packed.MergeFromSummary(packed);
+  from_legacy.MergeFromSummary(legacy);
+  ASSERT_TRUE(from_bytes.MergeFromSerializedSummary(packed.SerializeAsString()));
+  EXPECT_EQ(from_packed.num_values(), 1000);
+  EXPECT_EQ(from_bytes.num_values(), 1000);
+  for (TypeParam t : {-1, 0, 1, 500, 999, 1000}) {
+    EXPECT_EQ(from_packed.GetRelativeRank(t), from_legacy.GetRelativeRank(t));
+    EXPECT_EQ(from_bytes.GetRelativeRank(t), from_legacy.GetRelativeRank(t));
+  }
+}
+
+TYPED_TEST(PercentileTest, CompactSummary) {
+  Percentile<TypeParam> plain;
+  Percentile<TypeParam> compact(/*compact_summary=*/true);
+  for (int i = 0; i < 1000; ++i) {
+    plain.Add(1000000 + (i * 37) % 1000);
+    compact.Add(1000000 + (i * 37) % 1000);
+  }
+  BinarySearchSummary plain_summary, compact_summary;
+  plain.SerializeToSummary(&plain_summary);
+  compact.SerializeToSummary(&compact_summary);
+  EXPECT_EQ(compact_summary.input_count_size(), 0);
+  if (std::is_integral<TypeParam>::value) {
+    EXPECT_EQ(compact_summary.input_delta_size(), 1000);
+    EXPECT_LT(compact_summary.ByteSizeLong(), plain_summary.ByteSizeLong() / 2);
+  }
+
+  Percentile<TypeParam> from_proto, from_bytes;
+  from_proto.MergeFromSummary(compact_summary);
+  const std::string bytes = compact_summary.SerializeAsString();
+  ASSERT_TRUE(from_bytes.MergeFromSerializedSummary(bytes));
+  for (TypeParam t : {0, 1000000, 1000001, 1000500, 1000999, 2000000}) {
+    EXPECT_EQ(from_proto.GetRelativeRank(t), plain.GetRelativeRank(t));
+    EXPECT_EQ(from_bytes.GetRelativeRank(t), plain.GetRelativeRank(t));
+  }
+}
+
+TYPED_TEST(PercentileTest, CompactSummaryRunLengthEncodesDuplicates) {
+  Percentile<TypeParam> plain;
+  Percentile<TypeParam> compact(/*compact_summary=*/true);
+  for (int i = 0; i < 1000; ++i) {
+    plain.Add(i % 4 - 1);
+    compact.Add(i % 4 - 1);
+  }
+  BinarySearchSummary summary;
+  compact.SerializeToSummary(&summary);
+  EXPECT_THAT(summary.input_count(), testing::ElementsAre(250, 250, 250, 250));
+  EXPECT_EQ(summary.input_delta_size() + summary.input_double_size(), 4);
+
+  Percentile<TypeParam> from_bytes;
+  from_bytes.Add(0);
+  ASSERT_TRUE(
+      from_bytes.MergeFromSerializedSummary(summary.SerializeAsString()));
+  plain.Add(0);
+  EXPECT_EQ(from_bytes.num_values(), 1001);
+  for (TypeParam t : {-2, -1, 0, 1, 2, 3}) {
+    EXPECT_EQ(from_bytes.GetRelativeRank(t), plain.GetRelativeRank(t));
+  }
+
+  // Counts that do not match the distinct values are rejected.
+  summary.add_input_count(1);
+  EXPECT_FALSE(
+      from_bytes.MergeFromSerializedSummary(summary.SerializeAsString()));
+  EXPECT_EQ(from_bytes.num_values(), 1001);
+}
+
+TYPED_TEST(PercentileTest, CompactSummaryRejectsHugeCounts) {
+  Percentile<TypeParam> compact(/*compact_summary=*/true);
+  compact.Add(1);
+  compact.Add(1);
+  BinarySearchSummary summary;
+  compact.SerializeToSummary(&summary);
+  ASSERT_THAT(summary.input_count(), testing::ElementsAre(2));
+
+  Percentile<TypeParam> from_bytes;
+  from_bytes.Add(0);
+  // A single count above the limit.
+  summary.set_input_count(0, uint64_t{1} << 40);
+  EXPECT_FALSE(
+      from_bytes.MergeFromSerializedSummary(summary.SerializeAsString()));
+  // Two counts whose sum wraps around to a small number.
+  summary.set_input_count(0, std::numeric_limits<uint64_t>::max());
+  summary.add_input_count(2);
+  if (std::is_integral<TypeParam>::value) {
+    summary.add_input_delta(1);
+  } else {
+    summary.add_input_double(2);
+  }
+  EXPECT_FALSE(
+      from_bytes.MergeFromSerializedSummary(summary.SerializeAsString()));
+  EXPECT_EQ(from_bytes.num_values(), 1);
+}
+
+TYPED_TEST(PercentileTest, MergeFrom) {
+  Percentile<TypeParam> percentile;
+  Percentile<TypeParam> other;
+  Percentile<TypeParam> expected;
+  for (TypeParam t : {5, 3, 8}) {
+    percentile.Add(t);
+    expected.Add(t);
+  }
+  for (TypeParam t : {4, 1, 9, 3}) {
+    other.Add(t);
+    expected.Add(t);
+  }
+  percentile.MergeFrom(other);
+  EXPECT_EQ(percentile.num_values(), 7);
+  EXPECT_EQ(other.num_values(), 4);
+  for (TypeParam t : {0, 1, 3, 4, 5, 8, 9, 10}) {
+    EXPECT_EQ(percentile.GetRelativeRank(t), expected.GetRelativeRank(t));
+  }
+}
+
+TYPED_TEST(PercentileTest, AddWithCount) {
+  Percentile<TypeParam> percentile;
+  percentile.AddWithCount(3, 3);
+  percentile.AddWithCount(1, 1);
+  percentile.AddWithCount(5, 0);
+  EXPECT_EQ(percentile.num_values(), 4);
+  EXPECT_EQ(std::make_pair(0.0, 0.25), percentile.GetRelativeRank(1));
+  EXPECT_EQ(std::make_pair(0.25, 1.0), percentile.GetRelativeRank(3));
+}
+
+TYPED_TEST(PercentileTest, GetRelativeRanks) {
+  Percentile<TypeParam> percentile;
+  for (TypeParam t : {1, 2, 2, 3, 5}) {
+    percentile.Add(t);
+  }
+  const std::vector<TypeParam> sorted = {0, 1, 2, 2, 4, 5, 6};
+  const std::vector<TypeParam> unsorted = {4, 2, 6, 0, 5};
+  for (const std::vector<TypeParam>& values : {sorted, unsorted}) {
+    const std::vector<std::pair<double, double>> ranks =
+        percentile.GetRelativeRanks(values);
+    ASSERT_EQ(ranks.size(), values.size());
+    for (int i = 0; i < values.size(); ++i) {
+      EXPECT_EQ(ranks[i], percentile.GetRelativeRank(values[i]));
+    }
+  }
+  EXPECT_EQ(percentile.GetRelativeRanks(std::vector<TypeParam>{2})[0],
+            std::make_pair(0.2, 0.6));
+
+  Percentile<TypeParam> empty;
+  EXPECT_THAT(empty.GetRelativeRanks(sorted),
+              ::testing::Each(std::make_pair(0.0, 1.0)));
+}
+
+TYPED_TEST(PercentileTest, LargeInputSetMatchesSortedInputs) {
+  // Enough inputs for lookups to use the index, with runs of duplicates.
+  Percentile<TypeParam> percentile;
+  std::vector<TypeParam> inputs;
+  for (int64_t i = 0; i < 100000; ++i) {
+    const TypeParam t = static_cast<TypeParam>((i * 7919) % 30011);
+    percentile.Add(t);
+    inputs.push_back(t);
+  }
+  std::sort(inputs.begin(), inputs.end());
+
+  std::vector<TypeParam> values;
+  for (int64_t v = -2; v < 30015; v += 3) {
+    values.push_back(static_cast<TypeParam>(v));
+  }
+  const std::vector<std::pair<double, double>> ranks =
+      percentile.GetRelativeRanks(values);
+  for (int i = 0; i < values.size(); ++i) {
+    const double num_lt =
+        std::lower_bound(inputs.begin(), inputs.end(), values[i]) -
+        inputs.begin();
+    const double num_le =
+        std::upper_bound(inputs.begin(), inputs.end(), values[i]) -
+        inputs.begin();
+    const std::pair<double, double> expected(num_lt / inputs.size(),
+                                             num_le / inputs.size());
+    EXPECT_EQ(percentile.GetRelativeRank(values[i]), expected);
+    EXPECT_EQ(ranks[i], expected);
+  }
+
+  // Adding inputs invalidates the index.
+  percentile.Add(static_cast<TypeParam>(-1));
+  EXPECT_EQ(percentile.GetRelativeRank(static_cast<TypeParam>(0)).first,
+            1.0 / percentile.num_values());
+}
+
 }  // namespace
 }  // namespace base
 }  // namespace differential_privacy
@@ -19,6 +19,7 @@ limitations under the License.
 /* Create the aggregates:
  *
  * ANON_COUNT(column, epsilon)
+ * ANON_COUNT(column, epsilon, delta)
  * ANON_COUNT(column)
  *
  * where column is of any type.
@@ -28,39 +29,124 @@ limitations under the License.
 CREATE FUNCTION anon_count_accum(internal, anyelement, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_count_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for with epsilon and delta.
+CREATE FUNCTION anon_count_accum(internal, anyelement,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_count_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for no epsilon.
 CREATE FUNCTION anon_count_accum(internal, anyelement)
 RETURNS internal AS
   'anon_func','anon_count_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract.
 CREATE FUNCTION anon_count_extract(internal) RETURNS bigint AS
   'anon_func','anon_count_extract'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for with epsilon.
+CREATE FUNCTION anon_count_remove(internal, anyelement, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_count_remove'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for with epsilon and delta.
+CREATE FUNCTION anon_count_remove(internal, anyelement,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_count_remove'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for no epsilon.
+CREATE FUNCTION anon_count_remove(internal, anyelement)
+RETURNS internal AS
+  'anon_func','anon_count_remove'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Extract for moving aggregates, called for every window frame.
+-- Every call releases a result with the full epsilon, so a query that
+-- returns N window frames spends N times epsilon.
+CREATE FUNCTION anon_count_moving_extract(internal) RETURNS bigint AS
+  'anon_func','anon_count_moving_extract'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_count_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_count_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_count_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_count_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_count_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_count_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for with epsilon.
 CREATE AGGREGATE anon_count(anyelement, epsilon double precision) (
   SFUNC = anon_count_accum,
   STYPE = internal,
-  FINALFUNC = anon_count_extract
+  FINALFUNC = anon_count_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_count_accum,
+  MINVFUNC = anon_count_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_count_moving_extract,
+  COMBINEFUNC = anon_count_combine,
+  SERIALFUNC = anon_count_serialize,
+  DESERIALFUNC = anon_count_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for with epsilon and delta.
+CREATE AGGREGATE anon_count(anyelement,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_count_accum,
+  STYPE = internal,
+  FINALFUNC = anon_count_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_count_accum,
+  MINVFUNC = anon_count_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_count_moving_extract,
+  COMBINEFUNC = anon_count_combine,
+  SERIALFUNC = anon_count_serialize,
+  DESERIALFUNC = anon_count_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for no epsilon.
 CREATE AGGREGATE anon_count(anyelement) (
   SFUNC = anon_count_accum,
   STYPE = internal,
-  FINALFUNC = anon_count_extract
+  FINALFUNC = anon_count_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_count_accum,
+  MINVFUNC = anon_count_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_count_moving_extract,
+  COMBINEFUNC = anon_count_combine,
+  SERIALFUNC = anon_count_serialize,
+  DESERIALFUNC = anon_count_deserialize,
+  PARALLEL = SAFE
 );
 
 
 /* Create the aggregates:
  *
  * ANON_SUM(column, epsilon)
+ * ANON_SUM(column, epsilon, delta)
  * ANON_SUM(column)
  * ANON_SUM(column, lower, upper, epsilon)
+ * ANON_SUM(column, lower, upper, epsilon, delta)
  * ANON_SUM(column, lower, upper)
  *
  * where column can be double, bigint, integer, or smallint type.
@@ -70,170 +156,431 @@ CREATE AGGREGATE anon_count(anyelement) (
 CREATE FUNCTION anon_sum_accum(internal, entry double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entry double precision,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for double type, auto bounding, no epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry double precision)
 RETURNS internal AS
   'anon_func','anon_sum_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, auto bounding, with epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry bigint, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entry bigint,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, auto bounding, no epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry bigint)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, auto bounding, with epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry integer, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for integer type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entry integer,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, auto bounding, no epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry integer)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, auto bounding, with epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry smallint, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for smallint type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entry smallint,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, auto bounding, no epsilon.
 CREATE FUNCTION anon_sum_accum(internal, entry smallint)
 RETURNS internal AS
   'anon_func','anon_sum_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for double type, manual bounding, with epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for double type, manual bounding, no epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, manual bounding, with epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry bigint, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry bigint, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, manual bounding, no epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry bigint, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, manual bounding, with epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry integer, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for integer type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry integer, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, manual bounding, no epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry integer, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, manual bounding, with epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry smallint, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for smallint type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry smallint, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, manual bounding, no epsilon.
 CREATE FUNCTION anon_sum_with_bounds_accum(internal, entry smallint, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_sum_with_bounds_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract for double type.
 CREATE FUNCTION anon_sum_extract_double(internal) RETURNS double precision AS
   'anon_func','anon_sum_extract_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract for int type.
 CREATE FUNCTION anon_sum_extract_int(internal) RETURNS bigint AS
   'anon_func','anon_sum_extract_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for double type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for double type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for double type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry double precision, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for bigint type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry bigint, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for bigint type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry bigint, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for bigint type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry bigint, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for integer type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry integer, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for integer type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry integer, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for integer type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry integer, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for smallint type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry smallint, lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for smallint type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry smallint, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Inverse transition for smallint type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_remove(internal, entry smallint, lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_remove_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Extract for moving aggregates of double type.
+-- Every call releases a result with the full epsilon, so a query that
+-- returns N window frames spends N times epsilon.
+CREATE FUNCTION anon_sum_moving_extract_double(internal) RETURNS double precision AS
+  'anon_func','anon_sum_moving_extract_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Extract for moving aggregates of int type.
+-- Every call releases a result with the full epsilon, so a query that
+-- returns N window frames spends N times epsilon.
+CREATE FUNCTION anon_sum_moving_extract_int(internal) RETURNS bigint AS
+  'anon_func','anon_sum_moving_extract_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_sum_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_sum_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_sum_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_sum_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_sum_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_sum_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for double type, auto bounding, with epsilon.
 CREATE AGGREGATE anon_sum(entry double precision, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_double
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entry double precision,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for double type, auto bounding, no epsilon.
 CREATE AGGREGATE anon_sum(entry double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_double
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, auto bounding, with epsilon.
 CREATE AGGREGATE anon_sum(entry bigint, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entry bigint,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, auto bounding, no epsilon.
 CREATE AGGREGATE anon_sum(entry bigint) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, auto bounding, with epsilon.
 CREATE AGGREGATE anon_sum(entry integer, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for integer type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entry integer,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, auto bounding, no epsilon.
 CREATE AGGREGATE anon_sum(entry integer) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for smallint type, auto bounding, with epsilon.
 CREATE AGGREGATE anon_sum(entry smallint, epsilon double precision) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for smallint type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entry smallint,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for smallint type, auto bounding, no epsilon.
 CREATE AGGREGATE anon_sum(entry smallint) (
   SFUNC = anon_sum_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, manual bounding, with epsilon.
@@ -241,14 +588,49 @@ CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub doub
   epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub double precision,
+  epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, manual bounding, no epsilon.
 CREATE AGGREGATE anon_sum_with_bounds(entry bigint, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for double type, manual bounding, with epsilon.
@@ -256,7 +638,33 @@ CREATE AGGREGATE anon_sum_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_double
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_double,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum_with_bounds(entry double precision, lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_double,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for double type, manual bounding, no epsilon.
@@ -264,7 +672,16 @@ CREATE AGGREGATE anon_sum_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_double
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_double,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, manual bounding, with epsilon.
@@ -272,14 +689,49 @@ CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub dou
     epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for integer type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub double precision,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, manual bounding, no epsilon.
 CREATE AGGREGATE anon_sum_with_bounds(entry integer, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 
@@ -288,22 +740,42 @@ CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub do
     epsilon double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for smallint type, manual bounding, no epsilon.
 CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub double precision) (
   SFUNC = anon_sum_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_sum_extract_int
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  MSFUNC = anon_sum_with_bounds_accum,
+  MINVFUNC = anon_sum_with_bounds_remove,
+  MSTYPE = internal,
+  MFINALFUNC = anon_sum_moving_extract_int,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
 );
 
 
 /* Create the aggregates:
  *
  * ANON_AVG(column, epsilon)
+ * ANON_AVG(column, epsilon, delta)
  * ANON_AVG(column)
  * ANON_AVG(column, lower, upper, epsilon)
+ * ANON_AVG(column, lower, upper, epsilon, delta)
  * ANON_AVG(column, lower, upper)
  *
  * where column can be any numeric type smaller than double precision.
@@ -313,45 +785,97 @@ CREATE AGGREGATE anon_sum_with_bounds(entry smallint, lb double precision, ub do
 CREATE FUNCTION anon_avg_accum(internal, entry double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_avg_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_avg_accum(internal, entry double precision,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for auto bounding, no epsilon.
 CREATE FUNCTION anon_avg_accum(internal, entry double precision)
 RETURNS internal AS
   'anon_func','anon_avg_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, with epsilon.
 CREATE FUNCTION anon_avg_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_avg_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_avg_with_bounds_accum(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_with_bounds_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, no epsilon.
 CREATE FUNCTION anon_avg_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_avg_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract.
 CREATE FUNCTION anon_avg_extract(internal) RETURNS double precision AS
   'anon_func','anon_avg_extract'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_avg_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_avg_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_avg_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_avg_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_avg_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_avg_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for auto bounding, with epsilon.
 CREATE AGGREGATE anon_avg(entry double precision, epsilon double precision) (
   SFUNC = anon_avg_accum,
   STYPE = internal,
-  FINALFUNC = anon_avg_extract
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_avg(entry double precision,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_avg_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for auto bounding, no epsilon.
 CREATE AGGREGATE anon_avg(entry double precision) (
   SFUNC = anon_avg_accum,
   STYPE = internal,
-  FINALFUNC = anon_avg_extract
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, with epsilon.
@@ -359,7 +883,25 @@ CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_avg_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_avg_extract
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_avg_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, no epsilon.
@@ -367,15 +909,22 @@ CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_avg_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_avg_extract
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
 );
 
 
 /* Create the aggregates:
  *
  * ANON_VAR(column, epsilon)
+ * ANON_VAR(column, epsilon, delta)
  * ANON_VAR(column)
  * ANON_VAR(column, lower, upper, epsilon)
+ * ANON_VAR(column, lower, upper, epsilon, delta)
  * ANON_VAR(column, lower, upper)
  *
  * where column can be any numeric type smaller than double precision.
@@ -385,45 +934,97 @@ CREATE AGGREGATE anon_avg_with_bounds(entry double precision, lb double precisio
 CREATE FUNCTION anon_var_accum(internal, entry double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_var_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_var_accum(internal, entry double precision,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_var_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for auto bounding, no epsilon.
 CREATE FUNCTION anon_var_accum(internal, entry double precision)
 RETURNS internal AS
   'anon_func','anon_var_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, with epsilon.
 CREATE FUNCTION anon_var_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_var_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_var_with_bounds_accum(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_var_with_bounds_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, no epsilon.
 CREATE FUNCTION anon_var_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_var_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract.
 CREATE FUNCTION anon_var_extract(internal) RETURNS double precision AS
   'anon_func','anon_var_extract'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_var_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_var_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_var_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_var_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_var_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_var_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for auto bounding, with epsilon.
 CREATE AGGREGATE anon_var(entry double precision, epsilon double precision) (
   SFUNC = anon_var_accum,
   STYPE = internal,
-  FINALFUNC = anon_var_extract
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_var(entry double precision,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_var_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for auto bounding, no epsilon.
 CREATE AGGREGATE anon_var(entry double precision) (
   SFUNC = anon_var_accum,
   STYPE = internal,
-  FINALFUNC = anon_var_extract
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, with epsilon.
@@ -431,7 +1032,25 @@ CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precisio
     ub double precision, epsilon double precision) (
   SFUNC = anon_var_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_var_extract
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_var_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, no epsilon.
@@ -439,15 +1058,22 @@ CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precisio
     ub double precision) (
   SFUNC = anon_var_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_var_extract
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
 );
 
 
 /* Create the aggregates:
  *
  * ANON_STDDEV(column, epsilon)
+ * ANON_STDDEV(column, epsilon, delta)
  * ANON_STDDEV(column)
  * ANON_STDDEV(column, lower, upper, epsilon)
+ * ANON_STDDEV(column, lower, upper, epsilon, delta)
  * ANON_STDDEV(column, lower, upper)
  *
  * where column can be any numeric type smaller than double precision.
@@ -457,45 +1083,97 @@ CREATE AGGREGATE anon_var_with_bounds(entry double precision, lb double precisio
 CREATE FUNCTION anon_stddev_accum(internal, entry double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_stddev_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_stddev_accum(internal, entry double precision,
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for auto bounding, no epsilon.
 CREATE FUNCTION anon_stddev_accum(internal, entry double precision)
 RETURNS internal AS
   'anon_func','anon_stddev_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, with epsilon.
 CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_stddev_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entry double precision, lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_with_bounds_accum'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for manual bounding, no epsilon.
 CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entry double precision, lb double precision,
   ub double precision)
 RETURNS internal AS
   'anon_func','anon_stddev_with_bounds_accum'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract.
 CREATE FUNCTION anon_stddev_extract(internal) RETURNS double precision AS
   'anon_func','anon_stddev_extract'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_stddev_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_stddev_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_stddev_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_stddev_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_stddev_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_stddev_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for auto bounding, with epsilon.
 CREATE AGGREGATE anon_stddev(entry double precision, epsilon double precision) (
   SFUNC = anon_stddev_accum,
   STYPE = internal,
-  FINALFUNC = anon_stddev_extract
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_stddev(entry double precision,
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_stddev_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for auto bounding, no epsilon.
 CREATE AGGREGATE anon_stddev(entry double precision) (
   SFUNC = anon_stddev_accum,
   STYPE = internal,
-  FINALFUNC = anon_stddev_extract
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, with epsilon.
@@ -503,7 +1181,25 @@ CREATE AGGREGATE anon_stddev_with_bounds(entry double precision, lb double preci
     ub double precision, epsilon double precision) (
   SFUNC = anon_stddev_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_stddev_extract
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_stddev_with_bounds(entry double precision, lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_stddev_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for manual bounding, no epsilon.
@@ -511,13 +1207,19 @@ CREATE AGGREGATE anon_stddev_with_bounds(entry double precision, lb double preci
     ub double precision) (
   SFUNC = anon_stddev_with_bounds_accum,
   STYPE = internal,
-  FINALFUNC = anon_stddev_extract
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
 );
 
 
 /* Create the aggregates:
  *
  * ANON_NTILE(column, lower, upper, epsilon)
+ * ANON_NTILE(column, lower, upper, epsilon, delta)
  * ANON_NTILE(column, lower, upper)
  *
  * where column can be double, bigint, integer, or smallint type.
@@ -528,73 +1230,134 @@ CREATE FUNCTION anon_ntile_accum(internal, entry double precision, percentile do
   lb double precision, ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double type, with epsilon and delta.
+CREATE FUNCTION anon_ntile_accum(internal, entry double precision, percentile double precision,
+  lb double precision, ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_ntile_accum_double'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for double type, no epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry double precision, percentile double precision,
   lb double precision, ub double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, with epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry bigint, percentile double precision,
   lb double precision, ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint type, with epsilon and delta.
+CREATE FUNCTION anon_ntile_accum(internal, entry bigint, percentile double precision,
+  lb double precision, ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_ntile_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for bigint type, no epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry bigint, percentile double precision,
   lb double precision, ub double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, with epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry integer, percentile double precision,
   lb double precision, ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for integer type, with epsilon and delta.
+CREATE FUNCTION anon_ntile_accum(internal, entry integer, percentile double precision,
+  lb double precision, ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_ntile_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for integer type, no epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry integer, percentile double precision,
   lb double precision, ub double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, with epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry smallint, percentile double precision,
   lb double precision, ub double precision, epsilon double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for smallint type, with epsilon and delta.
+CREATE FUNCTION anon_ntile_accum(internal, entry smallint, percentile double precision,
+  lb double precision, ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_ntile_accum_int'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Accum for smallint type, no epsilon.
 CREATE FUNCTION anon_ntile_accum(internal, entry smallint, percentile double precision,
   lb double precision, ub double precision)
 RETURNS internal AS
   'anon_func','anon_ntile_accum_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract for double type.
 CREATE FUNCTION anon_ntile_extract_double(internal) RETURNS double precision AS
   'anon_func','anon_ntile_extract_double'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
 
 -- Extract for int type.
 CREATE FUNCTION anon_ntile_extract_int(internal) RETURNS bigint AS
   'anon_func','anon_ntile_extract_int'
-LANGUAGE C IMMUTABLE;
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Combine, used for parallel aggregation.
+CREATE FUNCTION anon_ntile_combine(internal, internal) RETURNS internal AS
+  'anon_func','anon_ntile_combine'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Serialize, used for parallel aggregation.
+CREATE FUNCTION anon_ntile_serialize(internal) RETURNS bytea AS
+  'anon_func','anon_ntile_serialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+-- Deserialize, used for parallel aggregation.
+CREATE FUNCTION anon_ntile_deserialize(bytea, internal) RETURNS internal AS
+  'anon_func','anon_ntile_deserialize'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
 
 -- Aggregate for double type, with epsilon.
 CREATE AGGREGATE anon_ntile(entry double precision, percentile double precision,
     lb double precision, ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_double
+  FINALFUNC = anon_ntile_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double type, with epsilon and delta.
+CREATE AGGREGATE anon_ntile(entry double precision, percentile double precision,
+    lb double precision, ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_ntile_accum,
+  STYPE = internal,
+  FINALFUNC = anon_ntile_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for double type, no epsilon.
@@ -602,7 +1365,12 @@ CREATE AGGREGATE anon_ntile(entry double precision, percentile double precision,
   lb double precision, ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_double
+  FINALFUNC = anon_ntile_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, with epsilon.
@@ -610,7 +1378,25 @@ CREATE AGGREGATE anon_ntile(entry bigint, percentile double precision, lb double
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint type, with epsilon and delta.
+CREATE AGGREGATE anon_ntile(entry bigint, percentile double precision, lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_ntile_accum,
+  STYPE = internal,
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for bigint type, no epsilon.
@@ -618,7 +1404,12 @@ CREATE AGGREGATE anon_ntile(entry bigint, percentile double precision, lb double
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, with epsilon.
@@ -626,7 +1417,25 @@ CREATE AGGREGATE anon_ntile(entry integer, percentile double precision,  lb doub
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for integer type, with epsilon and delta.
+CREATE AGGREGATE anon_ntile(entry integer, percentile double precision,  lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_ntile_accum,
+  STYPE = internal,
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for integer type, no epsilon.
@@ -634,7 +1443,12 @@ CREATE AGGREGATE anon_ntile(entry integer, percentile double precision,  lb doub
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for smallint type, with epsilon.
@@ -642,7 +1456,25 @@ CREATE AGGREGATE anon_ntile(entry smallint, percentile double precision,  lb dou
     ub double precision, epsilon double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for smallint type, with epsilon and delta.
+CREATE AGGREGATE anon_ntile(entry smallint, percentile double precision,  lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_ntile_accum,
+  STYPE = internal,
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
 );
 
 -- Aggregate for smallint type, no epsilon.
@@ -650,5 +1482,613 @@ CREATE AGGREGATE anon_ntile(entry smallint, percentile double precision,  lb dou
     ub double precision) (
   SFUNC = anon_ntile_accum,
   STYPE = internal,
-  FINALFUNC = anon_ntile_extract_int
+  FINALFUNC = anon_ntile_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_ntile_combine,
+  SERIALFUNC = anon_ntile_serialize,
+  DESERIALFUNC = anon_ntile_deserialize,
+  PARALLEL = SAFE
+);
+
+
+/* Create the array aggregates:
+ *
+ * ANON_SUM(array_column, epsilon)
+ * ANON_SUM(array_column, epsilon, delta)
+ * ANON_SUM(array_column)
+ * ANON_SUM_WITH_BOUNDS(array_column, lower, upper, epsilon)
+ * ANON_SUM_WITH_BOUNDS(array_column, lower, upper, epsilon, delta)
+ * ANON_SUM_WITH_BOUNDS(array_column, lower, upper)
+ *
+ * and likewise for ANON_AVG, ANON_VAR and ANON_STDDEV, where array_column is a
+ * double precision array, or a bigint array for ANON_SUM. Every element of
+ * every array is an entry, as if the arrays were unnested, but each array is
+ * added in one call. Null elements are skipped.
+ *
+ * Like the scalar aggregates, these assume that each entry is owned by a
+ * distinct user. The elements of an array are separate entries, both for the
+ * sensitivity of the result and for partition selection, so the result is
+ * only differentially private if every element of every array belongs to a
+ * different user. Do not use them on arrays that hold several values of the
+ * same user, e.g., per-user event vectors.
+ */
+
+-- Accum for double array type, auto bounding, with epsilon.
+CREATE FUNCTION anon_sum_accum(internal, entries double precision[], epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entries double precision[],
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, no epsilon.
+CREATE FUNCTION anon_sum_accum(internal, entries double precision[])
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Aggregate for double array type, auto bounding, with epsilon.
+CREATE AGGREGATE anon_sum(entries double precision[], epsilon double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entries double precision[],
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, no epsilon.
+CREATE AGGREGATE anon_sum(entries double precision[]) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon.
+CREATE AGGREGATE anon_sum_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, no epsilon.
+CREATE AGGREGATE anon_sum_with_bounds(entries double precision[], lb double precision,
+    ub double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_double,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Accum for bigint array type, auto bounding, with epsilon.
+CREATE FUNCTION anon_sum_accum(internal, entries bigint[], epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint array type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_accum(internal, entries bigint[],
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint array type, auto bounding, no epsilon.
+CREATE FUNCTION anon_sum_accum(internal, entries bigint[])
+RETURNS internal AS
+  'anon_func','anon_sum_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint array type, manual bounding, with epsilon.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries bigint[], lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint array type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries bigint[], lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for bigint array type, manual bounding, no epsilon.
+CREATE FUNCTION anon_sum_with_bounds_accum(internal, entries bigint[], lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_sum_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Aggregate for bigint array type, auto bounding, with epsilon.
+CREATE AGGREGATE anon_sum(entries bigint[], epsilon double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint array type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum(entries bigint[],
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint array type, auto bounding, no epsilon.
+CREATE AGGREGATE anon_sum(entries bigint[]) (
+  SFUNC = anon_sum_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint array type, manual bounding, with epsilon.
+CREATE AGGREGATE anon_sum_with_bounds(entries bigint[], lb double precision,
+    ub double precision, epsilon double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint array type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_sum_with_bounds(entries bigint[], lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for bigint array type, manual bounding, no epsilon.
+CREATE AGGREGATE anon_sum_with_bounds(entries bigint[], lb double precision,
+    ub double precision) (
+  SFUNC = anon_sum_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_sum_extract_int,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_sum_combine,
+  SERIALFUNC = anon_sum_serialize,
+  DESERIALFUNC = anon_sum_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Accum for double array type, auto bounding, with epsilon.
+CREATE FUNCTION anon_avg_accum(internal, entries double precision[], epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_avg_accum(internal, entries double precision[],
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, no epsilon.
+CREATE FUNCTION anon_avg_accum(internal, entries double precision[])
+RETURNS internal AS
+  'anon_func','anon_avg_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon.
+CREATE FUNCTION anon_avg_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_avg_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, no epsilon.
+CREATE FUNCTION anon_avg_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_avg_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Aggregate for double array type, auto bounding, with epsilon.
+CREATE AGGREGATE anon_avg(entries double precision[], epsilon double precision) (
+  SFUNC = anon_avg_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_avg(entries double precision[],
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_avg_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, no epsilon.
+CREATE AGGREGATE anon_avg(entries double precision[]) (
+  SFUNC = anon_avg_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon.
+CREATE AGGREGATE anon_avg_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision) (
+  SFUNC = anon_avg_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_avg_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_avg_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, no epsilon.
+CREATE AGGREGATE anon_avg_with_bounds(entries double precision[], lb double precision,
+    ub double precision) (
+  SFUNC = anon_avg_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_avg_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_avg_combine,
+  SERIALFUNC = anon_avg_serialize,
+  DESERIALFUNC = anon_avg_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Accum for double array type, auto bounding, with epsilon.
+CREATE FUNCTION anon_var_accum(internal, entries double precision[], epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_var_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_var_accum(internal, entries double precision[],
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_var_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, no epsilon.
+CREATE FUNCTION anon_var_accum(internal, entries double precision[])
+RETURNS internal AS
+  'anon_func','anon_var_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon.
+CREATE FUNCTION anon_var_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_var_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_var_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_var_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, no epsilon.
+CREATE FUNCTION anon_var_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_var_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Aggregate for double array type, auto bounding, with epsilon.
+CREATE AGGREGATE anon_var(entries double precision[], epsilon double precision) (
+  SFUNC = anon_var_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_var(entries double precision[],
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_var_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, no epsilon.
+CREATE AGGREGATE anon_var(entries double precision[]) (
+  SFUNC = anon_var_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon.
+CREATE AGGREGATE anon_var_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision) (
+  SFUNC = anon_var_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_var_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_var_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, no epsilon.
+CREATE AGGREGATE anon_var_with_bounds(entries double precision[], lb double precision,
+    ub double precision) (
+  SFUNC = anon_var_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_var_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_var_combine,
+  SERIALFUNC = anon_var_serialize,
+  DESERIALFUNC = anon_var_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Accum for double array type, auto bounding, with epsilon.
+CREATE FUNCTION anon_stddev_accum(internal, entries double precision[], epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, with epsilon and delta.
+CREATE FUNCTION anon_stddev_accum(internal, entries double precision[],
+  epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, auto bounding, no epsilon.
+CREATE FUNCTION anon_stddev_accum(internal, entries double precision[])
+RETURNS internal AS
+  'anon_func','anon_stddev_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon.
+CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, with epsilon and delta.
+CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision, epsilon double precision, delta double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Accum for double array type, manual bounding, no epsilon.
+CREATE FUNCTION anon_stddev_with_bounds_accum(internal, entries double precision[], lb double precision,
+  ub double precision)
+RETURNS internal AS
+  'anon_func','anon_stddev_with_bounds_accum_array'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+-- Aggregate for double array type, auto bounding, with epsilon.
+CREATE AGGREGATE anon_stddev(entries double precision[], epsilon double precision) (
+  SFUNC = anon_stddev_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, with epsilon and delta.
+CREATE AGGREGATE anon_stddev(entries double precision[],
+    epsilon double precision, delta double precision) (
+  SFUNC = anon_stddev_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, auto bounding, no epsilon.
+CREATE AGGREGATE anon_stddev(entries double precision[]) (
+  SFUNC = anon_stddev_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon.
+CREATE AGGREGATE anon_stddev_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision) (
+  SFUNC = anon_stddev_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, with epsilon and delta.
+CREATE AGGREGATE anon_stddev_with_bounds(entries double precision[], lb double precision,
+    ub double precision, epsilon double precision, delta double precision) (
+  SFUNC = anon_stddev_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
+);
+
+-- Aggregate for double array type, manual bounding, no epsilon.
+CREATE AGGREGATE anon_stddev_with_bounds(entries double precision[], lb double precision,
+    ub double precision) (
+  SFUNC = anon_stddev_with_bounds_accum,
+  STYPE = internal,
+  FINALFUNC = anon_stddev_extract,
+  FINALFUNC_MODIFY = READ_WRITE,
+  COMBINEFUNC = anon_stddev_combine,
+  SERIALFUNC = anon_stddev_serialize,
+  DESERIALFUNC = anon_stddev_deserialize,
+  PARALLEL = SAFE
 );
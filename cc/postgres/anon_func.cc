@@ -18,10 +18,18 @@ extern "C" {
 
 #include "postgres.h"
 #include "fmgr.h"
+#include "catalog/pg_type.h"
+#include "nodes/pg_list.h"
+#include "nodes/primnodes.h"
+#include "utils/array.h"
 #include "utils/datum.h"
+#include "utils/guc.h"
+#include "utils/lsyscache.h"
 
 PG_MODULE_MAGIC;
 
+void _PG_init(void);
+
 #define CHECK_AGG_CONTEXT(fcinfo)                                 \
   if (!AggCheckCallContext(fcinfo, NULL)) {                       \
     elog(ERROR, "Anon function called in non-aggregate context"); \
@@ -34,43 +42,214 @@ PG_MODULE_MAGIC;
 // ANON_COUNT
 PG_FUNCTION_INFO_V1(anon_count_accum);
 PG_FUNCTION_INFO_V1(anon_count_extract);
+PG_FUNCTION_INFO_V1(anon_count_remove);
+PG_FUNCTION_INFO_V1(anon_count_moving_extract);
+PG_FUNCTION_INFO_V1(anon_count_combine);
+PG_FUNCTION_INFO_V1(anon_count_serialize);
+PG_FUNCTION_INFO_V1(anon_count_deserialize);
 
 // ANON_SUM
 PG_FUNCTION_INFO_V1(anon_sum_accum_double);
 PG_FUNCTION_INFO_V1(anon_sum_accum_int);
 PG_FUNCTION_INFO_V1(anon_sum_with_bounds_accum_double);
 PG_FUNCTION_INFO_V1(anon_sum_with_bounds_accum_int);
+PG_FUNCTION_INFO_V1(anon_sum_accum_array);
+PG_FUNCTION_INFO_V1(anon_sum_with_bounds_accum_array);
 PG_FUNCTION_INFO_V1(anon_sum_extract_double);
 PG_FUNCTION_INFO_V1(anon_sum_extract_int);
+PG_FUNCTION_INFO_V1(anon_sum_with_bounds_remove_double);
+PG_FUNCTION_INFO_V1(anon_sum_with_bounds_remove_int);
+PG_FUNCTION_INFO_V1(anon_sum_moving_extract_double);
+PG_FUNCTION_INFO_V1(anon_sum_moving_extract_int);
+PG_FUNCTION_INFO_V1(anon_sum_combine);
+PG_FUNCTION_INFO_V1(anon_sum_serialize);
+PG_FUNCTION_INFO_V1(anon_sum_deserialize);
 
 // ANON_AVG
 PG_FUNCTION_INFO_V1(anon_avg_accum);
 PG_FUNCTION_INFO_V1(anon_avg_with_bounds_accum);
+PG_FUNCTION_INFO_V1(anon_avg_accum_array);
+PG_FUNCTION_INFO_V1(anon_avg_with_bounds_accum_array);
 PG_FUNCTION_INFO_V1(anon_avg_extract);
+PG_FUNCTION_INFO_V1(anon_avg_combine);
+PG_FUNCTION_INFO_V1(anon_avg_serialize);
+PG_FUNCTION_INFO_V1(anon_avg_deserialize);
 
 // ANON_VAR
 PG_FUNCTION_INFO_V1(anon_var_accum);
 PG_FUNCTION_INFO_V1(anon_var_with_bounds_accum);
+PG_FUNCTION_INFO_V1(anon_var_accum_array);
+PG_FUNCTION_INFO_V1(anon_var_with_bounds_accum_array);
 PG_FUNCTION_INFO_V1(anon_var_extract);
+PG_FUNCTION_INFO_V1(anon_var_combine);
+PG_FUNCTION_INFO_V1(anon_var_serialize);
+PG_FUNCTION_INFO_V1(anon_var_deserialize);
 
 // ANON_STDDEV
 PG_FUNCTION_INFO_V1(anon_stddev_accum);
 PG_FUNCTION_INFO_V1(anon_stddev_with_bounds_accum);
+PG_FUNCTION_INFO_V1(anon_stddev_accum_array);
+PG_FUNCTION_INFO_V1(anon_stddev_with_bounds_accum_array);
 PG_FUNCTION_INFO_V1(anon_stddev_extract);
+PG_FUNCTION_INFO_V1(anon_stddev_combine);
+PG_FUNCTION_INFO_V1(anon_stddev_serialize);
+PG_FUNCTION_INFO_V1(anon_stddev_deserialize);
 
 // ANON_NTILE
 PG_FUNCTION_INFO_V1(anon_ntile_accum_double);
 PG_FUNCTION_INFO_V1(anon_ntile_accum_int);
 PG_FUNCTION_INFO_V1(anon_ntile_extract_double);
 PG_FUNCTION_INFO_V1(anon_ntile_extract_int);
+PG_FUNCTION_INFO_V1(anon_ntile_combine);
+PG_FUNCTION_INFO_V1(anon_ntile_serialize);
+PG_FUNCTION_INFO_V1(anon_ntile_deserialize);
 }
 
+#include <climits>
+#include <memory>
+#include <new>
+#include <vector>
+
 #include "dp_func.h"
 
+/*
+ * Configuration parameters.
+ */
+
+// Number of sub-bins of the log histogram used by ANON_NTILE, or 0 to store
+// every input.
+static int ntile_log_histogram_sub_bins = 0;
+
+void _PG_init(void) {
+  DefineCustomIntVariable(
+      "anon_func.ntile_log_histogram_sub_bins",
+      "Number of sub-bins of the log histogram used by anon_ntile.",
+      "If positive, anon_ntile counts its inputs in a log histogram with this "
+      "many sub-bins per bin, which bounds its memory, instead of storing "
+      "every input. 0 stores every input.",
+      &ntile_log_histogram_sub_bins, 0, 0, INT_MAX, PGC_SUSET, 0, NULL, NULL,
+      NULL);
+}
+
 /*
  * Helper functions.
  */
 
+// Destroys a state that was constructed in an aggregate memory context.
+template <typename DpFunction>
+void destroy_state(void* arg) {
+  reinterpret_cast<DpFunction*>(arg)->~DpFunction();
+}
+
+// Allocates memory for a DpFunction state in the aggregate memory context.
+template <typename DpFunction>
+void* alloc_state(PG_FUNCTION_ARGS) {
+  MemoryContext agg_context;
+  AggCheckCallContext(fcinfo, &agg_context);
+  return MemoryContextAlloc(agg_context, sizeof(DpFunction));
+}
+
+// Registers a state constructed in memory from alloc_state, so that it is
+// destroyed when the aggregate memory context is reset or deleted. The
+// underlying algorithm is then freed with the query, even if the final
+// function is never called, e.g., because the query fails.
+template <typename DpFunction>
+DpFunction* register_state(PG_FUNCTION_ARGS, DpFunction* state) {
+  MemoryContext agg_context;
+  AggCheckCallContext(fcinfo, &agg_context);
+  MemoryContextCallback* callback =
+      reinterpret_cast<MemoryContextCallback*>(
+          MemoryContextAlloc(agg_context, sizeof(MemoryContextCallback)));
+  callback->func = destroy_state<DpFunction>;
+  callback->arg = state;
+  MemoryContextRegisterResetCallback(agg_context, callback);
+  return state;
+}
+
+// Constructs a state from the parameters that cache_params cached for this
+// aggregate call, or returns nullptr if they were not cached. They are only
+// cached if they are the same for every group, and they were already
+// validated when the first state was constructed. Constructing from them
+// skips reading the arguments and building the noise mechanisms.
+template <typename DpFunction>
+DpFunction* new_cached_state(PG_FUNCTION_ARGS, std::string* err) {
+  const DpFunc::Params* params =
+      reinterpret_cast<const DpFunc::Params*>(fcinfo->flinfo->fn_extra);
+  if (!params) {
+    return nullptr;
+  }
+  return register_state(fcinfo, NewDpFunc<DpFunction>(
+                                    *params, err,
+                                    alloc_state<DpFunction>(fcinfo)));
+}
+
+// Index of the first parameter argument of an accum function, after the
+// state and the aggregated value.
+constexpr int kFirstParamArg = 2;
+
+// Returns whether argument i of the accum function is a constant or an
+// external parameter, i.e., cannot change between rows.
+// get_fn_expr_arg_stable alone does not suffice for accum functions: their
+// fn_expr only holds placeholders for the arguments, so the arguments of the
+// aggregate call itself are checked.
+bool accum_arg_is_stable(PG_FUNCTION_ARGS, int i) {
+  if (get_fn_expr_arg_stable(fcinfo->flinfo, i)) {
+    return true;
+  }
+  Aggref* aggref = AggGetAggref(fcinfo);
+  // Argument 0 of the accum function is the state, and argument i > 0 is
+  // argument i - 1 of the aggregate.
+  if (aggref == nullptr || i < 1 || i > list_length(aggref->args)) {
+    return false;
+  }
+  TargetEntry* entry =
+      static_cast<TargetEntry*>(list_nth(aggref->args, i - 1));
+  Node* arg = reinterpret_cast<Node*>(entry->expr);
+  return IsA(arg, Const) ||
+         (IsA(arg, Param) &&
+          reinterpret_cast<Param*>(arg)->paramkind == PARAM_EXTERN);
+}
+
+// Caches the parameters of a valid state in fn_extra, for new_cached_state,
+// if every parameter argument is stable. Otherwise, e.g., if the epsilon or
+// bounds are columns, every group reads and validates its own parameters.
+void cache_params(PG_FUNCTION_ARGS, const DpFunc& state) {
+  for (int i = kFirstParamArg; i < PG_NARGS(); ++i) {
+    if (!accum_arg_is_stable(fcinfo, i)) {
+      return;
+    }
+  }
+  void* params =
+      MemoryContextAlloc(fcinfo->flinfo->fn_mcxt, sizeof(DpFunc::Params));
+  fcinfo->flinfo->fn_extra = new (params) DpFunc::Params(state.params());
+}
+
+// Reads the optional partition selection delta at argument delta_arg, and
+// returns whether it was provided. If it was, the epsilon of the aggregate is
+// split evenly between partition selection and the DP function, so *epsilon
+// is halved.
+bool get_selection_delta(PG_FUNCTION_ARGS, int delta_arg, float8* epsilon,
+                         float8* delta) {
+  if (PG_NARGS() <= delta_arg) {
+    return false;
+  }
+  *delta = PG_GETARG_FLOAT8(delta_arg);
+  *epsilon /= 2;
+  return true;
+}
+
+// Returns whether the result of the group of a state may be released.
+// Partition selection suppresses groups with too few entries, whose result is
+// null. Errors are reported and also make the result null.
+bool keep_partition(DpFunc* state) {
+  std::string err;
+  bool keep = state->KeepPartition(&err);
+  if (!err.empty()) {
+    ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
+  }
+  return keep;
+}
+
 template <typename DpFunction>
 void add_arg_entry(PG_FUNCTION_ARGS, DpFunction* func, bool is_integral) {
   bool entry_added;
@@ -87,39 +266,116 @@ void add_arg_entry(PG_FUNCTION_ARGS, DpFunction* func, bool is_integral) {
   }
 }
 
-// Common code for bounded accum functions.
+// Adds the elements of an array of doubles or bigints to the DP function with
+// one AddEntries call per array, skipping null elements. Returns false if
+// adding them fails.
 template <typename DpFunction>
-Datum bounded_accum(PG_FUNCTION_ARGS, bool with_bounds, bool is_integral) {
-  CHECK_AGG_CONTEXT(fcinfo);
+bool add_array_elements(ArrayType* array, DpFunction* func) {
+  const Oid element_type = ARR_ELEMTYPE(array);
+  if (!ARR_HASNULL(array)) {
+    // Without nulls, the elements are stored as a C array, which is passed to
+    // the DP function without copying.
+    const int num_elements = ArrayGetNItems(ARR_NDIM(array), ARR_DIMS(array));
+    if (element_type == INT8OID) {
+      return func->AddEntries(
+          reinterpret_cast<const int64_t*>(ARR_DATA_PTR(array)), num_elements);
+    }
+    return func->AddEntries(
+        reinterpret_cast<const double*>(ARR_DATA_PTR(array)), num_elements);
+  }
+  int16 element_length;
+  bool element_by_value;
+  char element_align;
+  get_typlenbyvalalign(element_type, &element_length, &element_by_value,
+                       &element_align);
+  Datum* elements;
+  bool* nulls;
+  int num_elements;
+  deconstruct_array(array, element_type, element_length, element_by_value,
+                    element_align, &elements, &nulls, &num_elements);
+  std::vector<double> entries;
+  entries.reserve(num_elements);
+  for (int i = 0; i < num_elements; ++i) {
+    if (nulls[i]) {
+      continue;
+    }
+    entries.push_back(element_type == INT8OID
+                          ? static_cast<double>(DatumGetInt64(elements[i]))
+                          : DatumGetFloat8(elements[i]));
+  }
+  pfree(elements);
+  pfree(nulls);
+  return func->AddEntries(entries.data(), entries.size());
+}
+
+// Adds the elements of the array argument, which is cheaper than unnesting
+// the array and adding one element per call of the accum function. A null
+// array adds no entries.
+template <typename DpFunction>
+void add_arg_array_entries(PG_FUNCTION_ARGS, DpFunction* func) {
+  if (PG_ARGISNULL(1)) {
+    return;
+  }
+  ArrayType* array = PG_GETARG_ARRAYTYPE_P(1);
+  const Oid element_type = ARR_ELEMTYPE(array);
+  if (element_type != FLOAT8OID && element_type != INT8OID) {
+    ereport(ERROR,
+            (errcode(ERRCODE_DATATYPE_MISMATCH),
+            errmsg("Array entries must be double precision or bigint.")));
+  }
+  if (!add_array_elements(array, func)) {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("Adding entries to dp function failed.")));
+  }
+}
+
+// Returns the state of a bounded accum function, constructing it from the
+// arguments for the first row of a group.
+template <typename DpFunction>
+DpFunction* bounded_state(PG_FUNCTION_ARGS, bool with_bounds) {
   DpFunction* arg0;
 
   // Create DpFunction if it doesn't exist.
   if (PG_ARGISNULL(0)) {
-    // Grab the optional variables, if provided.
-    float8 epsilon = 0, lower = 0, upper = 0;
-    bool with_epsilon = false;
-    if (with_bounds) {
-      if (PG_NARGS() < 4) {
-        ereport(ERROR,
-            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
-            errmsg("Bounds provided but unable to be retrieved.")));
+    std::string err;
+    arg0 = new_cached_state<DpFunction>(fcinfo, &err);
+    if (!arg0) {
+      // Grab the optional variables, if provided.
+      float8 epsilon = 0, lower = 0, upper = 0, delta = 0;
+      bool with_epsilon = false, with_delta = false;
+      if (with_bounds) {
+        if (PG_NARGS() < 4) {
+          ereport(ERROR,
+              (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+              errmsg("Bounds provided but unable to be retrieved.")));
+        }
+        lower = PG_GETARG_FLOAT8(2);
+        upper = PG_GETARG_FLOAT8(3);
+      }
+      if (with_bounds && PG_NARGS() > 4) {
+        epsilon = PG_GETARG_FLOAT8(4);
+        with_epsilon = true;
+        with_delta = get_selection_delta(fcinfo, 5, &epsilon, &delta);
+      }
+      if (!with_bounds && PG_NARGS() > 2) {
+        epsilon = PG_GETARG_FLOAT8(2);
+        with_epsilon = true;
+        with_delta = get_selection_delta(fcinfo, 3, &epsilon, &delta);
       }
-      lower = PG_GETARG_FLOAT8(2);
-      upper = PG_GETARG_FLOAT8(3);
-    }
-    if (with_bounds && PG_NARGS() > 4) {
-      epsilon = PG_GETARG_FLOAT8(4);
-      with_epsilon = true;
-    }
-    if (!with_bounds && PG_NARGS() > 2) {
-      epsilon = PG_GETARG_FLOAT8(2);
-      with_epsilon = true;
-    }
 
-    // Construct the DP function.
-    std::string err;
-    arg0 = new DpFunction(&err, !with_epsilon, epsilon,
-                          !with_bounds, lower, upper);
+      // Construct the DP function.
+      arg0 = register_state(
+          fcinfo,
+          new (alloc_state<DpFunction>(fcinfo)) DpFunction(
+              &err, !with_epsilon, epsilon, !with_bounds, lower, upper));
+      if (err.empty() && with_delta) {
+        arg0->SetPartitionSelection(epsilon, delta, &err);
+      }
+      if (err.empty()) {
+        cache_params(fcinfo, *arg0);
+      }
+    }
     if (!err.empty()) {
       ereport(ERROR,
               (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
@@ -128,11 +384,27 @@ Datum bounded_accum(PG_FUNCTION_ARGS, bool with_bounds, bool is_integral) {
   } else {
     arg0 = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
   }
+  return arg0;
+}
 
+// Common code for bounded accum functions.
+template <typename DpFunction>
+Datum bounded_accum(PG_FUNCTION_ARGS, bool with_bounds, bool is_integral) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  DpFunction* arg0 = bounded_state<DpFunction>(fcinfo, with_bounds);
   add_arg_entry(fcinfo, arg0, is_integral);
   PG_RETURN_POINTER(arg0);
 }
 
+// Common code for bounded accum functions of array arguments.
+template <typename DpFunction>
+Datum bounded_array_accum(PG_FUNCTION_ARGS, bool with_bounds) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  DpFunction* arg0 = bounded_state<DpFunction>(fcinfo, with_bounds);
+  add_arg_array_entries(fcinfo, arg0);
+  PG_RETURN_POINTER(arg0);
+}
+
 // Common extract code for returning integer values. Return null if error.
 template <typename DpFunction>
 Datum int_extract(PG_FUNCTION_ARGS){
@@ -141,13 +413,15 @@ Datum int_extract(PG_FUNCTION_ARGS){
     PG_RETURN_NULL();
   }
   DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  if (!keep_partition(arg)) {
+    PG_RETURN_NULL();
+  }
   std::string err;
   int64_t result = arg->ResultRounded(&err);
   if (!err.empty()) {
     ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
     PG_RETURN_NULL();
   }
-  delete arg;
   PG_RETURN_INT64(result);
 }
 
@@ -159,16 +433,170 @@ Datum double_extract(PG_FUNCTION_ARGS){
     PG_RETURN_NULL();
   }
   DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  if (!keep_partition(arg)) {
+    PG_RETURN_NULL();
+  }
   std::string err;
   double result = arg->Result(&err);
   if (!err.empty()) {
     ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
     PG_RETURN_NULL();
   }
-  delete arg;
   PG_RETURN_FLOAT8(result);
 }
 
+// Common inverse transition code for moving aggregates. Return null if the
+// entry cannot be removed, which makes postgres aggregate the window frame
+// from scratch.
+template <typename DpFunction>
+Datum remove_arg_entry(PG_FUNCTION_ARGS, bool is_integral) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpFunction* arg0 = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  bool entry_removed;
+  if (is_integral) {
+    entry_removed = arg0->RemoveEntry(PG_GETARG_INT64(1));
+  } else {
+    entry_removed = arg0->RemoveEntry(PG_GETARG_FLOAT8(1));
+  }
+  if (!entry_removed) {
+    PG_RETURN_NULL();
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+// Returns a copy of a state, on which Result may be called without consuming
+// the state. Iff copying fails, the error std::string is populated.
+template <typename DpFunction>
+std::unique_ptr<DpFunction> copy_state(DpFunction* state, std::string* err) {
+  std::unique_ptr<DpFunction> copy(NewDpFunc<DpFunction>(state->params(), err));
+  if (err->empty()) {
+    std::string serialized = state->Serialize(err);
+    if (err->empty()) {
+      copy->Merge(serialized, err);
+    }
+  }
+  return copy;
+}
+
+// Common extract code for moving aggregates, whose final function is called
+// for every window frame with the same state. The result is computed on a
+// copy of the state, which leaves the state usable for the next frame. Each
+// frame is released with the full epsilon of the state, so N frames spend N
+// times epsilon. Return null if error.
+template <typename DpFunction>
+Datum moving_extract(PG_FUNCTION_ARGS, bool is_integral) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  std::string err;
+  std::unique_ptr<DpFunction> copy = copy_state(arg, &err);
+  double result = 0;
+  int64_t result_rounded = 0;
+  if (err.empty() && !keep_partition(copy.get())) {
+    PG_RETURN_NULL();
+  }
+  if (err.empty()) {
+    if (is_integral) {
+      result_rounded = copy->ResultRounded(&err);
+    } else {
+      result = copy->Result(&err);
+    }
+  }
+  copy.reset();
+  if (!err.empty()) {
+    ereport(INFO, (errmsg("%s Returning NULL.", err.c_str())));
+    PG_RETURN_NULL();
+  }
+  if (is_integral) {
+    PG_RETURN_INT64(result_rounded);
+  }
+  PG_RETURN_FLOAT8(result);
+}
+
+// Common combine code for merging the second partial state into the first.
+// Either state may be null.
+template <typename DpFunction>
+Datum combine(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(1)) {
+    if (PG_ARGISNULL(0)) {
+      PG_RETURN_NULL();
+    }
+    PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+  }
+  DpFunction* arg1 = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(1));
+  std::string err;
+  std::string serialized = arg1->Serialize(&err);
+  DpFunction* arg0 = nullptr;
+  if (PG_ARGISNULL(0)) {
+    // Copy the second state rather than returning it, so that the returned
+    // state is always owned by the aggregate.
+    if (err.empty()) {
+      arg0 = DeserializeDpFunc<DpFunction>(serialized, &err,
+                                           alloc_state<DpFunction>(fcinfo));
+    }
+    if (arg0) {
+      register_state(fcinfo, arg0);
+    }
+  } else {
+    arg0 = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+    if (err.empty()) {
+      arg0->Merge(serialized, &err);
+    }
+  }
+  if (!err.empty()) {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("%s", err.c_str())));
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+// Common serialize code for passing a partial state between workers.
+template <typename DpFunction>
+Datum serialize(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  DpFunction* arg = reinterpret_cast<DpFunction*>(PG_GETARG_POINTER(0));
+  std::string err;
+  std::string serialized = arg->Serialize(&err);
+  if (!err.empty()) {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("%s", err.c_str())));
+  }
+  const size_t size = VARHDRSZ + serialized.size();
+  bytea* result = reinterpret_cast<bytea*>(palloc(size));
+  SET_VARSIZE(result, size);
+  memcpy(VARDATA(result), serialized.data(), serialized.size());
+  PG_RETURN_BYTEA_P(result);
+}
+
+// Common deserialize code for constructing a partial state from the output of
+// serialize.
+template <typename DpFunction>
+Datum deserialize(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  bytea* arg = PG_GETARG_BYTEA_PP(0);
+  std::string err;
+  DpFunction* result = DeserializeDpFunc<DpFunction>(
+      std::string(VARDATA_ANY(arg), VARSIZE_ANY_EXHDR(arg)), &err,
+      alloc_state<DpFunction>(fcinfo));
+  if (result) {
+    register_state(fcinfo, result);
+  }
+  if (!err.empty()) {
+    ereport(ERROR,
+            (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+            errmsg("%s", err.c_str())));
+  }
+  PG_RETURN_POINTER(result);
+}
+
 
 /*
  * ANON_COUNT functions.
@@ -179,11 +607,25 @@ Datum anon_count_accum(PG_FUNCTION_ARGS) {
   DpCount* arg0;
   if (PG_ARGISNULL(0)) {
     std::string err;
-    if (PG_NARGS() > 2) {
-      float8 epsilon = PG_GETARG_FLOAT8(2);
-      arg0 = new DpCount(&err, /*default_epsilon=*/false, epsilon);
-    } else {
-      arg0 = new DpCount(&err);
+    arg0 = new_cached_state<DpCount>(fcinfo, &err);
+    if (!arg0) {
+      float8 delta = 0;
+      bool with_delta = false;
+      if (PG_NARGS() > 2) {
+        float8 epsilon = PG_GETARG_FLOAT8(2);
+        with_delta = get_selection_delta(fcinfo, 3, &epsilon, &delta);
+        arg0 = new (alloc_state<DpCount>(fcinfo))
+            DpCount(&err, /*default_epsilon=*/false, epsilon);
+        if (err.empty() && with_delta) {
+          arg0->SetPartitionSelection(epsilon, delta, &err);
+        }
+      } else {
+        arg0 = new (alloc_state<DpCount>(fcinfo)) DpCount(&err);
+      }
+      register_state(fcinfo, arg0);
+      if (err.empty()) {
+        cache_params(fcinfo, *arg0);
+      }
     }
     if (!err.empty()) {
       ereport(ERROR,
@@ -207,6 +649,35 @@ Datum anon_count_extract(PG_FUNCTION_ARGS) {
   return int_extract<DpCount>(fcinfo);
 }
 
+Datum anon_count_remove(PG_FUNCTION_ARGS) {
+  CHECK_AGG_CONTEXT(fcinfo);
+  if (PG_ARGISNULL(0)) {
+    PG_RETURN_NULL();
+  }
+  DpCount* arg0 = reinterpret_cast<DpCount*>(PG_GETARG_POINTER(0));
+  // Remove the dummy entry added for the element.
+  if (!arg0->RemoveEntry(1.0)) {
+    PG_RETURN_NULL();
+  }
+  PG_RETURN_POINTER(arg0);
+}
+
+Datum anon_count_moving_extract(PG_FUNCTION_ARGS) {
+  return moving_extract<DpCount>(fcinfo, true);
+}
+
+Datum anon_count_combine(PG_FUNCTION_ARGS) {
+  return combine<DpCount>(fcinfo);
+}
+
+Datum anon_count_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpCount>(fcinfo);
+}
+
+Datum anon_count_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpCount>(fcinfo);
+}
+
 
 /*
  * ANON_SUM functions.
@@ -229,6 +700,14 @@ Datum anon_sum_with_bounds_accum_int(PG_FUNCTION_ARGS) {
   return bounded_accum<DpSum>(fcinfo, true, true);
 }
 
+Datum anon_sum_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpSum>(fcinfo, false);
+}
+
+Datum anon_sum_with_bounds_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpSum>(fcinfo, true);
+}
+
 Datum anon_sum_extract_double(PG_FUNCTION_ARGS) {
   return double_extract<DpSum>(fcinfo);
 }
@@ -237,6 +716,34 @@ Datum anon_sum_extract_int(PG_FUNCTION_ARGS) {
   return int_extract<DpSum>(fcinfo);
 }
 
+Datum anon_sum_with_bounds_remove_double(PG_FUNCTION_ARGS) {
+  return remove_arg_entry<DpSum>(fcinfo, false);
+}
+
+Datum anon_sum_with_bounds_remove_int(PG_FUNCTION_ARGS) {
+  return remove_arg_entry<DpSum>(fcinfo, true);
+}
+
+Datum anon_sum_moving_extract_double(PG_FUNCTION_ARGS) {
+  return moving_extract<DpSum>(fcinfo, false);
+}
+
+Datum anon_sum_moving_extract_int(PG_FUNCTION_ARGS) {
+  return moving_extract<DpSum>(fcinfo, true);
+}
+
+Datum anon_sum_combine(PG_FUNCTION_ARGS) {
+  return combine<DpSum>(fcinfo);
+}
+
+Datum anon_sum_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpSum>(fcinfo);
+}
+
+Datum anon_sum_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpSum>(fcinfo);
+}
+
 
 /*
  * ANON_AVG functions.
@@ -251,10 +758,30 @@ Datum anon_avg_with_bounds_accum(PG_FUNCTION_ARGS) {
   return bounded_accum<DpMean>(fcinfo, true, false);
 }
 
+Datum anon_avg_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpMean>(fcinfo, false);
+}
+
+Datum anon_avg_with_bounds_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpMean>(fcinfo, true);
+}
+
 Datum anon_avg_extract(PG_FUNCTION_ARGS) {
   return double_extract<DpMean>(fcinfo);
 }
 
+Datum anon_avg_combine(PG_FUNCTION_ARGS) {
+  return combine<DpMean>(fcinfo);
+}
+
+Datum anon_avg_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpMean>(fcinfo);
+}
+
+Datum anon_avg_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpMean>(fcinfo);
+}
+
 
 /*
  * ANON_VAR functions.
@@ -269,10 +796,30 @@ Datum anon_var_with_bounds_accum(PG_FUNCTION_ARGS) {
   return bounded_accum<DpVariance>(fcinfo, true, false);
 }
 
+Datum anon_var_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpVariance>(fcinfo, false);
+}
+
+Datum anon_var_with_bounds_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpVariance>(fcinfo, true);
+}
+
 Datum anon_var_extract(PG_FUNCTION_ARGS) {
   return double_extract<DpVariance>(fcinfo);
 }
 
+Datum anon_var_combine(PG_FUNCTION_ARGS) {
+  return combine<DpVariance>(fcinfo);
+}
+
+Datum anon_var_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpVariance>(fcinfo);
+}
+
+Datum anon_var_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpVariance>(fcinfo);
+}
+
 
 /*
  * ANON_STDDEV functions.
@@ -287,10 +834,30 @@ Datum anon_stddev_with_bounds_accum(PG_FUNCTION_ARGS) {
   return bounded_accum<DpStandardDeviation>(fcinfo, true, false);
 }
 
+Datum anon_stddev_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpStandardDeviation>(fcinfo, false);
+}
+
+Datum anon_stddev_with_bounds_accum_array(PG_FUNCTION_ARGS) {
+  return bounded_array_accum<DpStandardDeviation>(fcinfo, true);
+}
+
 Datum anon_stddev_extract(PG_FUNCTION_ARGS) {
   return double_extract<DpStandardDeviation>(fcinfo);
 }
 
+Datum anon_stddev_combine(PG_FUNCTION_ARGS) {
+  return combine<DpStandardDeviation>(fcinfo);
+}
+
+Datum anon_stddev_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpStandardDeviation>(fcinfo);
+}
+
+Datum anon_stddev_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpStandardDeviation>(fcinfo);
+}
+
 
 
 /*
@@ -303,16 +870,30 @@ Datum ntile_accum(PG_FUNCTION_ARGS, bool is_integral) {
 
   // Construct algorithm if needed.
   if (PG_ARGISNULL(0)) {
-    float8 percentile = PG_GETARG_FLOAT8(2);
-    float8 lower = PG_GETARG_FLOAT8(3);
-    float8 upper = PG_GETARG_FLOAT8(4);
     std::string err;
-    if (PG_NARGS() > 5) {
-      float8 epsilon = PG_GETARG_FLOAT8(5);
-      arg0 = new DpNtile(&err, percentile, lower, upper,
-                         /*default_epsilon=*/false, epsilon);
-    } else {
-      arg0 = new DpNtile(&err, percentile, lower, upper);
+    arg0 = new_cached_state<DpNtile>(fcinfo, &err);
+    if (!arg0) {
+      float8 percentile = PG_GETARG_FLOAT8(2);
+      float8 lower = PG_GETARG_FLOAT8(3);
+      float8 upper = PG_GETARG_FLOAT8(4);
+      if (PG_NARGS() > 5) {
+        float8 epsilon = PG_GETARG_FLOAT8(5), delta = 0;
+        bool with_delta = get_selection_delta(fcinfo, 6, &epsilon, &delta);
+        arg0 = new (alloc_state<DpNtile>(fcinfo))
+            DpNtile(&err, percentile, lower, upper, /*default_epsilon=*/false,
+                    epsilon, ntile_log_histogram_sub_bins);
+        if (err.empty() && with_delta) {
+          arg0->SetPartitionSelection(epsilon, delta, &err);
+        }
+      } else {
+        arg0 = new (alloc_state<DpNtile>(fcinfo))
+            DpNtile(&err, percentile, lower, upper, /*default_epsilon=*/true,
+                    /*epsilon=*/0, ntile_log_histogram_sub_bins);
+      }
+      register_state(fcinfo, arg0);
+      if (err.empty()) {
+        cache_params(fcinfo, *arg0);
+      }
     }
     if (!err.empty()) {
       ereport(ERROR,
@@ -342,3 +923,15 @@ Datum anon_ntile_extract_double(PG_FUNCTION_ARGS) {
 Datum anon_ntile_extract_int(PG_FUNCTION_ARGS) {
   return int_extract<DpNtile>(fcinfo);
 }
+
+Datum anon_ntile_combine(PG_FUNCTION_ARGS) {
+  return combine<DpNtile>(fcinfo);
+}
+
+Datum anon_ntile_serialize(PG_FUNCTION_ARGS) {
+  return serialize<DpNtile>(fcinfo);
+}
+
+Datum anon_ntile_deserialize(PG_FUNCTION_ARGS) {
+  return deserialize<DpNtile>(fcinfo);
+}
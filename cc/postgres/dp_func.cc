@@ -16,6 +16,14 @@
 
 #include "dp_func.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "absl/types/span.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/bounded-mean.h"
 #include "algorithms/bounded-standard-deviation.h"
@@ -23,7 +31,9 @@
 #include "algorithms/bounded-variance.h"
 #include "algorithms/count.h"
 #include "algorithms/order-statistics.h"
+#include "algorithms/partition-selection.h"
 #include "algorithms/util.h"
+#include "proto/summary.pb.h"
 
 using differential_privacy::Algorithm;
 using differential_privacy::BoundedMean;
@@ -32,13 +42,98 @@ using differential_privacy::BoundedSum;
 using differential_privacy::BoundedVariance;
 using differential_privacy::Count;
 using differential_privacy::DefaultEpsilon;
-using differential_privacy::GetValue;
+using differential_privacy::PartitionSelectionStrategy;
+using differential_privacy::PreaggPartitionSelection;
+using differential_privacy::base::StatusOr;
+using differential_privacy::Summary;
 using differential_privacy::continuous::Percentile;
 
+// Return the parameters of a function, with the default epsilon resolved.
+DpFunc::Params FunctionParams(bool default_epsilon, double epsilon,
+                              bool auto_bounds = true, double lower = 0,
+                              double upper = 0, double percentile = 0) {
+  DpFunc::Params params;
+  params.epsilon = default_epsilon ? DefaultEpsilon() : epsilon;
+  params.auto_bounds = auto_bounds;
+  params.lower = lower;
+  params.upper = upper;
+  params.percentile = percentile;
+  return params;
+}
+
+// The serialized partial state of a function is its parameters and number of
+// entries, followed by the serialized Summary of the algorithm. Partial states
+// are only passed between workers of the same server, so the values are
+// copied in their native representation.
+constexpr size_t kSerializedHeaderSize =
+    6 * sizeof(double) + sizeof(int) + 1 + sizeof(int64_t);
+
+template <typename T>
+void AppendValue(T value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+void ReadValue(const char** data, T* value) {
+  std::memcpy(value, *data, sizeof(*value));
+  *data += sizeof(*value);
+}
+
+void AppendHeader(const DpFunc::Params& params, int64_t num_entries,
+                  std::string* out) {
+  for (double value : {params.epsilon, params.lower, params.upper,
+                       params.percentile, params.selection_epsilon,
+                       params.selection_delta}) {
+    AppendValue(value, out);
+  }
+  AppendValue(params.log_histogram_sub_bins, out);
+  out->push_back(params.auto_bounds ? 1 : 0);
+  AppendValue(num_entries, out);
+}
+
+// Parse the parameters and number of entries at the start of serialized.
+// Return false if serialized is too short to hold them.
+bool ParseHeader(const std::string& serialized, DpFunc::Params* params,
+                 int64_t* num_entries) {
+  if (serialized.size() < kSerializedHeaderSize) {
+    return false;
+  }
+  const char* data = serialized.data();
+  for (double* value : {&params->epsilon, &params->lower, &params->upper,
+                        &params->percentile, &params->selection_epsilon,
+                        &params->selection_delta}) {
+    ReadValue(&data, value);
+  }
+  ReadValue(&data, &params->log_histogram_sub_bins);
+  params->auto_bounds = *data++ != 0;
+  ReadValue(&data, num_entries);
+  return true;
+}
+
+bool operator==(const DpFunc::Params& a, const DpFunc::Params& b) {
+  return a.epsilon == b.epsilon && a.auto_bounds == b.auto_bounds &&
+         a.lower == b.lower && a.upper == b.upper &&
+         a.percentile == b.percentile &&
+         a.log_histogram_sub_bins == b.log_histogram_sub_bins &&
+         a.selection_epsilon == b.selection_epsilon &&
+         a.selection_delta == b.selection_delta;
+}
+
+// Set options that only some algorithms have on their builder.
+template <typename Builder>
+void SetAlgorithmOptions(Builder* builder, bool auto_bounds) {}
+
+// Sums with manual bounds are exact, so that entries can be removed from them.
+void SetAlgorithmOptions(BoundedSum<double, nullptr>::Builder* builder,
+                         bool auto_bounds) {
+  builder->SetExactSum(!auto_bounds);
+}
+
 // Construct and return a bounded algorithm. Populate error if unsuccessful.
 template <typename Alg>
 Alg* BoundedAlgorithm(std::string* err, bool default_epsilon, double epsilon,
-                      bool auto_bounds, double lower, double upper) {
+                      bool auto_bounds, double lower, double upper,
+                      bool lazy_mechanism) {
   if (default_epsilon) {
     epsilon = DefaultEpsilon();
   }
@@ -46,7 +141,9 @@ Alg* BoundedAlgorithm(std::string* err, bool default_epsilon, double epsilon,
   if (!auto_bounds) {
     builder.SetLower(lower).SetUpper(upper);
   }
-  auto build_statusor = builder.SetEpsilon(epsilon).Build();
+  SetAlgorithmOptions(&builder, auto_bounds);
+  auto build_statusor =
+      builder.SetEpsilon(epsilon).SetLazyMechanism(lazy_mechanism).Build();
   if (build_statusor.ok()) {
     return build_statusor.ValueOrDie().release();
   }
@@ -62,40 +159,244 @@ void DeleteAlgorithm(Alg* alg) {
   }
 }
 
-// Add an entry to the algorithm. Return true if the algorithm exists.
-bool AlgorithmAddEntry(Algorithm<double>* alg, double entry) {
+// Add an entry to the algorithm and count it. Return true if the algorithm
+// exists.
+bool AlgorithmAddEntry(Algorithm<double>* alg, double entry,
+                       int64_t* num_entries) {
   if (alg) {
     alg->AddEntry(entry);
+    ++*num_entries;
     return true;
   }
   return false;
 }
 
-// Return the result of return_type from the algorithm, populating error if
-// unsuccessful.
-template <typename return_type>
+// Return the result of the algorithm, populating error if unsuccessful. The
+// result is read without constructing an Output proto.
 double AlgorithmResult(Algorithm<double>* alg, std::string* err) {
   double default_return = 0.0;
   if (!alg) {
     *err = "Underlying algorithm was never constructed.";
     return default_return;
   }
-  auto result_statusor = alg->PartialResult();
+  auto result_statusor = alg->PartialResultValue();
   if (result_statusor.ok()) {
-    return static_cast<double>(
-        GetValue<return_type>(result_statusor.ValueOrDie()));
+    return result_statusor.ValueOrDie().value;
   } else {
     *err = std::string(result_statusor.status().message());
   }
   return default_return;
 }
 
-// DP count.
-DpCount::DpCount(std::string* err, bool default_epsilon, double epsilon) {
-  if (default_epsilon) {
-    epsilon = DefaultEpsilon();
+std::string DpFunc::Serialize(std::string* err) {
+  Algorithm<double>* alg = algorithm();
+  if (!alg) {
+    *err = "Underlying algorithm was never constructed.";
+    return "";
+  }
+  std::string serialized;
+  AppendHeader(params_, num_entries_, &serialized);
+  serialized.append(alg->Serialize().SerializeAsString());
+  return serialized;
+}
+
+bool DpFunc::AddEntries(const double* entries, int64_t num_entries) {
+  Algorithm<double>* alg = algorithm();
+  if (!alg) {
+    return false;
+  }
+  alg->AddEntries(absl::MakeConstSpan(entries, num_entries));
+  num_entries_ += num_entries;
+  return true;
+}
+
+bool DpFunc::AddEntries(const int64_t* entries, int64_t num_entries) {
+  std::vector<double> converted(entries, entries + num_entries);
+  return AddEntries(converted.data(), num_entries);
+}
+
+bool DpFunc::RemoveEntry(double entry) {
+  Algorithm<double>* alg = algorithm();
+  if (!alg || !alg->RemoveEntryWithCount(entry, 1).ok()) {
+    return false;
+  }
+  --num_entries_;
+  return true;
+}
+
+bool DpFunc::Merge(const std::string& serialized, std::string* err) {
+  Algorithm<double>* alg = algorithm();
+  if (!alg) {
+    *err = "Underlying algorithm was never constructed.";
+    return false;
+  }
+  Params params;
+  int64_t num_entries;
+  Summary summary;
+  if (!ParseHeader(serialized, &params, &num_entries) ||
+      !summary.ParseFromArray(serialized.data() + kSerializedHeaderSize,
+                              serialized.size() - kSerializedHeaderSize)) {
+    *err = "Serialized partial state could not be parsed.";
+    return false;
+  }
+  if (!(params == params_)) {
+    *err = "Cannot merge partial states with different parameters.";
+    return false;
   }
-  auto count_statusor = Count<double>::Builder().SetEpsilon(epsilon).Build();
+  auto status = alg->Merge(summary);
+  if (!status.ok()) {
+    *err = std::string(status.message());
+    return false;
+  }
+  num_entries_ += num_entries;
+  return true;
+}
+
+// Builds the partition selection strategy of params, which must have a
+// positive selection delta.
+StatusOr<std::unique_ptr<PartitionSelectionStrategy>> BuildPartitionSelection(
+    const DpFunc::Params& params) {
+  PreaggPartitionSelection::Builder builder;
+  builder.SetEpsilon(params.selection_epsilon)
+      .SetDelta(params.selection_delta)
+      .SetMaxPartitionsContributed(1);
+  return builder.Build();
+}
+
+bool DpFunc::SetPartitionSelection(double epsilon, double delta,
+                                   std::string* err) {
+  if (!(delta > 0)) {
+    *err = "Partition selection delta must be positive.";
+    return false;
+  }
+  Params params = params_;
+  params.selection_epsilon = epsilon;
+  params.selection_delta = delta;
+  auto strategy = BuildPartitionSelection(params);
+  if (!strategy.ok()) {
+    *err = std::string(strategy.status().message());
+    return false;
+  }
+  params_ = params;
+  return true;
+}
+
+bool DpFunc::KeepPartition(std::string* err) {
+  if (params_.selection_delta <= 0) {
+    return true;
+  }
+  auto strategy = BuildPartitionSelection(params_);
+  if (!strategy.ok()) {
+    *err = std::string(strategy.status().message());
+    return false;
+  }
+  return strategy.ValueOrDie()->ShouldKeep(
+      static_cast<int>(std::min<int64_t>(num_entries_, INT_MAX)));
+}
+
+// Construct a DpFunction in memory, or on the heap if memory is null.
+template <typename DpFunction, typename... Args>
+DpFunction* NewFunction(void* memory, Args... args) {
+  if (memory) {
+    return new (memory) DpFunction(args...);
+  }
+  return new DpFunction(args...);
+}
+
+// Constructs a DpFunction with params, apart from partition selection.
+template <typename DpFunction>
+DpFunction* ConstructDpFunc(const DpFunc::Params& params, std::string* err,
+                            void* memory) {
+  return NewFunction<DpFunction>(memory, err, /*default_epsilon=*/false,
+                                 params.epsilon, params.auto_bounds,
+                                 params.lower, params.upper,
+                                 /*lazy_mechanism=*/true);
+}
+
+template <>
+DpCount* ConstructDpFunc<DpCount>(const DpFunc::Params& params,
+                                  std::string* err, void* memory) {
+  return NewFunction<DpCount>(memory, err, /*default_epsilon=*/false,
+                              params.epsilon, /*lazy_mechanism=*/true);
+}
+
+// Percentile does not support lazy mechanisms, so this is as expensive as the
+// constructor.
+template <>
+DpNtile* ConstructDpFunc<DpNtile>(const DpFunc::Params& params,
+                                  std::string* err, void* memory) {
+  return NewFunction<DpNtile>(memory, err, params.percentile, params.lower,
+                              params.upper, /*default_epsilon=*/false,
+                              params.epsilon, params.log_histogram_sub_bins);
+}
+
+template <typename DpFunction>
+DpFunction* NewDpFunc(const DpFunc::Params& params, std::string* err,
+                      void* memory) {
+  DpFunction* func = ConstructDpFunc<DpFunction>(params, err, memory);
+  if (err->empty() && params.selection_delta > 0) {
+    func->SetPartitionSelection(params.selection_epsilon,
+                                params.selection_delta, err);
+  }
+  return func;
+}
+
+template DpCount* NewDpFunc<DpCount>(const DpFunc::Params&, std::string*,
+                                     void*);
+template DpSum* NewDpFunc<DpSum>(const DpFunc::Params&, std::string*, void*);
+template DpMean* NewDpFunc<DpMean>(const DpFunc::Params&, std::string*, void*);
+template DpVariance* NewDpFunc<DpVariance>(const DpFunc::Params&, std::string*,
+                                           void*);
+template DpStandardDeviation* NewDpFunc<DpStandardDeviation>(
+    const DpFunc::Params&, std::string*, void*);
+template DpNtile* NewDpFunc<DpNtile>(const DpFunc::Params&, std::string*,
+                                     void*);
+
+template <typename DpFunction>
+DpFunction* DeserializeDpFunc(const std::string& serialized, std::string* err,
+                              void* memory) {
+  DpFunc::Params params;
+  int64_t num_entries;
+  if (!ParseHeader(serialized, &params, &num_entries)) {
+    *err = "Serialized partial state could not be parsed.";
+    return nullptr;
+  }
+  DpFunction* func = NewDpFunc<DpFunction>(params, err, memory);
+  if (err->empty()) {
+    func->Merge(serialized, err);
+  }
+  if (!err->empty()) {
+    if (memory) {
+      func->~DpFunction();
+    } else {
+      delete func;
+    }
+    return nullptr;
+  }
+  return func;
+}
+
+template DpCount* DeserializeDpFunc<DpCount>(const std::string&, std::string*,
+                                             void*);
+template DpSum* DeserializeDpFunc<DpSum>(const std::string&, std::string*,
+                                         void*);
+template DpMean* DeserializeDpFunc<DpMean>(const std::string&, std::string*,
+                                           void*);
+template DpVariance* DeserializeDpFunc<DpVariance>(const std::string&,
+                                                   std::string*, void*);
+template DpStandardDeviation* DeserializeDpFunc<DpStandardDeviation>(
+    const std::string&, std::string*, void*);
+template DpNtile* DeserializeDpFunc<DpNtile>(const std::string&, std::string*,
+                                             void*);
+
+// DP count.
+DpCount::DpCount(std::string* err, bool default_epsilon, double epsilon,
+                 bool lazy_mechanism) {
+  params_ = FunctionParams(default_epsilon, epsilon);
+  auto count_statusor = Count<double>::Builder()
+                            .SetEpsilon(params_.epsilon)
+                            .SetLazyMechanism(lazy_mechanism)
+                            .Build();
   if (count_statusor.ok()) {
     count_ = count_statusor.ValueOrDie().release();
   } else {
@@ -104,78 +405,107 @@ DpCount::DpCount(std::string* err, bool default_epsilon, double epsilon) {
 }
 DpCount::~DpCount() { DeleteAlgorithm<Count<double>>(count_); }
 bool DpCount::AddEntry(double entry) {
-  return AlgorithmAddEntry(count_, entry);
+  return AlgorithmAddEntry(count_, entry, &num_entries_);
 }
 double DpCount::Result(std::string* err) {
-  return AlgorithmResult<int64_t>(count_, err);
+  return AlgorithmResult(count_, err);
 }
+Algorithm<double>* DpCount::algorithm() { return count_; }
 
 // DP sum.
 DpSum::DpSum(std::string* err, bool default_epsilon, double epsilon,
-             bool auto_bounds, double lower, double upper) {
+             bool auto_bounds, double lower, double upper,
+             bool lazy_mechanism) {
+  params_ = FunctionParams(default_epsilon, epsilon, auto_bounds, lower,
+                           upper);
   sum_ = BoundedAlgorithm<BoundedSum<double, nullptr>>(
-      err, default_epsilon, epsilon, auto_bounds, lower, upper);
+      err, default_epsilon, epsilon, auto_bounds, lower, upper,
+      lazy_mechanism);
 }
 DpSum::~DpSum() { DeleteAlgorithm<BoundedSum<double, nullptr>>(sum_); }
-bool DpSum::AddEntry(double entry) { return AlgorithmAddEntry(sum_, entry); }
+bool DpSum::AddEntry(double entry) {
+  return AlgorithmAddEntry(sum_, entry, &num_entries_);
+}
 double DpSum::Result(std::string* err) {
-  return AlgorithmResult<double>(sum_, err);
+  return AlgorithmResult(sum_, err);
 }
+Algorithm<double>* DpSum::algorithm() { return sum_; }
 
 // DP mean.
 DpMean::DpMean(std::string* err, bool default_epsilon, double epsilon,
-               bool auto_bounds, double lower, double upper) {
+               bool auto_bounds, double lower, double upper,
+               bool lazy_mechanism) {
+  params_ = FunctionParams(default_epsilon, epsilon, auto_bounds, lower,
+                           upper);
   mean_ = BoundedAlgorithm<BoundedMean<double, nullptr>>(
-      err, default_epsilon, epsilon, auto_bounds, lower, upper);
+      err, default_epsilon, epsilon, auto_bounds, lower, upper,
+      lazy_mechanism);
 }
 DpMean::~DpMean() { DeleteAlgorithm<BoundedMean<double, nullptr>>(mean_); }
-bool DpMean::AddEntry(double entry) { return AlgorithmAddEntry(mean_, entry); }
+bool DpMean::AddEntry(double entry) {
+  return AlgorithmAddEntry(mean_, entry, &num_entries_);
+}
 double DpMean::Result(std::string* err) {
-  return AlgorithmResult<double>(mean_, err);
+  return AlgorithmResult(mean_, err);
 }
+Algorithm<double>* DpMean::algorithm() { return mean_; }
 
 // DP variance.
 DpVariance::DpVariance(std::string* err, bool default_epsilon, double epsilon,
-                       bool auto_bounds, double lower, double upper) {
+                       bool auto_bounds, double lower, double upper,
+                       bool lazy_mechanism) {
+  params_ = FunctionParams(default_epsilon, epsilon, auto_bounds, lower,
+                           upper);
   var_ = BoundedAlgorithm<BoundedVariance<double, nullptr>>(
-      err, default_epsilon, epsilon, auto_bounds, lower, upper);
+      err, default_epsilon, epsilon, auto_bounds, lower, upper,
+      lazy_mechanism);
 }
 DpVariance::~DpVariance() {
   DeleteAlgorithm<BoundedVariance<double, nullptr>>(var_);
 }
 bool DpVariance::AddEntry(double entry) {
-  return AlgorithmAddEntry(var_, entry);
+  return AlgorithmAddEntry(var_, entry, &num_entries_);
 }
 double DpVariance::Result(std::string* err) {
-  return AlgorithmResult<double>(var_, err);
+  return AlgorithmResult(var_, err);
 }
+Algorithm<double>* DpVariance::algorithm() { return var_; }
 
 // DP standard deviation.
 DpStandardDeviation::DpStandardDeviation(std::string* err, bool default_epsilon,
                                          double epsilon, bool auto_bounds,
-                                         double lower, double upper) {
+                                         double lower, double upper,
+                                         bool lazy_mechanism) {
+  params_ = FunctionParams(default_epsilon, epsilon, auto_bounds, lower,
+                           upper);
   sd_ = BoundedAlgorithm<BoundedStandardDeviation<double, nullptr>>(
-      err, default_epsilon, epsilon, auto_bounds, lower, upper);
+      err, default_epsilon, epsilon, auto_bounds, lower, upper,
+      lazy_mechanism);
 }
 DpStandardDeviation::~DpStandardDeviation() {
   DeleteAlgorithm<BoundedStandardDeviation<double, nullptr>>(sd_);
 }
 bool DpStandardDeviation::AddEntry(double entry) {
-  return AlgorithmAddEntry(sd_, entry);
+  return AlgorithmAddEntry(sd_, entry, &num_entries_);
 }
 double DpStandardDeviation::Result(std::string* err) {
-  return AlgorithmResult<double>(sd_, err);
+  return AlgorithmResult(sd_, err);
 }
+Algorithm<double>* DpStandardDeviation::algorithm() { return sd_; }
 
 // DP Ntile.
 DpNtile::DpNtile(std::string* err, double percentile, double lower,
-                 double upper, bool default_epsilon, double epsilon) {
-  if (default_epsilon) {
-    epsilon = DefaultEpsilon();
+                 double upper, bool default_epsilon, double epsilon,
+                 int log_histogram_sub_bins) {
+  params_ = FunctionParams(default_epsilon, epsilon, /*auto_bounds=*/false,
+                           lower, upper, percentile);
+  params_.log_histogram_sub_bins = log_histogram_sub_bins;
+  Percentile<double>::Builder builder;
+  if (log_histogram_sub_bins != 0) {
+    builder.SetLogHistogram(log_histogram_sub_bins);
   }
-  auto build_statusor = Percentile<double>::Builder()
-                            .SetPercentile(percentile)
-                            .SetEpsilon(epsilon)
+  auto build_statusor = builder.SetPercentile(percentile)
+                            .SetEpsilon(params_.epsilon)
                             .SetLower(lower)
                             .SetUpper(upper)
                             .Build();
@@ -186,7 +516,10 @@ DpNtile::DpNtile(std::string* err, double percentile, double lower,
   }
 }
 DpNtile::~DpNtile() { DeleteAlgorithm<Percentile<double>>(perc_); }
-bool DpNtile::AddEntry(double entry) { return AlgorithmAddEntry(perc_, entry); }
+bool DpNtile::AddEntry(double entry) {
+  return AlgorithmAddEntry(perc_, entry, &num_entries_);
+}
 double DpNtile::Result(std::string* err) {
-  return AlgorithmResult<double>(perc_, err);
+  return AlgorithmResult(perc_, err);
 }
+Algorithm<double>* DpNtile::algorithm() { return perc_; }
@@ -27,6 +27,9 @@
 // include these directly into anon_func.cc.
 namespace differential_privacy {
 
+template <typename T>
+class Algorithm;
+
 template <typename T>
 class Count;
 
@@ -60,6 +63,22 @@ class DpFunc {
   virtual bool AddEntry(double entry) = 0;
   bool AddEntry(int64_t entry) { return AddEntry(static_cast<double>(entry)); }
 
+  // Adds num_entries entries in one call to the batch ingestion of the
+  // underlying algorithm, e.g., the elements of an array argument, instead of
+  // one AddEntry call per entry. Each counts as one entry for partition
+  // selection. Returns true if adding the entries is successful.
+  bool AddEntries(const double* entries, int64_t num_entries);
+  bool AddEntries(const int64_t* entries, int64_t num_entries);
+
+  // Removes an entry that was added before, for the inverse transition of
+  // moving aggregates. Returns false if the underlying algorithm cannot remove
+  // entries exactly, which is only supported by counts and by sums with
+  // manual bounds.
+  bool RemoveEntry(double entry);
+  bool RemoveEntry(int64_t entry) {
+    return RemoveEntry(static_cast<double>(entry));
+  }
+
   // Result can only be called once per function. Iff grabbing the result fails,
   // the error std::string is populated and we return 0.
   virtual double Result(std::string* err) = 0;
@@ -67,52 +86,134 @@ class DpFunc {
   // Same as result, but the result is rounded to be an integer. Only Result or
   // ResultRounded may be called per function.
   int64_t ResultRounded(std::string* err) { return std::round(Result(err)); }
+
+  // Serializes the parameters and the partial state of the function, so that
+  // postgres can pass partial aggregates between parallel workers. Iff
+  // serializing fails, the error std::string is populated.
+  std::string Serialize(std::string* err);
+
+  // Merges a partial state returned by Serialize() of a function of the same
+  // type and parameters. Returns false and populates the error std::string if
+  // merging fails.
+  bool Merge(const std::string& serialized, std::string* err);
+
+  // Parameters the function was constructed with. They are serialized with
+  // the partial state, so that a function can be reconstructed from it.
+  struct Params {
+    double epsilon = 0;
+    bool auto_bounds = true;
+    double lower = 0;
+    double upper = 0;
+    double percentile = 0;
+    int log_histogram_sub_bins = 0;
+    // Partition selection is only applied if selection_delta is positive.
+    double selection_epsilon = 0;
+    double selection_delta = 0;
+  };
+
+  const Params& params() const { return params_; }
+
+  // Enables partition selection, which suppresses the result of a group with
+  // too few entries, using the given epsilon and delta. Every entry is
+  // assumed to be contributed by a different user. Returns false and
+  // populates the error std::string if the parameters are invalid.
+  bool SetPartitionSelection(double epsilon, double delta, std::string* err);
+
+  // Returns whether the result of the group may be released. This is always
+  // true without partition selection. Otherwise it consumes the randomness of
+  // the selection, so it may only be called once per function, before the
+  // result. Iff it fails, the error std::string is populated and we return
+  // false.
+  bool KeepPartition(std::string* err);
+
+ protected:
+  Params params_;
+  // Number of entries added, for partition selection.
+  int64_t num_entries_ = 0;
+
+ private:
+  // Returns the underlying algorithm, or nullptr if it was never constructed.
+  virtual differential_privacy::Algorithm<double>* algorithm() = 0;
 };
 
+// Constructs a function of type DpFunction with the params() of another
+// function of the same type. The parameters were validated when the other
+// function was constructed, so the noise mechanisms are only built when the
+// result is requested, which makes this cheaper than the constructor. Iff it
+// fails, the error std::string is populated. If memory is not null, the
+// function is constructed in it, and memory must hold sizeof(DpFunction)
+// bytes. Otherwise it is allocated with new.
+template <typename DpFunction>
+DpFunction* NewDpFunc(const DpFunc::Params& params, std::string* err,
+                      void* memory = nullptr);
+
+// Constructs a function of type DpFunction from a string returned by
+// DpFunc::Serialize() of a function of the same type. Iff it fails, the error
+// std::string is populated and we return nullptr. If memory is not null, the
+// function is constructed in it, and memory must hold sizeof(DpFunction)
+// bytes. Otherwise it is allocated with new.
+template <typename DpFunction>
+DpFunction* DeserializeDpFunc(const std::string& serialized, std::string* err,
+                              void* memory = nullptr);
+
 class DpCount : public DpFunc {
  public:
-  DpCount(std::string* err, bool default_epsilon = true, double epsilon = 0);
+  // With lazy_mechanism, the noise mechanisms are only built when the result
+  // is requested, and invalid mechanism parameters are only reported then.
+  DpCount(std::string* err, bool default_epsilon = true, double epsilon = 0,
+          bool lazy_mechanism = false);
   ~DpCount() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::Count<double>* count_ = nullptr;
 };
 
 class DpSum : public DpFunc {
  public:
   DpSum(std::string* err, bool default_epsilon = true, double epsilon = 0,
-        bool auto_bounds = true, double lower = 0, double upper = 0);
+        bool auto_bounds = true, double lower = 0, double upper = 0,
+        bool lazy_mechanism = false);
   ~DpSum() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::BoundedSum<double, nullptr>* sum_ = nullptr;
 };
 
 class DpMean : public DpFunc {
  public:
   DpMean(std::string* err, bool default_epsilon = true, double epsilon = 0,
-         bool auto_bounds = true, double lower = 0, double upper = 0);
+         bool auto_bounds = true, double lower = 0, double upper = 0,
+         bool lazy_mechanism = false);
   ~DpMean() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::BoundedMean<double, nullptr>* mean_ = nullptr;
 };
 
 class DpVariance : public DpFunc {
  public:
   DpVariance(std::string* err, bool default_epsilon = true, double epsilon = 0,
-             bool auto_bounds = true, double lower = 0, double upper = 0);
+             bool auto_bounds = true, double lower = 0, double upper = 0,
+             bool lazy_mechanism = false);
   ~DpVariance() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::BoundedVariance<double, nullptr>* var_ = nullptr;
 };
 
@@ -120,12 +221,15 @@ class DpStandardDeviation : public DpFunc {
  public:
   DpStandardDeviation(std::string* err, bool default_epsilon = true,
                       double epsilon = 0, bool auto_bounds = true,
-                      double lower = 0, double upper = 0);
+                      double lower = 0, double upper = 0,
+                      bool lazy_mechanism = false);
   ~DpStandardDeviation() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::BoundedStandardDeviation<double, nullptr>* sd_ =
       nullptr;
 };
@@ -133,14 +237,19 @@ class DpStandardDeviation : public DpFunc {
 class DpNtile : public DpFunc {
  public:
   // For the ntile function, require bounds because algorithm performs very
-  // poorly without them.
+  // poorly without them. If log_histogram_sub_bins is positive, the inputs are
+  // counted in a log histogram with log_histogram_sub_bins sub-bins per bin,
+  // which bounds the memory used, instead of being stored.
   DpNtile(std::string* err, double percentile, double lower, double upper,
-          bool default_epsilon = true, double epsilon = 0);
+          bool default_epsilon = true, double epsilon = 0,
+          int log_histogram_sub_bins = 0);
   ~DpNtile() override;
   bool AddEntry(double entry) override;
   double Result(std::string* err) override;
 
  private:
+  differential_privacy::Algorithm<double>* algorithm() override;
+
   differential_privacy::continuous::Percentile<double>* perc_ = nullptr;
 };
 
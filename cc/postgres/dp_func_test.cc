@@ -65,6 +65,155 @@ TYPED_TEST(BoundedDpFuncTest, BasicTest) {
   EXPECT_TRUE(err.empty());
 }
 
+TEST(DpCount, SerializeAndMerge) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  EXPECT_TRUE(func.AddEntry(1));
+  std::string serialized = func.Serialize(&err);
+  EXPECT_TRUE(err.empty());
+
+  DpCount* deserialized = DeserializeDpFunc<DpCount>(serialized, &err);
+  ASSERT_NE(deserialized, nullptr);
+  EXPECT_TRUE(err.empty());
+  EXPECT_TRUE(deserialized->Merge(func.Serialize(&err), &err));
+  EXPECT_TRUE(err.empty());
+  static_cast<void>(deserialized->Result(&err));
+  EXPECT_TRUE(err.empty());
+  delete deserialized;
+}
+
+TEST(DpCount, MergeDifferentParameters) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  auto other = DpCount(&err, false, 2);
+  EXPECT_FALSE(func.Merge(other.Serialize(&err), &err));
+  EXPECT_EQ(err, "Cannot merge partial states with different parameters.");
+}
+
+TEST(DpCount, DeserializeIntoMemory) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  EXPECT_TRUE(func.AddEntry(1));
+  alignas(DpCount) char memory[sizeof(DpCount)];
+  DpCount* deserialized =
+      DeserializeDpFunc<DpCount>(func.Serialize(&err), &err, memory);
+  ASSERT_EQ(deserialized, reinterpret_cast<DpCount*>(memory));
+  EXPECT_TRUE(err.empty());
+  static_cast<void>(deserialized->Result(&err));
+  EXPECT_TRUE(err.empty());
+  deserialized->~DpCount();
+}
+
+TEST(DpCount, DeserializeInvalid) {
+  std::string err;
+  EXPECT_EQ(DeserializeDpFunc<DpCount>("abc", &err), nullptr);
+  EXPECT_EQ(err, "Serialized partial state could not be parsed.");
+}
+
+TYPED_TEST(BoundedDpFuncTest, SerializeAndMerge) {
+  for (bool auto_bounds : {false, true}) {
+    std::string err;
+    auto func = TypeParam(&err, true, 0, auto_bounds, 0, 5);
+    EXPECT_TRUE(func.AddEntry(1));
+    std::string serialized = func.Serialize(&err);
+    EXPECT_TRUE(err.empty());
+
+    TypeParam* deserialized = DeserializeDpFunc<TypeParam>(serialized, &err);
+    ASSERT_NE(deserialized, nullptr);
+    EXPECT_TRUE(err.empty());
+    EXPECT_TRUE(deserialized->Merge(serialized, &err));
+    EXPECT_TRUE(err.empty());
+    delete deserialized;
+  }
+}
+
+TYPED_TEST(BoundedDpFuncTest, NewFromParams) {
+  for (bool auto_bounds : {false, true}) {
+    std::string err;
+    auto func = TypeParam(&err, false, 1, auto_bounds, 0, 5);
+    TypeParam* copy = NewDpFunc<TypeParam>(func.params(), &err);
+    ASSERT_NE(copy, nullptr);
+    EXPECT_TRUE(err.empty());
+    EXPECT_EQ(copy->params().epsilon, 1);
+    EXPECT_EQ(copy->params().auto_bounds, auto_bounds);
+    EXPECT_TRUE(copy->AddEntry(1));
+    EXPECT_TRUE(func.Merge(copy->Serialize(&err), &err));
+    EXPECT_TRUE(err.empty());
+    delete copy;
+  }
+}
+
+TEST(DpCount, NewFromParams) {
+  std::string err;
+  auto func = DpCount(&err, false, 2);
+  DpCount* copy = NewDpFunc<DpCount>(func.params(), &err);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_TRUE(copy->AddEntry(1));
+  static_cast<void>(copy->Result(&err));
+  EXPECT_TRUE(err.empty());
+  delete copy;
+}
+
+TEST(DpCount, RemoveEntry) {
+  std::string err;
+  auto func = DpCount(&err, true, 0);
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_TRUE(func.RemoveEntry(1.0));
+  EXPECT_FALSE(func.RemoveEntry(1.0));
+}
+
+TEST(DpSum, RemoveEntry) {
+  std::string err;
+  auto with_bounds = DpSum(&err, true, 0, false, 0, 5);
+  EXPECT_TRUE(with_bounds.AddEntry(0.1));
+  EXPECT_TRUE(with_bounds.AddEntry(3.0));
+  EXPECT_TRUE(with_bounds.RemoveEntry(0.1));
+  auto auto_bounds = DpSum(&err, true, 0, true);
+  EXPECT_TRUE(auto_bounds.AddEntry(1));
+  EXPECT_FALSE(auto_bounds.RemoveEntry(1.0));
+}
+
+TEST(DpMean, RemoveEntryUnsupported) {
+  std::string err;
+  auto func = DpMean(&err, true, 0, false, 0, 5);
+  EXPECT_TRUE(func.AddEntry(1));
+  EXPECT_FALSE(func.RemoveEntry(1.0));
+}
+
+TYPED_TEST(BoundedDpFuncTest, AddEntriesMatchesAddEntry) {
+  std::string err;
+  auto one_by_one = TypeParam(&err, false, 1, false, 0, 5);
+  auto batched = TypeParam(&err, false, 1, false, 0, 5);
+  ASSERT_TRUE(err.empty());
+  const double entries[] = {1, 2.5, -1, 7, 3};
+  for (double entry : entries) {
+    EXPECT_TRUE(one_by_one.AddEntry(entry));
+  }
+  EXPECT_TRUE(batched.AddEntries(entries, 3));
+  EXPECT_TRUE(batched.AddEntries(entries + 3, 2));
+  EXPECT_EQ(batched.Serialize(&err), one_by_one.Serialize(&err));
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpSum, AddIntegralEntries) {
+  std::string err;
+  auto one_by_one = DpSum(&err, false, 1, false, 0, 5);
+  auto batched = DpSum(&err, false, 1, false, 0, 5);
+  const int64_t entries[] = {1, 2, 8};
+  for (int64_t entry : entries) {
+    EXPECT_TRUE(one_by_one.AddEntry(entry));
+  }
+  EXPECT_TRUE(batched.AddEntries(entries, 3));
+  EXPECT_EQ(batched.Serialize(&err), one_by_one.Serialize(&err));
+}
+
+TEST(DpCount, AddEntriesMissingAlgorithm) {
+  std::string err;
+  auto dp_count = DpCount(&err, false, 0);
+  const double entries[] = {1, 2};
+  EXPECT_FALSE(dp_count.AddEntries(entries, 2));
+}
+
 TEST(DpNtile, BadPercentile) {
   std::string err;
   auto func = DpNtile(&err, -1, 0, 10);
@@ -87,4 +236,98 @@ TEST(DpNtile, BasicTest) {
   EXPECT_TRUE(err.empty());
 }
 
+TEST(DpNtile, SerializeAndMerge) {
+  std::string err;
+  auto func = DpNtile(&err, .5, 0, 10);
+  EXPECT_TRUE(func.AddEntry(1));
+  DpNtile* deserialized =
+      DeserializeDpFunc<DpNtile>(func.Serialize(&err), &err);
+  ASSERT_NE(deserialized, nullptr);
+  EXPECT_TRUE(err.empty());
+  EXPECT_TRUE(deserialized->Merge(func.Serialize(&err), &err));
+  static_cast<void>(deserialized->Result(&err));
+  EXPECT_TRUE(err.empty());
+  delete deserialized;
+}
+
+TEST(DpNtile, LogHistogram) {
+  std::string err;
+  auto func = DpNtile(&err, .5, 0, 10, true, 0, /*log_histogram_sub_bins=*/16);
+  EXPECT_TRUE(err.empty());
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(func.AddEntry(i % 10));
+  }
+  DpNtile* deserialized =
+      DeserializeDpFunc<DpNtile>(func.Serialize(&err), &err);
+  ASSERT_NE(deserialized, nullptr);
+  EXPECT_EQ(deserialized->params().log_histogram_sub_bins, 16);
+  static_cast<void>(deserialized->Result(&err));
+  EXPECT_TRUE(err.empty());
+  delete deserialized;
+
+  auto exact = DpNtile(&err, .5, 0, 10);
+  EXPECT_FALSE(func.Merge(exact.Serialize(&err), &err));
+}
+
+TEST(DpNtile, BadLogHistogram) {
+  std::string err;
+  auto func = DpNtile(&err, .5, 0, 10, true, 0, /*log_histogram_sub_bins=*/-1);
+  EXPECT_EQ(err,
+            "Number of log histogram sub-bins must be positive, but is -1.");
+}
+
+TEST(DpCount, KeepPartitionWithoutSelection) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  EXPECT_TRUE(func.KeepPartition(&err));
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpCount, PartitionSelection) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  ASSERT_TRUE(func.SetPartitionSelection(1, 1e-5, &err));
+  for (int i = 0; i < 1000; ++i) {
+    func.AddEntry(1.0);
+  }
+  EXPECT_TRUE(func.KeepPartition(&err));
+  EXPECT_TRUE(err.empty());
+
+  auto empty = DpCount(&err, false, 1);
+  ASSERT_TRUE(empty.SetPartitionSelection(1, 1e-5, &err));
+  EXPECT_FALSE(empty.KeepPartition(&err));
+  EXPECT_TRUE(err.empty());
+}
+
+TEST(DpCount, BadPartitionSelection) {
+  std::string err;
+  auto func = DpCount(&err, false, 1);
+  EXPECT_FALSE(func.SetPartitionSelection(1, 2, &err));
+  EXPECT_EQ(err, "Delta must be in the inclusive interval [0,1], but is 2.");
+  err.clear();
+  EXPECT_FALSE(func.SetPartitionSelection(1, 0, &err));
+  EXPECT_EQ(err, "Partition selection delta must be positive.");
+  err.clear();
+  EXPECT_TRUE(func.KeepPartition(&err));
+}
+
+TYPED_TEST(BoundedDpFuncTest, PartitionSelectionIsSerialized) {
+  std::string err;
+  auto func = TypeParam(&err, false, 1, false, 0, 10);
+  ASSERT_TRUE(func.SetPartitionSelection(1, 1e-5, &err));
+  for (int i = 0; i < 1000; ++i) {
+    func.AddEntry(1.0);
+  }
+  TypeParam* deserialized =
+      DeserializeDpFunc<TypeParam>(func.Serialize(&err), &err);
+  ASSERT_NE(deserialized, nullptr);
+  EXPECT_EQ(deserialized->params().selection_epsilon, 1);
+  EXPECT_EQ(deserialized->params().selection_delta, 1e-5);
+  EXPECT_TRUE(deserialized->KeepPartition(&err));
+  delete deserialized;
+
+  auto other = TypeParam(&err, false, 1, false, 0, 10);
+  EXPECT_FALSE(other.Merge(func.Serialize(&err), &err));
+}
+
 }  // namespace
@@ -17,8 +17,12 @@
 #ifndef DIFFERENTIAL_PRIVACY_PROTO_UTIL_H_
 #define DIFFERENTIAL_PRIVACY_PROTO_UTIL_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <type_traits>
 
+#include "google/protobuf/repeated_field.h"
 #include "proto/data.pb.h"
 
 namespace differential_privacy {
@@ -77,6 +81,50 @@ ValueType MakeValueType(T value) {
   return value_type;
 }
 
+// Summaries store numeric values in a pair of packed int64 and double fields,
+// of which only the one matching the stored type is set. Older summaries store
+// them in a repeated ValueType field instead. AddPackedValue writes to the
+// packed field matching T. NumPackedValues and GetPackedValue read the values
+// of the ValueType field followed by those of the packed fields, so that both
+// encodings are accepted.
+template <typename T,
+          typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+void AddPackedValue(T value,
+                    google::protobuf::RepeatedField<int64_t>* int_values,
+                    google::protobuf::RepeatedField<double>* double_values) {
+  int_values->Add(value);
+}
+
+template <typename T, typename std::enable_if<
+                          std::is_floating_point<T>::value>::type* = nullptr>
+void AddPackedValue(T value,
+                    google::protobuf::RepeatedField<int64_t>* int_values,
+                    google::protobuf::RepeatedField<double>* double_values) {
+  double_values->Add(value);
+}
+
+inline size_t NumPackedValues(
+    const google::protobuf::RepeatedPtrField<ValueType>& values,
+    const google::protobuf::RepeatedField<int64_t>& int_values,
+    const google::protobuf::RepeatedField<double>& double_values) {
+  return values.size() + int_values.size() + double_values.size();
+}
+
+template <typename T>
+T GetPackedValue(const google::protobuf::RepeatedPtrField<ValueType>& values,
+                 const google::protobuf::RepeatedField<int64_t>& int_values,
+                 const google::protobuf::RepeatedField<double>& double_values,
+                 int i) {
+  if (i < values.size()) {
+    return GetValue<T>(values.Get(i));
+  }
+  i -= values.size();
+  if (i < int_values.size()) {
+    return static_cast<T>(int_values.Get(i));
+  }
+  return static_cast<T>(double_values.Get(i - int_values.size()));
+}
+
 template <typename T,
           typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
 T GetValue(const Output& output) {
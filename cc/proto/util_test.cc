@@ -48,6 +48,23 @@ TEST(UtilTest, GetSetValueTypeFloat) {
   EXPECT_THAT(GetValue<double>(v), Eq(10.0));
 }
 
+TEST(UtilTest, PackedValues) {
+  google::protobuf::RepeatedPtrField<ValueType> values;
+  google::protobuf::RepeatedField<int64_t> int_values;
+  google::protobuf::RepeatedField<double> double_values;
+  AddPackedValue<int64_t>(3, &int_values, &double_values);
+  AddPackedValue<double>(2.5, &int_values, &double_values);
+  EXPECT_THAT(int_values, testing::ElementsAre(3));
+  EXPECT_THAT(double_values, testing::ElementsAre(2.5));
+
+  // The ValueType values are read first.
+  SetValue(values.Add(), 7);
+  ASSERT_EQ(NumPackedValues(values, int_values, double_values), size_t{3});
+  EXPECT_EQ(GetPackedValue<int64_t>(values, int_values, double_values, 0), 7);
+  EXPECT_EQ(GetPackedValue<int64_t>(values, int_values, double_values, 1), 3);
+  EXPECT_EQ(GetPackedValue<double>(values, int_values, double_values, 2), 2.5);
+}
+
 TEST(UtilTest, MakeOutputString) {
   std::string s = "hello";
   Output output = MakeOutput<std::string>(s);
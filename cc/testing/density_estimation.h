@@ -17,13 +17,16 @@
 #ifndef DIFFERENTIAL_PRIVACY_TESTING_DENSITY_ESTIMATION_H_
 #define DIFFERENTIAL_PRIVACY_TESTING_DENSITY_ESTIMATION_H_
 
+#include <algorithm>
 #include <limits>
 #include <numeric>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "base/canonical_errors.h"
 #include "base/status.h"
 
@@ -46,28 +49,55 @@ constexpr char kNewLine[] = "\n";
 //   hist.Add(3);
 //   hist.BinCount(1).ValueOrDie() == 1 // true
 //   hist.BinCount(2).ValueOrDie() == 1 // true
+//
+// Histograms with the same bins can be filled separately, e.g., on different
+// threads, and then merged.
 template <typename T>
 class Histogram {
  public:
   Histogram(T lowest, double width, int num_bins)
       : lowest_(lowest),
         width_(width),
+        inverse_width_(1 / width),
         bin_counts_(std::vector<int>(num_bins, 0)) {}
 
   // Increment the count of the bin into which t falls.
   absl::Status Add(T element) {
-    double index = (element - lowest_) / width_;
+    double index = (element - lowest_) * inverse_width_;
     if (index < 0) {
       return base::InvalidArgumentError("The element is out of bounds.");
     }
-    if (index >= NumBins() - 1) {
-      ++bin_counts_[NumBins() - 1];
-    } else {
-      ++bin_counts_[static_cast<int>(index)];
+    AddToBin(index);
+    return absl::OkStatus();
+  }
+
+  // Increments the counts of the bins into which the elements fall. Nothing is
+  // added if any element is out of bounds.
+  absl::Status Add(absl::Span<const T> elements) {
+    if (std::any_of(elements.begin(), elements.end(),
+                    [this](T element) { return element - lowest_ < 0; })) {
+      return base::InvalidArgumentError("An element is out of bounds.");
+    }
+    for (T element : elements) {
+      AddToBin((element - lowest_) * inverse_width_);
     }
     return absl::OkStatus();
   }
 
+  // Adds the counts of other, which must have the same bins.
+  absl::Status Merge(const Histogram& other) {
+    if (other.lowest_ != lowest_ || other.width_ != width_ ||
+        other.NumBins() != NumBins()) {
+      return base::InvalidArgumentError(
+          "Cannot merge histograms with different bins.");
+    }
+    for (int i = 0; i < NumBins(); ++i) {
+      bin_counts_[i] += other.bin_counts_[i];
+    }
+    total_ += other.total_;
+    return absl::OkStatus();
+  }
+
   // Number of elements in bin index.
   base::StatusOr<int> BinCount(int index) const {
     if (index < 0 || index >= NumBins()) {
@@ -76,13 +106,14 @@ class Histogram {
     return bin_counts_[index];
   }
 
+  // Counts of all bins, for computations over the whole histogram.
+  absl::Span<const int> BinCounts() const { return bin_counts_; }
+
   // Number of fixed width bins, including the one to +inf.
   int NumBins() const { return bin_counts_.size(); }
 
   // Total number of elements in histogram.
-  int Total() const {
-    return std::accumulate(bin_counts_.begin(), bin_counts_.end(), 0);
-  }
+  int Total() const { return total_; }
 
   // Maximum count in any bin.
   int MaxBinCount() const {
@@ -139,9 +170,24 @@ class Histogram {
   // The width of each bin.
   const double width_;
 
+  // Multiplied by the distance from lowest_ to find the bin of an element,
+  // which is faster than dividing by the width.
+  const double inverse_width_;
+
   // The count in each bin.
   std::vector<int> bin_counts_;
 
+  // The sum of bin_counts_.
+  int total_ = 0;
+
+  // Increments the count of the bin at the non-negative index, where all
+  // indices past the last bin fall into it.
+  void AddToBin(double index) {
+    const int last = NumBins() - 1;
+    ++bin_counts_[index >= last ? last : static_cast<int>(index)];
+    ++total_;
+  }
+
   // Convert the ith bin boundary into std::string with the right format.
   std::string BoundToString(int i) const {
     double boundary = BinBoundary(i);
@@ -17,6 +17,7 @@
 #include "testing/density_estimation.h"
 
 #include <limits>
+#include <vector>
 
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
@@ -27,6 +28,9 @@ namespace differential_privacy {
 namespace testing {
 namespace {
 
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::ElementsAre;
+
 template <typename T>
 class HistogramTest : public ::testing::Test {};
 
@@ -76,6 +80,38 @@ TYPED_TEST(HistogramTest, SmallInputSet) {
   EXPECT_EQ(hist.MaxBinCount(), 2);
 }
 
+TYPED_TEST(HistogramTest, AddBatch) {
+  Histogram<TypeParam> hist(-2, 2, 3);
+  EXPECT_OK(hist.Add(std::vector<TypeParam>{-1, 0, 0, 100}));
+  EXPECT_THAT(hist.BinCounts(), ElementsAre(1, 2, 1));
+  EXPECT_EQ(hist.Total(), 4);
+
+  // Nothing is added if any element is out of bounds.
+  EXPECT_THAT(hist.Add(std::vector<TypeParam>{0, -3}),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(hist.BinCounts(), ElementsAre(1, 2, 1));
+  EXPECT_EQ(hist.Total(), 4);
+}
+
+TYPED_TEST(HistogramTest, Merge) {
+  Histogram<TypeParam> hist(-2, 2, 3);
+  Histogram<TypeParam> other(-2, 2, 3);
+  EXPECT_OK(hist.Add(-1));
+  EXPECT_OK(other.Add(0));
+  EXPECT_OK(other.Add(100));
+  EXPECT_OK(hist.Merge(other));
+  EXPECT_THAT(hist.BinCounts(), ElementsAre(1, 1, 1));
+  EXPECT_EQ(hist.Total(), 3);
+
+  EXPECT_THAT(hist.Merge(Histogram<TypeParam>(-2, 2, 4)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(hist.Merge(Histogram<TypeParam>(-2, 1, 3)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(hist.Merge(Histogram<TypeParam>(0, 2, 3)),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_EQ(hist.Total(), 3);
+}
+
 TEST(HistogramTest, ToStringEmpty) {
   Histogram<double> hist(0, 1.0 / 3.0, 2);
   const std::string expected = absl::StrCat(
@@ -0,0 +1,78 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_TESTING_RESULT_SAMPLER_H_
+#define DIFFERENTIAL_PRIVACY_TESTING_RESULT_SAMPLER_H_
+
+#include <vector>
+
+#include "base/statusor.h"
+#include "algorithms/algorithm.h"
+#include "proto/data.pb.h"
+#include "proto/summary.pb.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+namespace testing {
+
+// Draws independent results of an algorithm on the same entries, for tests
+// that need many noisy samples of one dataset. The entries are only added once,
+// when the sampler is created, and the accumulated state is kept as a Summary.
+// Each draw resets the algorithm and merges that summary before generating a
+// result, so it costs the size of the state rather than the number of entries.
+//
+// Algorithms that do not serialize their state, i.e., whose summary has no
+// data, get all the entries added again for every draw instead.
+//
+// The sampler does not own the algorithm, which must outlive it. The
+// algorithm must not be used for anything else while samples are drawn.
+template <typename T>
+class ResultSampler {
+ public:
+  template <typename Iterator>
+  ResultSampler(Algorithm<T>* algorithm, Iterator begin, Iterator end)
+      : algorithm_(algorithm) {
+    algorithm_->Reset();
+    algorithm_->AddEntries(begin, end);
+    summary_ = algorithm_->Serialize();
+    if (!summary_.has_data()) {
+      entries_.assign(begin, end);
+    }
+    algorithm_->Reset();
+  }
+
+  // Returns a result on the entries with fresh noise, using the full privacy
+  // budget of the algorithm.
+  base::StatusOr<Output> Sample() {
+    if (!summary_.has_data()) {
+      return algorithm_->Result(entries_.begin(), entries_.end());
+    }
+    algorithm_->Reset();
+    RETURN_IF_ERROR(algorithm_->Merge(summary_));
+    return algorithm_->PartialResult();
+  }
+
+ private:
+  Algorithm<T>* algorithm_;
+  Summary summary_;
+  // Only set if the algorithm does not serialize its state.
+  std::vector<T> entries_;
+};
+
+}  // namespace testing
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_TESTING_RESULT_SAMPLER_H_
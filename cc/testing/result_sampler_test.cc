@@ -0,0 +1,114 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "testing/result_sampler.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "proto/util.h"
+
+namespace differential_privacy {
+namespace testing {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+
+// Counts the entries it was given, without serializing its state.
+class EntryCounter : public Algorithm<double> {
+ public:
+  EntryCounter() : Algorithm<double>(1) {}
+  void AddEntry(const double& t) override {
+    ++count_;
+    ++num_added_;
+  }
+
+  int64_t num_added() const { return num_added_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(
+      double /*privacy_budget*/, double /*noise_interval_level*/) override {
+    return MakeOutput<int64_t>(count_);
+  }
+  void ResetState() override { count_ = 0; }
+
+  Summary Serialize() override { return Summary(); }
+  absl::Status Merge(const Summary& summary) override {
+    return absl::OkStatus();
+  }
+  int64_t MemoryUsed() override { return sizeof(EntryCounter); }
+
+ private:
+  int64_t count_ = 0;
+  int64_t num_added_ = 0;
+};
+
+TEST(ResultSamplerTest, SamplesFromSerializedState) {
+  std::unique_ptr<BoundedSum<double>> sum =
+      BoundedSum<double>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  std::vector<double> entries = {1, 2, 3, 20};
+  ResultSampler<double> sampler(sum.get(), entries.begin(), entries.end());
+  for (int i = 0; i < 3; ++i) {
+    base::StatusOr<Output> result = sampler.Sample();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<double>(result.value()), 16);
+  }
+}
+
+TEST(ResultSamplerTest, DrawsFreshNoise) {
+  std::unique_ptr<Count<double>> count =
+      Count<double>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  std::vector<double> entries(100, 1);
+  ResultSampler<double> sampler(count.get(), entries.begin(), entries.end());
+  std::set<int64_t> values;
+  for (int i = 0; i < 100; ++i) {
+    base::StatusOr<Output> result = sampler.Sample();
+    ASSERT_OK(result);
+    values.insert(GetValue<int64_t>(result.value()));
+  }
+  EXPECT_GT(values.size(), 1);
+}
+
+TEST(ResultSamplerTest, AddsEntriesAgainWithoutSerializedState) {
+  EntryCounter counter;
+  std::vector<double> entries = {1, 2, 3};
+  ResultSampler<double> sampler(&counter, entries.begin(), entries.end());
+  for (int i = 0; i < 2; ++i) {
+    base::StatusOr<Output> result = sampler.Sample();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<int64_t>(result.value()), 3);
+  }
+  EXPECT_EQ(counter.num_added(), 9);
+}
+
+}  // namespace
+}  // namespace testing
+}  // namespace differential_privacy
@@ -18,12 +18,14 @@
 #define DIFFERENTIAL_PRIVACY_TESTING_SEQUENCE_H_
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 #include "base/logging.h"
 #include "absl/memory/memory.h"
 #include "absl/random/distributions.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
 namespace testing {
@@ -100,6 +102,17 @@ class HypercubeSequence : public Sequence<T> {
     return std::vector<int64_t>(n, dimension_);
   }
 
+  // Writes the next num_samples samples to samples, which must hold
+  // num_samples * dimension elements, as the rows of a row-major matrix.
+  // Subclasses override this to generate the samples in place.
+  virtual void GetSamples(int64_t num_samples, absl::Span<T> samples) {
+    CHECK_EQ(samples.size(), num_samples * dimension_);
+    for (int64_t i = 0; i < num_samples; ++i) {
+      const std::vector<T> sample = GetSample();
+      std::copy(sample.begin(), sample.end(), samples.begin() + i * dimension_);
+    }
+  }
+
   // In general, the range of the dataset elements is [offset, scale + offset]
   // since Sequence ranges are transformed by scaling first then applying the
   // offset.
@@ -150,6 +163,64 @@ class Halton {
   int base_;
 };
 
+// Generates the consecutive values of a Halton sequence from a starting index.
+// The digits of the index are kept, so that moving to the next index takes
+// amortized constant time rather than O(log(i)). The radical inverse is kept
+// as an integer, so values are exact up to the final division and do not
+// accumulate rounding errors.
+class IncrementalHalton {
+ public:
+  IncrementalHalton(int base, int64_t index) : base_(base) {
+    CHECK(std::count(GetFirstPrimes().begin(), GetFirstPrimes().end(), base));
+    CHECK_GT(index, 0);
+    // Use as many digits as keep the denominator exactly representable as a
+    // double.
+    uint64_t denominator = 1;
+    while (denominator <= (uint64_t{1} << 53) / base) {
+      denominator *= base;
+      weights_.push_back(0);
+    }
+    denominator_ = static_cast<double>(denominator);
+    for (int j = 0; j < weights_.size(); ++j) {
+      denominator /= base;
+      weights_[j] = denominator;
+    }
+    digits_.resize(weights_.size(), 0);
+    for (int j = 0; index > 0; ++j, index /= base) {
+      CHECK_LT(j, digits_.size());
+      digits_[j] = index % base;
+      reversed_ += digits_[j] * weights_[j];
+    }
+  }
+
+  // Returns the value at the current index, which is in (0, 1).
+  double Value() const { return reversed_ / denominator_; }
+
+  // Moves to the next index.
+  void Next() {
+    for (int j = 0;; ++j) {
+      CHECK_LT(j, digits_.size());
+      reversed_ += weights_[j];
+      if (++digits_[j] < base_) {
+        return;
+      }
+      // Carry into the next digit.
+      digits_[j] = 0;
+      reversed_ -= base_ * weights_[j];
+    }
+  }
+
+ private:
+  int base_;
+  // Digits of the index in base_, from least to most significant.
+  std::vector<int> digits_;
+  // Weight of each digit in the reversed number, base_^(num_digits - 1 - j).
+  std::vector<uint64_t> weights_;
+  // The digits reversed, i.e., the value times denominator_.
+  uint64_t reversed_ = 0;
+  double denominator_;
+};
+
 // Low-discrepancy sequence: generates a determinisitic sequence of uniform
 // random points that are spread out evenly.
 //
@@ -190,30 +261,45 @@ class HaltonSequence : public HypercubeSequence<T> {
   }
   std::vector<T> GetSample() override {
     std::vector<T> result(HypercubeSequence<T>::dimension_);
-    do {
-      for (int i = 0; i < HypercubeSequence<T>::dimension_; ++i) {
-        result[i] = HypercubeSequence<T>::scale_ *
-                        halton_generators_[i]->Get(current_index_) +
-                    HypercubeSequence<T>::shift_;
-      }
-      ++current_index_;
-    } while (sorted_only_ && !std::is_sorted(result.begin(), result.end()));
+    NextSample(absl::MakeSpan(result));
     return result;
   }
 
+  // Generates the samples in place, without any allocation.
+  void GetSamples(int64_t num_samples, absl::Span<T> samples) override {
+    const int64_t dimension = HypercubeSequence<T>::dimension_;
+    CHECK_EQ(samples.size(), num_samples * dimension);
+    for (int64_t i = 0; i < num_samples; ++i) {
+      NextSample(samples.subspan(i * dimension, dimension));
+    }
+  }
+
   HaltonSequence() = delete;
   ~HaltonSequence() override = default;
 
  private:
-  std::vector<std::unique_ptr<Halton>> halton_generators_;
+  std::vector<IncrementalHalton> halton_generators_;
   int64_t current_index_;
   bool sorted_only_;
 
   void InitializeHaltonGenerators(const std::vector<int>& bases) {
     CHECK(HypercubeSequence<T>::dimension_ == bases.size());
-    halton_generators_.resize(bases.size());
-    std::transform(bases.begin(), bases.end(), halton_generators_.begin(),
-                   [](int b) { return absl::make_unique<Halton>(b); });
+    for (int b : bases) {
+      halton_generators_.emplace_back(b, current_index_);
+    }
+  }
+
+  // Writes the next sample to result.
+  void NextSample(absl::Span<T> result) {
+    do {
+      for (int i = 0; i < HypercubeSequence<T>::dimension_; ++i) {
+        result[i] =
+            HypercubeSequence<T>::scale_ * halton_generators_[i].Value() +
+            HypercubeSequence<T>::shift_;
+        halton_generators_[i].Next();
+      }
+      ++current_index_;
+    } while (sorted_only_ && !std::is_sorted(result.begin(), result.end()));
   }
 };
 
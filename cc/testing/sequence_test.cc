@@ -19,6 +19,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "algorithms/util.h"
 
 namespace differential_privacy {
@@ -127,6 +128,43 @@ TEST(HaltonTest, Base2) {
   }
 }
 
+
+TEST(HaltonSequenceTest, GetSamplesMatchesGetSample) {
+  // Few dimensions, so that sorted samples are not too rare.
+  const int dimensions = 3;
+  for (bool sorted_only : {false, true}) {
+    HaltonSequence<double> batch(dimensions, sorted_only);
+    HaltonSequence<double> single(dimensions, sorted_only);
+    std::vector<double> samples(100 * dimensions);
+    batch.GetSamples(100, absl::MakeSpan(samples));
+    for (int i = 0; i < 100; ++i) {
+      const std::vector<double> sample = single.GetSample();
+      for (int j = 0; j < dimensions; ++j) {
+        EXPECT_EQ(samples[i * dimensions + j], sample[j]);
+      }
+    }
+  }
+}
+
+TEST(IncrementalHaltonTest, MatchesHalton) {
+  for (int base : {2, 3, 5, 29}) {
+    Halton halton(base);
+    IncrementalHalton incremental(base, 1);
+    for (int64_t i = 1; i <= 10000; ++i) {
+      EXPECT_NEAR(incremental.Value(), halton.Get(i), 1e-15);
+      incremental.Next();
+    }
+  }
+}
+
+TEST(IncrementalHaltonTest, StartsAtIndex) {
+  Halton halton(3);
+  IncrementalHalton incremental(3, 1000);
+  EXPECT_NEAR(incremental.Value(), halton.Get(1000), 1e-15);
+  incremental.Next();
+  EXPECT_NEAR(incremental.Value(), halton.Get(1001), 1e-15);
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace differential_privacy
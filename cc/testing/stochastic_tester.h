@@ -18,20 +18,29 @@
 #ifndef DIFFERENTIAL_PRIVACY_TESTING_STOCHASTIC_TESTER_H_
 #define DIFFERENTIAL_PRIVACY_TESTING_STOCHASTIC_TESTER_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <functional>
 #include <iomanip>
+#include <memory>
 #include <stack>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "base/logging.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/hash/hash.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "algorithms/algorithm.h"
+#include "algorithms/merge-all.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
 #include "testing/density_estimation.h"
+#include "testing/result_sampler.h"
 #include "testing/sequence.h"
 
 namespace differential_privacy {
@@ -47,6 +56,7 @@ constexpr double DefaultDataOffset() { return -0.5; }
 constexpr int DefaultDatasetSize() { return 3; }
 constexpr int DefaultNumSamplesPerHistogram() { return 10000; }
 constexpr int DefaultNumDatasetsToTest() { return 50; }
+constexpr int DefaultNumSequentialLooks() { return 4; }
 
 constexpr double MinimumRealBinWidth() { return 1e-10; }
 constexpr double MinimumIntegralBinWidth() { return 1.0; }
@@ -79,6 +89,8 @@ class StochasticTester;
 template <typename T, typename OutputT>
 class StochasticTester<T, OutputT> {
  public:
+  using AlgorithmFactory = std::function<std::unique_ptr<Algorithm<T>>()>;
+
   StochasticTester(
       std::unique_ptr<Algorithm<T>> algorithm,
       std::unique_ptr<Sequence<T>> sequence,
@@ -92,33 +104,139 @@ class StochasticTester<T, OutputT> {
         disable_search_branching_(disable_search_branching),
         max_violation_pct_(0.0) {}
 
+  // Checks the datasets on up to num_threads threads, or on as many threads as
+  // the hardware supports if num_threads is not positive. Every dataset is
+  // checked with its own algorithm, built by algorithm_factory, so algorithms
+  // need not be thread-safe and each has its own random number generator,
+  // e.g., the one of a SeededLaplaceMechanism.
+  //
+  // The datasets and their algorithms are created in order on the calling
+  // thread, and the comparisons of a dataset are all made on one thread, so
+  // the samples of each dataset and whether Run() passes do not depend on the
+  // number of threads or on their scheduling.
+  StochasticTester(
+      AlgorithmFactory algorithm_factory, std::unique_ptr<Sequence<T>> sequence,
+      int num_threads, int64_t num_datasets = DefaultNumDatasetsToTest(),
+      int64_t num_samples_per_histogram = DefaultNumSamplesPerHistogram(),
+      bool disable_search_branching = false)
+      : algorithm_factory_(std::move(algorithm_factory)),
+        sequence_(std::move(sequence)),
+        num_threads_(num_threads),
+        num_datasets_(num_datasets),
+        num_samples_per_histogram_(num_samples_per_histogram),
+        disable_search_branching_(disable_search_branching),
+        max_violation_pct_(0.0) {
+    if (num_threads_ <= 0) {
+      num_threads_ = std::max<int>(1, std::thread::hardware_concurrency());
+    }
+  }
+
+  // Enables sequential testing, which ends each comparison as soon as its
+  // outcome is decided. A comparison is first made on
+  // num_samples_per_histogram / 2^(num_looks - 1) samples per histogram, and
+  // the number of samples is doubled up to num_samples_per_histogram, for at
+  // most num_looks looks. The comparison fails as soon as the DP predicate is
+  // violated. It passes early once no bin could be violated by the comparison
+  // on all samples for any distributions within the confidence bounds of the
+  // current histograms. The confidence bounds of every look are corrected for
+  // the number of looks, so that the probability of a false failure is not
+  // increased by looking more than once. With num_looks of 1, which is the
+  // default, every comparison is made on all samples.
+  void SetSequentialLooks(int num_looks) {
+    num_looks_ = std::max(1, num_looks);
+  }
+
   bool Run() {
     Reset();
+    if (algorithm_factory_) {
+      return RunParallel();
+    }
 
     // For each dataset, check each member of its powerset for whether it
     // satisfies the dp predicate and record it in class variables. If too
     // many failures are seen, return early.
-    const double num_failures_ok = kHistogramPaddingAlpha * num_comparison_;
     for (int i = 0; i < num_datasets_; ++i) {
       std::vector<T> dataset = GenerateDataset();
-      CheckDifferentiallyPrivateOnDataset(dataset);
-      if (num_comparison_failures_ > num_failures_ok) {
-        LOG(INFO)
-            << "More than " << kHistogramPaddingAlpha
-            << " of comparisons failed so the algorithm is likely not DP.";
+      AddDatasetResult(
+          CheckDifferentiallyPrivateOnDataset(dataset, algorithm_.get()));
+      if (TooManyFailures()) {
         return false;
       }
     }
+    LogSummary();
+    return true;
+  }
+
+ private:
+  // Outcome of the comparisons on one dataset.
+  struct DatasetResult {
+    int64_t num_comparison_failures = 0;
+    double max_violation_pct = 0.0;
+  };
+
+  // Outcome of one look at a comparison. Without sequential testing, the
+  // outcome is never undecided.
+  enum class PredicateOutcome { kViolated, kSatisfied, kUndecided };
+
+  // Samples of a subset of the dataset, which are drawn as they are needed.
+  struct CachedSamples {
+    ResultSampler<T> sampler;
+    std::vector<base::StatusOr<OutputT>> samples;
+  };
+
+  bool RunParallel() {
+    std::vector<std::vector<T>> datasets;
+    std::vector<std::unique_ptr<Algorithm<T>>> algorithms;
+    for (int i = 0; i < num_datasets_; ++i) {
+      datasets.push_back(GenerateDataset());
+      algorithms.push_back(algorithm_factory_());
+    }
 
+    // The failures only ever add up, so once there are too many the test fails
+    // whatever happens on the remaining datasets, which are skipped.
+    const double num_failures_ok = kHistogramPaddingAlpha * num_comparison_;
+    std::atomic<int64_t> num_failures(0);
+    std::vector<DatasetResult> results(num_datasets_);
+    internal::ParallelFor(num_datasets_, num_threads_, [&](int64_t i) {
+      if (num_failures.load() <= num_failures_ok) {
+        results[i] = CheckDifferentiallyPrivateOnDataset(datasets[i],
+                                                         algorithms[i].get());
+        num_failures += results[i].num_comparison_failures;
+      }
+      algorithms[i].reset();
+    });
+    for (const DatasetResult& result : results) {
+      AddDatasetResult(result);
+    }
+    if (TooManyFailures()) {
+      return false;
+    }
+    LogSummary();
+    return true;
+  }
+
+  void AddDatasetResult(const DatasetResult& result) {
+    num_comparison_failures_ += result.num_comparison_failures;
+    max_violation_pct_ = std::max(max_violation_pct_, result.max_violation_pct);
+  }
+
+  bool TooManyFailures() const {
+    if (num_comparison_failures_ <= kHistogramPaddingAlpha * num_comparison_) {
+      return false;
+    }
+    LOG(INFO) << "More than " << kHistogramPaddingAlpha
+              << " of comparisons failed so the algorithm is likely not DP.";
+    return true;
+  }
+
+  void LogSummary() const {
     LOG(INFO) << "Across all datasets, proportion of comparisons failed: "
               << num_comparison_failures_ << " / " << num_comparison_;
     LOG(INFO) << absl::StrCat(
         "Tested DP over ", num_datasets_,
         " dataset(s). (Maximum violation %: ", max_violation_pct_ * 100, ")");
-    return true;
   }
 
- private:
   struct SelectionVectorHash {
     size_t operator()(const SelectionVector& v) const {
       const std::string serialized_v = absl::StrJoin(v, ".");
@@ -161,10 +279,36 @@ class StochasticTester<T, OutputT> {
   // Checks both directions of the DP predicate. This generates histograms based
   // on the samples passed in and compares them based on the DP predicate.
   // We allow for some amount of error that arises from the histogram
-  // approximation, thus this still returns true in cases where the predicate
-  // is violated within error bounds.
-  bool CheckDpPredicate(const std::vector<base::StatusOr<OutputT>>& dx_samples,
-                        const std::vector<base::StatusOr<OutputT>>& dy_samples);
+  // approximation, thus this is still satisfied in cases where the predicate
+  // is violated within error bounds. Updates the maximum violation of result.
+  // If there are fewer than final_size samples, the outcome is undecided
+  // unless the comparison on final_size samples could not be violated, see
+  // SetSequentialLooks().
+  PredicateOutcome CheckDpPredicate(
+      absl::Span<const base::StatusOr<OutputT>> dx_samples,
+      absl::Span<const base::StatusOr<OutputT>> dy_samples, double epsilon,
+      int64_t final_size, DatasetResult* result);
+
+  // Compares the samples of two neighbouring subsets, drawing more samples for
+  // every look until the outcome is decided. Returns false if the DP predicate
+  // is violated.
+  bool CompareSamples(double epsilon, CachedSamples* dx, CachedSamples* dy,
+                      DatasetResult* result) {
+    for (int look = num_looks_ - 1; look >= 0; --look) {
+      const int64_t size =
+          std::max<int64_t>(1, num_samples_per_histogram_ >> look);
+      ExtendSamples(size, dx);
+      ExtendSamples(size, dy);
+      const PredicateOutcome outcome = CheckDpPredicate(
+          absl::MakeConstSpan(dx->samples).first(size),
+          absl::MakeConstSpan(dy->samples).first(size), epsilon,
+          num_samples_per_histogram_, result);
+      if (outcome != PredicateOutcome::kUndecided) {
+        return outcome == PredicateOutcome::kSatisfied;
+      }
+    }
+    return true;
+  }
 
   // We need to check that all combinations of the input dataset of size 1 to N
   // obey the differential privacy predicate with all datasets that are a
@@ -173,9 +317,12 @@ class StochasticTester<T, OutputT> {
   // boolean selector vector to select subsets of the dataset. We keep track of
   // the subset sizes directly for efficiency. The DP algorithm is run multiple
   // times to generate a set of samples when successors are generated, which are
-  // cached for reuse. Calls CheckDpPredicate for each distance-1 pair to
-  // increment counter variables for number of successes of CheckDpPredicate.
-  void CheckDifferentiallyPrivateOnDataset(const std::vector<T>& dataset);
+  // cached for reuse. Calls CheckDpPredicate for each distance-1 pair and
+  // returns the number of failures of CheckDpPredicate. Only uses algorithm
+  // and constant members, so datasets can be checked concurrently with
+  // different algorithms.
+  DatasetResult CheckDifferentiallyPrivateOnDataset(
+      const std::vector<T>& dataset, Algorithm<T>* algorithm);
 
   // Given a current selection vector and the number of elements expected in
   // the set of successors, this generates the successors by flipping exactly
@@ -187,15 +334,12 @@ class StochasticTester<T, OutputT> {
   std::vector<SelectionVectorAndSizePair> GenerateSuccessors(
       const SelectionVector& selector, size_t succ_selector_size) const;
 
-  // Runs the DP algorithm over a dataset. In our case, the containers are
-  // based on itertools iterators which do not necessarily have size functions,
-  // so we provide that interface here.
-  template <typename Container>
-  std::vector<base::StatusOr<OutputT>> GenerateSamples(Container* c,
-                                                       size_t size) {
-    std::vector<base::StatusOr<OutputT>> samples(num_samples_per_histogram_);
-    for (int i = 0; i < num_samples_per_histogram_; ++i) {
-      base::StatusOr<Output> output = algorithm_->Result(c->begin(), c->end());
+  // Runs the DP algorithm until there are size samples of its results. The
+  // entries are only added once, see ResultSampler.
+  void ExtendSamples(int64_t size, CachedSamples* cached) {
+    std::vector<base::StatusOr<OutputT>>& samples = cached->samples;
+    for (int64_t i = samples.size(); i < size; ++i) {
+      base::StatusOr<Output> output = cached->sampler.Sample();
 
       // Algorithms such as ApproxBounds may return an error status rather than
       // a value for some datasets on some occasions. In this case we wish to
@@ -203,12 +347,11 @@ class StochasticTester<T, OutputT> {
       // status as a regular value, to be substituted during histogram
       // generation.
       if (output.ok()) {
-        samples[i] = GetValue<OutputT>(output.ValueOrDie());
+        samples.push_back(GetValue<OutputT>(output.ValueOrDie()));
       } else {
-        samples[i] = output.status();
+        samples.push_back(output.status());
       }
     }
-    return samples;
   }
 
   std::vector<T> GenerateDataset() { return sequence_->GetSample(); }
@@ -226,17 +369,39 @@ class StochasticTester<T, OutputT> {
   // The return value of this function is true only if the value exceeds
   // boundary_max.
   bool CheckBoundsAndUpdateMaxViolation(double value, double boundary_min,
-                                        double boundary_max) {
+                                        double boundary_max,
+                                        DatasetResult* result) {
     if (value <= boundary_min) {
       return false;
     }
     double absolute_violation = value - boundary_min;
     double boundary_size = boundary_max - boundary_min;
-    max_violation_pct_ =
-        std::max(max_violation_pct_, absolute_violation / boundary_size);
+    result->max_violation_pct = std::max(result->max_violation_pct,
+                                         absolute_violation / boundary_size);
     return value > boundary_max;
   }
 
+  // Returns whether the comparison on the final number of samples could
+  // violate the predicate for px > py in a bin in which the histograms of dx
+  // and dy currently have the proportions px and py. The error intervals are
+  // bounds on the square roots of the proportions scaled by the number of
+  // buckets, see CheckDpPredicate. Since the final samples include the
+  // current ones, the final square roots differ from the current ones by at
+  // most sqrt(error_interval^2 - final_error_interval^2) with the same
+  // confidence.
+  static bool CouldViolateAtFinalSize(double px, double py, int num_buckets,
+                                      double error_interval,
+                                      double final_error_interval,
+                                      double epsilon) {
+    const double drift = sqrt(std::max(
+        0.0, error_interval * error_interval -
+                 final_error_interval * final_error_interval));
+    const double ux = sqrt(px * num_buckets) + drift;
+    const double uy = std::max(0.0, sqrt(py * num_buckets) - drift);
+    return ux - final_error_interval >
+           exp(epsilon / 2) * (uy + final_error_interval);
+  }
+
   void Reset() {
     max_violation_pct_ = 0.0;
     num_comparison_failures_ = 0;
@@ -256,13 +421,17 @@ class StochasticTester<T, OutputT> {
   // Replace all samples that were output error to this error value. Populate
   // the value_samples vectors with replaced values.
   void ReplaceErrorWithValue(
-      const std::vector<base::StatusOr<OutputT>>& dx_samples,
-      const std::vector<base::StatusOr<OutputT>>& dy_samples,
+      absl::Span<const base::StatusOr<OutputT>> dx_samples,
+      absl::Span<const base::StatusOr<OutputT>> dy_samples,
       std::vector<OutputT>* dx_value_samples,
       std::vector<OutputT>* dy_value_samples);
 
+  // Exactly one of algorithm_ and algorithm_factory_ is set. With a factory,
+  // datasets are checked in parallel on num_threads_ threads.
   std::unique_ptr<Algorithm<T>> algorithm_;
+  AlgorithmFactory algorithm_factory_;
   std::unique_ptr<Sequence<T>> sequence_;
+  int num_threads_ = 1;
 
   int64_t num_datasets_;
   int64_t num_samples_per_histogram_;
@@ -274,6 +443,9 @@ class StochasticTester<T, OutputT> {
   // The default value is false so full search is the standard behavior.
   bool disable_search_branching_;
 
+  // Maximum number of looks at each comparison, see SetSequentialLooks().
+  int num_looks_ = 1;
+
   // The maximum amount by which any histogram bucket exceeded the differential
   // privacy requirement, expressed as a proportion of the amount the bucket was
   // allowed to exceed the requirement by our error bounds.
@@ -363,8 +535,8 @@ StochasticTester<T, OutputT>::ComputeCombinedHistogramOptions(
 
 template <typename T, typename OutputT>
 void StochasticTester<T, OutputT>::ReplaceErrorWithValue(
-    const std::vector<base::StatusOr<OutputT>>& dx_samples,
-    const std::vector<base::StatusOr<OutputT>>& dy_samples,
+    absl::Span<const base::StatusOr<OutputT>> dx_samples,
+    absl::Span<const base::StatusOr<OutputT>> dy_samples,
     std::vector<OutputT>* dx_value_samples,
     std::vector<OutputT>* dy_value_samples) {
   // Find the minimum and bin width without error outputs to heuristically chose
@@ -409,11 +581,11 @@ void StochasticTester<T, OutputT>::ReplaceErrorWithValue(
 }
 
 template <typename T, typename OutputT>
-bool StochasticTester<T, OutputT>::CheckDpPredicate(
-    const std::vector<base::StatusOr<OutputT>>& dx_samples,
-    const std::vector<base::StatusOr<OutputT>>& dy_samples) {
-  double epsilon = algorithm_->GetEpsilon();
-
+typename StochasticTester<T, OutputT>::PredicateOutcome
+StochasticTester<T, OutputT>::CheckDpPredicate(
+    absl::Span<const base::StatusOr<OutputT>> dx_samples,
+    absl::Span<const base::StatusOr<OutputT>> dy_samples, double epsilon,
+    int64_t final_size, DatasetResult* result) {
   // Handle error outputs by replacing them with a default error value. We must
   // replace error values first and include them in the analysis to create the
   // histogram options in order to provide an accurate confidence interval when
@@ -433,14 +605,12 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
   // small and far from this point.
   Histogram<OutputT> dx_hist(options.lowest, options.bin_width,
                              options.num_bins);
-  for (const OutputT& e : dx_value_samples) {
-    CHECK(dx_hist.Add(e).ok());
-  }
+  CHECK(dx_hist.Add(dx_value_samples).ok());
   Histogram<OutputT> dy_hist(options.lowest, options.bin_width,
                              options.num_bins);
-  for (const OutputT& e : dy_value_samples) {
-    CHECK(dy_hist.Add(e).ok());
-  }
+  CHECK(dy_hist.Add(dy_value_samples).ok());
+  const absl::Span<const int> dx_counts = dx_hist.BinCounts();
+  const absl::Span<const int> dy_counts = dy_hist.BinCounts();
 
   // The total number of actual buckets within the bounds is 1 fewer,
   // because there is an extra bucket on the upper extreme to consider values
@@ -458,21 +628,27 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
   // Note that although these intervals are implicitly identical because the
   // number of samples for each set of samples is enforced to be the same in
   // StochasticTester, we don't necessarily make the assumption here and
-  // therefore compute an interval for each.
+  // therefore compute an interval for each. With sequential testing, alpha is
+  // also divided by the number of looks.
   double dx_size = static_cast<double>(dx_samples.size());
   double dy_size = static_cast<double>(dy_samples.size());
   double critical_value =
-      Qnorm(1 - (kHistogramPaddingAlpha / 2 / actual_num_buckets), /*mu=*/0.0,
-            /*sigma=*/1.0)
+      Qnorm(1 - (kHistogramPaddingAlpha / 2 / actual_num_buckets / num_looks_),
+            /*mu=*/0.0, /*sigma=*/1.0)
           .ValueOrDie();
   double dx_error_interval =
       critical_value * sqrt(actual_num_buckets / dx_size) / 2;
   double dy_error_interval =
       critical_value * sqrt(actual_num_buckets / dy_size) / 2;
+  const double final_samples = static_cast<double>(final_size);
+  const bool is_final = std::min(dx_size, dy_size) >= final_samples;
+  const double final_error_interval =
+      critical_value * sqrt(actual_num_buckets / final_samples) / 2;
+  bool could_violate_at_final_size = false;
 
   for (int i = 0; i < options.num_bins; ++i) {
-    double px = dx_hist.BinCount(i).ValueOrDie() / dx_size;
-    double py = dy_hist.BinCount(i).ValueOrDie() / dy_size;
+    double px = dx_counts[i] / dx_size;
+    double py = dy_counts[i] / dy_size;
     double px_differential_privacy_bound = exp(epsilon) * px;
     double py_differential_privacy_bound = exp(epsilon) * py;
 
@@ -497,14 +673,14 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
     double px_upper_differential_privacy_bound = exp(epsilon) * px_upper_bound;
     double py_upper_differential_privacy_bound = exp(epsilon) * py_upper_bound;
 
-    bool bound_exceeded = (dx_hist.BinCount(i).ValueOrDie() > 0 &&
+    bool bound_exceeded = (dx_counts[i] > 0 &&
                            CheckBoundsAndUpdateMaxViolation(
                                px_lower_bound, py_differential_privacy_bound,
-                               py_upper_differential_privacy_bound)) ||
-                          (dy_hist.BinCount(i).ValueOrDie() > 0 &&
+                               py_upper_differential_privacy_bound, result)) ||
+                          (dy_counts[i] > 0 &&
                            CheckBoundsAndUpdateMaxViolation(
                                py_lower_bound, px_differential_privacy_bound,
-                               px_upper_differential_privacy_bound));
+                               px_upper_differential_privacy_bound, result));
 
     // We only report that the predicate is not satisfied if it also exceeds
     // the confidence bounds.
@@ -546,23 +722,35 @@ bool StochasticTester<T, OutputT>::CheckDpPredicate(
                                   " > ", px_differential_privacy_bound);
       }
       LOG(INFO) << absl::StrCat("Bounds exceeded by (>100%): ",
-                                max_violation_pct_);
+                                result->max_violation_pct);
       LOG(INFO) << " ";
-      return false;
+      return PredicateOutcome::kViolated;
     }
+    could_violate_at_final_size =
+        could_violate_at_final_size ||
+        CouldViolateAtFinalSize(px, py, actual_num_buckets, dx_error_interval,
+                                final_error_interval, epsilon) ||
+        CouldViolateAtFinalSize(py, px, actual_num_buckets, dy_error_interval,
+                                final_error_interval, epsilon);
+  }
+  if (!is_final && could_violate_at_final_size) {
+    return PredicateOutcome::kUndecided;
   }
-  return true;
+  return PredicateOutcome::kSatisfied;
 }
 
 template <typename T, typename OutputT>
-void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
-    const std::vector<T>& dataset) {
-  absl::flat_hash_map<SelectionVector,
-                      AlgorithmResultSamples<base::StatusOr<OutputT>>,
-                      SelectionVectorHash>
+typename StochasticTester<T, OutputT>::DatasetResult
+StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
+    const std::vector<T>& dataset, Algorithm<T>* algorithm) {
+  DatasetResult result;
+  absl::flat_hash_map<SelectionVector, CachedSamples, SelectionVectorHash>
       sample_cache;
   SelectionVector full_set_selector(dataset.size(), true);
-  sample_cache[full_set_selector] = GenerateSamples(&dataset, dataset.size());
+  sample_cache.emplace(
+      full_set_selector,
+      CachedSamples{ResultSampler<T>(algorithm, dataset.begin(), dataset.end()),
+                    {}});
 
   std::stack<SelectionVectorAndSizePair> dfs;
   dfs.push(std::make_pair(full_set_selector, dataset.size()));
@@ -575,10 +763,10 @@ void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
         GenerateSuccessors(current_selector, current_size - 1);
     for (const auto& succ_pair : successors) {
       const SelectionVector& succ_selector = succ_pair.first;
-      size_t succ_size = succ_pair.second;
       bool is_new_succ = !sample_cache.contains(succ_selector);
 
-      // Generate successor samples if they don't exist.
+      // Set up sampling from the successor if it doesn't exist. Samples are
+      // only drawn when they are compared.
       if (is_new_succ) {
         std::vector<T> subset;
         for (int i = 0; i < succ_selector.size(); ++i) {
@@ -586,16 +774,20 @@ void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
             subset.push_back(dataset[i]);
           }
         }
-        sample_cache[succ_selector] = GenerateSamples(&subset, succ_size);
+        sample_cache.emplace(
+            succ_selector,
+            CachedSamples{
+                ResultSampler<T>(algorithm, subset.begin(), subset.end()), {}});
       }
-      if (!CheckDpPredicate(sample_cache[current_selector],
-                            sample_cache[succ_selector])) {
+      if (!CompareSamples(algorithm->GetEpsilon(),
+                          &sample_cache.at(current_selector),
+                          &sample_cache.at(succ_selector), &result)) {
         LOG(INFO) << "Fails DP on: ";
         std::vector<T> c_current = VectorFilter(dataset, current_selector);
         LOG(INFO) << std::setprecision(16) << VectorToString(c_current);
         std::vector<T> c_succ = VectorFilter(dataset, succ_selector);
         LOG(INFO) << std::setprecision(16) << VectorToString(c_succ);
-        ++num_comparison_failures_;
+        ++result.num_comparison_failures;
       }
 
       // Only include successors with non-empty subsets and have not been
@@ -605,6 +797,7 @@ void StochasticTester<T, OutputT>::CheckDifferentiallyPrivateOnDataset(
       }
     }
   }
+  return result;
 }
 
 template <typename T, typename OutputT>
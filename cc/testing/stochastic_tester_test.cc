@@ -126,6 +126,30 @@ class BoundedSumWithError : public BoundedSum<T> {
   std::unique_ptr<LaplaceMechanism> mechanism_;
 };
 
+// A version of BoundedSum where Epsilon() is overridden to report twice the
+// actual epsilon value, so it passes the DP predicate by a wide margin. Counts
+// the results that it generates.
+template <typename T>
+class BoundedSumWithExcessNoise : public BoundedSum<T> {
+ public:
+  BoundedSumWithExcessNoise(double epsilon, T lower, T upper,
+                            std::unique_ptr<LaplaceMechanism::Builder> builder,
+                            int64_t* num_results)
+      : BoundedSum<T>(epsilon, lower, upper, 1, 1, std::move(builder), nullptr,
+                      nullptr),
+        num_results_(num_results) {}
+
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    ++*num_results_;
+    return BoundedSum<T>::GenerateResult(privacy_budget, noise_interval_level);
+  }
+  double GetEpsilon() const override { return Algorithm<T>::GetEpsilon() * 2; }
+
+ private:
+  int64_t* num_results_;
+};
+
 // Count but returns error without dp for some results.
 template <typename T>
 class CountNoDpError : public Count<T> {
@@ -315,6 +339,104 @@ TEST(StochasticTesterTest, AllError) {
   EXPECT_TRUE(tester.Run());
 }
 
+TEST(StochasticTesterTest, ParallelBoundedSumTest) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  const double lower = sequence->RangeMin();
+  const double upper = sequence->RangeMax();
+  auto factory = [lower, upper]() -> std::unique_ptr<Algorithm<double>> {
+    return BoundedSum<double>::Builder()
+        .SetLaplaceMechanism(
+            absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+        .SetEpsilon(std::log(3))
+        .SetLower(lower)
+        .SetUpper(upper)
+        .Build()
+        .ValueOrDie();
+  };
+  StochasticTester<double, int64_t> tester(factory, std::move(sequence),
+                                         /*num_threads=*/4);
+  EXPECT_TRUE(tester.Run());
+}
+
+TEST(StochasticTesterTest, ParallelBoundedSumWithInsufficientNoiseTest) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  const double lower = sequence->RangeMin();
+  const double upper = sequence->RangeMax();
+  auto factory = [lower, upper]() -> std::unique_ptr<Algorithm<double>> {
+    return absl::make_unique<BoundedSumWithInsufficientNoise<double>>(
+        std::log(3), lower, upper,
+        absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>());
+  };
+  StochasticTester<double> tester(factory, std::move(sequence),
+                                  /*num_threads=*/4);
+  EXPECT_FALSE(tester.Run());
+}
+
+TEST(StochasticTesterTest, SequentialStopsEarlyWithWideMargin) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  int64_t num_results = 0;
+  auto algorithm = absl::make_unique<BoundedSumWithExcessNoise<double>>(
+      std::log(3), sequence->RangeMin(), sequence->RangeMax(),
+      absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>(),
+      &num_results);
+  StochasticTester<double> tester(std::move(algorithm), std::move(sequence),
+                                  /*num_datasets=*/1,
+                                  DefaultNumSamplesPerHistogram());
+  tester.SetSequentialLooks(DefaultNumSequentialLooks());
+  EXPECT_TRUE(tester.Run());
+  // Without sequential testing, all 2^3 subsets of the dataset get the full
+  // number of samples.
+  EXPECT_LT(num_results, 8 * DefaultNumSamplesPerHistogram());
+}
+
+TEST(StochasticTesterTest, SequentialBoundedSumWithInsufficientNoiseTest) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  auto algorithm = absl::make_unique<BoundedSumWithInsufficientNoise<double>>(
+      std::log(3), sequence->RangeMin(), sequence->RangeMax(),
+      absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>());
+  StochasticTester<double> tester(std::move(algorithm), std::move(sequence));
+  tester.SetSequentialLooks(DefaultNumSequentialLooks());
+  EXPECT_FALSE(tester.Run());
+}
+
+TEST(StochasticTesterTest, SequentialNonDpCountTest) {
+  std::vector<std::vector<double>> datasets({{1.0, 2.0, 3.0}});
+  auto sequence = absl::make_unique<StoredSequence<double>>(datasets);
+  auto algorithm = absl::make_unique<NonDpCount<double>>();
+  StochasticTester<double, int64_t> tester(
+      std::move(algorithm), std::move(sequence),
+      /*num_datasets=*/1, DefaultNumSamplesPerHistogram());
+  tester.SetSequentialLooks(DefaultNumSequentialLooks());
+  EXPECT_FALSE(tester.Run());
+}
+
+TEST(StochasticTesterTest, SequentialBoundedSumTest) {
+  auto sequence = absl::make_unique<HaltonSequence<double>>(
+      DefaultDatasetSize(), /*sorted_only=*/true, DefaultDataScale(),
+      DefaultDataOffset());
+  auto algorithm =
+      BoundedSum<double>::Builder()
+          .SetLaplaceMechanism(
+              absl::make_unique<test_utils::SeededLaplaceMechanism::Builder>())
+          .SetEpsilon(std::log(3))
+          .SetLower(sequence->RangeMin())
+          .SetUpper(sequence->RangeMax())
+          .Build()
+          .ValueOrDie();
+  StochasticTester<double, int64_t> tester(std::move(algorithm),
+                                         std::move(sequence));
+  tester.SetSequentialLooks(DefaultNumSequentialLooks());
+  EXPECT_TRUE(tester.Run());
+}
+
 }  // namespace
 }  // namespace testing
 }  // namespace differential_privacy
@@ -53,18 +53,18 @@ void CreateSingleScenarioCount(int scenario, double true_value, int number_of_sa
     +std::to_string(static_cast<int>(ratio*100))+"/Scenario"+std::to_string(scenario);
   mkdir(filepath.c_str(), 0777);
   for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
+    std::vector<int64_t> samplesA;
+    std::vector<int64_t> samplesB;
+    samplesA.reserve(number_of_samples);
+    samplesB.reserve(number_of_samples);
     for (int i=0; i<number_of_samples; i++) {
       int64_t outputA = DPCount(sampleA, implemented_epsilon, max_partitions);
-      samplefileA << outputA << "\n";
+      samplesA.push_back(outputA);
       int64_t outputB = DPCount(sampleB, implemented_epsilon,max_partitions);
-        samplefileB << outputB << "\n";
+      samplesB.push_back(outputB);
     }
-  samplefileA.close();
-  samplefileB.close();
+  WriteSamples(filepath+"/TestCase"+std::to_string(i)+"A", samplesA);
+  WriteSamples(filepath+"/TestCase"+std::to_string(i)+"B", samplesB);
   }
 }
 
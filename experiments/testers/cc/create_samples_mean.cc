@@ -103,40 +103,38 @@ void CreateSingleScenarioMean(int scenario, std::vector<double>valuesA,
   mkdir(filepath.c_str(), 0777);
 
   for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
+    std::vector<double> samplesA;
+    std::vector<double> samplesB;
+    samplesA.reserve(number_of_samples);
+    samplesB.reserve(number_of_samples);
 
     if (extra_values_length == 0) {
       for (int i=0; i<number_of_samples; i++) {
         double outputA = DPMean(valuesA, granularity,
           implemented_epsilon, max_partitions, max_contributions, lower, upper);
         double discretized_outputA = DiscretizeMean(outputA, granularity);
-        samplefileA << discretized_outputA << "\n";
+        samplesA.push_back(discretized_outputA);
         double outputB = DPMean(valuesB, granularity,
           implemented_epsilon, max_partitions, max_contributions, lower, upper);
         double discretized_outputB = DiscretizeMean(outputB, granularity);
-        samplefileB << discretized_outputB << "\n";
+        samplesB.push_back(discretized_outputB);
       }
-      samplefileA.close();
-      samplefileB.close();
     }
     else {
       for (int i=0; i<number_of_samples; i++) {
       double outputA = DPMean(valuesA, granularity,
         implemented_epsilon, max_partitions, max_contributions, lower, upper);
       double discretized_outputA = DiscretizeMean(outputA, granularity);
-        samplefileA << discretized_outputA << "\n";
+        samplesA.push_back(discretized_outputA);
       double outputB = DPLargeMean(initial_value, extra_values_length,
         extra_value, granularity, implemented_epsilon, max_partitions,
         max_contributions, lower, upper);
       double discretized_outputB = DiscretizeMean(outputB, granularity);
-        samplefileB << discretized_outputB << "\n";
+        samplesB.push_back(discretized_outputB);
       }
-      samplefileA.close();
-      samplefileB.close();
     }
+    WriteSamples(filepath+"/TestCase"+std::to_string(i)+"A", samplesA);
+    WriteSamples(filepath+"/TestCase"+std::to_string(i)+"B", samplesB);
   }   
 }
 // Runs each sample-pair with parameters that replicate those specified in:
@@ -74,22 +74,22 @@ void CreateSingleScenarioSum(int scenario, std::vector<double> values,
     +std::to_string(scenario);
   mkdir(filepath.c_str(), 0777);
   for (int i=0; i<7; i++) {
-    std::ofstream samplefileA;
-    std::ofstream samplefileB;
-    samplefileA.open(filepath+"/TestCase"+std::to_string(i)+"A.txt");
-    samplefileB.open(filepath+"/TestCase"+std::to_string(i)+"B.txt");
+    std::vector<double> samplesA;
+    std::vector<double> samplesB;
+    samplesA.reserve(number_of_samples);
+    samplesB.reserve(number_of_samples);
     for (int i=0; i<number_of_samples; i++) {
       int64_t outputA = BoundedSumAlgorithm(values, granularity,
         implemented_epsilon, max_partitions, lower, upper);
       double discretized_outputA = DiscretizeSum(outputA, granularity);
-      samplefileA << discretized_outputA << "\n";
+      samplesA.push_back(discretized_outputA);
       int64_t outputB = BoundedSumAlgorithm(neighbor_values, granularity,
         implemented_epsilon, max_partitions, lower, upper);
       double discretized_outputB = DiscretizeSum(outputB, granularity);
-      samplefileB << discretized_outputB << "\n";
+      samplesB.push_back(discretized_outputB);
     }
-  samplefileA.close();
-  samplefileB.close();
+  WriteSamples(filepath+"/TestCase"+std::to_string(i)+"A", samplesA);
+  WriteSamples(filepath+"/TestCase"+std::to_string(i)+"B", samplesB);
   }
 }
 
@@ -41,6 +41,7 @@
 #include "base/statusor.h"
 #include "proto/data.pb.h"
 #include "testing/sequence.h"
+#include "sample_writer.h"
 
 namespace differential_privacy {
 
@@ -38,15 +38,54 @@
 #include "algorithms/bounded-sum.h"
 #include "algorithms/bounded-mean.h"
 #include "algorithms/count.h"
+#include "algorithms/merge-all.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/util.h"
 #include "base/statusor.h"
 #include "proto/data.pb.h"
 #include "testing/sequence.h"
 #include "testing/stochastic_tester.h"
+#include "sample_writer.h"
+
+// Generates the scenarios of every ratio from ratio_min to ratio_max with
+// generate, on up to num_threads threads. The scenarios of different ratios
+// are written to different folders, so they can be generated in parallel.
+void GenerateAllRatios(const std::string& samples_folder, double ratio_min,
+  double ratio_max, double increment, int num_threads,
+  void (*generate)(double)) {
+  mkdir(samples_folder.c_str(), 0777);
+  int num_iterations = ceil((ratio_max - ratio_min) / increment);
+  differential_privacy::internal::ParallelFor(num_iterations + 1, num_threads,
+    [&](int64_t i) {
+      double ratio = i * increment + ratio_min;
+      int ratio_name = (int)lround(ratio*100);
+      std::string path = samples_folder+"/R"+std::to_string(ratio_name);
+      mkdir(path.c_str(), 0777);
+      generate(ratio);
+    });
+}
 
 int main(int argc, char *argv[]) {
 
+// Sample generation options, which can be given before the other parameters:
+// --binary_samples writes the samples in the binary format described in
+// sample_writer.h rather than as text, and --sample_threads=N generates the
+// samples of up to N ratios in parallel.
+  int sample_threads = 1;
+  int num_args = 1;
+  for (int i=1; i<argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--binary_samples") {
+      differential_privacy::testing::sample_format =
+        differential_privacy::testing::SampleFormat::kBinary;
+    } else if (arg.rfind("--sample_threads=", 0) == 0) {
+      sample_threads = std::max(1, atoi(arg.substr(17).c_str()));
+    } else {
+      argv[num_args++] = argv[i];
+    }
+  }
+  argc = num_args;
+
 // Runs Stochastic Tester over series of algorithms with insufficient noise.
   std::ofstream countfile;
   std::ofstream sumfile;
@@ -112,38 +151,19 @@ int main(int argc, char *argv[]) {
     meanfile.close();
 
 // Generates samples of Count algorithm with insufficient noise.
-  mkdir(differential_privacy::testing::count_samples_folder.c_str(), 0777);
-  int num_iterations = ceil((ratio_max - ratio_min) / increment);
-  for (double i=0; i <= num_iterations; ++i) {
-    double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string count_path = differential_privacy::testing::count_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(count_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosCount(ratio);
-  }
+  GenerateAllRatios(differential_privacy::testing::count_samples_folder,
+    ratio_min, ratio_max, increment, sample_threads,
+    differential_privacy::testing::GenerateAllScenariosCount);
 
 // // Generates samples of BoundedSum algorithm with insufficient noise.
-  mkdir(differential_privacy::testing::sum_samples_folder.c_str(), 0777);
-  for (double i=0; i <= num_iterations; ++i) {
-    double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string sum_path = differential_privacy::testing::sum_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(sum_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosSum(ratio);
-  }
+  GenerateAllRatios(differential_privacy::testing::sum_samples_folder,
+    ratio_min, ratio_max, increment, sample_threads,
+    differential_privacy::testing::GenerateAllScenariosSum);
 
 // // Generates samples of BoundedMean algorithm with insufficient noise.
-  mkdir(differential_privacy::testing::mean_samples_folder.c_str(), 0777);
-  for (double i=0; i <= num_iterations; ++i) {
-    double ratio = i * increment + ratio_min;
-    int ratio_name = (int)lround(ratio*100);
-    std::string mean_path = differential_privacy::testing::mean_samples_folder
-      +"/R"+std::to_string(ratio_name);
-    mkdir(mean_path.c_str(), 0777);
-    differential_privacy::testing::GenerateAllScenariosMean(ratio);
-  }
+  GenerateAllRatios(differential_privacy::testing::mean_samples_folder,
+    ratio_min, ratio_max, increment, sample_threads,
+    differential_privacy::testing::GenerateAllScenariosMean);
   
   return 0;
 }
@@ -0,0 +1,83 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sample_writer.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace differential_privacy {
+
+namespace testing {
+
+SampleFormat sample_format = SampleFormat::kText;
+
+namespace {
+
+constexpr char kMagic[8] = {'D', 'P', 'S', 'A', 'M', 'P', 'L', 'E'};
+constexpr uint32_t kVersion = 1;
+
+// Appends the bytes of value in little-endian order, whatever the byte order
+// of the machine.
+template <typename T>
+void AppendLittleEndian(T value, std::string* out) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(value));
+  for (int i = 0; i < sizeof(value); ++i) {
+    out->push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+  }
+}
+
+template <typename T>
+void Write(const std::string& name, const std::vector<T>& samples,
+  uint32_t type) {
+  std::string data;
+  std::string path;
+  if (sample_format == SampleFormat::kBinary) {
+    path = name + ".bin";
+    data.reserve(sizeof(kMagic) + 16 + samples.size() * sizeof(T));
+    data.append(kMagic, sizeof(kMagic));
+    AppendLittleEndian<uint32_t>(kVersion, &data);
+    AppendLittleEndian<uint32_t>(type, &data);
+    AppendLittleEndian<uint64_t>(samples.size(), &data);
+    for (const T& sample : samples) {
+      AppendLittleEndian<T>(sample, &data);
+    }
+  } else {
+    path = name + ".txt";
+    std::ostringstream text;
+    for (const T& sample : samples) {
+      text << sample << "\n";
+    }
+    data = text.str();
+  }
+  std::ofstream file(path, std::ios::binary);
+  file.write(data.data(), data.size());
+}
+
+} // namespace
+
+void WriteSamples(const std::string& name, const std::vector<double>& samples) {
+  Write(name, samples, /*type=*/0);
+}
+
+void WriteSamples(const std::string& name,
+  const std::vector<int64_t>& samples) {
+  Write(name, samples, /*type=*/1);
+}
+
+} // testing
+} // differential_privacy
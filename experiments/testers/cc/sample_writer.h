@@ -0,0 +1,53 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SAMPLE_WRITER_H
+#define SAMPLE_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace differential_privacy {
+
+namespace testing {
+
+// Format of the sample files written by the create_samples_* generators.
+//
+// kText writes one sample per line to <name>.txt, which the Statistical Tester
+// in the java folder reads.
+//
+// kBinary writes <name>.bin, which is meant to be memory-mapped by analysis
+// scripts. It starts with a 24-byte header: the 8 bytes "DPSAMPLE", the
+// format version 1 and the sample type (0 for doubles, 1 for 64-bit
+// integers) as 32-bit integers, and the number of samples as a 64-bit
+// integer. The samples follow the header. All values are little-endian, and
+// the samples are 8-byte aligned for memory-mapping, e.g., with NumPy:
+//   numpy.memmap(path, dtype="<f8", mode="r", offset=24)
+// with dtype="<i8" for integer samples, such as those of Count.
+enum class SampleFormat { kText, kBinary };
+
+// Format used by the generators. Set once by main before generating samples.
+extern SampleFormat sample_format;
+
+// Writes the samples to the file for the base path name, e.g.,
+// ".../TestCase0A", in sample_format. The whole file is written at once.
+void WriteSamples(const std::string& name, const std::vector<double>& samples);
+void WriteSamples(const std::string& name, const std::vector<int64_t>& samples);
+
+} // testing
+} // differential_privacy
+
+#endif // SAMPLE_WRITER_H